@@ -0,0 +1,24 @@
+# Copyright (c) 2023 The Orbit Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+find_package(lz4 CONFIG QUIET)
+
+# Conan and lz4's own CMake config name the targets after the kind of library.
+foreach(target LZ4::lz4_static LZ4::lz4_shared lz4::lz4_static lz4::lz4_shared LZ4::lz4)
+  if(TARGET ${target})
+    add_library(lz4::lz4 INTERFACE IMPORTED)
+    target_link_libraries(lz4::lz4 INTERFACE ${target})
+    return()
+  endif()
+endforeach()
+
+if(TARGET lz4::lz4)
+  return()
+endif()
+
+message(STATUS "lz4 not found via find_package. Trying via pkg-config...")
+
+find_package(PkgConfig REQUIRED)
+pkg_check_modules(LZ4 REQUIRED IMPORTED_TARGET liblz4)
+add_library(lz4::lz4 ALIAS PkgConfig::LZ4)
@@ -0,0 +1,24 @@
+# Copyright (c) 2023 The Orbit Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+find_package(zstd CONFIG QUIET)
+
+# Conan and zstd's own CMake config name the targets after the kind of library.
+foreach(target zstd::libzstd_static zstd::libzstd_shared)
+  if(TARGET ${target})
+    add_library(zstd::zstd INTERFACE IMPORTED)
+    target_link_libraries(zstd::zstd INTERFACE ${target})
+    return()
+  endif()
+endforeach()
+
+if(TARGET zstd::zstd)
+  return()
+endif()
+
+message(STATUS "zstd not found via find_package. Trying via pkg-config...")
+
+find_package(PkgConfig REQUIRED)
+pkg_check_modules(ZSTD REQUIRED IMPORTED_TARGET libzstd)
+add_library(zstd::zstd ALIAS PkgConfig::ZSTD)
@@ -52,6 +52,7 @@ class OrbitConan(ConanFile):
         self.build_requires('grpc/1.48.0')
         self.build_requires('protobuf/3.21.4')
         self.build_requires('gtest/1.11.0', force_host_context=True)
+        self.build_requires('benchmark/1.7.0', force_host_context=True)
 
     def requirements(self):
         if self.options.with_system_deps: return
@@ -60,6 +61,8 @@ class OrbitConan(ConanFile):
         self.requires("capstone/4.0.2")
         self.requires("grpc/1.48.0")
         self.requires("outcome/2.2.3")
+        self.requires("lz4/1.9.3")
+        self.requires("zstd/1.5.2")
         self.requires("llvm-core/13.0.0")
         if self.settings.os != "Windows":
             self.requires("volk/1.3.224.1")
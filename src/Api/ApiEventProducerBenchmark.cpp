@@ -0,0 +1,142 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <benchmark/benchmark.h>
+#include <google/protobuf/arena.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "ApiInterface/Orbit.h"
+#include "ApiUtils/ApiEventRecord.h"
+#include "ApiUtils/Event.h"
+#include "CaptureEventProducer/LockFreeBufferCaptureEventProducer.h"
+#include "CaptureEventProducer/PerThreadBufferCaptureEventProducer.h"
+#include "GrpcProtos/capture.pb.h"
+#include "OrbitBase/Profiling.h"
+#include "OrbitBase/ThreadUtils.h"
+
+// These benchmarks measure the cost of an ORBIT_SCOPE, i.e., of enqueuing an ApiScopeStart and an
+// ApiScopeStop, in the threads of the target while an Orbit capture is running. Each iteration is
+// one ORBIT_SCOPE, so with real time the time per iteration is the time per ORBIT_SCOPE in each
+// thread. The producers are not connected to OrbitService: instead of the forwarder thread, a
+// thread dequeues the events concurrently and discards them.
+
+namespace orbit_api {
+
+namespace {
+
+constexpr const char* kScopeName = "BenchmarkScope";
+constexpr size_t kMaxEventsPerDequeue = 10'000;
+
+// The previous implementation of LockFreeApiEventProducer, kept as a baseline: a single
+// moodycamel::ConcurrentQueue of ApiEventVariant for all threads.
+class ConcurrentQueueApiEventProducer
+    : public orbit_capture_event_producer::LockFreeBufferCaptureEventProducer<ApiEventVariant> {
+ public:
+  using LockFreeBufferCaptureEventProducer<ApiEventVariant>::DequeueIntermediateEvents;
+
+  void EnqueueScope(uint32_t pid, uint32_t tid) {
+    EnqueueIntermediateEvent(ApiScopeStart{pid, tid, orbit_base::CaptureTimestampNs(), kScopeName,
+                                           kOrbitColorAuto, kOrbitDefaultGroupId, 0});
+    EnqueueIntermediateEvent(ApiScopeStop{pid, tid, orbit_base::CaptureTimestampNs()});
+  }
+
+ protected:
+  orbit_grpc_protos::ProducerCaptureEvent* TranslateIntermediateEvent(
+      ApiEventVariant&& /*intermediate_event*/, google::protobuf::Arena* /*arena*/) override {
+    return nullptr;
+  }
+};
+
+class PerThreadBufferApiEventProducer
+    : public orbit_capture_event_producer::PerThreadBufferCaptureEventProducer<ApiEventRecord> {
+ public:
+  using PerThreadBufferCaptureEventProducer<ApiEventRecord>::DequeueIntermediateEvents;
+
+  void EnqueueScope(uint32_t /*pid*/, uint32_t tid) {
+    EnqueueIntermediateEvent(ApiEventRecord::CreateScopeStart(
+        tid, orbit_base::CaptureTimestampNs(), kScopeName, kOrbitColorAuto, kOrbitDefaultGroupId,
+        0));
+    EnqueueIntermediateEvent(
+        ApiEventRecord::CreateScopeStop(tid, orbit_base::CaptureTimestampNs()));
+  }
+
+ protected:
+  orbit_grpc_protos::ProducerCaptureEvent* TranslateIntermediateEvent(
+      ApiEventRecord&& /*intermediate_event*/, google::protobuf::Arena* /*arena*/) override {
+    return nullptr;
+  }
+};
+
+// Dequeues and discards the events of `producer` in a separate thread until destroyed.
+template <typename Producer, typename IntermediateEventT>
+class ConcurrentDequeuer {
+ public:
+  explicit ConcurrentDequeuer(Producer* producer)
+      : thread_{[this, producer] {
+          std::vector<IntermediateEventT> events(kMaxEventsPerDequeue);
+          while (!exit_requested_) {
+            if (producer->DequeueIntermediateEvents(events.data(), kMaxEventsPerDequeue) == 0) {
+              std::this_thread::yield();
+            }
+          }
+        }} {}
+
+  ~ConcurrentDequeuer() {
+    exit_requested_ = true;
+    thread_.join();
+  }
+
+  ConcurrentDequeuer(const ConcurrentDequeuer&) = delete;
+  ConcurrentDequeuer& operator=(const ConcurrentDequeuer&) = delete;
+
+ private:
+  std::atomic<bool> exit_requested_ = false;
+  std::thread thread_;
+};
+
+template <typename Producer, typename IntermediateEventT>
+void RunOrbitScopeBenchmark(benchmark::State& state, Producer* producer) {
+  std::unique_ptr<ConcurrentDequeuer<Producer, IntermediateEventT>> dequeuer;
+  if (state.thread_index() == 0) {
+    dequeuer = std::make_unique<ConcurrentDequeuer<Producer, IntermediateEventT>>(producer);
+  }
+
+  static const uint32_t pid = orbit_base::GetCurrentProcessId();
+  const uint32_t tid = orbit_base::GetCurrentThreadId();
+  for (auto _ : state) {
+    producer->EnqueueScope(pid, tid);
+  }
+  state.SetItemsProcessed(2 * state.iterations());
+}
+
+// The producers are shared by all the threads of a benchmark and outlive them.
+
+void BM_OrbitScopeWithConcurrentQueue(benchmark::State& state) {
+  static ConcurrentQueueApiEventProducer producer;
+  RunOrbitScopeBenchmark<ConcurrentQueueApiEventProducer, ApiEventVariant>(state, &producer);
+}
+
+void BM_OrbitScopeWithPerThreadBuffers(benchmark::State& state) {
+  static PerThreadBufferApiEventProducer producer;
+  const uint64_t overflow_event_count_before = producer.GetOverflowEventCount();
+  RunOrbitScopeBenchmark<PerThreadBufferApiEventProducer, ApiEventRecord>(state, &producer);
+  // Events go to the slower overflow queues when the dequeuing thread doesn't keep up with the
+  // enqueuing threads.
+  if (state.thread_index() == 0) {
+    state.counters["overflow_events"] =
+        static_cast<double>(producer.GetOverflowEventCount() - overflow_event_count_before);
+  }
+}
+
+}  // namespace
+
+BENCHMARK(BM_OrbitScopeWithConcurrentQueue)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK(BM_OrbitScopeWithPerThreadBuffers)->ThreadRange(1, 64)->UseRealTime();
+
+}  // namespace orbit_api
@@ -4,22 +4,33 @@
 
 #include "LockFreeApiEventProducer.h"
 
-#include <variant>
-
 namespace orbit_api {
 
 orbit_grpc_protos::ProducerCaptureEvent* LockFreeApiEventProducer::TranslateIntermediateEvent(
-    ApiEventVariant&& raw_api_event, google::protobuf::Arena* arena) {
-  auto* capture_event =
-      google::protobuf::Arena::CreateMessage<orbit_grpc_protos::ProducerCaptureEvent>(arena);
-
-  std::visit(
-      [capture_event](const auto& event) {
-        orbit_api::FillProducerCaptureEventFromApiEvent(event, capture_event);
-      },
-      raw_api_event);
-
+    ApiEventRecord&& api_event_record, google::protobuf::Arena* arena) {
+  orbit_grpc_protos::ProducerCaptureEvent* capture_event = nullptr;
+  record_assembler_.AddRecord(
+      api_event_record, [&](const ApiEventRecord& record, const char* name) {
+        capture_event =
+            google::protobuf::Arena::CreateMessage<orbit_grpc_protos::ProducerCaptureEvent>(arena);
+        FillProducerCaptureEventFromApiEventRecord(record, name, pid_, capture_event);
+      });
   return capture_event;
 }
 
-}  // namespace orbit_api
\ No newline at end of file
+void LockFreeApiEventProducer::WriteSharedMemoryRecord(
+    ApiEventRecord&& api_event_record, google::protobuf::Arena* /*arena*/,
+    absl::FunctionRef<char*(orbit_shared_memory_transport::SharedMemoryRecordType type,
+                            uint64_t size)>
+        begin_record) {
+  record_assembler_.AddRecord(
+      api_event_record, [&](const ApiEventRecord& record, const char* name) {
+        char* payload =
+            begin_record(orbit_shared_memory_transport::SharedMemoryRecordType::kApiEvent,
+                         GetSerializedApiEventRecordSize(name));
+        if (payload == nullptr) return;
+        SerializeApiEventRecord(record, name, payload);
+      });
+}
+
+}  // namespace orbit_api
@@ -5,22 +5,26 @@
 #ifndef API_LOCK_FREE_API_EVENT_PRODUCER_H_
 #define API_LOCK_FREE_API_EVENT_PRODUCER_H_
 
+#include <absl/functional/function_ref.h>
 #include <google/protobuf/arena.h>
+#include <stdint.h>
 
-#include <utility>
-#include <variant>
-
-#include "ApiUtils/Event.h"
-#include "CaptureEventProducer/LockFreeBufferCaptureEventProducer.h"
+#include "ApiUtils/ApiEventRecord.h"
+#include "CaptureEventProducer/PerThreadBufferCaptureEventProducer.h"
 #include "GrpcProtos/capture.pb.h"
+#include "OrbitBase/ThreadUtils.h"
 #include "ProducerSideChannel/ProducerSideChannel.h"
+#include "SharedMemoryTransport/SharedMemoryRecords.h"
 
 namespace orbit_api {
 
-// This class is used to enqueue orbit_api::ApiEvent events from multiple threads and relay them to
-// OrbitService in the form of orbit_grpc_protos::ApiEvent events.
+// This class is used to enqueue orbit_api::ApiEventRecord events from multiple threads and relay
+// them to OrbitService in the form of orbit_grpc_protos::Api* events. Each thread enqueues its
+// events in its own buffer, so that threads calling the Orbit API concurrently don't contend. The
+// events with a name that didn't fit in a single record are only relayed once all their records
+// have been dequeued.
 class LockFreeApiEventProducer
-    : public orbit_capture_event_producer::LockFreeBufferCaptureEventProducer<ApiEventVariant> {
+    : public orbit_capture_event_producer::PerThreadBufferCaptureEventProducer<ApiEventRecord> {
  public:
   LockFreeApiEventProducer() {
     BuildAndStart(orbit_producer_side_channel::CreateProducerSideChannel());
@@ -30,7 +34,18 @@ class LockFreeApiEventProducer
 
  protected:
   [[nodiscard]] orbit_grpc_protos::ProducerCaptureEvent* TranslateIntermediateEvent(
-      ApiEventVariant&& raw_api_event, google::protobuf::Arena* arena) override;
+      ApiEventRecord&& api_event_record, google::protobuf::Arena* arena) override;
+
+  void WriteSharedMemoryRecord(
+      ApiEventRecord&& api_event_record, google::protobuf::Arena* arena,
+      absl::FunctionRef<char*(orbit_shared_memory_transport::SharedMemoryRecordType type,
+                              uint64_t size)>
+          begin_record) override;
+
+ private:
+  const uint32_t pid_ = orbit_base::GetCurrentProcessId();
+  // Only used by the forwarder thread.
+  ApiEventRecordAssembler record_assembler_;
 };
 
 }  // namespace orbit_api
@@ -8,7 +8,7 @@
 
 #include <utility>
 
-#include "ApiUtils/Event.h"
+#include "ApiUtils/ApiEventRecord.h"
 #include "LockFreeApiEventProducer.h"
 #include "OrbitApiVersions.h"
 #include "OrbitBase/Logging.h"
@@ -20,22 +20,47 @@
 #endif
 
 namespace {
+
+using orbit_api::ApiEventRecord;
+
 orbit_api::LockFreeApiEventProducer& GetCaptureEventProducer() {
   static orbit_api::LockFreeApiEventProducer producer;
   return producer;
 }
 
-template <typename Event, typename... Types>
-void EnqueueApiEvent(Types... args) {
+// `create_record` is one of the `ApiEventRecord::Create...` functions, which take the tid and the
+// timestamp followed by the arguments specific to the event.
+template <typename... Params, typename... Args>
+void EnqueueApiEvent(ApiEventRecord (*create_record)(uint32_t, uint64_t, Params...),
+                     Args... args) {
+  orbit_api::LockFreeApiEventProducer& producer = GetCaptureEventProducer();
+
+  if (!producer.IsCapturing()) return;
+
+  thread_local uint32_t tid = orbit_base::GetCurrentThreadId();
+  uint64_t timestamp_ns = orbit_base::CaptureTimestampNs();
+  producer.EnqueueIntermediateEvent(create_record(tid, timestamp_ns, args...));
+}
+
+// Same as EnqueueApiEvent, for the `ApiEventRecord::Create...` functions that take the name of the
+// event after the timestamp. A name that doesn't fit in the record is carried by continuation
+// records, enqueued right after it.
+template <typename... Params, typename... Args>
+void EnqueueApiEventWithName(ApiEventRecord (*create_record)(uint32_t, uint64_t, const char*,
+                                                             Params...),
+                             const char* name, Args... args) {
   orbit_api::LockFreeApiEventProducer& producer = GetCaptureEventProducer();
 
   if (!producer.IsCapturing()) return;
 
-  static uint32_t pid = orbit_base::GetCurrentProcessId();
   thread_local uint32_t tid = orbit_base::GetCurrentThreadId();
   uint64_t timestamp_ns = orbit_base::CaptureTimestampNs();
-  Event event{pid, tid, timestamp_ns, args...};
-  producer.EnqueueIntermediateEvent(event);
+  ApiEventRecord record = create_record(tid, timestamp_ns, name, args...);
+  const uint32_t name_continuation_count = record.name_continuation_count;
+  producer.EnqueueIntermediateEvent(std::move(record));
+  for (uint32_t index = 1; index <= name_continuation_count; ++index) {
+    producer.EnqueueIntermediateEvent(ApiEventRecord::CreateNameContinuation(tid, name, index));
+  }
 }
 
 void orbit_api_start_v1(const char* name, orbit_api_color color, uint64_t group_id,
@@ -43,59 +68,61 @@ void orbit_api_start_v1(const char* name, orbit_api_color color, uint64_t group_
   if (caller_address == kOrbitCallerAddressAuto) {
     caller_address = ORBIT_GET_CALLER_PC();
   }
-  EnqueueApiEvent<orbit_api::ApiScopeStart>(name, color, group_id, caller_address);
+  EnqueueApiEventWithName(&ApiEventRecord::CreateScopeStart, name, color, group_id, caller_address);
 }
 
 [[deprecated]] void orbit_api_start(const char* name, orbit_api_color color) {
   uint64_t return_address = ORBIT_GET_CALLER_PC();
-  EnqueueApiEvent<orbit_api::ApiScopeStart>(
-      name, color, static_cast<uint64_t>(kOrbitDefaultGroupId), return_address);
+  EnqueueApiEventWithName(&ApiEventRecord::CreateScopeStart, name, color,
+                  static_cast<uint64_t>(kOrbitDefaultGroupId), return_address);
 }
 
-void orbit_api_stop() { EnqueueApiEvent<orbit_api::ApiScopeStop>(); }
+void orbit_api_stop() { EnqueueApiEvent(&ApiEventRecord::CreateScopeStop); }
 
 void orbit_api_start_async_v1(const char* name, uint64_t id, orbit_api_color color,
                               uint64_t caller_address) {
   if (caller_address == kOrbitCallerAddressAuto) {
     caller_address = ORBIT_GET_CALLER_PC();
   }
-  EnqueueApiEvent<orbit_api::ApiScopeStartAsync>(name, id, color, caller_address);
+  EnqueueApiEventWithName(&ApiEventRecord::CreateScopeStartAsync, name, id, color, caller_address);
 }
 
 [[deprecated]] void orbit_api_start_async(const char* name, uint64_t id, orbit_api_color color) {
   uint64_t return_address = ORBIT_GET_CALLER_PC();
-  EnqueueApiEvent<orbit_api::ApiScopeStartAsync>(name, id, color, return_address);
+  EnqueueApiEventWithName(&ApiEventRecord::CreateScopeStartAsync, name, id, color, return_address);
 }
 
-void orbit_api_stop_async(uint64_t id) { EnqueueApiEvent<orbit_api::ApiScopeStopAsync>(id); }
+void orbit_api_stop_async(uint64_t id) {
+  EnqueueApiEvent(&ApiEventRecord::CreateScopeStopAsync, id);
+}
 
 void orbit_api_track_int(const char* name, int32_t value, orbit_api_color color) {
-  EnqueueApiEvent<orbit_api::ApiTrackInt>(name, value, color);
+  EnqueueApiEventWithName(&ApiEventRecord::CreateTrackInt, name, value, color);
 }
 
 void orbit_api_track_int64(const char* name, int64_t value, orbit_api_color color) {
-  EnqueueApiEvent<orbit_api::ApiTrackInt64>(name, value, color);
+  EnqueueApiEventWithName(&ApiEventRecord::CreateTrackInt64, name, value, color);
 }
 
 void orbit_api_track_uint(const char* name, uint32_t value, orbit_api_color color) {
-  EnqueueApiEvent<orbit_api::ApiTrackUint>(name, value, color);
+  EnqueueApiEventWithName(&ApiEventRecord::CreateTrackUint, name, value, color);
 }
 
 void orbit_api_track_uint64(const char* name, uint64_t value, orbit_api_color color) {
-  EnqueueApiEvent<orbit_api::ApiTrackUint64>(name, value, color);
+  EnqueueApiEventWithName(&ApiEventRecord::CreateTrackUint64, name, value, color);
 }
 
 void orbit_api_track_float(const char* name, float value, orbit_api_color color) {
-  EnqueueApiEvent<orbit_api::ApiTrackFloat>(name, value, color);
+  EnqueueApiEventWithName(&ApiEventRecord::CreateTrackFloat, name, value, color);
 }
 
 void orbit_api_track_double(const char* name, double value, orbit_api_color color) {
-  EnqueueApiEvent<orbit_api::ApiTrackDouble>(name, value, color);
+  EnqueueApiEventWithName(&ApiEventRecord::CreateTrackDouble, name, value, color);
 }
 
 void orbit_api_async_string(const char* str, uint64_t id, orbit_api_color color) {
   if (str == nullptr) return;
-  EnqueueApiEvent<orbit_api::ApiStringEvent>(str, id, color);
+  EnqueueApiEventWithName(&ApiEventRecord::CreateStringEvent, str, id, color);
 }
 
 template <typename OrbitApiT>
@@ -0,0 +1,340 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ApiUtils/ApiEventRecord.h"
+
+#include <absl/base/optimization.h>
+#include <absl/strings/str_format.h>
+#include <string.h>
+
+#include <string>
+
+#include "ApiUtils/EncodedString.h"
+#include "GrpcProtos/capture.pb.h"
+#include "OrbitBase/Logging.h"
+
+namespace orbit_api {
+
+bool ApiEventRecord::CopyName(const char* source) {
+  // Copy the name and look for its end in the same pass.
+  size_t length = 0;
+  for (; length < kMaxNameLength && source[length] != '\0'; ++length) {
+    name[length] = source[length];
+  }
+  name[length] = '\0';
+  return source[length] != '\0';
+}
+
+void ApiEventRecord::SetName(const char* source) {
+  if (source == nullptr) return;
+  if (ABSL_PREDICT_TRUE(!CopyName(source))) return;
+
+  // Slow path: the rest of the name goes to continuation records.
+  const size_t remaining_length = strlen(source + kMaxNameLength);
+  name_continuation_count = (remaining_length + kMaxNameLength - 1) / kMaxNameLength;
+}
+
+ApiEventRecord ApiEventRecord::CreateScopeStart(uint32_t tid, uint64_t timestamp_ns,
+                                                const char* name, orbit_api_color color,
+                                                uint64_t group_id, uint64_t address_in_function) {
+  ApiEventRecord record{Type::kScopeStart, tid, timestamp_ns};
+  record.SetName(name);
+  record.color_rgba = color;
+  record.id = group_id;
+  record.address_in_function = address_in_function;
+  return record;
+}
+
+ApiEventRecord ApiEventRecord::CreateScopeStop(uint32_t tid, uint64_t timestamp_ns) {
+  return ApiEventRecord{Type::kScopeStop, tid, timestamp_ns};
+}
+
+ApiEventRecord ApiEventRecord::CreateScopeStartAsync(uint32_t tid, uint64_t timestamp_ns,
+                                                     const char* name, uint64_t id,
+                                                     orbit_api_color color,
+                                                     uint64_t address_in_function) {
+  ApiEventRecord record{Type::kScopeStartAsync, tid, timestamp_ns};
+  record.SetName(name);
+  record.id = id;
+  record.color_rgba = color;
+  record.address_in_function = address_in_function;
+  return record;
+}
+
+ApiEventRecord ApiEventRecord::CreateScopeStopAsync(uint32_t tid, uint64_t timestamp_ns,
+                                                    uint64_t id) {
+  ApiEventRecord record{Type::kScopeStopAsync, tid, timestamp_ns};
+  record.id = id;
+  return record;
+}
+
+ApiEventRecord ApiEventRecord::CreateStringEvent(uint32_t tid, uint64_t timestamp_ns,
+                                                 const char* name, uint64_t id,
+                                                 orbit_api_color color) {
+  ApiEventRecord record{Type::kStringEvent, tid, timestamp_ns};
+  record.SetName(name);
+  record.id = id;
+  record.color_rgba = color;
+  return record;
+}
+
+ApiEventRecord ApiEventRecord::CreateTrackInt(uint32_t tid, uint64_t timestamp_ns,
+                                              const char* name, int32_t value,
+                                              orbit_api_color color) {
+  ApiEventRecord record{Type::kTrackInt, tid, timestamp_ns};
+  record.SetName(name);
+  record.value.int_value = value;
+  record.color_rgba = color;
+  return record;
+}
+
+ApiEventRecord ApiEventRecord::CreateTrackInt64(uint32_t tid, uint64_t timestamp_ns,
+                                                const char* name, int64_t value,
+                                                orbit_api_color color) {
+  ApiEventRecord record{Type::kTrackInt64, tid, timestamp_ns};
+  record.SetName(name);
+  record.value.int_value = value;
+  record.color_rgba = color;
+  return record;
+}
+
+ApiEventRecord ApiEventRecord::CreateTrackUint(uint32_t tid, uint64_t timestamp_ns,
+                                               const char* name, uint32_t value,
+                                               orbit_api_color color) {
+  ApiEventRecord record{Type::kTrackUint, tid, timestamp_ns};
+  record.SetName(name);
+  record.value.uint_value = value;
+  record.color_rgba = color;
+  return record;
+}
+
+ApiEventRecord ApiEventRecord::CreateTrackUint64(uint32_t tid, uint64_t timestamp_ns,
+                                                 const char* name, uint64_t value,
+                                                 orbit_api_color color) {
+  ApiEventRecord record{Type::kTrackUint64, tid, timestamp_ns};
+  record.SetName(name);
+  record.value.uint_value = value;
+  record.color_rgba = color;
+  return record;
+}
+
+ApiEventRecord ApiEventRecord::CreateTrackFloat(uint32_t tid, uint64_t timestamp_ns,
+                                                const char* name, float value,
+                                                orbit_api_color color) {
+  ApiEventRecord record{Type::kTrackFloat, tid, timestamp_ns};
+  record.SetName(name);
+  record.value.float_value = value;
+  record.color_rgba = color;
+  return record;
+}
+
+ApiEventRecord ApiEventRecord::CreateTrackDouble(uint32_t tid, uint64_t timestamp_ns,
+                                                 const char* name, double value,
+                                                 orbit_api_color color) {
+  ApiEventRecord record{Type::kTrackDouble, tid, timestamp_ns};
+  record.SetName(name);
+  record.value.double_value = value;
+  record.color_rgba = color;
+  return record;
+}
+
+ApiEventRecord ApiEventRecord::CreateNameContinuation(uint32_t tid, const char* name,
+                                                      uint32_t index) {
+  ApiEventRecord record{Type::kNameContinuation, tid, 0};
+  record.CopyName(name + size_t{index} * kMaxNameLength);
+  return record;
+}
+
+void ApiEventRecordAssembler::AddRecord(
+    const ApiEventRecord& record,
+    absl::FunctionRef<void(const ApiEventRecord& record, const char* name)> action) {
+  if (record.type == ApiEventRecord::Type::kNameContinuation) {
+    auto pending_event_it = pending_events_by_tid_.find(record.tid);
+    // The record of the event was dropped.
+    if (pending_event_it == pending_events_by_tid_.end()) return;
+    PendingEvent& pending_event = pending_event_it->second;
+    pending_event.name.append(record.GetName());
+    if (--pending_event.missing_continuation_count > 0) return;
+    action(pending_event.record, pending_event.name.c_str());
+    pending_events_by_tid_.erase(pending_event_it);
+    return;
+  }
+
+  // A pending event of the same thread can only be left if its continuation records were dropped.
+  pending_events_by_tid_.erase(record.tid);
+  if (ABSL_PREDICT_TRUE(record.name_continuation_count == 0)) {
+    action(record, record.GetName());
+    return;
+  }
+  pending_events_by_tid_.insert_or_assign(
+      record.tid, PendingEvent{record, record.GetName(), record.name_continuation_count});
+}
+
+namespace {
+
+template <typename ApiEventT>
+void SetCommonFields(const ApiEventRecord& record, uint32_t pid, ApiEventT* api_event) {
+  api_event->set_pid(pid);
+  api_event->set_tid(record.tid);
+  api_event->set_timestamp_ns(record.timestamp_ns);
+}
+
+template <typename ApiTrackT>
+void SetTrackFields(const ApiEventRecord& record, const char* name, uint32_t pid,
+                    ApiTrackT* api_track) {
+  SetCommonFields(record, pid, api_track);
+  EncodeString(name, api_track);
+  api_track->set_color_rgba(record.color_rgba);
+}
+
+// `name` is passed separately from `record`, so that serialized records don't need to be
+// deserialized to an ApiEventRecord with its own copy of the name.
+void FillProducerCaptureEvent(const ApiEventRecord& record, const char* name, uint32_t pid,
+                              orbit_grpc_protos::ProducerCaptureEvent* capture_event) {
+  switch (record.type) {
+    case ApiEventRecord::Type::kScopeStart: {
+      orbit_grpc_protos::ApiScopeStart* api_event = capture_event->mutable_api_scope_start();
+      SetCommonFields(record, pid, api_event);
+      EncodeString(name, api_event);
+      api_event->set_color_rgba(record.color_rgba);
+      api_event->set_group_id(record.id);
+      api_event->set_address_in_function(record.address_in_function);
+    } break;
+    case ApiEventRecord::Type::kScopeStop:
+      SetCommonFields(record, pid, capture_event->mutable_api_scope_stop());
+      break;
+    case ApiEventRecord::Type::kScopeStartAsync: {
+      orbit_grpc_protos::ApiScopeStartAsync* api_event =
+          capture_event->mutable_api_scope_start_async();
+      SetCommonFields(record, pid, api_event);
+      EncodeString(name, api_event);
+      api_event->set_color_rgba(record.color_rgba);
+      api_event->set_id(record.id);
+      api_event->set_address_in_function(record.address_in_function);
+    } break;
+    case ApiEventRecord::Type::kScopeStopAsync: {
+      orbit_grpc_protos::ApiScopeStopAsync* api_event =
+          capture_event->mutable_api_scope_stop_async();
+      SetCommonFields(record, pid, api_event);
+      api_event->set_id(record.id);
+    } break;
+    case ApiEventRecord::Type::kStringEvent: {
+      orbit_grpc_protos::ApiStringEvent* api_event = capture_event->mutable_api_string_event();
+      SetCommonFields(record, pid, api_event);
+      EncodeString(name, api_event);
+      api_event->set_id(record.id);
+      api_event->set_color_rgba(record.color_rgba);
+    } break;
+    case ApiEventRecord::Type::kTrackInt: {
+      orbit_grpc_protos::ApiTrackInt* api_event = capture_event->mutable_api_track_int();
+      SetTrackFields(record, name, pid, api_event);
+      api_event->set_data(static_cast<int32_t>(record.value.int_value));
+    } break;
+    case ApiEventRecord::Type::kTrackInt64: {
+      orbit_grpc_protos::ApiTrackInt64* api_event = capture_event->mutable_api_track_int64();
+      SetTrackFields(record, name, pid, api_event);
+      api_event->set_data(record.value.int_value);
+    } break;
+    case ApiEventRecord::Type::kTrackUint: {
+      orbit_grpc_protos::ApiTrackUint* api_event = capture_event->mutable_api_track_uint();
+      SetTrackFields(record, name, pid, api_event);
+      api_event->set_data(static_cast<uint32_t>(record.value.uint_value));
+    } break;
+    case ApiEventRecord::Type::kTrackUint64: {
+      orbit_grpc_protos::ApiTrackUint64* api_event = capture_event->mutable_api_track_uint64();
+      SetTrackFields(record, name, pid, api_event);
+      api_event->set_data(record.value.uint_value);
+    } break;
+    case ApiEventRecord::Type::kTrackFloat: {
+      orbit_grpc_protos::ApiTrackFloat* api_event = capture_event->mutable_api_track_float();
+      SetTrackFields(record, name, pid, api_event);
+      api_event->set_data(record.value.float_value);
+    } break;
+    case ApiEventRecord::Type::kTrackDouble: {
+      orbit_grpc_protos::ApiTrackDouble* api_event = capture_event->mutable_api_track_double();
+      SetTrackFields(record, name, pid, api_event);
+      api_event->set_data(record.value.double_value);
+    } break;
+    case ApiEventRecord::Type::kNone:
+    case ApiEventRecord::Type::kNameContinuation:
+      ORBIT_UNREACHABLE();
+  }
+}
+
+// The fixed-size part of a serialized ApiEventRecord. The name follows, without terminating null
+// character.
+struct SerializedApiEventRecordHeader {
+  uint64_t timestamp_ns;
+  uint64_t id;
+  uint64_t address_in_function;
+  uint64_t value;
+  uint32_t tid;
+  uint32_t color_rgba;
+  uint32_t name_length;
+  ApiEventRecord::Type type;
+  uint8_t reserved[3];
+};
+
+static_assert(sizeof(SerializedApiEventRecordHeader) == 48);
+static_assert(sizeof(ApiEventRecord::value) == sizeof(SerializedApiEventRecordHeader::value));
+
+}  // namespace
+
+void FillProducerCaptureEventFromApiEventRecord(
+    const ApiEventRecord& record, const char* name, uint32_t pid,
+    orbit_grpc_protos::ProducerCaptureEvent* capture_event) {
+  FillProducerCaptureEvent(record, name, pid, capture_event);
+}
+
+size_t GetSerializedApiEventRecordSize(const char* name) {
+  return sizeof(SerializedApiEventRecordHeader) + strlen(name);
+}
+
+void SerializeApiEventRecord(const ApiEventRecord& record, const char* name, char* buffer) {
+  SerializedApiEventRecordHeader header{};
+  header.timestamp_ns = record.timestamp_ns;
+  header.id = record.id;
+  header.address_in_function = record.address_in_function;
+  memcpy(&header.value, &record.value, sizeof(header.value));
+  header.tid = record.tid;
+  header.color_rgba = record.color_rgba;
+  header.name_length = strlen(name);
+  header.type = record.type;
+  memcpy(buffer, &header, sizeof(header));
+  memcpy(buffer + sizeof(header), name, header.name_length);
+}
+
+ErrorMessageOr<void> FillProducerCaptureEventFromSerializedApiEventRecord(
+    absl::Span<const char> serialized_record, uint32_t pid,
+    orbit_grpc_protos::ProducerCaptureEvent* capture_event) {
+  SerializedApiEventRecordHeader header;
+  if (serialized_record.size() < sizeof(header)) {
+    return ErrorMessage{"Serialized ApiEventRecord is too small"};
+  }
+  memcpy(&header, serialized_record.data(), sizeof(header));
+  // Continuation records are never serialized, as the full name is.
+  if (header.type == ApiEventRecord::Type::kNone ||
+      header.type > ApiEventRecord::Type::kTrackDouble) {
+    return ErrorMessage{absl::StrFormat("Serialized ApiEventRecord has invalid type %u",
+                                        static_cast<uint8_t>(header.type))};
+  }
+  if (header.name_length != serialized_record.size() - sizeof(header)) {
+    return ErrorMessage{absl::StrFormat("Serialized ApiEventRecord has invalid name length %u",
+                                        header.name_length)};
+  }
+
+  ApiEventRecord record;
+  record.timestamp_ns = header.timestamp_ns;
+  record.id = header.id;
+  record.address_in_function = header.address_in_function;
+  memcpy(&record.value, &header.value, sizeof(record.value));
+  record.tid = header.tid;
+  record.color_rgba = header.color_rgba;
+  record.type = header.type;
+  const std::string name(serialized_record.data() + sizeof(header), header.name_length);
+  FillProducerCaptureEvent(record, name.c_str(), pid, capture_event);
+  return outcome::success();
+}
+
+}  // namespace orbit_api
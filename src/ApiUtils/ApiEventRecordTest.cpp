@@ -0,0 +1,242 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <google/protobuf/util/message_differencer.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ApiUtils/ApiEventRecord.h"
+#include "ApiUtils/Event.h"
+#include "GrpcProtos/capture.pb.h"
+
+using google::protobuf::util::MessageDifferencer;
+using orbit_grpc_protos::ProducerCaptureEvent;
+
+namespace orbit_api {
+
+namespace {
+
+constexpr uint32_t kPid = 42;
+constexpr uint32_t kTid = 43;
+constexpr uint64_t kTimestampNs = 1'000'000;
+constexpr uint64_t kId = 44;
+constexpr uint64_t kAddressInFunction = 0x1234;
+constexpr orbit_api_color kColor = kOrbitColorLightBlue;
+
+const char* const kShortName = "short name";
+const std::string kMaxLengthName(ApiEventRecord::kMaxNameLength, 'x');
+const std::string kLongName(200, 'x');
+
+// Returns `record` followed by its continuation records for `name`, as enqueued by the Orbit API.
+[[nodiscard]] std::vector<ApiEventRecord> CreateRecords(const ApiEventRecord& record,
+                                                        const char* name) {
+  std::vector<ApiEventRecord> records{record};
+  for (uint32_t index = 1; index <= record.name_continuation_count; ++index) {
+    records.push_back(ApiEventRecord::CreateNameContinuation(record.tid, name, index));
+  }
+  return records;
+}
+
+// Translates `record`, created with `name`, like LockFreeApiEventProducer.
+[[nodiscard]] ProducerCaptureEvent Translate(const ApiEventRecord& record, const char* name) {
+  ApiEventRecordAssembler assembler;
+  ProducerCaptureEvent capture_event;
+  int complete_event_count = 0;
+  for (const ApiEventRecord& added_record : CreateRecords(record, name)) {
+    assembler.AddRecord(added_record, [&](const ApiEventRecord& complete_record,
+                                          const char* full_name) {
+      FillProducerCaptureEventFromApiEventRecord(complete_record, full_name, kPid, &capture_event);
+      ++complete_event_count;
+    });
+  }
+  EXPECT_EQ(complete_event_count, 1);
+  return capture_event;
+}
+
+template <typename ApiEventT>
+void ExpectRecordTranslatesLikeApiEvent(const ApiEventRecord& record, const char* name,
+                                        const ApiEventT& api_event) {
+  ProducerCaptureEvent expected_capture_event;
+  FillProducerCaptureEventFromApiEvent(api_event, &expected_capture_event);
+  ProducerCaptureEvent capture_event = Translate(record, name);
+  EXPECT_TRUE(MessageDifferencer::Equals(capture_event, expected_capture_event))
+      << capture_event.DebugString() << "\nvs\n"
+      << expected_capture_event.DebugString();
+}
+
+[[nodiscard]] std::vector<char> Serialize(const ApiEventRecord& record, const char* name) {
+  std::vector<char> buffer(GetSerializedApiEventRecordSize(name));
+  SerializeApiEventRecord(record, name, buffer.data());
+  return buffer;
+}
+
+}  // namespace
+
+TEST(ApiEventRecord, LongNamesContinueInOtherRecords) {
+  ApiEventRecord record = ApiEventRecord::CreateTrackInt(kTid, kTimestampNs, kMaxLengthName.c_str(),
+                                                         1, kOrbitColorAuto);
+  EXPECT_EQ(record.GetName(), kMaxLengthName);
+  EXPECT_EQ(record.name_continuation_count, 0);
+
+  record =
+      ApiEventRecord::CreateTrackInt(kTid, kTimestampNs, kLongName.c_str(), 1, kOrbitColorAuto);
+  EXPECT_EQ(record.GetName(), kLongName.substr(0, ApiEventRecord::kMaxNameLength));
+  ASSERT_EQ(record.name_continuation_count, 2);
+  std::string name = record.GetName();
+  for (uint32_t index = 1; index <= record.name_continuation_count; ++index) {
+    const ApiEventRecord continuation =
+        ApiEventRecord::CreateNameContinuation(kTid, kLongName.c_str(), index);
+    EXPECT_EQ(continuation.type, ApiEventRecord::Type::kNameContinuation);
+    EXPECT_EQ(continuation.tid, kTid);
+    name.append(continuation.GetName());
+  }
+  EXPECT_EQ(name, kLongName);
+
+  ApiEventRecord record_without_name = ApiEventRecord::CreateScopeStop(kTid, kTimestampNs);
+  EXPECT_STREQ(record_without_name.GetName(), "");
+  EXPECT_EQ(record_without_name.name_continuation_count, 0);
+}
+
+TEST(ApiEventRecordAssembler, AssemblesTheRecordsOfEachThread) {
+  constexpr uint32_t kOtherTid = kTid + 1;
+  const std::string other_long_name(3 * ApiEventRecord::kMaxNameLength + 1, 'y');
+  std::vector<ApiEventRecord> records =
+      CreateRecords(ApiEventRecord::CreateStringEvent(kTid, 1, kLongName.c_str(), kId, kColor),
+                    kLongName.c_str());
+  std::vector<ApiEventRecord> other_records = CreateRecords(
+      ApiEventRecord::CreateStringEvent(kOtherTid, 2, other_long_name.c_str(), kId, kColor),
+      other_long_name.c_str());
+  ASSERT_EQ(records.size(), 3);
+  ASSERT_EQ(other_records.size(), 4);
+
+  ApiEventRecordAssembler assembler;
+  std::vector<std::pair<uint64_t, std::string>> assembled_events;
+  auto add_record = [&](const ApiEventRecord& record) {
+    assembler.AddRecord(record, [&](const ApiEventRecord& complete_record, const char* name) {
+      assembled_events.emplace_back(complete_record.timestamp_ns, name);
+    });
+  };
+  // The records of the two threads are interleaved.
+  add_record(records[0]);
+  add_record(other_records[0]);
+  add_record(other_records[1]);
+  add_record(records[1]);
+  add_record(ApiEventRecord::CreateScopeStop(kOtherTid + 1, 3));
+  add_record(other_records[2]);
+  add_record(records[2]);
+  add_record(other_records[3]);
+  EXPECT_THAT(assembled_events,
+              ::testing::ElementsAre(std::make_pair(3, ""), std::make_pair(1, kLongName),
+                                     std::make_pair(2, other_long_name)));
+
+  // An event whose continuation records were dropped is dropped, and so are continuation records
+  // without their event.
+  assembled_events.clear();
+  add_record(records[0]);
+  add_record(ApiEventRecord::CreateScopeStop(kTid, 4));
+  add_record(records[1]);
+  add_record(records[2]);
+  EXPECT_THAT(assembled_events, ::testing::ElementsAre(std::make_pair(4, "")));
+}
+
+TEST(ApiEventRecord, TranslatesLikeApiEvents) {
+  for (const char* name : {kShortName, kMaxLengthName.c_str(), kLongName.c_str()}) {
+    ExpectRecordTranslatesLikeApiEvent(
+        ApiEventRecord::CreateScopeStart(kTid, kTimestampNs, name, kColor, kId,
+                                         kAddressInFunction), name,
+        ApiScopeStart{kPid, kTid, kTimestampNs, name, kColor, kId, kAddressInFunction});
+    ExpectRecordTranslatesLikeApiEvent(
+        ApiEventRecord::CreateScopeStartAsync(kTid, kTimestampNs, name, kId, kColor,
+                                              kAddressInFunction), name,
+        ApiScopeStartAsync{kPid, kTid, kTimestampNs, name, kId, kColor, kAddressInFunction});
+    ExpectRecordTranslatesLikeApiEvent(
+        ApiEventRecord::CreateStringEvent(kTid, kTimestampNs, name, kId, kColor), name,
+        ApiStringEvent{kPid, kTid, kTimestampNs, name, kId, kColor});
+    ExpectRecordTranslatesLikeApiEvent(
+        ApiEventRecord::CreateTrackInt(kTid, kTimestampNs, name, -1, kColor), name,
+        ApiTrackInt{kPid, kTid, kTimestampNs, name, -1, kColor});
+    ExpectRecordTranslatesLikeApiEvent(
+        ApiEventRecord::CreateTrackInt64(kTid, kTimestampNs, name, INT64_MIN, kColor), name,
+        ApiTrackInt64{kPid, kTid, kTimestampNs, name, INT64_MIN, kColor});
+    ExpectRecordTranslatesLikeApiEvent(
+        ApiEventRecord::CreateTrackUint(kTid, kTimestampNs, name, UINT32_MAX, kColor), name,
+        ApiTrackUint{kPid, kTid, kTimestampNs, name, UINT32_MAX, kColor});
+    ExpectRecordTranslatesLikeApiEvent(
+        ApiEventRecord::CreateTrackUint64(kTid, kTimestampNs, name, UINT64_MAX, kColor), name,
+        ApiTrackUint64{kPid, kTid, kTimestampNs, name, UINT64_MAX, kColor});
+    ExpectRecordTranslatesLikeApiEvent(
+        ApiEventRecord::CreateTrackFloat(kTid, kTimestampNs, name, 1.5f, kColor), name,
+        ApiTrackFloat{kPid, kTid, kTimestampNs, name, 1.5f, kColor});
+    ExpectRecordTranslatesLikeApiEvent(
+        ApiEventRecord::CreateTrackDouble(kTid, kTimestampNs, name, -2.5, kColor), name,
+        ApiTrackDouble{kPid, kTid, kTimestampNs, name, -2.5, kColor});
+  }
+
+  ExpectRecordTranslatesLikeApiEvent(ApiEventRecord::CreateScopeStop(kTid, kTimestampNs), "",
+                                     ApiScopeStop{kPid, kTid, kTimestampNs});
+  ExpectRecordTranslatesLikeApiEvent(
+      ApiEventRecord::CreateScopeStopAsync(kTid, kTimestampNs, kId), "",
+      ApiScopeStopAsync{kPid, kTid, kTimestampNs, kId});
+}
+
+TEST(ApiEventRecord, SerializedRecordsTranslateLikeRecords) {
+  std::vector<std::pair<ApiEventRecord, const char*>> records;
+  for (const char* name : {"", kShortName, kLongName.c_str()}) {
+    records.emplace_back(ApiEventRecord::CreateScopeStart(kTid, kTimestampNs, name, kColor, kId,
+                                                          kAddressInFunction),
+                         name);
+    records.emplace_back(ApiEventRecord::CreateStringEvent(kTid, kTimestampNs, name, kId, kColor),
+                         name);
+    records.emplace_back(ApiEventRecord::CreateTrackInt(kTid, kTimestampNs, name, -1, kColor),
+                         name);
+    records.emplace_back(ApiEventRecord::CreateTrackFloat(kTid, kTimestampNs, name, 1.5f, kColor),
+                         name);
+    records.emplace_back(ApiEventRecord::CreateTrackDouble(kTid, kTimestampNs, name, -2.5, kColor),
+                         name);
+  }
+  records.emplace_back(ApiEventRecord::CreateScopeStop(kTid, kTimestampNs), "");
+  records.emplace_back(ApiEventRecord::CreateScopeStopAsync(kTid, kTimestampNs, kId), "");
+
+  for (const auto& [record, name] : records) {
+    const ProducerCaptureEvent expected_capture_event = Translate(record, name);
+    const std::vector<char> serialized_record = Serialize(record, name);
+    ProducerCaptureEvent capture_event;
+    ASSERT_FALSE(FillProducerCaptureEventFromSerializedApiEventRecord(serialized_record, kPid,
+                                                                      &capture_event)
+                     .has_error());
+    EXPECT_TRUE(MessageDifferencer::Equals(capture_event, expected_capture_event))
+        << capture_event.DebugString() << "\nvs\n"
+        << expected_capture_event.DebugString();
+  }
+}
+
+TEST(ApiEventRecord, InvalidSerializedRecordsAreRejected) {
+  const std::vector<char> serialized_record =
+      Serialize(ApiEventRecord::CreateStringEvent(kTid, kTimestampNs, kShortName, kId, kColor),
+                kShortName);
+  ProducerCaptureEvent capture_event;
+
+  // Truncated header.
+  EXPECT_TRUE(FillProducerCaptureEventFromSerializedApiEventRecord(
+                  absl::MakeConstSpan(serialized_record).subspan(0, 8), kPid, &capture_event)
+                  .has_error());
+  // Truncated name.
+  EXPECT_TRUE(FillProducerCaptureEventFromSerializedApiEventRecord(
+                  absl::MakeConstSpan(serialized_record).first(serialized_record.size() - 1),
+                  kPid, &capture_event)
+                  .has_error());
+  // Invalid type: the type is the first byte after the name length.
+  std::vector<char> invalid_type_record = serialized_record;
+  invalid_type_record[44] = 100;
+  EXPECT_TRUE(FillProducerCaptureEventFromSerializedApiEventRecord(invalid_type_record, kPid,
+                                                                   &capture_event)
+                  .has_error());
+}
+
+}  // namespace orbit_api
@@ -0,0 +1,165 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_API_UTILS_API_EVENT_RECORD_H_
+#define ORBIT_API_UTILS_API_EVENT_RECORD_H_
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/functional/function_ref.h>
+#include <absl/types/span.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "ApiInterface/Orbit.h"
+#include "GrpcProtos/capture.pb.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_api {
+
+// A fixed-size, trivially copyable representation of any of the events of the Orbit API, used to
+// store the events in the per-thread buffers of LockFreeApiEventProducer. Contrary to the structs
+// in Event.h, creating an ApiEventRecord doesn't encode the name, and never allocates. The pid is
+// not stored, as all events are produced by the same process.
+//
+// A record holds the first `kMaxNameLength` bytes of the name. The rest of a longer name is carried
+// by `name_continuation_count` kNameContinuation records, created with CreateNameContinuation,
+// which must follow the record in the buffer of the thread. ApiEventRecordAssembler puts the name
+// back together.
+struct ApiEventRecord {
+  static constexpr size_t kNameCapacity = 80;
+  static constexpr size_t kMaxNameLength = kNameCapacity - 1;
+
+  enum class Type : uint8_t {
+    kNone,
+    kScopeStart,
+    kScopeStop,
+    kScopeStartAsync,
+    kScopeStopAsync,
+    kStringEvent,
+    kTrackInt,
+    kTrackInt64,
+    kTrackUint,
+    kTrackUint64,
+    kTrackFloat,
+    kTrackDouble,
+    kNameContinuation,
+  };
+
+  ApiEventRecord() = default;
+
+  [[nodiscard]] static ApiEventRecord CreateScopeStart(uint32_t tid, uint64_t timestamp_ns,
+                                                       const char* name, orbit_api_color color,
+                                                       uint64_t group_id,
+                                                       uint64_t address_in_function);
+  [[nodiscard]] static ApiEventRecord CreateScopeStop(uint32_t tid, uint64_t timestamp_ns);
+  [[nodiscard]] static ApiEventRecord CreateScopeStartAsync(uint32_t tid, uint64_t timestamp_ns,
+                                                            const char* name, uint64_t id,
+                                                            orbit_api_color color,
+                                                            uint64_t address_in_function);
+  [[nodiscard]] static ApiEventRecord CreateScopeStopAsync(uint32_t tid, uint64_t timestamp_ns,
+                                                           uint64_t id);
+  [[nodiscard]] static ApiEventRecord CreateStringEvent(uint32_t tid, uint64_t timestamp_ns,
+                                                        const char* name, uint64_t id,
+                                                        orbit_api_color color);
+  [[nodiscard]] static ApiEventRecord CreateTrackInt(uint32_t tid, uint64_t timestamp_ns,
+                                                     const char* name, int32_t value,
+                                                     orbit_api_color color);
+  [[nodiscard]] static ApiEventRecord CreateTrackInt64(uint32_t tid, uint64_t timestamp_ns,
+                                                       const char* name, int64_t value,
+                                                       orbit_api_color color);
+  [[nodiscard]] static ApiEventRecord CreateTrackUint(uint32_t tid, uint64_t timestamp_ns,
+                                                      const char* name, uint32_t value,
+                                                      orbit_api_color color);
+  [[nodiscard]] static ApiEventRecord CreateTrackUint64(uint32_t tid, uint64_t timestamp_ns,
+                                                        const char* name, uint64_t value,
+                                                        orbit_api_color color);
+  [[nodiscard]] static ApiEventRecord CreateTrackFloat(uint32_t tid, uint64_t timestamp_ns,
+                                                       const char* name, float value,
+                                                       orbit_api_color color);
+  [[nodiscard]] static ApiEventRecord CreateTrackDouble(uint32_t tid, uint64_t timestamp_ns,
+                                                        const char* name, double value,
+                                                        orbit_api_color color);
+  // Returns the `index`-th record, starting from 1, carrying the part of `name` that doesn't fit in
+  // the record of the event, see `name_continuation_count`.
+  [[nodiscard]] static ApiEventRecord CreateNameContinuation(uint32_t tid, const char* name,
+                                                             uint32_t index);
+
+  // Returns the part of the name of the event held by this record, or an empty string if the event
+  // has no name.
+  [[nodiscard]] const char* GetName() const { return name; }
+
+  uint64_t timestamp_ns = 0;
+  // The group id for kScopeStart, the id for the other asynchronous events.
+  uint64_t id = 0;
+  uint64_t address_in_function = 0;
+  // The value of track events, in the member corresponding to `type`. kTrackInt and kTrackUint use
+  // `int_value` and `uint_value`.
+  union {
+    int64_t int_value;
+    uint64_t uint_value;
+    float float_value;
+    double double_value;
+  } value{};
+  uint32_t tid = 0;
+  uint32_t color_rgba = 0;
+  Type type = Type::kNone;
+  // Null-terminated, see kMaxNameLength.
+  char name[kNameCapacity] = {};
+  // The number of kNameContinuation records that carry the rest of the name.
+  uint32_t name_continuation_count = 0;
+
+ private:
+  ApiEventRecord(Type type, uint32_t tid, uint64_t timestamp_ns)
+      : timestamp_ns{timestamp_ns}, tid{tid}, type{type} {}
+
+  // Copies at most the first `kMaxNameLength` bytes of `source`, and returns whether it is longer.
+  bool CopyName(const char* source);
+  void SetName(const char* source);
+};
+
+static_assert(std::is_trivially_copyable_v<ApiEventRecord>);
+static_assert(sizeof(ApiEventRecord) == 128);
+
+// Puts back together the events whose name was split over several records, see
+// ApiEventRecord::name_continuation_count. The records of each thread must be added in the order in
+// which they were created, but the records of different threads can be interleaved.
+class ApiEventRecordAssembler {
+ public:
+  // Calls `action` with the event completed by `record`, if any, and its full name. A record
+  // without continuation records completes itself.
+  void AddRecord(const ApiEventRecord& record,
+                 absl::FunctionRef<void(const ApiEventRecord& record, const char* name)> action);
+
+ private:
+  struct PendingEvent {
+    ApiEventRecord record;
+    std::string name;
+    uint32_t missing_continuation_count;
+  };
+  absl::flat_hash_map<uint32_t, PendingEvent> pending_events_by_tid_;
+};
+
+// Fills `capture_event` with the event described by `record` and its full `name`, which was
+// produced by process `pid`.
+void FillProducerCaptureEventFromApiEventRecord(
+    const ApiEventRecord& record, const char* name, uint32_t pid,
+    orbit_grpc_protos::ProducerCaptureEvent* capture_event);
+
+// Flat serialization of an ApiEventRecord and its full `name`, stored right after the fixed-size
+// fields. This is how the events are written to the shared memory ring buffer of the producer.
+[[nodiscard]] size_t GetSerializedApiEventRecordSize(const char* name);
+void SerializeApiEventRecord(const ApiEventRecord& record, const char* name, char* buffer);
+
+// Same as FillProducerCaptureEventFromApiEventRecord, for a record serialized with
+// SerializeApiEventRecord by a process that is not trusted, hence the validation.
+[[nodiscard]] ErrorMessageOr<void> FillProducerCaptureEventFromSerializedApiEventRecord(
+    absl::Span<const char> serialized_record, uint32_t pid,
+    orbit_grpc_protos::ProducerCaptureEvent* capture_event);
+
+}  // namespace orbit_api
+
+#endif  // ORBIT_API_UTILS_API_EVENT_RECORD_H_
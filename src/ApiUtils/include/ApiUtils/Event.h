@@ -16,9 +16,10 @@
 #include "OrbitBase/Logging.h"
 #include "absl/base/casts.h"
 
-// We don't want to store protos in the LockFreeApiEventProducer's buffer, as they introduce
+// We don't want to store protos in the buffers of the introspection events, as they introduce
 // expensive and unnecessary indirections and allocations. Therefore, we use the a std::variant of
 // the following structs. The structs must be kept up-to-date with the protos in capture.proto.
+// LockFreeApiEventProducer uses the more compact ApiEventRecord instead.
 namespace orbit_api {
 
 struct ApiEventMetaData {
@@ -199,7 +200,7 @@ struct ApiTrackFloat {
   uint32_t color_rgba = 0;
 };
 
-// Used in `LockFreeApiEventProducer`. The `std::monostate` is required make this variant default
+// Used by introspection. The `std::monostate` is required make this variant default
 // constructable. However, real (fully instantiated) values will never be of type `std::monostate`.
 using ApiEventVariant =
     std::variant<std::monostate, ApiScopeStart, ApiScopeStop, ApiScopeStartAsync, ApiScopeStopAsync,
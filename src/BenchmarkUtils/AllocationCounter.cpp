@@ -0,0 +1,73 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "BenchmarkUtils/AllocationCounter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<uint64_t> allocation_count = 0;
+
+void* CountedAllocate(size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  // malloc(0) may return nullptr, but operator new must return a unique non-null pointer.
+  void* result = std::malloc(size == 0 ? 1 : size);
+  if (result == nullptr) {
+    throw std::bad_alloc{};
+  }
+  return result;
+}
+
+void* CountedAlignedAllocate(size_t size, std::align_val_t alignment) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  const auto alignment_value = static_cast<size_t>(alignment);
+  // aligned_alloc requires the size to be a non-zero multiple of the alignment.
+  const size_t aligned_size =
+      std::max(alignment_value, (size + alignment_value - 1) / alignment_value * alignment_value);
+  void* result = std::aligned_alloc(alignment_value, aligned_size);
+  if (result == nullptr) {
+    throw std::bad_alloc{};
+  }
+  return result;
+}
+
+}  // namespace
+
+namespace orbit_benchmark_utils {
+
+uint64_t GetAllocationCount() { return allocation_count.load(std::memory_order_relaxed); }
+
+}  // namespace orbit_benchmark_utils
+
+void* operator new(size_t size) { return CountedAllocate(size); }
+void* operator new[](size_t size) { return CountedAllocate(size); }
+void* operator new(size_t size, std::align_val_t alignment) {
+  return CountedAlignedAllocate(size, alignment);
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+  return CountedAlignedAllocate(size, alignment);
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t /*size*/) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, size_t /*size*/) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t /*alignment*/) noexcept {
+  std::free(pointer);
+}
+void operator delete[](void* pointer, std::align_val_t /*alignment*/) noexcept {
+  std::free(pointer);
+}
+void operator delete(void* pointer, size_t /*size*/, std::align_val_t /*alignment*/) noexcept {
+  std::free(pointer);
+}
+void operator delete[](void* pointer, size_t /*size*/, std::align_val_t /*alignment*/) noexcept {
+  std::free(pointer);
+}
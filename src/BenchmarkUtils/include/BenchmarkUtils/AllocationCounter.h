@@ -0,0 +1,50 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BENCHMARK_UTILS_ALLOCATION_COUNTER_H_
+#define BENCHMARK_UTILS_ALLOCATION_COUNTER_H_
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+namespace orbit_benchmark_utils {
+
+// Returns the number of heap allocations performed through the global operator new, on any thread,
+// since the start of the program. Linking BenchmarkUtils replaces the global operator new and
+// delete with versions that count the allocations, so this must not be used outside benchmarks.
+[[nodiscard]] uint64_t GetAllocationCount();
+
+// Counts the allocations between its construction and the call to Report, which sets the items
+// processed by the benchmark as well as an "allocations_per_item" counter. Construct it right
+// before the benchmark loop. If the benchmark pauses timing to prepare its input, also call Pause
+// and Resume, so that the allocations of the preparation are not counted.
+class AllocationCounter {
+ public:
+  AllocationCounter() : allocation_count_at_start_{GetAllocationCount()} {}
+
+  void Pause() { allocation_count_at_pause_ = GetAllocationCount(); }
+  void Resume() { excluded_allocation_count_ += GetAllocationCount() - allocation_count_at_pause_; }
+
+  [[nodiscard]] uint64_t GetAllocationCountSinceStart() const {
+    return GetAllocationCount() - allocation_count_at_start_ - excluded_allocation_count_;
+  }
+
+  void Report(benchmark::State& state, int64_t item_count) const {
+    state.SetItemsProcessed(item_count);
+    state.counters["allocations_per_item"] =
+        item_count > 0 ? static_cast<double>(GetAllocationCountSinceStart()) /
+                             static_cast<double>(item_count)
+                       : 0.0;
+  }
+
+ private:
+  uint64_t allocation_count_at_start_;
+  uint64_t allocation_count_at_pause_ = 0;
+  uint64_t excluded_allocation_count_ = 0;
+};
+
+}  // namespace orbit_benchmark_utils
+
+#endif  // BENCHMARK_UTILS_ALLOCATION_COUNTER_H_
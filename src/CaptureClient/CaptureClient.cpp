@@ -20,6 +20,7 @@
 #include "ApiUtils/GetFunctionTableAddressPrefix.h"
 #include "CaptureClient/CaptureEventProcessor.h"
 #include "CaptureClient/CaptureListener.h"
+#include "CaptureResponseEncoding/PackedCaptureEvents.h"
 #include "ClientData/FunctionInfo.h"
 #include "ClientData/ModuleData.h"
 #include "ClientData/ModuleInMemory.h"
@@ -42,6 +43,7 @@ using orbit_grpc_protos::CaptureOptions;
 using orbit_grpc_protos::CaptureRequest;
 using orbit_grpc_protos::CaptureResponse;
 using orbit_grpc_protos::ClientCaptureEvent;
+using orbit_grpc_protos::EventSendingStats;
 using orbit_grpc_protos::InstrumentedFunction;
 using orbit_grpc_protos::TracepointInfo;
 using DynamicInstrumentationMethod =
@@ -114,6 +116,7 @@ std::vector<ApiFunction> FindApiFunctions(const orbit_client_data::ModuleManager
   capture_options.set_stack_dump_size(options.stack_dump_size);
   capture_options.set_thread_state_change_callstack_stack_dump_size(
       options.thread_state_change_callstack_stack_dump_size);
+  capture_options.set_unwinding_worker_count(options.unwinding_worker_count);
   capture_options.set_samples_per_second(options.samples_per_second);
 
   capture_options.set_collect_memory_info(options.collect_memory_info);
@@ -179,9 +182,39 @@ std::vector<ApiFunction> FindApiFunctions(const orbit_client_data::ModuleManager
   capture_options.set_thread_state_change_callstack_collection(
       options.thread_state_change_callstack_collection);
 
+  capture_options.set_use_shared_memory_producer_transport(
+      options.use_shared_memory_producer_transport);
+
   return capture_options;
 }
 
+[[nodiscard]] CaptureRequest ToGrpcCaptureRequest(
+    const ClientCaptureOptions& options, const orbit_client_data::ModuleManager& module_manager,
+    const orbit_client_data::ProcessData& process_data) {
+  CaptureRequest request;
+  *request.mutable_capture_options() = ToGrpcCaptureOptions(options, module_manager, process_data);
+  if (options.pack_capture_events) {
+    request.set_capture_response_encoding(CaptureRequest::kPackedCaptureEvents);
+  }
+  request.set_compress_capture_responses(options.compress_capture_responses);
+  request.set_max_send_latency_ms(options.max_send_latency_ms);
+  request.set_event_memory_budget_bytes(options.event_memory_budget_bytes);
+  request.set_event_drop_policy(options.event_drop_policy);
+  return request;
+}
+
+// Records the state of the queue of events in the service, which the service reports about once
+// per second, on the introspection tracks of the client.
+void RecordEventSendingStats([[maybe_unused]] const EventSendingStats& stats) {
+  ORBIT_UINT64("Service: queued CaptureEvents", stats.queued_event_count());
+  ORBIT_UINT64("Service: bytes of queued CaptureEvents", stats.queued_event_bytes());
+  ORBIT_UINT64("Service: max duration of sending CaptureResponses (us)",
+               stats.max_send_duration_us());
+  ORBIT_DOUBLE("Service: send throughput (bytes/s)", stats.send_throughput_bytes_per_second());
+  ORBIT_UINT64("Service: dropped callstack samples", stats.dropped_callstack_sample_count());
+  ORBIT_UINT64("Service: dropped other events", stats.dropped_other_event_count());
+}
+
 }  // namespace
 
 orbit_base::Future<ErrorMessageOr<CaptureListener::CaptureOutcome>> CaptureClient::Capture(
@@ -201,15 +234,14 @@ orbit_base::Future<ErrorMessageOr<CaptureListener::CaptureOutcome>> CaptureClien
   ORBIT_LOG("State is now kStarting");
 
   return thread_pool->Schedule([this, capture_event_processor = std::move(capture_event_processor),
-                                grpc_capture_options = ToGrpcCaptureOptions(
-                                    capture_options, module_manager, process_data)]() {
-    return CaptureSync(grpc_capture_options, capture_event_processor.get());
+                                request = ToGrpcCaptureRequest(capture_options, module_manager,
+                                                               process_data)]() {
+    return CaptureSync(request, capture_event_processor.get());
   });
 }
 
 ErrorMessageOr<CaptureListener::CaptureOutcome> CaptureClient::CaptureSync(
-    orbit_grpc_protos::CaptureOptions capture_options,
-    CaptureEventProcessor* capture_event_processor) {
+    CaptureRequest request, CaptureEventProcessor* capture_event_processor) {
   ORBIT_SCOPE_FUNCTION;
   writes_done_failed_ = false;
   try_abort_ = false;
@@ -221,9 +253,6 @@ ErrorMessageOr<CaptureListener::CaptureOutcome> CaptureClient::CaptureSync(
     reader_writer_ = capture_service_->Capture(client_context_.get());
   }
 
-  CaptureRequest request;
-  *request.mutable_capture_options() = std::move(capture_options);
-
   bool request_write_succeeded{};
   {
     absl::ReaderMutexLock lock{&context_and_stream_mutex_};
@@ -242,6 +271,8 @@ ErrorMessageOr<CaptureListener::CaptureOutcome> CaptureClient::CaptureSync(
   }
   ORBIT_LOG("Sent CaptureRequest on Capture's gRPC stream: asking to start capturing");
 
+  ErrorMessageOr<void> unpack_result = outcome::success();
+  EventSendingStats last_event_sending_stats;
   while (!writes_done_failed_ && !try_abort_) {
     CaptureResponse response;
     bool read_succeeded{};
@@ -249,14 +280,33 @@ ErrorMessageOr<CaptureListener::CaptureOutcome> CaptureClient::CaptureSync(
       absl::ReaderMutexLock lock{&context_and_stream_mutex_};
       read_succeeded = reader_writer_->Read(&response);
     }
-    if (read_succeeded) {
-      ProcessEvents(capture_event_processor, response.capture_events());
-    } else {
+    if (!read_succeeded) {
+      break;
+    }
+
+    // The events might have been packed by the service, as requested in the CaptureRequest.
+    unpack_result = orbit_capture_response_encoding::UnpackCaptureEvents(&response);
+    if (unpack_result.has_error()) {
+      ORBIT_ERROR("Unpacking CaptureResponse: %s", unpack_result.error().message());
+      absl::ReaderMutexLock lock{&context_and_stream_mutex_};
+      client_context_->TryCancel();
       break;
     }
+    if (response.has_event_sending_stats()) {
+      RecordEventSendingStats(response.event_sending_stats());
+      last_event_sending_stats = response.event_sending_stats();
+    }
+    ProcessEvents(capture_event_processor, response.capture_events());
   }
+  ORBIT_LOG("The service dropped %u callstack samples and %u other events",
+            last_event_sending_stats.dropped_callstack_sample_count(),
+            last_event_sending_stats.dropped_other_event_count());
 
   ErrorMessageOr<void> finish_result = FinishCapture();
+  if (unpack_result.has_error()) {
+    return ErrorMessage{absl::StrFormat("Received an invalid CaptureResponse: %s",
+                                        unpack_result.error().message())};
+  }
   if (try_abort_) {
     ORBIT_LOG(
         "TryCancel on Capture's gRPC context was called: Read on Capture's gRPC stream failed");
@@ -6,12 +6,16 @@
 
 #include <absl/container/flat_hash_set.h>
 #include <absl/hash/hash.h>
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
 #include <google/protobuf/stubs/port.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <filesystem>
 #include <memory>
 #include <optional>
+#include <thread>
 
 #include "CaptureClient/CaptureEventProcessor.h"
 #include "CaptureFile/CaptureFileSection.h"
@@ -19,9 +23,30 @@
 #include "ClientProtos/user_defined_capture_info.pb.h"
 #include "GrpcProtos/capture.pb.h"
 #include "OrbitBase/Logging.h"
+#include "ParallelCaptureSectionReader.h"
 
 namespace orbit_capture_client {
 
+// Parsing scales well up to a few threads, after which the single-threaded processing of the events
+// dominates the loading time.
+constexpr size_t kMaxParserThreadCount = 4;
+
+[[nodiscard]] static size_t GetParserThreadCount() {
+  // Leave one core for the thread that processes the events. Note that
+  // std::thread::hardware_concurrency() can return 0.
+  const size_t core_count = std::thread::hardware_concurrency();
+  return std::clamp<size_t>(core_count > 0 ? core_count - 1 : 1, 1, kMaxParserThreadCount);
+}
+
+static void LogLoadingThroughput(const ParallelCaptureSectionReader& reader,
+                                 absl::Duration duration) {
+  const double seconds = std::max(absl::ToDoubleSeconds(duration), 1e-9);
+  const double megabytes = static_cast<double>(reader.GetByteCount()) / (1024 * 1024);
+  ORBIT_LOG("Loaded %u events (%.2f MB) in %.3f s: %.2f MB/s, %.0f events/s",
+            reader.GetEventCount(), megabytes, seconds, megabytes / seconds,
+            reader.GetEventCount() / seconds);
+}
+
 [[nodiscard]] ErrorMessageOr<CaptureListener::CaptureOutcome> LoadCapture(
     CaptureListener* listener, orbit_capture_file::CaptureFile* capture_file,
     std::atomic<bool>* capture_loading_cancellation_requested) {
@@ -46,14 +71,19 @@ namespace orbit_capture_client {
                                                         frame_track_function_ids);
 
     auto capture_section_input_stream = capture_file->CreateCaptureSectionInputStream();
+    // Events are parsed in parallel but still processed in order on this thread.
+    ParallelCaptureSectionReader capture_section_reader{capture_section_input_stream.get(),
+                                                        GetParserThreadCount()};
+    const absl::Time loading_start = absl::Now();
     while (true) {
       if (*capture_loading_cancellation_requested) {
         return CaptureListener::CaptureOutcome::kCancelled;
       }
-      orbit_grpc_protos::ClientCaptureEvent event;
-      OUTCOME_TRY(capture_section_input_stream->ReadMessage(&event));
-      capture_event_processor->ProcessEvent(event);
-      if (event.event_case() == orbit_grpc_protos::ClientCaptureEvent::kCaptureFinished) {
+      OUTCOME_TRY(const orbit_grpc_protos::ClientCaptureEvent* event,
+                  capture_section_reader.ReadEvent());
+      capture_event_processor->ProcessEvent(*event);
+      if (event->event_case() == orbit_grpc_protos::ClientCaptureEvent::kCaptureFinished) {
+        LogLoadingThroughput(capture_section_reader, absl::Now() - loading_start);
         return CaptureListener::CaptureOutcome::kComplete;
       }
     }
@@ -0,0 +1,173 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ParallelCaptureSectionReader.h"
+
+#include <absl/strings/str_format.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
+#include <string_view>
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/ThreadUtils.h"
+
+namespace orbit_capture_client {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+
+// The reader thread doesn't parse the events, but it needs to recognize the CaptureFinished event
+// to stop reading. As a ClientCaptureEvent has a single field set, looking at the first tag is
+// enough.
+[[nodiscard]] static bool IsSerializedCaptureFinishedEvent(std::string_view serialized_event) {
+  google::protobuf::io::CodedInputStream coded_input_stream{
+      reinterpret_cast<const uint8_t*>(serialized_event.data()),
+      static_cast<int>(serialized_event.size())};
+  return google::protobuf::internal::WireFormatLite::GetTagFieldNumber(
+             coded_input_stream.ReadTag()) == ClientCaptureEvent::kCaptureFinishedFieldNumber;
+}
+
+ParallelCaptureSectionReader::ParallelCaptureSectionReader(
+    orbit_capture_file::ProtoSectionInputStream* input_stream, size_t parser_count)
+    : input_stream_{input_stream},
+      max_batches_in_flight_{kMaxBatchesInFlightPerParser * parser_count} {
+  ORBIT_CHECK(input_stream_ != nullptr);
+  ORBIT_CHECK(parser_count > 0);
+  reader_ = std::thread{&ParallelCaptureSectionReader::ReaderFunction, this};
+  parsers_.reserve(parser_count);
+  for (size_t i = 0; i < parser_count; ++i) {
+    parsers_.emplace_back(&ParallelCaptureSectionReader::ParserFunction, this);
+  }
+}
+
+ParallelCaptureSectionReader::~ParallelCaptureSectionReader() {
+  {
+    absl::MutexLock lock{&mutex_};
+    shutdown_requested_ = true;
+  }
+  reader_.join();
+  for (std::thread& parser : parsers_) {
+    parser.join();
+  }
+}
+
+ErrorMessageOr<const ClientCaptureEvent*> ParallelCaptureSectionReader::ReadEvent() {
+  while (true) {
+    if (current_batch_ != nullptr) {
+      if (next_event_index_ < current_batch_->events.size()) {
+        ++event_count_;
+        byte_count_ += current_batch_->event_sizes[next_event_index_];
+        return current_batch_->events[next_event_index_++];
+      }
+      if (current_batch_->error.has_value()) {
+        return current_batch_->error.value();
+      }
+      if (current_batch_->is_last) {
+        return ErrorMessage{"Attempted to read past the CaptureFinished event"};
+      }
+      current_batch_.reset();
+    }
+
+    absl::MutexLock lock{&mutex_};
+    mutex_.Await(absl::Condition(
+        +[](ParallelCaptureSectionReader* self) ABSL_EXCLUSIVE_LOCKS_REQUIRED(self->mutex_) {
+          return !self->batches_.empty() && self->batches_.front()->parsed;
+        },
+        this));
+    current_batch_ = std::move(batches_.front());
+    batches_.pop_front();
+    next_event_index_ = 0;
+  }
+}
+
+void ParallelCaptureSectionReader::ReaderFunction() {
+  orbit_base::SetCurrentThreadName("LoadCapt::Read");
+  while (true) {
+    auto batch = std::make_unique<Batch>();
+    while (batch->serialized_events.size() < kTargetBatchSize) {
+      const size_t event_offset = batch->serialized_events.size();
+      ErrorMessageOr<uint32_t> event_size_or_error =
+          input_stream_->ReadMessageBytes(&batch->serialized_events);
+      if (event_size_or_error.has_error()) {
+        batch->error = event_size_or_error.error();
+        batch->is_last = true;
+        break;
+      }
+      batch->event_sizes.push_back(event_size_or_error.value());
+      if (IsSerializedCaptureFinishedEvent(std::string_view{batch->serialized_events}.substr(
+              event_offset, event_size_or_error.value()))) {
+        batch->is_last = true;
+        break;
+      }
+    }
+
+    const bool is_last = batch->is_last;
+    absl::MutexLock lock{&mutex_};
+    mutex_.Await(absl::Condition(
+        +[](ParallelCaptureSectionReader* self) ABSL_EXCLUSIVE_LOCKS_REQUIRED(self->mutex_) {
+          return self->shutdown_requested_ ||
+                 self->batches_.size() < self->max_batches_in_flight_;
+        },
+        this));
+    if (shutdown_requested_) {
+      return;
+    }
+    batches_to_parse_.push_back(batch.get());
+    batches_.push_back(std::move(batch));
+    if (is_last) {
+      return;
+    }
+  }
+}
+
+void ParallelCaptureSectionReader::ParserFunction() {
+  orbit_base::SetCurrentThreadName("LoadCapt::Parse");
+  while (true) {
+    Batch* batch = nullptr;
+    {
+      absl::MutexLock lock{&mutex_};
+      mutex_.Await(absl::Condition(
+          +[](ParallelCaptureSectionReader* self) ABSL_EXCLUSIVE_LOCKS_REQUIRED(self->mutex_) {
+            return self->shutdown_requested_ || !self->batches_to_parse_.empty();
+          },
+          this));
+      if (shutdown_requested_) {
+        return;
+      }
+      batch = batches_to_parse_.front();
+      batches_to_parse_.pop_front();
+    }
+
+    ParseBatch(batch);
+
+    absl::MutexLock lock{&mutex_};
+    batch->parsed = true;
+  }
+}
+
+void ParallelCaptureSectionReader::ParseBatch(Batch* batch) {
+  batch->events.reserve(batch->event_sizes.size());
+  const char* serialized_event = batch->serialized_events.data();
+  for (const uint32_t event_size : batch->event_sizes) {
+    auto* event = google::protobuf::Arena::CreateMessage<ClientCaptureEvent>(&batch->arena);
+    // An error of the parser takes precedence over a read error, as it happened earlier.
+    if (!event->ParseFromArray(serialized_event, static_cast<int>(event_size))) {
+      batch->error =
+          ErrorMessage{absl::StrFormat("Unable to parse the message of size %d", event_size)};
+      return;
+    }
+    // This replicates the check of ProtoSectionInputStream::ReadMessage.
+    if (event->ByteSizeLong() != event_size) {
+      batch->error = ErrorMessage{absl::StrFormat(
+          "The message size %d of the parsed message is different from the parsed size %d",
+          event->ByteSizeLong(), event_size)};
+      return;
+    }
+    batch->events.push_back(event);
+    serialized_event += event_size;
+  }
+}
+
+}  // namespace orbit_capture_client
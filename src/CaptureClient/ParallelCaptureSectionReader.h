@@ -0,0 +1,108 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_CLIENT_PARALLEL_CAPTURE_SECTION_READER_H_
+#define CAPTURE_CLIENT_PARALLEL_CAPTURE_SECTION_READER_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
+#include <google/protobuf/arena.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CaptureFile/ProtoSectionInputStream.h"
+#include "GrpcProtos/capture.pb.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_capture_client {
+
+// ParallelCaptureSectionReader reads the ClientCaptureEvents of a capture section with a pipeline,
+// so that loading a capture is not bound by parsing the events on a single thread.
+//
+// A reader thread splits the size-prefixed messages of the section into batches of serialized
+// events, without parsing them. A fixed number of parser threads then parse the batches in
+// parallel, each batch into its own protobuf arena. ReadEvent hands the parsed events back to the
+// caller strictly in the order in which they are stored in the section.
+//
+// The reader stops after the CaptureFinished event, as the capture section must not be read past
+// it (see ProtoSectionInputStream::ReadMessage). The number of batches in flight is bounded, so
+// that memory usage stays bounded when the caller can't keep up.
+//
+// ReadEvent is expected to always be called from the same thread.
+class ParallelCaptureSectionReader {
+ public:
+  // `input_stream` needs to outlive this object.
+  explicit ParallelCaptureSectionReader(
+      orbit_capture_file::ProtoSectionInputStream* input_stream, size_t parser_count);
+  ~ParallelCaptureSectionReader();
+
+  ParallelCaptureSectionReader(const ParallelCaptureSectionReader&) = delete;
+  ParallelCaptureSectionReader& operator=(const ParallelCaptureSectionReader&) = delete;
+  ParallelCaptureSectionReader(ParallelCaptureSectionReader&&) = delete;
+  ParallelCaptureSectionReader& operator=(ParallelCaptureSectionReader&&) = delete;
+
+  // Returns the next event of the capture section, blocking until it has been parsed. The event is
+  // only valid until the next call. Errors of the underlying stream are returned in order, that is,
+  // after all the events that precede them.
+  [[nodiscard]] ErrorMessageOr<const orbit_grpc_protos::ClientCaptureEvent*> ReadEvent();
+
+  // The number of events returned by ReadEvent so far.
+  [[nodiscard]] uint64_t GetEventCount() const { return event_count_; }
+  // The number of serialized bytes of the events returned by ReadEvent so far.
+  [[nodiscard]] uint64_t GetByteCount() const { return byte_count_; }
+
+  // A batch is complete when it reaches this many bytes of serialized events.
+  static constexpr size_t kTargetBatchSize = 256 * 1024;
+  // Maximum number of batches that have been read but not yet returned by ReadEvent, per parser.
+  static constexpr size_t kMaxBatchesInFlightPerParser = 4;
+
+ private:
+  struct Batch {
+    std::string serialized_events;
+    std::vector<uint32_t> event_sizes;
+    // An error that occurred while reading or parsing the batch. It applies after `events`.
+    std::optional<ErrorMessage> error;
+    // Whether this is the last batch that the reader thread produces.
+    bool is_last = false;
+
+    google::protobuf::Arena arena;
+    std::vector<orbit_grpc_protos::ClientCaptureEvent*> events;
+    // Guarded by `mutex_`, as the reader, the parsers and ReadEvent access it.
+    bool parsed = false;
+  };
+
+  void ReaderFunction();
+  void ParserFunction();
+  static void ParseBatch(Batch* batch);
+
+  orbit_capture_file::ProtoSectionInputStream* input_stream_;
+  const size_t max_batches_in_flight_;
+
+  absl::Mutex mutex_;
+  // Batches that have been read but not yet taken by ReadEvent, in section order.
+  std::deque<std::unique_ptr<Batch>> batches_ ABSL_GUARDED_BY(mutex_);
+  // Batches waiting for a parser.
+  std::deque<Batch*> batches_to_parse_ ABSL_GUARDED_BY(mutex_);
+  bool shutdown_requested_ ABSL_GUARDED_BY(mutex_) = false;
+
+  // Only accessed by ReadEvent.
+  std::unique_ptr<Batch> current_batch_;
+  size_t next_event_index_ = 0;
+  uint64_t event_count_ = 0;
+  uint64_t byte_count_ = 0;
+
+  std::thread reader_;
+  std::vector<std::thread> parsers_;
+};
+
+}  // namespace orbit_capture_client
+
+#endif  // CAPTURE_CLIENT_PARALLEL_CAPTURE_SECTION_READER_H_
@@ -0,0 +1,161 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CaptureFile/ProtoSectionInputStream.h"
+#include "GrpcProtos/capture.pb.h"
+#include "OrbitBase/Result.h"
+#include "ParallelCaptureSectionReader.h"
+#include "TestUtils/TestUtils.h"
+
+namespace orbit_capture_client {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+using orbit_test_utils::HasErrorWithMessage;
+using orbit_test_utils::HasNoError;
+
+namespace {
+
+// Returns the serialized messages it was created with, followed by an error.
+class FakeProtoSectionInputStream : public orbit_capture_file::ProtoSectionInputStream {
+ public:
+  explicit FakeProtoSectionInputStream(std::vector<std::string> serialized_messages)
+      : serialized_messages_{std::move(serialized_messages)} {}
+
+  ErrorMessageOr<void> ReadMessage(google::protobuf::Message* message) override {
+    OUTCOME_TRY(ReadMessageBytes(&buffer_));
+    message->ParseFromString(buffer_);
+    buffer_.clear();
+    return outcome::success();
+  }
+
+  ErrorMessageOr<uint32_t> ReadMessageBytes(std::string* message_bytes) override {
+    if (next_message_index_ == serialized_messages_.size()) {
+      return ErrorMessage{"Unexpected end of section"};
+    }
+    const std::string& message = serialized_messages_[next_message_index_++];
+    message_bytes->append(message);
+    return message.size();
+  }
+
+ private:
+  std::vector<std::string> serialized_messages_;
+  size_t next_message_index_ = 0;
+  std::string buffer_;
+};
+
+std::string CreateSerializedSchedulingSlice(uint64_t index) {
+  ClientCaptureEvent event;
+  event.mutable_scheduling_slice()->set_tid(index);
+  event.mutable_scheduling_slice()->set_out_timestamp_ns(1000 * index);
+  return event.SerializeAsString();
+}
+
+std::string CreateSerializedCaptureFinished() {
+  ClientCaptureEvent event;
+  event.mutable_capture_finished()->set_status(orbit_grpc_protos::CaptureFinished::kSuccessful);
+  return event.SerializeAsString();
+}
+
+// Enough events for many batches to be in flight at the same time.
+constexpr uint64_t kEventCount = 100'000;
+constexpr size_t kParserCount = 3;
+
+}  // namespace
+
+TEST(ParallelCaptureSectionReader, ReadsEventsInOrder) {
+  std::vector<std::string> serialized_events;
+  uint64_t total_size = 0;
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    total_size += serialized_events.emplace_back(CreateSerializedSchedulingSlice(i)).size();
+  }
+  total_size += serialized_events.emplace_back(CreateSerializedCaptureFinished()).size();
+  // Anything after the CaptureFinished event must not be read.
+  serialized_events.emplace_back("not a valid event");
+
+  FakeProtoSectionInputStream input_stream{std::move(serialized_events)};
+  ParallelCaptureSectionReader reader{&input_stream, kParserCount};
+
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    ErrorMessageOr<const ClientCaptureEvent*> event = reader.ReadEvent();
+    ASSERT_THAT(event, HasNoError());
+    ASSERT_EQ(event.value()->event_case(), ClientCaptureEvent::kSchedulingSlice);
+    ASSERT_EQ(event.value()->scheduling_slice().tid(), i);
+    ASSERT_EQ(event.value()->scheduling_slice().out_timestamp_ns(), 1000 * i);
+  }
+  ErrorMessageOr<const ClientCaptureEvent*> capture_finished = reader.ReadEvent();
+  ASSERT_THAT(capture_finished, HasNoError());
+  EXPECT_EQ(capture_finished.value()->capture_finished().status(),
+            orbit_grpc_protos::CaptureFinished::kSuccessful);
+
+  EXPECT_EQ(reader.GetEventCount(), kEventCount + 1);
+  EXPECT_EQ(reader.GetByteCount(), total_size);
+
+  EXPECT_THAT(reader.ReadEvent(), HasErrorWithMessage("past the CaptureFinished event"));
+}
+
+TEST(ParallelCaptureSectionReader, ReturnsReadErrorAfterPrecedingEvents) {
+  std::vector<std::string> serialized_events;
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    serialized_events.emplace_back(CreateSerializedSchedulingSlice(i));
+  }
+
+  FakeProtoSectionInputStream input_stream{std::move(serialized_events)};
+  ParallelCaptureSectionReader reader{&input_stream, kParserCount};
+
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    ErrorMessageOr<const ClientCaptureEvent*> event = reader.ReadEvent();
+    ASSERT_THAT(event, HasNoError());
+    ASSERT_EQ(event.value()->scheduling_slice().tid(), i);
+  }
+  EXPECT_THAT(reader.ReadEvent(), HasErrorWithMessage("Unexpected end of section"));
+  EXPECT_THAT(reader.ReadEvent(), HasErrorWithMessage("Unexpected end of section"));
+}
+
+TEST(ParallelCaptureSectionReader, ReturnsParseErrorAfterPrecedingEvents) {
+  constexpr uint64_t kInvalidEventIndex = kEventCount / 2;
+  std::vector<std::string> serialized_events;
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    serialized_events.emplace_back(CreateSerializedSchedulingSlice(i));
+  }
+  // A truncated event.
+  serialized_events[kInvalidEventIndex].pop_back();
+
+  FakeProtoSectionInputStream input_stream{std::move(serialized_events)};
+  ParallelCaptureSectionReader reader{&input_stream, kParserCount};
+
+  for (uint64_t i = 0; i < kInvalidEventIndex; ++i) {
+    ErrorMessageOr<const ClientCaptureEvent*> event = reader.ReadEvent();
+    ASSERT_THAT(event, HasNoError());
+    ASSERT_EQ(event.value()->scheduling_slice().tid(), i);
+  }
+  EXPECT_THAT(reader.ReadEvent(), HasErrorWithMessage("Unable to parse the message"));
+}
+
+TEST(ParallelCaptureSectionReader, CanBeDestroyedBeforeTheEnd) {
+  std::vector<std::string> serialized_events;
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    serialized_events.emplace_back(CreateSerializedSchedulingSlice(i));
+  }
+
+  FakeProtoSectionInputStream input_stream{std::move(serialized_events)};
+  {
+    ParallelCaptureSectionReader reader{&input_stream, kParserCount};
+    ASSERT_THAT(reader.ReadEvent(), HasNoError());
+  }
+  {
+    // Destroying the reader while nothing has been read yet doesn't block either.
+    ParallelCaptureSectionReader reader{&input_stream, kParserCount};
+  }
+}
+
+}  // namespace orbit_capture_client
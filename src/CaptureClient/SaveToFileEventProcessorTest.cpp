@@ -17,9 +17,14 @@
 
 #include "CaptureClient/CaptureEventProcessor.h"
 #include "CaptureFile/CaptureFile.h"
+#include "CaptureFile/CaptureFileOutputStream.h"
 #include "CaptureFile/CaptureFileSection.h"
 #include "CaptureFile/ProtoSectionInputStream.h"
+#include "ClientData/CallstackEvent.h"
+#include "ClientData/CallstackInfo.h"
+#include "ClientData/LinuxAddressInfo.h"
 #include "GrpcProtos/capture.pb.h"
+#include "MockCaptureListener.h"
 #include "OrbitBase/Result.h"
 #include "TestUtils/TemporaryDirectory.h"
 #include "TestUtils/TestUtils.h"
@@ -27,11 +32,17 @@
 namespace orbit_capture_client {
 
 using orbit_capture_file::CaptureFile;
+using orbit_capture_file::CaptureSectionCompression;
+using orbit_capture_file::ProtoSectionInputStream;
+using orbit_client_data::CallstackEvent;
+using orbit_client_data::CallstackInfo;
+using orbit_client_data::LinuxAddressInfo;
 using orbit_grpc_protos::CaptureFinished;
 using orbit_grpc_protos::ClientCaptureEvent;
 using orbit_test_utils::HasNoError;
 using orbit_test_utils::HasValue;
 using orbit_test_utils::TemporaryDirectory;
+using ::testing::_;
 
 static ClientCaptureEvent CreateInternedStringEvent(uint64_t key, const char* intern) {
   ClientCaptureEvent event;
@@ -47,7 +58,13 @@ static ClientCaptureEvent CreateCaptureFinishedEvent() {
   return event;
 }
 
-TEST(SaveToFileEventProcessor, SaveAndLoadSimpleCapture) {
+class SaveToFileEventProcessorTest : public ::testing::TestWithParam<CaptureSectionCompression> {};
+
+INSTANTIATE_TEST_SUITE_P(SaveToFileEventProcessorTests, SaveToFileEventProcessorTest,
+                         ::testing::Values(CaptureSectionCompression::kNone,
+                                           CaptureSectionCompression::kZstd));
+
+TEST_P(SaveToFileEventProcessorTest, SaveAndLoadSimpleCapture) {
   auto temporary_dir_or_error = TemporaryDirectory::Create();
   ASSERT_TRUE(temporary_dir_or_error.has_value()) << temporary_dir_or_error.error().message();
   TemporaryDirectory temporary_dir = std::move(temporary_dir_or_error.value());
@@ -56,8 +73,8 @@ TEST(SaveToFileEventProcessor, SaveAndLoadSimpleCapture) {
   auto error_handler = [](const ErrorMessage& error) { FAIL() << error.message(); };
 
   std::filesystem::path capture_file_path = temporary_dir.GetDirectoryPath() / "capture.orbit";
-  auto capture_event_processor_or_error =
-      CaptureEventProcessor::CreateSaveToFileProcessor(capture_file_path, error_handler);
+  auto capture_event_processor_or_error = CaptureEventProcessor::CreateSaveToFileProcessor(
+      capture_file_path, error_handler, GetParam());
   ASSERT_TRUE(capture_event_processor_or_error.has_value())
       << capture_event_processor_or_error.error().message();
 
@@ -115,4 +132,136 @@ TEST(SaveToFileEventProcessor, SaveAndLoadSimpleCapture) {
   EXPECT_FALSE(user_data_section.has_value());
 }
 
+TEST_P(SaveToFileEventProcessorTest, SaveAndLoadWindowFromTimestamp) {
+  // Enough samples for the timestamp index to have several checkpoints.
+  constexpr uint64_t kSampleCount = 400'000;
+  constexpr uint64_t kFunctionNameKey = 1;
+  constexpr uint64_t kModuleNameKey = 2;
+  constexpr uint64_t kCallstackId = 3;
+  constexpr uint64_t kAbsoluteAddress = 0x1000;
+  constexpr uint32_t kTid = 42;
+  constexpr uint32_t kPid = 41;
+  constexpr const char* kModulePath = "/path/to/module";
+  constexpr const char* kThreadName = "thread";
+  constexpr const char* kOtherThreadName = "other thread";
+  constexpr uint32_t kOtherTid = 43;
+  auto get_timestamp_ns = [](uint64_t sample_index) { return 1'000 + sample_index * 1'000; };
+  const uint64_t first_timestamp_to_load_ns = get_timestamp_ns(kSampleCount * 7 / 8);
+
+  auto temporary_dir_or_error = TemporaryDirectory::Create();
+  ASSERT_THAT(temporary_dir_or_error, HasNoError());
+  TemporaryDirectory temporary_dir = std::move(temporary_dir_or_error.value());
+  std::filesystem::path capture_file_path = temporary_dir.GetDirectoryPath() / "capture.orbit";
+
+  {
+    auto error_handler = [](const ErrorMessage& error) { FAIL() << error.message(); };
+    auto capture_event_processor_or_error = CaptureEventProcessor::CreateSaveToFileProcessor(
+        capture_file_path, error_handler, GetParam());
+    ASSERT_THAT(capture_event_processor_or_error, HasNoError());
+    std::unique_ptr<CaptureEventProcessor> capture_event_processor =
+        std::move(capture_event_processor_or_error.value());
+
+    ClientCaptureEvent capture_started;
+    capture_started.mutable_capture_started()->set_capture_start_timestamp_ns(1);
+    capture_event_processor->ProcessEvent(capture_started);
+    capture_event_processor->ProcessEvent(CreateInternedStringEvent(kFunctionNameKey, "foo"));
+    capture_event_processor->ProcessEvent(CreateInternedStringEvent(kModuleNameKey, "module"));
+    ClientCaptureEvent address_info;
+    address_info.mutable_address_info()->set_absolute_address(kAbsoluteAddress);
+    address_info.mutable_address_info()->set_function_name_key(kFunctionNameKey);
+    address_info.mutable_address_info()->set_module_name_key(kModuleNameKey);
+    capture_event_processor->ProcessEvent(address_info);
+    ClientCaptureEvent interned_callstack;
+    interned_callstack.mutable_interned_callstack()->set_key(kCallstackId);
+    interned_callstack.mutable_interned_callstack()->mutable_intern()->add_pcs(kAbsoluteAddress);
+    capture_event_processor->ProcessEvent(interned_callstack);
+    // Like TracerImpl, only send the modules and thread names at the start of the capture.
+    ClientCaptureEvent modules_snapshot;
+    modules_snapshot.mutable_modules_snapshot()->set_pid(kPid);
+    modules_snapshot.mutable_modules_snapshot()->set_timestamp_ns(1);
+    modules_snapshot.mutable_modules_snapshot()->add_modules()->set_file_path(kModulePath);
+    capture_event_processor->ProcessEvent(modules_snapshot);
+    ClientCaptureEvent thread_names_snapshot;
+    thread_names_snapshot.mutable_thread_names_snapshot()->set_timestamp_ns(1);
+    orbit_grpc_protos::ThreadName* thread_name =
+        thread_names_snapshot.mutable_thread_names_snapshot()->add_thread_names();
+    thread_name->set_pid(kPid);
+    thread_name->set_tid(kTid);
+    thread_name->set_name(kThreadName);
+    capture_event_processor->ProcessEvent(thread_names_snapshot);
+    ClientCaptureEvent other_thread_name;
+    other_thread_name.mutable_thread_name()->set_pid(kPid);
+    other_thread_name.mutable_thread_name()->set_tid(kOtherTid);
+    other_thread_name.mutable_thread_name()->set_name(kOtherThreadName);
+    other_thread_name.mutable_thread_name()->set_timestamp_ns(1);
+    capture_event_processor->ProcessEvent(other_thread_name);
+
+    for (uint64_t sample_index = 0; sample_index < kSampleCount; ++sample_index) {
+      ClientCaptureEvent callstack_sample;
+      callstack_sample.mutable_callstack_sample()->set_tid(kTid);
+      callstack_sample.mutable_callstack_sample()->set_callstack_id(kCallstackId);
+      callstack_sample.mutable_callstack_sample()->set_timestamp_ns(get_timestamp_ns(sample_index));
+      capture_event_processor->ProcessEvent(callstack_sample);
+    }
+    capture_event_processor->ProcessEvent(CreateCaptureFinishedEvent());
+  }
+
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(capture_file_path);
+  ASSERT_THAT(capture_file_or_error, HasNoError());
+  std::unique_ptr<CaptureFile> capture_file = std::move(capture_file_or_error.value());
+  auto capture_section_or_error =
+      capture_file->CreateCaptureSectionInputStreamFromTimestamp(first_timestamp_to_load_ns);
+  ASSERT_THAT(capture_section_or_error, HasNoError());
+  std::unique_ptr<ProtoSectionInputStream> capture_section =
+      std::move(capture_section_or_error.value());
+
+  // The events before the window that the ones in it depend on are replayed, so the regular
+  // processor can handle the window like a whole capture.
+  ::testing::NiceMock<MockCaptureListener> listener;
+  EXPECT_CALL(listener, OnCaptureStarted).Times(1);
+  EXPECT_CALL(listener, OnAddressInfo)
+      .WillOnce([&](const LinuxAddressInfo& linux_address_info) {
+        EXPECT_EQ(linux_address_info.absolute_address(), kAbsoluteAddress);
+        EXPECT_EQ(linux_address_info.function_name(), "foo");
+        EXPECT_EQ(linux_address_info.module_path(), "module");
+      });
+  EXPECT_CALL(listener, OnUniqueCallstack(kCallstackId, _))
+      .WillOnce([&](uint64_t /*callstack_id*/, const CallstackInfo& callstack_info) {
+        EXPECT_THAT(callstack_info.frames(), ::testing::ElementsAre(kAbsoluteAddress));
+      });
+  EXPECT_CALL(listener, OnModulesSnapshot)
+      .WillOnce([&](uint64_t /*timestamp_ns*/,
+                    const std::vector<orbit_grpc_protos::ModuleInfo>& module_infos) {
+        ASSERT_EQ(module_infos.size(), 1);
+        EXPECT_EQ(module_infos[0].file_path(), kModulePath);
+      });
+  EXPECT_CALL(listener, OnThreadName(kTid, std::string{kThreadName})).Times(1);
+  EXPECT_CALL(listener, OnThreadName(kOtherTid, std::string{kOtherThreadName})).Times(1);
+  std::vector<uint64_t> loaded_timestamps_ns;
+  EXPECT_CALL(listener, OnCallstackEvent)
+      .WillRepeatedly([&](const CallstackEvent& callstack_event) {
+        EXPECT_EQ(callstack_event.callstack_id(), kCallstackId);
+        loaded_timestamps_ns.push_back(callstack_event.timestamp_ns());
+      });
+  EXPECT_CALL(listener, OnCaptureFinished).Times(1);
+
+  std::unique_ptr<CaptureEventProcessor> capture_event_processor =
+      CaptureEventProcessor::CreateForCaptureListener(&listener, capture_file_path, {});
+  while (true) {
+    ClientCaptureEvent event;
+    ASSERT_THAT(capture_section->ReadMessage(&event), HasNoError());
+    capture_event_processor->ProcessEvent(event);
+    if (event.event_case() == ClientCaptureEvent::kCaptureFinished) break;
+  }
+
+  // All the samples in the window are loaded, and only few before it.
+  ASSERT_FALSE(loaded_timestamps_ns.empty());
+  EXPECT_LT(loaded_timestamps_ns.size(), kSampleCount / 2);
+  EXPECT_LE(loaded_timestamps_ns.front(), first_timestamp_to_load_ns);
+  EXPECT_EQ(loaded_timestamps_ns.back(), get_timestamp_ns(kSampleCount - 1));
+  for (size_t i = 1; i < loaded_timestamps_ns.size(); ++i) {
+    ASSERT_EQ(loaded_timestamps_ns[i], loaded_timestamps_ns[i - 1] + 1'000);
+  }
+}
+
 }  // namespace orbit_capture_client
\ No newline at end of file
@@ -65,8 +65,7 @@ class CaptureClient {
 
  private:
   ErrorMessageOr<CaptureListener::CaptureOutcome> CaptureSync(
-      orbit_grpc_protos::CaptureOptions capture_options,
-      CaptureEventProcessor* capture_event_processor);
+      orbit_grpc_protos::CaptureRequest request, CaptureEventProcessor* capture_event_processor);
 
   void ProcessEvents(
       CaptureEventProcessor* capture_event_processor,
@@ -17,6 +17,7 @@
 
 #include "CaptureClient/CaptureListener.h"
 #include "GrpcProtos/capture.pb.h"
+#include "CaptureFile/CaptureFileOutputStream.h"
 #include "OrbitBase/Result.h"
 
 namespace orbit_capture_client {
@@ -32,9 +33,13 @@ class CaptureEventProcessor {
       CaptureListener* capture_listener, std::optional<std::filesystem::path> file_path,
       absl::flat_hash_set<uint64_t> frame_track_function_ids);
 
+  // With compression, the capture file is written in version 2 of the format, which older versions
+  // of Orbit can't open.
   static ErrorMessageOr<std::unique_ptr<CaptureEventProcessor>> CreateSaveToFileProcessor(
       const std::filesystem::path& file_path,
-      std::function<void(const ErrorMessage&)> error_handler);
+      std::function<void(const ErrorMessage&)> error_handler,
+      orbit_capture_file::CaptureSectionCompression compression =
+          orbit_capture_file::CaptureSectionCompression::kNone);
 
   static std::unique_ptr<CaptureEventProcessor> CreateCompositeProcessor(
       std::vector<std::unique_ptr<CaptureEventProcessor>> event_processors);
@@ -11,6 +11,7 @@
 #include "ClientData/FunctionInfo.h"
 #include "ClientData/TracepointCustom.h"
 #include "GrpcProtos/capture.pb.h"
+#include "GrpcProtos/services.pb.h"
 
 namespace orbit_capture_client {
 
@@ -35,6 +36,7 @@ struct ClientCaptureOptions {
 
   uint16_t stack_dump_size = 0;
   uint16_t thread_state_change_callstack_stack_dump_size = 0;
+  uint32_t unwinding_worker_count = 0;
   uint64_t max_local_marker_depth_per_command_buffer = 0;
   uint64_t memory_sampling_period_ms = 0;
   double samples_per_second = 0;
@@ -48,6 +50,24 @@ struct ClientCaptureOptions {
   bool record_arguments = false;
   bool record_return_values = false;
   bool enable_auto_frame_track = false;
+
+  // Ask the service to send the high-frequency events in a columnar, delta-encoded form, and to
+  // compress the CaptureResponses. This reduces the bandwidth used on slow connections, at the
+  // cost of some CPU time on both sides.
+  bool pack_capture_events = false;
+  bool compress_capture_responses = false;
+
+  // How the service buffers the events before sending them: the longest time it keeps them, and
+  // how much memory they can use before it drops some kinds of events, as per `event_drop_policy`.
+  // 0 selects the defaults of the service.
+  uint32_t max_send_latency_ms = 0;
+  uint64_t event_memory_budget_bytes = 0;
+  orbit_grpc_protos::CaptureRequest::EventDropPolicy event_drop_policy =
+      orbit_grpc_protos::CaptureRequest::kNeverDrop;
+
+  // Ask the in-process producers (Orbit API, user space instrumentation) to pass their events to
+  // OrbitService through shared memory instead of gRPC.
+  bool use_shared_memory_producer_transport = false;
 };
 
 }  // namespace orbit_capture_client
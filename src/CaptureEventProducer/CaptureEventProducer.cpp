@@ -10,7 +10,9 @@
 #include <chrono>
 
 #include "OrbitBase/Logging.h"
+#include "OrbitBase/Result.h"
 #include "OrbitBase/ThreadUtils.h"
+#include "SharedMemoryTransport/SharedMemoryFdPassing.h"
 
 using orbit_grpc_protos::ProducerSideService;
 using orbit_grpc_protos::ReceiveCommandsAndSendEventsResponse;
@@ -107,6 +109,41 @@ bool CaptureEventProducer::NotifyAllEventsSent() {
   return write_succeeded;
 }
 
+bool CaptureEventProducer::NotifySharedMemoryRingBuffer(int fd, uint64_t start_offset) {
+  ORBIT_CHECK(producer_side_service_stub_ != nullptr);
+  {
+    absl::ReaderMutexLock lock{&shutdown_requested_mutex_};
+    ORBIT_CHECK(!shutdown_requested_);
+  }
+
+  ErrorMessageOr<uint64_t> token_or_error =
+      orbit_shared_memory_transport::SendSharedMemoryFd(shared_memory_fd_socket_path_, fd);
+  if (token_or_error.has_error()) {
+    ORBIT_ERROR("Passing the shared memory ring buffer to ProducerSideService: %s",
+                token_or_error.error().message());
+    return false;
+  }
+
+  orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest shared_memory_ring_buffer_request;
+  auto* shared_memory_ring_buffer =
+      shared_memory_ring_buffer_request.mutable_shared_memory_ring_buffer();
+  shared_memory_ring_buffer->set_token(token_or_error.value());
+  shared_memory_ring_buffer->set_start_offset(start_offset);
+  bool write_succeeded{};
+  {
+    absl::ReaderMutexLock lock{&context_and_stream_mutex_};
+    if (stream_ == nullptr) {
+      ORBIT_ERROR("Sending SharedMemoryRingBuffer to ProducerSideService: not connected");
+      return false;
+    }
+    write_succeeded = stream_->Write(shared_memory_ring_buffer_request);
+  }
+  if (!write_succeeded) {
+    ORBIT_ERROR("Sending SharedMemoryRingBuffer to ProducerSideService");
+  }
+  return write_succeeded;
+}
+
 void CaptureEventProducer::ConnectAndReceiveCommandsThread() {
   ORBIT_CHECK(producer_side_service_stub_ != nullptr);
   orbit_base::SetCurrentThreadName("ConnectRcvCmds");
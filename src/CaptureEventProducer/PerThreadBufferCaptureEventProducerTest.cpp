@@ -0,0 +1,210 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+#include <absl/types/span.h>
+#include <gmock/gmock.h>
+#include <google/protobuf/arena.h>
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/support/channel_arguments.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "CaptureEventProducer/PerThreadBufferCaptureEventProducer.h"
+#include "FakeProducerSideService/FakeProducerSideService.h"
+#include "GrpcProtos/capture.pb.h"
+
+namespace orbit_capture_event_producer {
+
+namespace {
+
+// The intermediate events are the index of the enqueuing thread in the upper 32 bits and the index
+// of the event in that thread in the lower 32 bits. They are forwarded as the key of an
+// InternedString.
+class PerThreadBufferCaptureEventProducerImpl
+    : public PerThreadBufferCaptureEventProducer<uint64_t> {
+ public:
+  using PerThreadBufferCaptureEventProducer<uint64_t>::PerThreadBufferCaptureEventProducer;
+  using PerThreadBufferCaptureEventProducer<uint64_t>::DequeueIntermediateEvents;
+
+ protected:
+  orbit_grpc_protos::ProducerCaptureEvent* TranslateIntermediateEvent(
+      uint64_t&& intermediate_event, google::protobuf::Arena* arena) override {
+    auto* capture_event =
+        google::protobuf::Arena::CreateMessage<orbit_grpc_protos::ProducerCaptureEvent>(arena);
+    capture_event->mutable_interned_string()->set_key(intermediate_event);
+    return capture_event;
+  }
+};
+
+constexpr size_t kThreadBufferCapacity = 16;
+
+class PerThreadBufferCaptureEventProducerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    fake_service_.emplace();
+
+    grpc::ServerBuilder builder;
+    builder.RegisterService(&fake_service_.value());
+    fake_server_ = builder.BuildAndStart();
+    ASSERT_NE(fake_server_, nullptr);
+
+    std::shared_ptr<grpc::Channel> channel =
+        fake_server_->InProcessChannel(grpc::ChannelArguments{});
+
+    // The buffers are small, so that events also go through the overflow queues.
+    buffer_producer_.emplace(kThreadBufferCapacity);
+    buffer_producer_->BuildAndStart(channel);
+
+    // Leave some time for the ReceiveCommandsAndSendEvents RPC to actually happen.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+
+  void TearDown() override {
+    // Leave some time for all pending communication to finish.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    buffer_producer_->ShutdownAndWait();
+    buffer_producer_.reset();
+
+    fake_service_->FinishAndDisallowRpc();
+    fake_server_->Shutdown();
+    fake_server_->Wait();
+
+    fake_service_.reset();
+    fake_server_.reset();
+  }
+
+  std::optional<orbit_fake_producer_side_service::FakeProducerSideService> fake_service_;
+  std::unique_ptr<grpc::Server> fake_server_;
+  std::optional<PerThreadBufferCaptureEventProducerImpl> buffer_producer_;
+};
+
+constexpr std::chrono::milliseconds kWaitMessagesSentDuration{25};
+
+}  // namespace
+
+TEST_F(PerThreadBufferCaptureEventProducerTest, EventsOfEachThreadAreForwardedInOrder) {
+  fake_service_->SendStartCaptureCommand(orbit_grpc_protos::CaptureOptions{});
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+  EXPECT_TRUE(buffer_producer_->IsCapturing());
+
+  absl::Mutex mutex;
+  std::vector<uint64_t> received_events;
+  ON_CALL(*fake_service_, OnCaptureEventsReceived)
+      .WillByDefault([&mutex, &received_events](
+                         absl::Span<const orbit_grpc_protos::ProducerCaptureEvent> events) {
+        absl::MutexLock lock{&mutex};
+        for (const orbit_grpc_protos::ProducerCaptureEvent& event : events) {
+          received_events.push_back(event.interned_string().key());
+        }
+      });
+  EXPECT_CALL(*fake_service_, OnCaptureEventsReceived).Times(::testing::AtLeast(1));
+
+  constexpr uint64_t kThreadCount = 8;
+  constexpr uint64_t kEventCountPerThread = 1000;
+  std::vector<std::thread> threads;
+  for (uint64_t thread_index = 0; thread_index < kThreadCount; ++thread_index) {
+    threads.emplace_back([this, thread_index] {
+      for (uint64_t event_index = 0; event_index < kEventCountPerThread; ++event_index) {
+        buffer_producer_->EnqueueIntermediateEvent(thread_index << 32 | event_index);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_CALL(*fake_service_, OnAllEventsSentReceived).Times(1);
+  fake_service_->SendStopCaptureCommand();
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+  EXPECT_FALSE(buffer_producer_->IsCapturing());
+
+  absl::MutexLock lock{&mutex};
+  ASSERT_EQ(received_events.size(), kThreadCount * kEventCountPerThread);
+  absl::flat_hash_map<uint64_t, uint64_t> next_event_index_by_thread_index;
+  for (uint64_t received_event : received_events) {
+    uint64_t& next_event_index = next_event_index_by_thread_index[received_event >> 32];
+    EXPECT_EQ(received_event & 0xffffffff, next_event_index);
+    ++next_event_index;
+  }
+}
+
+TEST(PerThreadBufferCaptureEventProducer, EventsGoToTheOverflowQueueWhenTheThreadBufferIsFull) {
+  // The producer is not started, so that the buffers are only emptied by the test.
+  PerThreadBufferCaptureEventProducerImpl buffer_producer{4};
+
+  for (uint64_t i = 0; i < 6; ++i) {
+    buffer_producer.EnqueueIntermediateEvent(uint64_t{i});
+  }
+  EXPECT_EQ(buffer_producer.GetOverflowEventCount(), 2);
+
+  std::vector<uint64_t> events(10);
+  ASSERT_EQ(buffer_producer.DequeueIntermediateEvents(events.data(), 3), 3);
+  EXPECT_THAT(absl::MakeSpan(events.data(), 3), ::testing::ElementsAre(0, 1, 2));
+
+  // While the overflow queue is not empty, events go after the ones in it, even though the buffer
+  // has room again.
+  buffer_producer.EnqueueIntermediateEvent(6);
+  EXPECT_EQ(buffer_producer.GetOverflowEventCount(), 3);
+  ASSERT_EQ(buffer_producer.DequeueIntermediateEvents(events.data(), events.size()), 4);
+  EXPECT_THAT(absl::MakeSpan(events.data(), 4), ::testing::ElementsAre(3, 4, 5, 6));
+
+  buffer_producer.EnqueueIntermediateEvent(7);
+  EXPECT_EQ(buffer_producer.GetOverflowEventCount(), 3);
+
+  // Another thread has its own buffer.
+  std::thread other_thread{[&buffer_producer] {
+    for (uint64_t i = 0; i < 5; ++i) {
+      buffer_producer.EnqueueIntermediateEvent(uint64_t{i});
+    }
+  }};
+  other_thread.join();
+  EXPECT_EQ(buffer_producer.GetOverflowEventCount(), 4);
+  EXPECT_EQ(buffer_producer.DequeueIntermediateEvents(events.data(), events.size()), 6);
+  EXPECT_EQ(buffer_producer.GetOverflowEventCount(), 4);
+}
+
+TEST(PerThreadBufferCaptureEventProducer, EventsEnqueuedAfterTheThreadReleasedItsBufferAreKept) {
+  PerThreadBufferCaptureEventProducerImpl buffer_producer{4};
+
+  // Being constructed before the buffer of the thread, it is destroyed after the thread released
+  // the buffer.
+  struct EnqueueOnDestruction {
+    ~EnqueueOnDestruction() {
+      for (uint64_t i = 6; i < 9; ++i) {
+        buffer_producer->EnqueueIntermediateEvent(uint64_t{i});
+      }
+    }
+    PerThreadBufferCaptureEventProducerImpl* buffer_producer = nullptr;
+  };
+  std::thread thread{[&buffer_producer] {
+    thread_local EnqueueOnDestruction enqueue_on_destruction;
+    enqueue_on_destruction.buffer_producer = &buffer_producer;
+    for (uint64_t i = 0; i < 6; ++i) {
+      buffer_producer.EnqueueIntermediateEvent(uint64_t{i});
+    }
+  }};
+  thread.join();
+
+  // Dequeuing few events at a time, the events enqueued last wait for the released buffer.
+  std::vector<uint64_t> dequeued_events;
+  std::vector<uint64_t> events(2);
+  size_t dequeued_event_count = 0;
+  while ((dequeued_event_count =
+              buffer_producer.DequeueIntermediateEvents(events.data(), events.size())) > 0) {
+    dequeued_events.insert(dequeued_events.end(), events.begin(),
+                           events.begin() + dequeued_event_count);
+  }
+  EXPECT_THAT(dequeued_events, ::testing::ElementsAre(0, 1, 2, 3, 4, 5, 6, 7, 8));
+  EXPECT_EQ(buffer_producer.GetOverflowEventCount(), 2);
+}
+
+}  // namespace orbit_capture_event_producer
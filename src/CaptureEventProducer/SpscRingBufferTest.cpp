@@ -0,0 +1,102 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "CaptureEventProducer/SpscRingBuffer.h"
+
+namespace orbit_capture_event_producer {
+
+TEST(SpscRingBuffer, PopsInPushOrder) {
+  SpscRingBuffer<int> ring_buffer{4};
+  EXPECT_EQ(ring_buffer.capacity(), 4);
+  EXPECT_TRUE(ring_buffer.IsEmpty());
+
+  EXPECT_TRUE(ring_buffer.TryPush(1));
+  EXPECT_TRUE(ring_buffer.TryPush(2));
+  EXPECT_TRUE(ring_buffer.TryPush(3));
+  EXPECT_FALSE(ring_buffer.IsEmpty());
+
+  std::vector<int> popped;
+  EXPECT_EQ(ring_buffer.TryPopBulk(std::back_inserter(popped), 2), 2);
+  EXPECT_THAT(popped, ::testing::ElementsAre(1, 2));
+  EXPECT_EQ(ring_buffer.TryPopBulk(std::back_inserter(popped), 2), 1);
+  EXPECT_THAT(popped, ::testing::ElementsAre(1, 2, 3));
+  EXPECT_EQ(ring_buffer.TryPopBulk(std::back_inserter(popped), 2), 0);
+  EXPECT_TRUE(ring_buffer.IsEmpty());
+}
+
+TEST(SpscRingBuffer, PushFailsWhenFull) {
+  SpscRingBuffer<std::unique_ptr<int>> ring_buffer{2};
+  EXPECT_TRUE(ring_buffer.TryPush(std::make_unique<int>(1)));
+  EXPECT_TRUE(ring_buffer.TryPush(std::make_unique<int>(2)));
+
+  auto element = std::make_unique<int>(3);
+  EXPECT_FALSE(ring_buffer.TryPush(std::move(element)));
+  // The element is left to the caller.
+  ASSERT_NE(element, nullptr);
+
+  std::vector<std::unique_ptr<int>> popped;
+  EXPECT_EQ(ring_buffer.TryPopBulk(std::back_inserter(popped), 1), 1);
+  EXPECT_EQ(*popped[0], 1);
+  EXPECT_TRUE(ring_buffer.TryPush(std::move(element)));
+}
+
+TEST(SpscRingBuffer, WrapsAround) {
+  SpscRingBuffer<uint64_t> ring_buffer{4};
+  std::vector<uint64_t> popped;
+  for (uint64_t i = 0; i < 100; ++i) {
+    EXPECT_TRUE(ring_buffer.TryPush(uint64_t{i}));
+    EXPECT_TRUE(ring_buffer.TryPush(uint64_t{i}));
+    EXPECT_EQ(ring_buffer.TryPopBulk(std::back_inserter(popped), 3), 2);
+  }
+  EXPECT_EQ(popped.size(), 200);
+  EXPECT_EQ(popped.back(), 99);
+}
+
+TEST(SpscRingBuffer, DestroysRemainingElements) {
+  auto shared = std::make_shared<int>(0);
+  {
+    SpscRingBuffer<std::shared_ptr<int>> ring_buffer{4};
+    EXPECT_TRUE(ring_buffer.TryPush(std::shared_ptr<int>{shared}));
+    EXPECT_TRUE(ring_buffer.TryPush(std::shared_ptr<int>{shared}));
+    EXPECT_EQ(shared.use_count(), 3);
+  }
+  EXPECT_EQ(shared.use_count(), 1);
+}
+
+TEST(SpscRingBuffer, ConcurrentPushAndPop) {
+  constexpr uint64_t kElementCount = 1'000'000;
+  SpscRingBuffer<uint64_t> ring_buffer{64};
+
+  std::thread producer{[&ring_buffer] {
+    for (uint64_t i = 0; i < kElementCount; ++i) {
+      while (!ring_buffer.TryPush(uint64_t{i})) {
+        std::this_thread::yield();
+      }
+    }
+  }};
+
+  std::vector<uint64_t> popped;
+  popped.reserve(kElementCount);
+  while (popped.size() < kElementCount) {
+    if (ring_buffer.TryPopBulk(std::back_inserter(popped), 16) == 0) {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+
+  for (uint64_t i = 0; i < kElementCount; ++i) {
+    ASSERT_EQ(popped[i], i);
+  }
+}
+
+}  // namespace orbit_capture_event_producer
@@ -0,0 +1,334 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_EVENT_PRODUCER_BUFFERED_CAPTURE_EVENT_PRODUCER_H_
+#define CAPTURE_EVENT_PRODUCER_BUFFERED_CAPTURE_EVENT_PRODUCER_H_
+
+#include <absl/functional/function_ref.h>
+#include <absl/synchronization/mutex.h>
+#include <google/protobuf/arena.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "CaptureEventProducer/CaptureEventProducer.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/MakeUniqueForOverwrite.h"
+#include "OrbitBase/ThreadUtils.h"
+#include "SharedMemoryTransport/SharedMemoryRecords.h"
+#include "SharedMemoryTransport/SharedMemoryRingBuffer.h"
+
+namespace orbit_capture_event_producer {
+
+// This still abstract implementation of CaptureEventProducer buffers events written with low
+// overhead from the fast path where they are produced, and forwards them to ProducerSideService.
+// How events are enqueued and dequeued is left to subclasses, see
+// LockFreeBufferCaptureEventProducer and PerThreadBufferCaptureEventProducer.
+//
+// Internally, a thread reads from the buffer using DequeueIntermediateEvents, and sends
+// ProducerCaptureEvents to ProducerSideService using the methods provided by the superclass.
+//
+// The type of the buffered events is specified by the type parameter IntermediateEventT. These
+// events don't need to be ProducerCaptureEvents, nor protobufs at all. This is to allow enqueuing
+// objects that are faster to produce than protobufs. ProducerCaptureEvents are then built from
+// IntermediateEventT in TranslateIntermediateEvent, which subclasses need to implement.
+//
+// In particular, when hundreds of thousands of events are produced per second, it is recommended
+// that IntermediateEventT not be a protobuf or another type that involves heap allocations, as the
+// cost of dynamic allocations and de-allocations can add up quickly.
+//
+// When CaptureOptions::use_shared_memory_producer_transport is set, the events are instead written
+// to a ring buffer in memory shared with OrbitService, and gRPC is only used for control. This
+// saves the serialization of the requests and the system calls to send them. Subclasses can
+// override WriteSharedMemoryRecord to write events in a fixed layout instead of as protobufs.
+template <typename IntermediateEventT>
+class BufferedCaptureEventProducer : public CaptureEventProducer {
+ public:
+  void BuildAndStart(const std::shared_ptr<grpc::Channel>& channel) final {
+    CaptureEventProducer::BuildAndStart(channel);
+
+    forwarder_thread_ = std::thread{&BufferedCaptureEventProducer::ForwarderThread, this};
+  }
+
+  void ShutdownAndWait() final {
+    shutdown_requested_ = true;
+
+    ORBIT_CHECK(forwarder_thread_.joinable());
+    forwarder_thread_.join();
+
+    CaptureEventProducer::ShutdownAndWait();
+  }
+
+ protected:
+  void OnCaptureStart(orbit_grpc_protos::CaptureOptions capture_options) override {
+    absl::MutexLock lock{&status_mutex_};
+    status_ = ProducerStatus::kShouldSendEvents;
+    use_shared_memory_ = capture_options.use_shared_memory_producer_transport();
+    capture_finished_ = false;
+    ++capture_count_;
+  }
+
+  void OnCaptureStop() override {
+    absl::MutexLock lock{&status_mutex_};
+    status_ = ProducerStatus::kShouldNotifyAllEventsSent;
+  }
+
+  void OnCaptureFinished() override {
+    absl::MutexLock lock{&status_mutex_};
+    status_ = ProducerStatus::kShouldDropEvents;
+    capture_finished_ = true;
+  }
+
+  // Subclasses need to implement this method to convert an `IntermediateEventT` enqueued in the
+  // buffer to a `CaptureEvent` to be sent to ProducerSideService.
+  // The `CaptureEvent` must be created in the Arena using `google::protobuf::Arena::CreateMessage`
+  // from <google/protobuf/arena.h>. The pointer provided by `CreateMessage` should be returned.
+  // This optimizes memory allocations and cache efficiency. But keep in mind that:
+  // - `string` and `bytes` fields (both of which use `std::string` internally) still get heap
+  //   allocated no matter what;
+  // - If `IntermediateEventT` is itself a `ProducerCaptureEvent`, or the type of one of its fields,
+  //   attempting to move from it into the Arena-allocated `ProducerCaptureEvent` will silently
+  //   result in a deep copy.
+  // Subclasses can return nullptr for an `IntermediateEventT` that doesn't describe an event by
+  // itself, e.g., because it only holds the data of a longer event, then nothing is sent for it.
+  [[nodiscard]] virtual orbit_grpc_protos::ProducerCaptureEvent* TranslateIntermediateEvent(
+      IntermediateEventT&& intermediate_event, google::protobuf::Arena* arena) = 0;
+
+  // Subclasses need to implement this method to move up to `max_count` of the events enqueued in
+  // their buffer to `events`, and to return their number. It is only called by the forwarder
+  // thread. Returning less than `max_count` events means that the buffer was emptied.
+  [[nodiscard]] virtual size_t DequeueIntermediateEvents(IntermediateEventT* events,
+                                                         size_t max_count) = 0;
+
+  // Subclasses can override this method to write an `IntermediateEventT` to the shared memory ring
+  // buffer in one of the fixed layouts of SharedMemoryRecordType, instead of as the serialized
+  // `CaptureEvent` returned by TranslateIntermediateEvent. They need to call `begin_record` exactly
+  // once with the type and the size of the record, and to fill the buffer it returns, unless it
+  // returns nullptr because the event has to be dropped. Not calling `begin_record` at all means
+  // that there is nothing to write for the `IntermediateEventT`, as when TranslateIntermediateEvent
+  // returns nullptr.
+  virtual void WriteSharedMemoryRecord(
+      IntermediateEventT&& intermediate_event, google::protobuf::Arena* arena,
+      absl::FunctionRef<char*(orbit_shared_memory_transport::SharedMemoryRecordType type,
+                              uint64_t size)>
+          begin_record) {
+    orbit_grpc_protos::ProducerCaptureEvent* capture_event =
+        TranslateIntermediateEvent(std::move(intermediate_event), arena);
+    if (capture_event == nullptr) return;
+    const size_t size = capture_event->ByteSizeLong();
+    char* payload = begin_record(
+        orbit_shared_memory_transport::SharedMemoryRecordType::kProducerCaptureEvent, size);
+    if (payload == nullptr) return;
+    capture_event->SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(payload));
+  }
+
+ private:
+  void ForwarderThread() {
+    orbit_base::SetCurrentThreadName("ForwarderThread");
+
+    constexpr uint64_t kMaxEventsPerRequest = 10'000;
+    std::vector<IntermediateEventT> dequeued_events(kMaxEventsPerRequest);
+
+    // Pre-allocate and always reuse the same 1 MB chunk of memory as the first block of each Arena
+    // instance in the loop below. This is a small but measurable performance improvement.
+    google::protobuf::ArenaOptions arena_options;
+    constexpr size_t kArenaFixedBlockSize = 1024 * 1024;
+    auto arena_initial_block = make_unique_for_overwrite<char[]>(kArenaFixedBlockSize);
+    arena_options.initial_block = arena_initial_block.get();
+    arena_options.initial_block_size = kArenaFixedBlockSize;
+    // Also make sure that, if the Arena still needs to allocate more blocks, those are larger than
+    // the default, which would be capped at 8 kB. We choose the same size as the pre-allocated
+    // first block for simplicity.
+    arena_options.start_block_size = kArenaFixedBlockSize;
+    arena_options.max_block_size = kArenaFixedBlockSize;
+
+    while (!shutdown_requested_) {
+      while (true) {
+        size_t dequeued_event_count =
+            DequeueIntermediateEvents(dequeued_events.data(), kMaxEventsPerRequest);
+        bool buffer_was_emptied = dequeued_event_count < kMaxEventsPerRequest;
+
+        ProducerStatus current_status;
+        bool use_shared_memory;
+        uint64_t capture_count;
+        {
+          absl::MutexLock lock{&status_mutex_};
+          current_status = status_;
+          use_shared_memory = use_shared_memory_;
+          capture_count = capture_count_;
+          if (status_ == ProducerStatus::kShouldNotifyAllEventsSent && buffer_was_emptied) {
+            // We are about to send AllEventsSent: update status_ while we hold the mutex.
+            status_ = ProducerStatus::kShouldDropEvents;
+          }
+        }
+
+        if ((current_status == ProducerStatus::kShouldSendEvents ||
+             current_status == ProducerStatus::kShouldNotifyAllEventsSent) &&
+            dequeued_event_count > 0) {
+          orbit_shared_memory_transport::SharedMemoryRingBufferWriter* ring_buffer =
+              use_shared_memory ? GetSharedMemoryRingBufferForCapture(capture_count) : nullptr;
+          if (ring_buffer != nullptr) {
+            google::protobuf::Arena arena{arena_options};
+            WriteEventsToSharedMemory(dequeued_events.data(), dequeued_event_count, ring_buffer,
+                                      &arena);
+          } else {
+            google::protobuf::Arena arena{arena_options};
+            auto* send_request = google::protobuf::Arena::CreateMessage<
+                orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest>(&arena);
+            auto* capture_events =
+                send_request->mutable_buffered_capture_events()->mutable_capture_events();
+            capture_events->Reserve(dequeued_event_count);
+
+            for (size_t i = 0; i < dequeued_event_count; ++i) {
+              orbit_grpc_protos::ProducerCaptureEvent* capture_event =
+                  TranslateIntermediateEvent(std::move(dequeued_events[i]), &arena);
+              if (capture_event != nullptr) capture_events->AddAllocated(capture_event);
+            }
+
+            if (!capture_events->empty() && !SendCaptureEvents(*send_request)) {
+              ORBIT_ERROR("Forwarding %lu CaptureEvents", dequeued_event_count);
+              break;
+            }
+          }
+        }
+
+        if (current_status == ProducerStatus::kShouldNotifyAllEventsSent && buffer_was_emptied) {
+          // The buffer is now empty and status_ == kShouldNotifyAllEventsSent,
+          // send AllEventsSent. status_ has already been changed to kShouldDropEvents.
+          if (!NotifyAllEventsSent()) {
+            ORBIT_ERROR("Notifying that all CaptureEvents have been sent");
+          }
+          break;
+        }
+
+        // Note that if current_status == ProducerStatus::kShouldDropEvents
+        // the events extracted from the buffer will just be dropped.
+
+        if (buffer_was_emptied) {
+          break;
+        }
+      }
+
+      constexpr std::chrono::microseconds kSleepOnEmptyQueue{1000};
+      // Wait for the buffer to fill up with new CaptureEvents.
+      std::this_thread::sleep_for(kSleepOnEmptyQueue);
+    }
+  }
+
+  // Returns the shared memory ring buffer to write the events of the `capture_count`-th capture
+  // to, after notifying ProducerSideService of it, or nullptr if the events of this capture have to
+  // be sent with gRPC instead. The ring buffer is created the first time it is needed.
+  [[nodiscard]] orbit_shared_memory_transport::SharedMemoryRingBufferWriter*
+  GetSharedMemoryRingBufferForCapture(uint64_t capture_count) {
+    if (capture_count == shared_memory_capture_count_) {
+      return shared_memory_ring_buffer_for_capture_;
+    }
+    shared_memory_capture_count_ = capture_count;
+    shared_memory_ring_buffer_for_capture_ = nullptr;
+
+    if (shared_memory_ring_buffer_ == nullptr) {
+      constexpr uint64_t kSharedMemoryRingBufferCapacity = 8 * 1024 * 1024;
+      auto ring_buffer_or_error =
+          orbit_shared_memory_transport::SharedMemoryRingBufferWriter::Create(
+              kSharedMemoryRingBufferCapacity);
+      if (ring_buffer_or_error.has_error()) {
+        ORBIT_ERROR("Creating shared memory ring buffer, sending CaptureEvents with gRPC: %s",
+                    ring_buffer_or_error.error().message());
+        return nullptr;
+      }
+      shared_memory_ring_buffer_ = std::move(ring_buffer_or_error.value());
+    }
+
+    if (!NotifySharedMemoryRingBuffer(shared_memory_ring_buffer_->fd(),
+                                      shared_memory_ring_buffer_->GetWriteOffset())) {
+      ORBIT_ERROR("Notifying the shared memory ring buffer, sending CaptureEvents with gRPC");
+      return nullptr;
+    }
+    shared_memory_ring_buffer_for_capture_ = shared_memory_ring_buffer_.get();
+    return shared_memory_ring_buffer_for_capture_;
+  }
+
+  void WriteEventsToSharedMemory(
+      IntermediateEventT* events, size_t event_count,
+      orbit_shared_memory_transport::SharedMemoryRingBufferWriter* ring_buffer,
+      google::protobuf::Arena* arena) {
+    size_t dropped_event_count = 0;
+    for (size_t i = 0; i < event_count; ++i) {
+      bool begin_record_called = false;
+      bool record_begun = false;
+      WriteSharedMemoryRecord(
+          std::move(events[i]), arena,
+          [this, ring_buffer, &begin_record_called, &record_begun](
+              orbit_shared_memory_transport::SharedMemoryRecordType type, uint64_t size) -> char* {
+            ORBIT_CHECK(!begin_record_called);
+            begin_record_called = true;
+            char* payload = BeginSharedMemoryRecord(ring_buffer, type, size);
+            record_begun = payload != nullptr;
+            return payload;
+          });
+      if (record_begun) {
+        ring_buffer->EndRecord();
+      } else if (begin_record_called) {
+        ++dropped_event_count;
+      }
+    }
+    ring_buffer->Publish();
+
+    if (dropped_event_count > 0) {
+      ORBIT_ERROR("Dropped %u CaptureEvents that couldn't be written to shared memory",
+                  dropped_event_count);
+    }
+  }
+
+  // Waits for enough space in the ring buffer, as long as the capture hasn't finished.
+  [[nodiscard]] char* BeginSharedMemoryRecord(
+      orbit_shared_memory_transport::SharedMemoryRingBufferWriter* ring_buffer,
+      orbit_shared_memory_transport::SharedMemoryRecordType type, uint64_t size) {
+    if (size > ring_buffer->GetMaxRecordSize()) return nullptr;
+    while (true) {
+      char* payload =
+          ring_buffer->TryBeginRecord(static_cast<uint32_t>(type), static_cast<uint32_t>(size));
+      if (payload != nullptr) return payload;
+
+      // Let ProducerSideService read what was written so far.
+      ring_buffer->Publish();
+      if (shutdown_requested_) return nullptr;
+      {
+        absl::MutexLock lock{&status_mutex_};
+        if (capture_finished_) return nullptr;
+      }
+      constexpr std::chrono::microseconds kSleepOnFullRingBuffer{100};
+      std::this_thread::sleep_for(kSleepOnFullRingBuffer);
+    }
+  }
+
+  std::thread forwarder_thread_;
+  std::atomic<bool> shutdown_requested_ = false;
+
+  enum class ProducerStatus { kShouldSendEvents, kShouldNotifyAllEventsSent, kShouldDropEvents };
+  ProducerStatus status_ = ProducerStatus::kShouldDropEvents;
+  // Unlike status_, which already changes to kShouldDropEvents when AllEventsSent is about to be
+  // sent, this only becomes true when ProducerSideService has stopped waiting for events.
+  bool capture_finished_ = true;
+  bool use_shared_memory_ = false;
+  uint64_t capture_count_ = 0;
+  absl::Mutex status_mutex_;
+
+  // Only accessed by the forwarder thread.
+  std::unique_ptr<orbit_shared_memory_transport::SharedMemoryRingBufferWriter>
+      shared_memory_ring_buffer_;
+  uint64_t shared_memory_capture_count_ = 0;
+  orbit_shared_memory_transport::SharedMemoryRingBufferWriter*
+      shared_memory_ring_buffer_for_capture_ = nullptr;
+};
+
+}  // namespace orbit_capture_event_producer
+
+#endif  // CAPTURE_EVENT_PRODUCER_BUFFERED_CAPTURE_EVENT_PRODUCER_H_
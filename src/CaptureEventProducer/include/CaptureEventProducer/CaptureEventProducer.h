@@ -11,11 +11,14 @@
 
 #include <atomic>
 #include <memory>
+#include <string>
 #include <thread>
+#include <utility>
 
 #include "GrpcProtos/capture.pb.h"
 #include "GrpcProtos/producer_side_services.grpc.pb.h"
 #include "GrpcProtos/producer_side_services.pb.h"
+#include "ProducerSideChannel/ProducerSideChannel.h"
 
 namespace orbit_capture_event_producer {
 
@@ -34,6 +37,12 @@ class CaptureEventProducer {
   // be attempted when the connection fails or is interrupted. The default is 4 seconds.
   void SetReconnectionDelayMs(uint64_t ms) { reconnection_delay_ms_ = ms; }
 
+  // Sets the path of the Unix domain socket on which NotifySharedMemoryRingBuffer passes the file
+  // descriptor of the ring buffer. Must be called before BuildAndStart.
+  void SetSharedMemoryFdSocketPath(std::string path) {
+    shared_memory_fd_socket_path_ = std::move(path);
+  }
+
  protected:
   // This method establishes the connection with ProducerSideService. If a connection fails or
   // is interrupted, the class will keep trying to (re)connect, until ShutdownAndWait is called.
@@ -59,6 +68,11 @@ class CaptureEventProducer {
   // Subclasses should use this method to notify the ProducerSideService that
   // they have sent all their CaptureEvents after the capture has been stopped.
   [[nodiscard]] bool NotifyAllEventsSent();
+  // Subclasses can use this method to notify the ProducerSideService that, for the current capture,
+  // they write their CaptureEvents to the shared memory ring buffer with file descriptor `fd`,
+  // starting at `start_offset`, instead of sending them with SendCaptureEvents. The file descriptor
+  // is passed to OrbitService on every call, see SharedMemoryFdPassing.h.
+  [[nodiscard]] bool NotifySharedMemoryRingBuffer(int fd, uint64_t start_offset);
 
  private:
   void ConnectAndReceiveCommandsThread();
@@ -79,6 +93,9 @@ class CaptureEventProducer {
   absl::Mutex shutdown_requested_mutex_;
 
   std::atomic<uint64_t> reconnection_delay_ms_ = 4000;
+
+  std::string shared_memory_fd_socket_path_ =
+      orbit_producer_side_channel::kProducerSideSharedMemoryFdUnixDomainSocketPath;
 };
 
 }  // namespace orbit_capture_event_producer
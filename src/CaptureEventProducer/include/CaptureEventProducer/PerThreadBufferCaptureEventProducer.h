@@ -0,0 +1,234 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_EVENT_PRODUCER_PER_THREAD_BUFFER_CAPTURE_EVENT_PRODUCER_H_
+#define CAPTURE_EVENT_PRODUCER_PER_THREAD_BUFFER_CAPTURE_EVENT_PRODUCER_H_
+
+#include <absl/base/optimization.h>
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "CaptureEventProducer/BufferedCaptureEventProducer.h"
+#include "CaptureEventProducer/SpscRingBuffer.h"
+
+namespace orbit_capture_event_producer {
+
+// This still abstract implementation of CaptureEventProducer gives each thread that enqueues
+// events its own SpscRingBuffer, registered with the producer the first time the thread enqueues an
+// event. Threads enqueuing events concurrently don't share any cache line, which makes
+// EnqueueIntermediateEvent cheaper than with LockFreeBufferCaptureEventProducer when many threads
+// produce events at a high rate. The events are forwarded to ProducerSideService as described in
+// BufferedCaptureEventProducer. Subclasses need to implement TranslateIntermediateEvent.
+//
+// The order of the events of each thread is preserved, as long as the thread doesn't alternate
+// between several producers of the same type. No event is dropped: the buffers have a fixed
+// capacity, and an event enqueued while the buffer of its thread is full goes to an unbounded
+// overflow queue of the thread, protected by a mutex. The following events of the thread also go
+// there, until the forwarder thread has emptied it.
+//
+// The destructors of thread_local objects can enqueue events after the thread has released its
+// buffer. Such events go to a queue shared by the exited threads, which is only emptied once the
+// buffers released by these threads have been emptied, so that their order is also preserved.
+template <typename IntermediateEventT>
+class PerThreadBufferCaptureEventProducer
+    : public BufferedCaptureEventProducer<IntermediateEventT> {
+ public:
+  static constexpr size_t kDefaultThreadBufferCapacity = 8 * 1024;
+
+  // `thread_buffer_capacity` must be a power of two.
+  explicit PerThreadBufferCaptureEventProducer(
+      size_t thread_buffer_capacity = kDefaultThreadBufferCapacity)
+      : thread_buffer_capacity_{thread_buffer_capacity} {}
+
+  void EnqueueIntermediateEvent(IntermediateEventT&& event) {
+    ThreadBuffer* thread_buffer = GetOrRegisterThreadBuffer();
+    if (ABSL_PREDICT_FALSE(thread_buffer == nullptr)) {
+      absl::MutexLock lock{&exited_thread_events_mutex_};
+      exited_thread_events_.push_back(std::move(event));
+      return;
+    }
+    // Only this thread increases the number of overflow events, so it can't miss that earlier
+    // events are still in the overflow queue and that this event needs to go after them.
+    if (ABSL_PREDICT_TRUE(
+            thread_buffer->pending_overflow_event_count.load(std::memory_order_relaxed) == 0 &&
+            thread_buffer->ring_buffer.TryPush(std::move(event)))) {
+      return;
+    }
+    absl::MutexLock lock{&thread_buffer->overflow_mutex};
+    thread_buffer->overflow_events.push_back(std::move(event));
+    thread_buffer->pending_overflow_event_count.fetch_add(1, std::memory_order_relaxed);
+    ++thread_buffer->overflow_event_count;
+  }
+
+  // Returns the number of events that went to the overflow queues because the buffer of their
+  // thread was full.
+  [[nodiscard]] uint64_t GetOverflowEventCount() const {
+    absl::MutexLock lock{&thread_buffers_mutex_};
+    uint64_t overflow_event_count = overflow_event_count_of_removed_buffers_;
+    for (const std::shared_ptr<ThreadBuffer>& thread_buffer : thread_buffers_) {
+      absl::MutexLock overflow_lock{&thread_buffer->overflow_mutex};
+      overflow_event_count += thread_buffer->overflow_event_count;
+    }
+    return overflow_event_count;
+  }
+
+ protected:
+  [[nodiscard]] size_t DequeueIntermediateEvents(IntermediateEventT* events,
+                                                 size_t max_count) final {
+    absl::MutexLock lock{&thread_buffers_mutex_};
+    // Only the events of exited threads that are already in the shared queue are dequeued: their
+    // threads released their buffers before enqueuing them, so these buffers are visited below.
+    size_t exited_thread_event_count;
+    {
+      absl::MutexLock exited_thread_events_lock{&exited_thread_events_mutex_};
+      exited_thread_event_count = exited_thread_events_.size();
+    }
+    RemoveEmptyBuffersOfExitedThreads();
+
+    // Start from a different buffer every time, so that a thread producing many events doesn't
+    // delay the events of the other threads.
+    size_t dequeued_event_count = 0;
+    const size_t thread_buffer_count = thread_buffers_.size();
+    for (size_t i = 0; i < thread_buffer_count && dequeued_event_count < max_count; ++i) {
+      ThreadBuffer& thread_buffer =
+          *thread_buffers_[(first_thread_buffer_index_ + i) % thread_buffer_count];
+      dequeued_event_count += DequeueThreadBufferEvents(
+          &thread_buffer, events + dequeued_event_count, max_count - dequeued_event_count);
+    }
+    ++first_thread_buffer_index_;
+
+    // The shared queue is only read once all the buffers have been emptied, including the ones
+    // released before the events in it were enqueued.
+    if (dequeued_event_count == max_count || exited_thread_event_count == 0) {
+      return dequeued_event_count;
+    }
+    absl::MutexLock exited_thread_events_lock{&exited_thread_events_mutex_};
+    while (dequeued_event_count < max_count && exited_thread_event_count > 0) {
+      events[dequeued_event_count] = std::move(exited_thread_events_.front());
+      exited_thread_events_.pop_front();
+      ++dequeued_event_count;
+      --exited_thread_event_count;
+    }
+    return dequeued_event_count;
+  }
+
+ private:
+  struct ThreadBuffer {
+    explicit ThreadBuffer(size_t capacity) : ring_buffer{capacity} {}
+    SpscRingBuffer<IntermediateEventT> ring_buffer;
+    // The number of events in `overflow_events`. Only the thread increases it, and only the
+    // forwarder thread decreases it, both while holding `overflow_mutex`.
+    std::atomic<uint64_t> pending_overflow_event_count = 0;
+    absl::Mutex overflow_mutex;
+    std::deque<IntermediateEventT> overflow_events ABSL_GUARDED_BY(overflow_mutex);
+    uint64_t overflow_event_count ABSL_GUARDED_BY(overflow_mutex) = 0;
+  };
+
+  [[nodiscard]] static size_t DequeueThreadBufferEvents(ThreadBuffer* thread_buffer,
+                                                        IntermediateEventT* events,
+                                                        size_t max_count) {
+    size_t dequeued_event_count = thread_buffer->ring_buffer.TryPopBulk(events, max_count);
+    if (dequeued_event_count == max_count ||
+        thread_buffer->pending_overflow_event_count.load(std::memory_order_relaxed) == 0) {
+      return dequeued_event_count;
+    }
+
+    absl::MutexLock lock{&thread_buffer->overflow_mutex};
+    // The events in the overflow queue are more recent than all the events in the ring buffer, and
+    // the thread doesn't push to the ring buffer while the overflow queue is not empty. Holding the
+    // mutex makes all the events pushed to the ring buffer before the overflow events visible.
+    dequeued_event_count += thread_buffer->ring_buffer.TryPopBulk(
+        events + dequeued_event_count, max_count - dequeued_event_count);
+    while (dequeued_event_count < max_count && !thread_buffer->overflow_events.empty()) {
+      events[dequeued_event_count] = std::move(thread_buffer->overflow_events.front());
+      thread_buffer->overflow_events.pop_front();
+      ++dequeued_event_count;
+    }
+    thread_buffer->pending_overflow_event_count.store(thread_buffer->overflow_events.size(),
+                                                      std::memory_order_relaxed);
+    return dequeued_event_count;
+  }
+
+  // Returns nullptr if the thread is exiting and has already released its buffer.
+  [[nodiscard]] ThreadBuffer* GetOrRegisterThreadBuffer() {
+    // Only the buffer for the last producer used by this thread is cached, as a thread normally
+    // uses a single producer. The raw pointer is trivially destructible, which makes accessing it
+    // cheaper than accessing the owning pointer.
+    thread_local uint64_t cached_producer_id = 0;
+    thread_local ThreadBuffer* cached_thread_buffer = nullptr;
+    thread_local bool thread_buffer_released = false;
+    if (ABSL_PREDICT_TRUE(cached_producer_id == producer_id_)) return cached_thread_buffer;
+    if (thread_buffer_released) return nullptr;
+
+    // The producer keeps the buffer until it has been emptied after the thread released it. The
+    // cache is cleared first, as the buffer can be freed from then on, while the destructors of
+    // other thread_local objects can still enqueue events.
+    struct OwnedThreadBuffer {
+      ~OwnedThreadBuffer() {
+        cached_producer_id = 0;
+        cached_thread_buffer = nullptr;
+        thread_buffer_released = true;
+      }
+      std::shared_ptr<ThreadBuffer> thread_buffer;
+    };
+    thread_local OwnedThreadBuffer owned_thread_buffer;
+    owned_thread_buffer.thread_buffer = std::make_shared<ThreadBuffer>(thread_buffer_capacity_);
+    cached_thread_buffer = owned_thread_buffer.thread_buffer.get();
+    cached_producer_id = producer_id_;
+    absl::MutexLock lock{&thread_buffers_mutex_};
+    thread_buffers_.push_back(owned_thread_buffer.thread_buffer);
+    return cached_thread_buffer;
+  }
+
+  void RemoveEmptyBuffersOfExitedThreads() ABSL_EXCLUSIVE_LOCKS_REQUIRED(thread_buffers_mutex_) {
+    auto is_buffer_in_use = [](const std::shared_ptr<ThreadBuffer>& thread_buffer) {
+      // If the producer holds the only reference, the thread has exited and can't push anymore.
+      // The fence synchronizes with the release of the reference by the thread, so that the last
+      // events pushed by the thread are visible.
+      if (thread_buffer.use_count() != 1) return true;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return !thread_buffer->ring_buffer.IsEmpty() ||
+             thread_buffer->pending_overflow_event_count.load(std::memory_order_relaxed) != 0;
+    };
+    // Contrary to std::remove_if, std::partition keeps the removed buffers valid until they are
+    // erased, so that their counts of overflow events can be accumulated.
+    auto removed_begin =
+        std::partition(thread_buffers_.begin(), thread_buffers_.end(), is_buffer_in_use);
+    for (auto it = removed_begin; it != thread_buffers_.end(); ++it) {
+      absl::MutexLock overflow_lock{&(*it)->overflow_mutex};
+      overflow_event_count_of_removed_buffers_ += (*it)->overflow_event_count;
+    }
+    thread_buffers_.erase(removed_begin, thread_buffers_.end());
+  }
+
+  // Distinguishes the producers in the per-thread cache of GetOrRegisterThreadBuffer. Contrary to
+  // the address of the producer, it is never reused.
+  inline static std::atomic<uint64_t> next_producer_id_ = 1;
+  const uint64_t producer_id_ = next_producer_id_.fetch_add(1, std::memory_order_relaxed);
+  const size_t thread_buffer_capacity_;
+
+  mutable absl::Mutex thread_buffers_mutex_;
+  std::vector<std::shared_ptr<ThreadBuffer>> thread_buffers_ ABSL_GUARDED_BY(thread_buffers_mutex_);
+  uint64_t overflow_event_count_of_removed_buffers_ ABSL_GUARDED_BY(thread_buffers_mutex_) = 0;
+
+  // Acquired after `thread_buffers_mutex_` when both are held.
+  absl::Mutex exited_thread_events_mutex_;
+  std::deque<IntermediateEventT> exited_thread_events_ ABSL_GUARDED_BY(exited_thread_events_mutex_);
+
+  // Only accessed by the forwarder thread.
+  size_t first_thread_buffer_index_ = 0;
+};
+
+}  // namespace orbit_capture_event_producer
+
+#endif  // CAPTURE_EVENT_PRODUCER_PER_THREAD_BUFFER_CAPTURE_EVENT_PRODUCER_H_
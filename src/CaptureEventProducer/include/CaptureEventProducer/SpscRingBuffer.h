@@ -0,0 +1,107 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_EVENT_PRODUCER_SPSC_RING_BUFFER_H_
+#define CAPTURE_EVENT_PRODUCER_SPSC_RING_BUFFER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_capture_event_producer {
+
+// A bounded, lock-free queue for exactly one producer thread and one consumer thread. Pushing never
+// allocates nor waits: if the buffer is full, TryPush fails and leaves the element to the caller.
+//
+// The indices written by the producer and by the consumer are on separate cache lines, and each
+// side keeps a copy of the last index it read from the other side, so that in the common case an
+// operation only touches the cache lines of the other side when the buffer appears full or empty.
+template <typename T>
+class SpscRingBuffer {
+  static_assert(std::is_nothrow_move_constructible_v<T>);
+
+ public:
+  // `capacity` must be a power of two.
+  explicit SpscRingBuffer(size_t capacity)
+      : capacity_{capacity},
+        slots_{static_cast<T*>(
+            ::operator new[](capacity * sizeof(T), std::align_val_t{alignof(T)}))} {
+    ORBIT_CHECK(capacity > 0 && (capacity & (capacity - 1)) == 0);
+  }
+
+  ~SpscRingBuffer() {
+    const uint64_t tail = tail_.load(std::memory_order_acquire);
+    for (uint64_t head = head_.load(std::memory_order_relaxed); head != tail; ++head) {
+      GetSlot(head)->~T();
+    }
+    ::operator delete[](slots_, std::align_val_t{alignof(T)});
+  }
+
+  SpscRingBuffer(const SpscRingBuffer&) = delete;
+  SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+  SpscRingBuffer(SpscRingBuffer&&) = delete;
+  SpscRingBuffer& operator=(SpscRingBuffer&&) = delete;
+
+  // Only to be called by the producer thread. Returns false, and leaves `element` untouched, if the
+  // buffer is full.
+  [[nodiscard]] bool TryPush(T&& element) {
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ == capacity_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ == capacity_) return false;
+    }
+    new (GetSlot(tail)) T(std::move(element));
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Only to be called by the consumer thread. Moves up to `max_count` elements, in the order in
+  // which they were pushed, to `output`, and returns their number.
+  template <typename OutputIt>
+  size_t TryPopBulk(OutputIt output, size_t max_count) {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    if (cached_tail_ - head < max_count) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+    }
+    const size_t count = std::min<uint64_t>(cached_tail_ - head, max_count);
+    for (size_t i = 0; i < count; ++i) {
+      T* slot = GetSlot(head + i);
+      *output = std::move(*slot);
+      ++output;
+      slot->~T();
+    }
+    head_.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+  // Only to be called by the consumer thread.
+  [[nodiscard]] bool IsEmpty() const {
+    return tail_.load(std::memory_order_acquire) == head_.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] size_t capacity() const { return capacity_; }
+
+ private:
+  [[nodiscard]] T* GetSlot(uint64_t index) const { return slots_ + (index & (capacity_ - 1)); }
+
+  const size_t capacity_;
+  T* const slots_;
+
+  // The indices only ever increase, and are reduced modulo the capacity to address the slots.
+  alignas(64) std::atomic<uint64_t> head_ = 0;
+  uint64_t cached_tail_ = 0;  // Only accessed by the consumer.
+  alignas(64) std::atomic<uint64_t> tail_ = 0;
+  uint64_t cached_head_ = 0;  // Only accessed by the producer.
+};
+
+}  // namespace orbit_capture_event_producer
+
+#endif  // CAPTURE_EVENT_PRODUCER_SPSC_RING_BUFFER_H_
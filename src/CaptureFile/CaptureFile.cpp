@@ -21,12 +21,14 @@
 #include "CaptureFile/CaptureFileSection.h"
 #include "CaptureFile/ProtoSectionInputStream.h"
 #include "CaptureFileConstants.h"
+#include "MemoryMappedFile.h"
 #include "OrbitBase/Align.h"
 #include "OrbitBase/File.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Result.h"
 #include "OrbitBase/SafeStrerror.h"
 #include "ProtoSectionInputStreamImpl.h"
+#include "TimestampIndex.h"
 
 #ifdef __linux
 #include <errno.h>
@@ -39,18 +41,49 @@ namespace orbit_capture_file {
 namespace {
 
 using orbit_base::UniqueFd;
+using orbit_capture_file_internal::MemoryMappedFile;
 
 constexpr uint64_t kMaxNumberOfSections = std::numeric_limits<uint16_t>::max();
 
 struct CaptureFileHeader {
   static constexpr uint64_t kSignatureSize = kFileSignature.size();
   static constexpr uint64_t kFileFormatVersionSize = sizeof(uint32_t);
+  uint32_t version;
   uint64_t capture_section_offset;
   uint64_t section_list_offset;
   static constexpr uint64_t kSectionListOffsetFieldOffset =
       kSignatureSize + kFileFormatVersionSize + sizeof(capture_section_offset);
 };
 
+// Returns the first `replayed_message_count` messages of `replayed_messages`, then all the messages
+// of `messages`.
+class ReplayingProtoSectionInputStream : public ProtoSectionInputStream {
+ public:
+  ReplayingProtoSectionInputStream(std::unique_ptr<ProtoSectionInputStream> replayed_messages,
+                                   uint64_t replayed_message_count,
+                                   std::unique_ptr<ProtoSectionInputStream> messages)
+      : replayed_messages_{std::move(replayed_messages)},
+        replayed_message_count_{replayed_message_count},
+        messages_{std::move(messages)} {}
+
+  ErrorMessageOr<void> ReadMessage(google::protobuf::Message* message) override {
+    if (replayed_message_count_ == 0) return messages_->ReadMessage(message);
+    --replayed_message_count_;
+    return replayed_messages_->ReadMessage(message);
+  }
+
+  ErrorMessageOr<uint32_t> ReadMessageBytes(std::string* message_bytes) override {
+    if (replayed_message_count_ == 0) return messages_->ReadMessageBytes(message_bytes);
+    --replayed_message_count_;
+    return replayed_messages_->ReadMessageBytes(message_bytes);
+  }
+
+ private:
+  std::unique_ptr<ProtoSectionInputStream> replayed_messages_;
+  uint64_t replayed_message_count_;
+  std::unique_ptr<ProtoSectionInputStream> messages_;
+};
+
 class CaptureFileImpl : public CaptureFile {
  public:
   explicit CaptureFileImpl(std::filesystem::path file_path) : file_path_{std::move(file_path)} {}
@@ -78,6 +111,9 @@ class CaptureFileImpl : public CaptureFile {
 
   std::unique_ptr<ProtoSectionInputStream> CreateCaptureSectionInputStream() override;
 
+  ErrorMessageOr<std::unique_ptr<ProtoSectionInputStream>>
+  CreateCaptureSectionInputStreamFromTimestamp(uint64_t timestamp_ns) override;
+
   [[nodiscard]] const std::filesystem::path& GetFilePath() const override;
 
   std::unique_ptr<ProtoSectionInputStream> CreateProtoSectionInputStream(
@@ -105,6 +141,17 @@ class CaptureFileImpl : public CaptureFile {
   // false it file does not contain a user data section. Returns an error if file contains more than
   // one user data section, or if the one user data section is not the last section.
   ErrorMessageOr<bool> ContainsValidUserDataSection() const;
+  std::unique_ptr<ProtoSectionInputStream> CreateCaptureSectionInputStreamAtOffset(
+      uint64_t offset_in_capture_section);
+  // Creates the stream over the mapped file if possible, and over the file descriptor otherwise.
+  std::unique_ptr<ProtoSectionInputStream> CreateInputStreamForFileRange(
+      uint64_t offset, uint64_t size,
+      orbit_capture_file_internal::ProtoSectionInputStreamImpl::SectionEncoding encoding);
+  // Returns a mapping of the whole file, which is created on first use, or nullptr if the file
+  // can't be mapped.
+  [[nodiscard]] std::shared_ptr<const MemoryMappedFile> GetOrCreateMapping();
+  // Resizes the file and drops the mapping, which doesn't cover the new size.
+  ErrorMessageOr<void> ResizeFile(uint64_t new_size);
 
   std::filesystem::path file_path_;
   UniqueFd fd_;
@@ -121,6 +168,10 @@ class CaptureFileImpl : public CaptureFile {
   // section. The section_list is ordered by section offset. Meaning a section with lower offset
   // will come before a section with higher offset.
   std::vector<CaptureFileSection> section_list_;
+
+  // Input streams over sections read from this mapping, so that the file content is not copied out
+  // of the page cache. Streams created before the mapping is replaced keep the old one alive.
+  std::shared_ptr<const MemoryMappedFile> mapping_;
 };
 
 ErrorMessageOr<uint64_t> GetEndOfFileOffset(const UniqueFd& fd) {
@@ -220,8 +271,9 @@ ErrorMessageOr<void> ValidateSignature(google::protobuf::io::CodedInputStream* c
   return outcome::success();
 }
 
-ErrorMessageOr<void> ValidateFileVersion(google::protobuf::io::CodedInputStream* coded_input,
-                                         google::protobuf::io::FileInputStream* raw_input) {
+ErrorMessageOr<uint32_t> ReadAndValidateFileVersion(
+    google::protobuf::io::CodedInputStream* coded_input,
+    google::protobuf::io::FileInputStream* raw_input) {
   uint32_t version{};
   if (!coded_input->ReadLittleEndian32(&version)) {
     return ErrorMessage{
@@ -229,12 +281,12 @@ ErrorMessageOr<void> ValidateFileVersion(google::protobuf::io::CodedInputStream*
                         SafeStrerror(raw_input->GetErrno()))};
   }
 
-  if (version != kFileVersion) {
-    return ErrorMessage{
-        absl::StrFormat("Incompatible version %d, expected %d", version, kFileVersion)};
+  if (version < kMinSupportedFileVersion || version > kMaxSupportedFileVersion) {
+    return ErrorMessage{absl::StrFormat("Incompatible version %d, expected %d to %d", version,
+                                        kMinSupportedFileVersion, kMaxSupportedFileVersion)};
   }
 
-  return outcome::success();
+  return version;
 }
 
 // Calculates how large (bytes) a section list (with `number_of_sections` sections) is when written
@@ -248,9 +300,10 @@ ErrorMessageOr<void> CaptureFileImpl::ReadHeader() {
   google::protobuf::io::CodedInputStream coded_input{&raw_input};
 
   OUTCOME_TRY(ValidateSignature(&coded_input, &raw_input));
-  OUTCOME_TRY(ValidateFileVersion(&coded_input, &raw_input));
+  OUTCOME_TRY(auto&& version, ReadAndValidateFileVersion(&coded_input, &raw_input));
 
   CaptureFileHeader header{};
+  header.version = version;
 
   if (!coded_input.ReadLittleEndian64(&header.capture_section_offset)) {
     return ErrorMessage{"Could not read the capture section's offset value"};
@@ -327,7 +380,7 @@ ErrorMessageOr<uint64_t> CaptureFileImpl::AddUserDataSection(uint64_t section_si
                                             /*.size = */ section_size});
 
   // Resize the file
-  OUTCOME_TRY(orbit_base::ResizeFile(file_path_, user_data_section_offset + section_size));
+  OUTCOME_TRY(ResizeFile(user_data_section_offset + section_size));
 
   OUTCOME_TRY(WriteSectionList(section_list, section_list_offset));
 
@@ -368,8 +421,93 @@ ErrorMessageOr<void> CaptureFileImpl::ReadFromSection(uint64_t section_number,
 }
 
 std::unique_ptr<ProtoSectionInputStream> CaptureFileImpl::CreateCaptureSectionInputStream() {
-  return std::make_unique<orbit_capture_file_internal::ProtoSectionInputStreamImpl>(
-      fd_, header_.capture_section_offset, capture_section_size_);
+  return CreateCaptureSectionInputStreamAtOffset(0);
+}
+
+std::unique_ptr<ProtoSectionInputStream> CaptureFileImpl::CreateCaptureSectionInputStreamAtOffset(
+    uint64_t offset_in_capture_section) {
+  using orbit_capture_file_internal::ProtoSectionInputStreamImpl;
+  ORBIT_CHECK(offset_in_capture_section < capture_section_size_);
+  const ProtoSectionInputStreamImpl::SectionEncoding encoding =
+      header_.version == kFileVersionChunkedCaptureSection
+          ? ProtoSectionInputStreamImpl::SectionEncoding::kCompressedChunks
+          : ProtoSectionInputStreamImpl::SectionEncoding::kPlain;
+  return CreateInputStreamForFileRange(header_.capture_section_offset + offset_in_capture_section,
+                                       capture_section_size_ - offset_in_capture_section, encoding);
+}
+
+std::unique_ptr<ProtoSectionInputStream> CaptureFileImpl::CreateInputStreamForFileRange(
+    uint64_t offset, uint64_t size,
+    orbit_capture_file_internal::ProtoSectionInputStreamImpl::SectionEncoding encoding) {
+  using orbit_capture_file_internal::ProtoSectionInputStreamImpl;
+  std::shared_ptr<const MemoryMappedFile> mapping = GetOrCreateMapping();
+  if (mapping != nullptr) {
+    return std::make_unique<ProtoSectionInputStreamImpl>(std::move(mapping), offset, size,
+                                                         encoding);
+  }
+  return std::make_unique<ProtoSectionInputStreamImpl>(fd_, offset, size, encoding);
+}
+
+std::shared_ptr<const MemoryMappedFile> CaptureFileImpl::GetOrCreateMapping() {
+  if (mapping_ != nullptr) return mapping_;
+
+  ErrorMessageOr<uint64_t> file_size = GetEndOfFileOffset(fd_);
+  if (file_size.has_error()) {
+    ORBIT_ERROR("Unable to get the size of \"%s\": %s", file_path_.string(),
+                file_size.error().message());
+    return nullptr;
+  }
+  ErrorMessageOr<std::shared_ptr<const MemoryMappedFile>> mapping =
+      MemoryMappedFile::Create(fd_, file_size.value());
+  if (mapping.has_error()) {
+    ORBIT_ERROR("Reading \"%s\" without memory mapping: %s", file_path_.string(),
+                mapping.error().message());
+    return nullptr;
+  }
+  mapping_ = std::move(mapping.value());
+  return mapping_;
+}
+
+ErrorMessageOr<void> CaptureFileImpl::ResizeFile(uint64_t new_size) {
+  mapping_.reset();
+  return orbit_base::ResizeFile(file_path_, new_size);
+}
+
+ErrorMessageOr<std::unique_ptr<ProtoSectionInputStream>>
+CaptureFileImpl::CreateCaptureSectionInputStreamFromTimestamp(uint64_t timestamp_ns) {
+  using orbit_capture_file_internal::TimestampIndexCheckpoint;
+  std::optional<uint64_t> section_number = FindSectionByType(kSectionTypeTimestampIndex);
+  if (!section_number.has_value()) {
+    return CreateCaptureSectionInputStream();
+  }
+
+  std::string section_content(section_list_[section_number.value()].size, '\0');
+  OUTCOME_TRY(ReadFromSection(section_number.value(), 0, section_content.data(),
+                              section_content.size()));
+  OUTCOME_TRY(auto&& checkpoints, orbit_capture_file_internal::ParseTimestampIndex(
+                                      section_content, capture_section_size_));
+
+  std::optional<TimestampIndexCheckpoint> checkpoint =
+      orbit_capture_file_internal::FindCheckpointBefore(checkpoints, timestamp_ns);
+  if (!checkpoint.has_value()) {
+    return CreateCaptureSectionInputStream();
+  }
+  std::unique_ptr<ProtoSectionInputStream> capture_section_input_stream =
+      CreateCaptureSectionInputStreamAtOffset(checkpoint->offset_in_capture_section);
+  if (checkpoint->seek_context_event_count_before == 0) {
+    return capture_section_input_stream;
+  }
+
+  // The events that the skipped events have in common with the following ones, like
+  // CaptureStarted and the interned strings, are replayed from the SEEK_CONTEXT section.
+  std::optional<uint64_t> seek_context_section_number =
+      FindSectionByType(kSectionTypeSeekContext);
+  if (!seek_context_section_number.has_value()) {
+    return ErrorMessage{"Capture file has a timestamp index but no seek context section"};
+  }
+  return std::make_unique<ReplayingProtoSectionInputStream>(
+      CreateProtoSectionInputStream(seek_context_section_number.value()),
+      checkpoint->seek_context_event_count_before, std::move(capture_section_input_stream));
 }
 
 std::unique_ptr<ProtoSectionInputStream> CaptureFileImpl::CreateProtoSectionInputStream(
@@ -377,8 +515,9 @@ std::unique_ptr<ProtoSectionInputStream> CaptureFileImpl::CreateProtoSectionInpu
   ORBIT_CHECK(section_number < section_list_.size());
   const auto& section_info = section_list_[section_number];
 
-  return std::make_unique<orbit_capture_file_internal::ProtoSectionInputStreamImpl>(
-      fd_, section_info.offset, section_info.size);
+  return CreateInputStreamForFileRange(
+      section_info.offset, section_info.size,
+      orbit_capture_file_internal::ProtoSectionInputStreamImpl::SectionEncoding::kPlain);
 }
 
 std::optional<uint64_t> CaptureFileImpl::FindSectionByType(uint64_t section_type) const {
@@ -437,8 +576,8 @@ ErrorMessageOr<void> orbit_capture_file::CaptureFileImpl::ExtendSection(uint64_t
   section_list[section_number].size = new_size;
 
   // We checked that this is the last section so the new file size is the section offset + size
-  OUTCOME_TRY(orbit_base::ResizeFile(
-      file_path_, section_list[section_number].offset + section_list[section_number].size));
+  OUTCOME_TRY(ResizeFile(
+      section_list[section_number].offset + section_list[section_number].size));
   OUTCOME_TRY(WriteSectionList(section_list, header_.section_list_offset));
 
   section_list_ = section_list;
@@ -562,7 +701,7 @@ ErrorMessageOr<uint64_t> CaptureFileImpl::AddAdditionalSectionOfType(uint64_t ne
   // 3. Resize file to make space for the new_section_list.
   const uint64_t new_section_list_end =
       new_section_list_offset + CalculateSectionListSizeInFile(new_section_list.size());
-  OUTCOME_TRY(orbit_base::ResizeFile(file_path_, new_section_list_end));
+  OUTCOME_TRY(ResizeFile(new_section_list_end));
 
   // 3.3 If a user data section exists, copy behind the new section list.
   if (FindSectionByType(kSectionTypeUserData).has_value()) {
@@ -572,7 +711,7 @@ ErrorMessageOr<uint64_t> CaptureFileImpl::AddAdditionalSectionOfType(uint64_t ne
 
     const uint64_t new_user_data_section_end =
         new_user_data_section_offset + user_data_section.size;
-    OUTCOME_TRY(orbit_base::ResizeFile(file_path_, new_user_data_section_end));
+    OUTCOME_TRY(ResizeFile(new_user_data_section_end));
 
     std::vector<char> bytes(user_data_section.size);
     OUTCOME_TRY(orbit_base::ReadFullyAtOffset(fd_, bytes.data(), user_data_section.size,
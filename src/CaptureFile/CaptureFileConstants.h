@@ -16,6 +16,12 @@
 constexpr std::string_view kFileSignature = "ORBT";
 static_assert(kFileSignature.size() == 4);
 
-constexpr uint32_t kFileVersion = 1;
+// Version 1 stores the capture section as a plain sequence of messages. Version 2 stores it as a
+// sequence of chunks, each of which can be compressed. Both versions can be read, and version 1 is
+// still written when no compression is requested. See FORMAT.md.
+constexpr uint32_t kFileVersionUncompressedCaptureSection = 1;
+constexpr uint32_t kFileVersionChunkedCaptureSection = 2;
+constexpr uint32_t kMinSupportedFileVersion = kFileVersionUncompressedCaptureSection;
+constexpr uint32_t kMaxSupportedFileVersion = kFileVersionChunkedCaptureSection;
 
 #endif  // CAPTURE_FILE_CONSTANTS_H_
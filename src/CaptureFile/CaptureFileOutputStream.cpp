@@ -14,27 +14,52 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include <algorithm>
 #include <optional>
 #include <string>
 #include <string_view>
 #include <utility>
+#include <vector>
 
 #include "CaptureFile/BufferOutputStream.h"
+#include "CaptureFile/CaptureFile.h"
+#include "CaptureFile/CaptureFileSection.h"
 #include "CaptureFileConstants.h"
+#include "ChunkCompression.h"
 #include "OrbitBase/File.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/SafeStrerror.h"
+#include "TimestampIndex.h"
 
 namespace orbit_capture_file {
 
 namespace {
 
+using orbit_capture_file_internal::CaptureSectionChunkHeader;
+using orbit_capture_file_internal::ChunkCompressor;
+using orbit_capture_file_internal::kTargetChunkUncompressedSize;
+using orbit_capture_file_internal::TimestampIndexBuilder;
+
+// signature - 4bytes, version - 4bytes
+// capture section offset - 8 bytes
+// additional section offset - 8 bytes
+constexpr uint64_t kCaptureSectionOffset =
+    kFileSignature.size() + sizeof(uint32_t) + 2 * sizeof(uint64_t);
+
+// The seek context is moved from memory to a temporary file when it reaches this size, and copied
+// to its section in pieces of this size.
+constexpr size_t kSeekContextBufferSize = 1024 * 1024;  // 1Mb
+
 class CaptureFileOutputStreamImpl final : public CaptureFileOutputStream {
  public:
-  explicit CaptureFileOutputStreamImpl(std::filesystem::path path)
-      : output_type_(OutputType::kFile), path_{std::move(path)} {}
-  explicit CaptureFileOutputStreamImpl(BufferOutputStream* output_buffer)
-      : output_type_(OutputType::kBuffer), output_buffer_(output_buffer) {}
+  explicit CaptureFileOutputStreamImpl(std::filesystem::path path,
+                                       CaptureSectionCompression compression)
+      : output_type_(OutputType::kFile), path_{std::move(path)}, compression_{compression} {}
+  explicit CaptureFileOutputStreamImpl(BufferOutputStream* output_buffer,
+                                       CaptureSectionCompression compression)
+      : output_type_(OutputType::kBuffer),
+        output_buffer_(output_buffer),
+        compression_{compression} {}
   ~CaptureFileOutputStreamImpl() override;
 
   [[nodiscard]] ErrorMessageOr<void> Initialize();
@@ -46,6 +71,21 @@ class CaptureFileOutputStreamImpl final : public CaptureFileOutputStream {
  private:
   void Reset();
   [[nodiscard]] ErrorMessageOr<void> WriteHeader();
+  // Compresses the messages accumulated in `pending_chunk_` and writes them as one chunk.
+  [[nodiscard]] ErrorMessageOr<void> FlushPendingChunk();
+  // Adds `event` to the timestamp index, and moves the seek context to the temporary file when
+  // there is enough of it. The index is only written to files.
+  void AddEventToTimestampIndex(const orbit_grpc_protos::ClientCaptureEvent& event);
+  [[nodiscard]] ErrorMessageOr<void> WriteSeekContextToTemporaryFile();
+  void RemoveSeekContextTemporaryFile();
+  // Adds the SEEK_CONTEXT and TIMESTAMP_INDEX sections to the file, once the capture section has
+  // been written. The index is optional, so the capture file is kept without it if this fails.
+  void WriteTimestampIndexSections();
+  [[nodiscard]] ErrorMessageOr<void> CopySeekContextTemporaryFileToSection(
+      CaptureFile* capture_file, uint64_t section_number);
+  [[nodiscard]] uint64_t GetOffsetInCaptureSection() const {
+    return coded_output_->ByteCount() - kCaptureSectionOffset;
+  }
   [[nodiscard]] std::string_view GetErrorFromOutputStream() const;
   // Handles write error by cleaning up the file and generating error message.
   [[nodiscard]] ErrorMessage HandleWriteError(const char* section_name,
@@ -61,12 +101,32 @@ class CaptureFileOutputStreamImpl final : public CaptureFileOutputStream {
   BufferOutputStream* output_buffer_ = nullptr;
   std::unique_ptr<google::protobuf::io::ZeroCopyOutputStream> zero_copy_output_stream_;
   std::optional<google::protobuf::io::CodedOutputStream> coded_output_;
+
+  // Only used when the capture section is compressed, i.e., written in chunks.
+  CaptureSectionCompression compression_;
+  std::optional<ChunkCompressor> chunk_compressor_;
+  std::vector<uint8_t> pending_chunk_;
+  std::vector<uint8_t> compressed_chunk_;
+
+  TimestampIndexBuilder timestamp_index_builder_;
+  // Set when the timestamp index can't be written, as the capture is still saved without it.
+  bool timestamp_index_failed_ = false;
+  // The beginning of the SEEK_CONTEXT section, which for long captures doesn't fit in memory. The
+  // file is only created when needed.
+  std::filesystem::path seek_context_temporary_file_path_;
+  orbit_base::UniqueFd seek_context_temporary_file_fd_;
+  uint64_t seek_context_temporary_file_size_ = 0;
 };
 
 CaptureFileOutputStreamImpl::~CaptureFileOutputStreamImpl() {
   // The destructor is not default to make sure close for streams and the file are called in
   // the correct order.
+  if (coded_output_.has_value() && !pending_chunk_.empty()) {
+    // There is nothing we can do about an error here, and the file is removed in that case.
+    (void)FlushPendingChunk();
+  }
   Reset();
+  RemoveSeekContextTemporaryFile();
 }
 
 ErrorMessageOr<void> CaptureFileOutputStreamImpl::Initialize() {
@@ -93,6 +153,11 @@ ErrorMessageOr<void> CaptureFileOutputStreamImpl::Initialize() {
 
   coded_output_.emplace(zero_copy_output_stream_.get());
 
+  if (compression_ != CaptureSectionCompression::kNone) {
+    chunk_compressor_.emplace(compression_);
+    pending_chunk_.reserve(kTargetChunkUncompressedSize);
+  }
+
   if (auto result = WriteHeader(); result.has_error()) {
     return result.error();
   }
@@ -101,12 +166,21 @@ ErrorMessageOr<void> CaptureFileOutputStreamImpl::Initialize() {
 }
 
 ErrorMessageOr<void> CaptureFileOutputStreamImpl::Close() {
+  OUTCOME_TRY(FlushPendingChunk());
   coded_output_->Trim();
   if (coded_output_->HadError()) {
     return HandleWriteError("Unknown", GetErrorFromOutputStream());
   }
   Reset();
 
+  // The index is only useful to seek in files. It is added as an additional section, which requires
+  // to know the size of the capture section.
+  if (output_type_ == OutputType::kFile && !timestamp_index_failed_ &&
+      !timestamp_index_builder_.GetCheckpoints().empty()) {
+    WriteTimestampIndexSections();
+  }
+  RemoveSeekContextTemporaryFile();
+
   return outcome::success();
 }
 
@@ -133,6 +207,7 @@ bool CaptureFileOutputStreamImpl::IsOpen() {
 
 void CaptureFileOutputStreamImpl::CloseAndTryRemoveFileAfterError() {
   Reset();
+  RemoveSeekContextTemporaryFile();
 
   if (output_type_ == OutputType::kFile && remove(path_.string().c_str()) == -1) {
     ORBIT_ERROR("Unable to remove \"%s\": %s", path_.string(), SafeStrerror(errno));
@@ -163,24 +238,170 @@ ErrorMessageOr<void> CaptureFileOutputStreamImpl::WriteCaptureEvent(
   ORBIT_CHECK(zero_copy_output_stream_ != nullptr);
 
   uint32_t event_size = event.ByteSizeLong();
-  coded_output_->WriteVarint32(event_size);
-  if (!event.SerializeToCodedStream(&coded_output_.value()) || coded_output_->HadError()) {
+  if (compression_ == CaptureSectionCompression::kNone) {
+    timestamp_index_builder_.AddCheckpointIfDue(GetOffsetInCaptureSection());
+    AddEventToTimestampIndex(event);
+    coded_output_->WriteVarint32(event_size);
+    if (!event.SerializeToCodedStream(&coded_output_.value()) || coded_output_->HadError()) {
+      return HandleWriteError("Capture", GetErrorFromOutputStream());
+    }
+    return outcome::success();
+  }
+
+  // Messages never span chunks, so that each chunk can be parsed on its own.
+  const size_t size_with_prefix =
+      google::protobuf::io::CodedOutputStream::VarintSize32(event_size) + event_size;
+  if (!pending_chunk_.empty() &&
+      pending_chunk_.size() + size_with_prefix > kTargetChunkUncompressedSize) {
+    OUTCOME_TRY(FlushPendingChunk());
+  }
+  // Reading can only start at the beginning of a chunk.
+  if (pending_chunk_.empty()) {
+    timestamp_index_builder_.AddCheckpoint(GetOffsetInCaptureSection());
+  }
+  AddEventToTimestampIndex(event);
+
+  const size_t offset_in_chunk = pending_chunk_.size();
+  pending_chunk_.resize(offset_in_chunk + size_with_prefix);
+  uint8_t* target = google::protobuf::io::CodedOutputStream::WriteVarint32ToArray(
+      event_size, pending_chunk_.data() + offset_in_chunk);
+  event.SerializeWithCachedSizesToArray(target);
+
+  return outcome::success();
+}
+
+ErrorMessageOr<void> CaptureFileOutputStreamImpl::FlushPendingChunk() {
+  if (pending_chunk_.empty()) return outcome::success();
+  ORBIT_CHECK(chunk_compressor_.has_value());
+
+  auto compress_result = chunk_compressor_->Compress(pending_chunk_, &compressed_chunk_);
+  if (compress_result.has_error()) {
+    return HandleWriteError("Capture", compress_result.error().message());
+  }
+
+  CaptureSectionChunkHeader header{
+      .compression = static_cast<uint32_t>(compression_),
+      .compressed_size = static_cast<uint32_t>(compressed_chunk_.size()),
+      .uncompressed_size = static_cast<uint32_t>(pending_chunk_.size()),
+  };
+  const std::vector<uint8_t>* chunk_data = &compressed_chunk_;
+  // Incompressible data is stored as is, rather than growing.
+  if (compressed_chunk_.size() >= pending_chunk_.size()) {
+    header.compression = static_cast<uint32_t>(CaptureSectionCompression::kNone);
+    header.compressed_size = header.uncompressed_size;
+    chunk_data = &pending_chunk_;
+  }
+
+  coded_output_->WriteRaw(&header, sizeof(header));
+  coded_output_->WriteRaw(chunk_data->data(), static_cast<int>(chunk_data->size()));
+  pending_chunk_.clear();
+  if (coded_output_->HadError()) {
     return HandleWriteError("Capture", GetErrorFromOutputStream());
   }
 
   return outcome::success();
 }
 
+void CaptureFileOutputStreamImpl::AddEventToTimestampIndex(
+    const orbit_grpc_protos::ClientCaptureEvent& event) {
+  if (output_type_ != OutputType::kFile || timestamp_index_failed_) return;
+  timestamp_index_builder_.AddEvent(event);
+  if (timestamp_index_builder_.GetPendingSeekContextSize() < kSeekContextBufferSize) return;
+
+  if (auto result = WriteSeekContextToTemporaryFile(); result.has_error()) {
+    ORBIT_ERROR("Unable to write the seek context of \"%s\", the timestamp index is omitted: %s",
+                path_.string(), result.error().message());
+    timestamp_index_failed_ = true;
+    RemoveSeekContextTemporaryFile();
+  }
+}
+
+ErrorMessageOr<void> CaptureFileOutputStreamImpl::WriteSeekContextToTemporaryFile() {
+  if (!seek_context_temporary_file_fd_.valid()) {
+    seek_context_temporary_file_path_ = path_;
+    seek_context_temporary_file_path_ += ".seek_context";
+    // A file left over by a crash would otherwise prevent creating the new one.
+    OUTCOME_TRY(orbit_base::RemoveFile(seek_context_temporary_file_path_));
+    OUTCOME_TRY(auto&& fd, orbit_base::OpenNewFileForReadWrite(seek_context_temporary_file_path_));
+    seek_context_temporary_file_fd_ = std::move(fd);
+  }
+  const std::string seek_context = timestamp_index_builder_.TakeSeekContext();
+  OUTCOME_TRY(orbit_base::WriteFully(seek_context_temporary_file_fd_, seek_context));
+  seek_context_temporary_file_size_ += seek_context.size();
+  return outcome::success();
+}
+
+void CaptureFileOutputStreamImpl::RemoveSeekContextTemporaryFile() {
+  if (seek_context_temporary_file_path_.empty()) return;
+  seek_context_temporary_file_fd_.release();
+  if (auto result = orbit_base::RemoveFile(seek_context_temporary_file_path_); result.has_error()) {
+    ORBIT_ERROR("Unable to remove \"%s\": %s", seek_context_temporary_file_path_.string(),
+                result.error().message());
+  }
+  seek_context_temporary_file_path_.clear();
+  seek_context_temporary_file_size_ = 0;
+}
+
+void CaptureFileOutputStreamImpl::WriteTimestampIndexSections() {
+  const std::string seek_context_end = timestamp_index_builder_.TakeSeekContext();
+  const uint64_t seek_context_size = seek_context_temporary_file_size_ + seek_context_end.size();
+  const std::string index_content = orbit_capture_file_internal::SerializeTimestampIndex(
+      timestamp_index_builder_.GetCheckpoints());
+
+  ErrorMessageOr<void> result = [&]() -> ErrorMessageOr<void> {
+    OUTCOME_TRY(auto&& capture_file, CaptureFile::OpenForReadWrite(path_));
+    // The seek context is written first, so that a file with an index always has it too.
+    if (seek_context_size > 0) {
+      OUTCOME_TRY(auto&& seek_context_section_number,
+                  capture_file->AddAdditionalSectionOfType(kSectionTypeSeekContext,
+                                                           seek_context_size));
+      OUTCOME_TRY(
+          CopySeekContextTemporaryFileToSection(capture_file.get(), seek_context_section_number));
+      OUTCOME_TRY(capture_file->WriteToSection(seek_context_section_number,
+                                               seek_context_temporary_file_size_,
+                                               seek_context_end.data(), seek_context_end.size()));
+    }
+    OUTCOME_TRY(auto&& index_section_number, capture_file->AddAdditionalSectionOfType(
+                                                 kSectionTypeTimestampIndex, index_content.size()));
+    return capture_file->WriteToSection(index_section_number, 0, index_content.data(),
+                                        index_content.size());
+  }();
+  if (result.has_error()) {
+    ORBIT_ERROR("Unable to write \"TimestampIndex\" section to \"%s\": %s", path_.string(),
+                result.error().message());
+  }
+}
+
+ErrorMessageOr<void> CaptureFileOutputStreamImpl::CopySeekContextTemporaryFileToSection(
+    CaptureFile* capture_file, uint64_t section_number) {
+  if (seek_context_temporary_file_size_ == 0) return outcome::success();
+  std::vector<char> buffer(kSeekContextBufferSize);
+  uint64_t offset = 0;
+  while (offset < seek_context_temporary_file_size_) {
+    const size_t size_to_read =
+        std::min<uint64_t>(buffer.size(), seek_context_temporary_file_size_ - offset);
+    OUTCOME_TRY(const size_t size_read,
+                orbit_base::ReadFullyAtOffset(seek_context_temporary_file_fd_, buffer.data(),
+                                              size_to_read, static_cast<int64_t>(offset)));
+    if (size_read < size_to_read) {
+      return ErrorMessage{absl::StrFormat("Temporary file \"%s\" is truncated",
+                                          seek_context_temporary_file_path_.string())};
+    }
+    OUTCOME_TRY(capture_file->WriteToSection(section_number, offset, buffer.data(), size_read));
+    offset += size_read;
+  }
+  return outcome::success();
+}
+
 ErrorMessageOr<void> CaptureFileOutputStreamImpl::WriteHeader() {
   ORBIT_CHECK(coded_output_.has_value());
 
+  const uint32_t version = compression_ == CaptureSectionCompression::kNone
+                               ? kFileVersionUncompressedCaptureSection
+                               : kFileVersionChunkedCaptureSection;
   std::string header{kFileSignature};
-  header.append(std::string_view(absl::bit_cast<char*>(&kFileVersion), sizeof(kFileVersion)));
-  // signature - 4bytes, version - 4bytes
-  // capture section offset - 8 bytes
-  // additional section offset - 8 bytes
-  uint64_t capture_section_offset =
-      kFileSignature.size() + sizeof(kFileVersion) + 2 * sizeof(uint64_t);
+  header.append(std::string_view(absl::bit_cast<const char*>(&version), sizeof(version)));
+  uint64_t capture_section_offset = kCaptureSectionOffset;
   header.append(std::string_view(absl::bit_cast<char*>(&capture_section_offset),
                                  sizeof(capture_section_offset)));
   uint64_t additional_section_list_offset =
@@ -201,8 +422,9 @@ ErrorMessageOr<void> CaptureFileOutputStreamImpl::WriteHeader() {
 }  // namespace
 
 ErrorMessageOr<std::unique_ptr<CaptureFileOutputStream>> CaptureFileOutputStream::Create(
-    std::filesystem::path path) {
-  auto implementation = std::make_unique<CaptureFileOutputStreamImpl>(std::move(path));
+    std::filesystem::path path, CaptureSectionCompression compression) {
+  auto implementation =
+      std::make_unique<CaptureFileOutputStreamImpl>(std::move(path), compression);
   auto init_result = implementation->Initialize();
   if (init_result.has_error()) {
     return init_result.error();
@@ -212,8 +434,8 @@ ErrorMessageOr<std::unique_ptr<CaptureFileOutputStream>> CaptureFileOutputStream
 }
 
 std::unique_ptr<CaptureFileOutputStream> CaptureFileOutputStream::Create(
-    BufferOutputStream* output_buffer) {
-  auto implementation = std::make_unique<CaptureFileOutputStreamImpl>(output_buffer);
+    BufferOutputStream* output_buffer, CaptureSectionCompression compression) {
+  auto implementation = std::make_unique<CaptureFileOutputStreamImpl>(output_buffer, compression);
   auto init_result = implementation->Initialize();
   ORBIT_CHECK(!init_result.has_error());
 
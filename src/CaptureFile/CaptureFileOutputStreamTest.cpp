@@ -2,6 +2,7 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <absl/types/span.h>
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 #include <gtest/gtest.h>
@@ -19,6 +20,7 @@
 #include "CaptureFile/BufferOutputStream.h"
 #include "CaptureFile/CaptureFileOutputStream.h"
 #include "CaptureFileConstants.h"
+#include "ChunkCompression.h"
 #include "GrpcProtos/capture.pb.h"
 #include "OrbitBase/ReadFileToString.h"
 #include "OrbitBase/Result.h"
@@ -59,6 +61,9 @@ TEST(CaptureFileOutputStream, Smoke) {
   auto check_output_stream_content = [&](std::string_view stream_content) {
     ASSERT_GT(stream_content.size(), 24);
     ASSERT_EQ(stream_content.substr(0, 4), kFileSignature);
+    uint32_t version = 0;
+    memcpy(&version, stream_content.data() + 4, sizeof(version));
+    EXPECT_EQ(version, kFileVersionUncompressedCaptureSection);
     uint64_t capture_section_offset = 0;
     memcpy(&capture_section_offset, stream_content.data() + 8, sizeof(capture_section_offset));
     ASSERT_EQ(capture_section_offset, 24);
@@ -127,6 +132,68 @@ TEST(CaptureFileOutputStream, Smoke) {
   }
 }
 
+TEST(CaptureFileOutputStream, CompressedCaptureSection) {
+  orbit_grpc_protos::ClientCaptureEvent event1 =
+      CreateInternedStringCaptureEvent(kAnswerKey, kAnswerString);
+  orbit_grpc_protos::ClientCaptureEvent event2 =
+      CreateInternedStringCaptureEvent(kNotAnAnswerKey, kNotAnAnswerString);
+
+  for (CaptureSectionCompression compression :
+       {CaptureSectionCompression::kZstd, CaptureSectionCompression::kLz4}) {
+    BufferOutputStream output_buffer;
+    std::unique_ptr<CaptureFileOutputStream> output_stream =
+        CaptureFileOutputStream::Create(&output_buffer, compression);
+    // Repeat the events so that the chunk is compressible.
+    constexpr int kRepetitions = 100;
+    for (int i = 0; i < kRepetitions; ++i) {
+      auto write_result = output_stream->WriteCaptureEvent(event1);
+      ASSERT_FALSE(write_result.has_error()) << write_result.error().message();
+      write_result = output_stream->WriteCaptureEvent(event2);
+      ASSERT_FALSE(write_result.has_error()) << write_result.error().message();
+    }
+    auto close_result = output_stream->Close();
+    ASSERT_FALSE(close_result.has_error()) << close_result.error().message();
+
+    std::vector<unsigned char> stream_content = output_buffer.TakeBuffer();
+    constexpr uint64_t kCaptureSectionOffset = 24;
+    orbit_capture_file_internal::CaptureSectionChunkHeader chunk_header{};
+    ASSERT_GT(stream_content.size(), kCaptureSectionOffset + sizeof(chunk_header));
+    uint32_t version = 0;
+    memcpy(&version, stream_content.data() + 4, sizeof(version));
+    EXPECT_EQ(version, kFileVersionChunkedCaptureSection);
+
+    // All the events fit in a single chunk.
+    memcpy(&chunk_header, stream_content.data() + kCaptureSectionOffset, sizeof(chunk_header));
+    EXPECT_EQ(chunk_header.compression, static_cast<uint32_t>(compression));
+    const size_t chunk_data_offset = kCaptureSectionOffset + sizeof(chunk_header);
+    ASSERT_EQ(stream_content.size(), chunk_data_offset + chunk_header.compressed_size);
+    EXPECT_EQ(chunk_header.uncompressed_size,
+              kRepetitions * (event1.ByteSizeLong() + event2.ByteSizeLong() + 2));
+    EXPECT_LT(chunk_header.compressed_size, chunk_header.uncompressed_size);
+
+    std::vector<uint8_t> chunk(chunk_header.uncompressed_size);
+    orbit_capture_file_internal::ChunkDecompressor decompressor;
+    auto decompress_result = decompressor.Decompress(
+        compression,
+        absl::MakeConstSpan(stream_content.data() + chunk_data_offset,
+                            chunk_header.compressed_size),
+        absl::MakeSpan(chunk));
+    ASSERT_FALSE(decompress_result.has_error()) << decompress_result.error().message();
+
+    google::protobuf::io::ArrayInputStream input_stream(chunk.data(),
+                                                        static_cast<int>(chunk.size()));
+    google::protobuf::io::CodedInputStream coded_input_stream(&input_stream);
+    uint32_t event_size = 0;
+    ASSERT_TRUE(coded_input_stream.ReadVarint32(&event_size));
+    std::vector<uint8_t> buffer(event_size);
+    ASSERT_TRUE(coded_input_stream.ReadRaw(buffer.data(), buffer.size()));
+    orbit_grpc_protos::ClientCaptureEvent event_from_file;
+    ASSERT_TRUE(event_from_file.ParseFromArray(buffer.data(), buffer.size()));
+    EXPECT_EQ(event_from_file.interned_string().key(), kAnswerKey);
+    EXPECT_EQ(event_from_file.interned_string().intern(), kAnswerString);
+  }
+}
+
 TEST(CaptureFileOutputStream, WriteAfterClose) {
   auto check_write_after_close = [&](CaptureFileOutputStream* output_stream) {
     EXPECT_TRUE(output_stream->IsOpen());
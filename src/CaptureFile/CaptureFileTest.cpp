@@ -3,12 +3,14 @@
 // found in the LICENSE file.
 
 #include <absl/base/casts.h>
+#include <absl/strings/str_format.h>
 #include <gmock/gmock.h>
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 #include <gtest/gtest.h>
 #include <stddef.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <filesystem>
 #include <memory>
@@ -191,6 +193,37 @@ TEST_F(CaptureFileTest, CreateCaptureFileAndReadMainSection) {
   VerifyCaptureSectionContent(capture_section);
 }
 
+TEST_F(CaptureFileTest, CreateCaptureFileAndReadMainSectionAsBytes) {
+  const std::string serialized_event_1 =
+      CreateInternedStringCaptureEvent(kAnswerKey, kAnswerString).SerializeAsString();
+  const std::string serialized_event_2 =
+      CreateInternedStringCaptureEvent(kNotAnAnswerKey, kNotAnAnswerString).SerializeAsString();
+
+  auto capture_section = capture_file_->CreateCaptureSectionInputStream();
+  std::string message_bytes = "prefix";
+  ErrorMessageOr<uint32_t> first_message_size = capture_section->ReadMessageBytes(&message_bytes);
+  ASSERT_THAT(first_message_size, HasNoError());
+  EXPECT_EQ(first_message_size.value(), serialized_event_1.size());
+  ErrorMessageOr<uint32_t> second_message_size = capture_section->ReadMessageBytes(&message_bytes);
+  ASSERT_THAT(second_message_size, HasNoError());
+  EXPECT_EQ(second_message_size.value(), serialized_event_2.size());
+  EXPECT_EQ(message_bytes, "prefix" + serialized_event_1 + serialized_event_2);
+}
+
+TEST_F(CaptureFileTest, InputStreamRemainsValidWhenFileIsResized) {
+  auto capture_section = capture_file_->CreateCaptureSectionInputStream();
+  ClientCaptureEvent event;
+  ASSERT_THAT(capture_section->ReadMessage(&event), HasNoError());
+  VerifyEventEquals(event, CreateInternedStringCaptureEvent(kAnswerKey, kAnswerString));
+
+  // Growing the file replaces the mapping that the capture section is read from.
+  ASSERT_THAT(capture_file_->AddUserDataSection(1024 * 1024), HasNoError());
+  ASSERT_THAT(capture_section->ReadMessage(&event), HasNoError());
+  VerifyEventEquals(event, CreateInternedStringCaptureEvent(kNotAnAnswerKey, kNotAnAnswerString));
+
+  VerifyCaptureSectionContent(capture_file_->CreateCaptureSectionInputStream());
+}
+
 TEST_F(CaptureFileTest, CreateCaptureFileWriteAdditionalSectionAndReadMainSection) {
   constexpr size_t kUserDataSectionSize = 333;
   auto section_number_or_error = capture_file_->AddUserDataSection(kUserDataSectionSize);
@@ -337,7 +370,209 @@ TEST_F(CaptureFileHeaderTest, OpenCaptureFileInvalidVersion) {
   EXPECT_THAT(orbit_base::WriteStringToFile(GetCaptureFilePath(), header), HasNoError());
 
   auto capture_file_or_error = CaptureFile::OpenForReadWrite(GetCaptureFilePath());
-  EXPECT_THAT(capture_file_or_error, HasErrorWithMessage("Incompatible version 0, expected 1"));
+  EXPECT_THAT(capture_file_or_error,
+              HasErrorWithMessage("Incompatible version 0, expected 1 to 2"));
+}
+
+TEST_F(CaptureFileHeaderTest, WriteAndReadCompressedCaptureSection) {
+  // Enough events for the capture section to be split into multiple chunks.
+  constexpr uint64_t kEventCount = 100'000;
+  auto create_event = [](uint64_t key) {
+    return CreateInternedStringCaptureEvent(key, absl::StrFormat("%s %u", kAnswerString, key));
+  };
+
+  for (CaptureSectionCompression compression :
+       {CaptureSectionCompression::kZstd, CaptureSectionCompression::kLz4}) {
+    {
+      auto output_stream_or_error =
+          CaptureFileOutputStream::Create(GetCaptureFilePath(), compression);
+      ASSERT_THAT(output_stream_or_error, HasNoError());
+      std::unique_ptr<CaptureFileOutputStream> output_stream =
+          std::move(output_stream_or_error.value());
+      for (uint64_t key = 0; key < kEventCount; ++key) {
+        ASSERT_THAT(output_stream->WriteCaptureEvent(create_event(key)), HasNoError());
+      }
+      ASSERT_THAT(output_stream->Close(), HasNoError());
+    }
+
+    auto capture_file_or_error = CaptureFile::OpenForReadWrite(GetCaptureFilePath());
+    ASSERT_THAT(capture_file_or_error, HasNoError());
+    std::unique_ptr<CaptureFile> capture_file = std::move(capture_file_or_error.value());
+    // The capture section is followed by padding and the section list.
+    ASSERT_THAT(capture_file->AddUserDataSection(16), HasNoError());
+
+    std::unique_ptr<ProtoSectionInputStream> capture_section =
+        capture_file->CreateCaptureSectionInputStream();
+    for (uint64_t key = 0; key < kEventCount; ++key) {
+      ClientCaptureEvent event;
+      ASSERT_THAT(capture_section->ReadMessage(&event), HasNoError());
+      ASSERT_EQ(event.interned_string().key(), key);
+      ASSERT_EQ(event.interned_string().intern(), create_event(key).interned_string().intern());
+    }
+
+    ClientCaptureEvent event;
+    EXPECT_THAT(capture_section->ReadMessage(&event),
+                HasErrorWithMessage("Unexpected end of section"));
+
+    capture_section.reset();
+    capture_file.reset();
+    ASSERT_TRUE(std::filesystem::remove(GetCaptureFilePath()));
+  }
+}
+
+TEST_F(CaptureFileHeaderTest, CreateCaptureSectionInputStreamFromTimestamp) {
+  // Enough events for the timestamp index to have several checkpoints.
+  constexpr uint64_t kEventCount = 200'000;
+  constexpr uint64_t kFirstTimestampToRead = kEventCount / 2 * 1'000;
+  // Every tenth event is older than the previous ones, as events are only roughly ordered.
+  auto get_timestamp_ns = [](uint64_t event_index) {
+    return event_index * 1'000 - (event_index % 10 == 0 ? std::min<uint64_t>(event_index, 50) : 0);
+  };
+
+  for (CaptureSectionCompression compression :
+       {CaptureSectionCompression::kNone, CaptureSectionCompression::kZstd}) {
+    {
+      auto output_stream_or_error =
+          CaptureFileOutputStream::Create(GetCaptureFilePath(), compression);
+      ASSERT_THAT(output_stream_or_error, HasNoError());
+      std::unique_ptr<CaptureFileOutputStream> output_stream =
+          std::move(output_stream_or_error.value());
+      for (uint64_t event_index = 0; event_index < kEventCount; ++event_index) {
+        ClientCaptureEvent event;
+        event.mutable_scheduling_slice()->set_tid(event_index);
+        event.mutable_scheduling_slice()->set_out_timestamp_ns(get_timestamp_ns(event_index));
+        ASSERT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+      }
+      ClientCaptureEvent capture_finished;
+      capture_finished.mutable_capture_finished();
+      ASSERT_THAT(output_stream->WriteCaptureEvent(capture_finished), HasNoError());
+      ASSERT_THAT(output_stream->Close(), HasNoError());
+    }
+
+    auto capture_file_or_error = CaptureFile::OpenForReadWrite(GetCaptureFilePath());
+    ASSERT_THAT(capture_file_or_error, HasNoError());
+    std::unique_ptr<CaptureFile> capture_file = std::move(capture_file_or_error.value());
+    EXPECT_TRUE(capture_file->FindSectionByType(kSectionTypeTimestampIndex).has_value());
+
+    auto capture_section_or_error =
+        capture_file->CreateCaptureSectionInputStreamFromTimestamp(kFirstTimestampToRead);
+    ASSERT_THAT(capture_section_or_error, HasNoError());
+    std::unique_ptr<ProtoSectionInputStream> capture_section =
+        std::move(capture_section_or_error.value());
+
+    // The stream starts at a checkpoint, which is after the start of the capture section and before
+    // the first event to read. All the following events need to be returned.
+    ClientCaptureEvent event;
+    ASSERT_THAT(capture_section->ReadMessage(&event), HasNoError());
+    const uint64_t first_event_index = event.scheduling_slice().tid();
+    EXPECT_GT(first_event_index, 0);
+    EXPECT_LT(get_timestamp_ns(first_event_index), kFirstTimestampToRead);
+    for (uint64_t event_index = first_event_index + 1; event_index < kEventCount; ++event_index) {
+      ASSERT_THAT(capture_section->ReadMessage(&event), HasNoError());
+      ASSERT_EQ(event.scheduling_slice().tid(), event_index);
+    }
+    ASSERT_THAT(capture_section->ReadMessage(&event), HasNoError());
+    EXPECT_EQ(event.event_case(), ClientCaptureEvent::kCaptureFinished);
+
+    // Before the first checkpoint, the stream starts at the beginning of the capture section.
+    capture_section_or_error = capture_file->CreateCaptureSectionInputStreamFromTimestamp(0);
+    ASSERT_THAT(capture_section_or_error, HasNoError());
+    ASSERT_THAT(capture_section_or_error.value()->ReadMessage(&event), HasNoError());
+    EXPECT_EQ(event.scheduling_slice().tid(), 0);
+
+    capture_section.reset();
+    capture_section_or_error.value().reset();
+    capture_file.reset();
+    ASSERT_TRUE(std::filesystem::remove(GetCaptureFilePath()));
+  }
+}
+
+TEST_F(CaptureFileHeaderTest, CreateCaptureSectionInputStreamFromTimestampWithLargeSeekContext) {
+  // Enough interned strings for the seek context not to be kept in memory while writing.
+  constexpr uint64_t kEventCount = 3'000;
+  const std::string interned_string_suffix(1'000, 'a');
+
+  for (CaptureSectionCompression compression :
+       {CaptureSectionCompression::kNone, CaptureSectionCompression::kZstd}) {
+    {
+      auto output_stream_or_error =
+          CaptureFileOutputStream::Create(GetCaptureFilePath(), compression);
+      ASSERT_THAT(output_stream_or_error, HasNoError());
+      std::unique_ptr<CaptureFileOutputStream> output_stream =
+          std::move(output_stream_or_error.value());
+      for (uint64_t event_index = 0; event_index < kEventCount; ++event_index) {
+        ASSERT_THAT(output_stream->WriteCaptureEvent(CreateInternedStringCaptureEvent(
+                        event_index, absl::StrFormat("%u%s", event_index, interned_string_suffix))),
+                    HasNoError());
+        ClientCaptureEvent event;
+        event.mutable_scheduling_slice()->set_out_timestamp_ns(event_index * 1'000);
+        ASSERT_THAT(output_stream->WriteCaptureEvent(event), HasNoError());
+      }
+      ClientCaptureEvent capture_finished;
+      capture_finished.mutable_capture_finished();
+      ASSERT_THAT(output_stream->WriteCaptureEvent(capture_finished), HasNoError());
+      ASSERT_THAT(output_stream->Close(), HasNoError());
+    }
+    std::filesystem::path seek_context_temporary_file_path = GetCaptureFilePath();
+    seek_context_temporary_file_path += ".seek_context";
+    EXPECT_FALSE(std::filesystem::exists(seek_context_temporary_file_path));
+
+    auto capture_file_or_error = CaptureFile::OpenForReadWrite(GetCaptureFilePath());
+    ASSERT_THAT(capture_file_or_error, HasNoError());
+    std::unique_ptr<CaptureFile> capture_file = std::move(capture_file_or_error.value());
+    auto capture_section_or_error =
+        capture_file->CreateCaptureSectionInputStreamFromTimestamp((kEventCount - 1) * 1'000);
+    ASSERT_THAT(capture_section_or_error, HasNoError());
+    std::unique_ptr<ProtoSectionInputStream> capture_section =
+        std::move(capture_section_or_error.value());
+
+    // The interned strings before the checkpoint are replayed, and the following ones are read
+    // from the capture section, so each of them is read once and in order.
+    uint64_t interned_string_count = 0;
+    uint64_t scheduling_slice_count = 0;
+    while (true) {
+      ClientCaptureEvent event;
+      ASSERT_THAT(capture_section->ReadMessage(&event), HasNoError());
+      if (event.event_case() == ClientCaptureEvent::kCaptureFinished) break;
+      if (event.event_case() == ClientCaptureEvent::kSchedulingSlice) {
+        ++scheduling_slice_count;
+        continue;
+      }
+      ASSERT_EQ(event.interned_string().key(), interned_string_count);
+      ASSERT_EQ(event.interned_string().intern(),
+                absl::StrFormat("%u%s", interned_string_count, interned_string_suffix));
+      ++interned_string_count;
+    }
+    EXPECT_EQ(interned_string_count, kEventCount);
+    EXPECT_LT(scheduling_slice_count, kEventCount / 2);
+
+    capture_section.reset();
+    capture_file.reset();
+    ASSERT_TRUE(std::filesystem::remove(GetCaptureFilePath()));
+  }
+}
+
+TEST_F(CaptureFileHeaderTest, CreateCaptureSectionInputStreamFromTimestampWithoutIndex) {
+  {
+    auto output_stream_or_error = CaptureFileOutputStream::Create(GetCaptureFilePath());
+    ASSERT_THAT(output_stream_or_error, HasNoError());
+    ASSERT_THAT(output_stream_or_error.value()->WriteCaptureEvent(
+                    CreateInternedStringCaptureEvent(kAnswerKey, kAnswerString)),
+                HasNoError());
+    ASSERT_THAT(output_stream_or_error.value()->Close(), HasNoError());
+  }
+
+  auto capture_file_or_error = CaptureFile::OpenForReadWrite(GetCaptureFilePath());
+  ASSERT_THAT(capture_file_or_error, HasNoError());
+  EXPECT_FALSE(
+      capture_file_or_error.value()->FindSectionByType(kSectionTypeTimestampIndex).has_value());
+
+  auto capture_section_or_error =
+      capture_file_or_error.value()->CreateCaptureSectionInputStreamFromTimestamp(1'000);
+  ASSERT_THAT(capture_section_or_error, HasNoError());
+  ClientCaptureEvent event;
+  ASSERT_THAT(capture_section_or_error.value()->ReadMessage(&event), HasNoError());
+  EXPECT_EQ(event.interned_string().key(), kAnswerKey);
 }
 
 TEST_F(CaptureFileHeaderTest, OpenCaptureFileInvalidSectionListSize) {
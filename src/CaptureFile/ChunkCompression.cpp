@@ -0,0 +1,121 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ChunkCompression.h"
+
+#include <absl/strings/str_format.h>
+#include <lz4.h>
+#include <zstd.h>
+
+#include <cstring>
+#include <limits>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_capture_file_internal {
+
+using orbit_capture_file::CaptureSectionCompression;
+
+namespace {
+// Zstd's default level compresses captures to a fraction of their size at a speed well above the
+// rate at which events arrive. Higher levels would slow down saving for little gain.
+constexpr int kZstdCompressionLevel = ZSTD_CLEVEL_DEFAULT;
+}  // namespace
+
+ChunkCompressor::ChunkCompressor(CaptureSectionCompression compression)
+    : compression_{compression} {
+  ORBIT_CHECK(compression_ != CaptureSectionCompression::kNone);
+  if (compression_ == CaptureSectionCompression::kZstd) {
+    zstd_context_ = ZSTD_createCCtx();
+    ORBIT_CHECK(zstd_context_ != nullptr);
+  }
+}
+
+ChunkCompressor::~ChunkCompressor() { ZSTD_freeCCtx(zstd_context_); }
+
+ErrorMessageOr<void> ChunkCompressor::Compress(absl::Span<const uint8_t> input,
+                                               std::vector<uint8_t>* output) {
+  ORBIT_CHECK(output != nullptr);
+  ORBIT_CHECK(input.size() <= static_cast<size_t>(std::numeric_limits<int>::max()));
+
+  switch (compression_) {
+    case CaptureSectionCompression::kNone:
+      ORBIT_UNREACHABLE();
+    case CaptureSectionCompression::kZstd: {
+      output->resize(ZSTD_compressBound(input.size()));
+      const size_t result = ZSTD_compressCCtx(zstd_context_, output->data(), output->size(),
+                                              input.data(), input.size(), kZstdCompressionLevel);
+      if (ZSTD_isError(result) != 0) {
+        return ErrorMessage{
+            absl::StrFormat("Unable to compress chunk with zstd: %s", ZSTD_getErrorName(result))};
+      }
+      output->resize(result);
+      return outcome::success();
+    }
+    case CaptureSectionCompression::kLz4: {
+      output->resize(LZ4_compressBound(static_cast<int>(input.size())));
+      const int result = LZ4_compress_default(
+          reinterpret_cast<const char*>(input.data()), reinterpret_cast<char*>(output->data()),
+          static_cast<int>(input.size()), static_cast<int>(output->size()));
+      if (result <= 0) {
+        return ErrorMessage{"Unable to compress chunk with LZ4"};
+      }
+      output->resize(result);
+      return outcome::success();
+    }
+  }
+
+  ORBIT_UNREACHABLE();
+}
+
+ChunkDecompressor::~ChunkDecompressor() { ZSTD_freeDCtx(zstd_context_); }
+
+ErrorMessageOr<void> ChunkDecompressor::Decompress(CaptureSectionCompression compression,
+                                                   absl::Span<const uint8_t> input,
+                                                   absl::Span<uint8_t> output) {
+  switch (compression) {
+    case CaptureSectionCompression::kNone:
+      if (input.size() != output.size()) {
+        return ErrorMessage{absl::StrFormat(
+            "Uncompressed chunk has size %d, but its header says %d", input.size(), output.size())};
+      }
+      std::memcpy(output.data(), input.data(), input.size());
+      return outcome::success();
+    case CaptureSectionCompression::kZstd: {
+      if (zstd_context_ == nullptr) {
+        zstd_context_ = ZSTD_createDCtx();
+        ORBIT_CHECK(zstd_context_ != nullptr);
+      }
+      const size_t result = ZSTD_decompressDCtx(zstd_context_, output.data(), output.size(),
+                                                input.data(), input.size());
+      if (ZSTD_isError(result) != 0) {
+        return ErrorMessage{
+            absl::StrFormat("Unable to decompress zstd chunk: %s", ZSTD_getErrorName(result))};
+      }
+      if (result != output.size()) {
+        return ErrorMessage{absl::StrFormat(
+            "Decompressed chunk has size %d, but its header says %d", result, output.size())};
+      }
+      return outcome::success();
+    }
+    case CaptureSectionCompression::kLz4: {
+      const int result = LZ4_decompress_safe(
+          reinterpret_cast<const char*>(input.data()), reinterpret_cast<char*>(output.data()),
+          static_cast<int>(input.size()), static_cast<int>(output.size()));
+      if (result < 0) {
+        return ErrorMessage{"Unable to decompress LZ4 chunk: the data is corrupted"};
+      }
+      if (static_cast<size_t>(result) != output.size()) {
+        return ErrorMessage{absl::StrFormat(
+            "Decompressed chunk has size %d, but its header says %d", result, output.size())};
+      }
+      return outcome::success();
+    }
+  }
+
+  return ErrorMessage{
+      absl::StrFormat("Unknown chunk compression %d", static_cast<uint32_t>(compression))};
+}
+
+}  // namespace orbit_capture_file_internal
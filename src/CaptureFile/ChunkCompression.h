@@ -0,0 +1,73 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHUNK_COMPRESSION_H_
+#define CHUNK_COMPRESSION_H_
+
+#include <absl/types/span.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "CaptureFile/CaptureFileOutputStream.h"
+#include "OrbitBase/Result.h"
+
+struct ZSTD_CCtx_s;
+struct ZSTD_DCtx_s;
+
+namespace orbit_capture_file_internal {
+
+// In version 2 of the file format, the capture section is a sequence of chunks, each made of this
+// header followed by `compressed_size` bytes of data. Once decompressed, the data of a chunk is
+// `uncompressed_size` bytes long and contains a whole number of size-prefixed messages.
+struct CaptureSectionChunkHeader {
+  // A orbit_capture_file::CaptureSectionCompression.
+  uint32_t compression;
+  uint32_t compressed_size;
+  uint32_t uncompressed_size;
+};
+static_assert(sizeof(CaptureSectionChunkHeader) == 12);
+
+// The writer starts a new chunk when adding a message would make the current one larger than this.
+constexpr uint32_t kTargetChunkUncompressedSize = 1024 * 1024;  // 1Mb
+// Since file input is not trusted, chunks larger than this are rejected by the reader.
+constexpr uint32_t kMaximumChunkSize = 8 * 1024 * 1024;  // 8Mb
+
+// Compresses chunks with the given method, reusing the compression context across chunks.
+class ChunkCompressor {
+ public:
+  explicit ChunkCompressor(orbit_capture_file::CaptureSectionCompression compression);
+  ChunkCompressor(const ChunkCompressor&) = delete;
+  ChunkCompressor& operator=(const ChunkCompressor&) = delete;
+  ~ChunkCompressor();
+
+  // Replaces the content of `output` with the compressed `input`.
+  [[nodiscard]] ErrorMessageOr<void> Compress(absl::Span<const uint8_t> input,
+                                              std::vector<uint8_t>* output);
+
+ private:
+  orbit_capture_file::CaptureSectionCompression compression_;
+  ZSTD_CCtx_s* zstd_context_ = nullptr;
+};
+
+// Decompresses chunks compressed with any of the supported methods.
+class ChunkDecompressor {
+ public:
+  ChunkDecompressor() = default;
+  ChunkDecompressor(const ChunkDecompressor&) = delete;
+  ChunkDecompressor& operator=(const ChunkDecompressor&) = delete;
+  ~ChunkDecompressor();
+
+  // Decompresses `input` into `output`, whose size needs to be the one of the uncompressed data.
+  [[nodiscard]] ErrorMessageOr<void> Decompress(
+      orbit_capture_file::CaptureSectionCompression compression, absl::Span<const uint8_t> input,
+      absl::Span<uint8_t> output);
+
+ private:
+  ZSTD_DCtx_s* zstd_context_ = nullptr;
+};
+
+}  // namespace orbit_capture_file_internal
+
+#endif  // CHUNK_COMPRESSION_H_
@@ -0,0 +1,94 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/types/span.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "CaptureFile/CaptureFileOutputStream.h"
+#include "ChunkCompression.h"
+#include "TestUtils/TestUtils.h"
+
+namespace orbit_capture_file_internal {
+
+using orbit_capture_file::CaptureSectionCompression;
+using orbit_test_utils::HasError;
+using orbit_test_utils::HasNoError;
+
+static std::vector<uint8_t> CreateCompressibleData() {
+  std::vector<uint8_t> data(64 * 1024);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<uint8_t>(i % 32);
+  }
+  return data;
+}
+
+TEST(ChunkCompression, CompressAndDecompress) {
+  const std::vector<uint8_t> data = CreateCompressibleData();
+  ChunkDecompressor decompressor;
+
+  for (CaptureSectionCompression compression :
+       {CaptureSectionCompression::kZstd, CaptureSectionCompression::kLz4}) {
+    ChunkCompressor compressor{compression};
+    // Compress twice to check that the compressor can be reused.
+    for (int i = 0; i < 2; ++i) {
+      std::vector<uint8_t> compressed;
+      ASSERT_THAT(compressor.Compress(data, &compressed), HasNoError());
+      EXPECT_LT(compressed.size(), data.size());
+
+      std::vector<uint8_t> decompressed(data.size());
+      ASSERT_THAT(decompressor.Decompress(compression, compressed, absl::MakeSpan(decompressed)),
+                  HasNoError());
+      EXPECT_EQ(decompressed, data);
+    }
+  }
+}
+
+TEST(ChunkCompression, DecompressUncompressed) {
+  const std::vector<uint8_t> data = CreateCompressibleData();
+  ChunkDecompressor decompressor;
+
+  std::vector<uint8_t> decompressed(data.size());
+  ASSERT_THAT(decompressor.Decompress(CaptureSectionCompression::kNone, data,
+                                      absl::MakeSpan(decompressed)),
+              HasNoError());
+  EXPECT_EQ(decompressed, data);
+}
+
+TEST(ChunkCompression, DecompressWithWrongSizeFails) {
+  const std::vector<uint8_t> data = CreateCompressibleData();
+  ChunkDecompressor decompressor;
+
+  for (CaptureSectionCompression compression :
+       {CaptureSectionCompression::kZstd, CaptureSectionCompression::kLz4}) {
+    ChunkCompressor compressor{compression};
+    std::vector<uint8_t> compressed;
+    ASSERT_THAT(compressor.Compress(data, &compressed), HasNoError());
+
+    std::vector<uint8_t> decompressed(data.size() - 1);
+    EXPECT_THAT(decompressor.Decompress(compression, compressed, absl::MakeSpan(decompressed)),
+                HasError());
+  }
+}
+
+TEST(ChunkCompression, DecompressCorruptedDataFails) {
+  const std::vector<uint8_t> corrupted(1024, 0xff);
+  ChunkDecompressor decompressor;
+
+  for (CaptureSectionCompression compression :
+       {CaptureSectionCompression::kZstd, CaptureSectionCompression::kLz4}) {
+    std::vector<uint8_t> decompressed(4096);
+    EXPECT_THAT(decompressor.Decompress(compression, corrupted, absl::MakeSpan(decompressed)),
+                HasError());
+  }
+  std::vector<uint8_t> decompressed(4096);
+  EXPECT_THAT(decompressor.Decompress(static_cast<CaptureSectionCompression>(42), corrupted,
+                                      absl::MakeSpan(decompressed)),
+              HasError());
+}
+
+}  // namespace orbit_capture_file_internal
@@ -0,0 +1,113 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CompressedChunksInputStream.h"
+
+#include <absl/strings/str_format.h>
+#include <absl/types/span.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "CaptureFile/CaptureFileOutputStream.h"
+#include "OrbitBase/Logging.h"
+
+namespace orbit_capture_file_internal {
+
+using orbit_capture_file::CaptureSectionCompression;
+
+bool CompressedChunksInputStream::Next(const void** data, int* size) {
+  ORBIT_CHECK(data != nullptr);
+  ORBIT_CHECK(size != nullptr);
+
+  if (position_in_chunk_ == chunk_.size() && !ReadNextChunk()) {
+    return false;
+  }
+
+  *data = chunk_.data() + position_in_chunk_;
+  *size = static_cast<int>(chunk_.size() - position_in_chunk_);
+  byte_count_ += *size;
+  position_in_chunk_ = chunk_.size();
+  return true;
+}
+
+void CompressedChunksInputStream::BackUp(int count) {
+  ORBIT_CHECK(count >= 0);
+  ORBIT_CHECK(static_cast<size_t>(count) <= position_in_chunk_);
+  position_in_chunk_ -= count;
+  byte_count_ -= count;
+}
+
+bool CompressedChunksInputStream::Skip(int count) {
+  ORBIT_CHECK(count >= 0);
+
+  size_t bytes_to_skip = count;
+  while (true) {
+    const size_t bytes_skipped = std::min(bytes_to_skip, chunk_.size() - position_in_chunk_);
+    position_in_chunk_ += bytes_skipped;
+    byte_count_ += static_cast<int64_t>(bytes_skipped);
+    bytes_to_skip -= bytes_skipped;
+    if (bytes_to_skip == 0) return true;
+    if (!ReadNextChunk()) return false;
+  }
+}
+
+std::optional<ErrorMessage> CompressedChunksInputStream::GetLastError() const {
+  if (last_error_.has_value()) return last_error_;
+  return chunks_input_stream_->GetLastError();
+}
+
+bool CompressedChunksInputStream::ReadNextChunk() {
+  if (last_error_.has_value()) return false;
+
+  CaptureSectionChunkHeader header{};
+  if (!ReadFromChunksInputStream(&header, sizeof(header)) || header.uncompressed_size == 0) {
+    return false;
+  }
+
+  if (header.compressed_size > kMaximumChunkSize || header.uncompressed_size > kMaximumChunkSize) {
+    last_error_ = ErrorMessage{absl::StrFormat(
+        "The chunk size %d (compressed: %d) is too big (maximum allowed chunk size is %d)",
+        header.uncompressed_size, header.compressed_size, kMaximumChunkSize)};
+    return false;
+  }
+
+  compressed_chunk_.resize(header.compressed_size);
+  if (!ReadFromChunksInputStream(compressed_chunk_.data(), compressed_chunk_.size())) {
+    last_error_ = chunks_input_stream_->GetLastError().value_or(
+        ErrorMessage{"Unexpected end of section while reading a chunk"});
+    return false;
+  }
+
+  chunk_.resize(header.uncompressed_size);
+  position_in_chunk_ = 0;
+  auto decompress_result =
+      decompressor_.Decompress(static_cast<CaptureSectionCompression>(header.compression),
+                               compressed_chunk_, absl::MakeSpan(chunk_));
+  if (decompress_result.has_error()) {
+    chunk_.clear();
+    last_error_ = std::move(decompress_result.error());
+    return false;
+  }
+
+  return true;
+}
+
+bool CompressedChunksInputStream::ReadFromChunksInputStream(void* data, size_t size) {
+  auto* destination = static_cast<uint8_t*>(data);
+  while (size > 0) {
+    const void* buffer = nullptr;
+    int buffer_size = 0;
+    if (!chunks_input_stream_->Next(&buffer, &buffer_size)) return false;
+
+    const size_t bytes_to_copy = std::min(size, static_cast<size_t>(buffer_size));
+    std::memcpy(destination, buffer, bytes_to_copy);
+    destination += bytes_to_copy;
+    size -= bytes_to_copy;
+    chunks_input_stream_->BackUp(buffer_size - static_cast<int>(bytes_to_copy));
+  }
+  return true;
+}
+
+}  // namespace orbit_capture_file_internal
@@ -0,0 +1,55 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef COMPRESSED_CHUNKS_INPUT_STREAM_H_
+#define COMPRESSED_CHUNKS_INPUT_STREAM_H_
+
+#include <google/protobuf/io/zero_copy_stream.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <optional>
+#include <vector>
+
+#include "ChunkCompression.h"
+#include "FileFragmentInputStream.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_capture_file_internal {
+
+// ZeroCopyInputStream that reads the chunks of a capture section in version 2 of the file format
+// from `chunks_input_stream`, and returns their decompressed content. Only one chunk is kept in
+// memory at a time. The stream ends at the end of `chunks_input_stream` or when a chunk header
+// with a size of zero is encountered, which is what the padding after the section looks like.
+class CompressedChunksInputStream : public google::protobuf::io::ZeroCopyInputStream {
+ public:
+  explicit CompressedChunksInputStream(FileFragmentInputStream* chunks_input_stream)
+      : chunks_input_stream_{chunks_input_stream} {}
+
+  bool Next(const void** data, int* size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  [[nodiscard]] int64_t ByteCount() const override { return byte_count_; }
+
+  // Returns the error that made Next or Skip fail, either while reading or while decompressing.
+  [[nodiscard]] std::optional<ErrorMessage> GetLastError() const;
+
+ private:
+  // Reads and decompresses the next chunk into `chunk_`. Returns false at the end of the section
+  // or on error, in which case `last_error_` is set.
+  bool ReadNextChunk();
+  bool ReadFromChunksInputStream(void* data, size_t size);
+
+  FileFragmentInputStream* chunks_input_stream_;
+  ChunkDecompressor decompressor_;
+  std::vector<uint8_t> compressed_chunk_;
+  std::vector<uint8_t> chunk_;
+  size_t position_in_chunk_ = 0;
+  int64_t byte_count_ = 0;
+  std::optional<ErrorMessage> last_error_{};
+};
+
+}  // namespace orbit_capture_file_internal
+
+#endif  // COMPRESSED_CHUNKS_INPUT_STREAM_H_
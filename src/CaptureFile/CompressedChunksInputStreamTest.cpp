@@ -0,0 +1,162 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "CaptureFile/CaptureFileOutputStream.h"
+#include "ChunkCompression.h"
+#include "CompressedChunksInputStream.h"
+#include "FileFragmentInputStream.h"
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+#include "TestUtils/TemporaryFile.h"
+#include "TestUtils/TestUtils.h"
+
+namespace orbit_capture_file_internal {
+
+using orbit_capture_file::CaptureSectionCompression;
+using orbit_test_utils::HasErrorWithMessage;
+using orbit_test_utils::HasNoError;
+
+namespace {
+
+class CompressedChunksInputStreamTest : public testing::Test {
+ public:
+  void SetUp() override {
+    auto temporary_file_or_error = orbit_test_utils::TemporaryFile::Create();
+    ASSERT_THAT(temporary_file_or_error, HasNoError());
+    temporary_file_.emplace(std::move(temporary_file_or_error.value()));
+  }
+
+ protected:
+  void AppendChunk(CaptureSectionCompression compression, std::string_view content) {
+    std::vector<uint8_t> data(content.begin(), content.end());
+    if (compression != CaptureSectionCompression::kNone) {
+      ChunkCompressor compressor{compression};
+      std::vector<uint8_t> compressed;
+      ASSERT_THAT(compressor.Compress(data, &compressed), HasNoError());
+      data = std::move(compressed);
+    }
+    AppendChunkHeader({.compression = static_cast<uint32_t>(compression),
+                       .compressed_size = static_cast<uint32_t>(data.size()),
+                       .uncompressed_size = static_cast<uint32_t>(content.size())});
+    Append(data.data(), data.size());
+  }
+
+  void AppendChunkHeader(const CaptureSectionChunkHeader& header) {
+    Append(&header, sizeof(header));
+  }
+
+  void Append(const void* data, size_t size) {
+    ASSERT_THAT(orbit_base::WriteFully(temporary_file_->fd(), data, size), HasNoError());
+    file_size_ += size;
+  }
+
+  [[nodiscard]] FileFragmentInputStream CreateFileFragmentInputStream() const {
+    return FileFragmentInputStream{temporary_file_->fd(), 0, file_size_};
+  }
+
+ private:
+  std::optional<orbit_test_utils::TemporaryFile> temporary_file_;
+  uint64_t file_size_ = 0;
+};
+
+std::string_view ToStringView(const void* data, int size) {
+  return {static_cast<const char*>(data), static_cast<size_t>(size)};
+}
+
+}  // namespace
+
+TEST_F(CompressedChunksInputStreamTest, ReadChunks) {
+  const std::string first_content(1000, 'a');
+  const std::string second_content = "not compressed";
+  const std::string third_content(2000, 'c');
+  AppendChunk(CaptureSectionCompression::kZstd, first_content);
+  AppendChunk(CaptureSectionCompression::kNone, second_content);
+  AppendChunk(CaptureSectionCompression::kLz4, third_content);
+
+  FileFragmentInputStream file_fragment_input_stream = CreateFileFragmentInputStream();
+  CompressedChunksInputStream input_stream{&file_fragment_input_stream};
+
+  const void* data = nullptr;
+  int size = 0;
+  ASSERT_TRUE(input_stream.Next(&data, &size));
+  EXPECT_EQ(ToStringView(data, size), first_content);
+  EXPECT_EQ(input_stream.ByteCount(), 1000);
+
+  input_stream.BackUp(10);
+  EXPECT_EQ(input_stream.ByteCount(), 990);
+  ASSERT_TRUE(input_stream.Next(&data, &size));
+  EXPECT_EQ(ToStringView(data, size), std::string(10, 'a'));
+
+  // Skip across the end of the second chunk.
+  ASSERT_TRUE(input_stream.Skip(static_cast<int>(second_content.size()) + 500));
+  EXPECT_EQ(input_stream.ByteCount(), 1000 + second_content.size() + 500);
+  ASSERT_TRUE(input_stream.Next(&data, &size));
+  EXPECT_EQ(ToStringView(data, size), std::string(1500, 'c'));
+
+  EXPECT_FALSE(input_stream.Next(&data, &size));
+  EXPECT_FALSE(input_stream.GetLastError().has_value());
+}
+
+TEST_F(CompressedChunksInputStreamTest, StopsAtZeroPadding) {
+  AppendChunk(CaptureSectionCompression::kLz4, "some content");
+  AppendChunkHeader({});
+  AppendChunk(CaptureSectionCompression::kNone, "after the padding");
+
+  FileFragmentInputStream file_fragment_input_stream = CreateFileFragmentInputStream();
+  CompressedChunksInputStream input_stream{&file_fragment_input_stream};
+
+  const void* data = nullptr;
+  int size = 0;
+  ASSERT_TRUE(input_stream.Next(&data, &size));
+  EXPECT_EQ(ToStringView(data, size), "some content");
+  EXPECT_FALSE(input_stream.Next(&data, &size));
+  EXPECT_FALSE(input_stream.GetLastError().has_value());
+}
+
+TEST_F(CompressedChunksInputStreamTest, ChunkTooLarge) {
+  AppendChunkHeader({.compression = static_cast<uint32_t>(CaptureSectionCompression::kZstd),
+                     .compressed_size = 16,
+                     .uncompressed_size = kMaximumChunkSize + 1});
+  Append("0123456789abcdef", 16);
+
+  FileFragmentInputStream file_fragment_input_stream = CreateFileFragmentInputStream();
+  CompressedChunksInputStream input_stream{&file_fragment_input_stream};
+
+  const void* data = nullptr;
+  int size = 0;
+  EXPECT_FALSE(input_stream.Next(&data, &size));
+  ASSERT_TRUE(input_stream.GetLastError().has_value());
+  EXPECT_THAT(ErrorMessageOr<void>{input_stream.GetLastError().value()},
+              HasErrorWithMessage("is too big"));
+}
+
+TEST_F(CompressedChunksInputStreamTest, TruncatedChunk) {
+  AppendChunkHeader({.compression = static_cast<uint32_t>(CaptureSectionCompression::kNone),
+                     .compressed_size = 100,
+                     .uncompressed_size = 100});
+  Append("0123456789", 10);
+
+  FileFragmentInputStream file_fragment_input_stream = CreateFileFragmentInputStream();
+  CompressedChunksInputStream input_stream{&file_fragment_input_stream};
+
+  const void* data = nullptr;
+  int size = 0;
+  EXPECT_FALSE(input_stream.Next(&data, &size));
+  ASSERT_TRUE(input_stream.GetLastError().has_value());
+  EXPECT_THAT(ErrorMessageOr<void>{input_stream.GetLastError().value()},
+              HasErrorWithMessage("Unexpected end of section while reading a chunk"));
+}
+
+}  // namespace orbit_capture_file_internal
@@ -6,22 +6,50 @@
 
 #include <stdint.h>
 
+#include <algorithm>
 #include <utility>
 
 namespace orbit_capture_file_internal {
 
 using orbit_base::ReadFullyAtOffset;
 
+// In mapped mode, Next returns at most this many bytes at once, which keeps the sizes far from the
+// limits of int.
+constexpr uint64_t kMaxMappedChunkSize = 64 * 1024 * 1024;
+
 bool FileFragmentInputStream::Next(const void** data, int* size) {
   ORBIT_CHECK(data != nullptr);
   ORBIT_CHECK(size != nullptr);
 
   if (last_error_.has_value()) return false;
 
+  if (mapping_ != nullptr) {
+    // file_fragments_end_ might be beyond EOF for some reason, and the file might have been
+    // truncated since it was mapped. Accessing the mapping beyond the end of the file raises
+    // SIGBUS, so re-check the size of the file before handing out each chunk. This doesn't protect
+    // against the file being truncated while the caller reads the chunk: files that other processes
+    // might still truncate must be read without a mapping.
+    ErrorMessageOr<uint64_t> file_size = mapping_->GetFileSize();
+    if (file_size.has_error()) {
+      last_error_ = std::move(file_size.error());
+      return false;
+    }
+    const uint64_t end = std::min<uint64_t>(
+        {file_fragments_end_, mapping_->GetData().size(), file_size.value()});
+    if (current_position_ >= end) {
+      return false;
+    }
+    const uint64_t bytes_available = std::min(end - current_position_, kMaxMappedChunkSize);
+    (*data) = mapping_->GetData().data() + current_position_;
+    (*size) = static_cast<int>(bytes_available);
+    current_position_ += bytes_available;
+    return true;
+  }
+
   uint64_t bytes_to_read = std::min(buffer_.size(), file_fragments_end_ - current_position_);
 
   auto bytes_read_or_error =
-      ReadFullyAtOffset(fd_, buffer_.data(), bytes_to_read, current_position_);
+      ReadFullyAtOffset(*fd_, buffer_.data(), bytes_to_read, current_position_);
   if (bytes_read_or_error.has_error()) {
     last_error_ = std::move(bytes_read_or_error.error());
     return false;
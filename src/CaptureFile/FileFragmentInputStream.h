@@ -11,9 +11,12 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <memory>
 #include <optional>
+#include <utility>
 #include <vector>
 
+#include "MemoryMappedFile.h"
 #include "OrbitBase/File.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Result.h"
@@ -23,12 +26,14 @@ namespace orbit_capture_file_internal {
 // ZeroCopyInputStream implementation for a file fragment with offset and size.
 // This class is used to read protos from capture file sections and makes sure
 // we do not overread into other sections of the file.
+// When created with a MemoryMappedFile, the stream returns the data directly from the mapping
+// instead of reading it into a buffer.
 // https://developers.google.com/protocol-buffers/docs/reference/cpp/google.protobuf.io.zero_copy_stream
 class FileFragmentInputStream : public google::protobuf::io::ZeroCopyInputStream {
  public:
   explicit FileFragmentInputStream(const orbit_base::UniqueFd& fd, uint64_t file_offset,
                                    uint64_t size, size_t block_size = 1 << 16)
-      : fd_{fd},
+      : fd_{&fd},
         file_fragments_start_{file_offset},
         file_fragments_end_{file_offset + size},
         buffer_(block_size),
@@ -36,6 +41,17 @@ class FileFragmentInputStream : public google::protobuf::io::ZeroCopyInputStream
     ORBIT_CHECK(size > 0);
   }
 
+  explicit FileFragmentInputStream(std::shared_ptr<const MemoryMappedFile> mapping,
+                                   uint64_t file_offset, uint64_t size)
+      : mapping_{std::move(mapping)},
+        file_fragments_start_{file_offset},
+        file_fragments_end_{file_offset + size},
+        current_position_{file_offset} {
+    ORBIT_CHECK(mapping_ != nullptr);
+    ORBIT_CHECK(size > 0);
+    mapping_->AdviseSequentialAccess(file_offset, size);
+  }
+
   // Obtains a chunk of data from the stream.
   // https://developers.google.com/protocol-buffers/docs/reference/cpp/google.protobuf.io.zero_copy_stream#ZeroCopyInputStream.Next.details
   bool Next(const void** data, int* size) override;
@@ -51,7 +67,9 @@ class FileFragmentInputStream : public google::protobuf::io::ZeroCopyInputStream
   [[nodiscard]] std::optional<ErrorMessage> GetLastError() const { return last_error_; }
 
  private:
-  const orbit_base::UniqueFd& fd_;
+  // Exactly one of `fd_` and `mapping_` is set.
+  const orbit_base::UniqueFd* fd_ = nullptr;
+  std::shared_ptr<const MemoryMappedFile> mapping_;
   const uint64_t file_fragments_start_;
   const uint64_t file_fragments_end_;
   std::vector<uint8_t> buffer_;
@@ -11,10 +11,15 @@
 #include <utility>
 
 #include "FileFragmentInputStream.h"
+#include "MemoryMappedFile.h"
 #include "OrbitBase/File.h"
 #include "OrbitBase/Result.h"
 #include "TestUtils/TemporaryFile.h"
 
+#ifdef __linux
+#include <unistd.h>
+#endif
+
 namespace orbit_capture_file_internal {
 
 TEST(FileFragmentInputStream, ReadBlocksOfTen) {
@@ -78,4 +83,93 @@ TEST(FileFragmentInputStream, ReadBlocksOfTen) {
   EXPECT_FALSE(input_stream.GetLastError().has_value());
 }
 
+#ifdef __linux
+TEST(FileFragmentInputStream, ReadFromMapping) {
+  auto temporary_file_or_error = orbit_test_utils::TemporaryFile::Create();
+  ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
+  orbit_test_utils::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  constexpr std::string_view kContent =
+      "Vestibulum euismod sapien eget urna molestie euismod. Etiam pellentesque porttitor ligula "
+      "et facilisis.";
+  auto write_result = orbit_base::WriteFully(temporary_file.fd(), kContent);
+  ASSERT_FALSE(write_result.has_error()) << write_result.error().message();
+
+  auto mapping_or_error = MemoryMappedFile::Create(temporary_file.fd(), kContent.size());
+  ASSERT_TRUE(mapping_or_error.has_value()) << mapping_or_error.error().message();
+  std::shared_ptr<const MemoryMappedFile> mapping = std::move(mapping_or_error.value());
+
+  {
+    // The fragment is "urna molestie euismod. Etiam pellentesque"
+    FileFragmentInputStream input_stream{mapping, 31, 41};
+
+    const void* bytes = nullptr;
+    int size = 0;
+    ASSERT_TRUE(input_stream.Next(&bytes, &size));
+    EXPECT_EQ((std::string_view{static_cast<const char*>(bytes), static_cast<size_t>(size)}),
+              "urna molestie euismod. Etiam pellentesque");
+    // The data is not copied.
+    EXPECT_EQ(bytes, mapping->GetData().data() + 31);
+    EXPECT_EQ(input_stream.ByteCount(), 41);
+    EXPECT_FALSE(input_stream.Next(&bytes, &size));
+
+    input_stream.BackUp(5);
+    ASSERT_TRUE(input_stream.Next(&bytes, &size));
+    EXPECT_EQ((std::string_view{static_cast<const char*>(bytes), static_cast<size_t>(size)}),
+              "esque");
+    EXPECT_FALSE(input_stream.Next(&bytes, &size));
+    EXPECT_FALSE(input_stream.GetLastError().has_value());
+  }
+
+  {
+    // A fragment that goes beyond the end of the file ends with the file.
+    FileFragmentInputStream input_stream{mapping, 90, 100};
+    const void* bytes = nullptr;
+    int size = 0;
+    ASSERT_TRUE(input_stream.Next(&bytes, &size));
+    EXPECT_EQ((std::string_view{static_cast<const char*>(bytes), static_cast<size_t>(size)}),
+              "et facilisis.");
+    EXPECT_FALSE(input_stream.Next(&bytes, &size));
+  }
+}
+
+TEST(FileFragmentInputStream, ReadFromMappingOfTruncatedFile) {
+  auto temporary_file_or_error = orbit_test_utils::TemporaryFile::Create();
+  ASSERT_TRUE(temporary_file_or_error.has_value()) << temporary_file_or_error.error().message();
+  orbit_test_utils::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+
+  constexpr std::string_view kContent =
+      "Vestibulum euismod sapien eget urna molestie euismod. Etiam pellentesque porttitor ligula "
+      "et facilisis.";
+  auto write_result = orbit_base::WriteFully(temporary_file.fd(), kContent);
+  ASSERT_FALSE(write_result.has_error()) << write_result.error().message();
+
+  auto mapping_or_error = MemoryMappedFile::Create(temporary_file.fd(), kContent.size());
+  ASSERT_TRUE(mapping_or_error.has_value()) << mapping_or_error.error().message();
+  std::shared_ptr<const MemoryMappedFile> mapping = std::move(mapping_or_error.value());
+
+  ASSERT_EQ(ftruncate(temporary_file.fd().get(), 40), 0);
+
+  {
+    // Only the part of the fragment that is still in the file is returned.
+    FileFragmentInputStream input_stream{mapping, 31, 41};
+    const void* bytes = nullptr;
+    int size = 0;
+    ASSERT_TRUE(input_stream.Next(&bytes, &size));
+    EXPECT_EQ((std::string_view{static_cast<const char*>(bytes), static_cast<size_t>(size)}),
+              "urna mole");
+    EXPECT_FALSE(input_stream.Next(&bytes, &size));
+    EXPECT_FALSE(input_stream.GetLastError().has_value());
+  }
+
+  {
+    // A fragment that is entirely beyond the new end of the file is empty.
+    FileFragmentInputStream input_stream{mapping, 90, 10};
+    const void* bytes = nullptr;
+    int size = 0;
+    EXPECT_FALSE(input_stream.Next(&bytes, &size));
+  }
+}
+#endif
+
 }  // namespace orbit_capture_file_internal
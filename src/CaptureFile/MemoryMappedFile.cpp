@@ -0,0 +1,84 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "MemoryMappedFile.h"
+
+#include <absl/strings/str_format.h>
+
+#include <algorithm>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/SafeStrerror.h"
+
+#ifdef __linux
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace orbit_capture_file_internal {
+
+ErrorMessageOr<std::shared_ptr<const MemoryMappedFile>> MemoryMappedFile::Create(
+    const orbit_base::UniqueFd& fd, uint64_t size) {
+  if (size == 0) {
+    return ErrorMessage{"Unable to map an empty file"};
+  }
+#ifdef __linux
+  orbit_base::UniqueFd duplicated_fd{fcntl(fd.get(), F_DUPFD_CLOEXEC, 0)};
+  if (!duplicated_fd.valid()) {
+    return ErrorMessage{
+        absl::StrFormat("Unable to duplicate the file descriptor: %s", SafeStrerror(errno))};
+  }
+  void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd.get(), 0);
+  if (data == MAP_FAILED) {
+    return ErrorMessage{absl::StrFormat("Unable to map the file: %s", SafeStrerror(errno))};
+  }
+  return std::shared_ptr<const MemoryMappedFile>{
+      new MemoryMappedFile{std::move(duplicated_fd), static_cast<const uint8_t*>(data), size}};
+#else
+  (void)fd;
+  return ErrorMessage{"Mapping capture files is not supported on this platform"};
+#endif
+}
+
+MemoryMappedFile::~MemoryMappedFile() {
+#ifdef __linux
+  if (munmap(const_cast<uint8_t*>(data_), size_) != 0) {
+    ORBIT_ERROR("Unable to unmap capture file: %s", SafeStrerror(errno));
+  }
+#endif
+}
+
+ErrorMessageOr<uint64_t> MemoryMappedFile::GetFileSize() const {
+#ifdef __linux
+  struct stat file_stat {};
+  if (fstat(fd_.get(), &file_stat) != 0) {
+    return ErrorMessage{
+        absl::StrFormat("Unable to get the size of the mapped file: %s", SafeStrerror(errno))};
+  }
+  return static_cast<uint64_t>(file_stat.st_size);
+#else
+  return ErrorMessage{"Mapping capture files is not supported on this platform"};
+#endif
+}
+
+void MemoryMappedFile::AdviseSequentialAccess(uint64_t offset, uint64_t size) const {
+#ifdef __linux
+  if (offset >= size_) return;
+  // madvise requires a page-aligned start address.
+  static const uint64_t kPageSize = sysconf(_SC_PAGESIZE);
+  const uint64_t aligned_offset = offset - offset % kPageSize;
+  const uint64_t aligned_size = std::min<uint64_t>(size, size_ - offset) + offset % kPageSize;
+  if (madvise(const_cast<uint8_t*>(data_ + aligned_offset), aligned_size, MADV_SEQUENTIAL) != 0) {
+    ORBIT_ERROR("Unable to advise sequential access to capture file: %s", SafeStrerror(errno));
+  }
+#else
+  (void)offset;
+  (void)size;
+#endif
+}
+
+}  // namespace orbit_capture_file_internal
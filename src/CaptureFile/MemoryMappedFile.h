@@ -0,0 +1,64 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MEMORY_MAPPED_FILE_H_
+#define MEMORY_MAPPED_FILE_H_
+
+#include <absl/types/span.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <utility>
+
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_capture_file_internal {
+
+// A read-only, shared mapping of the whole content of a file. Reading through the mapping avoids
+// copying the file content out of the page cache, which repeated opens of the same file share. As
+// the mapping is shared, later writes to the file through the file descriptor are visible through
+// it, but changes of the file size are not: the file needs to be mapped again. Accessing the pages
+// of the mapping that are beyond the end of a truncated file raises SIGBUS, so readers need to
+// bound their accesses with GetFileSize.
+//
+// Instances are held through shared_ptr so that input streams over the mapping can keep it alive.
+class MemoryMappedFile {
+ public:
+  // Maps the first `size` bytes of the file. Returns an error if mapping is not supported on this
+  // platform, or if `size` is zero.
+  [[nodiscard]] static ErrorMessageOr<std::shared_ptr<const MemoryMappedFile>> Create(
+      const orbit_base::UniqueFd& fd, uint64_t size);
+
+  ~MemoryMappedFile();
+
+  MemoryMappedFile(const MemoryMappedFile&) = delete;
+  MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+  MemoryMappedFile(MemoryMappedFile&&) = delete;
+  MemoryMappedFile& operator=(MemoryMappedFile&&) = delete;
+
+  [[nodiscard]] absl::Span<const uint8_t> GetData() const { return {data_, size_}; }
+
+  // Returns the current size of the mapped file, which might be smaller than the mapping.
+  [[nodiscard]] ErrorMessageOr<uint64_t> GetFileSize() const;
+
+  // Hints the kernel that the given range will be read sequentially, so that it reads ahead more
+  // aggressively and can drop pages that have been read. The range is clamped to the mapping.
+  void AdviseSequentialAccess(uint64_t offset, uint64_t size) const;
+
+ private:
+  MemoryMappedFile(orbit_base::UniqueFd fd, const uint8_t* data, size_t size)
+      : fd_{std::move(fd)}, data_{data}, size_{size} {}
+
+  // A duplicate of the file descriptor the file was mapped from, so that the mapping doesn't depend
+  // on the lifetime of the original.
+  orbit_base::UniqueFd fd_;
+  const uint8_t* data_;
+  size_t size_;
+};
+
+}  // namespace orbit_capture_file_internal
+
+#endif  // MEMORY_MAPPED_FILE_H_
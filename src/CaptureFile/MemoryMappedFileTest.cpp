@@ -0,0 +1,56 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string_view>
+#include <utility>
+
+#include "MemoryMappedFile.h"
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+#include "TestUtils/TemporaryFile.h"
+#include "TestUtils/TestUtils.h"
+
+namespace orbit_capture_file_internal {
+
+using orbit_test_utils::HasError;
+using orbit_test_utils::HasNoError;
+
+#ifdef __linux
+[[nodiscard]] static std::string_view ToStringView(absl::Span<const uint8_t> data) {
+  return {reinterpret_cast<const char*>(data.data()), data.size()};
+}
+
+TEST(MemoryMappedFile, MapsTheFileContent) {
+  auto temporary_file_or_error = orbit_test_utils::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, HasNoError());
+  orbit_test_utils::TemporaryFile temporary_file = std::move(temporary_file_or_error.value());
+  ASSERT_THAT(orbit_base::WriteFully(temporary_file.fd(), "some file content"), HasNoError());
+
+  auto mapping_or_error = MemoryMappedFile::Create(temporary_file.fd(), 17);
+  ASSERT_THAT(mapping_or_error, HasNoError());
+  std::shared_ptr<const MemoryMappedFile> mapping = std::move(mapping_or_error.value());
+  EXPECT_EQ(ToStringView(mapping->GetData()), "some file content");
+
+  // The mapping is shared, so writes to the file are visible through it.
+  ASSERT_THAT(orbit_base::WriteFullyAtOffset(temporary_file.fd(), "FILE", 4, 5), HasNoError());
+  EXPECT_EQ(ToStringView(mapping->GetData()), "some FILE content");
+
+  // This is only a hint, it must not fail even for ranges beyond the mapping.
+  mapping->AdviseSequentialAccess(0, 17);
+  mapping->AdviseSequentialAccess(5, 100);
+  mapping->AdviseSequentialAccess(100, 100);
+}
+#endif
+
+TEST(MemoryMappedFile, EmptyFileCannotBeMapped) {
+  auto temporary_file_or_error = orbit_test_utils::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, HasNoError());
+  EXPECT_THAT(MemoryMappedFile::Create(temporary_file_or_error.value().fd(), 0), HasError());
+}
+
+}  // namespace orbit_capture_file_internal
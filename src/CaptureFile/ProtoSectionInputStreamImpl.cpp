@@ -14,38 +14,41 @@ namespace orbit_capture_file_internal {
 
 constexpr uint64_t kMaximumMessageSize = 1024 * 1024;  // 1Mb
 
-ErrorMessageOr<void> ProtoSectionInputStreamImpl::ReadMessage(google::protobuf::Message* message) {
+ErrorMessageOr<uint32_t> ProtoSectionInputStreamImpl::ReadMessageSize() {
   // CodedInputStream imposes a hard limit on the total number of bytes it will read. It's INT_MAX
   // by default and it cannot be increased past that. To work around the limitation, reinitialize
-  // the CodedInputStream, as the actual current position is kept by the FileFragmentInputStream
-  // instead. Note that this makes CodedInputStream::CurrentPosition not always reflect the actual
-  // position in the stream.
+  // the CodedInputStream, as the actual current position is kept by the FileFragmentInputStream (or
+  // by the CompressedChunksInputStream) instead. Note that this makes
+  // CodedInputStream::CurrentPosition not always reflect the actual position in the stream.
   if (coded_input_stream_->CurrentPosition() >= kCodedInputStreamReinitializationThreshold) {
-    coded_input_stream_.emplace(&file_fragment_input_stream_);
+    coded_input_stream_.emplace(input_stream_);
     coded_input_stream_->SetTotalBytesLimit(kCodedInputStreamTotalBytesLimit);
   }
 
   uint32_t message_size = 0;
 
-  // Note that in case there was an error CodedInputStream does not provide error messages/codes.
-  // We need to go to underlying stream (file_fragment_input_stream_ in this case) to get the error
-  // message in case of a failure.
   if (!coded_input_stream_->ReadVarint32(&message_size)) {
-    return file_fragment_input_stream_.GetLastError().value_or(
+    return GetLastErrorOfInputStream().value_or(
         ErrorMessage{"Unexpected end of section while reading message size"});
   }
 
   // Since file input is not trusted, having too big value here may lead to out-of-memory allocation
-  // below. Do a sanity check for message size, we limit our messages to 1Mb maximum size.
+  // by the caller. Do a sanity check for message size, we limit our messages to 1Mb maximum size.
   if (message_size > kMaximumMessageSize) {
     return ErrorMessage{
         absl::StrFormat("The message size %d is too big (maximum allowed message size is %d)",
                         message_size, kMaximumMessageSize)};
   }
 
+  return message_size;
+}
+
+ErrorMessageOr<void> ProtoSectionInputStreamImpl::ReadMessage(google::protobuf::Message* message) {
+  OUTCOME_TRY(const uint32_t message_size, ReadMessageSize());
+
   auto buf = make_unique_for_overwrite<uint8_t[]>(message_size);
   if (!coded_input_stream_->ReadRaw(buf.get(), message_size)) {
-    return file_fragment_input_stream_.GetLastError().value_or(
+    return GetLastErrorOfInputStream().value_or(
         ErrorMessage{"Unexpected end of section while reading the message"});
   }
 
@@ -60,4 +63,25 @@ ErrorMessageOr<void> ProtoSectionInputStreamImpl::ReadMessage(google::protobuf::
   return outcome::success();
 }
 
+ErrorMessageOr<uint32_t> ProtoSectionInputStreamImpl::ReadMessageBytes(std::string* message_bytes) {
+  OUTCOME_TRY(const uint32_t message_size, ReadMessageSize());
+
+  const size_t message_offset = message_bytes->size();
+  message_bytes->resize(message_offset + message_size);
+  if (!coded_input_stream_->ReadRaw(message_bytes->data() + message_offset, message_size)) {
+    message_bytes->resize(message_offset);
+    return GetLastErrorOfInputStream().value_or(
+        ErrorMessage{"Unexpected end of section while reading the message"});
+  }
+
+  return message_size;
+}
+
+std::optional<ErrorMessage> ProtoSectionInputStreamImpl::GetLastErrorOfInputStream() const {
+  if (compressed_chunks_input_stream_.has_value()) {
+    return compressed_chunks_input_stream_->GetLastError();
+  }
+  return file_fragment_input_stream_.GetLastError();
+}
+
 }  // namespace orbit_capture_file_internal
\ No newline at end of file
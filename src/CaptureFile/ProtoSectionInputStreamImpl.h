@@ -10,11 +10,15 @@
 #include <stdint.h>
 
 #include <limits>
+#include <memory>
 #include <optional>
+#include <string>
 #include <utility>
 
 #include "CaptureFile/ProtoSectionInputStream.h"
+#include "CompressedChunksInputStream.h"
 #include "FileFragmentInputStream.h"
+#include "MemoryMappedFile.h"
 #include "OrbitBase/File.h"
 #include "OrbitBase/Result.h"
 
@@ -23,23 +27,57 @@ namespace orbit_capture_file_internal {
 // This class is used to read proto messages from a section of capture file.
 class ProtoSectionInputStreamImpl : public orbit_capture_file::ProtoSectionInputStream {
  public:
+  // How the size-prefixed messages are stored in the section.
+  enum class SectionEncoding {
+    // The messages directly follow each other.
+    kPlain,
+    // The messages are grouped in chunks which can be compressed (see CompressedChunksInputStream).
+    kCompressedChunks
+  };
+
   explicit ProtoSectionInputStreamImpl(orbit_base::UniqueFd& fd, uint64_t capture_section_offset,
-                                       uint64_t capture_section_size)
-      : fd_{fd},
-        file_fragment_input_stream_{fd_, capture_section_offset, capture_section_size},
-        coded_input_stream_{std::in_place, &file_fragment_input_stream_} {
-    coded_input_stream_->SetTotalBytesLimit(kCodedInputStreamTotalBytesLimit);
+                                       uint64_t capture_section_size,
+                                       SectionEncoding encoding = SectionEncoding::kPlain)
+      : file_fragment_input_stream_{fd, capture_section_offset, capture_section_size} {
+    InitializeInputStreams(encoding);
+  }
+
+  // Reads the section directly from the mapped file.
+  explicit ProtoSectionInputStreamImpl(std::shared_ptr<const MemoryMappedFile> mapping,
+                                       uint64_t capture_section_offset,
+                                       uint64_t capture_section_size,
+                                       SectionEncoding encoding = SectionEncoding::kPlain)
+      : file_fragment_input_stream_{std::move(mapping), capture_section_offset,
+                                    capture_section_size} {
+    InitializeInputStreams(encoding);
   }
 
   ErrorMessageOr<void> ReadMessage(google::protobuf::Message* message) override;
+  ErrorMessageOr<uint32_t> ReadMessageBytes(std::string* message_bytes) override;
 
  private:
   static constexpr int kCodedInputStreamTotalBytesLimit = std::numeric_limits<int>::max();
   static constexpr int kCodedInputStreamReinitializationThreshold =
       kCodedInputStreamTotalBytesLimit / 2;
 
-  orbit_base::UniqueFd& fd_;
+  void InitializeInputStreams(SectionEncoding encoding) {
+    if (encoding == SectionEncoding::kCompressedChunks) {
+      compressed_chunks_input_stream_.emplace(&file_fragment_input_stream_);
+      input_stream_ = &compressed_chunks_input_stream_.value();
+    }
+    coded_input_stream_.emplace(input_stream_);
+    coded_input_stream_->SetTotalBytesLimit(kCodedInputStreamTotalBytesLimit);
+  }
+
+  [[nodiscard]] ErrorMessageOr<uint32_t> ReadMessageSize();
+
+  // Note that in case there was an error CodedInputStream does not provide error messages/codes.
+  // We need to go to the underlying stream to get the error message in case of a failure.
+  [[nodiscard]] std::optional<ErrorMessage> GetLastErrorOfInputStream() const;
+
   FileFragmentInputStream file_fragment_input_stream_;
+  std::optional<CompressedChunksInputStream> compressed_chunks_input_stream_;
+  google::protobuf::io::ZeroCopyInputStream* input_stream_ = &file_fragment_input_stream_;
   std::optional<google::protobuf::io::CodedInputStream> coded_input_stream_;
 };
 
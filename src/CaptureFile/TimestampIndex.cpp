@@ -0,0 +1,210 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "TimestampIndex.h"
+
+#include <absl/base/casts.h>
+#include <absl/strings/str_format.h>
+#include <google/protobuf/io/coded_stream.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace orbit_capture_file_internal {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+
+std::optional<uint64_t> GetCaptureEventTimestampNs(const ClientCaptureEvent& event) {
+  switch (event.event_case()) {
+    case ClientCaptureEvent::kApiScopeStart:
+      return event.api_scope_start().timestamp_ns();
+    case ClientCaptureEvent::kApiScopeStartAsync:
+      return event.api_scope_start_async().timestamp_ns();
+    case ClientCaptureEvent::kApiScopeStop:
+      return event.api_scope_stop().timestamp_ns();
+    case ClientCaptureEvent::kApiScopeStopAsync:
+      return event.api_scope_stop_async().timestamp_ns();
+    case ClientCaptureEvent::kApiStringEvent:
+      return event.api_string_event().timestamp_ns();
+    case ClientCaptureEvent::kApiTrackDouble:
+      return event.api_track_double().timestamp_ns();
+    case ClientCaptureEvent::kApiTrackFloat:
+      return event.api_track_float().timestamp_ns();
+    case ClientCaptureEvent::kApiTrackInt:
+      return event.api_track_int().timestamp_ns();
+    case ClientCaptureEvent::kApiTrackInt64:
+      return event.api_track_int64().timestamp_ns();
+    case ClientCaptureEvent::kApiTrackUint:
+      return event.api_track_uint().timestamp_ns();
+    case ClientCaptureEvent::kApiTrackUint64:
+      return event.api_track_uint64().timestamp_ns();
+    case ClientCaptureEvent::kCallstackSample:
+      return event.callstack_sample().timestamp_ns();
+    case ClientCaptureEvent::kCaptureStarted:
+      return event.capture_started().capture_start_timestamp_ns();
+    case ClientCaptureEvent::kClockResolutionEvent:
+      return event.clock_resolution_event().timestamp_ns();
+    case ClientCaptureEvent::kErrorEnablingOrbitApiEvent:
+      return event.error_enabling_orbit_api_event().timestamp_ns();
+    case ClientCaptureEvent::kErrorEnablingUserSpaceInstrumentationEvent:
+      return event.error_enabling_user_space_instrumentation_event().timestamp_ns();
+    case ClientCaptureEvent::kErrorsWithPerfEventOpenEvent:
+      return event.errors_with_perf_event_open_event().timestamp_ns();
+    case ClientCaptureEvent::kFunctionCall:
+      return event.function_call().end_timestamp_ns();
+    case ClientCaptureEvent::kGpuJob:
+      return event.gpu_job().dma_fence_signaled_time_ns();
+    case ClientCaptureEvent::kGpuQueueSubmission:
+      return event.gpu_queue_submission().meta_info().post_submission_cpu_timestamp();
+    case ClientCaptureEvent::kLostPerfRecordsEvent:
+      return event.lost_perf_records_event().end_timestamp_ns();
+    case ClientCaptureEvent::kMemoryUsageEvent:
+      return event.memory_usage_event().timestamp_ns();
+    case ClientCaptureEvent::kModulesSnapshot:
+      return event.modules_snapshot().timestamp_ns();
+    case ClientCaptureEvent::kModuleUpdateEvent:
+      return event.module_update_event().timestamp_ns();
+    case ClientCaptureEvent::kOutOfOrderEventsDiscardedEvent:
+      return event.out_of_order_events_discarded_event().end_timestamp_ns();
+    case ClientCaptureEvent::kPresentEvent:
+      return event.present_event().begin_timestamp_ns() + event.present_event().duration_ns();
+    case ClientCaptureEvent::kSchedulingSlice:
+      return event.scheduling_slice().out_timestamp_ns();
+    case ClientCaptureEvent::kThreadName:
+      return event.thread_name().timestamp_ns();
+    case ClientCaptureEvent::kThreadNamesSnapshot:
+      return event.thread_names_snapshot().timestamp_ns();
+    case ClientCaptureEvent::kThreadStateSlice:
+      return event.thread_state_slice().end_timestamp_ns();
+    case ClientCaptureEvent::kTracepointEvent:
+      return event.tracepoint_event().timestamp_ns();
+    case ClientCaptureEvent::kWarningEvent:
+      return event.warning_event().timestamp_ns();
+    case ClientCaptureEvent::kWarningInstrumentingWithUprobesEvent:
+      return event.warning_instrumenting_with_uprobes_event().timestamp_ns();
+    case ClientCaptureEvent::kWarningInstrumentingWithUserSpaceInstrumentationEvent:
+      return event.warning_instrumenting_with_user_space_instrumentation_event().timestamp_ns();
+    case ClientCaptureEvent::kAddressInfo:
+    case ClientCaptureEvent::kCaptureFinished:
+    case ClientCaptureEvent::kInternedCallstack:
+    case ClientCaptureEvent::kInternedString:
+    case ClientCaptureEvent::kInternedTracepointInfo:
+    case ClientCaptureEvent::EVENT_NOT_SET:
+      return std::nullopt;
+  }
+  return std::nullopt;
+}
+
+bool IsSeekContextEvent(const ClientCaptureEvent& event) {
+  switch (event.event_case()) {
+    case ClientCaptureEvent::kAddressInfo:
+    case ClientCaptureEvent::kCaptureStarted:
+    case ClientCaptureEvent::kClockResolutionEvent:
+    case ClientCaptureEvent::kInternedCallstack:
+    case ClientCaptureEvent::kInternedString:
+    case ClientCaptureEvent::kInternedTracepointInfo:
+    case ClientCaptureEvent::kModulesSnapshot:
+    case ClientCaptureEvent::kModuleUpdateEvent:
+    case ClientCaptureEvent::kThreadName:
+    case ClientCaptureEvent::kThreadNamesSnapshot:
+      return true;
+    default:
+      return false;
+  }
+}
+
+void TimestampIndexBuilder::AddCheckpoint(uint64_t offset_in_capture_section) {
+  // A checkpoint at the start of the capture section would be redundant.
+  if (event_count_ == 0) return;
+  checkpoints_.push_back({.max_timestamp_ns_before = max_timestamp_ns_,
+                          .offset_in_capture_section = offset_in_capture_section,
+                          .event_count_before = event_count_,
+                          .seek_context_event_count_before = seek_context_event_count_});
+  last_checkpoint_offset_ = offset_in_capture_section;
+}
+
+void TimestampIndexBuilder::AddCheckpointIfDue(uint64_t offset_in_capture_section) {
+  if (offset_in_capture_section - last_checkpoint_offset_ >= kCheckpointInterval) {
+    AddCheckpoint(offset_in_capture_section);
+  }
+}
+
+void TimestampIndexBuilder::AddEvent(const ClientCaptureEvent& event) {
+  ++event_count_;
+  std::optional<uint64_t> timestamp_ns = GetCaptureEventTimestampNs(event);
+  if (timestamp_ns.has_value()) {
+    max_timestamp_ns_ = std::max(max_timestamp_ns_, timestamp_ns.value());
+  }
+
+  if (!IsSeekContextEvent(event)) return;
+  const uint32_t event_size = event.ByteSizeLong();
+  const size_t offset = pending_seek_context_.size();
+  pending_seek_context_.resize(
+      offset + google::protobuf::io::CodedOutputStream::VarintSize32(event_size) + event_size);
+  uint8_t* target = google::protobuf::io::CodedOutputStream::WriteVarint32ToArray(
+      event_size, absl::bit_cast<uint8_t*>(pending_seek_context_.data() + offset));
+  event.SerializeWithCachedSizesToArray(target);
+  ++seek_context_event_count_;
+}
+
+std::string SerializeTimestampIndex(absl::Span<const TimestampIndexCheckpoint> checkpoints) {
+  const uint64_t number_of_checkpoints = checkpoints.size();
+  std::string content{absl::bit_cast<const char*>(&number_of_checkpoints),
+                      sizeof(number_of_checkpoints)};
+  content.append(absl::bit_cast<const char*>(checkpoints.data()),
+                 checkpoints.size() * sizeof(TimestampIndexCheckpoint));
+  return content;
+}
+
+ErrorMessageOr<std::vector<TimestampIndexCheckpoint>> ParseTimestampIndex(
+    std::string_view section_content, uint64_t capture_section_size) {
+  uint64_t number_of_checkpoints = 0;
+  if (section_content.size() < sizeof(number_of_checkpoints)) {
+    return ErrorMessage{"Timestamp index section is too small"};
+  }
+  std::memcpy(&number_of_checkpoints, section_content.data(), sizeof(number_of_checkpoints));
+  section_content.remove_prefix(sizeof(number_of_checkpoints));
+
+  if (section_content.size() / sizeof(TimestampIndexCheckpoint) < number_of_checkpoints) {
+    return ErrorMessage{absl::StrFormat(
+        "Timestamp index section is too small for %d checkpoints", number_of_checkpoints)};
+  }
+
+  std::vector<TimestampIndexCheckpoint> checkpoints(number_of_checkpoints);
+  std::memcpy(checkpoints.data(), section_content.data(),
+              number_of_checkpoints * sizeof(TimestampIndexCheckpoint));
+
+  // FindCheckpointBefore relies on offsets and timestamps being ordered.
+  for (size_t i = 0; i < checkpoints.size(); ++i) {
+    const TimestampIndexCheckpoint& checkpoint = checkpoints[i];
+    if (checkpoint.offset_in_capture_section >= capture_section_size) {
+      return ErrorMessage{absl::StrFormat(
+          "Checkpoint %d of the timestamp index is outside of the capture section", i)};
+    }
+    if (i == 0) continue;
+    const TimestampIndexCheckpoint& previous_checkpoint = checkpoints[i - 1];
+    if (checkpoint.offset_in_capture_section <= previous_checkpoint.offset_in_capture_section ||
+        checkpoint.max_timestamp_ns_before < previous_checkpoint.max_timestamp_ns_before ||
+        checkpoint.seek_context_event_count_before <
+            previous_checkpoint.seek_context_event_count_before) {
+      return ErrorMessage{
+          absl::StrFormat("Checkpoint %d of the timestamp index is out of order", i)};
+    }
+  }
+
+  return checkpoints;
+}
+
+std::optional<TimestampIndexCheckpoint> FindCheckpointBefore(
+    absl::Span<const TimestampIndexCheckpoint> checkpoints, uint64_t timestamp_ns) {
+  auto it = std::partition_point(checkpoints.begin(), checkpoints.end(),
+                                 [timestamp_ns](const TimestampIndexCheckpoint& checkpoint) {
+                                   return checkpoint.max_timestamp_ns_before < timestamp_ns;
+                                 });
+  if (it == checkpoints.begin()) return std::nullopt;
+  return *std::prev(it);
+}
+
+}  // namespace orbit_capture_file_internal
@@ -0,0 +1,98 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TIMESTAMP_INDEX_H_
+#define TIMESTAMP_INDEX_H_
+
+#include <absl/types/span.h>
+#include <stdint.h>
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "GrpcProtos/capture.pb.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_capture_file_internal {
+
+// An entry of the TIMESTAMP_INDEX section, see FORMAT.md.
+struct TimestampIndexCheckpoint {
+  // The largest timestamp of the events before the checkpoint.
+  uint64_t max_timestamp_ns_before;
+  // Where reading the capture section can start. This is always the start of a message, or, in
+  // version 2 of the format, of a chunk.
+  uint64_t offset_in_capture_section;
+  // The number of messages before the checkpoint.
+  uint64_t event_count_before;
+  // The number of messages of the SEEK_CONTEXT section that need to be replayed before reading
+  // from the checkpoint, i.e., the number of messages before the checkpoint for which
+  // IsSeekContextEvent is true.
+  uint64_t seek_context_event_count_before;
+};
+static_assert(sizeof(TimestampIndexCheckpoint) == 32);
+
+// Returns the timestamp that the index uses for `event`, which is the end of the event for events
+// with a duration, or std::nullopt for events that have no timestamp, like interned strings.
+[[nodiscard]] std::optional<uint64_t> GetCaptureEventTimestampNs(
+    const orbit_grpc_protos::ClientCaptureEvent& event);
+
+// Returns whether `event` can be needed to process the events after it, and so needs to be
+// replayed when reading starts at a checkpoint: CaptureStarted, the interned strings, callstacks
+// and tracepoint infos, the AddressInfos, which refer to interned strings, the modules and thread
+// names, which are mostly only sent in snapshots at the start of the capture, and the clock
+// resolution.
+[[nodiscard]] bool IsSeekContextEvent(const orbit_grpc_protos::ClientCaptureEvent& event);
+
+// Collects the checkpoints of the timestamp index while the capture section is being written.
+class TimestampIndexBuilder {
+ public:
+  // When the capture section is not split into chunks, the checkpoints are about this far apart.
+  static constexpr uint64_t kCheckpointInterval = 1024 * 1024;  // 1Mb
+
+  // Adds a checkpoint at `offset_in_capture_section`, where the next event or chunk is written.
+  void AddCheckpoint(uint64_t offset_in_capture_section);
+  // Adds a checkpoint if the previous one is at least kCheckpointInterval bytes before.
+  void AddCheckpointIfDue(uint64_t offset_in_capture_section);
+  // Needs to be called for each event, in the order in which they are written.
+  void AddEvent(const orbit_grpc_protos::ClientCaptureEvent& event);
+
+  [[nodiscard]] const std::vector<TimestampIndexCheckpoint>& GetCheckpoints() const {
+    return checkpoints_;
+  }
+  // Returns the part of the content of the SEEK_CONTEXT section added since the previous call: the
+  // events for which IsSeekContextEvent is true, each prefixed by its size like in the capture
+  // section. Taking it regularly keeps the seek context of long captures out of memory.
+  [[nodiscard]] std::string TakeSeekContext() { return std::exchange(pending_seek_context_, {}); }
+  [[nodiscard]] size_t GetPendingSeekContextSize() const { return pending_seek_context_.size(); }
+
+ private:
+  std::vector<TimestampIndexCheckpoint> checkpoints_;
+  uint64_t last_checkpoint_offset_ = 0;
+  uint64_t max_timestamp_ns_ = 0;
+  uint64_t event_count_ = 0;
+  std::string pending_seek_context_;
+  uint64_t seek_context_event_count_ = 0;
+};
+
+// Returns the content of a TIMESTAMP_INDEX section with these checkpoints.
+[[nodiscard]] std::string SerializeTimestampIndex(
+    absl::Span<const TimestampIndexCheckpoint> checkpoints);
+
+// Parses the content of a TIMESTAMP_INDEX section and checks that the checkpoints are consistent
+// with a capture section of `capture_section_size` bytes, and ordered.
+[[nodiscard]] ErrorMessageOr<std::vector<TimestampIndexCheckpoint>> ParseTimestampIndex(
+    std::string_view section_content, uint64_t capture_section_size);
+
+// Returns the checkpoint from which all events with a timestamp of at least `timestamp_ns` can be
+// read, as it is preceded only by older events, or std::nullopt if that is the start of the capture
+// section.
+[[nodiscard]] std::optional<TimestampIndexCheckpoint> FindCheckpointBefore(
+    absl::Span<const TimestampIndexCheckpoint> checkpoints, uint64_t timestamp_ns);
+
+}  // namespace orbit_capture_file_internal
+
+#endif  // TIMESTAMP_INDEX_H_
@@ -0,0 +1,159 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "GrpcProtos/capture.pb.h"
+#include "TestUtils/TestUtils.h"
+#include "TimestampIndex.h"
+
+namespace orbit_capture_file_internal {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+using orbit_test_utils::HasErrorWithMessage;
+using orbit_test_utils::HasNoError;
+
+static ClientCaptureEvent CreateSchedulingSliceEvent(uint64_t out_timestamp_ns) {
+  ClientCaptureEvent event;
+  event.mutable_scheduling_slice()->set_out_timestamp_ns(out_timestamp_ns);
+  event.mutable_scheduling_slice()->set_duration_ns(100);
+  return event;
+}
+
+static bool operator==(const TimestampIndexCheckpoint& lhs, const TimestampIndexCheckpoint& rhs) {
+  return lhs.max_timestamp_ns_before == rhs.max_timestamp_ns_before &&
+         lhs.offset_in_capture_section == rhs.offset_in_capture_section &&
+         lhs.event_count_before == rhs.event_count_before &&
+         lhs.seek_context_event_count_before == rhs.seek_context_event_count_before;
+}
+
+TEST(TimestampIndex, GetCaptureEventTimestampNs) {
+  EXPECT_EQ(GetCaptureEventTimestampNs(CreateSchedulingSliceEvent(42)), 42);
+
+  ClientCaptureEvent function_call;
+  function_call.mutable_function_call()->set_end_timestamp_ns(43);
+  function_call.mutable_function_call()->set_duration_ns(10);
+  EXPECT_EQ(GetCaptureEventTimestampNs(function_call), 43);
+
+  ClientCaptureEvent present_event;
+  present_event.mutable_present_event()->set_begin_timestamp_ns(40);
+  present_event.mutable_present_event()->set_duration_ns(4);
+  EXPECT_EQ(GetCaptureEventTimestampNs(present_event), 44);
+
+  ClientCaptureEvent interned_string;
+  interned_string.mutable_interned_string()->set_key(1);
+  EXPECT_EQ(GetCaptureEventTimestampNs(interned_string), std::nullopt);
+
+  EXPECT_EQ(GetCaptureEventTimestampNs(ClientCaptureEvent{}), std::nullopt);
+}
+
+TEST(TimestampIndex, BuilderAddsCheckpointsAtInterval) {
+  constexpr uint64_t kInterval = TimestampIndexBuilder::kCheckpointInterval;
+  TimestampIndexBuilder builder;
+
+  // No checkpoint is needed at the start of the section.
+  builder.AddCheckpoint(0);
+  builder.AddEvent(CreateSchedulingSliceEvent(100));
+  builder.AddCheckpointIfDue(kInterval - 1);
+  EXPECT_TRUE(builder.GetCheckpoints().empty());
+
+  builder.AddEvent(CreateSchedulingSliceEvent(300));
+  builder.AddCheckpointIfDue(kInterval);
+  // Older events don't decrease the timestamp of the following checkpoints.
+  builder.AddEvent(CreateSchedulingSliceEvent(200));
+  builder.AddCheckpointIfDue(2 * kInterval - 1);
+  builder.AddCheckpoint(2 * kInterval);
+
+  EXPECT_THAT(builder.GetCheckpoints(),
+              testing::ElementsAre(TimestampIndexCheckpoint{300, kInterval, 2, 0},
+                                   TimestampIndexCheckpoint{300, 2 * kInterval, 3, 0}));
+}
+
+TEST(TimestampIndex, BuilderCollectsSeekContext) {
+  TimestampIndexBuilder builder;
+  ClientCaptureEvent capture_started;
+  capture_started.mutable_capture_started()->set_capture_start_timestamp_ns(1);
+  ClientCaptureEvent interned_string;
+  interned_string.mutable_interned_string()->set_key(42);
+  interned_string.mutable_interned_string()->set_intern("answer");
+
+  EXPECT_TRUE(IsSeekContextEvent(capture_started));
+  EXPECT_TRUE(IsSeekContextEvent(interned_string));
+  ClientCaptureEvent modules_snapshot;
+  modules_snapshot.mutable_modules_snapshot()->add_modules()->set_file_path("/path/to/module");
+  EXPECT_TRUE(IsSeekContextEvent(modules_snapshot));
+  ClientCaptureEvent thread_names_snapshot;
+  thread_names_snapshot.mutable_thread_names_snapshot()->add_thread_names()->set_name("thread");
+  EXPECT_TRUE(IsSeekContextEvent(thread_names_snapshot));
+  EXPECT_FALSE(IsSeekContextEvent(CreateSchedulingSliceEvent(100)));
+
+  auto serialize_with_size = [](const ClientCaptureEvent& event) {
+    std::string serialized(1, static_cast<char>(event.ByteSizeLong()));
+    serialized.append(event.SerializeAsString());
+    return serialized;
+  };
+
+  builder.AddEvent(capture_started);
+  builder.AddEvent(CreateSchedulingSliceEvent(100));
+  builder.AddCheckpoint(1000);
+  EXPECT_EQ(builder.GetPendingSeekContextSize(), serialize_with_size(capture_started).size());
+  EXPECT_EQ(builder.TakeSeekContext(), serialize_with_size(capture_started));
+  EXPECT_EQ(builder.GetPendingSeekContextSize(), 0);
+
+  builder.AddEvent(interned_string);
+  builder.AddEvent(CreateSchedulingSliceEvent(200));
+  builder.AddCheckpoint(2000);
+
+  EXPECT_THAT(builder.GetCheckpoints(),
+              testing::ElementsAre(TimestampIndexCheckpoint{100, 1000, 2, 1},
+                                   TimestampIndexCheckpoint{200, 2000, 4, 2}));
+  EXPECT_EQ(builder.TakeSeekContext(), serialize_with_size(interned_string));
+}
+
+TEST(TimestampIndex, SerializeAndParse) {
+  const std::vector<TimestampIndexCheckpoint> checkpoints{
+      {100, 1000, 10, 1}, {100, 2000, 20, 2}, {300, 3000, 30, 2}};
+  const std::string section_content = SerializeTimestampIndex(checkpoints);
+  EXPECT_EQ(section_content.size(), 8 + 3 * 32);
+
+  auto parsed_checkpoints_or_error = ParseTimestampIndex(section_content, 4000);
+  ASSERT_THAT(parsed_checkpoints_or_error, HasNoError());
+  EXPECT_EQ(parsed_checkpoints_or_error.value(), checkpoints);
+
+  EXPECT_THAT(ParseTimestampIndex(section_content, 3000),
+              HasErrorWithMessage("outside of the capture section"));
+  EXPECT_THAT(ParseTimestampIndex(section_content.substr(0, 50), 4000),
+              HasErrorWithMessage("too small"));
+  EXPECT_THAT(ParseTimestampIndex(section_content.substr(0, 4), 4000),
+              HasErrorWithMessage("too small"));
+
+  const std::vector<TimestampIndexCheckpoint> unordered_checkpoints{{100, 2000, 10, 0},
+                                                                    {100, 1000, 20, 0}};
+  EXPECT_THAT(ParseTimestampIndex(SerializeTimestampIndex(unordered_checkpoints), 4000),
+              HasErrorWithMessage("out of order"));
+  const std::vector<TimestampIndexCheckpoint> unordered_seek_context{{100, 1000, 10, 2},
+                                                                     {100, 2000, 20, 1}};
+  EXPECT_THAT(ParseTimestampIndex(SerializeTimestampIndex(unordered_seek_context), 4000),
+              HasErrorWithMessage("out of order"));
+}
+
+TEST(TimestampIndex, FindCheckpointBefore) {
+  const std::vector<TimestampIndexCheckpoint> checkpoints{
+      {100, 1000, 10, 1}, {100, 2000, 20, 1}, {300, 3000, 30, 1}};
+
+  EXPECT_EQ(FindCheckpointBefore(checkpoints, 50), std::nullopt);
+  EXPECT_EQ(FindCheckpointBefore(checkpoints, 100), std::nullopt);
+  EXPECT_EQ(FindCheckpointBefore(checkpoints, 101), checkpoints[1]);
+  EXPECT_EQ(FindCheckpointBefore(checkpoints, 300), checkpoints[1]);
+  EXPECT_EQ(FindCheckpointBefore(checkpoints, 301), checkpoints[2]);
+  EXPECT_EQ(FindCheckpointBefore({}, 301), std::nullopt);
+}
+
+}  // namespace orbit_capture_file_internal
@@ -71,6 +71,16 @@ class CaptureFile {
 
   virtual std::unique_ptr<ProtoSectionInputStream> CreateCaptureSectionInputStream() = 0;
 
+  // Creates a stream over the capture section that skips as much as possible of the events before
+  // `timestamp_ns`, using the TIMESTAMP_INDEX section: the stream returns all the events with a
+  // timestamp of at least `timestamp_ns`, and some older events. When events are skipped, the
+  // stream first returns the skipped CaptureStarted, InternedString, InternedCallstack,
+  // InternedTracepointInfo and AddressInfo events, so that the events it returns can be processed
+  // like a whole capture section. Without the index, the stream starts at the beginning of the
+  // section.
+  virtual ErrorMessageOr<std::unique_ptr<ProtoSectionInputStream>>
+  CreateCaptureSectionInputStreamFromTimestamp(uint64_t timestamp_ns) = 0;
+
   static ErrorMessageOr<std::unique_ptr<CaptureFile>> OpenForReadWrite(
       const std::filesystem::path& file_path);
 
@@ -7,6 +7,8 @@
 
 #include <google/protobuf/message.h>
 
+#include <stdint.h>
+
 #include <filesystem>
 #include <memory>
 
@@ -16,6 +18,11 @@
 
 namespace orbit_capture_file {
 
+// Compression of the capture section. With kNone, files are written in version 1 of the format,
+// which older versions of Orbit can read. Otherwise, the capture section is split into chunks of
+// about 1 MB which are compressed independently (version 2). The values are stored in the file.
+enum class CaptureSectionCompression : uint32_t { kNone = 0, kZstd = 1, kLz4 = 2 };
+
 // This class in used for creating new capture file from
 // a stream of ClientCaptureEvents. If the file already exists
 // it is going to be overwritten. Appending to the existing file
@@ -54,9 +61,11 @@ class CaptureFileOutputStream {
   // Create new capture file output stream. If the file exists it is going to be
   // overwritten.
   [[nodiscard]] static ErrorMessageOr<std::unique_ptr<CaptureFileOutputStream>> Create(
-      std::filesystem::path path);
+      std::filesystem::path path,
+      CaptureSectionCompression compression = CaptureSectionCompression::kNone);
   [[nodiscard]] static std::unique_ptr<CaptureFileOutputStream> Create(
-      BufferOutputStream* output_buffer);
+      BufferOutputStream* output_buffer,
+      CaptureSectionCompression compression = CaptureSectionCompression::kNone);
 };
 
 }  // namespace orbit_capture_file
@@ -10,6 +10,8 @@
 namespace orbit_capture_file {
 
 constexpr uint64_t kSectionTypeUserData = 1;
+constexpr uint64_t kSectionTypeTimestampIndex = 2;
+constexpr uint64_t kSectionTypeSeekContext = 3;
 
 struct CaptureFileSection {
   uint64_t type;
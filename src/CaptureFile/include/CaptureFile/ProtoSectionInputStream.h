@@ -6,6 +6,9 @@
 #define CAPTURE_FILE_PROTO_SECTION_INPUT_STREAM_H_
 
 #include <google/protobuf/message.h>
+#include <stdint.h>
+
+#include <string>
 
 #include "OrbitBase/Result.h"
 
@@ -25,6 +28,11 @@ class ProtoSectionInputStream {
   // aligned to 8bytes. Reading beyond the CaptureFinished message will incorrectly
   // read padded zeros as empty messages until finally causing an end of section error.
   virtual ErrorMessageOr<void> ReadMessage(google::protobuf::Message* message) = 0;
+
+  // Reads the next message from the stream like ReadMessage, but instead of parsing it, appends its
+  // serialized bytes to `message_bytes`. Returns the size of the message. This allows parsing the
+  // messages later and on another thread.
+  virtual ErrorMessageOr<uint32_t> ReadMessageBytes(std::string* message_bytes) = 0;
 };
 
 }  // namespace orbit_capture_file
@@ -0,0 +1,329 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CaptureResponseEncoding/PackedCaptureEvents.h"
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/strings/str_format.h>
+#include <google/protobuf/repeated_ptr_field.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <array>
+#include <initializer_list>
+#include <numeric>
+#include <vector>
+
+#include "GrpcProtos/capture.pb.h"
+#include "OrbitBase/Logging.h"
+
+namespace orbit_capture_response_encoding {
+
+using orbit_grpc_protos::CallstackSample;
+using orbit_grpc_protos::CaptureResponse;
+using orbit_grpc_protos::ClientCaptureEvent;
+using orbit_grpc_protos::FunctionCall;
+using orbit_grpc_protos::PackedCaptureEvents;
+using orbit_grpc_protos::SchedulingSlice;
+
+namespace {
+
+// Converts between the timestamps of the events of one kind and their difference from the
+// timestamp of the previous event on the same thread. The arithmetic wraps around, so that any
+// sequence of timestamps round-trips.
+class PerThreadTimestampDeltas {
+ public:
+  explicit PerThreadTimestampDeltas(uint64_t base_timestamp_ns)
+      : base_timestamp_ns_{base_timestamp_ns} {}
+
+  [[nodiscard]] int64_t Encode(uint32_t tid, uint64_t timestamp_ns) {
+    uint64_t& previous_timestamp_ns = GetPreviousTimestampNs(tid);
+    const auto delta = static_cast<int64_t>(timestamp_ns - previous_timestamp_ns);
+    previous_timestamp_ns = timestamp_ns;
+    return delta;
+  }
+
+  [[nodiscard]] uint64_t Decode(uint32_t tid, int64_t delta) {
+    uint64_t& previous_timestamp_ns = GetPreviousTimestampNs(tid);
+    previous_timestamp_ns += static_cast<uint64_t>(delta);
+    return previous_timestamp_ns;
+  }
+
+ private:
+  [[nodiscard]] uint64_t& GetPreviousTimestampNs(uint32_t tid) {
+    return previous_timestamp_ns_by_tid_.try_emplace(tid, base_timestamp_ns_).first->second;
+  }
+
+  uint64_t base_timestamp_ns_;
+  absl::flat_hash_map<uint32_t, uint64_t> previous_timestamp_ns_by_tid_;
+};
+
+[[nodiscard]] PackedCaptureEvents::EventKind GetPackedEventKind(const ClientCaptureEvent& event) {
+  switch (event.event_case()) {
+    case ClientCaptureEvent::kSchedulingSlice:
+      return PackedCaptureEvents::kSchedulingSlice;
+    case ClientCaptureEvent::kCallstackSample:
+      return PackedCaptureEvents::kCallstackSample;
+    case ClientCaptureEvent::kFunctionCall:
+      // The registers are rare enough that they are not worth a column.
+      return event.function_call().registers().empty() ? PackedCaptureEvents::kFunctionCall
+                                                       : PackedCaptureEvents::kUnpacked;
+    default:
+      return PackedCaptureEvents::kUnpacked;
+  }
+}
+
+[[nodiscard]] uint64_t GetTimestampNs(const ClientCaptureEvent& event) {
+  switch (event.event_case()) {
+    case ClientCaptureEvent::kSchedulingSlice:
+      return event.scheduling_slice().out_timestamp_ns();
+    case ClientCaptureEvent::kCallstackSample:
+      return event.callstack_sample().timestamp_ns();
+    case ClientCaptureEvent::kFunctionCall:
+      return event.function_call().end_timestamp_ns();
+    default:
+      return 0;
+  }
+}
+
+void AppendToRuns(PackedCaptureEvents::EventKind kind, PackedCaptureEvents* packed_events) {
+  const int run_count = packed_events->run_kinds_size();
+  if (run_count > 0 && packed_events->run_kinds(run_count - 1) == kind) {
+    packed_events->set_run_lengths(run_count - 1, packed_events->run_lengths(run_count - 1) + 1);
+    return;
+  }
+  packed_events->add_run_kinds(kind);
+  packed_events->add_run_lengths(1);
+}
+
+void PackSchedulingSlice(const SchedulingSlice& scheduling_slice,
+                         PerThreadTimestampDeltas* timestamp_deltas,
+                         PackedCaptureEvents::SchedulingSlices* scheduling_slices) {
+  scheduling_slices->add_pid(scheduling_slice.pid());
+  scheduling_slices->add_tid(scheduling_slice.tid());
+  scheduling_slices->add_core(scheduling_slice.core());
+  scheduling_slices->add_duration_ns(scheduling_slice.duration_ns());
+  scheduling_slices->add_out_timestamp_ns_delta(
+      timestamp_deltas->Encode(scheduling_slice.tid(), scheduling_slice.out_timestamp_ns()));
+}
+
+void PackCallstackSample(const CallstackSample& callstack_sample,
+                         PerThreadTimestampDeltas* timestamp_deltas,
+                         PackedCaptureEvents::CallstackSamples* callstack_samples) {
+  callstack_samples->add_pid(callstack_sample.pid());
+  callstack_samples->add_tid(callstack_sample.tid());
+  callstack_samples->add_callstack_id(callstack_sample.callstack_id());
+  callstack_samples->add_timestamp_ns_delta(
+      timestamp_deltas->Encode(callstack_sample.tid(), callstack_sample.timestamp_ns()));
+}
+
+void PackFunctionCall(const FunctionCall& function_call, PerThreadTimestampDeltas* timestamp_deltas,
+                      PackedCaptureEvents::FunctionCalls* function_calls) {
+  function_calls->add_pid(function_call.pid());
+  function_calls->add_tid(function_call.tid());
+  function_calls->add_function_id(function_call.function_id());
+  function_calls->add_duration_ns(function_call.duration_ns());
+  function_calls->add_end_timestamp_ns_delta(
+      timestamp_deltas->Encode(function_call.tid(), function_call.end_timestamp_ns()));
+  function_calls->add_depth(function_call.depth());
+  function_calls->add_return_value(function_call.return_value());
+}
+
+void UnpackSchedulingSlice(const PackedCaptureEvents::SchedulingSlices& scheduling_slices,
+                           int index, PerThreadTimestampDeltas* timestamp_deltas,
+                           SchedulingSlice* scheduling_slice) {
+  scheduling_slice->set_pid(scheduling_slices.pid(index));
+  scheduling_slice->set_tid(scheduling_slices.tid(index));
+  scheduling_slice->set_core(scheduling_slices.core(index));
+  scheduling_slice->set_duration_ns(scheduling_slices.duration_ns(index));
+  scheduling_slice->set_out_timestamp_ns(timestamp_deltas->Decode(
+      scheduling_slices.tid(index), scheduling_slices.out_timestamp_ns_delta(index)));
+}
+
+void UnpackCallstackSample(const PackedCaptureEvents::CallstackSamples& callstack_samples,
+                           int index, PerThreadTimestampDeltas* timestamp_deltas,
+                           CallstackSample* callstack_sample) {
+  callstack_sample->set_pid(callstack_samples.pid(index));
+  callstack_sample->set_tid(callstack_samples.tid(index));
+  callstack_sample->set_callstack_id(callstack_samples.callstack_id(index));
+  callstack_sample->set_timestamp_ns(timestamp_deltas->Decode(
+      callstack_samples.tid(index), callstack_samples.timestamp_ns_delta(index)));
+}
+
+void UnpackFunctionCall(const PackedCaptureEvents::FunctionCalls& function_calls, int index,
+                        PerThreadTimestampDeltas* timestamp_deltas, FunctionCall* function_call) {
+  function_call->set_pid(function_calls.pid(index));
+  function_call->set_tid(function_calls.tid(index));
+  function_call->set_function_id(function_calls.function_id(index));
+  function_call->set_duration_ns(function_calls.duration_ns(index));
+  function_call->set_end_timestamp_ns(timestamp_deltas->Decode(
+      function_calls.tid(index), function_calls.end_timestamp_ns_delta(index)));
+  function_call->set_depth(function_calls.depth(index));
+  function_call->set_return_value(function_calls.return_value(index));
+}
+
+// Returns the number of packed events of each kind, or an error if the columns of a kind don't
+// have the same size or don't match the runs.
+[[nodiscard]] ErrorMessageOr<std::array<int, 4>> ValidatePackedCaptureEvents(
+    const PackedCaptureEvents& packed_events, int unpacked_event_count) {
+  if (packed_events.run_kinds_size() != packed_events.run_lengths_size()) {
+    return ErrorMessage{absl::StrFormat("PackedCaptureEvents has %d run kinds but %d run lengths",
+                                        packed_events.run_kinds_size(),
+                                        packed_events.run_lengths_size())};
+  }
+
+  std::array<uint64_t, 4> event_count_by_kind{};
+  for (int i = 0; i < packed_events.run_kinds_size(); ++i) {
+    const int kind = packed_events.run_kinds(i);
+    if (kind < 0 || kind >= static_cast<int>(event_count_by_kind.size())) {
+      return ErrorMessage{absl::StrFormat("PackedCaptureEvents has unknown event kind %d", kind)};
+    }
+    event_count_by_kind[kind] += packed_events.run_lengths(i);
+  }
+
+  const auto columns_have_size = [](uint64_t size, std::initializer_list<int> column_sizes) {
+    return std::all_of(column_sizes.begin(), column_sizes.end(), [size](int column_size) {
+      return static_cast<uint64_t>(column_size) == size;
+    });
+  };
+  const PackedCaptureEvents::SchedulingSlices& scheduling_slices =
+      packed_events.scheduling_slices();
+  const PackedCaptureEvents::CallstackSamples& callstack_samples =
+      packed_events.callstack_samples();
+  const PackedCaptureEvents::FunctionCalls& function_calls = packed_events.function_calls();
+  if (event_count_by_kind[PackedCaptureEvents::kUnpacked] !=
+          static_cast<uint64_t>(unpacked_event_count) ||
+      !columns_have_size(event_count_by_kind[PackedCaptureEvents::kSchedulingSlice],
+                         {scheduling_slices.pid_size(), scheduling_slices.tid_size(),
+                          scheduling_slices.core_size(), scheduling_slices.duration_ns_size(),
+                          scheduling_slices.out_timestamp_ns_delta_size()}) ||
+      !columns_have_size(event_count_by_kind[PackedCaptureEvents::kCallstackSample],
+                         {callstack_samples.pid_size(), callstack_samples.tid_size(),
+                          callstack_samples.callstack_id_size(),
+                          callstack_samples.timestamp_ns_delta_size()}) ||
+      !columns_have_size(event_count_by_kind[PackedCaptureEvents::kFunctionCall],
+                         {function_calls.pid_size(), function_calls.tid_size(),
+                          function_calls.function_id_size(), function_calls.duration_ns_size(),
+                          function_calls.end_timestamp_ns_delta_size(),
+                          function_calls.depth_size(), function_calls.return_value_size()})) {
+    return ErrorMessage{"PackedCaptureEvents has event counts that don't match its runs"};
+  }
+
+  // All counts fit in an int, as they are equal to the size of a repeated field.
+  std::array<int, 4> result{};
+  std::transform(event_count_by_kind.begin(), event_count_by_kind.end(), result.begin(),
+                 [](uint64_t count) { return static_cast<int>(count); });
+  return result;
+}
+
+}  // namespace
+
+void PackCaptureEvents(CaptureResponse* capture_response) {
+  google::protobuf::RepeatedPtrField<ClientCaptureEvent>* events =
+      capture_response->mutable_capture_events();
+  capture_response->clear_packed_capture_events();
+
+  auto first_packed_event_it =
+      std::find_if(events->begin(), events->end(), [](const ClientCaptureEvent& event) {
+        return GetPackedEventKind(event) != PackedCaptureEvents::kUnpacked;
+      });
+  if (first_packed_event_it == events->end()) return;
+
+  PackedCaptureEvents* packed_events = capture_response->mutable_packed_capture_events();
+  const uint64_t base_timestamp_ns = GetTimestampNs(*first_packed_event_it);
+  packed_events->set_base_timestamp_ns(base_timestamp_ns);
+  PerThreadTimestampDeltas scheduling_slice_deltas{base_timestamp_ns};
+  PerThreadTimestampDeltas callstack_sample_deltas{base_timestamp_ns};
+  PerThreadTimestampDeltas function_call_deltas{base_timestamp_ns};
+
+  // The events that are not packed are moved to the front, keeping their order, and the packed
+  // ones are then deleted from the back.
+  int unpacked_event_count = 0;
+  for (int i = 0; i < events->size(); ++i) {
+    const ClientCaptureEvent& event = events->Get(i);
+    const PackedCaptureEvents::EventKind kind = GetPackedEventKind(event);
+    AppendToRuns(kind, packed_events);
+    switch (kind) {
+      case PackedCaptureEvents::kSchedulingSlice:
+        PackSchedulingSlice(event.scheduling_slice(), &scheduling_slice_deltas,
+                            packed_events->mutable_scheduling_slices());
+        break;
+      case PackedCaptureEvents::kCallstackSample:
+        PackCallstackSample(event.callstack_sample(), &callstack_sample_deltas,
+                            packed_events->mutable_callstack_samples());
+        break;
+      case PackedCaptureEvents::kFunctionCall:
+        PackFunctionCall(event.function_call(), &function_call_deltas,
+                         packed_events->mutable_function_calls());
+        break;
+      default:
+        events->SwapElements(i, unpacked_event_count);
+        ++unpacked_event_count;
+        break;
+    }
+  }
+  events->DeleteSubrange(unpacked_event_count, events->size() - unpacked_event_count);
+}
+
+ErrorMessageOr<void> UnpackCaptureEvents(CaptureResponse* capture_response) {
+  if (!capture_response->has_packed_capture_events()) return outcome::success();
+
+  const PackedCaptureEvents& packed_events = capture_response->packed_capture_events();
+  google::protobuf::RepeatedPtrField<ClientCaptureEvent>* events =
+      capture_response->mutable_capture_events();
+  const int unpacked_event_count = events->size();
+  OUTCOME_TRY(auto&& event_count_by_kind,
+              ValidatePackedCaptureEvents(packed_events, unpacked_event_count));
+
+  const uint64_t base_timestamp_ns = packed_events.base_timestamp_ns();
+  PerThreadTimestampDeltas scheduling_slice_deltas{base_timestamp_ns};
+  PerThreadTimestampDeltas callstack_sample_deltas{base_timestamp_ns};
+  PerThreadTimestampDeltas function_call_deltas{base_timestamp_ns};
+
+  // The unpacked events are appended after the ones that were not packed, and the pointers to all
+  // events are then reordered, so that no event is copied.
+  const int event_count =
+      std::accumulate(event_count_by_kind.begin(), event_count_by_kind.end(), 0);
+  events->Reserve(event_count);
+  std::vector<ClientCaptureEvent*> ordered_events;
+  ordered_events.reserve(event_count);
+  int next_unpacked_event_index = 0;
+  std::array<int, 4> next_index_by_kind{};
+  for (int run_index = 0; run_index < packed_events.run_kinds_size(); ++run_index) {
+    const PackedCaptureEvents::EventKind kind = packed_events.run_kinds(run_index);
+    for (uint32_t i = 0; i < packed_events.run_lengths(run_index); ++i) {
+      if (kind == PackedCaptureEvents::kUnpacked) {
+        ordered_events.push_back(events->Mutable(next_unpacked_event_index));
+        ++next_unpacked_event_index;
+        continue;
+      }
+
+      ClientCaptureEvent* event = events->Add();
+      const int index = next_index_by_kind[kind]++;
+      switch (kind) {
+        case PackedCaptureEvents::kSchedulingSlice:
+          UnpackSchedulingSlice(packed_events.scheduling_slices(), index, &scheduling_slice_deltas,
+                                event->mutable_scheduling_slice());
+          break;
+        case PackedCaptureEvents::kCallstackSample:
+          UnpackCallstackSample(packed_events.callstack_samples(), index, &callstack_sample_deltas,
+                                event->mutable_callstack_sample());
+          break;
+        case PackedCaptureEvents::kFunctionCall:
+          UnpackFunctionCall(packed_events.function_calls(), index, &function_call_deltas,
+                             event->mutable_function_call());
+          break;
+        default:
+          ORBIT_UNREACHABLE();
+      }
+      ordered_events.push_back(event);
+    }
+  }
+  std::copy(ordered_events.begin(), ordered_events.end(), events->pointer_begin());
+
+  capture_response->clear_packed_capture_events();
+  return outcome::success();
+}
+
+}  // namespace orbit_capture_response_encoding
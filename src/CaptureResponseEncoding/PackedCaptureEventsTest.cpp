@@ -0,0 +1,186 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <google/protobuf/util/message_differencer.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include "CaptureResponseEncoding/PackedCaptureEvents.h"
+#include "GrpcProtos/capture.pb.h"
+#include "GrpcProtos/services.pb.h"
+#include "TestUtils/TestUtils.h"
+
+namespace orbit_capture_response_encoding {
+
+using google::protobuf::util::MessageDifferencer;
+using orbit_grpc_protos::CallstackSample;
+using orbit_grpc_protos::CaptureResponse;
+using orbit_grpc_protos::FunctionCall;
+using orbit_grpc_protos::PackedCaptureEvents;
+using orbit_grpc_protos::SchedulingSlice;
+using orbit_test_utils::HasErrorWithMessage;
+using orbit_test_utils::HasNoError;
+
+namespace {
+
+constexpr uint32_t kPid = 42;
+
+void AddSchedulingSlice(uint32_t tid, uint64_t out_timestamp_ns, CaptureResponse* response) {
+  SchedulingSlice* scheduling_slice = response->add_capture_events()->mutable_scheduling_slice();
+  scheduling_slice->set_pid(kPid);
+  scheduling_slice->set_tid(tid);
+  scheduling_slice->set_core(3);
+  scheduling_slice->set_duration_ns(1000);
+  scheduling_slice->set_out_timestamp_ns(out_timestamp_ns);
+}
+
+void AddCallstackSample(uint32_t tid, uint64_t timestamp_ns, CaptureResponse* response) {
+  CallstackSample* callstack_sample = response->add_capture_events()->mutable_callstack_sample();
+  callstack_sample->set_pid(kPid);
+  callstack_sample->set_tid(tid);
+  callstack_sample->set_callstack_id(7);
+  callstack_sample->set_timestamp_ns(timestamp_ns);
+}
+
+FunctionCall* AddFunctionCall(uint32_t tid, uint64_t end_timestamp_ns, CaptureResponse* response) {
+  FunctionCall* function_call = response->add_capture_events()->mutable_function_call();
+  function_call->set_pid(kPid);
+  function_call->set_tid(tid);
+  function_call->set_function_id(5);
+  function_call->set_duration_ns(200);
+  function_call->set_end_timestamp_ns(end_timestamp_ns);
+  function_call->set_depth(2);
+  function_call->set_return_value(0xdeadbeef);
+  return function_call;
+}
+
+void AddInternedString(uint64_t key, CaptureResponse* response) {
+  orbit_grpc_protos::InternedString* interned_string =
+      response->add_capture_events()->mutable_interned_string();
+  interned_string->set_key(key);
+  interned_string->set_intern("string");
+}
+
+CaptureResponse CreateCaptureResponseWithAllKindsOfEvents() {
+  CaptureResponse response;
+  AddInternedString(1, &response);
+  AddSchedulingSlice(10, 1'000'000, &response);
+  AddSchedulingSlice(11, 1'000'500, &response);
+  AddCallstackSample(10, 1'000'100, &response);
+  AddInternedString(2, &response);
+  AddFunctionCall(10, 1'000'200, &response);
+  AddFunctionCall(10, 1'000'300, &response)->add_registers(1);
+  AddFunctionCall(11, 999'000, &response);
+  AddSchedulingSlice(10, 1'002'000, &response);
+  AddCallstackSample(11, 1'000'400, &response);
+  return response;
+}
+
+}  // namespace
+
+TEST(PackedCaptureEvents, UnpackRestoresThePackedCaptureResponse) {
+  const CaptureResponse expected_response = CreateCaptureResponseWithAllKindsOfEvents();
+  CaptureResponse response = expected_response;
+
+  PackCaptureEvents(&response);
+  ASSERT_TRUE(response.has_packed_capture_events());
+  // The interned strings and the FunctionCall with registers are not packed.
+  ASSERT_EQ(response.capture_events_size(), 3);
+  EXPECT_EQ(response.capture_events(0).interned_string().key(), 1);
+  EXPECT_EQ(response.capture_events(1).interned_string().key(), 2);
+  EXPECT_EQ(response.capture_events(2).function_call().registers_size(), 1);
+  EXPECT_EQ(response.packed_capture_events().scheduling_slices().pid_size(), 3);
+  EXPECT_EQ(response.packed_capture_events().callstack_samples().pid_size(), 2);
+  EXPECT_EQ(response.packed_capture_events().function_calls().pid_size(), 2);
+
+  // Serialize and parse, as done on the wire.
+  CaptureResponse received_response;
+  ASSERT_TRUE(received_response.ParseFromString(response.SerializeAsString()));
+
+  ASSERT_THAT(UnpackCaptureEvents(&received_response), HasNoError());
+  EXPECT_FALSE(received_response.has_packed_capture_events());
+  EXPECT_TRUE(MessageDifferencer::Equals(received_response, expected_response));
+}
+
+TEST(PackedCaptureEvents, TimestampsAreDeltaEncodedPerThread) {
+  CaptureResponse response;
+  AddSchedulingSlice(10, 1'000'000, &response);
+  AddSchedulingSlice(11, 1'000'500, &response);
+  AddSchedulingSlice(10, 1'002'000, &response);
+  AddSchedulingSlice(11, 1'000'400, &response);
+
+  PackCaptureEvents(&response);
+  EXPECT_EQ(response.capture_events_size(), 0);
+  const PackedCaptureEvents& packed_events = response.packed_capture_events();
+  EXPECT_EQ(packed_events.base_timestamp_ns(), 1'000'000);
+  ASSERT_EQ(packed_events.run_kinds_size(), 1);
+  EXPECT_EQ(packed_events.run_kinds(0), PackedCaptureEvents::kSchedulingSlice);
+  EXPECT_EQ(packed_events.run_lengths(0), 4);
+  const auto& deltas = packed_events.scheduling_slices().out_timestamp_ns_delta();
+  ASSERT_EQ(deltas.size(), 4);
+  EXPECT_EQ(deltas[0], 0);
+  EXPECT_EQ(deltas[1], 500);
+  EXPECT_EQ(deltas[2], 2'000);
+  EXPECT_EQ(deltas[3], -100);
+}
+
+TEST(PackedCaptureEvents, PackingReducesTheSerializedSize) {
+  CaptureResponse response;
+  for (uint64_t i = 0; i < 1000; ++i) {
+    const uint64_t timestamp_ns = 1'700'000'000'000'000'000 + i * 1'000;
+    AddSchedulingSlice(10 + i % 4, timestamp_ns, &response);
+    AddCallstackSample(10 + i % 4, timestamp_ns + 100, &response);
+  }
+  const size_t unpacked_size = response.ByteSizeLong();
+
+  PackCaptureEvents(&response);
+  EXPECT_LT(response.ByteSizeLong(), unpacked_size / 2);
+}
+
+TEST(PackedCaptureEvents, ResponseWithoutPackableEventsIsUnchanged) {
+  CaptureResponse response;
+  AddInternedString(1, &response);
+  AddFunctionCall(10, 1'000, &response)->add_registers(1);
+  const CaptureResponse expected_response = response;
+
+  PackCaptureEvents(&response);
+  EXPECT_FALSE(response.has_packed_capture_events());
+  EXPECT_TRUE(MessageDifferencer::Equals(response, expected_response));
+
+  EXPECT_THAT(UnpackCaptureEvents(&response), HasNoError());
+  EXPECT_TRUE(MessageDifferencer::Equals(response, expected_response));
+}
+
+TEST(PackedCaptureEvents, UnpackFailsOnInconsistentPackedCaptureEvents) {
+  CaptureResponse response = CreateCaptureResponseWithAllKindsOfEvents();
+  PackCaptureEvents(&response);
+
+  {
+    CaptureResponse missing_column_value = response;
+    missing_column_value.mutable_packed_capture_events()
+        ->mutable_callstack_samples()
+        ->mutable_callstack_id()
+        ->RemoveLast();
+    const CaptureResponse expected_response = missing_column_value;
+    EXPECT_THAT(UnpackCaptureEvents(&missing_column_value),
+                HasErrorWithMessage("don't match its runs"));
+    EXPECT_TRUE(MessageDifferencer::Equals(missing_column_value, expected_response));
+  }
+
+  {
+    CaptureResponse missing_unpacked_event = response;
+    missing_unpacked_event.mutable_capture_events()->RemoveLast();
+    EXPECT_THAT(UnpackCaptureEvents(&missing_unpacked_event),
+                HasErrorWithMessage("don't match its runs"));
+  }
+
+  {
+    CaptureResponse unknown_kind = response;
+    unknown_kind.mutable_packed_capture_events()->set_run_kinds(
+        0, static_cast<PackedCaptureEvents::EventKind>(42));
+    EXPECT_THAT(UnpackCaptureEvents(&unknown_kind), HasErrorWithMessage("unknown event kind 42"));
+  }
+}
+
+}  // namespace orbit_capture_response_encoding
@@ -0,0 +1,28 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CAPTURE_RESPONSE_ENCODING_PACKED_CAPTURE_EVENTS_H_
+#define CAPTURE_RESPONSE_ENCODING_PACKED_CAPTURE_EVENTS_H_
+
+#include "GrpcProtos/services.pb.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_capture_response_encoding {
+
+// Moves the SchedulingSlices, CallstackSamples and FunctionCalls without registers of
+// `capture_response->capture_events()` to `capture_response->packed_capture_events()`, see
+// PackedCaptureEvents in services.proto. The other events stay in `capture_events()`, in order. If
+// there is no event to pack, `packed_capture_events()` is not set.
+void PackCaptureEvents(orbit_grpc_protos::CaptureResponse* capture_response);
+
+// Moves the events in `capture_response->packed_capture_events()` back to
+// `capture_response->capture_events()`, restoring the order of all events at the time they were
+// packed. Does nothing if `packed_capture_events()` is not set. Returns an error, and leaves
+// `capture_response` unchanged, if `packed_capture_events()` is inconsistent.
+[[nodiscard]] ErrorMessageOr<void> UnpackCaptureEvents(
+    orbit_grpc_protos::CaptureResponse* capture_response);
+
+}  // namespace orbit_capture_response_encoding
+
+#endif  // CAPTURE_RESPONSE_ENCODING_PACKED_CAPTURE_EVENTS_H_
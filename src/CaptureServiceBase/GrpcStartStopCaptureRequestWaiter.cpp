@@ -8,13 +8,13 @@
 
 namespace orbit_capture_service_base {
 
-orbit_grpc_protos::CaptureOptions GrpcStartStopCaptureRequestWaiter::WaitForStartCaptureRequest() {
+orbit_grpc_protos::CaptureRequest GrpcStartStopCaptureRequestWaiter::WaitForStartCaptureRequest() {
   orbit_grpc_protos::CaptureRequest request;
   // This call is blocking.
   reader_writer_->Read(&request);
 
   ORBIT_LOG("Read CaptureRequest from Capture's gRPC stream: starting capture");
-  return request.capture_options();
+  return request;
 }
 
 [[nodiscard]] CaptureServiceBase::StopCaptureReason
@@ -24,7 +24,7 @@ class GrpcStartStopCaptureRequestWaiter : public StopCaptureRequestWaiter {
                                orbit_grpc_protos::CaptureRequest>* reader_writer)
       : reader_writer_{reader_writer} {}
 
-  [[nodiscard]] orbit_grpc_protos::CaptureOptions WaitForStartCaptureRequest();
+  [[nodiscard]] orbit_grpc_protos::CaptureRequest WaitForStartCaptureRequest();
   [[nodiscard]] CaptureServiceBase::StopCaptureReason WaitForStopCaptureRequest() override;
 
  private:
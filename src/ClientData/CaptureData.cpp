@@ -14,6 +14,7 @@
 #include <memory>
 #include <optional>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include "ClientData/FastRenderingUtils.h"
@@ -60,8 +61,9 @@ CaptureData::CaptureData(CaptureStarted capture_started,
       frame_track_function_ids_{std::move(frame_track_function_ids)},
       file_path_{std::move(file_path)},
       scope_id_provider_(NameEqualityScopeIdProvider::Create(capture_started_.capture_options())),
-      thread_track_data_provider_(
-          std::make_unique<ThreadTrackDataProvider>(data_source == DataSource::kLoadedCapture)),
+      thread_track_data_provider_(std::make_unique<ThreadTrackDataProvider>(
+          data_source == DataSource::kLoadedCapture,
+          [this](const TimerBlock& block) { ComputeBlockScopeStats(block); })),
       all_scopes_(std::make_shared<ScopeStatsCollection>()) {
   for (const auto& instrumented_function :
        capture_started_.capture_options().instrumented_functions()) {
@@ -279,9 +281,9 @@ uint64_t CaptureData::ScopeIdToFunctionId(ScopeId scope_id) const {
   return scope_id_provider_->ScopeIdToFunctionId(scope_id);
 }
 
-const std::vector<uint64_t>* CaptureData::GetSortedTimerDurationsForScopeId(
+const orbit_statistics::QuantileSketch* CaptureData::GetDurationSketchForScopeId(
     ScopeId scope_id) const {
-  return all_scopes_->GetSortedTimerDurationsForScopeId(scope_id);
+  return all_scopes_->GetDurationSketchForScopeId(scope_id);
 }
 
 std::shared_ptr<const ScopeStatsCollection> CaptureData::GetAllScopeStatsCollection() const {
@@ -294,9 +296,52 @@ std::unique_ptr<const ScopeStatsCollection> CaptureData::CreateScopeStatsCollect
   std::vector<uint32_t> thread_ids = thread_id == orbit_base::kAllProcessThreadsTid
                                          ? GetThreadTrackDataProvider()->GetAllThreadIds()
                                          : std::vector<uint32_t>{thread_id};
-  auto timers = GetAllScopeTimersByTids(thread_ids, kAllValidScopeTypes, min_tick, max_tick,
-                                        /*exclusive=*/true);
-  return std::make_unique<ScopeStatsCollection>(*scope_id_provider_, timers);
+
+  absl::flat_hash_map<ScopeId, ScopeStats> scope_stats;
+  auto update_scope_stats = [this, &scope_stats](const TimerInfo& timer) {
+    const std::optional<ScopeId> scope_id = ProvideScopeId(timer);
+    if (!scope_id.has_value()) return;
+    scope_stats[scope_id.value()].UpdateStats(timer.end() - timer.start());
+  };
+
+  for (const uint32_t tid : thread_ids) {
+    GetThreadTrackDataProvider()->VisitTimersInRange(
+        tid, min_tick, max_tick,
+        [this, &scope_stats](const TimerBlock& block) {
+          // The mutex is only held per block, as the blocks are filled while holding the lock of
+          // the ThreadTrackDataProvider.
+          absl::MutexLock lock{&block_scope_stats_mutex_};
+          auto block_stats_it = block_scope_stats_.find(&block);
+          ORBIT_CHECK(block_stats_it != block_scope_stats_.end());
+          for (const auto& [scope_id, block_stats] : block_stats_it->second) {
+            scope_stats[scope_id].Merge(block_stats);
+          }
+        },
+        update_scope_stats);
+  }
+
+  for (const TimerInfo* timer : timer_data_manager_.GetTimers(TimerInfo::kApiScopeAsync, min_tick,
+                                                              max_tick, /*exclusive=*/true)) {
+    update_scope_stats(*timer);
+  }
+
+  return std::make_unique<ScopeStatsCollection>(std::move(scope_stats));
+}
+
+void CaptureData::ComputeBlockScopeStats(const TimerBlock& block) {
+  absl::flat_hash_map<ScopeId, ScopeStats> stats_by_scope_id;
+  for (size_t i = 0; i < block.size(); ++i) {
+    const TimerInfo& timer = block[i];
+    const std::optional<ScopeId> scope_id = ProvideScopeId(timer);
+    if (!scope_id.has_value()) continue;
+    stats_by_scope_id[scope_id.value()].UpdateStats(timer.end() - timer.start());
+  }
+
+  std::vector<std::pair<ScopeId, ScopeStats>> block_stats(
+      std::make_move_iterator(stats_by_scope_id.begin()),
+      std::make_move_iterator(stats_by_scope_id.end()));
+  absl::MutexLock lock{&block_scope_stats_mutex_};
+  block_scope_stats_.insert_or_assign(&block, std::move(block_stats));
 }
 
 [[nodiscard]] std::vector<const TimerInfo*> CaptureData::GetAllScopeTimers(
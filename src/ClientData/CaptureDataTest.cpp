@@ -2,6 +2,7 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <absl/container/flat_hash_map.h>
 #include <absl/hash/hash.h>
 #include <absl/strings/numbers.h>
 #include <absl/strings/str_split.h>
@@ -17,6 +18,7 @@
 #include <filesystem>
 #include <iterator>
 #include <limits>
+#include <memory>
 #include <numeric>
 #include <optional>
 #include <string>
@@ -29,13 +31,16 @@
 #include "ClientData/ModuleIdentifierProvider.h"
 #include "ClientData/ScopeId.h"
 #include "ClientData/ScopeStats.h"
+#include "ClientData/ScopeStatsCollection.h"
 #include "ClientData/ThreadStateSliceInfo.h"
 #include "ClientData/TimerTrackDataIdManager.h"
 #include "ClientProtos/capture_data.pb.h"
 #include "GrpcProtos/capture.pb.h"
 #include "OrbitBase/ReadFileToString.h"
 #include "OrbitBase/Result.h"
+#include "OrbitBase/ThreadConstants.h"
 #include "OrbitBase/Typedef.h"
+#include "Statistics/QuantileSketch.h"
 #include "Test/Path.h"
 
 using testing::ElementsAreArray;
@@ -282,17 +287,126 @@ TEST_F(CaptureDataTest, UpdateTimerDurationsIsCorrect) {
 
   capture_data_.OnCaptureComplete();
 
-  const std::vector<uint64_t>* durations_first =
-      capture_data_.GetSortedTimerDurationsForScopeId(kFirstId);
-  EXPECT_EQ(*durations_first, std::vector(std::begin(kSortedDurationsForFirstId),
-                                          std::end(kSortedDurationsForFirstId)));
+  const orbit_statistics::QuantileSketch* durations_first =
+      capture_data_.GetDurationSketchForScopeId(kFirstId);
+  ASSERT_NE(durations_first, nullptr);
+  EXPECT_EQ(durations_first->count(), kTimersForFirstId);
+  EXPECT_EQ(durations_first->ComputeQuantile(0), kSortedDurationsForFirstId.front());
+  EXPECT_NEAR(durations_first->ComputeQuantile(0.5), kSortedDurationsForFirstId[1],
+              durations_first->relative_accuracy() * kSortedDurationsForFirstId[1]);
+  EXPECT_EQ(durations_first->ComputeQuantile(1), kSortedDurationsForFirstId.back());
+
+  const orbit_statistics::QuantileSketch* durations_second =
+      capture_data_.GetDurationSketchForScopeId(kSecondId);
+  ASSERT_NE(durations_second, nullptr);
+  EXPECT_EQ(durations_second->count(), kTimersForSecondId);
+  EXPECT_EQ(durations_second->ComputeQuantile(0), kSortedDurationsForSecondId.front());
+  EXPECT_EQ(durations_second->ComputeQuantile(1), kSortedDurationsForSecondId.back());
+
+  EXPECT_THAT(capture_data_.GetDurationSketchForScopeId(kNotIssuedId), testing::IsNull());
+}
+
+TEST_F(CaptureDataTest, CreateScopeStatsCollectionIsCorrect) {
+  constexpr uint32_t kThreadId = 42;
+  // Enough timers for several full blocks.
+  constexpr uint64_t kThreadTimerCount = 5000;
+  std::vector<TimerInfo> timers;
+  for (uint64_t i = 0; i < kThreadTimerCount; ++i) {
+    TimerInfo& timer = timers.emplace_back();
+    timer.set_thread_id(kThreadId);
+    timer.set_function_id(i % 3 == 0 ? *kSecondId : *kFirstId);
+    timer.set_start(20'000 * i);
+    timer.set_end(20'000 * i + 1'000 + (i * i) % 9'973);
+    capture_data_.GetThreadTrackDataProvider()->AddTimer(timer);
+  }
+
+  for (const auto& [min_tick, max_tick] :
+       std::vector<std::pair<uint64_t, uint64_t>>{
+           {12'345'678, 87'654'321}, {0, 100'000'000}, {5, 6}}) {
+    absl::flat_hash_map<ScopeId, std::vector<uint64_t>> expected_durations;
+    for (const TimerInfo& timer : timers) {
+      if (timer.start() < min_tick || timer.end() > max_tick) continue;
+      const ScopeId scope_id = timer.function_id() == *kFirstId ? kFirstId : kSecondId;
+      expected_durations[scope_id].push_back(timer.end() - timer.start());
+    }
 
-  const std::vector<uint64_t>* durations_second =
-      capture_data_.GetSortedTimerDurationsForScopeId(kSecondId);
-  EXPECT_EQ(*durations_second, std::vector(std::begin(kSortedDurationsForSecondId),
-                                           std::end(kSortedDurationsForSecondId)));
+    // The second time, the stats of the full blocks have been computed already.
+    for (int repetition = 0; repetition < 2; ++repetition) {
+      std::unique_ptr<const ScopeStatsCollection> collection =
+          capture_data_.CreateScopeStatsCollection(kThreadId, min_tick, max_tick);
+      EXPECT_EQ(collection->GetAllProvidedScopeIds().size(), expected_durations.size());
+      for (auto& [scope_id, durations] : expected_durations) {
+        const ScopeStats& stats = collection->GetScopeStatsOrDefault(scope_id);
+        EXPECT_EQ(stats.count(), durations.size());
+        EXPECT_EQ(stats.total_time_ns(), std::reduce(durations.begin(), durations.end()));
+        EXPECT_EQ(stats.min_ns(), *std::min_element(durations.begin(), durations.end()));
+        EXPECT_EQ(stats.max_ns(), *std::max_element(durations.begin(), durations.end()));
+        const double mean = static_cast<double>(stats.total_time_ns()) / durations.size();
+        double expected_variance = 0;
+        for (const uint64_t duration : durations) {
+          expected_variance += (duration - mean) * (duration - mean) / durations.size();
+        }
+        EXPECT_NEAR(stats.variance_ns(), expected_variance, 1e-3 * expected_variance);
+
+        std::sort(durations.begin(), durations.end());
+        const orbit_statistics::QuantileSketch* sketch =
+            collection->GetDurationSketchForScopeId(scope_id);
+        ASSERT_NE(sketch, nullptr);
+        EXPECT_EQ(sketch->count(), durations.size());
+        for (double quantile : {0.0, 0.5, 0.9, 0.99, 1.0}) {
+          const auto expected_duration = static_cast<double>(
+              durations[static_cast<size_t>(quantile * (durations.size() - 1))]);
+          EXPECT_NEAR(sketch->ComputeQuantile(quantile), expected_duration,
+                      sketch->relative_accuracy() * expected_duration);
+        }
+      }
+    }
+  }
+}
+
+TEST_F(CaptureDataTest, CreateScopeStatsCollectionIsCorrectWithManyFullBlocks) {
+  // Each thread has several full blocks, whose stats are combined, and a partially filled one.
+  constexpr uint32_t kThreadCount = 4;
+  constexpr uint64_t kTimerCountPerThread = 5'000;
+  constexpr uint64_t kMinTick = 1'000 * 1'234;
+  constexpr uint64_t kMaxTick = 1'000 * 3'456;
+  uint64_t expected_total_time_ns = 0;
+  uint64_t expected_count_in_range = 0;
+  uint64_t expected_total_time_ns_in_range = 0;
+  for (uint32_t thread_id = 1; thread_id <= kThreadCount; ++thread_id) {
+    for (uint64_t i = 0; i < kTimerCountPerThread; ++i) {
+      TimerInfo timer;
+      timer.set_thread_id(thread_id);
+      timer.set_function_id(*kFirstId);
+      timer.set_start(1'000 * i);
+      timer.set_end(1'000 * i + thread_id + i % 100);
+      expected_total_time_ns += timer.end() - timer.start();
+      if (timer.start() >= kMinTick && timer.end() <= kMaxTick) {
+        ++expected_count_in_range;
+        expected_total_time_ns_in_range += timer.end() - timer.start();
+      }
+      capture_data_.GetThreadTrackDataProvider()->AddTimer(timer);
+    }
+  }
 
-  EXPECT_THAT(capture_data_.GetSortedTimerDurationsForScopeId(kNotIssuedId), testing::IsNull());
+  std::unique_ptr<const ScopeStatsCollection> collection = capture_data_.CreateScopeStatsCollection(
+      orbit_base::kAllProcessThreadsTid, 0, std::numeric_limits<uint64_t>::max());
+  const ScopeStats& stats = collection->GetScopeStatsOrDefault(kFirstId);
+  EXPECT_EQ(stats.count(), kThreadCount * kTimerCountPerThread);
+  EXPECT_EQ(stats.total_time_ns(), expected_total_time_ns);
+  EXPECT_EQ(stats.min_ns(), 1);
+  EXPECT_EQ(stats.max_ns(), kThreadCount + 99);
+
+  // Only the blocks inside the range are combined, the timers of the blocks at its edges are
+  // visited one by one.
+  collection = capture_data_.CreateScopeStatsCollection(orbit_base::kAllProcessThreadsTid,
+                                                        kMinTick, kMaxTick);
+  const ScopeStats& stats_in_range = collection->GetScopeStatsOrDefault(kFirstId);
+  EXPECT_EQ(stats_in_range.count(), expected_count_in_range);
+  EXPECT_EQ(stats_in_range.total_time_ns(), expected_total_time_ns_in_range);
+
+  collection = capture_data_.CreateScopeStatsCollection(1, 0, std::numeric_limits<uint64_t>::max());
+  EXPECT_EQ(collection->GetScopeStatsOrDefault(kFirstId).count(), kTimerCountPerThread);
 }
 
 struct ForEachThreadStateSliceIntersectingTimeRangeDiscretizedTestCase {
@@ -0,0 +1,63 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ClientData/FunctionAddressIndex.h"
+
+#include <absl/numeric/bits.h>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_client_data {
+
+namespace {
+
+// Assigns the elements of `sorted` to the nodes of the implicit binary tree rooted at `node`, in
+// in-order, i.e., such that a binary search over the tree visits them in sorted order.
+template <typename T>
+void FillInEytzingerOrder(absl::Span<const T> sorted, size_t node, size_t* next_sorted_index,
+                          std::vector<T>* eytzinger) {
+  if (node >= eytzinger->size()) return;
+  FillInEytzingerOrder(sorted, 2 * node, next_sorted_index, eytzinger);
+  (*eytzinger)[node] = sorted[(*next_sorted_index)++];
+  FillInEytzingerOrder(sorted, 2 * node + 1, next_sorted_index, eytzinger);
+}
+
+}  // namespace
+
+FunctionAddressIndex::FunctionAddressIndex(absl::Span<const FunctionInfo* const> functions) {
+  std::vector<Entry> sorted_entries;
+  sorted_entries.reserve(functions.size());
+  for (auto it = functions.rbegin(); it != functions.rend(); ++it) {
+    const FunctionInfo* function = *it;
+    ORBIT_CHECK(sorted_entries.empty() || sorted_entries.back().address > function->address());
+    sorted_entries.push_back({function->address(), function->size(), function});
+  }
+
+  entries_.resize(sorted_entries.size() + 1, Entry{0, 0, nullptr});
+  size_t next_sorted_index = 0;
+  FillInEytzingerOrder(absl::MakeConstSpan(sorted_entries), 1, &next_sorted_index, &entries_);
+}
+
+const FunctionInfo* FunctionAddressIndex::FindFunctionByVirtualAddress(uint64_t virtual_address,
+                                                                       bool is_exact) const {
+  // Find the first entry, in order of decreasing addresses, with an address not greater than
+  // `virtual_address`. The descent encodes the path in the bits of `node`: one bit per level, set
+  // where the search went to the right. Stripping the trailing ones, and the zero before them,
+  // yields the last node where the search went to the left, i.e., the entry searched for. If the
+  // search never went to the left, this yields 0, which is the sentinel.
+  const uint64_t entry_count = size();
+  uint64_t node = 1;
+  while (node <= entry_count) {
+    node = 2 * node + static_cast<uint64_t>(entries_[node].address > virtual_address);
+  }
+  node >>= absl::countr_zero(~node) + 1;
+
+  const Entry& entry = entries_[node];
+  if (entry.function == nullptr) return nullptr;
+  if (is_exact) return entry.address == virtual_address ? entry.function : nullptr;
+  if (entry.address + entry.size < virtual_address) return nullptr;
+  return entry.function;
+}
+
+}  // namespace orbit_client_data
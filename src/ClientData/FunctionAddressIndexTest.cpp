@@ -0,0 +1,91 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/strings/str_format.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+#include "ClientData/FunctionAddressIndex.h"
+#include "ClientData/FunctionInfo.h"
+
+namespace orbit_client_data {
+
+namespace {
+
+std::unique_ptr<FunctionInfo> CreateFunction(uint64_t address, uint64_t size) {
+  return std::make_unique<FunctionInfo>("/path/to/module", "buildid", address, size,
+                                        absl::StrFormat("function_%#x", address),
+                                        /*is_hotpatchable=*/false);
+}
+
+std::vector<const FunctionInfo*> GetPointers(
+    const std::vector<std::unique_ptr<FunctionInfo>>& functions) {
+  std::vector<const FunctionInfo*> result;
+  result.reserve(functions.size());
+  for (const auto& function : functions) result.push_back(function.get());
+  return result;
+}
+
+}  // namespace
+
+TEST(FunctionAddressIndex, Empty) {
+  FunctionAddressIndex index{{}};
+  EXPECT_EQ(index.size(), 0);
+  EXPECT_EQ(index.FindFunctionByVirtualAddress(0, /*is_exact=*/false), nullptr);
+  EXPECT_EQ(index.FindFunctionByVirtualAddress(0x1000, /*is_exact=*/true), nullptr);
+}
+
+TEST(FunctionAddressIndex, FindFunctionByVirtualAddress) {
+  std::vector<std::unique_ptr<FunctionInfo>> functions;
+  functions.push_back(CreateFunction(0x1000, 0x10));
+  functions.push_back(CreateFunction(0x1010, 0x20));
+  functions.push_back(CreateFunction(0x2000, 0x10));
+  FunctionAddressIndex index{GetPointers(functions)};
+  EXPECT_EQ(index.size(), 3);
+
+  EXPECT_EQ(index.FindFunctionByVirtualAddress(0xfff, /*is_exact=*/false), nullptr);
+  EXPECT_EQ(index.FindFunctionByVirtualAddress(0x1000, /*is_exact=*/false), functions[0].get());
+  EXPECT_EQ(index.FindFunctionByVirtualAddress(0x100f, /*is_exact=*/false), functions[0].get());
+  EXPECT_EQ(index.FindFunctionByVirtualAddress(0x1010, /*is_exact=*/false), functions[1].get());
+  // As before, the address right after the end of a function is still attributed to it.
+  EXPECT_EQ(index.FindFunctionByVirtualAddress(0x1030, /*is_exact=*/false), functions[1].get());
+  EXPECT_EQ(index.FindFunctionByVirtualAddress(0x1031, /*is_exact=*/false), nullptr);
+  EXPECT_EQ(index.FindFunctionByVirtualAddress(0x2008, /*is_exact=*/false), functions[2].get());
+  EXPECT_EQ(index.FindFunctionByVirtualAddress(0x3000, /*is_exact=*/false), nullptr);
+
+  EXPECT_EQ(index.FindFunctionByVirtualAddress(0x1010, /*is_exact=*/true), functions[1].get());
+  EXPECT_EQ(index.FindFunctionByVirtualAddress(0x1011, /*is_exact=*/true), nullptr);
+  EXPECT_EQ(index.FindFunctionByVirtualAddress(0x2000, /*is_exact=*/true), functions[2].get());
+}
+
+TEST(FunctionAddressIndex, AgreesWithLinearSearchForAllSizes) {
+  // Covers complete and incomplete trees of different heights.
+  for (uint64_t function_count = 1; function_count <= 70; ++function_count) {
+    std::vector<std::unique_ptr<FunctionInfo>> functions;
+    for (uint64_t i = 0; i < function_count; ++i) {
+      // Functions of size 4 every 8 bytes, starting at 16, so that there are gaps.
+      functions.push_back(CreateFunction(16 + 8 * i, 4));
+    }
+    FunctionAddressIndex index{GetPointers(functions)};
+
+    for (uint64_t address = 0; address < 16 + 8 * function_count + 16; ++address) {
+      const FunctionInfo* expected = nullptr;
+      const FunctionInfo* expected_exact = nullptr;
+      for (const auto& function : functions) {
+        if (function->address() <= address && address <= function->address() + function->size()) {
+          expected = function.get();
+        }
+        if (function->address() == address) expected_exact = function.get();
+      }
+      EXPECT_EQ(index.FindFunctionByVirtualAddress(address, /*is_exact=*/false), expected)
+          << function_count << " functions, address " << address;
+      EXPECT_EQ(index.FindFunctionByVirtualAddress(address, /*is_exact=*/true), expected_exact)
+          << function_count << " functions, address " << address;
+    }
+  }
+}
+
+}  // namespace orbit_client_data
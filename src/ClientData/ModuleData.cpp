@@ -9,8 +9,10 @@
 #include <absl/meta/type_traits.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cinttypes>
 #include <utility>
+#include <vector>
 
 #include "GrpcProtos/module.pb.h"
 #include "Introspection/Introspection.h"
@@ -133,8 +135,8 @@ bool ModuleData::UpdateIfChangedAndUnload(ModuleInfo new_module_info) {
 
   ORBIT_LOG("Module %s contained symbols. Because the module changed, those are now removed.",
             module_info_.file_path());
+  UnpublishFunctionAddressIndex();
   functions_.clear();
-  absolute_address_to_function_info_cache_.clear();
   hash_to_function_map_.clear();
   name_to_function_info_map_.clear();
   loaded_symbols_completeness_ = SymbolCompleteness::kNoSymbols;
@@ -162,38 +164,10 @@ bool ModuleData::UpdateIfChangedAndNotLoaded(orbit_grpc_protos::ModuleInfo new_m
 
 const FunctionInfo* ModuleData::FindFunctionByVirtualAddress(uint64_t virtual_address,
                                                              bool is_exact) const {
-  absl::MutexLock lock(&mutex_);
-  if (functions_.empty()) return nullptr;
-
-  auto cache_it = absolute_address_to_function_info_cache_.find(virtual_address);
-  if (cache_it != absolute_address_to_function_info_cache_.end()) {
-    return cache_it->second;
-  }
-
-  if (is_exact) {
-    auto it = functions_.find(virtual_address);
-    FunctionInfo* result = (it != functions_.end()) ? it->second.get() : nullptr;
-    absolute_address_to_function_info_cache_.emplace(virtual_address, result);
-    return result;
-  }
-
-  auto it = functions_.upper_bound(virtual_address);
-  if (it == functions_.begin()) {
-    absolute_address_to_function_info_cache_.emplace(virtual_address, nullptr);
-    return nullptr;
-  }
-
-  --it;
-  FunctionInfo* function = it->second.get();
-  ORBIT_CHECK(function->address() <= virtual_address);
-
-  if (function->address() + function->size() < virtual_address) {
-    absolute_address_to_function_info_cache_.emplace(virtual_address, nullptr);
-    return nullptr;
-  }
-
-  absolute_address_to_function_info_cache_.emplace(virtual_address, function);
-  return function;
+  const FunctionAddressIndex* function_address_index =
+      function_address_index_.load(std::memory_order_acquire);
+  if (function_address_index == nullptr) return nullptr;
+  return function_address_index->FindFunctionByVirtualAddress(virtual_address, is_exact);
 }
 
 const FunctionInfo* ModuleData::FindFunctionFromHash(uint64_t hash) const {
@@ -249,8 +223,8 @@ void ModuleData::AddSymbolsInternal(const orbit_grpc_protos::ModuleSymbols& modu
       absl::StrFormat("AddSymbolsInternal [%u]", module_symbols.symbol_infos().size()).c_str());
   mutex_.AssertHeld();
   ORBIT_CHECK(loaded_symbols_completeness_ < completeness);
+  UnpublishFunctionAddressIndex();
   functions_.clear();
-  absolute_address_to_function_info_cache_.clear();
   hash_to_function_map_.clear();
   name_to_function_info_map_.clear();
 
@@ -295,7 +269,23 @@ void ModuleData::AddSymbolsInternal(const orbit_grpc_protos::ModuleSymbols& modu
         name_reuse_counter, module_info_.name());
   }
 
+  PublishFunctionAddressIndex();
   loaded_symbols_completeness_ = completeness;
 }
 
+void ModuleData::PublishFunctionAddressIndex() {
+  std::vector<const FunctionInfo*> functions;
+  functions.reserve(functions_.size());
+  for (const auto& [unused_address, function] : functions_) {
+    functions.push_back(function.get());
+  }
+  function_address_indices_.push_back(std::make_unique<const FunctionAddressIndex>(functions));
+  function_address_index_.store(function_address_indices_.back().get(), std::memory_order_release);
+}
+
+void ModuleData::UnpublishFunctionAddressIndex() {
+  // Lookups that start from now on don't find the functions that are about to be removed.
+  function_address_index_.store(nullptr, std::memory_order_release);
+}
+
 }  // namespace orbit_client_data
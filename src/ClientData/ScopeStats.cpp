@@ -4,6 +4,8 @@
 
 #include "ClientData/ScopeStats.h"
 
+#include <algorithm>
+
 namespace orbit_client_data {
 void ScopeStats::UpdateStats(uint64_t elapsed_nanos) {
   auto old_avg = static_cast<double>(ComputeAverageTimeNs());
@@ -25,6 +27,32 @@ void ScopeStats::UpdateStats(uint64_t elapsed_nanos) {
   if (min_ns_ == 0 || elapsed_nanos < min_ns_) {
     min_ns_ = elapsed_nanos;
   }
+
+  duration_sketch_.Add(elapsed_nanos);
+}
+
+void ScopeStats::Merge(const ScopeStats& other) {
+  if (other.count_ == 0) return;
+  if (count_ == 0) {
+    *this = other;
+    return;
+  }
+
+  // Combines the variances as in the parallel algorithm of Chan et al.:
+  // M2 = M2_a + M2_b + delta^2 * n_a * n_b / n, with M2 = variance * count.
+  const auto count = static_cast<double>(count_);
+  const auto other_count = static_cast<double>(other.count_);
+  const double delta = static_cast<double>(other.total_time_ns_) / other_count -
+                       static_cast<double>(total_time_ns_) / count;
+  const double m2 = variance_ns_ * count + other.variance_ns_ * other_count +
+                    delta * delta * count * other_count / (count + other_count);
+
+  count_ += other.count_;
+  total_time_ns_ += other.total_time_ns_;
+  variance_ns_ = m2 / static_cast<double>(count_);
+  min_ns_ = std::min(min_ns_, other.min_ns_);
+  max_ns_ = std::max(max_ns_, other.max_ns_);
+  duration_sketch_.Merge(other.duration_sketch_);
 }
 
 uint64_t ScopeStats::ComputeAverageTimeNs() const {
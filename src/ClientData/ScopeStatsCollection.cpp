@@ -33,12 +33,14 @@ ScopeStatsCollection::ScopeStatsCollection(ScopeIdProvider& scope_id_provider,
   OnCaptureComplete();
 }
 
+ScopeStatsCollection::ScopeStatsCollection(absl::flat_hash_map<ScopeId, ScopeStats> scope_stats)
+    : scope_stats_{std::move(scope_stats)} {}
+
 void ScopeStatsCollection::UpdateScopeStats(ScopeId scope_id, const TimerInfo& timer) {
   ScopeStats& stats = scope_stats_[scope_id];
   const uint64_t elapsed_nanos = timer.end() - timer.start();
   stats.UpdateStats(elapsed_nanos);
-  scope_id_to_timer_durations_[scope_id].push_back(elapsed_nanos);
-  timer_durations_are_sorted_ = false;
+  capture_is_complete_ = false;
 }
 
 void ScopeStatsCollection::SetScopeStats(ScopeId scope_id, const ScopeStats stats) {
@@ -59,29 +61,21 @@ const ScopeStats& ScopeStatsCollection::GetScopeStatsOrDefault(ScopeId scope_id)
   return kDefaultScopeStats;
 }
 
-const std::vector<uint64_t>* ScopeStatsCollection::GetSortedTimerDurationsForScopeId(
+const orbit_statistics::QuantileSketch* ScopeStatsCollection::GetDurationSketchForScopeId(
     ScopeId scope_id) const {
-  if (!timer_durations_are_sorted_) {
+  if (!capture_is_complete_) {
     ORBIT_ERROR(
-        "Calling GetSortedTimerDurationsForScopeId on unsorted timers. Must call OnDataChanged() "
-        "first.");
+        "Calling GetDurationSketchForScopeId while the stats are updated. Must call "
+        "OnCaptureComplete() first.");
     return nullptr;
   }
-  if (const auto durations_it = scope_id_to_timer_durations_.find(scope_id);
-      durations_it != scope_id_to_timer_durations_.end()) {
-    return &durations_it->second;
+  if (const auto scope_stats_it = scope_stats_.find(scope_id);
+      scope_stats_it != scope_stats_.end()) {
+    return &scope_stats_it->second.duration_sketch();
   }
   return nullptr;
 }
 
-void ScopeStatsCollection::OnCaptureComplete() {
-  ORBIT_SCOPE_WITH_COLOR("ScopeStatsCollection::OnCaptureComplete", kOrbitColorDeepOrange);
-  if (timer_durations_are_sorted_) return;
-
-  for (auto& [unused_id, timer_durations] : scope_id_to_timer_durations_) {
-    absl::c_sort(timer_durations);
-  }
-  timer_durations_are_sorted_ = true;
-}
+void ScopeStatsCollection::OnCaptureComplete() { capture_is_complete_ = true; }
 
 }  // namespace orbit_client_data
\ No newline at end of file
@@ -2,6 +2,7 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <absl/container/flat_hash_map.h>
 #include <absl/types/span.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -11,6 +12,7 @@
 #include <array>
 #include <cstdint>
 #include <optional>
+#include <utility>
 #include <vector>
 
 #include "ClientData/MockScopeIdProvider.h"
@@ -19,6 +21,7 @@
 #include "ClientData/ScopeStatsCollection.h"
 #include "ClientData/TimerTrackDataIdManager.h"
 #include "ClientProtos/capture_data.pb.h"
+#include "Statistics/QuantileSketch.h"
 
 namespace orbit_client_data {
 
@@ -66,6 +69,54 @@ static void ExpectStatsAreEqual(ScopeStats actual, ScopeStats expect) {
   EXPECT_EQ(actual.min_ns(), expect.min_ns());
   EXPECT_EQ(actual.total_time_ns(), expect.total_time_ns());
   EXPECT_EQ(actual.variance_ns(), expect.variance_ns());
+  EXPECT_EQ(actual.duration_sketch().count(), expect.duration_sketch().count());
+  EXPECT_EQ(actual.ComputeQuantileNs(0.5), expect.ComputeQuantileNs(0.5));
+}
+
+static void ExpectSketchOfScope1Durations(const orbit_statistics::QuantileSketch* sketch) {
+  ASSERT_NE(sketch, nullptr);
+  EXPECT_EQ(sketch->count(), kNumTimers);
+  EXPECT_EQ(sketch->ComputeQuantile(0), kOrderedDiffs[0]);
+  EXPECT_NEAR(sketch->ComputeQuantile(0.5), kOrderedDiffs[1],
+              sketch->relative_accuracy() * kOrderedDiffs[1]);
+  EXPECT_EQ(sketch->ComputeQuantile(1), kOrderedDiffs[2]);
+}
+
+TEST(ScopeStatsTest, MergeIsEquivalentToUpdateStats) {
+  ScopeStats stats_a;
+  ScopeStats stats_b;
+  ScopeStats stats_all;
+  for (uint64_t i = 1; i <= 1000; ++i) {
+    const uint64_t duration = (i * i) % 1009 + 1000 * (i % 7);
+    (i % 3 == 0 ? stats_a : stats_b).UpdateStats(duration);
+    stats_all.UpdateStats(duration);
+  }
+  ScopeStats merged;
+  merged.Merge(stats_a);
+  merged.Merge(ScopeStats{});
+  merged.Merge(stats_b);
+
+  EXPECT_EQ(merged.count(), stats_all.count());
+  EXPECT_EQ(merged.total_time_ns(), stats_all.total_time_ns());
+  EXPECT_EQ(merged.min_ns(), stats_all.min_ns());
+  EXPECT_EQ(merged.max_ns(), stats_all.max_ns());
+  // UpdateStats uses the truncated average, so the variances only match approximately.
+  EXPECT_NEAR(merged.variance_ns(), stats_all.variance_ns(), 1e-5 * stats_all.variance_ns());
+  EXPECT_EQ(merged.duration_sketch().count(), stats_all.duration_sketch().count());
+  for (double quantile : {0.0, 0.5, 0.9, 0.99, 0.999, 1.0}) {
+    EXPECT_EQ(merged.ComputeQuantileNs(quantile), stats_all.ComputeQuantileNs(quantile));
+  }
+}
+
+TEST(ScopeStatsCollectionTest, CreateFromAggregatedStats) {
+  absl::flat_hash_map<ScopeId, ScopeStats> scope_stats;
+  scope_stats[kScopeId1] = kScope1Stats;
+  ScopeStatsCollection collection{std::move(scope_stats)};
+
+  EXPECT_THAT(collection.GetAllProvidedScopeIds(), ElementsAre(kScopeId1));
+  ExpectStatsAreEqual(collection.GetScopeStatsOrDefault(kScopeId1), kScope1Stats);
+  EXPECT_THAT(collection.GetDurationSketchForScopeId(kScopeId2), IsNull());
+  ExpectSketchOfScope1Durations(collection.GetDurationSketchForScopeId(kScopeId1));
 }
 
 TEST(ScopeStatsCollectionTest, CreateEmpty) {
@@ -73,7 +124,7 @@ TEST(ScopeStatsCollectionTest, CreateEmpty) {
   EXPECT_TRUE(collection.GetAllProvidedScopeIds().empty());
   ScopeStats stats = collection.GetScopeStatsOrDefault(kScopeId1);
   ExpectStatsAreEqual(stats, kDefaultScopeStats);
-  EXPECT_THAT(collection.GetSortedTimerDurationsForScopeId(kScopeId1), IsNull());
+  EXPECT_THAT(collection.GetDurationSketchForScopeId(kScopeId1), IsNull());
 }
 
 TEST(ScopeStatsCollectionTest, AddTimersWithUpdateStats) {
@@ -88,11 +139,9 @@ TEST(ScopeStatsCollectionTest, AddTimersWithUpdateStats) {
 
   ExpectStatsAreEqual(collection.GetScopeStatsOrDefault(kScopeId1), kScope1Stats);
 
-  const auto* timer_durations = collection.GetSortedTimerDurationsForScopeId(kScopeId1);
-  EXPECT_THAT(timer_durations, IsNull());
+  EXPECT_THAT(collection.GetDurationSketchForScopeId(kScopeId1), IsNull());
   collection.OnCaptureComplete();
-  timer_durations = collection.GetSortedTimerDurationsForScopeId(kScopeId1);
-  EXPECT_THAT(*timer_durations, ElementsAre(kOrderedDiffs[0], kOrderedDiffs[1], kOrderedDiffs[2]));
+  ExpectSketchOfScope1Durations(collection.GetDurationSketchForScopeId(kScopeId1));
 }
 
 TEST(ScopeStatsCollectionTest, CreateWithTimers) {
@@ -111,8 +160,7 @@ TEST(ScopeStatsCollectionTest, CreateWithTimers) {
 
   EXPECT_EQ(collection.GetAllProvidedScopeIds().size(), 2);
   ExpectStatsAreEqual(collection.GetScopeStatsOrDefault(kScopeId1), kScope1Stats);
-  const auto* timer_durations = collection.GetSortedTimerDurationsForScopeId(kScopeId1);
-  EXPECT_THAT(*timer_durations, ElementsAre(kOrderedDiffs[0], kOrderedDiffs[1], kOrderedDiffs[2]));
+  ExpectSketchOfScope1Durations(collection.GetDurationSketchForScopeId(kScopeId1));
 }
 
 }  // namespace orbit_client_data
\ No newline at end of file
@@ -27,7 +27,11 @@ const TimerInfo& TimerData::AddTimer(TimerInfo timer_info, uint32_t depth) {
   ++num_timers_;
   UpdateDepth(timer_info.depth() + 1);
 
-  return timer_chain->emplace_back(std::move(timer_info));
+  const TimerInfo& timer_info_ref = timer_chain->emplace_back(std::move(timer_info));
+  if (full_block_callback_ != nullptr && timer_chain->GetLastBlock().at_capacity()) {
+    full_block_callback_(timer_chain->GetLastBlock());
+  }
+  return timer_info_ref;
 }
 
 std::vector<const TimerChain*> TimerData::GetChains() const {
@@ -75,6 +79,28 @@ std::vector<const orbit_client_protos::TimerInfo*> TimerData::GetTimers(uint64_t
   return timers;
 }
 
+void TimerData::VisitTimersInRange(
+    uint64_t min_tick, uint64_t max_tick,
+    const std::function<void(const TimerBlock&)>& full_block_action,
+    const std::function<void(const orbit_client_protos::TimerInfo&)>& timer_action) const {
+  absl::MutexLock lock(&mutex_);
+  for (const auto& [depth, chain] : timers_) {
+    ORBIT_CHECK(chain != nullptr);
+    for (const auto& block : *chain) {
+      if (!block.Intersects(min_tick, max_tick)) continue;
+      if (block.at_capacity() && block.MinTimestamp() >= min_tick &&
+          block.MaxTimestamp() <= max_tick) {
+        full_block_action(block);
+        continue;
+      }
+      for (uint64_t i = 0; i < block.size(); i++) {
+        const orbit_client_protos::TimerInfo& timer = block[i];
+        if (timer.start() >= min_tick && timer.end() <= max_tick) timer_action(timer);
+      }
+    }
+  }
+}
+
 std::vector<const orbit_client_protos::TimerInfo*> TimerData::GetTimersAtDepthDiscretized(
     uint32_t depth, uint32_t resolution, uint64_t start_ns, uint64_t end_ns) const {
   ORBIT_SCOPE_WITH_COLOR("GetTimersAtDepthDiscretized", kOrbitColorBlueGrey);
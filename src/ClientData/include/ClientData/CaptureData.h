@@ -41,6 +41,7 @@
 #include "ClientData/ScopeStatsCollection.h"
 #include "ClientData/ThreadStateSliceInfo.h"
 #include "ClientData/ThreadTrackDataProvider.h"
+#include "ClientData/TimerChain.h"
 #include "ClientData/TimerData.h"
 #include "ClientData/TimerDataManager.h"
 #include "ClientData/TimerTrackDataIdManager.h"
@@ -53,6 +54,7 @@
 #include "GrpcProtos/process.pb.h"
 #include "GrpcProtos/tracepoint.pb.h"
 #include "OrbitBase/Logging.h"
+#include "Statistics/QuantileSketch.h"
 
 namespace orbit_client_data {
 
@@ -258,7 +260,7 @@ class CaptureData {
   [[nodiscard]] std::optional<ScopeId> FunctionIdToScopeId(uint64_t function_id) const;
   [[nodiscard]] uint64_t ScopeIdToFunctionId(ScopeId scope_id) const;
 
-  [[nodiscard]] const std::vector<uint64_t>* GetSortedTimerDurationsForScopeId(
+  [[nodiscard]] const orbit_statistics::QuantileSketch* GetDurationSketchForScopeId(
       ScopeId scope_id) const;
 
   // Returns all the timers corresponding to scopes with non-invalid ids
@@ -283,11 +285,15 @@ class CaptureData {
   [[nodiscard]] std::optional<ThreadStateSliceInfo> FindThreadStateSliceInfoFromTimestamp(
       int64_t thread_id, uint64_t timestamp) const;
 
+  // The stats of the timers in full blocks of the thread tracks are computed when the block fills
+  // up and combined, so only the timers in blocks at the edges of the range are visited.
   [[nodiscard]] std::unique_ptr<const ScopeStatsCollection> CreateScopeStatsCollection(
       uint32_t thread_id, uint64_t min_tick, uint64_t max_tick) const;
   [[nodiscard]] std::shared_ptr<const ScopeStatsCollection> GetAllScopeStatsCollection() const;
 
  private:
+  void ComputeBlockScopeStats(const TimerBlock& block);
+
   orbit_grpc_protos::CaptureStarted capture_started_;
 
   orbit_client_data::ProcessData process_;
@@ -329,6 +335,13 @@ class CaptureData {
   std::unique_ptr<ThreadTrackDataProvider> thread_track_data_provider_;
 
   std::shared_ptr<ScopeStatsCollection> all_scopes_;
+
+  // The stats per scope of the timers of each full thread track block, which doesn't change
+  // anymore. They are computed when the block fills up and kept for the whole capture, which costs
+  // little compared to the timers of the block.
+  absl::flat_hash_map<const TimerBlock*, std::vector<std::pair<ScopeId, ScopeStats>>>
+      block_scope_stats_ ABSL_GUARDED_BY(block_scope_stats_mutex_);
+  mutable absl::Mutex block_scope_stats_mutex_;
 };
 
 }  // namespace orbit_client_data
@@ -0,0 +1,48 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CLIENT_DATA_FUNCTION_ADDRESS_INDEX_H_
+#define CLIENT_DATA_FUNCTION_ADDRESS_INDEX_H_
+
+#include <absl/types/span.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "ClientData/FunctionInfo.h"
+
+namespace orbit_client_data {
+
+// Immutable index from virtual addresses to the functions containing them. The functions are
+// stored in Eytzinger (breadth-first) order, so that the first levels of the binary search share
+// few cache lines, and a lookup only touches the index itself, never the FunctionInfos. As it is
+// immutable, the index can be queried from any number of threads without synchronization.
+class FunctionAddressIndex {
+ public:
+  // `functions` must be sorted by address and must not contain two functions with the same address.
+  explicit FunctionAddressIndex(absl::Span<const FunctionInfo* const> functions);
+
+  // If `is_exact` is true, returns the function starting exactly at `virtual_address`. Otherwise,
+  // returns the function with the highest address not greater than `virtual_address`, unless the
+  // address lies after the end of that function. Returns nullptr if there is no such function.
+  [[nodiscard]] const FunctionInfo* FindFunctionByVirtualAddress(uint64_t virtual_address,
+                                                                 bool is_exact) const;
+
+  [[nodiscard]] size_t size() const { return entries_.size() - 1; }
+
+ private:
+  struct Entry {
+    uint64_t address;
+    uint64_t size;
+    const FunctionInfo* function;
+  };
+
+  // Entries sorted by decreasing address, in Eytzinger order starting at index 1. Index 0 holds a
+  // sentinel that lookups return when there is no function with a low enough address.
+  std::vector<Entry> entries_;
+};
+
+}  // namespace orbit_client_data
+
+#endif  // CLIENT_DATA_FUNCTION_ADDRESS_INDEX_H_
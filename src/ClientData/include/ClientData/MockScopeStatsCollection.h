@@ -10,6 +10,7 @@
 
 #include "ClientData/ScopeStatsCollection.h"
 #include "GrpcProtos/capture.pb.h"
+#include "Statistics/QuantileSketch.h"
 
 namespace orbit_client_data {
 
@@ -17,7 +18,7 @@ class MockScopeStatsCollection : public ScopeStatsCollectionInterface {
  public:
   MOCK_METHOD(std::vector<ScopeId>, GetAllProvidedScopeIds, (), (const, override));
   MOCK_METHOD(const ScopeStats&, GetScopeStatsOrDefault, (ScopeId), (const, override));
-  MOCK_METHOD(const std::vector<uint64_t>*, GetSortedTimerDurationsForScopeId, (ScopeId),
+  MOCK_METHOD(const orbit_statistics::QuantileSketch*, GetDurationSketchForScopeId, (ScopeId),
               (const, override));
 
   MOCK_METHOD(void, UpdateScopeStats, (ScopeId, const TimerInfo& timer), (override));
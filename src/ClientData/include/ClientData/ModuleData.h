@@ -9,6 +9,7 @@
 #include <absl/container/flat_hash_map.h>
 #include <absl/synchronization/mutex.h>
 
+#include <atomic>
 #include <cinttypes>
 #include <cstdint>
 #include <map>
@@ -18,6 +19,7 @@
 #include <utility>
 #include <vector>
 
+#include "ClientData/FunctionAddressIndex.h"
 #include "ClientData/FunctionInfo.h"
 #include "ClientData/ModuleIdentifier.h"
 #include "GrpcProtos/module.pb.h"
@@ -52,6 +54,7 @@ class ModuleData final {
   // and false if the module cannot be updated because symbols are already loaded.
   [[nodiscard]] bool UpdateIfChangedAndNotLoaded(orbit_grpc_protos::ModuleInfo new_module_info);
 
+  // Does not lock, as this is called for every sampled address.
   [[nodiscard]] const FunctionInfo* FindFunctionByVirtualAddress(uint64_t virtual_address,
                                                                  bool is_exact) const;
   [[nodiscard]] const FunctionInfo* FindFunctionFromHash(uint64_t hash) const;
@@ -75,6 +78,8 @@ class ModuleData final {
 
   void AddSymbolsInternal(const orbit_grpc_protos::ModuleSymbols& module_symbols,
                           SymbolCompleteness completeness);
+  void PublishFunctionAddressIndex() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void UnpublishFunctionAddressIndex() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
   mutable absl::Mutex mutex_;
   orbit_grpc_protos::ModuleInfo module_info_ ABSL_GUARDED_BY(mutex_);
@@ -82,7 +87,11 @@ class ModuleData final {
   SymbolCompleteness loaded_symbols_completeness_ ABSL_GUARDED_BY(mutex_) =
       SymbolCompleteness::kNoSymbols;
   std::map<uint64_t, std::unique_ptr<FunctionInfo>> functions_ ABSL_GUARDED_BY(mutex_);
-  mutable absl::flat_hash_map<uint64_t, FunctionInfo*> absolute_address_to_function_info_cache_
+  // Built from `functions_` whenever symbols are added, and read without holding `mutex_`. Indices
+  // that are no longer published are kept alive, as concurrent lookups might still be using them.
+  // Symbols are only replaced a few times per module, so these are few.
+  std::atomic<const FunctionAddressIndex*> function_address_index_ = nullptr;
+  std::vector<std::unique_ptr<const FunctionAddressIndex>> function_address_indices_
       ABSL_GUARDED_BY(mutex_);
   absl::flat_hash_map<std::string_view, FunctionInfo*> name_to_function_info_map_
       ABSL_GUARDED_BY(mutex_);
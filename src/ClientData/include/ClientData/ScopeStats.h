@@ -8,17 +8,24 @@
 
 #include <cmath>
 
+#include "Statistics/QuantileSketch.h"
+
 namespace orbit_client_data {
 
 // A simple class that keeps track of some basic statistics for a particular scope id (e.g. a
 // particular function).
 // Usage: Whenever we have a new occurrence of a particular scope, `UpdateStats` needs to be called
 // with the respective duration.
+// Besides the moments of the durations, a `QuantileSketch` of them is maintained, which gives
+// percentiles and a histogram with a relative error of at most 1% in bounded memory.
 class ScopeStats {
  public:
   explicit ScopeStats() = default;
 
   void UpdateStats(uint64_t elapsed_nanos);
+  // Combines the stats of another set of durations into these, as if `UpdateStats` had been called
+  // with each of them.
+  void Merge(const ScopeStats& other);
 
   [[nodiscard]] uint64_t ComputeAverageTimeNs() const;
 
@@ -42,12 +49,22 @@ class ScopeStats {
     return static_cast<uint64_t>(std::sqrt(variance_ns()));
   }
 
+  // Returns an estimate of the duration at `quantile` (e.g., 0.99 for the 99th percentile) of the
+  // durations passed to `UpdateStats`.
+  [[nodiscard]] uint64_t ComputeQuantileNs(double quantile) const {
+    return duration_sketch_.ComputeQuantile(quantile);
+  }
+  [[nodiscard]] const orbit_statistics::QuantileSketch& duration_sketch() const {
+    return duration_sketch_;
+  }
+
  private:
   uint64_t count_{};
   uint64_t total_time_ns_{};
   uint64_t min_ns_{};
   uint64_t max_ns_{};
   double variance_ns_{};
+  orbit_statistics::QuantileSketch duration_sketch_;
 };
 
 }  // namespace orbit_client_data
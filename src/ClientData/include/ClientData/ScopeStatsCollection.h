@@ -18,22 +18,23 @@
 #include "ClientData/ScopeStats.h"
 #include "ClientData/TimerTrackDataIdManager.h"
 #include "ClientProtos/capture_data.pb.h"
+#include "Statistics/QuantileSketch.h"
 
 namespace orbit_client_data {
 
-// ScopeStatsCollection holds a subset of all Scopes in a capture keeping track of their stats and
-// ordered durations.
+// ScopeStatsCollection holds a subset of all Scopes in a capture keeping track of their stats,
+// including a sketch of the distribution of their durations.
 class ScopeStatsCollectionInterface {
  public:
   virtual ~ScopeStatsCollectionInterface() = default;
 
   [[nodiscard]] virtual std::vector<ScopeId> GetAllProvidedScopeIds() const = 0;
   [[nodiscard]] virtual const ScopeStats& GetScopeStatsOrDefault(ScopeId scope_id) const = 0;
-  [[nodiscard]] virtual const std::vector<uint64_t>* GetSortedTimerDurationsForScopeId(
+  [[nodiscard]] virtual const orbit_statistics::QuantileSketch* GetDurationSketchForScopeId(
       ScopeId scope_id) const = 0;
 
-  // Calling this function causes the timer durations to no longer be sorted. OnCaptureComplete()
-  // *must* be called after UpdateScopeStats and before GetSortedTimerDurationsForScopeId().
+  // The stats are updated while capturing, so OnCaptureComplete() *must* be called after
+  // UpdateScopeStats and before GetDurationSketchForScopeId().
   virtual void UpdateScopeStats(ScopeId scope_id, const TimerInfo& timer) = 0;
   // TODO(b/249046906): Remove this test-only function.
   virtual void SetScopeStats(ScopeId scope_id, ScopeStats stats) = 0;
@@ -45,10 +46,13 @@ class ScopeStatsCollection : public ScopeStatsCollectionInterface {
   explicit ScopeStatsCollection() = default;
   explicit ScopeStatsCollection(ScopeIdProvider& scope_id_provider,
                                 absl::Span<const TimerInfo* const> timers);
+  // Creates a collection from stats that were aggregated without going through the individual
+  // timers, e.g., using ScopeStats::Merge.
+  explicit ScopeStatsCollection(absl::flat_hash_map<ScopeId, ScopeStats> scope_stats);
 
   [[nodiscard]] std::vector<ScopeId> GetAllProvidedScopeIds() const override;
   [[nodiscard]] const ScopeStats& GetScopeStatsOrDefault(ScopeId scope_id) const override;
-  [[nodiscard]] const std::vector<uint64_t>* GetSortedTimerDurationsForScopeId(
+  [[nodiscard]] const orbit_statistics::QuantileSketch* GetDurationSketchForScopeId(
       ScopeId scope_id) const override;
 
   void UpdateScopeStats(ScopeId scope_id, const TimerInfo& timer) override;
@@ -57,8 +61,7 @@ class ScopeStatsCollection : public ScopeStatsCollectionInterface {
 
  private:
   absl::flat_hash_map<ScopeId, ScopeStats> scope_stats_;
-  absl::flat_hash_map<ScopeId, std::vector<uint64_t>> scope_id_to_timer_durations_;
-  bool timer_durations_are_sorted_ = true;
+  bool capture_is_complete_ = true;
 };
 
 }  // namespace orbit_client_data
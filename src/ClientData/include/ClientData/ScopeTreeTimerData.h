@@ -10,7 +10,9 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <functional>
 #include <limits>
+#include <utility>
 #include <vector>
 
 #include "ClientData/TimerChain.h"
@@ -26,9 +28,13 @@ namespace orbit_client_data {
 class ScopeTreeTimerData final : public TimerDataInterface {
  public:
   enum class ScopeTreeUpdateType { kAlways, kOnCaptureComplete, kNever };
-  explicit ScopeTreeTimerData(int64_t thread_id = -1, ScopeTreeUpdateType scope_tree_update_type =
-                                                          ScopeTreeUpdateType::kAlways)
-      : thread_id_(thread_id), scope_tree_update_type_(scope_tree_update_type){};
+  explicit ScopeTreeTimerData(
+      int64_t thread_id = -1,
+      ScopeTreeUpdateType scope_tree_update_type = ScopeTreeUpdateType::kAlways,
+      TimerData::FullBlockCallback full_block_callback = nullptr)
+      : thread_id_(thread_id),
+        scope_tree_update_type_(scope_tree_update_type),
+        timer_data_(std::move(full_block_callback)){};
 
   // We are using a ScopeTree to automatically manage timers and their depth, no need to set it
   // here.
@@ -43,6 +49,13 @@ class ScopeTreeTimerData final : public TimerDataInterface {
       uint64_t start_ns = std::numeric_limits<uint64_t>::min(),
       uint64_t end_ns = std::numeric_limits<uint64_t>::max(),
       bool exclusive = false) const override;
+  // See TimerData::VisitTimersInRange.
+  void VisitTimersInRange(
+      uint64_t min_tick, uint64_t max_tick,
+      const std::function<void(const TimerBlock&)>& full_block_action,
+      const std::function<void(const orbit_client_protos::TimerInfo&)>& timer_action) const {
+    timer_data_.VisitTimersInRange(min_tick, max_tick, full_block_action, timer_action);
+  }
   [[nodiscard]] std::vector<const orbit_client_protos::TimerInfo*> GetTimersAtDepth(
       uint32_t depth, uint64_t start_ns = std::numeric_limits<uint64_t>::min(),
       uint64_t end_ns = std::numeric_limits<uint64_t>::max()) const;
@@ -8,6 +8,7 @@
 #include <absl/container/flat_hash_map.h>
 #include <absl/synchronization/mutex.h>
 
+#include <utility>
 #include <vector>
 
 #include "ClientData/TimerData.h"
@@ -20,10 +21,12 @@ namespace orbit_client_data {
 // Creates and stores data from Thread Tracks in a thread-safe way, using thread_id as the key.
 class ThreadTrackDataManager final {
  public:
-  explicit ThreadTrackDataManager(bool is_data_from_saved_capture = false)
+  explicit ThreadTrackDataManager(bool is_data_from_saved_capture = false,
+                                  TimerData::FullBlockCallback full_block_callback = nullptr)
       : scope_tree_update_type_(is_data_from_saved_capture
                                     ? ScopeTreeTimerData::ScopeTreeUpdateType::kOnCaptureComplete
-                                    : ScopeTreeTimerData::ScopeTreeUpdateType::kAlways){};
+                                    : ScopeTreeTimerData::ScopeTreeUpdateType::kAlways),
+        full_block_callback_(std::move(full_block_callback)){};
 
   const orbit_client_protos::TimerInfo& AddTimer(orbit_client_protos::TimerInfo timer_info) {
     absl::MutexLock lock(&mutex_);
@@ -32,7 +35,8 @@ class ThreadTrackDataManager final {
     // will be executed many times.
     auto [it, inserted] = scope_tree_timer_data_map_.try_emplace(thread_id, nullptr);
     if (inserted) {
-      it->second = std::make_unique<ScopeTreeTimerData>(thread_id, scope_tree_update_type_);
+      it->second = std::make_unique<ScopeTreeTimerData>(thread_id, scope_tree_update_type_,
+                                                        full_block_callback_);
     }
     return it->second->AddTimer(std::move(timer_info));
   }
@@ -50,7 +54,8 @@ class ThreadTrackDataManager final {
   const ScopeTreeTimerData* CreateScopeTreeTimerData(uint32_t thread_id) {
     absl::MutexLock lock(&mutex_);
     auto [it, unused_inserted] = scope_tree_timer_data_map_.try_emplace(
-        thread_id, std::make_unique<ScopeTreeTimerData>(thread_id, scope_tree_update_type_));
+        thread_id, std::make_unique<ScopeTreeTimerData>(thread_id, scope_tree_update_type_,
+                                                        full_block_callback_));
     return it->second.get();
   };
 
@@ -69,6 +74,7 @@ class ThreadTrackDataManager final {
   absl::flat_hash_map<uint32_t, std::unique_ptr<ScopeTreeTimerData>> scope_tree_timer_data_map_
       ABSL_GUARDED_BY(mutex_);
   ScopeTreeTimerData::ScopeTreeUpdateType scope_tree_update_type_;
+  TimerData::FullBlockCallback full_block_callback_;
 };
 
 }  // namespace orbit_client_data
@@ -8,6 +8,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <functional>
 #include <limits>
 #include <memory>
 #include <utility>
@@ -26,9 +27,12 @@ namespace orbit_client_data {
 // well as metadata about them.
 class ThreadTrackDataProvider final {
  public:
-  explicit ThreadTrackDataProvider(bool is_data_from_saved_capture = false)
-      : thread_track_data_manager_{
-            std::make_unique<ThreadTrackDataManager>(is_data_from_saved_capture)} {};
+  // `full_block_callback` is called with each block of timers when it becomes full, see
+  // TimerData::FullBlockCallback.
+  explicit ThreadTrackDataProvider(bool is_data_from_saved_capture = false,
+                                   TimerData::FullBlockCallback full_block_callback = nullptr)
+      : thread_track_data_manager_{std::make_unique<ThreadTrackDataManager>(
+            is_data_from_saved_capture, std::move(full_block_callback))} {};
 
   const orbit_client_protos::TimerInfo& AddTimer(orbit_client_protos::TimerInfo timer_info) {
     return thread_track_data_manager_->AddTimer(std::move(timer_info));
@@ -55,6 +59,16 @@ class ThreadTrackDataProvider final {
     return scope_tree_timer_data->GetTimers(min_tick, max_tick, exclusive);
   }
 
+  // See TimerData::VisitTimersInRange.
+  void VisitTimersInRange(
+      uint32_t thread_id, uint64_t min_tick, uint64_t max_tick,
+      const std::function<void(const TimerBlock&)>& full_block_action,
+      const std::function<void(const orbit_client_protos::TimerInfo&)>& timer_action) const {
+    const auto* scope_tree_timer_data = GetScopeTreeTimerData(thread_id);
+    if (scope_tree_timer_data == nullptr) return;
+    scope_tree_timer_data->VisitTimersInRange(min_tick, max_tick, full_block_action, timer_action);
+  }
+
   // This method avoids returning two timers that map to the same pixel, so is especially useful
   // when many timers map to the same pixel (zooming-out for example). The overall complexity is
   // O(log(num_timers) * resolution). Resolution should be the pixel width of the area where timers
@@ -53,6 +53,7 @@ class TimerBlock {
   // that have so far been added to this block.
   [[nodiscard]] bool Intersects(uint64_t min, uint64_t max) const;
   [[nodiscard]] uint64_t MinTimestamp() const { return min_timestamp_; }
+  [[nodiscard]] uint64_t MaxTimestamp() const { return max_timestamp_; }
 
   [[nodiscard]] size_t size() const { return data_.size(); }
   [[nodiscard]] bool at_capacity() const { return size() == kBlockSize; }
@@ -133,6 +134,9 @@ class TimerChain {
   [[nodiscard]] const orbit_client_protos::TimerInfo* GetElementBefore(
       const orbit_client_protos::TimerInfo& element) const;
 
+  // The block to which the last timer was added.
+  [[nodiscard]] const TimerBlock& GetLastBlock() const { return *current_; }
+
   [[nodiscard]] TimerChainIterator begin() const { return TimerChainIterator(root_); }
 
   [[nodiscard]] TimerChainIterator end() const { return TimerChainIterator(nullptr); }
@@ -12,9 +12,11 @@
 
 #include <algorithm>
 #include <atomic>
+#include <functional>
 #include <limits>
 #include <map>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "ClientProtos/capture_data.pb.h"
@@ -28,6 +30,12 @@ namespace orbit_client_data {
 // certain range as well as metadata from them. Timers might be divided in different depths.
 class TimerData final : public TimerDataInterface {
  public:
+  // Called with each block of the chains when it becomes full, after which it doesn't change.
+  using FullBlockCallback = std::function<void(const TimerBlock&)>;
+
+  explicit TimerData(FullBlockCallback full_block_callback = nullptr)
+      : full_block_callback_{std::move(full_block_callback)} {}
+
   const orbit_client_protos::TimerInfo& AddTimer(orbit_client_protos::TimerInfo timer_info,
                                                  uint32_t depth = 0) override;
 
@@ -41,6 +49,14 @@ class TimerData final : public TimerDataInterface {
       uint64_t min_tick = std::numeric_limits<uint64_t>::min(),
       uint64_t max_tick = std::numeric_limits<uint64_t>::max(),
       bool exclusive = false) const override;
+  // Visits the timers that lie entirely within [min_tick, max_tick]. Full blocks whose timers all
+  // lie in the range are passed as a whole to `full_block_action`, the other timers are passed one
+  // by one to `timer_action`. As full blocks don't change anymore, callers can cache what they
+  // compute for a block.
+  void VisitTimersInRange(
+      uint64_t min_tick, uint64_t max_tick,
+      const std::function<void(const TimerBlock&)>& full_block_action,
+      const std::function<void(const orbit_client_protos::TimerInfo&)>& timer_action) const;
   // Returns timers in a particular depth avoiding completely overlapped timers that map to the
   // same pixels in the screen. It assures to return at least one timer in each occupied pixel. The
   // overall complexity is faster than GetTimers since it doesn't require going through all timers.
@@ -103,6 +119,8 @@ class TimerData final : public TimerDataInterface {
   std::atomic<uint64_t> max_time_{std::numeric_limits<uint64_t>::min()};
 
   uint32_t process_id_ = orbit_base::kInvalidProcessId;
+
+  FullBlockCallback full_block_callback_;
 };
 
 }  // namespace orbit_client_data
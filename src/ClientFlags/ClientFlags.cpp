@@ -81,5 +81,17 @@ ABSL_FLAG(std::string, ssh_target_process, "",
           "--ssh_key_path also need to be specified (--ssh_port will default to 22). If multiple "
           "instances of the same process exist, the one with the highest PID will be chosen.");
 
+ABSL_FLAG(bool, compact_capture_stream, false,
+          "Ask OrbitService to send the capture data delta-encoded and compressed. This reduces "
+          "the bandwidth used, e.g., over slow SSH tunnels, at the cost of some CPU time.");
+
+ABSL_FLAG(bool, compress_capture_files, false,
+          "Compress the capture section of saved capture files with zstd. Such files are much "
+          "smaller, but older versions of Orbit can't open them.");
+
+ABSL_FLAG(bool, shared_memory_producer_transport, false,
+          "Let the producers in the target process pass their events to OrbitService through "
+          "shared memory instead of gRPC. This reduces the overhead in the target process.");
+
 // Introspection from entry point.
 ABSL_FLAG(bool, introspect, false, "Introspect from entry point");
\ No newline at end of file
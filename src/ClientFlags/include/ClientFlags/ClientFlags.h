@@ -73,6 +73,15 @@ ABSL_DECLARE_FLAG(std::string, ssh_known_host_path);
 ABSL_DECLARE_FLAG(std::string, ssh_key_path);
 ABSL_DECLARE_FLAG(std::string, ssh_target_process);
 
+// Reduces the bandwidth used by captures.
+ABSL_DECLARE_FLAG(bool, compact_capture_stream);
+
+// Writes capture files in version 2 of the format, with a compressed capture section.
+ABSL_DECLARE_FLAG(bool, compress_capture_files);
+
+// Reduces the overhead of the in-process producers.
+ABSL_DECLARE_FLAG(bool, shared_memory_producer_transport);
+
 // Introspection on entry.
 ABSL_DECLARE_FLAG(bool, introspect);
 
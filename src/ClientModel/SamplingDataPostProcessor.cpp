@@ -9,6 +9,7 @@
 #include <absl/container/flat_hash_set.h>
 #include <absl/hash/hash.h>
 #include <absl/meta/type_traits.h>
+#include <absl/types/span.h>
 #include <stddef.h>
 
 #include <algorithm>
@@ -23,8 +24,16 @@
 #include "ClientData/CallstackEvent.h"
 #include "ClientData/CallstackInfo.h"
 #include "ClientData/CallstackType.h"
+#include "ClientData/FunctionInfo.h"
+#include "ClientData/LinuxAddressInfo.h"
 #include "ClientData/ModuleAndFunctionLookup.h"
+#include "ClientData/ModuleData.h"
+#include "ClientData/ModuleInMemory.h"
+#include "ClientData/ProcessData.h"
+#include "ModuleUtils/VirtualAndAbsoluteAddresses.h"
+#include "OrbitBase/Chunk.h"
 #include "OrbitBase/Logging.h"
+#include "OrbitBase/TaskGroup.h"
 #include "OrbitBase/ThreadConstants.h"
 
 using orbit_client_data::CallstackData;
@@ -32,6 +41,9 @@ using orbit_client_data::CallstackEvent;
 using orbit_client_data::CallstackInfo;
 using orbit_client_data::CallstackType;
 using orbit_client_data::CaptureData;
+using orbit_client_data::FunctionInfo;
+using orbit_client_data::LinuxAddressInfo;
+using orbit_client_data::ModuleData;
 using orbit_client_data::ModuleManager;
 using orbit_client_data::PostProcessedSamplingData;
 using orbit_client_data::SampledFunction;
@@ -74,6 +86,36 @@ struct CallstackInfoEq {
   }
 };
 
+// The modules loaded by the process, with their ModuleData, as they were when post-processing
+// started. Lookups in ProcessData and ModuleManager lock a mutex and update a cache, which would
+// serialize the tasks on the thread pool. This copy is immutable, so the tasks can share it without
+// locking. The lookups give the same results as the ones in ModuleAndFunctionLookup.h.
+class ModuleRangesSnapshot {
+ public:
+  explicit ModuleRangesSnapshot(const CaptureData& capture_data,
+                                const ModuleManager& module_manager);
+
+  [[nodiscard]] std::optional<uint64_t> FindFunctionAbsoluteAddressByInstructionAbsoluteAddress(
+      uint64_t absolute_address) const;
+  [[nodiscard]] const std::string& GetFunctionNameByAddress(uint64_t absolute_address) const;
+  [[nodiscard]] const std::string& GetModulePathByAddress(uint64_t absolute_address) const;
+
+ private:
+  struct ModuleRange {
+    uint64_t start;
+    uint64_t end;
+    const ModuleData* module;
+  };
+
+  [[nodiscard]] const ModuleRange* FindModuleRange(uint64_t absolute_address) const;
+  [[nodiscard]] const FunctionInfo* FindFunctionByAddress(const ModuleRange& module_range,
+                                                          uint64_t absolute_address) const;
+
+  const CaptureData* capture_data_;
+  // Sorted by start address, and not overlapping.
+  std::vector<ModuleRange> module_ranges_;
+};
+
 class SamplingDataPostProcessor {
  public:
   explicit SamplingDataPostProcessor() = default;
@@ -88,14 +130,19 @@ class SamplingDataPostProcessor {
                                            const ModuleManager& module_manager);
 
  private:
-  void ResolveCallstacks(const CallstackData& callstack_data, const CaptureData& capture_data,
-                         const ModuleManager& module_manager);
+  void MapAddressesToFunctionAddresses(const CallstackData& callstack_data,
+                                       const ModuleRangesSnapshot& module_ranges);
+
+  void ResolveCallstacks(const CallstackData& callstack_data);
 
-  void MapAddressToFunctionAddress(uint64_t absolute_address, const CaptureData& capture_data,
-                                   const ModuleManager& module_manager);
+  // Computes all the statistics of `thread_sample_data` from its samples_count and
+  // sampled_callstack_id_to_events. This only reads the members, so that it can run for different
+  // threads in parallel.
+  void FillThreadSampleData(ThreadSampleData* thread_sample_data,
+                            const ModuleRangesSnapshot& module_ranges) const;
 
-  void FillThreadSampleDataSampleReports(const CaptureData& capture_data,
-                                         const ModuleManager& module_manager);
+  static void FillThreadSampleDataSampleReports(ThreadSampleData* thread_sample_data,
+                                                const ModuleRangesSnapshot& module_ranges);
 
   // Filled by ProcessSamples.
   absl::flat_hash_map<ThreadID, ThreadSampleData> thread_id_to_sample_data_;
@@ -107,6 +154,8 @@ class SamplingDataPostProcessor {
   absl::flat_hash_map<uint64_t, absl::flat_hash_set<uint64_t>>
       function_address_to_sampled_callstack_ids_;
   absl::flat_hash_map<uint64_t, uint64_t> exact_address_to_function_address_;
+  // The distinct addresses of each callstack that count towards sampled_address_to_count.
+  absl::flat_hash_map<uint64_t, std::vector<uint64_t>> callstack_id_to_sampled_addresses_;
 };
 
 }  // namespace
@@ -119,131 +168,224 @@ PostProcessedSamplingData CreatePostProcessedSamplingData(const CallstackData& c
 }
 
 namespace {
-PostProcessedSamplingData SamplingDataPostProcessor::ProcessSamples(
-    const CallstackData& callstack_data, const CaptureData& capture_data,
-    const ModuleManager& module_manager) {
-  // Unique call stacks and per thread data
-  callstack_data.ForEachCallstackEvent([this, &callstack_data](const CallstackEvent& event) {
-    const CallstackInfo* callstack_info = callstack_data.GetCallstack(event.callstack_id());
-    ORBIT_CHECK(callstack_info != nullptr);
-
-    std::vector<uint64_t> sorted_frames;
-    ORBIT_CHECK(!callstack_info->frames().empty());
-    if (callstack_info->type() == CallstackType::kComplete) {
-      for (uint64_t frame : callstack_info->frames()) {
-        sorted_frames.push_back(frame);
-      }
-    } else {
-      // For non-kComplete callstacks, only use the innermost frame for statistics, as it's the only
-      // one known to be correct. Note that, in the vast majority of cases, the innermost frame is
-      // also the only one available.
-      sorted_frames.push_back(callstack_info->frames()[0]);
-    }
+ModuleRangesSnapshot::ModuleRangesSnapshot(const CaptureData& capture_data,
+                                           const ModuleManager& module_manager)
+    : capture_data_(&capture_data) {
+  for (const auto& [start, module_in_memory] : capture_data.process()->GetMemoryMapCopy()) {
+    const ModuleData* module =
+        module_manager.GetModuleByModuleIdentifier(module_in_memory.module_id());
+    if (module == nullptr) continue;
+    module_ranges_.push_back({start, module_in_memory.end(), module});
+  }
+}
 
-    // We need to consider duplicated frames (because of recursion) only once. We should use a set
-    // for better time complexity but sorting and comparing adjacent elements is faster in practice
-    // for a number of elements in the order of the number of frames in a callstack.
-    std::sort(sorted_frames.begin(), sorted_frames.end());
+const ModuleRangesSnapshot::ModuleRange* ModuleRangesSnapshot::FindModuleRange(
+    uint64_t absolute_address) const {
+  auto it = std::upper_bound(module_ranges_.begin(), module_ranges_.end(), absolute_address,
+                             [](uint64_t address, const ModuleRange& module_range) {
+                               return address < module_range.start;
+                             });
+  if (it == module_ranges_.begin()) return nullptr;
+  --it;
+  if (absolute_address >= it->end) return nullptr;
+  // As in ModuleManager::GetModuleByModuleInMemoryAndAbsoluteAddress, a valid address is at least
+  // start + (executable_segment_offset % kPageSize).
+  if (absolute_address <
+      it->start + it->module->executable_segment_offset() % orbit_module_utils::kPageSize) {
+    return nullptr;
+  }
+  return &*it;
+}
 
-    ThreadSampleData* thread_sample_data = &thread_id_to_sample_data_[event.thread_id()];
-    thread_sample_data->thread_id = event.thread_id();
-    thread_sample_data->samples_count++;
-    thread_sample_data->sampled_callstack_id_to_events[event.callstack_id()].emplace_back(event);
-    for (size_t i = 0; i < sorted_frames.size(); ++i) {
-      if (i != 0 && sorted_frames[i] == sorted_frames[i - 1]) {
-        continue;
-      }
-      thread_sample_data->sampled_address_to_count[sorted_frames[i]]++;
-    }
+const FunctionInfo* ModuleRangesSnapshot::FindFunctionByAddress(const ModuleRange& module_range,
+                                                                uint64_t absolute_address) const {
+  const uint64_t virtual_address = orbit_module_utils::SymbolAbsoluteAddressToVirtualAddress(
+      absolute_address, module_range.start, module_range.module->load_bias(),
+      module_range.module->executable_segment_offset());
+  return module_range.module->FindFunctionByVirtualAddress(virtual_address, /*is_exact=*/false);
+}
 
-    ThreadSampleData* all_thread_sample_data =
-        &thread_id_to_sample_data_[orbit_base::kAllProcessThreadsTid];
-    all_thread_sample_data->thread_id = orbit_base::kAllProcessThreadsTid;
-    all_thread_sample_data->samples_count++;
-    all_thread_sample_data->sampled_callstack_id_to_events[event.callstack_id()].emplace_back(
-        event);
-    for (size_t i = 0; i < sorted_frames.size(); ++i) {
-      if (i != 0 && sorted_frames[i] == sorted_frames[i - 1]) {
-        continue;
-      }
-      all_thread_sample_data->sampled_address_to_count[sorted_frames[i]]++;
+std::optional<uint64_t>
+ModuleRangesSnapshot::FindFunctionAbsoluteAddressByInstructionAbsoluteAddress(
+    uint64_t absolute_address) const {
+  if (const ModuleRange* module_range = FindModuleRange(absolute_address);
+      module_range != nullptr) {
+    if (const FunctionInfo* function = FindFunctionByAddress(*module_range, absolute_address);
+        function != nullptr) {
+      return orbit_module_utils::SymbolVirtualAddressToAbsoluteAddress(
+          function->address(), module_range->start, module_range->module->load_bias(),
+          module_range->module->executable_segment_offset());
     }
-  });
-  // Only include the summary if there is more than 1 thread in the data.
-  if (thread_id_to_sample_data_.size() == 2) {
-    thread_id_to_sample_data_.erase(orbit_base::kAllProcessThreadsTid);
   }
 
-  ResolveCallstacks(callstack_data, capture_data, module_manager);
+  const LinuxAddressInfo* address_info = capture_data_->GetAddressInfo(absolute_address);
+  if (address_info == nullptr) return std::nullopt;
+  return absolute_address - address_info->offset_in_function();
+}
 
-  for (auto& sample_data_it : thread_id_to_sample_data_) {
-    ThreadSampleData* thread_sample_data = &sample_data_it.second;
+const std::string& ModuleRangesSnapshot::GetFunctionNameByAddress(uint64_t absolute_address) const {
+  if (const ModuleRange* module_range = FindModuleRange(absolute_address);
+      module_range != nullptr) {
+    if (const FunctionInfo* function = FindFunctionByAddress(*module_range, absolute_address);
+        function != nullptr) {
+      return function->pretty_name();
+    }
+  }
 
-    // Address count per sample per thread
-    for (const auto& [sampled_callstack_id, callstack_events] :
-         thread_sample_data->sampled_callstack_id_to_events) {
-      uint64_t callstack_count = callstack_events.size();
-      uint64_t resolved_callstack_id = original_id_to_resolved_callstack_id_[sampled_callstack_id];
-      const CallstackInfo& resolved_callstack = id_to_resolved_callstack_.at(resolved_callstack_id);
-
-      // "Exclusive" stat.
-      ORBIT_CHECK(!resolved_callstack.frames().empty());
-      thread_sample_data->resolved_address_to_exclusive_count[resolved_callstack.frames()[0]] +=
-          callstack_count;
+  const LinuxAddressInfo* address_info = capture_data_->GetAddressInfo(absolute_address);
+  if (address_info == nullptr || address_info->function_name().empty()) {
+    return orbit_client_data::kUnknownFunctionOrModuleName;
+  }
+  return address_info->function_name();
+}
 
-      absl::flat_hash_set<uint64_t> unique_resolved_addresses;
-      if (resolved_callstack.type() == CallstackType::kComplete) {
-        for (uint64_t resolved_address : resolved_callstack.frames()) {
-          unique_resolved_addresses.insert(resolved_address);
-        }
-      } else {
-        // For non-kComplete callstacks, only use the innermost frame for statistics.
-        unique_resolved_addresses.insert(resolved_callstack.frames()[0]);
-      }
+const std::string& ModuleRangesSnapshot::GetModulePathByAddress(uint64_t absolute_address) const {
+  if (const ModuleRange* module_range = FindModuleRange(absolute_address);
+      module_range != nullptr) {
+    return module_range->module->file_path();
+  }
 
-      // "Inclusive" stat.
-      for (uint64_t resolved_address : unique_resolved_addresses) {
-        thread_sample_data->resolved_address_to_count[resolved_address] += callstack_count;
-      }
+  const LinuxAddressInfo* address_info = capture_data_->GetAddressInfo(absolute_address);
+  if (address_info == nullptr || address_info->module_path().empty()) {
+    return orbit_client_data::kUnknownFunctionOrModuleName;
+  }
+  return address_info->module_path();
+}
 
-      // "Unwind errors" stat.
-      if (resolved_callstack.type() != CallstackType::kComplete) {
-        thread_sample_data->resolved_address_to_error_count[resolved_callstack.frames()[0]] +=
-            callstack_count;
-      }
+PostProcessedSamplingData SamplingDataPostProcessor::ProcessSamples(
+    const CallstackData& callstack_data, const CaptureData& capture_data,
+    const ModuleManager& module_manager) {
+  // Group the samples by thread. This is the only pass over all the samples that is not parallel,
+  // and it only copies them.
+  std::vector<ThreadSampleData> thread_sample_datas;
+  absl::flat_hash_map<ThreadID, size_t> thread_id_to_index;
+  callstack_data.ForEachCallstackEvent([&](const CallstackEvent& event) {
+    auto [it, inserted] =
+        thread_id_to_index.try_emplace(event.thread_id(), thread_sample_datas.size());
+    if (inserted) {
+      thread_sample_datas.emplace_back().thread_id = event.thread_id();
     }
+    ThreadSampleData* thread_sample_data = &thread_sample_datas[it->second];
+    thread_sample_data->samples_count++;
+    std::vector<CallstackEvent>& events =
+        thread_sample_data->sampled_callstack_id_to_events[event.callstack_id()];
+    if (events.empty()) {
+      // The later passes run on the thread pool and assume that sampled callstacks have frames.
+      const CallstackInfo* callstack_info = callstack_data.GetCallstack(event.callstack_id());
+      ORBIT_CHECK(callstack_info != nullptr);
+      ORBIT_CHECK(!callstack_info->frames().empty());
+    }
+    events.emplace_back(event);
+  });
 
-    // For each thread, sort resolved (function) addresses by inclusive count.
-    for (const auto& address_count_it : thread_sample_data->resolved_address_to_count) {
-      const uint64_t address = address_count_it.first;
-      const uint32_t count = address_count_it.second;
-      thread_sample_data->sorted_count_to_resolved_address.insert(std::make_pair(count, address));
+  // Only include the summary if there is more than 1 thread in the data.
+  if (thread_sample_datas.size() > 1) {
+    // ForEachCallstackEvent visits the events thread by thread, so appending the events of each
+    // thread in the order in which the threads were first visited keeps the events of the summary
+    // in the order of ForEachCallstackEvent.
+    ThreadSampleData all_thread_sample_data;
+    all_thread_sample_data.thread_id = orbit_base::kAllProcessThreadsTid;
+    for (const ThreadSampleData& thread_sample_data : thread_sample_datas) {
+      all_thread_sample_data.samples_count += thread_sample_data.samples_count;
+      for (const auto& [callstack_id, events] : thread_sample_data.sampled_callstack_id_to_events) {
+        std::vector<CallstackEvent>* all_events =
+            &all_thread_sample_data.sampled_callstack_id_to_events[callstack_id];
+        all_events->insert(all_events->end(), events.begin(), events.end());
+      }
     }
+    thread_sample_datas.push_back(std::move(all_thread_sample_data));
+  }
+
+  // The tasks below resolve addresses in this copy of the module ranges, so that they don't
+  // contend on the mutexes of ProcessData and ModuleManager.
+  const ModuleRangesSnapshot module_ranges{capture_data, module_manager};
+
+  MapAddressesToFunctionAddresses(callstack_data, module_ranges);
+  ResolveCallstacks(callstack_data);
+
+  // The statistics of each thread, and of the summary, only depend on the samples of that thread.
+  orbit_base::TaskGroup task_group;
+  for (ThreadSampleData& thread_sample_data : thread_sample_datas) {
+    task_group.AddTask([this, &thread_sample_data, &module_ranges]() {
+      FillThreadSampleData(&thread_sample_data, module_ranges);
+    });
   }
+  task_group.Wait();
 
-  FillThreadSampleDataSampleReports(capture_data, module_manager);
+  thread_id_to_sample_data_.reserve(thread_sample_datas.size());
+  for (ThreadSampleData& thread_sample_data : thread_sample_datas) {
+    ThreadID thread_id = thread_sample_data.thread_id;
+    thread_id_to_sample_data_.emplace(thread_id, std::move(thread_sample_data));
+  }
 
   return {std::move(thread_id_to_sample_data_), std::move(id_to_resolved_callstack_),
           std::move(original_id_to_resolved_callstack_id_),
           std::move(function_address_to_sampled_callstack_ids_)};
 }
 
-void SamplingDataPostProcessor::ResolveCallstacks(const CallstackData& callstack_data,
-                                                  const CaptureData& capture_data,
-                                                  const ModuleManager& module_manager) {
-  callstack_data.ForEachUniqueCallstack([this, &capture_data, &module_manager](
-                                            uint64_t callstack_id, const CallstackInfo& callstack) {
+void SamplingDataPostProcessor::MapAddressesToFunctionAddresses(
+    const CallstackData& callstack_data, const ModuleRangesSnapshot& module_ranges) {
+  // SamplingDataPostProcessor relies heavily on the association between address and function
+  // address held by exact_address_to_function_address_, otherwise each address is considered a
+  // different function. As many callstacks share most of their frames, each distinct address is
+  // only looked up once, and the lookups are spread over the thread pool.
+  absl::flat_hash_set<uint64_t> unique_addresses;
+  callstack_data.ForEachUniqueCallstack(
+      [&unique_addresses](uint64_t /*callstack_id*/, const CallstackInfo& callstack) {
+        unique_addresses.insert(callstack.frames().begin(), callstack.frames().end());
+      });
+
+  std::vector<std::pair<uint64_t, uint64_t>> address_to_function_address;
+  address_to_function_address.reserve(unique_addresses.size());
+  for (uint64_t address : unique_addresses) {
+    address_to_function_address.emplace_back(address, address);
+  }
+
+  constexpr size_t kNumAddressesPerTask = 1024;
+  std::vector<absl::Span<std::pair<uint64_t, uint64_t>>> chunks =
+      orbit_base::CreateChunksOfSize(address_to_function_address, kNumAddressesPerTask);
+  orbit_base::TaskGroup task_group;
+  for (absl::Span<std::pair<uint64_t, uint64_t>>& chunk : chunks) {
+    task_group.AddTask([&chunk, &module_ranges]() {
+      for (auto& [absolute_address, absolute_function_address] : chunk) {
+        absolute_function_address =
+            module_ranges.FindFunctionAbsoluteAddressByInstructionAbsoluteAddress(absolute_address)
+                .value_or(absolute_address);
+      }
+    });
+  }
+  task_group.Wait();
+
+  exact_address_to_function_address_.insert(address_to_function_address.begin(),
+                                             address_to_function_address.end());
+}
+
+void SamplingDataPostProcessor::ResolveCallstacks(const CallstackData& callstack_data) {
+  callstack_data.ForEachUniqueCallstack([this](uint64_t callstack_id,
+                                               const CallstackInfo& callstack) {
+    std::vector<uint64_t> sampled_addresses;
+    if (callstack.type() == CallstackType::kComplete) {
+      sampled_addresses = callstack.frames();
+    } else if (!callstack.frames().empty()) {
+      // For non-kComplete callstacks, only use the innermost frame for statistics, as it's the only
+      // one known to be correct. Note that, in the vast majority of cases, the innermost frame is
+      // also the only one available.
+      sampled_addresses.push_back(callstack.frames()[0]);
+    }
+    // We need to consider duplicated frames (because of recursion) only once. We should use a set
+    // for better time complexity but sorting and comparing adjacent elements is faster in practice
+    // for a number of elements in the order of the number of frames in a callstack.
+    std::sort(sampled_addresses.begin(), sampled_addresses.end());
+    sampled_addresses.erase(std::unique(sampled_addresses.begin(), sampled_addresses.end()),
+                            sampled_addresses.end());
+    callstack_id_to_sampled_addresses_.emplace(callstack_id, std::move(sampled_addresses));
+
     // A "resolved callstack" is a callstack where every address is replaced by the start address of
     // the function (if known).
     std::vector<uint64_t> resolved_callstack_frames;
-
+    resolved_callstack_frames.reserve(callstack.frames().size());
     for (uint64_t address : callstack.frames()) {
-      if (!exact_address_to_function_address_.contains(address)) {
-        MapAddressToFunctionAddress(address, capture_data, module_manager);
-      }
-      auto function_address_it = exact_address_to_function_address_.find(address);
-      ORBIT_CHECK(function_address_it != exact_address_to_function_address_.end());
-      resolved_callstack_frames.push_back(function_address_it->second);
+      resolved_callstack_frames.push_back(exact_address_to_function_address_.at(address));
     }
 
     if (callstack.type() == CallstackType::kComplete) {
@@ -282,63 +424,98 @@ void SamplingDataPostProcessor::ResolveCallstacks(const CallstackData& callstack
   });
 }
 
-void SamplingDataPostProcessor::MapAddressToFunctionAddress(uint64_t absolute_address,
-                                                            const CaptureData& capture_data,
-                                                            const ModuleManager& module_manager) {
-  // SamplingDataPostProcessor relies heavily on the association between address and function
-  // address held by exact_address_to_function_address_, otherwise each address is considered a
-  // different function. We are storing this mapping for faster lookup.
-  std::optional<uint64_t> absolute_function_address_option =
-      orbit_client_data::FindFunctionAbsoluteAddressByInstructionAbsoluteAddress(
-          module_manager, capture_data, absolute_address);
-  uint64_t absolute_function_address = absolute_function_address_option.value_or(absolute_address);
+void SamplingDataPostProcessor::FillThreadSampleData(
+    ThreadSampleData* thread_sample_data, const ModuleRangesSnapshot& module_ranges) const {
+  for (const auto& [sampled_callstack_id, callstack_events] :
+       thread_sample_data->sampled_callstack_id_to_events) {
+    const uint32_t callstack_count = callstack_events.size();
 
-  exact_address_to_function_address_[absolute_address] = absolute_function_address;
+    // Address count per sample per thread
+    auto sampled_addresses_it = callstack_id_to_sampled_addresses_.find(sampled_callstack_id);
+    ORBIT_CHECK(sampled_addresses_it != callstack_id_to_sampled_addresses_.end());
+    ORBIT_CHECK(!sampled_addresses_it->second.empty());
+    for (uint64_t sampled_address : sampled_addresses_it->second) {
+      thread_sample_data->sampled_address_to_count[sampled_address] += callstack_count;
+    }
+
+    uint64_t resolved_callstack_id = original_id_to_resolved_callstack_id_.at(sampled_callstack_id);
+    const CallstackInfo& resolved_callstack = id_to_resolved_callstack_.at(resolved_callstack_id);
+
+    // "Exclusive" stat.
+    ORBIT_CHECK(!resolved_callstack.frames().empty());
+    thread_sample_data->resolved_address_to_exclusive_count[resolved_callstack.frames()[0]] +=
+        callstack_count;
+
+    absl::flat_hash_set<uint64_t> unique_resolved_addresses;
+    if (resolved_callstack.type() == CallstackType::kComplete) {
+      for (uint64_t resolved_address : resolved_callstack.frames()) {
+        unique_resolved_addresses.insert(resolved_address);
+      }
+    } else {
+      // For non-kComplete callstacks, only use the innermost frame for statistics.
+      unique_resolved_addresses.insert(resolved_callstack.frames()[0]);
+    }
+
+    // "Inclusive" stat.
+    for (uint64_t resolved_address : unique_resolved_addresses) {
+      thread_sample_data->resolved_address_to_count[resolved_address] += callstack_count;
+    }
+
+    // "Unwind errors" stat.
+    if (resolved_callstack.type() != CallstackType::kComplete) {
+      thread_sample_data->resolved_address_to_error_count[resolved_callstack.frames()[0]] +=
+          callstack_count;
+    }
+  }
+
+  // Sort resolved (function) addresses by inclusive count.
+  for (const auto& address_count_it : thread_sample_data->resolved_address_to_count) {
+    const uint64_t address = address_count_it.first;
+    const uint32_t count = address_count_it.second;
+    thread_sample_data->sorted_count_to_resolved_address.insert(std::make_pair(count, address));
+  }
+
+  FillThreadSampleDataSampleReports(thread_sample_data, module_ranges);
 }
 
 void SamplingDataPostProcessor::FillThreadSampleDataSampleReports(
-    const CaptureData& capture_data, const ModuleManager& module_manager) {
-  for (auto& data : thread_id_to_sample_data_) {
-    ThreadSampleData* thread_sample_data = &data.second;
-    std::vector<SampledFunction>* sampled_functions = &thread_sample_data->sampled_functions;
-
-    for (auto sorted_it = thread_sample_data->sorted_count_to_resolved_address.rbegin();
-         sorted_it != thread_sample_data->sorted_count_to_resolved_address.rend(); ++sorted_it) {
-      uint32_t num_occurrences = sorted_it->first;
-      uint64_t absolute_address = sorted_it->second;
-
-      SampledFunction function;
-      function.name = orbit_client_data::GetFunctionNameByAddress(module_manager, capture_data,
-                                                                  absolute_address);
-
-      function.inclusive = num_occurrences;
-      function.inclusive_percent = 100.f * num_occurrences / thread_sample_data->samples_count;
-
-      function.exclusive = 0;
-      function.exclusive_percent = 0.f;
-
-      if (auto it = thread_sample_data->resolved_address_to_exclusive_count.find(absolute_address);
-          it != thread_sample_data->resolved_address_to_exclusive_count.end()) {
-        function.exclusive = it->second;
-        function.exclusive_percent = 100.f * it->second / thread_sample_data->samples_count;
-      }
+    ThreadSampleData* thread_sample_data, const ModuleRangesSnapshot& module_ranges) {
+  std::vector<SampledFunction>* sampled_functions = &thread_sample_data->sampled_functions;
 
-      function.unwind_errors = 0;
-      function.unwind_errors_percent = 0.f;
-      if (auto it = thread_sample_data->resolved_address_to_error_count.find(absolute_address);
-          it != thread_sample_data->resolved_address_to_error_count.end()) {
-        function.unwind_errors = it->second;
-        // We only write the innermost frame into "resolved_address_to_error_count", so we get the
-        // sum of all samples with unwinding errors by computing the sum of errors per function.
-        thread_sample_data->unwinding_errors_count += function.unwind_errors;
-        function.unwind_errors_percent = 100.f * it->second / thread_sample_data->samples_count;
-      }
-      function.absolute_address = absolute_address;
-      function.module_path =
-          orbit_client_data::GetModulePathByAddress(module_manager, capture_data, absolute_address);
+  for (auto sorted_it = thread_sample_data->sorted_count_to_resolved_address.rbegin();
+       sorted_it != thread_sample_data->sorted_count_to_resolved_address.rend(); ++sorted_it) {
+    uint32_t num_occurrences = sorted_it->first;
+    uint64_t absolute_address = sorted_it->second;
 
-      sampled_functions->push_back(function);
+    SampledFunction function;
+    function.name = module_ranges.GetFunctionNameByAddress(absolute_address);
+
+    function.inclusive = num_occurrences;
+    function.inclusive_percent = 100.f * num_occurrences / thread_sample_data->samples_count;
+
+    function.exclusive = 0;
+    function.exclusive_percent = 0.f;
+
+    if (auto it = thread_sample_data->resolved_address_to_exclusive_count.find(absolute_address);
+        it != thread_sample_data->resolved_address_to_exclusive_count.end()) {
+      function.exclusive = it->second;
+      function.exclusive_percent = 100.f * it->second / thread_sample_data->samples_count;
     }
+
+    function.unwind_errors = 0;
+    function.unwind_errors_percent = 0.f;
+    if (auto it = thread_sample_data->resolved_address_to_error_count.find(absolute_address);
+        it != thread_sample_data->resolved_address_to_error_count.end()) {
+      function.unwind_errors = it->second;
+      // We only write the innermost frame into "resolved_address_to_error_count", so we get the
+      // sum of all samples with unwinding errors by computing the sum of errors per function.
+      thread_sample_data->unwinding_errors_count += function.unwind_errors;
+      function.unwind_errors_percent = 100.f * it->second / thread_sample_data->samples_count;
+    }
+    function.absolute_address = absolute_address;
+    function.module_path = module_ranges.GetModulePathByAddress(absolute_address);
+
+    sampled_functions->push_back(function);
   }
 }
 
@@ -26,11 +26,15 @@
 #include "ClientData/CaptureData.h"
 #include "ClientData/LinuxAddressInfo.h"
 #include "ClientData/ModuleAndFunctionLookup.h"
+#include "ClientData/ModuleData.h"
 #include "ClientData/ModuleIdentifierProvider.h"
 #include "ClientData/ModuleManager.h"
 #include "ClientData/PostProcessedSamplingData.h"
+#include "ClientData/ProcessData.h"
 #include "ClientModel/SamplingDataPostProcessor.h"
 #include "GrpcProtos/capture.pb.h"
+#include "GrpcProtos/module.pb.h"
+#include "GrpcProtos/symbol.pb.h"
 #include "OrbitBase/Sort.h"
 #include "OrbitBase/ThreadConstants.h"
 
@@ -1690,4 +1694,71 @@ TEST_F(SamplingDataPostProcessorTest, TwoThreadsWithMixedCallstackTypes) {
   VerifyEmptySortedCallstackReport(kThreadIdNotSampled);
 }
 
+
+TEST_F(SamplingDataPostProcessorTest, ResolvesAddressesInLoadedModules) {
+  constexpr uint64_t kModuleStartAddress = 0x1000;
+  constexpr uint64_t kModuleEndAddress = 0x2000;
+  constexpr uint64_t kModuleExecutableSegmentOffset = 0x100;
+  constexpr uint64_t kModuleLoadBias = 0x400000;
+  const std::string kLoadedModulePath = "/path/to/loaded_module";
+  const std::string kLoadedFunctionName = "loaded_function";
+  constexpr uint64_t kLoadedFunctionVirtualAddress = 0x400200;
+  constexpr uint64_t kLoadedFunctionStartAbsoluteAddress = 0x1200;
+  constexpr uint64_t kLoadedFunctionInstructionAbsoluteAddress = 0x1210;
+  // Inside the module, but before its executable segment: this falls back to the address info.
+  constexpr uint64_t kBeforeExecutableSegmentAbsoluteAddress = 0x1050;
+  constexpr uint64_t kBeforeExecutableSegmentOffsetInFunction = 0x10;
+
+  orbit_grpc_protos::ModuleInfo module_info;
+  module_info.set_name("loaded_module");
+  module_info.set_file_path(kLoadedModulePath);
+  module_info.set_build_id("build_id");
+  module_info.set_address_start(kModuleStartAddress);
+  module_info.set_address_end(kModuleEndAddress);
+  module_info.set_executable_segment_offset(kModuleExecutableSegmentOffset);
+  module_info.set_load_bias(kModuleLoadBias);
+  ModuleManager module_manager{&module_identifier_provider_};
+  EXPECT_TRUE(module_manager.AddOrUpdateModules({module_info}).empty());
+  capture_data_.mutable_process()->UpdateModuleInfos({module_info});
+
+  orbit_grpc_protos::SymbolInfo symbol_info;
+  symbol_info.set_demangled_name(kLoadedFunctionName);
+  symbol_info.set_address(kLoadedFunctionVirtualAddress);
+  symbol_info.set_size(0x40);
+  orbit_grpc_protos::ModuleSymbols module_symbols;
+  *module_symbols.add_symbol_infos() = symbol_info;
+  module_manager
+      .GetMutableModuleByModulePathAndBuildId(
+          {.module_path = kLoadedModulePath, .build_id = "build_id"})
+      ->AddSymbols(module_symbols);
+
+  AddAddressInfo(kModulePath, kFunction1Name, kBeforeExecutableSegmentAbsoluteAddress,
+                 kBeforeExecutableSegmentOffsetInFunction);
+  AddCallstackInfo(
+      kCallstack1Id,
+      {kLoadedFunctionInstructionAbsoluteAddress, kBeforeExecutableSegmentAbsoluteAddress},
+      CallstackType::kComplete);
+  AddCallstackEvent(kCallstack1Id, kThreadId1);
+
+  ppsd_ = CreatePostProcessedSamplingData(capture_data_.GetCallstackData(), capture_data_,
+                                          module_manager);
+
+  constexpr uint64_t kBeforeExecutableSegmentFunctionAbsoluteAddress =
+      kBeforeExecutableSegmentAbsoluteAddress - kBeforeExecutableSegmentOffsetInFunction;
+  EXPECT_THAT(ppsd_.GetResolvedCallstack(kCallstack1Id).frames(),
+              ElementsAre(kLoadedFunctionStartAbsoluteAddress,
+                          kBeforeExecutableSegmentFunctionAbsoluteAddress));
+  const ThreadSampleData* thread_sample_data = ppsd_.GetThreadSampleDataByThreadId(kThreadId1);
+  ASSERT_NE(thread_sample_data, nullptr);
+  EXPECT_THAT(
+      thread_sample_data->sampled_functions,
+      UnorderedElementsAre(
+          SampledFunctionEq(MakeSampledFunction(kLoadedFunctionName, kLoadedModulePath, 1, 100.0f,
+                                                1, 100.0f, 0, 0.0f,
+                                                kLoadedFunctionStartAbsoluteAddress)),
+          SampledFunctionEq(MakeSampledFunction(kFunction1Name, kModulePath, 0, 0.0f, 1, 100.0f, 0,
+                                                0.0f,
+                                                kBeforeExecutableSegmentFunctionAbsoluteAddress))));
+}
+
 }  // namespace orbit_client_model
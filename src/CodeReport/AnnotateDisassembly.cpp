@@ -15,6 +15,7 @@
 #include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "OrbitBase/Result.h"
 #include "OrbitBase/Sort.h"
@@ -39,13 +40,20 @@ static std::vector<std::string_view> SplitIntoLines(std::string_view source_file
   // We will show each source code line above the first related instruction
   absl::flat_hash_map<size_t, uint64_t> source_line_to_first_instruction_offset;
 
+  std::vector<uint64_t> addresses(function_info.size());
   for (uint64_t current_offset = 0; current_offset < function_info.size(); ++current_offset) {
-    const auto line_info_or_error = elf->GetLineInfo(current_offset + function_info.address());
-    if (line_info_or_error.has_error()) continue;
-    if (line_info_or_error.value().source_file() != location_info.source_file()) continue;
-    if (line_info_or_error.value().source_line() == 0) continue;
+    addresses[current_offset] = function_info.address() + current_offset;
+  }
+  const std::vector<std::optional<orbit_grpc_protos::LineInfo>> line_infos =
+      elf->GetLineInfos(addresses);
+
+  for (uint64_t current_offset = 0; current_offset < function_info.size(); ++current_offset) {
+    const std::optional<orbit_grpc_protos::LineInfo>& line_info = line_infos[current_offset];
+    if (!line_info.has_value()) continue;
+    if (line_info->source_file() != location_info.source_file()) continue;
+    if (line_info->source_line() == 0) continue;
 
-    const auto source_line = line_info_or_error.value().source_line() - 1;
+    const auto source_line = line_info->source_line() - 1;
     if (source_line >= static_cast<size_t>(source_file_lines.size())) continue;
 
     source_line_to_first_instruction_offset.emplace(source_line, current_offset);
@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <optional>
 #include <string>
+#include <vector>
 
 #include "ClientData/PostProcessedSamplingData.h"
 #include "GrpcProtos/symbol.pb.h"
@@ -24,20 +25,28 @@ SourceCodeReport::SourceCodeReport(std::string_view source_file,
                                    const orbit_client_data::ThreadSampleData& thread_sample_data,
                                    uint32_t total_samples_in_capture)
     : total_samples_in_capture_(total_samples_in_capture) {
+  std::vector<uint64_t> sampled_addresses;
+  std::vector<uint32_t> sample_counts;
   for (size_t offset = 0; offset < function.size(); ++offset) {
     const uint32_t current_samples =
         thread_sample_data.GetCountForAddress(absolute_address + offset);
     if (current_samples == 0) continue;
+    sampled_addresses.push_back(function.address() + offset);
+    sample_counts.push_back(current_samples);
+  }
+  if (sampled_addresses.empty()) return;
 
-    const auto maybe_current_line_info = elf_file->GetLineInfo(function.address() + offset);
-    if (!maybe_current_line_info.has_value()) continue;
+  const std::vector<std::optional<orbit_grpc_protos::LineInfo>> line_infos =
+      elf_file->GetLineInfos(sampled_addresses);
+  for (size_t i = 0; i < sampled_addresses.size(); ++i) {
+    if (!line_infos[i].has_value()) continue;
 
-    const auto& current_line_info = maybe_current_line_info.value();
+    const auto& current_line_info = line_infos[i].value();
     if (source_file != current_line_info.source_file()) {
       ORBIT_ERROR(
           "Was trying to gather sampling data for function \"%s\" but the debug information "
           "tells me the function address %#x is defined in a different source file.",
-          function.pretty_name(), function.address() + offset);
+          function.pretty_name(), sampled_addresses[i]);
       ORBIT_ERROR("Expected: %s", source_file);
       ORBIT_ERROR("Actual: %s", current_line_info.source_file());
       continue;
@@ -46,8 +55,8 @@ SourceCodeReport::SourceCodeReport(std::string_view source_file,
     min_line_number_ = std::min(min_line_number_, current_line_info.source_line());
     max_line_number_ = std::max(max_line_number_, current_line_info.source_line());
 
-    number_of_samples_per_line_[current_line_info.source_line()] += current_samples;
-    total_samples_in_function_ += current_samples;
+    number_of_samples_per_line_[current_line_info.source_line()] += sample_counts[i];
+    total_samples_in_function_ += sample_counts[i];
   }
 }
 
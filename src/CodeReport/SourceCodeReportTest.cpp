@@ -4,6 +4,7 @@
 
 #include <absl/container/flat_hash_map.h>
 #include <absl/hash/hash.h>
+#include <absl/types/span.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <stddef.h>
@@ -46,6 +47,8 @@ class MockElfFile : public orbit_object_utils::ElfFile {
   MOCK_METHOD(std::string, GetSoname, (), (const, override));
   MOCK_METHOD(std::string, GetBuildId, (), (const, override));
   MOCK_METHOD(ErrorMessageOr<orbit_grpc_protos::LineInfo>, GetLineInfo, (uint64_t), (override));
+  MOCK_METHOD(std::vector<std::optional<orbit_grpc_protos::LineInfo>>, GetLineInfos,
+              (absl::Span<const uint64_t>), (override));
   MOCK_METHOD(ErrorMessageOr<orbit_grpc_protos::LineInfo>, GetDeclarationLocationOfFunction,
               (uint64_t), (override));
   MOCK_METHOD(std::optional<orbit_object_utils::GnuDebugLinkInfo>, GetGnuDebugLinkInfo, (),
@@ -60,6 +63,13 @@ class MockElfFile : public orbit_object_utils::ElfFile {
   MOCK_METHOD(bool, IsElf, (), (const, override));
   MOCK_METHOD(bool, IsCoff, (), (const, override));
 };
+// Returns `line_info` for each of the addresses.
+auto ReturnLineInfoForEachAddress(const orbit_grpc_protos::LineInfo& line_info) {
+  return [line_info](absl::Span<const uint64_t> sorted_addresses) {
+    return std::vector<std::optional<orbit_grpc_protos::LineInfo>>(sorted_addresses.size(),
+                                                                    line_info);
+  };
+}
 }  // namespace
 
 namespace orbit_code_report {
@@ -69,7 +79,7 @@ TEST(SourceCodeReport, Empty) {
                                                 "main()",         /*is_hotpatchable=*/false};
 
   MockElfFile elf_file{};
-  EXPECT_CALL(elf_file, GetLineInfo).Times(0);
+  EXPECT_CALL(elf_file, GetLineInfos).Times(0);
 
   orbit_client_data::ThreadSampleData sample_data{};
 
@@ -89,9 +99,8 @@ TEST(SourceCodeReport, Simple) {
   orbit_grpc_protos::LineInfo static_line_info{};
   static_line_info.set_source_file("main.cpp");
   static_line_info.set_source_line(55);
-  EXPECT_CALL(elf_file, GetLineInfo)
-      .Times(static_cast<int>(function_info.size()))
-      .WillRepeatedly(testing::Return(static_line_info));
+  EXPECT_CALL(elf_file, GetLineInfos(testing::SizeIs(function_info.size())))
+      .WillOnce(ReturnLineInfoForEachAddress(static_line_info));
 
   constexpr size_t kAbsoluteAddress = 0x8000;
 
@@ -126,9 +135,8 @@ TEST(SourceCodeReport, NonMatchingSourceFileName) {
   orbit_grpc_protos::LineInfo static_line_info{};
   static_line_info.set_source_file("main.cpp");
   static_line_info.set_source_line(55);
-  EXPECT_CALL(elf_file, GetLineInfo)
-      .Times(static_cast<int>(function_info.size()))
-      .WillRepeatedly(testing::Return(static_line_info));
+  EXPECT_CALL(elf_file, GetLineInfos(testing::SizeIs(function_info.size())))
+      .WillOnce(ReturnLineInfoForEachAddress(static_line_info));
 
   constexpr size_t kAbsoluteAddress = 0x8000;
 
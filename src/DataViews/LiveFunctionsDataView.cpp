@@ -44,6 +44,7 @@
 #include "OrbitBase/File.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Result.h"
+#include "Statistics/QuantileSketch.h"
 
 using orbit_client_data::CaptureData;
 using orbit_client_data::FunctionInfo;
@@ -179,9 +180,9 @@ void LiveFunctionsDataView::UpdateHistogramWithIndices(
 }
 
 void LiveFunctionsDataView::UpdateHistogramWithScopeIds(absl::Span<const ScopeId> scope_ids) {
-  const std::vector<uint64_t>* timer_durations =
+  const orbit_statistics::QuantileSketch* timer_durations =
       (app_->HasCaptureData() && !scope_ids.empty())
-          ? scope_stats_collection_->GetSortedTimerDurationsForScopeId(scope_ids[0])
+          ? scope_stats_collection_->GetDurationSketchForScopeId(scope_ids[0])
           : nullptr;
 
   if (timer_durations == nullptr) {
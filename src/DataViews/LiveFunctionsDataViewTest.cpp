@@ -52,6 +52,7 @@
 #include "MockAppInterface.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Typedef.h"
+#include "Statistics/QuantileSketch.h"
 
 using JumpToTimerMode = orbit_data_views::AppInterface::JumpToTimerMode;
 
@@ -170,11 +171,11 @@ const orbit_client_data::TimerChain kTimerChain = []() {
 
 const std::vector<const orbit_client_data::TimerChain*> kTimerChains = {&kTimerChain};
 
-const std::vector<uint64_t> kDurations = []() {
-  std::vector<uint64_t> durations;
-  std::transform(std::begin(kTimerPointers), std::end(kTimerPointers),
-                 std::back_inserter(durations),
-                 [](const TimerInfo* timer) { return timer->end() - timer->start(); });
+const orbit_statistics::QuantileSketch kDurations = []() {
+  orbit_statistics::QuantileSketch durations;
+  for (const TimerInfo* timer : kTimerPointers) {
+    durations.Add(timer->end() - timer->start());
+  }
   return durations;
 }();
 
@@ -293,7 +294,7 @@ class LiveFunctionsDataViewTest : public testing::Test {
       EXPECT_CALL(*scope_stats_collection, GetScopeStatsOrDefault(kScopeIds[index]))
           .WillRepeatedly(ReturnRef(kScopeStats[index]));
     }
-    EXPECT_CALL(*scope_stats_collection, GetSortedTimerDurationsForScopeId(kScopeIds[0]))
+    EXPECT_CALL(*scope_stats_collection, GetDurationSketchForScopeId(kScopeIds[0]))
         .WillRepeatedly(Return(&kDurations));
 
     view_.SetScopeStatsCollection(std::move(scope_stats_collection));
@@ -907,7 +908,7 @@ TEST_F(LiveFunctionsDataViewTest, HistogramIsProperlyUpdated) {
 
   AddFunctionsByIndices({0});
 
-  EXPECT_CALL(app_, ShowHistogram(testing::Pointee(kDurations), kPrettyNames[0],
+  EXPECT_CALL(app_, ShowHistogram(&kDurations, kPrettyNames[0],
                                   std::optional<ScopeId>(kScopeIds[0])))
       .Times(3);
 
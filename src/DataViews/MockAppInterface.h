@@ -110,7 +110,7 @@ class MockAppInterface : public AppInterface {
               GetConfidenceIntervalEstimator, (), (const, override));
 
   MOCK_METHOD(void, ShowHistogram,
-              (const std::vector<uint64_t>* data, std::string function_name,
+              (const orbit_statistics::QuantileSketch* data, std::string function_name,
                std::optional<ScopeId> scope_id),
               (override));
 
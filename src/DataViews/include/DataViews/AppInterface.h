@@ -27,6 +27,7 @@
 #include "PresetFile/PresetFile.h"
 #include "Statistics/BinomialConfidenceInterval.h"
 #include "Statistics/Histogram.h"
+#include "Statistics/QuantileSketch.h"
 
 namespace orbit_data_views {
 
@@ -116,7 +117,7 @@ class AppInterface : public orbit_client_data::CaptureDataHolder {
   virtual void Disassemble(uint32_t pid, const orbit_client_data::FunctionInfo& function) = 0;
   virtual void ShowSourceCode(const orbit_client_data::FunctionInfo& function) = 0;
 
-  virtual void ShowHistogram(const std::vector<uint64_t>* data, std::string scope_name,
+  virtual void ShowHistogram(const orbit_statistics::QuantileSketch* data, std::string scope_name,
                              std::optional<ScopeId> scope_id) = 0;
 
   [[nodiscard]] virtual const orbit_statistics::BinomialConfidenceIntervalEstimator&
@@ -336,6 +336,8 @@ int main(int argc, char* argv[]) {
   ORBIT_LOG("unwinding_method=%s", options.unwinding_method == CaptureOptions::kFramePointers
                                        ? "Frame pointers"
                                        : "DWARF");
+  options.unwinding_worker_count = absl::GetFlag(FLAGS_unwinding_workers);
+  ORBIT_LOG("unwinding_worker_count=%u", options.unwinding_worker_count);
 
   std::string file_path = absl::GetFlag(FLAGS_instrument_path);
   uint64_t file_offset = absl::GetFlag(FLAGS_instrument_offset);
@@ -377,6 +379,22 @@ int main(int argc, char* argv[]) {
     options.memory_sampling_period_ms = 1'000 / absl::GetFlag(FLAGS_memory_sampling_rate);
     ORBIT_LOG("memory_sampling_period_ms=%u", options.memory_sampling_period_ms);
   }
+  options.pack_capture_events = absl::GetFlag(FLAGS_pack_capture_events);
+  ORBIT_LOG("pack_capture_events=%d", options.pack_capture_events);
+  options.compress_capture_responses = absl::GetFlag(FLAGS_compress_capture_responses);
+  ORBIT_LOG("compress_capture_responses=%d", options.compress_capture_responses);
+  options.max_send_latency_ms = absl::GetFlag(FLAGS_max_send_latency_ms);
+  ORBIT_LOG("max_send_latency_ms=%u", options.max_send_latency_ms);
+  if (absl::GetFlag(FLAGS_event_memory_budget_mb) > 0) {
+    options.event_memory_budget_bytes = absl::GetFlag(FLAGS_event_memory_budget_mb) * 1024 * 1024;
+    options.event_drop_policy =
+        orbit_grpc_protos::CaptureRequest::kDropCallstackSamplesThenSystemEvents;
+  }
+  ORBIT_LOG("event_memory_budget_bytes=%u", options.event_memory_budget_bytes);
+  options.use_shared_memory_producer_transport =
+      absl::GetFlag(FLAGS_shared_memory_producer_transport);
+  ORBIT_LOG("use_shared_memory_producer_transport=%d",
+            options.use_shared_memory_producer_transport);
 
   uint32_t grpc_port = absl::GetFlag(FLAGS_port);
   std::string service_address = absl::StrFormat("127.0.0.1:%d", grpc_port);
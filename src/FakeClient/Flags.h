@@ -42,6 +42,9 @@ ABSL_FLAG(uint32_t, duration, std::numeric_limits<uint32_t>::max(),
 ABSL_FLAG(uint16_t, sampling_rate, 1000,
           "Callstack sampling rate in samples per second (0: no sampling)");
 ABSL_FLAG(bool, frame_pointers, false, "Use frame pointers for unwinding");
+ABSL_FLAG(uint32_t, unwinding_workers, 0,
+          "Number of threads OrbitService uses for DWARF unwinding (0 to unwind on the processing "
+          "thread)");
 ABSL_FLAG(std::string, instrument_path, "", "Path of the binary of the function to instrument");
 ABSL_FLAG(std::string, instrument_name, "", "Name of the function to instrument");
 ABSL_FLAG(uint64_t, instrument_offset, 0, "Offset in the binary of the function to instrument");
@@ -60,5 +63,15 @@ ABSL_FLAG(EventProcessorType, event_processor, EventProcessorType::kFake, "");
 ABSL_FLAG(std::string, pid_file_path, "",
           "Path of the file to watch that will contain the target PID (the file must exists)");
 ABSL_FLAG(std::string, output_path, "", "Path of the output files");
+ABSL_FLAG(bool, pack_capture_events, false,
+          "Ask for the high-frequency events to be sent delta-encoded in columns");
+ABSL_FLAG(bool, compress_capture_responses, false, "Ask for the CaptureResponses to be compressed");
+ABSL_FLAG(uint32_t, max_send_latency_ms, 0,
+          "Longest time the service keeps events before sending them (0: service's default)");
+ABSL_FLAG(uint64_t, event_memory_budget_mb, 0,
+          "Memory of queued events above which the service drops callstack samples, then other "
+          "events (0: never drop events)");
+ABSL_FLAG(bool, shared_memory_producer_transport, false,
+          "Let the in-process producers send their events through shared memory");
 
 #endif  // FAKE_CLIENT_FLAGS_H_
\ No newline at end of file
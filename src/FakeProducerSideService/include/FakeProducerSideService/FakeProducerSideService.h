@@ -54,6 +54,8 @@ class FakeProducerSideService : public orbit_grpc_protos::ProducerSideService::S
         case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::kAllEventsSent:
           OnAllEventsSentReceived();
           break;
+        case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::kSharedMemoryRingBuffer:
+          break;
         case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::EVENT_NOT_SET:
           break;
       }
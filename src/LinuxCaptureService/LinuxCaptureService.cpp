@@ -4,24 +4,37 @@
 
 #include "LinuxCaptureService/LinuxCaptureService.h"
 
+#include <grpcpp/grpcpp.h>
+
 #include <memory>
 
 #include "CaptureServiceBase/CaptureServiceBase.h"
 #include "CaptureServiceBase/GrpcStartStopCaptureRequestWaiter.h"
 #include "GrpcProtos/capture.pb.h"
+#include "GrpcProtos/services.pb.h"
 #include "OrbitBase/ThreadUtils.h"
 #include "ProducerEventProcessor/GrpcClientCaptureEventCollector.h"
 
 namespace orbit_linux_capture_service {
 
 grpc::Status LinuxCaptureService::Capture(
-    grpc::ServerContext* /*context*/,
+    grpc::ServerContext* context,
     grpc::ServerReaderWriter<orbit_grpc_protos::CaptureResponse, orbit_grpc_protos::CaptureRequest>*
         reader_writer) {
   orbit_base::SetCurrentThreadName("CSImpl::Capture");
 
+  // The CaptureRequest is read first, as it carries the options of the
+  // GrpcClientCaptureEventCollector.
+  auto grpc_start_stop_capture_request_waiter =
+      std::make_shared<orbit_capture_service_base::GrpcStartStopCaptureRequestWaiter>(
+          reader_writer);
+  const orbit_grpc_protos::CaptureRequest capture_request =
+      grpc_start_stop_capture_request_waiter->WaitForStartCaptureRequest();
+
   orbit_producer_event_processor::GrpcClientCaptureEventCollector
-      grpc_client_capture_event_collector{reader_writer};
+      grpc_client_capture_event_collector{
+          reader_writer, orbit_producer_event_processor::GrpcClientCaptureEventCollector::
+                             GetOptionsFromCaptureRequest(capture_request)};
   CaptureServiceBase::CaptureInitializationResult initialization_result =
       InitializeCapture(&grpc_client_capture_event_collector);
   switch (initialization_result) {
@@ -32,12 +45,14 @@ grpc::Status LinuxCaptureService::Capture(
               "Cannot start capture because another capture is already in progress"};
   }
 
-  auto grpc_start_stop_capture_request_waiter =
-      std::make_shared<orbit_capture_service_base::GrpcStartStopCaptureRequestWaiter>(
-          reader_writer);
-  const orbit_grpc_protos::CaptureOptions& capture_options =
-      grpc_start_stop_capture_request_waiter->WaitForStartCaptureRequest();
-  DoCapture(capture_options, grpc_start_stop_capture_request_waiter);
+  if (capture_request.capture_response_encoding() ==
+      orbit_grpc_protos::CaptureRequest::kPackedCaptureEvents) {
+    grpc_client_capture_event_collector.EnablePackedCaptureEvents();
+  }
+  if (capture_request.compress_capture_responses()) {
+    context->set_compression_algorithm(GRPC_COMPRESS_GZIP);
+  }
+  DoCapture(capture_request.capture_options(), grpc_start_stop_capture_request_waiter);
 
   return grpc::Status::OK;
 }
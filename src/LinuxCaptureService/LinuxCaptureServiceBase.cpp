@@ -361,9 +361,12 @@ void LinuxCaptureServiceBase::DoCapture(
       FilterOutInstrumentedFunctionsFromCaptureOptions(
           result_or_error.value().instrumented_function_ids, linux_tracing_capture_options);
 
-      ORBIT_LOG("User space instrumentation enabled for %u out of %u instrumented functions.",
-                result_or_error.value().instrumented_function_ids.size(),
-                capture_options.instrumented_functions_size());
+      ORBIT_LOG(
+          "User space instrumentation enabled for %u out of %u instrumented functions (target "
+          "process stopped for %.3f ms).",
+          result_or_error.value().instrumented_function_ids.size(),
+          capture_options.instrumented_functions_size(),
+          absl::ToDoubleMilliseconds(result_or_error.value().stop_duration));
 
       if (!result_or_error.value().function_ids_to_error_messages.empty()) {
         info_from_enabling_user_space_instrumentation =
@@ -0,0 +1,53 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <benchmark/benchmark.h>
+#include <sys/types.h>
+
+#include <cstdint>
+
+#include "BenchmarkUtils/AllocationCounter.h"
+#include "ContextSwitchManager.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+// On each core, the running thread is switched out and the next one is switched in, producing one
+// SchedulingSlice per switch out.
+void BM_ContextSwitches(benchmark::State& state) {
+  const auto core_count = static_cast<uint16_t>(state.range(0));
+  constexpr pid_t kPid = 42;
+  constexpr pid_t kThreadsPerCore = 4;
+
+  ContextSwitchManager manager;
+  uint64_t timestamp_ns = 1;
+  pid_t thread_index = 0;
+  for (uint16_t core = 0; core < core_count; ++core) {
+    manager.ProcessContextSwitchIn(kPid, kPid + core * kThreadsPerCore, core, timestamp_ns);
+  }
+
+  orbit_benchmark_utils::AllocationCounter allocation_counter;
+  int64_t switch_count = 0;
+  for (auto _ : state) {
+    ++timestamp_ns;
+    for (uint16_t core = 0; core < core_count; ++core) {
+      const pid_t prev_tid = kPid + core * kThreadsPerCore + thread_index % kThreadsPerCore;
+      const pid_t next_tid = kPid + core * kThreadsPerCore + (thread_index + 1) % kThreadsPerCore;
+      benchmark::DoNotOptimize(
+          manager.ProcessContextSwitchOut(kPid, prev_tid, core, timestamp_ns));
+      manager.ProcessContextSwitchIn(kPid, next_tid, core, timestamp_ns);
+    }
+    ++thread_index;
+    switch_count += core_count;
+  }
+
+  allocation_counter.Report(state, switch_count);
+}
+
+BENCHMARK(BM_ContextSwitches)->Arg(4)->Arg(64);
+
+}  // namespace
+
+}  // namespace orbit_linux_tracing
@@ -0,0 +1,87 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_NO_OP_TRACER_LISTENER_H_
+#define LINUX_TRACING_NO_OP_TRACER_LISTENER_H_
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#include "GrpcProtos/capture.pb.h"
+#include "LinuxTracing/TracerListener.h"
+
+namespace orbit_linux_tracing {
+
+// TracerListener for benchmarks: it only counts the events it receives, and makes sure the
+// compiler can't optimize away their creation.
+class NoOpTracerListener : public TracerListener {
+ public:
+  void OnSchedulingSlice(orbit_grpc_protos::SchedulingSlice scheduling_slice) override {
+    Consume(scheduling_slice);
+  }
+  void OnCallstackSample(orbit_grpc_protos::FullCallstackSample callstack_sample) override {
+    Consume(callstack_sample);
+  }
+  void OnThreadStateSliceCallstack(
+      orbit_grpc_protos::ThreadStateSliceCallstack callstack) override {
+    Consume(callstack);
+  }
+  void OnFunctionCall(orbit_grpc_protos::FunctionCall function_call) override {
+    Consume(function_call);
+  }
+  void OnGpuJob(orbit_grpc_protos::FullGpuJob gpu_job) override { Consume(gpu_job); }
+  void OnThreadName(orbit_grpc_protos::ThreadName thread_name) override { Consume(thread_name); }
+  void OnThreadNamesSnapshot(
+      orbit_grpc_protos::ThreadNamesSnapshot thread_names_snapshot) override {
+    Consume(thread_names_snapshot);
+  }
+  void OnThreadStateSlice(orbit_grpc_protos::ThreadStateSlice thread_state_slice) override {
+    Consume(thread_state_slice);
+  }
+  void OnAddressInfo(orbit_grpc_protos::FullAddressInfo full_address_info) override {
+    Consume(full_address_info);
+  }
+  void OnTracepointEvent(orbit_grpc_protos::FullTracepointEvent tracepoint_event) override {
+    Consume(tracepoint_event);
+  }
+  void OnModulesSnapshot(orbit_grpc_protos::ModulesSnapshot modules_snapshot) override {
+    Consume(modules_snapshot);
+  }
+  void OnModuleUpdate(orbit_grpc_protos::ModuleUpdateEvent module_update_event) override {
+    Consume(module_update_event);
+  }
+  void OnErrorsWithPerfEventOpenEvent(
+      orbit_grpc_protos::ErrorsWithPerfEventOpenEvent errors_with_perf_event_open_event) override {
+    Consume(errors_with_perf_event_open_event);
+  }
+  void OnLostPerfRecordsEvent(
+      orbit_grpc_protos::LostPerfRecordsEvent lost_perf_records_event) override {
+    Consume(lost_perf_records_event);
+  }
+  void OnOutOfOrderEventsDiscardedEvent(orbit_grpc_protos::OutOfOrderEventsDiscardedEvent
+                                            out_of_order_events_discarded_event) override {
+    Consume(out_of_order_events_discarded_event);
+  }
+  void OnWarningInstrumentingWithUprobesEvent(
+      orbit_grpc_protos::WarningInstrumentingWithUprobesEvent
+          warning_instrumenting_with_uprobes_event) override {
+    Consume(warning_instrumenting_with_uprobes_event);
+  }
+
+  [[nodiscard]] uint64_t GetEventCount() const { return event_count_; }
+
+ private:
+  template <typename T>
+  void Consume(T& event) {
+    benchmark::DoNotOptimize(event);
+    ++event_count_;
+  }
+
+  uint64_t event_count_ = 0;
+};
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_NO_OP_TRACER_LISTENER_H_
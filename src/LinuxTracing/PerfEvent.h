@@ -21,6 +21,7 @@
 
 #include "GrpcProtos/Constants.h"
 #include "OrbitBase/MakeUniqueForOverwrite.h"
+#include "PerfEventBufferPool.h"
 #include "PerfEventOrderedStream.h"
 #include "PerfEventRecords.h"
 
@@ -85,9 +86,9 @@ struct StackSamplePerfEventData {
 
   pid_t pid;
   pid_t tid;
-  std::unique_ptr<uint64_t[]> regs;
+  PerfEventBuffer<uint64_t> regs;
   uint64_t dyn_size;
-  std::unique_ptr<uint8_t[]> data;
+  PerfEventBuffer<uint8_t> data;
 };
 using StackSamplePerfEvent = TypedPerfEvent<StackSamplePerfEventData>;
 
@@ -120,8 +121,8 @@ struct CallchainSamplePerfEventData {
   // LeafFunctionCallManager::PatchCallerOfLeafFunction.
   mutable uint64_t ips_size;
   mutable std::unique_ptr<uint64_t[]> ips;
-  std::unique_ptr<uint64_t[]> regs;
-  std::unique_ptr<uint8_t[]> data;
+  PerfEventBuffer<uint64_t> regs;
+  PerfEventBuffer<uint8_t> data;
 };
 using CallchainSamplePerfEvent = TypedPerfEvent<CallchainSamplePerfEventData>;
 
@@ -155,13 +156,13 @@ struct UprobesWithStackPerfEventData {
   uint64_t stream_id;
   pid_t pid;
   pid_t tid;
-  std::unique_ptr<uint64_t[]> regs;
+  PerfEventBuffer<uint64_t> regs;
 
   uint64_t dyn_size;
   // This mutablility allows moving the data out of this class in the UprobesUnwindingVisitor even
   // if we only have a const reference there. This requires the explicit knowledge that there is
   // only one visitor being applied to this event.
-  mutable std::unique_ptr<uint8_t[]> data;
+  mutable PerfEventBuffer<uint8_t> data;
 };
 using UprobesWithStackPerfEvent = TypedPerfEvent<UprobesWithStackPerfEventData>;
 
@@ -301,8 +302,8 @@ struct SchedWakeupWithCallchainPerfEventData {
   // LeafFunctionCallManager::PatchCallerOfLeafFunction.
   mutable uint64_t ips_size;
   mutable std::unique_ptr<uint64_t[]> ips;
-  std::unique_ptr<uint64_t[]> regs;
-  std::unique_ptr<uint8_t[]> data;
+  PerfEventBuffer<uint64_t> regs;
+  PerfEventBuffer<uint8_t> data;
 };
 using SchedWakeupWithCallchainPerfEvent = TypedPerfEvent<SchedWakeupWithCallchainPerfEventData>;
 
@@ -338,8 +339,8 @@ struct SchedSwitchWithCallchainPerfEventData {
   // LeafFunctionCallManager::PatchCallerOfLeafFunction.
   mutable uint64_t ips_size;
   mutable std::unique_ptr<uint64_t[]> ips;
-  std::unique_ptr<uint64_t[]> regs;
-  std::unique_ptr<uint8_t[]> data;
+  PerfEventBuffer<uint64_t> regs;
+  PerfEventBuffer<uint8_t> data;
 };
 using SchedSwitchWithCallchainPerfEvent = TypedPerfEvent<SchedSwitchWithCallchainPerfEventData>;
 
@@ -364,9 +365,9 @@ struct SchedWakeupWithStackPerfEventData {
   pid_t woken_tid;
   pid_t was_unblocked_by_tid;
   pid_t was_unblocked_by_pid;
-  std::unique_ptr<uint64_t[]> regs;
+  PerfEventBuffer<uint64_t> regs;
   uint64_t dyn_size;
-  std::unique_ptr<uint8_t[]> data;
+  PerfEventBuffer<uint8_t> data;
 };
 using SchedWakeupWithStackPerfEvent = TypedPerfEvent<SchedWakeupWithStackPerfEventData>;
 
@@ -393,9 +394,9 @@ struct SchedSwitchWithStackPerfEventData {
   pid_t prev_tid;
   int64_t prev_state;
   int32_t next_tid;
-  std::unique_ptr<uint64_t[]> regs;
+  PerfEventBuffer<uint64_t> regs;
   uint64_t dyn_size;
-  std::unique_ptr<uint8_t[]> data;
+  PerfEventBuffer<uint8_t> data;
 };
 using SchedSwitchWithStackPerfEvent = TypedPerfEvent<SchedSwitchWithStackPerfEventData>;
 
@@ -0,0 +1,89 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "PerfEventBufferPool.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "OrbitBase/MakeUniqueForOverwrite.h"
+
+namespace orbit_linux_tracing {
+
+PerfEventBufferPool::PerfEventBufferPool(uint64_t stack_data_capacity)
+    : stack_data_capacity_{stack_data_capacity},
+      max_free_stack_data_buffers_{static_cast<size_t>(
+          kMaxFreeStackDataBytes / std::max<uint64_t>(stack_data_capacity, 1))} {}
+
+PerfEventBuffer<uint8_t> PerfEventBufferPool::AllocateStackData(uint64_t size) {
+  if (size > stack_data_capacity_) {
+    CountMiss();
+    return make_unique_for_overwrite<uint8_t[]>(size);
+  }
+
+  {
+    absl::MutexLock lock{&mutex_};
+    if (!free_stack_data_buffers_.empty()) {
+      uint8_t* buffer = free_stack_data_buffers_.back().release();
+      free_stack_data_buffers_.pop_back();
+      CountHit();
+      return PerfEventBuffer<uint8_t>{buffer, PerfEventBufferDeleter<uint8_t>{this}};
+    }
+  }
+
+  CountMiss();
+  return PerfEventBuffer<uint8_t>{
+      make_unique_for_overwrite<uint8_t[]>(stack_data_capacity_).release(),
+      PerfEventBufferDeleter<uint8_t>{this}};
+}
+
+PerfEventBuffer<uint64_t> PerfEventBufferPool::AllocateRegisters(uint64_t count) {
+  if (count > kRegistersCapacity) {
+    CountMiss();
+    return make_unique_for_overwrite<uint64_t[]>(count);
+  }
+
+  {
+    absl::MutexLock lock{&mutex_};
+    if (!free_registers_buffers_.empty()) {
+      uint64_t* buffer = free_registers_buffers_.back().release();
+      free_registers_buffers_.pop_back();
+      CountHit();
+      return PerfEventBuffer<uint64_t>{buffer, PerfEventBufferDeleter<uint64_t>{this}};
+    }
+  }
+
+  CountMiss();
+  return PerfEventBuffer<uint64_t>{
+      make_unique_for_overwrite<uint64_t[]>(kRegistersCapacity).release(),
+      PerfEventBufferDeleter<uint64_t>{this}};
+}
+
+size_t PerfEventBufferPool::GetFreeStackDataBufferCount() const {
+  absl::MutexLock lock{&mutex_};
+  return free_stack_data_buffers_.size();
+}
+
+size_t PerfEventBufferPool::GetFreeRegistersBufferCount() const {
+  absl::MutexLock lock{&mutex_};
+  return free_registers_buffers_.size();
+}
+
+void PerfEventBufferPool::Release(uint8_t* stack_data) {
+  std::unique_ptr<uint8_t[]> buffer{stack_data};
+  absl::MutexLock lock{&mutex_};
+  if (free_stack_data_buffers_.size() < max_free_stack_data_buffers_) {
+    free_stack_data_buffers_.emplace_back(std::move(buffer));
+  }
+}
+
+void PerfEventBufferPool::Release(uint64_t* registers) {
+  std::unique_ptr<uint64_t[]> buffer{registers};
+  absl::MutexLock lock{&mutex_};
+  if (free_registers_buffers_.size() < kMaxFreeRegistersBuffers) {
+    free_registers_buffers_.emplace_back(std::move(buffer));
+  }
+}
+
+}  // namespace orbit_linux_tracing
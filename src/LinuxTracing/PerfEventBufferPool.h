@@ -0,0 +1,123 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_PERF_EVENT_BUFFER_POOL_H_
+#define LINUX_TRACING_PERF_EVENT_BUFFER_POOL_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
+#include <asm/perf_regs.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace orbit_linux_tracing {
+
+class PerfEventBufferPool;
+
+// Deleter for the register and stack buffers of PerfEvents. Buffers that were handed out by a
+// PerfEventBufferPool are given back to it, all other buffers are simply deleted.
+template <typename T>
+class PerfEventBufferDeleter {
+ public:
+  PerfEventBufferDeleter() = default;
+  // Allows assigning buffers created with make_unique_for_overwrite, e.g., in tests.
+  // NOLINTNEXTLINE(google-explicit-constructor): Non-explicit constructor for conversions.
+  PerfEventBufferDeleter(std::default_delete<T[]> /*unused*/) {}
+  explicit PerfEventBufferDeleter(PerfEventBufferPool* pool) : pool_{pool} {}
+
+  void operator()(T* buffer) const;
+
+ private:
+  PerfEventBufferPool* pool_ = nullptr;
+};
+
+template <typename T>
+using PerfEventBuffer = std::unique_ptr<T[], PerfEventBufferDeleter<T>>;
+
+// Under heavy sampling, allocating (and freeing) the up to 64 KiB stack dump of every sample is one
+// of the most expensive operations in the tracer. This class recycles those buffers, as well as the
+// ones for the registers.
+//
+// All stack buffers handed out by the pool have the same capacity, which is the largest stack dump
+// size requested from perf_event_open, so that any of them can be reused for any sample. Buffers
+// are given back to the pool by PerfEventBufferDeleter when the event that owns them is
+// destroyed, normally when PerfEventQueue::PopEvent drops the event. As that can happen on a
+// different thread than the one allocating, the pool is thread-safe. The pool must outlive all the
+// buffers it hands out.
+class PerfEventBufferPool {
+ public:
+  explicit PerfEventBufferPool(uint64_t stack_data_capacity);
+
+  PerfEventBufferPool(const PerfEventBufferPool&) = delete;
+  PerfEventBufferPool& operator=(const PerfEventBufferPool&) = delete;
+  PerfEventBufferPool(PerfEventBufferPool&&) = delete;
+  PerfEventBufferPool& operator=(PerfEventBufferPool&&) = delete;
+
+  // The content of the returned buffers is uninitialized, like with make_unique_for_overwrite.
+  // Requests larger than the capacity of the pooled buffers are served with a regular allocation.
+  [[nodiscard]] PerfEventBuffer<uint8_t> AllocateStackData(uint64_t size);
+  [[nodiscard]] PerfEventBuffer<uint64_t> AllocateRegisters(uint64_t count);
+
+  // An allocation is a hit if it could reuse a buffer that was given back to the pool, and a miss
+  // if it required allocating memory.
+  void SetHitAndMissCounters(std::atomic<uint64_t>* hit_counter,
+                             std::atomic<uint64_t>* miss_counter) {
+    hit_counter_ = hit_counter;
+    miss_counter_ = miss_counter;
+  }
+
+  [[nodiscard]] uint64_t GetStackDataCapacity() const { return stack_data_capacity_; }
+  [[nodiscard]] size_t GetFreeStackDataBufferCount() const;
+  [[nodiscard]] size_t GetFreeRegistersBufferCount() const;
+
+  static constexpr uint64_t kRegistersCapacity = PERF_REG_X86_64_MAX;
+  // Bounds the memory that free buffers keep allocated after a burst of events.
+  static constexpr uint64_t kMaxFreeStackDataBytes = 64ULL * 1024 * 1024;
+  static constexpr size_t kMaxFreeRegistersBuffers = 4096;
+
+ private:
+  friend class PerfEventBufferDeleter<uint8_t>;
+  friend class PerfEventBufferDeleter<uint64_t>;
+
+  void Release(uint8_t* stack_data);
+  void Release(uint64_t* registers);
+
+  void CountHit() const {
+    if (hit_counter_ != nullptr) {
+      ++(*hit_counter_);
+    }
+  }
+  void CountMiss() const {
+    if (miss_counter_ != nullptr) {
+      ++(*miss_counter_);
+    }
+  }
+
+  const uint64_t stack_data_capacity_;
+  const size_t max_free_stack_data_buffers_;
+
+  mutable absl::Mutex mutex_;
+  std::vector<std::unique_ptr<uint8_t[]>> free_stack_data_buffers_ ABSL_GUARDED_BY(mutex_);
+  std::vector<std::unique_ptr<uint64_t[]>> free_registers_buffers_ ABSL_GUARDED_BY(mutex_);
+
+  std::atomic<uint64_t>* hit_counter_ = nullptr;
+  std::atomic<uint64_t>* miss_counter_ = nullptr;
+};
+
+template <typename T>
+void PerfEventBufferDeleter<T>::operator()(T* buffer) const {
+  if (pool_ != nullptr) {
+    pool_->Release(buffer);
+  } else {
+    delete[] buffer;
+  }
+}
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_PERF_EVENT_BUFFER_POOL_H_
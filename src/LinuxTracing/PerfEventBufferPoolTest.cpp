@@ -0,0 +1,136 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "OrbitBase/MakeUniqueForOverwrite.h"
+#include "PerfEvent.h"
+#include "PerfEventBufferPool.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+class PerfEventBufferPoolTest : public ::testing::Test {
+ protected:
+  static constexpr uint64_t kStackDataCapacity = 1024;
+
+  void SetUp() override { pool_.SetHitAndMissCounters(&hit_count_, &miss_count_); }
+
+  PerfEventBufferPool pool_{kStackDataCapacity};
+  std::atomic<uint64_t> hit_count_ = 0;
+  std::atomic<uint64_t> miss_count_ = 0;
+};
+
+}  // namespace
+
+TEST_F(PerfEventBufferPoolTest, ReusesReleasedStackData) {
+  PerfEventBuffer<uint8_t> buffer = pool_.AllocateStackData(kStackDataCapacity);
+  ASSERT_NE(buffer, nullptr);
+  EXPECT_EQ(hit_count_, 0);
+  EXPECT_EQ(miss_count_, 1);
+
+  uint8_t* const raw_buffer = buffer.get();
+  buffer.reset();
+  EXPECT_EQ(pool_.GetFreeStackDataBufferCount(), 1);
+
+  // Smaller requests can reuse the same buffer.
+  buffer = pool_.AllocateStackData(kStackDataCapacity / 2);
+  EXPECT_EQ(buffer.get(), raw_buffer);
+  EXPECT_EQ(hit_count_, 1);
+  EXPECT_EQ(miss_count_, 1);
+  EXPECT_EQ(pool_.GetFreeStackDataBufferCount(), 0);
+}
+
+TEST_F(PerfEventBufferPoolTest, ReusesReleasedRegisters) {
+  PerfEventBuffer<uint64_t> registers = pool_.AllocateRegisters(PERF_REG_X86_64_MAX);
+  ASSERT_NE(registers, nullptr);
+  uint64_t* const raw_registers = registers.get();
+  registers.reset();
+  EXPECT_EQ(pool_.GetFreeRegistersBufferCount(), 1);
+
+  registers = pool_.AllocateRegisters(1);
+  EXPECT_EQ(registers.get(), raw_registers);
+  EXPECT_EQ(hit_count_, 1);
+  EXPECT_EQ(miss_count_, 1);
+}
+
+TEST_F(PerfEventBufferPoolTest, LargerRequestsAreNotPooled) {
+  PerfEventBuffer<uint8_t> buffer = pool_.AllocateStackData(kStackDataCapacity + 1);
+  ASSERT_NE(buffer, nullptr);
+  EXPECT_EQ(miss_count_, 1);
+  buffer.reset();
+  EXPECT_EQ(pool_.GetFreeStackDataBufferCount(), 0);
+
+  PerfEventBuffer<uint64_t> registers =
+      pool_.AllocateRegisters(PerfEventBufferPool::kRegistersCapacity + 1);
+  ASSERT_NE(registers, nullptr);
+  EXPECT_EQ(miss_count_, 2);
+  registers.reset();
+  EXPECT_EQ(pool_.GetFreeRegistersBufferCount(), 0);
+}
+
+TEST_F(PerfEventBufferPoolTest, BuffersNotFromThePoolAreNotReturnedToIt) {
+  PerfEventBuffer<uint8_t> buffer = make_unique_for_overwrite<uint8_t[]>(kStackDataCapacity);
+  buffer.reset();
+  EXPECT_EQ(pool_.GetFreeStackDataBufferCount(), 0);
+}
+
+TEST_F(PerfEventBufferPoolTest, DestroyingEventReturnsBuffers) {
+  {
+    PerfEvent event = StackSamplePerfEvent{
+        .timestamp = 0,
+        .data =
+            {
+                .pid = 1,
+                .tid = 1,
+                .regs = pool_.AllocateRegisters(PERF_REG_X86_64_MAX),
+                .dyn_size = kStackDataCapacity,
+                .data = pool_.AllocateStackData(kStackDataCapacity),
+            },
+    };
+    EXPECT_EQ(pool_.GetFreeStackDataBufferCount(), 0);
+    EXPECT_EQ(pool_.GetFreeRegistersBufferCount(), 0);
+  }
+  EXPECT_EQ(pool_.GetFreeStackDataBufferCount(), 1);
+  EXPECT_EQ(pool_.GetFreeRegistersBufferCount(), 1);
+}
+
+TEST_F(PerfEventBufferPoolTest, NumberOfFreeStackDataBuffersIsBounded) {
+  constexpr uint64_t kLargeStackDataCapacity = PerfEventBufferPool::kMaxFreeStackDataBytes / 4;
+  PerfEventBufferPool pool{kLargeStackDataCapacity};
+
+  std::vector<PerfEventBuffer<uint8_t>> buffers;
+  for (size_t i = 0; i < 8; ++i) {
+    buffers.emplace_back(pool.AllocateStackData(kLargeStackDataCapacity));
+  }
+  buffers.clear();
+  EXPECT_EQ(pool.GetFreeStackDataBufferCount(), 4);
+}
+
+TEST_F(PerfEventBufferPoolTest, BuffersCanBeReleasedOnOtherThreads) {
+  constexpr size_t kBufferCount = 1000;
+  std::vector<PerfEventBuffer<uint8_t>> buffers;
+  for (size_t i = 0; i < kBufferCount; ++i) {
+    buffers.emplace_back(pool_.AllocateStackData(kStackDataCapacity));
+  }
+
+  std::thread releasing_thread{[buffers = std::move(buffers)]() mutable { buffers.clear(); }};
+  for (size_t i = 0; i < kBufferCount; ++i) {
+    PerfEventBuffer<uint8_t> buffer = pool_.AllocateStackData(kStackDataCapacity);
+    EXPECT_NE(buffer, nullptr);
+  }
+  releasing_thread.join();
+
+  EXPECT_EQ(hit_count_ + miss_count_, 2 * kBufferCount);
+  EXPECT_GE(pool_.GetFreeStackDataBufferCount(), 1);
+}
+
+}  // namespace orbit_linux_tracing
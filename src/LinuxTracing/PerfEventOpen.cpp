@@ -26,6 +26,10 @@ perf_event_attr generic_event_attr() {
   pe.sample_id_all = 1;  // Also include timestamps for lost events.
   pe.disabled = 1;
   pe.sample_type = kSampleTypeTidTimeStreamidCpu;
+  // Wake up pollers based on the amount of data in the ring buffer rather than on the number of
+  // records, see kRingBufferWakeupWatermarkBytes.
+  pe.watermark = 1;
+  pe.wakeup_watermark = kRingBufferWakeupWatermarkBytes;
 
   return pe;
 }
@@ -113,6 +113,12 @@ static constexpr uint16_t kSampleStackUserSize8Bytes = 8;
 // See also `ClientFlags.cpp`.
 static constexpr uint16_t kMaxStackSampleUserSize = 65000;
 
+// Pollers of a ring buffer (see PerfEventRingBufferPoller) are woken up when at least this many
+// bytes are available to read. This is low enough compared to the size of our smallest ring buffers
+// (64 KiB) that they are emptied well before overflowing, while still allowing to read several
+// records per wakeup from the busier ring buffers.
+static constexpr uint32_t kRingBufferWakeupWatermarkBytes = 32 * 1024;
+
 // perf_event_open for context switches.
 int context_switch_event_open(pid_t pid, int32_t cpu);
 
@@ -33,6 +33,8 @@ class PerfEventProcessor {
 
   void ProcessOldEvents();
 
+  [[nodiscard]] bool HasEvents() const { return event_queue_.HasEvent(); }
+
   void AddVisitor(PerfEventVisitor* visitor) { visitors_.push_back(visitor); }
 
   void ClearVisitors() { visitors_.clear(); }
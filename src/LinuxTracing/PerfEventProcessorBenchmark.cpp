@@ -0,0 +1,194 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/container/flat_hash_set.h>
+#include <benchmark/benchmark.h>
+#include <sys/types.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include "BenchmarkUtils/AllocationCounter.h"
+#include "NoOpTracerListener.h"
+#include "OrbitBase/MakeUniqueForOverwrite.h"
+#include "PerfEvent.h"
+#include "PerfEventBufferPool.h"
+#include "PerfEventOrderedStream.h"
+#include "PerfEventProcessor.h"
+#include "PerfEventRecords.h"
+#include "PerfEventVisitor.h"
+#include "SwitchesStatesNamesVisitor.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+constexpr pid_t kPid = 42;
+constexpr pid_t kThreadsPerCpu = 4;
+constexpr int kStepsPerCpuPerBatch = 256;
+constexpr uint64_t kStepDurationNs = 1'000;
+// Value of sched_switch's prev_state for a thread going to interruptible sleep.
+constexpr int64_t kTaskInterruptible = 1;
+
+[[nodiscard]] pid_t GetTid(int cpu, int thread_index) {
+  return kPid + 1 + cpu * kThreadsPerCpu + thread_index % kThreadsPerCpu;
+}
+
+// Pushes, for each CPU, a batch of steps in which the thread running on the CPU wakes up the next
+// one and then goes to sleep, switching to it. This is what SwitchesStatesNamesVisitor sees from a
+// capture with thread states and scheduling slices of a process with many busy threads. Events of
+// different CPUs have the same timestamps, and are ordered in the stream of their CPU, like when
+// they are read from the ring buffer of that CPU.
+void PushSchedulingBatch(PerfEventProcessor* processor, int cpu_count, uint64_t batch_index) {
+  for (int step = 0; step < kStepsPerCpuPerBatch; ++step) {
+    const uint64_t step_index = batch_index * kStepsPerCpuPerBatch + step;
+    const uint64_t timestamp_ns = step_index * kStepDurationNs;
+    for (int cpu = 0; cpu < cpu_count; ++cpu) {
+      const pid_t prev_tid = GetTid(cpu, static_cast<int>(step_index));
+      const pid_t next_tid = GetTid(cpu, static_cast<int>(step_index + 1));
+      processor->AddEvent(SchedWakeupPerfEvent{
+          .timestamp = timestamp_ns,
+          .ordered_stream = PerfEventOrderedStream::FileDescriptor(cpu),
+          .data =
+              {
+                  .woken_tid = next_tid,
+                  .was_unblocked_by_tid = prev_tid,
+                  .was_unblocked_by_pid = kPid,
+              },
+      });
+      processor->AddEvent(SchedSwitchPerfEvent{
+          .timestamp = timestamp_ns + kStepDurationNs / 2,
+          .ordered_stream = PerfEventOrderedStream::FileDescriptor(cpu),
+          .data =
+              {
+                  .cpu = static_cast<uint32_t>(cpu),
+                  .prev_pid_or_minus_one = kPid,
+                  .prev_tid = prev_tid,
+                  .prev_state = kTaskInterruptible,
+                  .next_tid = next_tid,
+              },
+      });
+    }
+  }
+}
+
+void BM_ProcessSchedulingEvents(benchmark::State& state) {
+  const auto cpu_count = static_cast<int>(state.range(0));
+
+  NoOpTracerListener listener;
+  SwitchesStatesNamesVisitor visitor{&listener};
+  visitor.SetProduceSchedulingSlices(true);
+  visitor.SetThreadStatePidFilters(absl::flat_hash_set<pid_t>{kPid});
+  for (int cpu = 0; cpu < cpu_count; ++cpu) {
+    for (int thread_index = 0; thread_index < kThreadsPerCpu; ++thread_index) {
+      visitor.ProcessInitialTidToPidAssociation(GetTid(cpu, thread_index), kPid);
+      // The first thread of each CPU is running, the others are sleeping.
+      visitor.ProcessInitialState(0, GetTid(cpu, thread_index), thread_index == 0 ? 'R' : 'S');
+    }
+  }
+
+  PerfEventProcessor processor;
+  processor.AddVisitor(&visitor);
+
+  orbit_benchmark_utils::AllocationCounter allocation_counter;
+  uint64_t batch_index = 0;
+  for (auto _ : state) {
+    PushSchedulingBatch(&processor, cpu_count, batch_index);
+    ++batch_index;
+    // ProcessOldEvents depends on the actual time, so always process everything that was pushed.
+    processor.ProcessAllEvents();
+  }
+
+  allocation_counter.Report(
+      state, static_cast<int64_t>(batch_index) * kStepsPerCpuPerBatch * cpu_count * 2);
+  state.counters["listener_events"] = static_cast<double>(listener.GetEventCount());
+}
+
+BENCHMARK(BM_ProcessSchedulingEvents)->Arg(4)->Arg(16)->Arg(64);
+
+class StackSampleCountingVisitor : public PerfEventVisitor {
+ public:
+  void Visit(uint64_t /*event_timestamp*/, const StackSamplePerfEventData& event_data) override {
+    benchmark::DoNotOptimize(event_data.GetStackData());
+    ++stack_sample_count_;
+  }
+
+  [[nodiscard]] uint64_t GetStackSampleCount() const { return stack_sample_count_; }
+
+ private:
+  uint64_t stack_sample_count_ = 0;
+};
+
+[[nodiscard]] PerfEventBuffer<uint64_t> AllocateRegisters(PerfEventBufferPool* buffer_pool_or_null,
+                                                          uint64_t count) {
+  if (buffer_pool_or_null == nullptr) {
+    return make_unique_for_overwrite<uint64_t[]>(count);
+  }
+  return buffer_pool_or_null->AllocateRegisters(count);
+}
+
+[[nodiscard]] PerfEventBuffer<uint8_t> AllocateStackData(PerfEventBufferPool* buffer_pool_or_null,
+                                                         uint64_t size) {
+  if (buffer_pool_or_null == nullptr) {
+    return make_unique_for_overwrite<uint8_t[]>(size);
+  }
+  return buffer_pool_or_null->AllocateStackData(size);
+}
+
+// Stack samples, which carry the registers and a copy of the stack, are the largest events and the
+// most frequent ones in a typical capture. Passing a non-zero argument allocates their buffers from
+// a PerfEventBufferPool, like TracerImpl does.
+void BM_ProcessStackSamples(benchmark::State& state) {
+  const bool use_buffer_pool = state.range(0) != 0;
+  constexpr int kCpuCount = 16;
+  constexpr int kSamplesPerCpuPerBatch = 64;
+  constexpr uint64_t kStackDumpSize = 16 * 1024;
+  constexpr uint64_t kRegisterCount = sizeof(RingBufferSampleRegsUserAll) / sizeof(uint64_t);
+
+  std::optional<PerfEventBufferPool> buffer_pool;
+  if (use_buffer_pool) {
+    buffer_pool.emplace(kStackDumpSize);
+  }
+  PerfEventBufferPool* buffer_pool_or_null = buffer_pool.has_value() ? &*buffer_pool : nullptr;
+
+  StackSampleCountingVisitor visitor;
+  PerfEventProcessor processor;
+  processor.AddVisitor(&visitor);
+
+  orbit_benchmark_utils::AllocationCounter allocation_counter;
+  uint64_t batch_index = 0;
+  for (auto _ : state) {
+    for (int sample = 0; sample < kSamplesPerCpuPerBatch; ++sample) {
+      const uint64_t timestamp_ns =
+          (batch_index * kSamplesPerCpuPerBatch + sample) * kStepDurationNs;
+      for (int cpu = 0; cpu < kCpuCount; ++cpu) {
+        processor.AddEvent(StackSamplePerfEvent{
+            .timestamp = timestamp_ns,
+            .ordered_stream = PerfEventOrderedStream::FileDescriptor(cpu),
+            .data =
+                {
+                    .pid = kPid,
+                    .tid = GetTid(cpu, sample),
+                    .regs = AllocateRegisters(buffer_pool_or_null, kRegisterCount),
+                    .dyn_size = kStackDumpSize,
+                    .data = AllocateStackData(buffer_pool_or_null, kStackDumpSize),
+                },
+        });
+      }
+    }
+    ++batch_index;
+    processor.ProcessAllEvents();
+  }
+
+  allocation_counter.Report(
+      state, static_cast<int64_t>(batch_index) * kSamplesPerCpuPerBatch * kCpuCount);
+  state.counters["samples_visited"] = static_cast<double>(visitor.GetStackSampleCount());
+}
+
+BENCHMARK(BM_ProcessStackSamples)->Arg(0)->Arg(1);
+
+}  // namespace
+
+}  // namespace orbit_linux_tracing
@@ -4,10 +4,10 @@
 
 #include "PerfEventQueue.h"
 
-#include <absl/meta/type_traits.h>
-#include <stddef.h>
-
 #include <algorithm>
+#include <functional>
+#include <memory>
+#include <new>
 #include <utility>
 
 #include "OrbitBase/Logging.h"
@@ -16,127 +16,205 @@
 
 namespace orbit_linux_tracing {
 
+PerfEventQueue::EventBlock* PerfEventQueue::EventBlockPool::Allocate() {
+  if (free_blocks_ == nullptr) {
+    return blocks_.emplace_back(std::make_unique<EventBlock>()).get();
+  }
+  EventBlock* block = free_blocks_;
+  free_blocks_ = block->next;
+  block->next = nullptr;
+  return block;
+}
+
+void PerfEventQueue::EventBlockPool::Free(EventBlock* block) {
+  block->next = free_blocks_;
+  free_blocks_ = block;
+}
+
+PerfEventQueue::EventBlockQueue::~EventBlockQueue() {
+  while (head_block_ != nullptr) {
+    head_block_->At(head_index_)->~PerfEvent();
+    ++head_index_;
+    if (head_block_ == tail_block_ && head_index_ == tail_index_) {
+      head_block_ = nullptr;
+    } else if (head_index_ == EventBlock::kEventCount) {
+      head_block_ = head_block_->next;
+      head_index_ = 0;
+    }
+  }
+}
+
+void PerfEventQueue::EventBlockQueue::push_back(PerfEvent&& event, EventBlockPool* pool) {
+  if (tail_block_ == nullptr) {
+    head_block_ = pool->Allocate();
+    tail_block_ = head_block_;
+    head_index_ = 0;
+    tail_index_ = 0;
+  } else if (tail_index_ == EventBlock::kEventCount) {
+    EventBlock* block = pool->Allocate();
+    tail_block_->next = block;
+    tail_block_ = block;
+    tail_index_ = 0;
+  }
+  new (&tail_block_->events[tail_index_]) PerfEvent{std::move(event)};
+  ++tail_index_;
+}
+
+void PerfEventQueue::EventBlockQueue::pop_front(EventBlockPool* pool) {
+  ORBIT_CHECK(!empty());
+  head_block_->At(head_index_)->~PerfEvent();
+  ++head_index_;
+  if (head_block_ == tail_block_ && head_index_ == tail_index_) {
+    pool->Free(head_block_);
+    head_block_ = nullptr;
+    tail_block_ = nullptr;
+  } else if (head_index_ == EventBlock::kEventCount) {
+    EventBlock* next_block = head_block_->next;
+    pool->Free(head_block_);
+    head_block_ = next_block;
+    head_index_ = 0;
+  }
+}
+
 void PerfEventQueue::PushEvent(PerfEvent&& event) {
+  ++event_count_;
+  const uint64_t timestamp = event.timestamp;
   const PerfEventOrderedStream order = event.ordered_stream;
+
   if (order == PerfEventOrderedStream::kNone) {
-    priority_queue_of_events_not_ordered_in_stream_.push(std::move(event));
-  } else if (auto queue_it = queues_of_events_ordered_in_stream_.find(order);
-             queue_it != queues_of_events_ordered_in_stream_.end()) {
-    const std::unique_ptr<std::queue<PerfEvent>>& queue = queue_it->second;
+    size_t index = 0;
+    if (free_indices_of_events_not_ordered_in_stream_.empty()) {
+      index = events_not_ordered_in_stream_.size();
+      events_not_ordered_in_stream_.emplace_back(std::move(event));
+    } else {
+      index = free_indices_of_events_not_ordered_in_stream_.back();
+      free_indices_of_events_not_ordered_in_stream_.pop_back();
+      events_not_ordered_in_stream_[index].emplace(std::move(event));
+    }
+    heap_of_events_not_ordered_in_stream_.emplace_back(timestamp, index);
+    std::push_heap(heap_of_events_not_ordered_in_stream_.begin(),
+                   heap_of_events_not_ordered_in_stream_.end(), std::greater<>{});
+    return;
+  }
 
-    ORBIT_CHECK(!queue->empty());
+  if (auto leaf_it = leaves_of_ordered_streams_.find(order);
+      leaf_it != leaves_of_ordered_streams_.end()) {
+    EventBlockQueue& events = events_ordered_in_stream_[leaf_it->second];
+    ORBIT_CHECK(!events.empty());
     // Fundamental assumption: events from the same file descriptor come already in order.
-    ORBIT_CHECK(event.timestamp >= queue->back().timestamp);
-    queue->push(std::move(event));
-  } else {
-    queue_it = queues_of_events_ordered_in_stream_
-                   .emplace(order, std::make_unique<std::queue<PerfEvent>>())
-                   .first;
-    const std::unique_ptr<std::queue<PerfEvent>>& queue = queue_it->second;
-
-    queue->push(std::move(event));
-    heap_of_queues_of_events_ordered_in_stream_.emplace_back(queue.get());
-    MoveUpBackOfHeapOfQueues();
+    ORBIT_CHECK(timestamp >= events.back().timestamp);
+    events.push_back(std::move(event), &event_block_pool_);
+    return;
   }
-}
 
-bool PerfEventQueue::HasEvent() const {
-  return !heap_of_queues_of_events_ordered_in_stream_.empty() ||
-         !priority_queue_of_events_not_ordered_in_stream_.empty();
+  const LeafIndex leaf = AllocateLeaf();
+  leaves_of_ordered_streams_.emplace(order, leaf);
+  events_ordered_in_stream_[leaf].push_back(std::move(event), &event_block_pool_);
+  leaf_timestamps_[leaf] = timestamp;
+  tree_needs_rebuild_ = true;
 }
 
+bool PerfEventQueue::HasEvent() const { return event_count_ > 0; }
+
 const PerfEvent& PerfEventQueue::TopEvent() {
-  // As we effectively have two priority queues, get the older event between the two events at the
-  // top of the two queues. In case those two events have the exact same timestamp, return the one
-  // at the top of priority_queue_of_events_not_ordered_in_stream_ (and do the same in PopEvent).
-  if (priority_queue_of_events_not_ordered_in_stream_.empty()) {
-    ORBIT_CHECK(!heap_of_queues_of_events_ordered_in_stream_.empty());
-    ORBIT_CHECK(!heap_of_queues_of_events_ordered_in_stream_.front()->empty());
-    return heap_of_queues_of_events_ordered_in_stream_.front()->front();
-  }
-  if (heap_of_queues_of_events_ordered_in_stream_.empty()) {
-    ORBIT_CHECK(!priority_queue_of_events_not_ordered_in_stream_.empty());
-    return priority_queue_of_events_not_ordered_in_stream_.top();
+  ORBIT_CHECK(HasEvent());
+  RebuildTreeIfNeeded();
+  if (IsNotOrderedEventOlderThanWinner()) {
+    return TopNotOrderedEvent();
   }
-  return (heap_of_queues_of_events_ordered_in_stream_.front()->front().timestamp <
-          priority_queue_of_events_not_ordered_in_stream_.top().timestamp)
-             ? heap_of_queues_of_events_ordered_in_stream_.front()->front()
-             : priority_queue_of_events_not_ordered_in_stream_.top();
+  return events_ordered_in_stream_[losers_[0]].front();
 }
 
 void PerfEventQueue::PopEvent() {
-  if (!priority_queue_of_events_not_ordered_in_stream_.empty() &&
-      (heap_of_queues_of_events_ordered_in_stream_.empty() ||
-       priority_queue_of_events_not_ordered_in_stream_.top().timestamp <=
-           heap_of_queues_of_events_ordered_in_stream_.front()->front().timestamp)) {
-    // The oldest event is at the top of the priority queue holding the events that cannot be
-    // assumed sorted in any stream. Note in particular that we pop this event even if the event at
-    // the top of heap_of_queues_of_events_ordered_in_stream_ has the exact same timestamp, as we
-    // need to be consistent with TopEvent.
-    priority_queue_of_events_not_ordered_in_stream_.pop();
+  ORBIT_CHECK(HasEvent());
+  RebuildTreeIfNeeded();
+  --event_count_;
+
+  if (IsNotOrderedEventOlderThanWinner()) {
+    PopNotOrderedEvent();
     return;
   }
 
-  std::queue<PerfEvent>* top_queue = heap_of_queues_of_events_ordered_in_stream_.front();
-  const PerfEventOrderedStream top_order = top_queue->front().ordered_stream;
-  top_queue->pop();
+  const LeafIndex winner = losers_[0];
+  EventBlockQueue& events = events_ordered_in_stream_[winner];
+  const PerfEventOrderedStream order = events.front().ordered_stream;
+  events.pop_front(&event_block_pool_);
+  if (events.empty()) {
+    leaves_of_ordered_streams_.erase(order);
+    free_leaves_.push_back(winner);
+    leaf_timestamps_[winner] = kEmptyLeafTimestamp;
+  } else {
+    leaf_timestamps_[winner] = events.front().timestamp;
+  }
+  ReplayWinner();
+}
 
-  if (top_queue->empty()) {
-    queues_of_events_ordered_in_stream_.erase(top_order);
-    std::swap(heap_of_queues_of_events_ordered_in_stream_.front(),
-              heap_of_queues_of_events_ordered_in_stream_.back());
-    heap_of_queues_of_events_ordered_in_stream_.pop_back();
+PerfEventQueue::LeafIndex PerfEventQueue::AllocateLeaf() {
+  if (!free_leaves_.empty()) {
+    const LeafIndex leaf = free_leaves_.back();
+    free_leaves_.pop_back();
+    return leaf;
   }
 
-  MoveDownFrontOfHeapOfQueues();
+  const auto leaf = static_cast<LeafIndex>(events_ordered_in_stream_.size());
+  events_ordered_in_stream_.emplace_back();
+  if (leaf >= leaf_count_) {
+    // Double the number of leaves, so that the tree stays complete. The new leaves are empty.
+    leaf_count_ *= 2;
+    leaf_timestamps_.resize(leaf_count_, kEmptyLeafTimestamp);
+    losers_.resize(leaf_count_);
+  }
+  return leaf;
 }
 
-void PerfEventQueue::MoveDownFrontOfHeapOfQueues() {
-  if (heap_of_queues_of_events_ordered_in_stream_.empty()) {
+void PerfEventQueue::RebuildTreeIfNeeded() {
+  if (!tree_needs_rebuild_) {
     return;
   }
+  tree_needs_rebuild_ = false;
 
-  size_t current_index = 0;
-  while (true) {
-    size_t new_index = current_index;
-    size_t left_index = current_index * 2 + 1;
-    size_t right_index = current_index * 2 + 2;
-    if (left_index < heap_of_queues_of_events_ordered_in_stream_.size() &&
-        heap_of_queues_of_events_ordered_in_stream_[left_index]->front().timestamp <
-            heap_of_queues_of_events_ordered_in_stream_[new_index]->front().timestamp) {
-      new_index = left_index;
-    }
-    if (right_index < heap_of_queues_of_events_ordered_in_stream_.size() &&
-        heap_of_queues_of_events_ordered_in_stream_[right_index]->front().timestamp <
-            heap_of_queues_of_events_ordered_in_stream_[new_index]->front().timestamp) {
-      new_index = right_index;
-    }
-    if (new_index != current_index) {
-      std::swap(heap_of_queues_of_events_ordered_in_stream_[new_index],
-                heap_of_queues_of_events_ordered_in_stream_[current_index]);
-      current_index = new_index;
+  // Play all matches bottom-up. winners_[n] is the winner of the match at node n.
+  winners_.resize(2 * leaf_count_);
+  for (size_t leaf = 0; leaf < leaf_count_; ++leaf) {
+    winners_[leaf_count_ + leaf] = static_cast<LeafIndex>(leaf);
+  }
+  for (size_t node = leaf_count_ - 1; node > 0; --node) {
+    const LeafIndex left = winners_[2 * node];
+    const LeafIndex right = winners_[2 * node + 1];
+    if (IsOlder(right, left)) {
+      winners_[node] = right;
+      losers_[node] = left;
     } else {
-      break;
+      winners_[node] = left;
+      losers_[node] = right;
     }
   }
+  losers_[0] = winners_[1];
 }
 
-void PerfEventQueue::MoveUpBackOfHeapOfQueues() {
-  if (heap_of_queues_of_events_ordered_in_stream_.empty()) {
-    return;
+void PerfEventQueue::ReplayWinner() {
+  LeafIndex winner = losers_[0];
+  uint64_t winner_timestamp = leaf_timestamps_[winner];
+  for (size_t node = (leaf_count_ + winner) / 2; node > 0; node /= 2) {
+    // Written without branches, as the outcome of the matches is unpredictable.
+    const LeafIndex loser = losers_[node];
+    const uint64_t loser_timestamp = leaf_timestamps_[loser];
+    const bool loser_wins = loser_timestamp < winner_timestamp ||
+                            (loser_timestamp == winner_timestamp && loser < winner);
+    losers_[node] = loser_wins ? winner : loser;
+    winner = loser_wins ? loser : winner;
+    winner_timestamp = loser_wins ? loser_timestamp : winner_timestamp;
   }
+  losers_[0] = winner;
+}
 
-  size_t current_index = heap_of_queues_of_events_ordered_in_stream_.size() - 1;
-  while (current_index > 0) {
-    size_t parent_index = (current_index - 1) / 2;
-    if (heap_of_queues_of_events_ordered_in_stream_[parent_index]->front().timestamp <=
-        heap_of_queues_of_events_ordered_in_stream_[current_index]->front().timestamp) {
-      break;
-    }
-    std::swap(heap_of_queues_of_events_ordered_in_stream_[parent_index],
-              heap_of_queues_of_events_ordered_in_stream_[current_index]);
-    current_index = parent_index;
-  }
+void PerfEventQueue::PopNotOrderedEvent() {
+  std::pop_heap(heap_of_events_not_ordered_in_stream_.begin(),
+                heap_of_events_not_ordered_in_stream_.end(), std::greater<>{});
+  const size_t index = heap_of_events_not_ordered_in_stream_.back().second;
+  heap_of_events_not_ordered_in_stream_.pop_back();
+  events_not_ordered_in_stream_[index].reset();
+  free_indices_of_events_not_ordered_in_stream_.push_back(index);
 }
 
 }  // namespace orbit_linux_tracing
@@ -8,9 +8,13 @@
 #include <absl/container/flat_hash_map.h>
 #include <absl/hash/hash.h>
 
-#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <memory>
-#include <queue>
+#include <new>
+#include <optional>
+#include <utility>
 #include <vector>
 
 #include "PerfEvent.h"
@@ -25,47 +29,156 @@ namespace orbit_linux_tracing {
 // Instead of keeping a single priority queue with all the events to process, on which push/pop
 // operations would be logarithmic in the number of events, we leverage the fact that some streams
 // of events are known to be already sorted; for example, most perf_event_open records coming from
-// the same perf_event_open ring buffer are already sorted. We then keep a priority queue of queues,
-// where the events in each queue come from the same sorted stream, identified by matching instances
-// of PerfEventOrderedStream. Whenever an event is removed from a queue, we need to move such queue
-// down the priority queue.
+// the same perf_event_open ring buffer are already sorted. We keep a FIFO queue for each of these
+// streams, identified by matching instances of PerfEventOrderedStream, and merge the queues with a
+// tournament tree (a "loser tree"), in which each queue is a leaf.
+//
+// Each inner node of the tree stores the index of the leaf that lost the match played at that
+// node, and the overall winner, i.e., the leaf with the oldest event, is stored separately. When
+// the oldest event is removed, the winner's leaf only needs to replay the matches on its path to
+// the root, which takes exactly one comparison per level. The comparisons only look at a
+// contiguous array of the timestamps at the front of each leaf, and only leaf indices are moved
+// around, never the (large) PerfEvents themselves.
+//
+// A leaf whose queue was empty (or that is assigned to a new stream) can't be inserted by
+// replaying a single path of a loser tree, so in that case the tree is rebuilt, lazily, before the
+// next call to TopEvent or PopEvent. As PerfEventProcessor pushes events in batches, this happens
+// at most once per batch.
 //
 // In order to be able to add an event to a queue, we also need to maintain the association between
 // a queue and its sorted stream, which is what the map is for. We use the PerfEventOrderedStream as
 // key.
 //
 // Some events, though, are known to come out of order even in relation to other events in the same
-// perf_event_open ring buffer (e.g., dma_fence_signaled). For those cases, use an additional single
-// std::priority_queue.
+// perf_event_open ring buffer (e.g., dma_fence_signaled). For those cases, we use an additional
+// binary heap, whose top is compared with the winner of the tree.
 class PerfEventQueue {
  public:
   void PushEvent(PerfEvent&& event);
   [[nodiscard]] bool HasEvent() const;
   [[nodiscard]] const PerfEvent& TopEvent();
+  // Destroys the oldest event. This also gives its buffers back to their PerfEventBufferPool.
   void PopEvent();
 
  private:
-  // Floats down the element at the top of the ordered_queues_heap_ to its correct place. Used when
-  // the key of the top element changes, or as part of the process of removing the top element.
-  void MoveDownFrontOfHeapOfQueues();
-  // Floats up an element that it is know should be further up in the heap. Used on insertion.
-  void MoveUpBackOfHeapOfQueues();
-
-  // This vector holds the heap of the queues each of which holds events coming from the same
-  // stream of events already in order by timestamp.
-  std::vector<std::queue<PerfEvent>*> heap_of_queues_of_events_ordered_in_stream_;
-  // This map keeps the association between an ordered stream of events and the ordered queue of
-  // events coming from that stream.
-  absl::flat_hash_map<PerfEventOrderedStream, std::unique_ptr<std::queue<PerfEvent>>>
-      queues_of_events_ordered_in_stream_;
-
-  static constexpr auto kPerfEventReverseTimestampCompare =
-      [](const PerfEvent& lhs, const PerfEvent& rhs) { return lhs.timestamp > rhs.timestamp; };
-  // This priority queue holds all those events that cannot be assumed already sorted in a specific
-  // stream. All such events are simply sorted by the priority queue by increasing timestamp.
-  std::priority_queue<PerfEvent, std::vector<PerfEvent>,
-                      std::function<bool(const PerfEvent&, const PerfEvent&)>>
-      priority_queue_of_events_not_ordered_in_stream_{kPerfEventReverseTimestampCompare};
+  // Events of ordered streams are stored in blocks of a fixed number of events. The events are
+  // constructed in place in uninitialized storage, so that they are as densely packed as in a
+  // std::vector<PerfEvent>.
+  struct EventBlock {
+    static constexpr size_t kEventCount = 32;
+    struct alignas(PerfEvent) Storage {
+      std::byte bytes[sizeof(PerfEvent)];
+    };
+
+    [[nodiscard]] PerfEvent* At(size_t index) {
+      return std::launder(reinterpret_cast<PerfEvent*>(&events[index]));
+    }
+
+    Storage events[kEventCount];
+    EventBlock* next = nullptr;
+  };
+
+  // Owns all the EventBlocks and keeps those that are not in use in a free list, shared by all the
+  // ordered streams. Blocks are only allocated when the free list is empty, so that pushes and pops
+  // don't allocate in the steady state. As a block is given back as soon as its last event is
+  // popped, the memory in use stays close to the number of events in the queue, however many
+  // streams there are, and the most recently freed (hence likely cached) block is reused first.
+  class EventBlockPool {
+   public:
+    [[nodiscard]] EventBlock* Allocate();
+    void Free(EventBlock* block);
+
+   private:
+    std::vector<std::unique_ptr<EventBlock>> blocks_;
+    EventBlock* free_blocks_ = nullptr;
+  };
+
+  // FIFO queue of the events of an ordered stream, stored in a linked list of EventBlocks.
+  class EventBlockQueue {
+   public:
+    EventBlockQueue() = default;
+    EventBlockQueue(const EventBlockQueue&) = delete;
+    EventBlockQueue& operator=(const EventBlockQueue&) = delete;
+    EventBlockQueue(EventBlockQueue&& other) noexcept
+        : head_block_{std::exchange(other.head_block_, nullptr)},
+          tail_block_{std::exchange(other.tail_block_, nullptr)},
+          head_index_{std::exchange(other.head_index_, 0)},
+          tail_index_{std::exchange(other.tail_index_, 0)} {}
+    EventBlockQueue& operator=(EventBlockQueue&&) = delete;
+    // Destroys the remaining events. The blocks belong to the EventBlockPool.
+    ~EventBlockQueue();
+
+    [[nodiscard]] bool empty() const { return head_block_ == nullptr; }
+    [[nodiscard]] PerfEvent& front() { return *head_block_->At(head_index_); }
+    [[nodiscard]] const PerfEvent& back() const { return *tail_block_->At(tail_index_ - 1); }
+    void push_back(PerfEvent&& event, EventBlockPool* pool);
+    void pop_front(EventBlockPool* pool);
+
+   private:
+    EventBlock* head_block_ = nullptr;
+    EventBlock* tail_block_ = nullptr;
+    // The index of the front event in `head_block_`.
+    size_t head_index_ = 0;
+    // The index after the back event in `tail_block_`.
+    size_t tail_index_ = 0;
+  };
+
+  using LeafIndex = uint32_t;
+  static constexpr uint64_t kEmptyLeafTimestamp = std::numeric_limits<uint64_t>::max();
+
+  // Ties are broken by leaf index, so that the outcome of the matches doesn't depend on the order
+  // in which they are played.
+  [[nodiscard]] bool IsOlder(LeafIndex lhs, LeafIndex rhs) const {
+    return leaf_timestamps_[lhs] < leaf_timestamps_[rhs] ||
+           (leaf_timestamps_[lhs] == leaf_timestamps_[rhs] && lhs < rhs);
+  }
+
+  [[nodiscard]] LeafIndex AllocateLeaf();
+  // Makes the tree consistent again after leaves were inserted.
+  void RebuildTreeIfNeeded();
+  // Replays the matches on the path from the current winner to the root, after the timestamp of
+  // the winner changed.
+  void ReplayWinner();
+
+  // In case the two events have the exact same timestamp, prefer the one not ordered in any stream
+  // (and do the same in TopEvent and PopEvent).
+  [[nodiscard]] bool IsNotOrderedEventOlderThanWinner() const {
+    return !heap_of_events_not_ordered_in_stream_.empty() &&
+           heap_of_events_not_ordered_in_stream_.front().first <= leaf_timestamps_[losers_[0]];
+  }
+  [[nodiscard]] const PerfEvent& TopNotOrderedEvent() const {
+    return *events_not_ordered_in_stream_[heap_of_events_not_ordered_in_stream_.front().second];
+  }
+  void PopNotOrderedEvent();
+
+  // The number of leaves is always a power of two, so that the tree is complete. Leaf i
+  // corresponds to node leaf_count_ + i. Leaves with no events have kEmptyLeafTimestamp.
+  size_t leaf_count_ = 1;
+  std::vector<uint64_t> leaf_timestamps_{kEmptyLeafTimestamp};
+  // losers_[0] is the overall winner, losers_[n] for n > 0 is the loser of the match at node n.
+  std::vector<LeafIndex> losers_{0};
+  // Scratch space for RebuildTreeIfNeeded.
+  std::vector<LeafIndex> winners_;
+  bool tree_needs_rebuild_ = false;
+  size_t event_count_ = 0;
+
+  // Declared before events_ordered_in_stream_, which hold events in its blocks.
+  EventBlockPool event_block_pool_;
+  // The queues of the events coming from the same stream of events already in order by timestamp,
+  // indexed by leaf.
+  std::vector<EventBlockQueue> events_ordered_in_stream_;
+  // The leaves that are not assigned to any stream.
+  std::vector<LeafIndex> free_leaves_;
+  // This map keeps the association between an ordered stream of events and the leaf holding the
+  // queue of events coming from that stream.
+  absl::flat_hash_map<PerfEventOrderedStream, LeafIndex> leaves_of_ordered_streams_;
+
+  // These hold all those events that cannot be assumed already sorted in a specific stream. The
+  // events stay in place in events_not_ordered_in_stream_, while the min-heap only moves pairs of
+  // timestamp and index into that vector.
+  std::vector<std::optional<PerfEvent>> events_not_ordered_in_stream_;
+  std::vector<size_t> free_indices_of_events_not_ordered_in_stream_;
+  std::vector<std::pair<uint64_t, size_t>> heap_of_events_not_ordered_in_stream_;
 };
 
 }  // namespace orbit_linux_tracing
@@ -0,0 +1,219 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/container/flat_hash_map.h>
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "BenchmarkUtils/AllocationCounter.h"
+#include "PerfEvent.h"
+#include "PerfEventOrderedStream.h"
+#include "PerfEventQueue.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+// The previous implementation of PerfEventQueue, kept as a baseline: a binary heap of pointers to
+// std::queues, one for each ordered stream, plus a std::priority_queue with a std::function
+// comparator for the events that are not ordered in any stream.
+class HeapOfQueuesPerfEventQueue {
+ public:
+  void PushEvent(PerfEvent&& event) {
+    const PerfEventOrderedStream order = event.ordered_stream;
+    if (order == PerfEventOrderedStream::kNone) {
+      priority_queue_of_events_not_ordered_in_stream_.push(std::move(event));
+    } else if (auto queue_it = queues_of_events_ordered_in_stream_.find(order);
+               queue_it != queues_of_events_ordered_in_stream_.end()) {
+      queue_it->second->push(std::move(event));
+    } else {
+      queue_it = queues_of_events_ordered_in_stream_
+                     .emplace(order, std::make_unique<std::queue<PerfEvent>>())
+                     .first;
+      queue_it->second->push(std::move(event));
+      heap_.emplace_back(queue_it->second.get());
+      MoveUpBackOfHeap();
+    }
+  }
+
+  [[nodiscard]] bool HasEvent() const {
+    return !heap_.empty() || !priority_queue_of_events_not_ordered_in_stream_.empty();
+  }
+
+  [[nodiscard]] const PerfEvent& TopEvent() {
+    if (priority_queue_of_events_not_ordered_in_stream_.empty()) {
+      return heap_.front()->front();
+    }
+    if (heap_.empty()) {
+      return priority_queue_of_events_not_ordered_in_stream_.top();
+    }
+    return (heap_.front()->front().timestamp <
+            priority_queue_of_events_not_ordered_in_stream_.top().timestamp)
+               ? heap_.front()->front()
+               : priority_queue_of_events_not_ordered_in_stream_.top();
+  }
+
+  void PopEvent() {
+    if (!priority_queue_of_events_not_ordered_in_stream_.empty() &&
+        (heap_.empty() || priority_queue_of_events_not_ordered_in_stream_.top().timestamp <=
+                              heap_.front()->front().timestamp)) {
+      priority_queue_of_events_not_ordered_in_stream_.pop();
+      return;
+    }
+
+    std::queue<PerfEvent>* top_queue = heap_.front();
+    const PerfEventOrderedStream top_order = top_queue->front().ordered_stream;
+    top_queue->pop();
+    if (top_queue->empty()) {
+      queues_of_events_ordered_in_stream_.erase(top_order);
+      std::swap(heap_.front(), heap_.back());
+      heap_.pop_back();
+    }
+    MoveDownFrontOfHeap();
+  }
+
+ private:
+  void MoveDownFrontOfHeap() {
+    size_t current_index = 0;
+    while (true) {
+      size_t new_index = current_index;
+      const size_t left_index = current_index * 2 + 1;
+      const size_t right_index = current_index * 2 + 2;
+      if (left_index < heap_.size() &&
+          heap_[left_index]->front().timestamp < heap_[new_index]->front().timestamp) {
+        new_index = left_index;
+      }
+      if (right_index < heap_.size() &&
+          heap_[right_index]->front().timestamp < heap_[new_index]->front().timestamp) {
+        new_index = right_index;
+      }
+      if (new_index == current_index) {
+        break;
+      }
+      std::swap(heap_[new_index], heap_[current_index]);
+      current_index = new_index;
+    }
+  }
+
+  void MoveUpBackOfHeap() {
+    size_t current_index = heap_.size() - 1;
+    while (current_index > 0) {
+      const size_t parent_index = (current_index - 1) / 2;
+      if (heap_[parent_index]->front().timestamp <= heap_[current_index]->front().timestamp) {
+        break;
+      }
+      std::swap(heap_[parent_index], heap_[current_index]);
+      current_index = parent_index;
+    }
+  }
+
+  std::vector<std::queue<PerfEvent>*> heap_;
+  absl::flat_hash_map<PerfEventOrderedStream, std::unique_ptr<std::queue<PerfEvent>>>
+      queues_of_events_ordered_in_stream_;
+  std::priority_queue<PerfEvent, std::vector<PerfEvent>,
+                      std::function<bool(const PerfEvent&, const PerfEvent&)>>
+      priority_queue_of_events_not_ordered_in_stream_{
+          [](const PerfEvent& lhs, const PerfEvent& rhs) { return lhs.timestamp > rhs.timestamp; }};
+};
+
+constexpr int kEventsPerStreamPerBatch = 64;
+constexpr uint64_t kBatchDurationNs = 64'000;
+
+// Pushes a batch of events covering kBatchDurationNs for each stream. Streams are interleaved as
+// they would be when reading from multiple ring buffers, and the events of each stream are spread
+// with some jitter over the duration of the batch. One event out of 64 has no order, like, e.g.,
+// dma_fence_signaled.
+template <typename QueueT>
+void PushBatch(QueueT* event_queue, int stream_count, uint64_t batch_index,
+               std::mt19937* random_engine) {
+  constexpr uint64_t kEventSpacingNs = kBatchDurationNs / kEventsPerStreamPerBatch;
+  std::uniform_int_distribution<uint64_t> jitter_distribution{0, kEventSpacingNs - 1};
+  for (int i = 0; i < kEventsPerStreamPerBatch; ++i) {
+    for (int stream = 0; stream < stream_count; ++stream) {
+      const uint64_t timestamp = batch_index * kBatchDurationNs + i * kEventSpacingNs +
+                                 jitter_distribution(*random_engine);
+      event_queue->PushEvent(ForkPerfEvent{
+          .timestamp = timestamp,
+          .ordered_stream = (timestamp % 64 == 0) ? PerfEventOrderedStream::kNone
+                                                  : PerfEventOrderedStream::FileDescriptor(stream),
+      });
+    }
+  }
+}
+
+// Simulates how PerfEventProcessor uses the queue: a batch of events from many ring buffers
+// (streams) is pushed, then the events older than a few batches are popped, leaving the rest in the
+// queue for the next iteration.
+template <typename QueueT>
+void BM_PushAndPopEvents(benchmark::State& state) {
+  const auto stream_count = static_cast<int>(state.range(0));
+  constexpr uint64_t kBatchesKeptInQueue = 4;
+
+  std::mt19937 random_engine{42};
+  QueueT event_queue;
+  orbit_benchmark_utils::AllocationCounter allocation_counter;
+  uint64_t batch_index = 0;
+  for (auto _ : state) {
+    PushBatch(&event_queue, stream_count, batch_index, &random_engine);
+    ++batch_index;
+
+    const uint64_t max_timestamp_to_pop =
+        (batch_index > kBatchesKeptInQueue ? batch_index - kBatchesKeptInQueue : 0) *
+        kBatchDurationNs;
+    while (event_queue.HasEvent() && event_queue.TopEvent().timestamp < max_timestamp_to_pop) {
+      benchmark::DoNotOptimize(event_queue.TopEvent().timestamp);
+      event_queue.PopEvent();
+    }
+  }
+
+  allocation_counter.Report(
+      state, static_cast<int64_t>(batch_index) * kEventsPerStreamPerBatch * stream_count);
+}
+
+// Only measures popping, hence merging the streams, from a queue filled beforehand.
+template <typename QueueT>
+void BM_PopEvents(benchmark::State& state) {
+  const auto stream_count = static_cast<int>(state.range(0));
+  constexpr uint64_t kBatchCount = 4;
+
+  std::mt19937 random_engine{42};
+  QueueT event_queue;
+  orbit_benchmark_utils::AllocationCounter allocation_counter;
+  uint64_t batch_index = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    allocation_counter.Pause();
+    for (uint64_t i = 0; i < kBatchCount; ++i) {
+      PushBatch(&event_queue, stream_count, batch_index, &random_engine);
+      ++batch_index;
+    }
+    allocation_counter.Resume();
+    state.ResumeTiming();
+
+    while (event_queue.HasEvent()) {
+      benchmark::DoNotOptimize(event_queue.TopEvent().timestamp);
+      event_queue.PopEvent();
+    }
+  }
+
+  allocation_counter.Report(
+      state, static_cast<int64_t>(batch_index) * kEventsPerStreamPerBatch * stream_count);
+}
+
+BENCHMARK_TEMPLATE(BM_PushAndPopEvents, PerfEventQueue)->Arg(8)->Arg(64)->Arg(256);
+BENCHMARK_TEMPLATE(BM_PushAndPopEvents, HeapOfQueuesPerfEventQueue)->Arg(8)->Arg(64)->Arg(256);
+BENCHMARK_TEMPLATE(BM_PopEvents, PerfEventQueue)->Arg(8)->Arg(64)->Arg(256);
+BENCHMARK_TEMPLATE(BM_PopEvents, HeapOfQueuesPerfEventQueue)->Arg(8)->Arg(64)->Arg(256);
+
+}  // namespace
+
+}  // namespace orbit_linux_tracing
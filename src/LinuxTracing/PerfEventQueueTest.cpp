@@ -6,7 +6,10 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <algorithm>
 #include <memory>
+#include <random>
+#include <vector>
 
 #include "PerfEvent.h"
 #include "PerfEventOrderedStream.h"
@@ -419,4 +422,59 @@ TEST(
   EXPECT_NE(top_order, remaining_order);
 }
 
+TEST(PerfEventQueue, ManyStreamsInterleavedWithPops) {
+  constexpr int kStreamCount = 300;
+  constexpr int kRoundCount = 50;
+  PerfEventQueue event_queue;
+  std::mt19937 random_engine{42};
+  std::uniform_int_distribution<uint64_t> timestamp_increment_distribution{0, 10};
+  std::uniform_int_distribution<int> stream_distribution{0, kStreamCount - 1};
+  std::uniform_int_distribution<int> stream_type_distribution{0, 2};
+  std::vector<uint64_t> last_timestamp_of_stream(kStreamCount, 0);
+  std::vector<uint64_t> pending_timestamps;
+  uint64_t last_popped_timestamp = 0;
+
+  for (int round = 0; round < kRoundCount; ++round) {
+    // Push a batch of events that are in order within each stream, and random events with no
+    // order, all newer than the events already popped.
+    for (int i = 0; i < 200; ++i) {
+      const int stream = stream_distribution(random_engine);
+      uint64_t& timestamp = last_timestamp_of_stream[stream];
+      timestamp = std::max(timestamp, last_popped_timestamp) +
+                  timestamp_increment_distribution(random_engine);
+      switch (stream_type_distribution(random_engine)) {
+        case 0:
+          event_queue.PushEvent(MakeTestEventOrderedInFd(stream, timestamp));
+          break;
+        case 1:
+          event_queue.PushEvent(MakeTestEventNotOrdered(timestamp));
+          break;
+        default:
+          event_queue.PushEvent(MakeTestEventOrderedInTid(stream, timestamp));
+          break;
+      }
+      pending_timestamps.push_back(timestamp);
+    }
+
+    // Pop about half of the events, possibly emptying some streams.
+    std::sort(pending_timestamps.begin(), pending_timestamps.end());
+    const size_t pop_count = pending_timestamps.size() / 2;
+    for (size_t i = 0; i < pop_count; ++i) {
+      ASSERT_TRUE(event_queue.HasEvent());
+      ASSERT_EQ(event_queue.TopEvent().timestamp, pending_timestamps[i]);
+      last_popped_timestamp = event_queue.TopEvent().timestamp;
+      event_queue.PopEvent();
+    }
+    pending_timestamps.erase(pending_timestamps.begin(),
+                             pending_timestamps.begin() + static_cast<ptrdiff_t>(pop_count));
+  }
+
+  for (uint64_t expected_timestamp : pending_timestamps) {
+    ASSERT_TRUE(event_queue.HasEvent());
+    ASSERT_EQ(event_queue.TopEvent().timestamp, expected_timestamp);
+    event_queue.PopEvent();
+  }
+  EXPECT_FALSE(event_queue.HasEvent());
+}
+
 }  // namespace orbit_linux_tracing
@@ -18,6 +18,7 @@
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/MakeUniqueForOverwrite.h"
 #include "PerfEvent.h"
+#include "PerfEventBufferPool.h"
 #include "PerfEventOpen.h"
 #include "PerfEventOrderedStream.h"
 #include "PerfEventRecords.h"
@@ -52,12 +53,12 @@ struct PerfRecordSample {
   // uint64_t bnr;                        /* if PERF_SAMPLE_BRANCH_STACK */
   // struct perf_branch_entry lbr[bnr];   /* if PERF_SAMPLE_BRANCH_STACK */
 
-  uint64_t abi;                     /* if PERF_SAMPLE_REGS_USER */
-  std::unique_ptr<uint64_t[]> regs; /* if PERF_SAMPLE_REGS_USER */
+  uint64_t abi;                   /* if PERF_SAMPLE_REGS_USER */
+  PerfEventBuffer<uint64_t> regs; /* if PERF_SAMPLE_REGS_USER */
 
-  uint64_t stack_size;                   /* if PERF_SAMPLE_STACK_USER */
-  std::unique_ptr<uint8_t[]> stack_data; /* if PERF_SAMPLE_STACK_USER */
-  uint64_t dyn_size;                     /* if PERF_SAMPLE_STACK_USER && size != 0 */
+  uint64_t stack_size;                 /* if PERF_SAMPLE_STACK_USER */
+  PerfEventBuffer<uint8_t> stack_data; /* if PERF_SAMPLE_STACK_USER */
+  uint64_t dyn_size;                   /* if PERF_SAMPLE_STACK_USER && size != 0 */
 
   // uint64_t weight;                     /* if PERF_SAMPLE_WEIGHT */
   // uint64_t data_src;                   /* if PERF_SAMPLE_DATA_SRC */
@@ -68,10 +69,10 @@ struct PerfRecordSample {
   // uint64_t cgroup;                     /* if PERF_SAMPLE_CGROUP */
 };
 
-[[nodiscard]] static PerfRecordSample ConsumeRecordSample(PerfEventRingBuffer* ring_buffer,
-                                                          const perf_event_header& header,
-                                                          perf_event_attr flags,
-                                                          bool copy_stack_related_data = true) {
+// If `buffer_pool` is not null, the buffers for the registers and the stack are taken from it.
+[[nodiscard]] static PerfRecordSample ConsumeRecordSample(
+    PerfEventRingBuffer* ring_buffer, const perf_event_header& header, perf_event_attr flags,
+    bool copy_stack_related_data = true, PerfEventBufferPool* buffer_pool = nullptr) {
   ORBIT_CHECK(header.size >
               sizeof(perf_event_header) + sizeof(RingBufferSampleIdTidTimeStreamidCpu));
 
@@ -158,7 +159,8 @@ struct PerfRecordSample {
     if (event.abi != PERF_SAMPLE_REGS_ABI_NONE) {
       const int num_of_regs = std::bitset<64>(flags.sample_regs_user).count();
       if (copy_stack_related_data) {
-        event.regs = make_unique_for_overwrite<uint64_t[]>(num_of_regs);
+        event.regs = (buffer_pool != nullptr) ? buffer_pool->AllocateRegisters(num_of_regs)
+                                              : make_unique_for_overwrite<uint64_t[]>(num_of_regs);
         ring_buffer->ReadRawAtOffset(event.regs.get(), current_offset,
                                      num_of_regs * sizeof(uint64_t));
       }
@@ -174,7 +176,9 @@ struct PerfRecordSample {
       // we can use it to not copy unnessary parts of the stack.
       ring_buffer->ReadRawAtOffset(
           &event.dyn_size, current_offset + (event.stack_size * sizeof(uint8_t)), sizeof(uint64_t));
-      event.stack_data = make_unique_for_overwrite<uint8_t[]>(event.dyn_size);
+      event.stack_data = (buffer_pool != nullptr)
+                             ? buffer_pool->AllocateStackData(event.dyn_size)
+                             : make_unique_for_overwrite<uint8_t[]>(event.dyn_size);
       ring_buffer->ReadRawAtOffset(event.stack_data.get(), current_offset,
                                    event.dyn_size * sizeof(uint8_t));
     }
@@ -307,7 +311,8 @@ MmapPerfEvent ConsumeMmapPerfEvent(PerfEventRingBuffer* ring_buffer,
 }
 
 StackSamplePerfEvent ConsumeStackSamplePerfEvent(PerfEventRingBuffer* ring_buffer,
-                                                 const perf_event_header& header) {
+                                                 const perf_event_header& header,
+                                                 PerfEventBufferPool* buffer_pool) {
   // The flags here are in sync with stack_sample_event_open in PerfEventOpen.
   // TODO(b/242020362): use the same perf_event_attr object from stack_sample_event_open
   const perf_event_attr flags{
@@ -315,7 +320,8 @@ StackSamplePerfEvent ConsumeStackSamplePerfEvent(PerfEventRingBuffer* ring_buffe
       .sample_regs_user = kSampleRegsUserAll,
   };
 
-  PerfRecordSample res = ConsumeRecordSample(ring_buffer, header, flags);
+  PerfRecordSample res = ConsumeRecordSample(ring_buffer, header, flags,
+                                             /*copy_stack_related_data=*/true, buffer_pool);
 
   StackSamplePerfEvent event{
       .timestamp = res.time,
@@ -335,7 +341,8 @@ StackSamplePerfEvent ConsumeStackSamplePerfEvent(PerfEventRingBuffer* ring_buffe
 }
 
 CallchainSamplePerfEvent ConsumeCallchainSamplePerfEvent(PerfEventRingBuffer* ring_buffer,
-                                                         const perf_event_header& header) {
+                                                         const perf_event_header& header,
+                                                         PerfEventBufferPool* buffer_pool) {
   // The flags here are in sync with callchain_sample_event_open in PerfEventOpen.
   // TODO(b/242020362): use the same perf_event_attr object from callchain_sample_event_open
   const perf_event_attr flags{
@@ -344,7 +351,8 @@ CallchainSamplePerfEvent ConsumeCallchainSamplePerfEvent(PerfEventRingBuffer* ri
       .sample_regs_user = kSampleRegsUserAll,
   };
 
-  PerfRecordSample res = ConsumeRecordSample(ring_buffer, header, flags);
+  PerfRecordSample res = ConsumeRecordSample(ring_buffer, header, flags,
+                                             /*copy_stack_related_data=*/true, buffer_pool);
 
   CallchainSamplePerfEvent event{
       .timestamp = res.time,
@@ -365,7 +373,8 @@ CallchainSamplePerfEvent ConsumeCallchainSamplePerfEvent(PerfEventRingBuffer* ri
 }
 
 UprobesWithStackPerfEvent ConsumeUprobeWithStackPerfEvent(PerfEventRingBuffer* ring_buffer,
-                                                          const perf_event_header& header) {
+                                                          const perf_event_header& header,
+                                                          PerfEventBufferPool* buffer_pool) {
   // The flags here are in sync with uprobes_with_stack_and_sp_event_open in PerfEventOpen.
   // TODO(b/242020362): use the same perf_event_attr object from
   // uprobes_with_stack_and_sp_event_open
@@ -374,7 +383,8 @@ UprobesWithStackPerfEvent ConsumeUprobeWithStackPerfEvent(PerfEventRingBuffer* r
       .sample_regs_user = kSampleRegsUserSp,
   };
 
-  PerfRecordSample res = ConsumeRecordSample(ring_buffer, header, flags);
+  PerfRecordSample res = ConsumeRecordSample(ring_buffer, header, flags,
+                                             /*copy_stack_related_data=*/true, buffer_pool);
   ring_buffer->SkipRecord(header);
 
   UprobesWithStackPerfEvent event{
@@ -449,7 +459,8 @@ SchedWakeupPerfEvent ConsumeSchedWakeupPerfEvent(PerfEventRingBuffer* ring_buffe
 
 PerfEvent ConsumeSchedWakeupWithOrWithoutCallchainPerfEvent(PerfEventRingBuffer* ring_buffer,
                                                             const perf_event_header& header,
-                                                            bool copy_stack_related_data) {
+                                                            bool copy_stack_related_data,
+                                                            PerfEventBufferPool* buffer_pool) {
   // The flags here are in sync with tracepoint_with_callchain_event_open in PerfEventOpen.
   // TODO(b/242020362): use the same perf_event_attr object from
   // tracepoint_with_callchain_event_open
@@ -458,7 +469,8 @@ PerfEvent ConsumeSchedWakeupWithOrWithoutCallchainPerfEvent(PerfEventRingBuffer*
                                              PERF_SAMPLE_STACK_USER,
                               .sample_regs_user = kSampleRegsUserAll};
 
-  PerfRecordSample res = ConsumeRecordSample(ring_buffer, header, flags, copy_stack_related_data);
+  PerfRecordSample res =
+      ConsumeRecordSample(ring_buffer, header, flags, copy_stack_related_data, buffer_pool);
 
   SchedWakeupTracepointDataFixed sched_wakeup;
   std::memcpy(&sched_wakeup, res.raw_data.get(), sizeof(SchedWakeupTracepointDataFixed));
@@ -499,7 +511,8 @@ PerfEvent ConsumeSchedWakeupWithOrWithoutCallchainPerfEvent(PerfEventRingBuffer*
 
 PerfEvent ConsumeSchedWakeupWithOrWithoutStackPerfEvent(PerfEventRingBuffer* ring_buffer,
                                                         const perf_event_header& header,
-                                                        bool copy_stack_related_data) {
+                                                        bool copy_stack_related_data,
+                                                        PerfEventBufferPool* buffer_pool) {
   // The flags here are in sync with tracepoint_with_stack_event_open in PerfEventOpen.
   // TODO(b/242020362): use the same perf_event_attr object from
   // tracepoint_with_stack_event_open
@@ -507,7 +520,8 @@ PerfEvent ConsumeSchedWakeupWithOrWithoutStackPerfEvent(PerfEventRingBuffer* rin
                                              PERF_SAMPLE_REGS_USER | PERF_SAMPLE_STACK_USER,
                               .sample_regs_user = kSampleRegsUserAll};
 
-  PerfRecordSample res = ConsumeRecordSample(ring_buffer, header, flags, copy_stack_related_data);
+  PerfRecordSample res =
+      ConsumeRecordSample(ring_buffer, header, flags, copy_stack_related_data, buffer_pool);
 
   SchedWakeupTracepointDataFixed sched_wakeup;
   std::memcpy(&sched_wakeup, res.raw_data.get(), sizeof(SchedWakeupTracepointDataFixed));
@@ -549,7 +563,8 @@ PerfEvent ConsumeSchedWakeupWithOrWithoutStackPerfEvent(PerfEventRingBuffer* rin
 
 PerfEvent ConsumeSchedSwitchWithOrWithoutStackPerfEvent(PerfEventRingBuffer* ring_buffer,
                                                         const perf_event_header& header,
-                                                        bool copy_stack_related_data) {
+                                                        bool copy_stack_related_data,
+                                                        PerfEventBufferPool* buffer_pool) {
   // The flags here are in sync with tracepoint_with_stack_event_open in PerfEventOpen.
   // TODO(b/242020362): use the same perf_event_attr object from
   // tracepoint_with_stack_event_open
@@ -557,7 +572,8 @@ PerfEvent ConsumeSchedSwitchWithOrWithoutStackPerfEvent(PerfEventRingBuffer* rin
                                              PERF_SAMPLE_REGS_USER | PERF_SAMPLE_STACK_USER,
                               .sample_regs_user = kSampleRegsUserAll};
 
-  PerfRecordSample res = ConsumeRecordSample(ring_buffer, header, flags, copy_stack_related_data);
+  PerfRecordSample res =
+      ConsumeRecordSample(ring_buffer, header, flags, copy_stack_related_data, buffer_pool);
 
   SchedSwitchTracepointData sched_switch;
   std::memcpy(&sched_switch, res.raw_data.get(), sizeof(SchedSwitchTracepointData));
@@ -607,7 +623,8 @@ PerfEvent ConsumeSchedSwitchWithOrWithoutStackPerfEvent(PerfEventRingBuffer* rin
 
 PerfEvent ConsumeSchedSwitchWithOrWithoutCallchainPerfEvent(PerfEventRingBuffer* ring_buffer,
                                                             const perf_event_header& header,
-                                                            bool copy_stack_related_data) {
+                                                            bool copy_stack_related_data,
+                                                            PerfEventBufferPool* buffer_pool) {
   // The flags here are in sync with tracepoint_with_callchain_event_open in PerfEventOpen.
   // TODO(b/242020362): use the same perf_event_attr object from
   // tracepoint_with_callchain_event_open
@@ -616,7 +633,8 @@ PerfEvent ConsumeSchedSwitchWithOrWithoutCallchainPerfEvent(PerfEventRingBuffer*
                                              PERF_SAMPLE_STACK_USER,
                               .sample_regs_user = kSampleRegsUserAll};
 
-  PerfRecordSample res = ConsumeRecordSample(ring_buffer, header, flags, copy_stack_related_data);
+  PerfRecordSample res =
+      ConsumeRecordSample(ring_buffer, header, flags, copy_stack_related_data, buffer_pool);
 
   SchedSwitchTracepointData sched_switch;
   std::memcpy(&sched_switch, res.raw_data.get(), sizeof(SchedSwitchTracepointData));
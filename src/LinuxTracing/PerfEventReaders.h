@@ -10,6 +10,7 @@
 #include <sys/types.h>
 
 #include "PerfEvent.h"
+#include "PerfEventBufferPool.h"
 #include "PerfEventRecords.h"
 #include "PerfEventRingBuffer.h"
 
@@ -17,6 +18,8 @@ namespace orbit_linux_tracing {
 
 // Helper functions for reads from a perf_event_open ring buffer that require
 // more complex operations than simply copying an entire perf_event_open record.
+// The functions that copy registers and stack data take those buffers from `buffer_pool`, unless it
+// is null.
 
 // This function reads sample_id, which is always the last field
 // in the perf event record unless it is PERF_RECORD_SAMPLE.
@@ -35,13 +38,16 @@ void ReadPerfSampleIdAll(PerfEventRingBuffer* ring_buffer, const perf_event_head
                                                  const perf_event_header& header);
 
 [[nodiscard]] UprobesWithStackPerfEvent ConsumeUprobeWithStackPerfEvent(
-    PerfEventRingBuffer* ring_buffer, const perf_event_header& header);
+    PerfEventRingBuffer* ring_buffer, const perf_event_header& header,
+    PerfEventBufferPool* buffer_pool);
 
 [[nodiscard]] StackSamplePerfEvent ConsumeStackSamplePerfEvent(PerfEventRingBuffer* ring_buffer,
-                                                               const perf_event_header& header);
+                                                               const perf_event_header& header,
+                                                               PerfEventBufferPool* buffer_pool);
 
 [[nodiscard]] CallchainSamplePerfEvent ConsumeCallchainSamplePerfEvent(
-    PerfEventRingBuffer* ring_buffer, const perf_event_header& header);
+    PerfEventRingBuffer* ring_buffer, const perf_event_header& header,
+    PerfEventBufferPool* buffer_pool);
 
 [[nodiscard]] GenericTracepointPerfEvent ConsumeGenericTracepointPerfEvent(
     PerfEventRingBuffer* ring_buffer, const perf_event_header& header);
@@ -51,19 +57,19 @@ void ReadPerfSampleIdAll(PerfEventRingBuffer* ring_buffer, const perf_event_head
 
 [[nodiscard]] PerfEvent ConsumeSchedWakeupWithOrWithoutCallchainPerfEvent(
     PerfEventRingBuffer* ring_buffer, const perf_event_header& header,
-    bool copy_stack_related_data);
+    bool copy_stack_related_data, PerfEventBufferPool* buffer_pool);
 
 [[nodiscard]] PerfEvent ConsumeSchedSwitchWithOrWithoutCallchainPerfEvent(
     PerfEventRingBuffer* ring_buffer, const perf_event_header& header,
-    bool copy_stack_related_data);
+    bool copy_stack_related_data, PerfEventBufferPool* buffer_pool);
 
 [[nodiscard]] PerfEvent ConsumeSchedSwitchWithOrWithoutStackPerfEvent(
     PerfEventRingBuffer* ring_buffer, const perf_event_header& header,
-    bool copy_stack_related_data);
+    bool copy_stack_related_data, PerfEventBufferPool* buffer_pool);
 
 [[nodiscard]] PerfEvent ConsumeSchedWakeupWithOrWithoutStackPerfEvent(
     PerfEventRingBuffer* ring_buffer, const perf_event_header& header,
-    bool copy_stack_related_data);
+    bool copy_stack_related_data, PerfEventBufferPool* buffer_pool);
 
 [[nodiscard]] AmdgpuCsIoctlPerfEvent ConsumeAmdgpuCsIoctlPerfEvent(PerfEventRingBuffer* ring_buffer,
                                                                    const perf_event_header& header);
@@ -108,6 +108,11 @@ bool PerfEventRingBuffer::HasNewData() {
   return head > metadata_page_->data_tail;
 }
 
+uint64_t PerfEventRingBuffer::GetUnreadSize() const {
+  ORBIT_DCHECK(IsOpen());
+  return ReadRingBufferHead(metadata_page_) - metadata_page_->data_tail;
+}
+
 void PerfEventRingBuffer::ReadHeader(perf_event_header* header) {
   ReadAtTail(header, sizeof(perf_event_header));
   ORBIT_DCHECK(header->type != 0);
@@ -30,6 +30,9 @@ class PerfEventRingBuffer {
   [[nodiscard]] const std::string& GetName() const { return name_; }
 
   bool HasNewData();
+  // Returns how many bytes have been written to the ring buffer but not read yet.
+  [[nodiscard]] uint64_t GetUnreadSize() const;
+  [[nodiscard]] uint64_t GetSize() const { return ring_buffer_size_; }
   void ReadHeader(perf_event_header* header);
   void SkipRecord(const perf_event_header& header);
 
@@ -0,0 +1,89 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "PerfEventRingBufferPoller.h"
+
+#include <absl/strings/str_format.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/SafeStrerror.h"
+
+namespace orbit_linux_tracing {
+
+ErrorMessageOr<std::unique_ptr<PerfEventRingBufferPoller>> PerfEventRingBufferPoller::Create() {
+  orbit_base::UniqueFd epoll_fd{epoll_create1(EPOLL_CLOEXEC)};
+  if (!epoll_fd.valid()) {
+    return ErrorMessage{absl::StrFormat("epoll_create1: %s", SafeStrerror(errno))};
+  }
+
+  orbit_base::UniqueFd interrupt_fd{eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)};
+  if (!interrupt_fd.valid()) {
+    return ErrorMessage{absl::StrFormat("eventfd: %s", SafeStrerror(errno))};
+  }
+
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = interrupt_fd.get();
+  if (epoll_ctl(epoll_fd.get(), EPOLL_CTL_ADD, interrupt_fd.get(), &event) != 0) {
+    return ErrorMessage{absl::StrFormat("epoll_ctl: %s", SafeStrerror(errno))};
+  }
+
+  return std::unique_ptr<PerfEventRingBufferPoller>{
+      new PerfEventRingBufferPoller{std::move(epoll_fd), std::move(interrupt_fd)}};
+}
+
+ErrorMessageOr<void> PerfEventRingBufferPoller::AddRingBuffer(
+    const PerfEventRingBuffer& ring_buffer) {
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = ring_buffer.GetFileDescriptor();
+  if (epoll_ctl(epoll_fd_.get(), EPOLL_CTL_ADD, ring_buffer.GetFileDescriptor(), &event) != 0) {
+    return ErrorMessage{absl::StrFormat("epoll_ctl on ring buffer '%s': %s", ring_buffer.GetName(),
+                                        SafeStrerror(errno))};
+  }
+  return outcome::success();
+}
+
+bool PerfEventRingBufferPoller::Wait(absl::Duration timeout) {
+  // We don't need to know which ring buffers are ready, as the caller checks all of them anyway.
+  constexpr int kMaxEvents = 16;
+  std::array<epoll_event, kMaxEvents> events{};
+  const int timeout_ms = static_cast<int>(absl::ToInt64Milliseconds(timeout));
+  const int ready_count = epoll_wait(epoll_fd_.get(), events.data(), kMaxEvents, timeout_ms);
+  if (ready_count < 0) {
+    if (errno != EINTR) {
+      ORBIT_ERROR("epoll_wait: %s", SafeStrerror(errno));
+    }
+    return false;
+  }
+
+  bool ring_buffer_ready = false;
+  for (int i = 0; i < ready_count; ++i) {
+    if (events[i].data.fd == interrupt_fd_.get()) {
+      // Reset the eventfd, so that it doesn't keep interrupting.
+      uint64_t unused_value = 0;
+      (void)read(interrupt_fd_.get(), &unused_value, sizeof(unused_value));
+    } else {
+      ring_buffer_ready = true;
+    }
+  }
+  return ring_buffer_ready;
+}
+
+void PerfEventRingBufferPoller::Interrupt() {
+  const uint64_t value = 1;
+  if (write(interrupt_fd_.get(), &value, sizeof(value)) < 0 && errno != EAGAIN) {
+    ORBIT_ERROR("Writing to eventfd: %s", SafeStrerror(errno));
+  }
+}
+
+}  // namespace orbit_linux_tracing
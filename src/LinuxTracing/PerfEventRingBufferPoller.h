@@ -0,0 +1,50 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_PERF_EVENT_RING_BUFFER_POLLER_H_
+#define LINUX_TRACING_PERF_EVENT_RING_BUFFER_POLLER_H_
+
+#include <absl/time/time.h>
+
+#include <memory>
+#include <utility>
+
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+#include "PerfEventRingBuffer.h"
+
+namespace orbit_linux_tracing {
+
+// Allows the thread reading from the perf_event_open ring buffers to sleep until there is something
+// to read, instead of polling the ring buffers at fixed intervals.
+//
+// The kernel wakes up pollers of a ring buffer when the amount of unread data in it crosses its
+// wakeup watermark (perf_event_attr::wakeup_watermark, see kRingBufferWakeupWatermarkBytes), so
+// Wait returns as soon as one of the ring buffers is filled up to that point. Less data than that
+// doesn't cause a wakeup, which is why Wait also takes a timeout. Interrupt allows another thread to
+// wake up the waiting thread, e.g., to stop the capture.
+class PerfEventRingBufferPoller {
+ public:
+  [[nodiscard]] static ErrorMessageOr<std::unique_ptr<PerfEventRingBufferPoller>> Create();
+
+  [[nodiscard]] ErrorMessageOr<void> AddRingBuffer(const PerfEventRingBuffer& ring_buffer);
+
+  // Returns true if at least one ring buffer reached its wakeup watermark, false on timeout or
+  // interruption.
+  bool Wait(absl::Duration timeout);
+
+  // Can be called from any thread.
+  void Interrupt();
+
+ private:
+  PerfEventRingBufferPoller(orbit_base::UniqueFd epoll_fd, orbit_base::UniqueFd interrupt_fd)
+      : epoll_fd_{std::move(epoll_fd)}, interrupt_fd_{std::move(interrupt_fd)} {}
+
+  orbit_base::UniqueFd epoll_fd_;
+  orbit_base::UniqueFd interrupt_fd_;
+};
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_PERF_EVENT_RING_BUFFER_POLLER_H_
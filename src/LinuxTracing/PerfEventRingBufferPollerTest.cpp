@@ -0,0 +1,56 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+
+#include "PerfEventRingBufferPoller.h"
+#include "TestUtils/TestUtils.h"
+
+namespace orbit_linux_tracing {
+
+using orbit_test_utils::HasNoError;
+
+TEST(PerfEventRingBufferPoller, WaitTimesOutWithoutRingBuffers) {
+  auto poller_or_error = PerfEventRingBufferPoller::Create();
+  ASSERT_THAT(poller_or_error, HasNoError());
+  std::unique_ptr<PerfEventRingBufferPoller> poller = std::move(poller_or_error.value());
+
+  const absl::Time start = absl::Now();
+  EXPECT_FALSE(poller->Wait(absl::Milliseconds(10)));
+  EXPECT_GE(absl::Now() - start, absl::Milliseconds(10));
+}
+
+TEST(PerfEventRingBufferPoller, InterruptWakesUpWait) {
+  auto poller_or_error = PerfEventRingBufferPoller::Create();
+  ASSERT_THAT(poller_or_error, HasNoError());
+  std::unique_ptr<PerfEventRingBufferPoller> poller = std::move(poller_or_error.value());
+
+  std::thread interrupting_thread{[&poller] { poller->Interrupt(); }};
+  const absl::Time start = absl::Now();
+  EXPECT_FALSE(poller->Wait(absl::Hours(1)));
+  EXPECT_LT(absl::Now() - start, absl::Minutes(1));
+  interrupting_thread.join();
+
+  // The interruption was consumed, so the next Wait times out again.
+  EXPECT_FALSE(poller->Wait(absl::ZeroDuration()));
+}
+
+TEST(PerfEventRingBufferPoller, InterruptBeforeWaitIsNotLost) {
+  auto poller_or_error = PerfEventRingBufferPoller::Create();
+  ASSERT_THAT(poller_or_error, HasNoError());
+  std::unique_ptr<PerfEventRingBufferPoller> poller = std::move(poller_or_error.value());
+
+  poller->Interrupt();
+  poller->Interrupt();
+  const absl::Time start = absl::Now();
+  EXPECT_FALSE(poller->Wait(absl::Hours(1)));
+  EXPECT_LT(absl::Now() - start, absl::Minutes(1));
+}
+
+}  // namespace orbit_linux_tracing
@@ -0,0 +1,78 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <benchmark/benchmark.h>
+#include <sys/types.h>
+
+#include <cstdint>
+#include <optional>
+
+#include "BenchmarkUtils/AllocationCounter.h"
+#include "GrpcProtos/capture.pb.h"
+#include "ThreadStateManager.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+using orbit_grpc_protos::ThreadStateSlice;
+
+// Cycles each of the threads through the transitions of a thread that repeatedly blocks: it's
+// woken up (runnable), switched in (running), and switched out while going to sleep, producing a
+// ThreadStateSlice for each transition. The number of threads affects the lookups in the map of
+// open states.
+void BM_ThreadStateTransitions(benchmark::State& state) {
+  const auto thread_count = static_cast<pid_t>(state.range(0));
+  constexpr pid_t kPid = 42;
+  constexpr pid_t kWakerTid = 41;
+
+  ThreadStateManager manager;
+  uint64_t timestamp_ns = 1;
+  for (pid_t tid = kPid; tid < kPid + thread_count; ++tid) {
+    manager.OnInitialState(timestamp_ns, tid, ThreadStateSlice::kInterruptibleSleep);
+  }
+
+  orbit_benchmark_utils::AllocationCounter allocation_counter;
+  int64_t transition_count = 0;
+  for (auto _ : state) {
+    for (pid_t tid = kPid; tid < kPid + thread_count; ++tid) {
+      benchmark::DoNotOptimize(manager.OnSchedWakeup(++timestamp_ns, tid, kWakerTid, kPid));
+      benchmark::DoNotOptimize(manager.OnSchedSwitchIn(++timestamp_ns, tid));
+      benchmark::DoNotOptimize(
+          manager.OnSchedSwitchOut(++timestamp_ns, tid, ThreadStateSlice::kInterruptibleSleep));
+    }
+    transition_count += 3 * thread_count;
+  }
+
+  allocation_counter.Report(state, transition_count);
+}
+
+BENCHMARK(BM_ThreadStateTransitions)->Arg(16)->Arg(256)->Arg(4096);
+
+// New threads are created and run once, like in a process that spawns many short-lived threads.
+void BM_NewTasks(benchmark::State& state) {
+  constexpr pid_t kPid = 42;
+
+  ThreadStateManager manager;
+  orbit_benchmark_utils::AllocationCounter allocation_counter;
+  uint64_t timestamp_ns = 1;
+  pid_t next_tid = kPid + 1;
+  int64_t task_count = 0;
+  for (auto _ : state) {
+    const pid_t tid = next_tid++;
+    manager.OnNewTask(++timestamp_ns, tid, kPid, kPid);
+    benchmark::DoNotOptimize(manager.OnSchedSwitchIn(++timestamp_ns, tid));
+    benchmark::DoNotOptimize(
+        manager.OnSchedSwitchOut(++timestamp_ns, tid, ThreadStateSlice::kDead));
+    ++task_count;
+  }
+
+  allocation_counter.Report(state, task_count);
+}
+
+BENCHMARK(BM_NewTasks);
+
+}  // namespace
+
+}  // namespace orbit_linux_tracing
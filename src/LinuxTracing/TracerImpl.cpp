@@ -11,6 +11,7 @@
 #include <absl/strings/str_format.h>
 #include <absl/strings/str_join.h>
 #include <absl/synchronization/mutex.h>
+#include <absl/time/time.h>
 #include <absl/types/span.h>
 #include <string.h>
 #include <unistd.h>
@@ -111,6 +112,21 @@ TracerImpl::TracerImpl(
   }
   stack_dump_size_ = static_cast<uint16_t>(stack_dump_size);
 
+  unwinding_worker_count_ = capture_options.unwinding_worker_count();
+  if (const uint32_t max_unwinding_worker_count = std::thread::hardware_concurrency();
+      max_unwinding_worker_count > 0 && unwinding_worker_count_ > max_unwinding_worker_count) {
+    ORBIT_ERROR("Too many unwinding workers requested: %u; reducing to: %u",
+                unwinding_worker_count_, max_unwinding_worker_count);
+    unwinding_worker_count_ = max_unwinding_worker_count;
+  }
+
+  // Stack samples and callstacks on thread state changes use different stack dump sizes. Size the
+  // pooled buffers for the larger of the two, so that all of them can be recycled.
+  perf_event_buffer_pool_ = std::make_unique<PerfEventBufferPool>(
+      std::max(stack_dump_size_, thread_state_change_callstack_stack_dump_size_));
+  perf_event_buffer_pool_->SetHitAndMissCounters(&stats_.buffer_pool_hit_count,
+                                                 &stats_.buffer_pool_miss_count);
+
   if (capture_options.samples_per_second() == 0) {
     sampling_period_ns_ = std::nullopt;
   } else {
@@ -144,12 +160,26 @@ TracerImpl::TracerImpl(
 }
 
 void TracerImpl::Start() {
+  if (ring_buffer_poller_ == nullptr) {
+    ErrorMessageOr<std::unique_ptr<PerfEventRingBufferPoller>> ring_buffer_poller_or_error =
+        PerfEventRingBufferPoller::Create();
+    if (ring_buffer_poller_or_error.has_value()) {
+      ring_buffer_poller_ = std::move(ring_buffer_poller_or_error.value());
+    } else {
+      ORBIT_ERROR("Creating PerfEventRingBufferPoller, falling back to polling: %s",
+                  ring_buffer_poller_or_error.error().message());
+    }
+  }
+
   stop_run_thread_ = false;
   run_thread_ = std::thread(&TracerImpl::Run, this);
 }
 
 void TracerImpl::Stop() {
   stop_run_thread_ = true;
+  if (ring_buffer_poller_ != nullptr) {
+    ring_buffer_poller_->Interrupt();
+  }
   ORBIT_CHECK(run_thread_.joinable());
   run_thread_.join();
 }
@@ -238,6 +268,15 @@ void TracerImpl::InitUprobesEventVisitor() {
       &absolute_address_to_size_of_functions_to_stop_unwinding_at_);
   uprobes_unwinding_visitor_->SetUnwindErrorsAndDiscardedSamplesCounters(
       &stats_.unwind_error_count, &stats_.samples_in_uretprobes_count);
+  if (unwinding_method_ == CaptureOptions::kDwarf && unwinding_worker_count_ > 0) {
+    // Each worker needs its own LibunwindstackUnwinder, while they all share maps_.
+    unwinding_worker_pool_ = std::make_unique<UnwindingWorkerPool>(unwinding_worker_count_, [this] {
+      return LibunwindstackUnwinder::Create(
+          &absolute_address_to_size_of_functions_to_stop_unwinding_at_);
+    });
+    uprobes_unwinding_visitor_->SetUnwindingWorkerPool(unwinding_worker_pool_.get(),
+                                                      perf_event_buffer_pool_.get());
+  }
   event_processor_.AddVisitor(uprobes_unwinding_visitor_.get());
 }
 
@@ -991,6 +1030,18 @@ void TracerImpl::Run() {
 
   Startup();
 
+  bool use_ring_buffer_poller = ring_buffer_poller_ != nullptr;
+  if (use_ring_buffer_poller) {
+    for (const PerfEventRingBuffer& ring_buffer : ring_buffers_) {
+      if (ErrorMessageOr<void> result = ring_buffer_poller_->AddRingBuffer(ring_buffer);
+          result.has_error()) {
+        ORBIT_ERROR("%s, falling back to polling", result.error().message());
+        use_ring_buffer_poller = false;
+        break;
+      }
+    }
+  }
+
   bool last_iteration_saw_events = false;
   std::thread deferred_events_thread(&TracerImpl::ProcessDeferredEvents, this);
 
@@ -1001,9 +1052,14 @@ void TracerImpl::Run() {
       // Periodically print event statistics.
       PrintStatsIfTimerElapsed();
 
-      // Sleep if there was no new event in the last iteration so that we are
-      // not constantly polling. Don't sleep so long that ring buffers overflow.
-      {
+      // Wait if there was no new event in the last iteration so that we are not constantly
+      // polling. The kernel wakes us up as soon as a ring buffer reaches its wakeup watermark, so
+      // ring buffers don't overflow even if they fill up quickly. Ring buffers that only receive
+      // few events are still read after kMaxWaitTimeOnEmptyRingBuffersMs.
+      if (use_ring_buffer_poller) {
+        ORBIT_SCOPE("Wait");
+        ring_buffer_poller_->Wait(absl::Milliseconds(kMaxWaitTimeOnEmptyRingBuffersMs));
+      } else {
         ORBIT_SCOPE("Sleep");
         usleep(kIdleTimeOnEmptyRingBuffersUs);
       }
@@ -1013,17 +1069,17 @@ void TracerImpl::Run() {
 
     // Read and process events from all ring buffers. In order to ensure that no
     // buffer is read constantly while others overflow, we schedule the reading
-    // using round-robin like scheduling.
+    // using round-robin like scheduling, weighted by how full each buffer is.
     for (PerfEventRingBuffer& ring_buffer : ring_buffers_) {
       if (stop_run_thread_) {
         break;
       }
 
-      // Read up to ROUND_ROBIN_POLLING_BATCH_SIZE (5) new events.
       // TODO: Some event types (e.g., stack samples) have a much longer
       //  processing time but are less frequent than others (e.g., context
       //  switches). Take this into account in our scheduling algorithm.
-      for (int32_t read_from_this_buffer = 0; read_from_this_buffer < kRoundRobinPollingBatchSize;
+      const int32_t batch_size = ComputeRoundRobinPollingBatchSize(ring_buffer);
+      for (int32_t read_from_this_buffer = 0; read_from_this_buffer < batch_size;
            ++read_from_this_buffer) {
         if (stop_run_thread_) {
           break;
@@ -1039,13 +1095,26 @@ void TracerImpl::Run() {
   }
 
   // Finish processing all deferred events.
-  stop_deferred_thread_ = true;
+  {
+    absl::MutexLock lock{&deferred_events_being_buffered_mutex_};
+    stop_deferred_thread_ = true;
+  }
   deferred_events_thread.join();
   event_processor_.ProcessAllEvents();
+  if (unwinding_worker_pool_ != nullptr) {
+    unwinding_worker_pool_->WaitAndDeliverAll();
+  }
 
   Shutdown();
 }
 
+int32_t TracerImpl::ComputeRoundRobinPollingBatchSize(const PerfEventRingBuffer& ring_buffer) {
+  const uint64_t unread_size = std::min(ring_buffer.GetUnreadSize(), ring_buffer.GetSize());
+  return kRoundRobinPollingBatchSize +
+         static_cast<int32_t>((kMaxRoundRobinPollingBatchSize - kRoundRobinPollingBatchSize) *
+                              unread_size / ring_buffer.GetSize());
+}
+
 uint64_t TracerImpl::ProcessForkEventAndReturnTimestamp(const perf_event_header& header,
                                                         PerfEventRingBuffer* ring_buffer) {
   RingBufferForkExit ring_buffer_record;
@@ -1193,7 +1262,8 @@ uint64_t TracerImpl::ProcessSampleEventAndReturnTimestamp(const perf_event_heade
       return timestamp_ns;
     }
 
-    UprobesWithStackPerfEvent event = ConsumeUprobeWithStackPerfEvent(ring_buffer, header);
+    UprobesWithStackPerfEvent event =
+        ConsumeUprobeWithStackPerfEvent(ring_buffer, header, perf_event_buffer_pool_.get());
     DeferEvent(std::move(event));
     ++stats_.uprobes_with_stack_count;
   } else if (is_uprobe_with_args) {
@@ -1292,7 +1362,8 @@ uint64_t TracerImpl::ProcessSampleEventAndReturnTimestamp(const perf_event_heade
     // e.g., with header.misc == PERF_RECORD_MISC_KERNEL,
     // in general they seem to produce valid callstacks.
 
-    StackSamplePerfEvent event = ConsumeStackSamplePerfEvent(ring_buffer, header);
+    StackSamplePerfEvent event =
+        ConsumeStackSamplePerfEvent(ring_buffer, header, perf_event_buffer_pool_.get());
     DeferEvent(std::move(event));
     ++stats_.sample_count;
 
@@ -1304,7 +1375,8 @@ uint64_t TracerImpl::ProcessSampleEventAndReturnTimestamp(const perf_event_heade
       return timestamp_ns;
     }
 
-    PerfEvent event = ConsumeCallchainSamplePerfEvent(ring_buffer, header);
+    PerfEvent event =
+        ConsumeCallchainSamplePerfEvent(ring_buffer, header, perf_event_buffer_pool_.get());
     DeferEvent(std::move(event));
     ++stats_.sample_count;
 
@@ -1384,31 +1456,31 @@ uint64_t TracerImpl::ProcessSampleEventAndReturnTimestamp(const perf_event_heade
     // For simplicity, we accept that we discard the callstack in this case.
     pid_t pid_or_minus_one = ReadSampleRecordPid(ring_buffer);
     bool copy_stack_related_data = pid_or_minus_one == target_pid_;
-    PerfEvent event = ConsumeSchedSwitchWithOrWithoutCallchainPerfEvent(ring_buffer, header,
-                                                                        copy_stack_related_data);
+    PerfEvent event = ConsumeSchedSwitchWithOrWithoutCallchainPerfEvent(
+        ring_buffer, header, copy_stack_related_data, perf_event_buffer_pool_.get());
     DeferEvent(std::move(event));
     ++stats_.sched_switch_count;
 
   } else if (is_sched_wakeup_with_callchain) {
     pid_t pid = ReadSampleRecordPid(ring_buffer);
     bool copy_stack_related_data = pid == target_pid_;
-    PerfEvent event = ConsumeSchedWakeupWithOrWithoutCallchainPerfEvent(ring_buffer, header,
-                                                                        copy_stack_related_data);
+    PerfEvent event = ConsumeSchedWakeupWithOrWithoutCallchainPerfEvent(
+        ring_buffer, header, copy_stack_related_data, perf_event_buffer_pool_.get());
     DeferEvent(std::move(event));
   } else if (is_sched_switch_with_stack) {
     // See comment in "is_sched_switch_with_stack" case above for reasoning about "-1".
     pid_t pid_or_minus_one = ReadSampleRecordPid(ring_buffer);
     bool copy_stack_related_data = pid_or_minus_one == target_pid_;
-    PerfEvent event =
-        ConsumeSchedSwitchWithOrWithoutStackPerfEvent(ring_buffer, header, copy_stack_related_data);
+    PerfEvent event = ConsumeSchedSwitchWithOrWithoutStackPerfEvent(
+        ring_buffer, header, copy_stack_related_data, perf_event_buffer_pool_.get());
     DeferEvent(std::move(event));
     ++stats_.sched_switch_count;
 
   } else if (is_sched_wakeup_with_stack) {
     pid_t pid = ReadSampleRecordPid(ring_buffer);
     bool copy_stack_related_data = pid == target_pid_;
-    PerfEvent event =
-        ConsumeSchedWakeupWithOrWithoutStackPerfEvent(ring_buffer, header, copy_stack_related_data);
+    PerfEvent event = ConsumeSchedWakeupWithOrWithoutStackPerfEvent(
+        ring_buffer, header, copy_stack_related_data, perf_event_buffer_pool_.get());
     DeferEvent(std::move(event));
 
   } else if (is_amdgpu_cs_ioctl_event) {
@@ -1527,14 +1599,37 @@ void TracerImpl::ProcessDeferredEvents() {
     // deferred events. The last iteration will consume all remaining events.
     should_exit = stop_deferred_thread_;
 
+    // Forward the callstacks unwound by the workers since the last iteration, even if there are no
+    // new events.
+    if (unwinding_worker_pool_ != nullptr) {
+      unwinding_worker_pool_->DeliverCompletedInOrder();
+    }
+
     {
       absl::MutexLock lock{&deferred_events_being_buffered_mutex_};
+      if (!should_exit && deferred_events_being_buffered_.empty()) {
+        // Instead of sleeping for a fixed time, wait until DeferEvent adds an event or the thread
+        // is asked to stop. While PerfEventProcessor still holds events, don't wait too long, so
+        // that the events that become old enough are processed and the callstacks unwound in the
+        // meantime are forwarded timely.
+        ORBIT_SCOPE("Wait");
+        const absl::Duration timeout = event_processor_.HasEvents()
+                                           ? absl::Microseconds(kIdleTimeOnEmptyDeferredEventsUs)
+                                           : absl::Milliseconds(kMaxWaitTimeOnNoDeferredEventsMs);
+        deferred_events_being_buffered_mutex_.AwaitWithTimeout(
+            absl::Condition(
+                +[](TracerImpl* self) ABSL_EXCLUSIVE_LOCKS_REQUIRED(
+                     self->deferred_events_being_buffered_mutex_) {
+                  return !self->deferred_events_being_buffered_.empty() ||
+                         self->stop_deferred_thread_;
+                },
+                this),
+            timeout);
+      }
       deferred_events_being_buffered_.swap(deferred_events_to_process_);
     }
 
     if (deferred_events_to_process_.empty()) {
-      ORBIT_SCOPE("Sleep");
-      usleep(kIdleTimeOnEmptyDeferredEventsUs);
       continue;
     }
 
@@ -1608,6 +1703,8 @@ void TracerImpl::Reset() {
     deferred_events_being_buffered_.clear();
   }
   deferred_events_to_process_.clear();
+  // The tasks of the UnwindingWorkerPool reference the UprobesUnwindingVisitor.
+  unwinding_worker_pool_.reset();
   uprobes_unwinding_visitor_.reset();
   leaf_function_call_manager_.reset();
   return_address_manager_.reset();
@@ -1671,6 +1768,16 @@ void TracerImpl::PrintStatsIfTimerElapsed() {
   uint64_t thread_state_count = stats_.thread_state_count;
   ORBIT_LOG("  target's thread states: %.0f/s (%lu)", thread_state_count / actual_window_s,
             thread_state_count);
+
+  uint64_t buffer_pool_hit_count = stats_.buffer_pool_hit_count;
+  uint64_t buffer_pool_miss_count = stats_.buffer_pool_miss_count;
+  uint64_t buffer_pool_request_count = buffer_pool_hit_count + buffer_pool_miss_count;
+  if (buffer_pool_request_count == 0) {
+    ORBIT_LOG("  sample buffer pool hits: 0, misses: 0");
+  } else {
+    ORBIT_LOG("  sample buffer pool hits: %lu, misses: %lu [%.1f%% hits]", buffer_pool_hit_count,
+              buffer_pool_miss_count, 100.0 * buffer_pool_hit_count / buffer_pool_request_count);
+  }
   stats_.Reset();
 }
 
@@ -35,9 +35,12 @@
 #include "LostAndDiscardedEventVisitor.h"
 #include "OrbitBase/Profiling.h"
 #include "PerfEvent.h"
+#include "PerfEventBufferPool.h"
 #include "PerfEventProcessor.h"
 #include "PerfEventRingBuffer.h"
+#include "PerfEventRingBufferPoller.h"
 #include "SwitchesStatesNamesVisitor.h"
+#include "UnwindingWorkerPool.h"
 #include "UprobesFunctionCallManager.h"
 #include "UprobesReturnAddressManager.h"
 #include "UprobesUnwindingVisitor.h"
@@ -123,8 +126,14 @@ class TracerImpl : public Tracer {
   void Reset();
 
   // Number of records to read consecutively from a perf_event_open ring buffer
-  // before switching to another one.
+  // before switching to another one, when the ring buffer is (almost) empty.
   static constexpr int32_t kRoundRobinPollingBatchSize = 5;
+  // Number of records to read consecutively from a full ring buffer. The batch size grows linearly
+  // with how full a ring buffer is, between the two values, so that the ring buffers that are at
+  // risk of overflowing are drained faster than the ones that only receive few events.
+  static constexpr int32_t kMaxRoundRobinPollingBatchSize = 500;
+  [[nodiscard]] static int32_t ComputeRoundRobinPollingBatchSize(
+      const PerfEventRingBuffer& ring_buffer);
 
   // These values are supposed to be large enough to accommodate enough events
   // in case TracerThread::Run's thread is not scheduled for a few tens of
@@ -139,8 +148,17 @@ class TracerImpl : public Tracer {
   static constexpr uint64_t kInstrumentedTracepointsRingBufferSizeKb = 8 * 1024;
   static constexpr uint64_t kUprobesWithStackRingBufferSizeKb = 64 * 1024;
 
+  // Only used if ring_buffer_poller_ couldn't be created.
   static constexpr uint32_t kIdleTimeOnEmptyRingBuffersUs = 5000;
+  // Ring buffers that never reach their wakeup watermark are still read after this time. This is
+  // only a fallback, so that an idle tracer rarely wakes up. The events read late are still in
+  // time for PerfEventProcessor, which only processes events older than kProcessingDelayMs.
+  static constexpr uint32_t kMaxWaitTimeOnEmptyRingBuffersMs = 100;
+  static_assert(kMaxWaitTimeOnEmptyRingBuffersMs < PerfEventProcessor::kProcessingDelayMs);
+  // How long ProcessDeferredEvents waits for new events while PerfEventProcessor still holds events
+  // that become old enough to be processed, and while it holds none, respectively.
   static constexpr uint32_t kIdleTimeOnEmptyDeferredEventsUs = 5000;
+  static constexpr uint32_t kMaxWaitTimeOnNoDeferredEventsMs = 100;
 
   bool trace_context_switches_;
   bool introspection_enabled_;
@@ -151,6 +169,7 @@ class TracerImpl : public Tracer {
   orbit_grpc_protos::CaptureOptions::ThreadStateChangeCallStackCollection
       thread_state_change_callstack_collection_;
   uint16_t thread_state_change_callstack_stack_dump_size_;
+  uint32_t unwinding_worker_count_;
   std::vector<orbit_grpc_protos::InstrumentedFunction> instrumented_functions_;
   std::vector<orbit_grpc_protos::FunctionToRecordAdditionalStackOn>
       functions_to_record_additional_stack_on_;
@@ -165,6 +184,8 @@ class TracerImpl : public Tracer {
 
   std::atomic<bool> stop_run_thread_ = true;
   std::thread run_thread_;
+  // Created in Start, before run_thread_, so that Stop can safely interrupt it.
+  std::unique_ptr<PerfEventRingBufferPoller> ring_buffer_poller_;
 
   absl::flat_hash_map<std::string, std::vector<int>> tracing_fds_by_type_;
   std::vector<PerfEventRingBuffer> ring_buffers_;
@@ -193,6 +214,11 @@ class TracerImpl : public Tracer {
 
   uint64_t effective_capture_start_timestamp_ns_ = 0;
 
+  // Declared before all the members that can hold PerfEvents, as it needs to outlive their buffers.
+  std::unique_ptr<PerfEventBufferPool> perf_event_buffer_pool_;
+
+  // Only set while holding deferred_events_being_buffered_mutex_, so that ProcessDeferredEvents
+  // wakes up right away.
   std::atomic<bool> stop_deferred_thread_ = false;
   std::vector<PerfEvent> deferred_events_being_buffered_
       ABSL_GUARDED_BY(deferred_events_being_buffered_mutex_);
@@ -205,6 +231,8 @@ class TracerImpl : public Tracer {
   std::unique_ptr<LibunwindstackUnwinder> unwinder_;
   std::unique_ptr<LeafFunctionCallManager> leaf_function_call_manager_;
   std::unique_ptr<UprobesUnwindingVisitor> uprobes_unwinding_visitor_;
+  // Declared after uprobes_unwinding_visitor_ as its tasks reference the visitor.
+  std::unique_ptr<UnwindingWorkerPool> unwinding_worker_pool_;
   std::unique_ptr<SwitchesStatesNamesVisitor> switches_states_names_visitor_;
   std::unique_ptr<GpuTracepointVisitor> gpu_event_visitor_;
   std::unique_ptr<LostAndDiscardedEventVisitor> lost_and_discarded_event_visitor_;
@@ -225,6 +253,8 @@ class TracerImpl : public Tracer {
       unwind_error_count = 0;
       samples_in_uretprobes_count = 0;
       thread_state_count = 0;
+      buffer_pool_hit_count = 0;
+      buffer_pool_miss_count = 0;
     }
 
     uint64_t event_count_begin_ns = 0;
@@ -240,6 +270,8 @@ class TracerImpl : public Tracer {
     std::atomic<uint64_t> unwind_error_count = 0;
     std::atomic<uint64_t> samples_in_uretprobes_count = 0;
     std::atomic<uint64_t> thread_state_count = 0;
+    std::atomic<uint64_t> buffer_pool_hit_count = 0;
+    std::atomic<uint64_t> buffer_pool_miss_count = 0;
   };
 
   static constexpr uint64_t kEventStatsWindowS = 5;
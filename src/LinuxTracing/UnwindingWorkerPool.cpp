@@ -0,0 +1,139 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "UnwindingWorkerPool.h"
+
+#include <utility>
+
+#include "Introspection/Introspection.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/ThreadUtils.h"
+
+namespace orbit_linux_tracing {
+
+UnwindingWorkerPool::UnwindingWorkerPool(
+    size_t worker_count,
+    const std::function<std::unique_ptr<LibunwindstackUnwinder>()>& unwinder_factory) {
+  ORBIT_CHECK(worker_count > 0);
+  unwinders_.reserve(worker_count);
+  workers_.reserve(worker_count);
+  for (size_t i = 0; i < worker_count; ++i) {
+    LibunwindstackUnwinder* unwinder = unwinders_.emplace_back(unwinder_factory()).get();
+    workers_.emplace_back(&UnwindingWorkerPool::WorkerFunction, this, unwinder);
+  }
+}
+
+UnwindingWorkerPool::~UnwindingWorkerPool() {
+  {
+    absl::MutexLock lock{&mutex_};
+    shutdown_requested_ = true;
+  }
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+  // Deliveries of tasks that were never delivered are simply dropped.
+}
+
+void UnwindingWorkerPool::SubmitTask(Task task) {
+  const size_t max_undelivered_tasks = kMaxUndeliveredTasksPerWorker * workers_.size();
+  while (true) {
+    DeliverCompletedInOrder();
+    {
+      absl::MutexLock lock{&mutex_};
+      if (slots_.size() < max_undelivered_tasks) {
+        const uint64_t sequence_number = next_slot_to_deliver_index_ + slots_.size();
+        slots_.emplace_back();
+        pending_tasks_.emplace_back(sequence_number, std::move(task));
+        return;
+      }
+    }
+    BlockUntilFrontSlotCompleted();
+  }
+}
+
+void UnwindingWorkerPool::SubmitCompleted(Delivery delivery) {
+  {
+    absl::MutexLock lock{&mutex_};
+    if (!slots_.empty()) {
+      slots_.emplace_back().delivery.emplace(std::move(delivery));
+      return;
+    }
+  }
+  // No previously submitted task is waiting to be delivered, so this can be delivered right away.
+  delivery();
+}
+
+void UnwindingWorkerPool::DeliverCompletedInOrder() {
+  std::vector<Delivery> deliveries;
+  {
+    absl::MutexLock lock{&mutex_};
+    while (!slots_.empty() && slots_.front().delivery.has_value()) {
+      deliveries.emplace_back(std::move(slots_.front().delivery.value()));
+      slots_.pop_front();
+      ++next_slot_to_deliver_index_;
+    }
+  }
+
+  // Call the deliveries outside of the lock, so that the workers can keep completing tasks.
+  for (Delivery& delivery : deliveries) {
+    delivery();
+  }
+}
+
+void UnwindingWorkerPool::WaitAndDeliverAll() {
+  ORBIT_SCOPE_FUNCTION;
+  while (true) {
+    DeliverCompletedInOrder();
+    {
+      absl::MutexLock lock{&mutex_};
+      if (slots_.empty()) {
+        return;
+      }
+    }
+    BlockUntilFrontSlotCompleted();
+  }
+}
+
+void UnwindingWorkerPool::BlockUntilFrontSlotCompleted() {
+  ORBIT_SCOPE_FUNCTION;
+  absl::MutexLock lock{&mutex_};
+  mutex_.Await(absl::Condition(
+      +[](std::deque<Slot>* slots) {
+        return slots->empty() || slots->front().delivery.has_value();
+      },
+      &slots_));
+}
+
+void UnwindingWorkerPool::WorkerFunction(LibunwindstackUnwinder* unwinder) {
+  orbit_base::SetCurrentThreadName("Tracer::Unwind");
+  while (true) {
+    uint64_t sequence_number = 0;
+    std::optional<Task> task;
+    {
+      absl::MutexLock lock{&mutex_};
+      mutex_.Await(absl::Condition(
+          +[](UnwindingWorkerPool* self) ABSL_EXCLUSIVE_LOCKS_REQUIRED(self->mutex_) {
+            return self->shutdown_requested_ || !self->pending_tasks_.empty();
+          },
+          this));
+      if (shutdown_requested_) {
+        return;
+      }
+      sequence_number = pending_tasks_.front().first;
+      task.emplace(std::move(pending_tasks_.front().second));
+      pending_tasks_.pop_front();
+    }
+
+    Delivery delivery = (*task)(unwinder);
+    // Destroy the task, and with it the data it owns, before its delivery becomes visible, so that
+    // such data has been released once WaitAndDeliverAll returns.
+    task.reset();
+
+    absl::MutexLock lock{&mutex_};
+    ORBIT_CHECK(sequence_number >= next_slot_to_deliver_index_);
+    slots_[sequence_number - next_slot_to_deliver_index_].delivery.emplace(std::move(delivery));
+  }
+}
+
+}  // namespace orbit_linux_tracing
@@ -0,0 +1,98 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LINUX_TRACING_UNWINDING_WORKER_POOL_H_
+#define LINUX_TRACING_UNWINDING_WORKER_POOL_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "LibunwindstackUnwinder.h"
+#include "OrbitBase/AnyInvocable.h"
+
+namespace orbit_linux_tracing {
+
+// UnwindingWorkerPool runs DWARF unwinding tasks on a fixed number of worker threads, while
+// handing the results back in the order in which the tasks were submitted.
+//
+// Each worker owns its own LibunwindstackUnwinder, as the unwinder caches DWARF information and is
+// not thread-safe. The unwindstack::Maps the tasks unwind against are instead shared between all
+// workers: the caller is responsible for calling WaitAndDeliverAll before modifying them, so that
+// the workers only ever see a read-only snapshot.
+//
+// A task runs on a worker and returns a "delivery", which is then called on the thread that calls
+// DeliverCompletedInOrder or WaitAndDeliverAll, strictly in submission order. As
+// UprobesUnwindingVisitor submits tasks while visiting events in timestamp order, this re-merges
+// the unwound callstacks in timestamp order before they reach the TracerListener.
+// SubmitCompleted allows passing a delivery that requires no work on a worker, so that it is still
+// ordered with respect to the tasks.
+//
+// Submission and delivery are expected to happen on the same thread.
+class UnwindingWorkerPool {
+ public:
+  using Delivery = orbit_base::AnyInvocable<void()>;
+  using Task = orbit_base::AnyInvocable<Delivery(LibunwindstackUnwinder*)>;
+
+  explicit UnwindingWorkerPool(
+      size_t worker_count,
+      const std::function<std::unique_ptr<LibunwindstackUnwinder>()>& unwinder_factory);
+  ~UnwindingWorkerPool();
+
+  UnwindingWorkerPool(const UnwindingWorkerPool&) = delete;
+  UnwindingWorkerPool& operator=(const UnwindingWorkerPool&) = delete;
+  UnwindingWorkerPool(UnwindingWorkerPool&&) = delete;
+  UnwindingWorkerPool& operator=(UnwindingWorkerPool&&) = delete;
+
+  // Schedules `task` on one of the workers. If too many tasks are in flight, this first blocks
+  // (delivering completed tasks in the meantime) until some of them have been delivered, so that
+  // memory usage stays bounded when the workers can't keep up.
+  void SubmitTask(Task task);
+  // Calls `delivery` right away if no previously submitted task is still waiting to be delivered,
+  // otherwise enqueues it to be called after all of them.
+  void SubmitCompleted(Delivery delivery);
+
+  // Calls the deliveries of all tasks that have completed and that were not preceded by a task
+  // that is still running. Doesn't block.
+  void DeliverCompletedInOrder();
+  // Waits for all submitted tasks to complete and calls all the remaining deliveries.
+  void WaitAndDeliverAll();
+
+  [[nodiscard]] size_t GetWorkerCount() const { return workers_.size(); }
+
+  // Maximum number of submitted tasks whose delivery has not happened yet, per worker.
+  static constexpr size_t kMaxUndeliveredTasksPerWorker = 256;
+
+ private:
+  void WorkerFunction(LibunwindstackUnwinder* unwinder);
+  void BlockUntilFrontSlotCompleted();
+
+  struct Slot {
+    std::optional<Delivery> delivery;
+  };
+
+  absl::Mutex mutex_;
+  // Slots for all submitted tasks that have not been delivered yet, in submission order.
+  // `next_slot_to_deliver_index_` is the sequence number of the task in the front slot.
+  std::deque<Slot> slots_ ABSL_GUARDED_BY(mutex_);
+  uint64_t next_slot_to_deliver_index_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Tasks waiting for a worker, each with the sequence number of its slot.
+  std::deque<std::pair<uint64_t, Task>> pending_tasks_ ABSL_GUARDED_BY(mutex_);
+  bool shutdown_requested_ ABSL_GUARDED_BY(mutex_) = false;
+
+  std::vector<std::unique_ptr<LibunwindstackUnwinder>> unwinders_;
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace orbit_linux_tracing
+
+#endif  // LINUX_TRACING_UNWINDING_WORKER_POOL_H_
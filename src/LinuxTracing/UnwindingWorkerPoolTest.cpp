@@ -0,0 +1,112 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/container/flat_hash_set.h>
+#include <absl/synchronization/mutex.h>
+#include <absl/synchronization/notification.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "LibunwindstackUnwinder.h"
+#include "UnwindingWorkerPool.h"
+#include "UprobesUnwindingVisitorTestCommon.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+std::unique_ptr<LibunwindstackUnwinder> CreateMockUnwinder() {
+  return std::make_unique<MockLibunwindstackUnwinder>();
+}
+
+}  // namespace
+
+TEST(UnwindingWorkerPool, DeliversInSubmissionOrderEvenIfTasksCompleteOutOfOrder) {
+  UnwindingWorkerPool pool{2, &CreateMockUnwinder};
+  std::vector<int> delivered;
+
+  absl::Notification second_task_completed;
+  pool.SubmitTask(UnwindingWorkerPool::Task{
+      [&second_task_completed, &delivered](LibunwindstackUnwinder* /*unwinder*/) {
+        second_task_completed.WaitForNotification();
+        return UnwindingWorkerPool::Delivery{[&delivered] { delivered.push_back(1); }};
+      }});
+  pool.SubmitTask(UnwindingWorkerPool::Task{
+      [&second_task_completed, &delivered](LibunwindstackUnwinder* /*unwinder*/) {
+        second_task_completed.Notify();
+        return UnwindingWorkerPool::Delivery{[&delivered] { delivered.push_back(2); }};
+      }});
+  pool.SubmitCompleted(UnwindingWorkerPool::Delivery{[&delivered] { delivered.push_back(3); }});
+
+  pool.WaitAndDeliverAll();
+  EXPECT_THAT(delivered, ::testing::ElementsAre(1, 2, 3));
+}
+
+TEST(UnwindingWorkerPool, DeliverCompletedInOrderStopsAtTaskStillRunning) {
+  UnwindingWorkerPool pool{1, &CreateMockUnwinder};
+  std::vector<int> delivered;
+
+  pool.SubmitCompleted(UnwindingWorkerPool::Delivery{[&delivered] { delivered.push_back(1); }});
+  // Nothing was pending, so the delivery happened right away.
+  EXPECT_THAT(delivered, ::testing::ElementsAre(1));
+
+  absl::Notification task_can_complete;
+  pool.SubmitTask(
+      UnwindingWorkerPool::Task{[&task_can_complete, &delivered](LibunwindstackUnwinder*) {
+        task_can_complete.WaitForNotification();
+        return UnwindingWorkerPool::Delivery{[&delivered] { delivered.push_back(2); }};
+      }});
+  pool.SubmitCompleted(UnwindingWorkerPool::Delivery{[&delivered] { delivered.push_back(3); }});
+
+  pool.DeliverCompletedInOrder();
+  EXPECT_THAT(delivered, ::testing::ElementsAre(1));
+
+  task_can_complete.Notify();
+  pool.WaitAndDeliverAll();
+  EXPECT_THAT(delivered, ::testing::ElementsAre(1, 2, 3));
+}
+
+TEST(UnwindingWorkerPool, EachWorkerUsesItsOwnUnwinder) {
+  constexpr size_t kWorkerCount = 4;
+  UnwindingWorkerPool pool{kWorkerCount, &CreateMockUnwinder};
+  EXPECT_EQ(pool.GetWorkerCount(), kWorkerCount);
+
+  // Keep all workers busy at the same time, so that each of them takes exactly one task.
+  absl::Mutex mutex;
+  size_t running_task_count = 0;
+  absl::flat_hash_set<LibunwindstackUnwinder*> unwinders;
+  for (size_t i = 0; i < kWorkerCount; ++i) {
+    pool.SubmitTask(UnwindingWorkerPool::Task{[&](LibunwindstackUnwinder* unwinder) {
+      absl::MutexLock lock{&mutex};
+      unwinders.insert(unwinder);
+      ++running_task_count;
+      mutex.Await(absl::Condition(
+          +[](size_t* count) { return *count == kWorkerCount; }, &running_task_count));
+      return UnwindingWorkerPool::Delivery{[] {}};
+    }});
+  }
+  pool.WaitAndDeliverAll();
+
+  EXPECT_EQ(unwinders.size(), kWorkerCount);
+  EXPECT_FALSE(unwinders.contains(nullptr));
+}
+
+TEST(UnwindingWorkerPool, SubmitTaskDoesNotBlockForeverWhenManyTasksAreUndelivered) {
+  UnwindingWorkerPool pool{1, &CreateMockUnwinder};
+  constexpr size_t kTaskCount = 4 * UnwindingWorkerPool::kMaxUndeliveredTasksPerWorker;
+  size_t delivered_count = 0;
+  for (size_t i = 0; i < kTaskCount; ++i) {
+    pool.SubmitTask(UnwindingWorkerPool::Task{[&delivered_count](LibunwindstackUnwinder*) {
+      return UnwindingWorkerPool::Delivery{[&delivered_count] { ++delivered_count; }};
+    }});
+  }
+  pool.WaitAndDeliverAll();
+  EXPECT_EQ(delivered_count, kTaskCount);
+}
+
+}  // namespace orbit_linux_tracing
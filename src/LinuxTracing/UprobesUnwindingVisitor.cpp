@@ -14,6 +14,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <limits>
 #include <memory>
 #include <optional>
@@ -271,6 +272,84 @@ bool UprobesUnwindingVisitor::UnwindStack(const StackPerfEventDataT& event_data,
   return true;
 }
 
+template <typename StackPerfEventDataT, typename CallstackHolderT>
+void UprobesUnwindingVisitor::UnwindStackOnWorkerPool(const StackPerfEventDataT& event_data,
+                                                      CallstackHolderT callstack_holder,
+                                                      bool offline_memory_only) {
+  ORBIT_CHECK(unwinding_worker_pool_ != nullptr);
+  ORBIT_CHECK(current_maps_ != nullptr);
+
+  // Patching depends on the state of UprobesReturnAddressManager at the time of the sample, so it
+  // still needs to happen here, in order.
+  return_address_manager_->PatchSample(event_data.GetCallstackTid(), event_data.GetRegisters().sp,
+                                       event_data.GetMutableStackData(), event_data.GetStackSize());
+
+  // The task outlives the event, so it gets its own copy of the (already patched) stack data. The
+  // additional stack slices are copied too, as the next UprobesWithStackPerfEvent on the same
+  // stream replaces them, possibly before the task runs. The copies come from the
+  // PerfEventBufferPool and are given back to it when the task is destroyed after running.
+  std::vector<StackSlice> stack_slices;
+  PerfEventBuffer<uint8_t> stack_data_copy =
+      perf_event_buffer_pool_->AllocateStackData(event_data.GetStackSize());
+  std::memcpy(stack_data_copy.get(), event_data.GetStackData(), event_data.GetStackSize());
+  stack_slices.push_back(StackSlice{.start_address = event_data.GetRegisters().sp,
+                                    .size = event_data.GetStackSize(),
+                                    .data = std::move(stack_data_copy)});
+  const auto& stream_id_to_user_stack =
+      thread_id_stream_id_to_stack_slices_.find(event_data.GetCallstackTid());
+  if (stream_id_to_user_stack != thread_id_stream_id_to_stack_slices_.end()) {
+    for (const auto& [unused_stream_id, user_stack_slice] : stream_id_to_user_stack->second) {
+      PerfEventBuffer<uint8_t> data_copy =
+          perf_event_buffer_pool_->AllocateStackData(user_stack_slice.size);
+      std::memcpy(data_copy.get(), user_stack_slice.data.get(), user_stack_slice.size);
+      stack_slices.push_back(StackSlice{.start_address = user_stack_slice.start_address,
+                                        .size = user_stack_slice.size,
+                                        .data = std::move(data_copy)});
+    }
+  }
+
+  // The maps are only read by the workers. Visit(uint64_t, const MmapPerfEventData&) waits for all
+  // tasks to complete before modifying them.
+  unwinding_worker_pool_->SubmitTask(UnwindingWorkerPool::Task{
+      [this, pid = event_data.GetCallstackPidOrMinusOne(), maps = current_maps_->Get(),
+       registers = event_data.GetRegistersAsArray(), stack_slices = std::move(stack_slices),
+       callstack_holder = std::move(callstack_holder),
+       offline_memory_only](LibunwindstackUnwinder* unwinder) mutable {
+        std::vector<StackSliceView> stack_slice_views;
+        stack_slice_views.reserve(stack_slices.size());
+        for (const StackSlice& stack_slice : stack_slices) {
+          stack_slice_views.emplace_back(stack_slice.start_address, stack_slice.size,
+                                         stack_slice.data.get());
+        }
+
+        LibunwindstackResult libunwindstack_result =
+            unwinder->Unwind(pid, maps, registers, stack_slice_views, offline_memory_only);
+        if (libunwindstack_result.frames().empty()) {
+          ORBIT_ERROR("Unwound callstack has no frames");
+          return UnwindingWorkerPool::Delivery{[] {}};
+        }
+
+        // ComputeCallstackTypeFromStackSample only reads immutable state and increments atomic
+        // counters, so it is safe to call from the workers.
+        orbit_grpc_protos::Callstack* callstack = callstack_holder.mutable_callstack();
+        callstack->set_type(ComputeCallstackTypeFromStackSample(libunwindstack_result));
+        for (const unwindstack::FrameData& libunwindstack_frame : libunwindstack_result.frames()) {
+          callstack->add_pcs(libunwindstack_frame.pc);
+        }
+
+        // Sending to the listener, as well as known_linux_address_infos_, stay on the thread that
+        // delivers.
+        return UnwindingWorkerPool::Delivery{
+            [this, frames = libunwindstack_result.frames(),
+             callstack_holder = std::move(callstack_holder)]() mutable {
+              for (const unwindstack::FrameData& libunwindstack_frame : frames) {
+                SendFullAddressInfoToListener(libunwindstack_frame);
+              }
+              SendCallstackHolderToListener(std::move(callstack_holder));
+            }};
+      }});
+}
+
 void UprobesUnwindingVisitor::Visit(uint64_t event_timestamp,
                                     const StackSamplePerfEventData& event_data) {
   FullCallstackSample sample;
@@ -278,6 +357,11 @@ void UprobesUnwindingVisitor::Visit(uint64_t event_timestamp,
   sample.set_tid(event_data.tid);
   sample.set_timestamp_ns(event_timestamp);
 
+  if (unwinding_worker_pool_ != nullptr) {
+    UnwindStackOnWorkerPool(event_data, std::move(sample), /*offline_memory_only=*/false);
+    return;
+  }
+
   const bool success = UnwindStack(event_data, sample.mutable_callstack());
 
   if (!success) {
@@ -293,6 +377,12 @@ void UprobesUnwindingVisitor::Visit(uint64_t event_timestamp,
   thread_state_slice_callstack.set_thread_state_slice_tid(event_data.woken_tid);
   thread_state_slice_callstack.set_timestamp_ns(event_timestamp);
 
+  if (unwinding_worker_pool_ != nullptr) {
+    UnwindStackOnWorkerPool(event_data, std::move(thread_state_slice_callstack),
+                            /*offline_memory_only=*/true);
+    return;
+  }
+
   const bool success = UnwindStack(event_data, thread_state_slice_callstack.mutable_callstack(),
                                    /*offline_memory_only=*/true);
 
@@ -309,6 +399,12 @@ void UprobesUnwindingVisitor::Visit(uint64_t event_timestamp,
   thread_state_slice_callstack.set_thread_state_slice_tid(event_data.prev_tid);
   thread_state_slice_callstack.set_timestamp_ns(event_timestamp);
 
+  if (unwinding_worker_pool_ != nullptr) {
+    UnwindStackOnWorkerPool(event_data, std::move(thread_state_slice_callstack),
+                            /*offline_memory_only=*/true);
+    return;
+  }
+
   const bool success = UnwindStack(event_data, thread_state_slice_callstack.mutable_callstack(),
                                    /*offline_memory_only=*/true);
 
@@ -460,7 +556,9 @@ void UprobesUnwindingVisitor::Visit(uint64_t event_timestamp,
   }
 
   ORBIT_CHECK(!callstack->pcs().empty());
-  listener_->OnCallstackSample(std::move(sample));
+  SendInOrder([this, sample = std::move(sample)]() mutable {
+    listener_->OnCallstackSample(std::move(sample));
+  });
 }
 
 void UprobesUnwindingVisitor::Visit(uint64_t event_timestamp,
@@ -476,7 +574,10 @@ void UprobesUnwindingVisitor::Visit(uint64_t event_timestamp,
     return;
   }
 
-  listener_->OnThreadStateSliceCallstack(std::move(thread_state_slice_callstack));
+  SendInOrder([this, thread_state_slice_callstack =
+                         std::move(thread_state_slice_callstack)]() mutable {
+    listener_->OnThreadStateSliceCallstack(std::move(thread_state_slice_callstack));
+  });
 }
 
 void UprobesUnwindingVisitor::Visit(uint64_t event_timestamp,
@@ -492,7 +593,10 @@ void UprobesUnwindingVisitor::Visit(uint64_t event_timestamp,
     return;
   }
 
-  listener_->OnThreadStateSliceCallstack(std::move(thread_state_slice_callstack));
+  SendInOrder([this, thread_state_slice_callstack =
+                         std::move(thread_state_slice_callstack)]() mutable {
+    listener_->OnThreadStateSliceCallstack(std::move(thread_state_slice_callstack));
+  });
 }
 
 void UprobesUnwindingVisitor::OnUprobes(
@@ -561,7 +665,9 @@ void UprobesUnwindingVisitor::OnUretprobes(uint64_t timestamp_ns, pid_t pid, pid
   std::optional<FunctionCall> function_call =
       function_call_manager_->ProcessFunctionExit(pid, tid, timestamp_ns, ax);
   if (function_call.has_value()) {
-    listener_->OnFunctionCall(std::move(function_call.value()));
+    SendInOrder([this, function_call = std::move(function_call.value())]() mutable {
+      listener_->OnFunctionCall(std::move(function_call));
+    });
   }
 
   return_address_manager_->ProcessFunctionExit(tid);
@@ -591,7 +697,9 @@ void UprobesUnwindingVisitor::Visit(uint64_t event_timestamp,
   std::optional<FunctionCall> function_call = function_call_manager_->ProcessFunctionExit(
       event_data.pid, event_data.tid, event_timestamp, std::nullopt);
   if (function_call.has_value()) {
-    listener_->OnFunctionCall(std::move(function_call.value()));
+    SendInOrder([this, function_call = std::move(function_call.value())]() mutable {
+      listener_->OnFunctionCall(std::move(function_call));
+    });
   }
 
   return_address_manager_->ProcessFunctionExit(event_data.tid);
@@ -721,6 +829,12 @@ void UprobesUnwindingVisitor::Visit(uint64_t event_timestamp, const MmapPerfEven
   ORBIT_CHECK(listener_ != nullptr);
   ORBIT_CHECK(current_maps_ != nullptr);
 
+  // The workers of the UnwindingWorkerPool read current_maps_ without synchronization, so let them
+  // finish before modifying it.
+  if (unwinding_worker_pool_ != nullptr) {
+    unwinding_worker_pool_->WaitAndDeliverAll();
+  }
+
   // PERF_RECORD_MMAP events do not contain the flags, but only distinguish between executable and
   // non-executable. This is all we need, so simply assume PROT_READ | PROT_EXEC for executable
   // mappings and PROT_READ for non-executable mappings. If we wanted the exact flags, we could
@@ -807,7 +921,9 @@ void UprobesUnwindingVisitor::Visit(uint64_t event_timestamp, const MmapPerfEven
   module_update_event.set_pid(event_data.pid);
   module_update_event.set_timestamp_ns(event_timestamp);
   *module_update_event.mutable_module() = std::move(module_info_or_error.value());
-  listener_->OnModuleUpdate(std::move(module_update_event));
+  SendInOrder([this, module_update_event = std::move(module_update_event)]() mutable {
+    listener_->OnModuleUpdate(std::move(module_update_event));
+  });
 }
 
 }  // namespace orbit_linux_tracing
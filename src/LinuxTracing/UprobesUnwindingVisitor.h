@@ -27,9 +27,11 @@
 #include "LinuxTracing/UserSpaceInstrumentationAddresses.h"
 #include "OrbitBase/Logging.h"
 #include "PerfEvent.h"
+#include "PerfEventBufferPool.h"
 #include "PerfEventRecords.h"
 #include "PerfEventVisitor.h"
 #include "UprobesFunctionCallManager.h"
+#include "UnwindingWorkerPool.h"
 #include "UprobesReturnAddressManager.h"
 #include "unwindstack/Unwinder.h"
 
@@ -85,6 +87,21 @@ class UprobesUnwindingVisitor : public PerfEventVisitor {
     samples_in_uretprobes_counter_ = samples_in_uretprobes_counter;
   }
 
+  // When an UnwindingWorkerPool is set, DWARF unwinding of stack samples (and of stacks collected
+  // on thread state changes) happens on the workers of the pool rather than in Visit. To preserve
+  // the order of what is sent to the listener, all other events sent to the listener are then also
+  // sent through the pool. The caller needs to call UnwindingWorkerPool::DeliverCompletedInOrder
+  // regularly, and UnwindingWorkerPool::WaitAndDeliverAll once all events have been visited.
+  // The copies of the stack data that the tasks of the pool own are taken from
+  // `perf_event_buffer_pool`, which needs to outlive `unwinding_worker_pool`.
+  void SetUnwindingWorkerPool(UnwindingWorkerPool* unwinding_worker_pool,
+                              PerfEventBufferPool* perf_event_buffer_pool) {
+    ORBIT_CHECK(unwinding_worker_pool != nullptr);
+    ORBIT_CHECK(perf_event_buffer_pool != nullptr);
+    unwinding_worker_pool_ = unwinding_worker_pool;
+    perf_event_buffer_pool_ = perf_event_buffer_pool;
+  }
+
   void Visit(uint64_t event_timestamp, const StackSamplePerfEventData& event_data) override;
   void Visit(uint64_t event_timestamp,
              const SchedWakeupWithCallchainPerfEventData& event_data) override;
@@ -113,7 +130,7 @@ class UprobesUnwindingVisitor : public PerfEventVisitor {
   struct StackSlice {
     uint64_t start_address;
     uint64_t size;
-    std::unique_ptr<uint8_t[]> data;
+    PerfEventBuffer<uint8_t> data;
   };
 
   void OnUprobes(uint64_t timestamp_ns, pid_t tid, uint32_t cpu, uint64_t sp, uint64_t ip,
@@ -136,6 +153,33 @@ class UprobesUnwindingVisitor : public PerfEventVisitor {
                                  orbit_grpc_protos::Callstack* resulting_callstack,
                                  bool offline_memory_only = false);
 
+  // Sends `callstack_holder` to the listener after unwinding the stack on one of the workers of
+  // unwinding_worker_pool_. CallstackHolderT is either FullCallstackSample or
+  // ThreadStateSliceCallstack.
+  template <typename StackPerfEventDataT, typename CallstackHolderT>
+  void UnwindStackOnWorkerPool(const StackPerfEventDataT& event_data,
+                               CallstackHolderT callstack_holder, bool offline_memory_only);
+
+  void SendCallstackHolderToListener(orbit_grpc_protos::FullCallstackSample sample) {
+    listener_->OnCallstackSample(std::move(sample));
+  }
+  void SendCallstackHolderToListener(
+      orbit_grpc_protos::ThreadStateSliceCallstack thread_state_slice_callstack) {
+    listener_->OnThreadStateSliceCallstack(std::move(thread_state_slice_callstack));
+  }
+
+  // Calls `send` right away or, if an UnwindingWorkerPool is set, after all the previously
+  // submitted unwinding tasks have been delivered.
+  template <typename SendT>
+  void SendInOrder(SendT&& send) {
+    if (unwinding_worker_pool_ == nullptr) {
+      send();
+      return;
+    }
+    unwinding_worker_pool_->SubmitCompleted(
+        UnwindingWorkerPool::Delivery{std::forward<SendT>(send)});
+  }
+
   template <typename CallchainPerfEventDataT>
   [[nodiscard]] bool VisitCallchainEvent(const CallchainPerfEventDataT& event_data,
                                          orbit_grpc_protos::Callstack* resulting_callstack);
@@ -152,6 +196,9 @@ class UprobesUnwindingVisitor : public PerfEventVisitor {
 
   const std::map<uint64_t, uint64_t>* absolute_address_to_size_of_functions_to_stop_at_;
 
+  UnwindingWorkerPool* unwinding_worker_pool_ = nullptr;
+  PerfEventBufferPool* perf_event_buffer_pool_ = nullptr;
+
   std::atomic<uint64_t>* unwind_error_counter_ = nullptr;
   std::atomic<uint64_t>* samples_in_uretprobes_counter_ = nullptr;
 
@@ -0,0 +1,230 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/types/span.h>
+#include <asm/perf_regs.h>
+#include <benchmark/benchmark.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unwindstack/Error.h>
+#include <unwindstack/MapInfo.h>
+#include <unwindstack/Maps.h>
+#include <unwindstack/Regs.h>
+#include <unwindstack/RegsX86_64.h>
+#include <unwindstack/Unwinder.h>
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "BenchmarkUtils/AllocationCounter.h"
+#include "LeafFunctionCallManager.h"
+#include "LibunwindstackMaps.h"
+#include "LibunwindstackUnwinder.h"
+#include "NoOpTracerListener.h"
+#include "OrbitBase/MakeUniqueForOverwrite.h"
+#include "PerfEvent.h"
+#include "PerfEventBufferPool.h"
+#include "PerfEventRecords.h"
+#include "UnwindingWorkerPool.h"
+#include "UprobesFunctionCallManager.h"
+#include "UprobesReturnAddressManager.h"
+#include "UprobesUnwindingVisitor.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+constexpr pid_t kPid = 42;
+constexpr uint64_t kModuleStart = 0x100000;
+constexpr uint64_t kModuleEnd = 0x200000;
+constexpr size_t kFramesPerCallstack = 16;
+// The number of distinct callstacks determines how many FullAddressInfos are sent.
+constexpr uint64_t kDistinctCallstackCount = 64;
+
+class FakeLibunwindstackMaps : public LibunwindstackMaps {
+ public:
+  std::shared_ptr<unwindstack::MapInfo> Find(uint64_t /*pc*/) override { return map_info_; }
+  unwindstack::Maps* Get() override { return nullptr; }
+  void AddAndSort(uint64_t /*start*/, uint64_t /*end*/, uint64_t /*offset*/, uint64_t /*flags*/,
+                  std::string_view /*name*/) override {}
+
+ private:
+  std::shared_ptr<unwindstack::MapInfo> map_info_ = unwindstack::MapInfo::Create(
+      kModuleStart, kModuleEnd, 0, PROT_EXEC | PROT_READ, "/path/to/module.so");
+};
+
+// Doesn't actually unwind, so that the benchmark measures what surrounds the unwinding: copying
+// and patching the stack, building the Callstack, deduplicating addresses, and, when an
+// UnwindingWorkerPool is used, the hand-off to the workers and back. It returns one of
+// kDistinctCallstackCount callstacks, depending on the stack pointer of the sample.
+class FakeLibunwindstackUnwinder : public LibunwindstackUnwinder {
+ public:
+  explicit FakeLibunwindstackUnwinder(std::shared_ptr<unwindstack::MapInfo> map_info)
+      : map_info_{std::move(map_info)} {}
+
+  LibunwindstackResult Unwind(pid_t /*pid*/, unwindstack::Maps* /*maps*/,
+                              const std::array<uint64_t, PERF_REG_X86_64_MAX>& perf_regs,
+                              absl::Span<const StackSliceView> stack_slices,
+                              bool /*offline_memory_only*/, size_t /*max_frames*/) override {
+    benchmark::DoNotOptimize(stack_slices.front().data());
+    const uint64_t callstack_index = perf_regs[PERF_REG_X86_SP] % kDistinctCallstackCount;
+    std::vector<unwindstack::FrameData> frames;
+    frames.reserve(kFramesPerCallstack);
+    for (size_t i = 0; i < kFramesPerCallstack; ++i) {
+      const uint64_t pc = kModuleStart + callstack_index * kFramesPerCallstack * 0x10 + i * 0x10;
+      frames.push_back(unwindstack::FrameData{
+          .pc = pc,
+          .function_name = "function",
+          .function_offset = pc - kModuleStart,
+          .map_info = map_info_,
+      });
+    }
+    return LibunwindstackResult{std::move(frames), unwindstack::RegsX86_64{},
+                                unwindstack::ErrorCode::ERROR_NONE};
+  }
+
+  std::optional<bool> HasFramePointerSet(uint64_t /*instruction_pointer*/, pid_t /*pid*/,
+                                         unwindstack::Maps* /*maps*/) override {
+    return std::nullopt;
+  }
+
+ private:
+  std::shared_ptr<unwindstack::MapInfo> map_info_;
+};
+
+[[nodiscard]] StackSamplePerfEvent BuildStackSample(uint64_t timestamp_ns, pid_t tid,
+                                                    uint64_t stack_size) {
+  constexpr uint64_t kRegisterCount = sizeof(RingBufferSampleRegsUserAll) / sizeof(uint64_t);
+  StackSamplePerfEvent event{
+      .timestamp = timestamp_ns,
+      .data =
+          {
+              .pid = kPid,
+              .tid = tid,
+              .regs = std::make_unique<uint64_t[]>(kRegisterCount),
+              .dyn_size = stack_size,
+              .data = make_unique_for_overwrite<uint8_t[]>(stack_size),
+          },
+  };
+  event.data.regs[PERF_REG_X86_SP] = 0x7fff0000 + timestamp_ns % kDistinctCallstackCount;
+  return event;
+}
+
+// Visits stack samples, which are unwound on the calling thread or, when the argument is non-zero,
+// on an UnwindingWorkerPool with that many workers. The samples are created before timing, as in
+// the tracer they come from the ring buffers.
+void BM_VisitStackSamples(benchmark::State& state) {
+  const auto worker_count = static_cast<size_t>(state.range(0));
+  constexpr int kSamplesPerBatch = 256;
+  constexpr pid_t kThreadCount = 8;
+  constexpr uint64_t kStackSize = 8 * 1024;
+
+  NoOpTracerListener listener;
+  UprobesFunctionCallManager function_call_manager;
+  UprobesReturnAddressManager return_address_manager{nullptr};
+  FakeLibunwindstackMaps maps;
+  std::shared_ptr<unwindstack::MapInfo> map_info = maps.Find(kModuleStart);
+  FakeLibunwindstackUnwinder unwinder{map_info};
+  LeafFunctionCallManager leaf_function_call_manager{static_cast<uint16_t>(kStackSize)};
+  std::map<uint64_t, uint64_t> absolute_address_to_size_of_functions_to_stop_at;
+  UprobesUnwindingVisitor visitor{&listener,
+                                  &function_call_manager,
+                                  &return_address_manager,
+                                  &maps,
+                                  &unwinder,
+                                  &leaf_function_call_manager,
+                                  /*user_space_instrumentation_addresses=*/nullptr,
+                                  &absolute_address_to_size_of_functions_to_stop_at};
+
+  PerfEventBufferPool perf_event_buffer_pool{kStackSize};
+  std::unique_ptr<UnwindingWorkerPool> unwinding_worker_pool;
+  if (worker_count > 0) {
+    unwinding_worker_pool = std::make_unique<UnwindingWorkerPool>(worker_count, [&map_info] {
+      return std::make_unique<FakeLibunwindstackUnwinder>(map_info);
+    });
+    visitor.SetUnwindingWorkerPool(unwinding_worker_pool.get(), &perf_event_buffer_pool);
+  }
+
+  orbit_benchmark_utils::AllocationCounter allocation_counter;
+  uint64_t timestamp_ns = 0;
+  std::vector<StackSamplePerfEvent> samples;
+  samples.reserve(kSamplesPerBatch);
+  for (auto _ : state) {
+    state.PauseTiming();
+    allocation_counter.Pause();
+    samples.clear();
+    for (int i = 0; i < kSamplesPerBatch; ++i) {
+      ++timestamp_ns;
+      samples.push_back(
+          BuildStackSample(timestamp_ns, kPid + static_cast<pid_t>(i % kThreadCount), kStackSize));
+    }
+    allocation_counter.Resume();
+    state.ResumeTiming();
+
+    for (const StackSamplePerfEvent& sample : samples) {
+      visitor.Visit(sample.timestamp, sample.data);
+    }
+    if (unwinding_worker_pool != nullptr) {
+      unwinding_worker_pool->WaitAndDeliverAll();
+    }
+  }
+
+  allocation_counter.Report(state,
+                            static_cast<int64_t>(state.iterations()) * kSamplesPerBatch);
+}
+
+BENCHMARK(BM_VisitStackSamples)->Arg(0)->Arg(1)->Arg(4)->UseRealTime();
+
+// Entries into and exits from a dynamically instrumented function, which produce FunctionCalls.
+void BM_VisitUprobesAndUretprobes(benchmark::State& state) {
+  constexpr pid_t kTid = kPid + 1;
+  constexpr uint64_t kFunctionId = 1;
+
+  NoOpTracerListener listener;
+  UprobesFunctionCallManager function_call_manager;
+  UprobesReturnAddressManager return_address_manager{nullptr};
+  FakeLibunwindstackMaps maps;
+  FakeLibunwindstackUnwinder unwinder{maps.Find(kModuleStart)};
+  LeafFunctionCallManager leaf_function_call_manager{1024};
+  std::map<uint64_t, uint64_t> absolute_address_to_size_of_functions_to_stop_at;
+  UprobesUnwindingVisitor visitor{&listener,
+                                  &function_call_manager,
+                                  &return_address_manager,
+                                  &maps,
+                                  &unwinder,
+                                  &leaf_function_call_manager,
+                                  /*user_space_instrumentation_addresses=*/nullptr,
+                                  &absolute_address_to_size_of_functions_to_stop_at};
+
+  orbit_benchmark_utils::AllocationCounter allocation_counter;
+  uint64_t timestamp_ns = 0;
+  for (auto _ : state) {
+    visitor.Visit(++timestamp_ns, UprobesPerfEventData{
+                                      .pid = kPid,
+                                      .tid = kTid,
+                                      .cpu = 0,
+                                      .function_id = kFunctionId,
+                                      .sp = 0x7fff0000,
+                                      .ip = kModuleStart,
+                                      .return_address = kModuleStart + 0x100,
+                                  });
+    visitor.Visit(++timestamp_ns, UretprobesPerfEventData{.pid = kPid, .tid = kTid});
+  }
+
+  allocation_counter.Report(state, static_cast<int64_t>(state.iterations()) * 2);
+  state.counters["listener_events"] = static_cast<double>(listener.GetEventCount());
+}
+
+BENCHMARK(BM_VisitUprobesAndUretprobes);
+
+}  // namespace
+
+}  // namespace orbit_linux_tracing
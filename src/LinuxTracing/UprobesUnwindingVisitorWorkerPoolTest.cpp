@@ -0,0 +1,279 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/strings/str_format.h>
+#include <absl/strings/str_join.h>
+#include <absl/types/span.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <unwindstack/Error.h>
+#include <unwindstack/MapInfo.h>
+#include <unwindstack/Regs.h>
+#include <unwindstack/Unwinder.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "GrpcProtos/capture.pb.h"
+#include "LibunwindstackMultipleOfflineAndProcessMemory.h"
+#include "LibunwindstackUnwinder.h"
+#include "MockTracerListener.h"
+#include "PerfEvent.h"
+#include "PerfEventBufferPool.h"
+#include "PerfEventRecords.h"
+#include "UnwindingWorkerPool.h"
+#include "UprobesFunctionCallManager.h"
+#include "UprobesUnwindingVisitor.h"
+#include "UprobesUnwindingVisitorTestCommon.h"
+
+namespace orbit_linux_tracing {
+
+namespace {
+
+constexpr uint64_t kTargetMapsStart = 100;
+constexpr uint64_t kTargetMapsEnd = 400;
+constexpr pid_t kPid = 10;
+constexpr pid_t kTid = 11;
+constexpr uint64_t kStackSize = 16;
+
+const std::shared_ptr<unwindstack::MapInfo> kTargetMapInfo = unwindstack::MapInfo::Create(
+    kTargetMapsStart, kTargetMapsEnd, 0, PROT_EXEC | PROT_READ, "target");
+
+// Unwinds to a callstack that depends on the first byte of the stack, so that the results of
+// different samples differ. Sleeps for a duration that also depends on it, so that the tasks on
+// an UnwindingWorkerPool complete out of order.
+class FakeUnwinder : public LibunwindstackUnwinder {
+ public:
+  LibunwindstackResult Unwind(pid_t /*pid*/, unwindstack::Maps* /*maps*/,
+                              const std::array<uint64_t, PERF_REG_X86_64_MAX>& /*perf_regs*/,
+                              absl::Span<const StackSliceView> stack_slices,
+                              bool /*offline_memory_only*/, size_t /*max_frames*/) override {
+    const uint8_t seed = stack_slices.front().data()[0];
+    std::this_thread::sleep_for(std::chrono::microseconds{(seed * 7) % 5 * 200});
+
+    std::vector<unwindstack::FrameData> frames;
+    for (uint64_t i = 0; i <= seed % 3; ++i) {
+      frames.push_back(unwindstack::FrameData{.pc = kTargetMapsStart + seed + i * 100,
+                                              .function_name = absl::StrFormat("function%u", i),
+                                              .function_offset = 0,
+                                              .map_info = kTargetMapInfo});
+    }
+    return LibunwindstackResult{std::move(frames), unwindstack::RegsX86_64{}};
+  }
+
+  std::optional<bool> HasFramePointerSet(uint64_t /*instruction_address*/, pid_t /*pid*/,
+                                         unwindstack::Maps* /*maps*/) override {
+    return std::nullopt;
+  }
+};
+
+template <typename StackPerfEventT>
+StackPerfEventT CreateStackPerfEvent(uint64_t timestamp, uint8_t seed) {
+  constexpr uint64_t kTotalNumOfRegisters = sizeof(RingBufferSampleRegsUserAll) / sizeof(uint64_t);
+  StackPerfEventT event{
+      .timestamp = timestamp,
+      .data =
+          {
+              .regs = std::make_unique<uint64_t[]>(kTotalNumOfRegisters),
+              .dyn_size = kStackSize,
+              .data = std::make_unique<uint8_t[]>(kStackSize),
+          },
+  };
+  event.data.data[0] = seed;
+  if constexpr (std::is_same_v<StackPerfEventT, StackSamplePerfEvent>) {
+    event.data.pid = kPid;
+    event.data.tid = kTid;
+  } else {
+    event.data.prev_pid_or_minus_one = kPid;
+    event.data.prev_tid = kTid;
+  }
+  return event;
+}
+
+// Stack samples and stacks collected on context switches, interleaved with the entries and exits
+// of an instrumented function, which are sent to the listener without unwinding.
+std::vector<PerfEvent> CreatePerfEvents() {
+  std::vector<PerfEvent> events;
+  uint64_t timestamp = 1000;
+  for (uint8_t seed = 0; seed < 100; ++seed) {
+    if (seed % 10 == 0) {
+      events.emplace_back(UserSpaceFunctionEntryPerfEvent{
+          .timestamp = ++timestamp,
+          .data = {.pid = kPid, .tid = kTid, .function_id = seed, .sp = 0, .return_address = 0}});
+    }
+    if (seed % 4 == 0) {
+      events.emplace_back(CreateStackPerfEvent<SchedSwitchWithStackPerfEvent>(++timestamp, seed));
+    } else {
+      events.emplace_back(CreateStackPerfEvent<StackSamplePerfEvent>(++timestamp, seed));
+    }
+    if (seed % 10 == 5) {
+      events.emplace_back(UserSpaceFunctionExitPerfEvent{.timestamp = ++timestamp,
+                                                         .data = {.pid = kPid, .tid = kTid}});
+    }
+  }
+  return events;
+}
+
+// Visits the events of CreatePerfEvents with a UprobesUnwindingVisitor, on an UnwindingWorkerPool
+// with `worker_count` workers if not zero, and returns what the listener received, in order.
+std::vector<std::string> VisitPerfEventsAndGetListenerCalls(size_t worker_count) {
+  std::vector<std::string> listener_calls;
+  ::testing::NiceMock<MockTracerListener> listener;
+  ON_CALL(listener, OnCallstackSample)
+      .WillByDefault([&listener_calls](orbit_grpc_protos::FullCallstackSample sample) {
+        listener_calls.push_back(absl::StrFormat(
+            "CallstackSample %u %u %d [%s]", sample.timestamp_ns(), sample.tid(),
+            sample.callstack().type(), absl::StrJoin(sample.callstack().pcs(), ",")));
+      });
+  ON_CALL(listener, OnThreadStateSliceCallstack)
+      .WillByDefault(
+          [&listener_calls](orbit_grpc_protos::ThreadStateSliceCallstack slice_callstack) {
+            listener_calls.push_back(absl::StrFormat(
+                "ThreadStateSliceCallstack %u %u %d [%s]", slice_callstack.timestamp_ns(),
+                slice_callstack.thread_state_slice_tid(), slice_callstack.callstack().type(),
+                absl::StrJoin(slice_callstack.callstack().pcs(), ",")));
+          });
+  ON_CALL(listener, OnFunctionCall)
+      .WillByDefault([&listener_calls](orbit_grpc_protos::FunctionCall function_call) {
+        listener_calls.push_back(absl::StrFormat("FunctionCall %u %u",
+                                                 function_call.function_id(),
+                                                 function_call.end_timestamp_ns()));
+      });
+  ON_CALL(listener, OnAddressInfo)
+      .WillByDefault([&listener_calls](orbit_grpc_protos::FullAddressInfo address_info) {
+        listener_calls.push_back(absl::StrFormat(
+            "AddressInfo %#x %s %s", address_info.absolute_address(),
+            address_info.function_name(), address_info.module_name()));
+      });
+
+  UprobesFunctionCallManager function_call_manager;
+  ::testing::NiceMock<MockUprobesReturnAddressManager> return_address_manager{nullptr};
+  ::testing::NiceMock<MockLibunwindstackMaps> maps;
+  FakeUnwinder unwinder;
+  ::testing::NiceMock<MockLeafFunctionCallManager> leaf_function_call_manager{kStackSize};
+  std::map<uint64_t, uint64_t> absolute_address_to_size_of_functions_to_stop_at;
+  UprobesUnwindingVisitor visitor{&listener,
+                                  &function_call_manager,
+                                  &return_address_manager,
+                                  &maps,
+                                  &unwinder,
+                                  &leaf_function_call_manager,
+                                  /*user_space_instrumentation_addresses=*/nullptr,
+                                  &absolute_address_to_size_of_functions_to_stop_at};
+
+  PerfEventBufferPool perf_event_buffer_pool{kStackSize};
+  std::optional<UnwindingWorkerPool> unwinding_worker_pool;
+  if (worker_count > 0) {
+    unwinding_worker_pool.emplace(worker_count,
+                                  [] { return std::make_unique<FakeUnwinder>(); });
+    visitor.SetUnwindingWorkerPool(&unwinding_worker_pool.value(), &perf_event_buffer_pool);
+  }
+
+  for (const PerfEvent& event : CreatePerfEvents()) {
+    event.Accept(&visitor);
+    if (unwinding_worker_pool.has_value()) {
+      unwinding_worker_pool->DeliverCompletedInOrder();
+    }
+  }
+  if (unwinding_worker_pool.has_value()) {
+    unwinding_worker_pool->WaitAndDeliverAll();
+  }
+  return listener_calls;
+}
+
+}  // namespace
+
+TEST(UprobesUnwindingVisitorWorkerPool, SendsTheSameAsWithoutWorkerPoolInTheSameOrder) {
+  const std::vector<std::string> expected_listener_calls = VisitPerfEventsAndGetListenerCalls(0);
+  // All 100 stacks and 10 function calls, as well as some address infos.
+  EXPECT_GT(expected_listener_calls.size(), 110);
+
+  EXPECT_THAT(VisitPerfEventsAndGetListenerCalls(1),
+              ::testing::ElementsAreArray(expected_listener_calls));
+  EXPECT_THAT(VisitPerfEventsAndGetListenerCalls(4),
+              ::testing::ElementsAreArray(expected_listener_calls));
+}
+
+TEST(UprobesUnwindingVisitorWorkerPool, DoesNotModifyTheVisitedEvent) {
+  ::testing::NiceMock<MockTracerListener> listener;
+  UprobesFunctionCallManager function_call_manager;
+  ::testing::NiceMock<MockUprobesReturnAddressManager> return_address_manager{nullptr};
+  ::testing::NiceMock<MockLibunwindstackMaps> maps;
+  FakeUnwinder unwinder;
+  ::testing::NiceMock<MockLeafFunctionCallManager> leaf_function_call_manager{kStackSize};
+  std::map<uint64_t, uint64_t> absolute_address_to_size_of_functions_to_stop_at;
+  UprobesUnwindingVisitor visitor{&listener,
+                                  &function_call_manager,
+                                  &return_address_manager,
+                                  &maps,
+                                  &unwinder,
+                                  &leaf_function_call_manager,
+                                  /*user_space_instrumentation_addresses=*/nullptr,
+                                  &absolute_address_to_size_of_functions_to_stop_at};
+  PerfEventBufferPool perf_event_buffer_pool{kStackSize};
+  UnwindingWorkerPool unwinding_worker_pool{2, [] { return std::make_unique<FakeUnwinder>(); }};
+  visitor.SetUnwindingWorkerPool(&unwinding_worker_pool, &perf_event_buffer_pool);
+
+  EXPECT_CALL(listener, OnCallstackSample).Times(1);
+  const PerfEvent event{CreateStackPerfEvent<StackSamplePerfEvent>(1000, 42)};
+  event.Accept(&visitor);
+  unwinding_worker_pool.WaitAndDeliverAll();
+
+  // The stack data stays with the event, which other visitors might still read.
+  const auto& event_data = std::get<StackSamplePerfEventData>(event.data);
+  ASSERT_NE(event_data.GetStackData(), nullptr);
+  EXPECT_EQ(event_data.GetStackData()[0], 42);
+}
+
+TEST(UprobesUnwindingVisitorWorkerPool, TakesTheStackCopyFromThePoolAndGivesItBack) {
+  ::testing::NiceMock<MockTracerListener> listener;
+  UprobesFunctionCallManager function_call_manager;
+  ::testing::NiceMock<MockUprobesReturnAddressManager> return_address_manager{nullptr};
+  ::testing::NiceMock<MockLibunwindstackMaps> maps;
+  FakeUnwinder unwinder;
+  ::testing::NiceMock<MockLeafFunctionCallManager> leaf_function_call_manager{kStackSize};
+  std::map<uint64_t, uint64_t> absolute_address_to_size_of_functions_to_stop_at;
+  UprobesUnwindingVisitor visitor{&listener,
+                                  &function_call_manager,
+                                  &return_address_manager,
+                                  &maps,
+                                  &unwinder,
+                                  &leaf_function_call_manager,
+                                  /*user_space_instrumentation_addresses=*/nullptr,
+                                  &absolute_address_to_size_of_functions_to_stop_at};
+  PerfEventBufferPool perf_event_buffer_pool{kStackSize};
+  std::atomic<uint64_t> hit_count = 0;
+  std::atomic<uint64_t> miss_count = 0;
+  perf_event_buffer_pool.SetHitAndMissCounters(&hit_count, &miss_count);
+  UnwindingWorkerPool unwinding_worker_pool{1, [] { return std::make_unique<FakeUnwinder>(); }};
+  visitor.SetUnwindingWorkerPool(&unwinding_worker_pool, &perf_event_buffer_pool);
+
+  EXPECT_CALL(listener, OnCallstackSample).Times(2);
+  const PerfEvent first_event{CreateStackPerfEvent<StackSamplePerfEvent>(1000, 1)};
+  first_event.Accept(&visitor);
+  unwinding_worker_pool.WaitAndDeliverAll();
+  EXPECT_EQ(miss_count, 1);
+  EXPECT_EQ(perf_event_buffer_pool.GetFreeStackDataBufferCount(), 1);
+
+  const PerfEvent second_event{CreateStackPerfEvent<StackSamplePerfEvent>(1001, 2)};
+  second_event.Accept(&visitor);
+  unwinding_worker_pool.WaitAndDeliverAll();
+  EXPECT_EQ(hit_count, 1);
+  EXPECT_EQ(miss_count, 1);
+  EXPECT_EQ(perf_event_buffer_pool.GetFreeStackDataBufferCount(), 1);
+}
+
+}  // namespace orbit_linux_tracing
@@ -0,0 +1,108 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "DemangleSymbolNames.h"
+
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
+#include <llvm/Demangle/Demangle.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "OrbitBase/ThreadPool.h"
+
+using orbit_grpc_protos::SymbolInfo;
+
+namespace orbit_object_utils {
+
+namespace {
+
+// Demangling this many symbols takes a few milliseconds. Smaller symbol tables are demangled
+// sequentially.
+constexpr size_t kDemanglingChunkSize = 16 * 1024;
+
+struct ChunksState {
+  explicit ChunksState(size_t chunk_count) : chunk_count{chunk_count} {}
+
+  const size_t chunk_count;
+  std::atomic<size_t> next_chunk = 0;
+  absl::Mutex mutex;
+  size_t processed_chunk_count ABSL_GUARDED_BY(mutex) = 0;
+};
+
+// Processes chunks until there are none left, and returns how many chunks it processed.
+size_t ProcessRemainingChunks(ChunksState* state, size_t size, size_t chunk_size,
+                              absl::FunctionRef<void(size_t begin, size_t end)> process_chunk) {
+  size_t processed_chunk_count = 0;
+  for (size_t chunk = state->next_chunk++; chunk < state->chunk_count;
+       chunk = state->next_chunk++) {
+    process_chunk(chunk * chunk_size, std::min(size, (chunk + 1) * chunk_size));
+    ++processed_chunk_count;
+  }
+  return processed_chunk_count;
+}
+
+void DemangleSymbolName(SymbolInfo* symbol_info) {
+  symbol_info->set_demangled_name(llvm::demangle(symbol_info->demangled_name()));
+}
+
+}  // namespace
+
+void ForEachChunkInParallel(size_t size, size_t chunk_size,
+                            absl::FunctionRef<void(size_t begin, size_t end)> process_chunk) {
+  if (size <= chunk_size) {
+    if (size > 0) process_chunk(0, size);
+    return;
+  }
+
+  const size_t chunk_count = (size + chunk_size - 1) / chunk_size;
+  // Helpers that only start once all chunks are taken just return, possibly after this function
+  // has returned. So they share ownership of the state, and only call `process_chunk` for the
+  // chunks they take, which this function waits for.
+  auto state = std::make_shared<ChunksState>(chunk_count);
+  const size_t helper_count =
+      std::min<size_t>(chunk_count, std::max(1u, std::thread::hardware_concurrency())) - 1;
+  for (size_t i = 0; i < helper_count; ++i) {
+    orbit_base::ThreadPool::GetDefaultThreadPool()->Schedule(
+        [state, size, chunk_size, process_chunk] {
+          const size_t processed_chunk_count =
+              ProcessRemainingChunks(state.get(), size, chunk_size, process_chunk);
+          absl::MutexLock lock{&state->mutex};
+          state->processed_chunk_count += processed_chunk_count;
+        });
+  }
+
+  const size_t processed_chunk_count =
+      ProcessRemainingChunks(state.get(), size, chunk_size, process_chunk);
+  absl::MutexLock lock{&state->mutex};
+  state->processed_chunk_count += processed_chunk_count;
+  state->mutex.Await(absl::Condition(
+      +[](ChunksState* state) ABSL_EXCLUSIVE_LOCKS_REQUIRED(state->mutex) {
+        return state->processed_chunk_count == state->chunk_count;
+      },
+      state.get()));
+}
+
+void DemangleSymbolNames(google::protobuf::RepeatedPtrField<SymbolInfo>* symbol_infos) {
+  ForEachChunkInParallel(symbol_infos->size(), kDemanglingChunkSize,
+                         [symbol_infos](size_t begin, size_t end) {
+                           for (size_t i = begin; i < end; ++i) {
+                             DemangleSymbolName(symbol_infos->Mutable(static_cast<int>(i)));
+                           }
+                         });
+}
+
+void DemangleSymbolNames(std::vector<SymbolInfo>* symbol_infos) {
+  ForEachChunkInParallel(symbol_infos->size(), kDemanglingChunkSize,
+                         [symbol_infos](size_t begin, size_t end) {
+                           for (size_t i = begin; i < end; ++i) {
+                             DemangleSymbolName(&(*symbol_infos)[i]);
+                           }
+                         });
+}
+
+}  // namespace orbit_object_utils
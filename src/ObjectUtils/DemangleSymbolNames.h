@@ -0,0 +1,34 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef OBJECT_UTILS_DEMANGLE_SYMBOL_NAMES_H_
+#define OBJECT_UTILS_DEMANGLE_SYMBOL_NAMES_H_
+
+#include <absl/functional/function_ref.h>
+#include <google/protobuf/repeated_field.h>
+#include <stddef.h>
+
+#include <vector>
+
+#include "GrpcProtos/symbol.pb.h"
+
+namespace orbit_object_utils {
+
+// Calls `process_chunk` for consecutive chunks of at most `chunk_size` elements that together cover
+// [0, size). If there is more than one chunk, the chunks are processed in parallel on the default
+// thread pool. The calling thread processes chunks as well, so that this makes progress even when
+// all threads of the pool are busy, e.g., because this is itself called from the thread pool.
+void ForEachChunkInParallel(size_t size, size_t chunk_size,
+                            absl::FunctionRef<void(size_t begin, size_t end)> process_chunk);
+
+// Symbols are first collected with their mangled names, which are then replaced with the demangled
+// names. Demangling dominates the time needed to load the symbols of large binaries, so large
+// symbol tables are demangled in parallel.
+void DemangleSymbolNames(
+    google::protobuf::RepeatedPtrField<orbit_grpc_protos::SymbolInfo>* symbol_infos);
+void DemangleSymbolNames(std::vector<orbit_grpc_protos::SymbolInfo>* symbol_infos);
+
+}  // namespace orbit_object_utils
+
+#endif  // OBJECT_UTILS_DEMANGLE_SYMBOL_NAMES_H_
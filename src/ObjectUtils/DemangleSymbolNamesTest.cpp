@@ -0,0 +1,82 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/strings/str_format.h>
+#include <absl/synchronization/mutex.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "DemangleSymbolNames.h"
+#include "GrpcProtos/symbol.pb.h"
+
+namespace orbit_object_utils {
+
+using orbit_grpc_protos::ModuleSymbols;
+using orbit_grpc_protos::SymbolInfo;
+
+namespace {
+
+// The mangled name of `void function<index>()`.
+[[nodiscard]] std::string GetMangledFunctionName(int index) {
+  const std::string name = absl::StrFormat("function%d", index);
+  return absl::StrFormat("_Z%d%sv", name.size(), name);
+}
+
+}  // namespace
+
+TEST(ForEachChunkInParallel, CoversRangeWithChunks) {
+  for (size_t size : {0, 1, 99, 100, 101, 1000, 1001}) {
+    absl::Mutex mutex;
+    std::vector<std::pair<size_t, size_t>> chunks;
+    ForEachChunkInParallel(size, 100, [&](size_t begin, size_t end) {
+      absl::MutexLock lock{&mutex};
+      chunks.emplace_back(begin, end);
+    });
+
+    std::sort(chunks.begin(), chunks.end());
+    size_t expected_begin = 0;
+    for (const auto& [begin, end] : chunks) {
+      EXPECT_EQ(begin, expected_begin);
+      EXPECT_GT(end, begin);
+      EXPECT_LE(end - begin, 100);
+      expected_begin = end;
+    }
+    EXPECT_EQ(expected_begin, size);
+  }
+}
+
+TEST(DemangleSymbolNames, DemanglesSmallAndLargeSymbolTables) {
+  for (int symbol_count : {3, 100'000}) {
+    ModuleSymbols module_symbols;
+    for (int i = 0; i < symbol_count; ++i) {
+      SymbolInfo* symbol_info = module_symbols.add_symbol_infos();
+      symbol_info->set_demangled_name(i % 2 == 0 ? GetMangledFunctionName(i) : "main");
+    }
+
+    DemangleSymbolNames(module_symbols.mutable_symbol_infos());
+
+    for (int i = 0; i < symbol_count; ++i) {
+      EXPECT_EQ(module_symbols.symbol_infos(i).demangled_name(),
+                i % 2 == 0 ? absl::StrFormat("function%d()", i) : "main");
+    }
+  }
+}
+
+TEST(DemangleSymbolNames, DemanglesVector) {
+  std::vector<SymbolInfo> symbol_infos(2);
+  symbol_infos[0].set_demangled_name("_ZN3foo3barEi");
+  symbol_infos[1].set_demangled_name("not_mangled");
+
+  DemangleSymbolNames(&symbol_infos);
+
+  EXPECT_EQ(symbol_infos[0].demangled_name(), "foo::bar(int)");
+  EXPECT_EQ(symbol_infos[1].demangled_name(), "not_mangled");
+}
+
+}  // namespace orbit_object_utils
@@ -5,12 +5,15 @@
 #include "ObjectUtils/ElfFile.h"
 
 #include <absl/base/casts.h>
+#include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
 #include <absl/hash/hash.h>
 #include <absl/strings/str_cat.h>
 #include <absl/strings/str_format.h>
+#include <absl/types/span.h>
 #include <llvm/ADT/ArrayRef.h>
 #include <llvm/ADT/Optional.h>
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/ADT/StringRef.h>
 #include <llvm/ADT/iterator.h>
 #include <llvm/BinaryFormat/Dwarf.h>
@@ -23,8 +26,8 @@
 #include <llvm/DebugInfo/DWARF/DWARFDebugLine.h>
 #include <llvm/DebugInfo/DWARF/DWARFDie.h>
 #include <llvm/DebugInfo/DWARF/DWARFFormValue.h>
+#include <llvm/DebugInfo/DWARF/DWARFUnit.h>
 #include <llvm/DebugInfo/Symbolize/Symbolize.h>
-#include <llvm/Demangle/Demangle.h>
 #include <llvm/Object/Binary.h>
 #include <llvm/Object/ELF.h>
 #include <llvm/Object/ELFObjectFile.h>
@@ -39,10 +42,13 @@
 
 #include <algorithm>
 #include <cstring>
+#include <optional>
+#include <string>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "DemangleSymbolNames.h"
 #include "GrpcProtos/module.pb.h"
 #include "GrpcProtos/symbol.pb.h"
 #include "Introspection/Introspection.h"
@@ -90,6 +96,8 @@ class ElfFileImpl : public ElfFile {
   [[nodiscard]] std::string GetSoname() const override;
   [[nodiscard]] const std::filesystem::path& GetFilePath() const override;
   [[nodiscard]] ErrorMessageOr<LineInfo> GetLineInfo(uint64_t address) override;
+  [[nodiscard]] std::vector<std::optional<LineInfo>> GetLineInfos(
+      absl::Span<const uint64_t> sorted_addresses) override;
   [[nodiscard]] ErrorMessageOr<LineInfo> GetDeclarationLocationOfFunction(
       uint64_t address) override;
   [[nodiscard]] std::optional<GnuDebugLinkInfo> GetGnuDebugLinkInfo() const override;
@@ -103,11 +111,19 @@ class ElfFileImpl : public ElfFile {
       const llvm::object::ELFSymbolRef& symbol_ref,
       const absl::flat_hash_set<uint64_t>& hotpachable_addresses);
   [[nodiscard]] absl::flat_hash_set<uint64_t> LoadHotpatchableAddresses();
+  [[nodiscard]] llvm::DWARFContext* GetDwarfContext();
+  [[nodiscard]] const std::optional<std::string>& GetSourceFileName(
+      llvm::DWARFUnit* unit, const llvm::DWARFDebugLine::LineTable& line_table,
+      uint64_t file_index);
 
   const std::filesystem::path file_path_;
   llvm::object::OwningBinary<llvm::object::ObjectFile> owning_binary_;
   llvm::object::ELFObjectFile<ElfT>* object_file_;
   llvm::symbolize::LLVMSymbolizer symbolizer_;
+  // Created on first use and kept, as it caches parsed compilation units and line tables.
+  std::unique_ptr<llvm::DWARFContext> dwarf_context_;
+  absl::flat_hash_map<std::pair<llvm::DWARFUnit*, uint64_t>, std::optional<std::string>>
+      source_file_names_;
   std::string build_id_;
   std::string soname_;
   bool has_symtab_section_;
@@ -132,6 +148,33 @@ bool IsHotpatchable(const absl::flat_hash_set<uint64_t>& hotpachable_addresses,
   return hotpachable_addresses.contains(symbol_address - kPaddingSize);
 }
 
+// Returns the index of the row of `line_table` that describes `address`, like
+// `LineTable::lookupAddress`. When looking up increasing addresses, pass the previous result as
+// `previous_row_index`: as long as the addresses stay in the same sequence, this then only advances
+// through the rows, instead of searching the whole table again.
+uint32_t FindRowForAddress(const llvm::DWARFDebugLine::LineTable& line_table, uint64_t address,
+                           uint32_t previous_row_index) {
+  const llvm::DWARFDebugLine::LineTable::RowVector& rows = line_table.Rows;
+  if (previous_row_index != line_table.UnknownRowIndex &&
+      rows[previous_row_index].Address.Address <= address) {
+    // Each sequence ends with an end_sequence row, which never describes an address. So the
+    // previous row is always followed by another row.
+    uint32_t row_index = previous_row_index;
+    while (!rows[row_index + 1].EndSequence && rows[row_index + 1].Address.Address <= address) {
+      ++row_index;
+    }
+    if (address < rows[row_index + 1].Address.Address) return row_index;
+  }
+  return line_table.lookupAddress({address, llvm::object::SectionedAddress::UndefSection});
+}
+
+[[nodiscard]] LineInfo CreateLineInfo(std::string source_file, uint32_t source_line) {
+  LineInfo line_info;
+  line_info.set_source_file(std::move(source_file));
+  line_info.set_source_line(source_line);
+  return line_info;
+}
+
 template <typename ElfT>
 ErrorMessageOr<GnuDebugLinkInfo> ReadGnuDebuglinkSection(
     const typename ElfT::Shdr& section_header, const llvm::object::ELFFile<ElfT>& elf_file) {
@@ -393,7 +436,8 @@ ErrorMessageOr<SymbolInfo> ElfFileImpl<ElfT>::CreateSymbolInfo(
   }
 
   SymbolInfo symbol_info;
-  symbol_info.set_demangled_name(llvm::demangle(name));
+  // Demangled by the callers, all at once.
+  symbol_info.set_demangled_name(std::move(name));
   symbol_info.set_address(maybe_value.get());
   symbol_info.set_size(symbol_ref.getSize());
   symbol_info.set_is_hotpatchable(IsHotpatchable(hotpachable_addresses, maybe_value.get()));
@@ -420,6 +464,7 @@ ErrorMessageOr<ModuleSymbols> ElfFileImpl<ElfT>::LoadDebugSymbols() {
     return ErrorMessage(
         "Unable to load symbols from ELF file: not even a single symbol of type function found.");
   }
+  DemangleSymbolNames(module_symbols.mutable_symbol_infos());
   return module_symbols;
 }
 
@@ -444,6 +489,7 @@ ErrorMessageOr<ModuleSymbols> ElfFileImpl<ElfT>::LoadSymbolsFromDynsym() {
         "Unable to load symbols from .dynsym section: not even a single symbol of type function "
         "found.");
   }
+  DemangleSymbolNames(module_symbols.mutable_symbol_infos());
   return module_symbols;
 }
 
@@ -749,10 +795,88 @@ ErrorMessageOr<LineInfo> orbit_object_utils::ElfFileImpl<ElfT>::GetLineInfo(uint
   return line_info;
 }
 
+template <typename ElfT>
+std::vector<std::optional<LineInfo>> orbit_object_utils::ElfFileImpl<ElfT>::GetLineInfos(
+    absl::Span<const uint64_t> sorted_addresses) {
+  ORBIT_CHECK(has_debug_info_section_);
+  ORBIT_CHECK(std::is_sorted(sorted_addresses.begin(), sorted_addresses.end()));
+  std::vector<std::optional<LineInfo>> line_infos(sorted_addresses.size());
+  llvm::DWARFContext* dwarf_context = GetDwarfContext();
+  if (dwarf_context == nullptr) return line_infos;
+
+  llvm::DWARFCompileUnit* compile_unit = nullptr;
+  const llvm::DWARFDebugLine::LineTable* line_table = nullptr;
+  uint32_t row_index = UINT32_MAX;
+  llvm::SmallVector<llvm::DWARFDie, 4> inlined_chain;
+  for (size_t i = 0; i < sorted_addresses.size(); ++i) {
+    const uint64_t address = sorted_addresses[i];
+    llvm::DWARFCompileUnit* address_compile_unit = dwarf_context->getCompileUnitForAddress(address);
+    if (address_compile_unit == nullptr) continue;
+    if (address_compile_unit != compile_unit) {
+      compile_unit = address_compile_unit;
+      line_table = dwarf_context->getLineTableForUnit(compile_unit);
+      if (line_table != nullptr) row_index = line_table->UnknownRowIndex;
+    }
+    if (line_table == nullptr) continue;
+
+    // The chain goes from the innermost inlined subroutine to the subprogram containing `address`.
+    // Like GetLineInfo, we report the location in the subprogram: for inlined code, this is the
+    // call site of the outermost inlined subroutine.
+    inlined_chain.clear();
+    compile_unit->getInlinedChainForAddress(address, inlined_chain);
+    uint64_t file_index = 0;
+    uint32_t line = 0;
+    if (inlined_chain.size() >= 2) {
+      uint32_t call_file = 0;
+      uint32_t call_column = 0;
+      uint32_t call_discriminator = 0;
+      inlined_chain[inlined_chain.size() - 2].getCallerFrame(call_file, line, call_column,
+                                                            call_discriminator);
+      file_index = call_file;
+    } else {
+      row_index = FindRowForAddress(*line_table, address, row_index);
+      if (row_index == line_table->UnknownRowIndex) continue;
+      file_index = line_table->Rows[row_index].File;
+      line = line_table->Rows[row_index].Line;
+    }
+
+    const std::optional<std::string>& source_file =
+        GetSourceFileName(compile_unit, *line_table, file_index);
+    if (!source_file.has_value()) continue;
+    line_infos[i] = CreateLineInfo(source_file.value(), line);
+  }
+  return line_infos;
+}
+
+template <typename ElfT>
+llvm::DWARFContext* orbit_object_utils::ElfFileImpl<ElfT>::GetDwarfContext() {
+  if (dwarf_context_ == nullptr) {
+    dwarf_context_ = llvm::DWARFContext::create(*owning_binary_.getBinary());
+  }
+  return dwarf_context_.get();
+}
+
+template <typename ElfT>
+const std::optional<std::string>& orbit_object_utils::ElfFileImpl<ElfT>::GetSourceFileName(
+    llvm::DWARFUnit* unit, const llvm::DWARFDebugLine::LineTable& line_table,
+    uint64_t file_index) {
+  // Building the absolute path is comparatively expensive, and only few files are referenced.
+  auto [it, inserted] = source_file_names_.try_emplace(std::make_pair(unit, file_index));
+  if (inserted) {
+    std::string file_name;
+    if (line_table.getFileNameByIndex(
+            file_index, unit->getCompilationDir(),
+            llvm::DILineInfoSpecifier::FileLineInfoKind::AbsoluteFilePath, file_name)) {
+      it->second = std::move(file_name);
+    }
+  }
+  return it->second;
+}
+
 template <typename ElfT>
 ErrorMessageOr<LineInfo> orbit_object_utils::ElfFileImpl<ElfT>::GetDeclarationLocationOfFunction(
     uint64_t address) {
-  const auto dwarf_context = llvm::DWARFContext::create(*owning_binary_.getBinary());
+  llvm::DWARFContext* const dwarf_context = GetDwarfContext();
   if (dwarf_context == nullptr) return ErrorMessage{"Could not read DWARF information."};
 
   const auto offset = dwarf_context->getDebugAranges()->findAddress(address);
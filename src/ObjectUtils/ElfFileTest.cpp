@@ -9,6 +9,7 @@
 #include <gtest/gtest.h>
 #include <stdint.h>
 
+#include <algorithm>
 #include <filesystem>
 #include <memory>
 #include <optional>
@@ -547,6 +548,60 @@ TEST(ElfFile, LineInfoInlining) {
             "LineInfoTestBinary.cpp");
 }
 
+static void ExpectGetLineInfosAgreesWithGetLineInfo(const char* file_name) {
+  const std::filesystem::path file_path = orbit_test::GetTestdataDir() / file_name;
+  auto elf_file = CreateElfFile(file_path);
+  ASSERT_THAT(elf_file, HasNoError());
+  auto symbols = elf_file.value()->LoadDebugSymbols();
+  ASSERT_THAT(symbols, HasNoError());
+
+  std::vector<uint64_t> addresses;
+  for (const SymbolInfo& symbol_info : symbols.value().symbol_infos()) {
+    for (uint64_t address = symbol_info.address();
+         address < symbol_info.address() + symbol_info.size(); ++address) {
+      addresses.push_back(address);
+    }
+  }
+  // Also cover addresses without line info.
+  addresses.push_back(0x10);
+  std::sort(addresses.begin(), addresses.end());
+  ASSERT_GT(addresses.size(), 1);
+
+  const std::vector<std::optional<orbit_grpc_protos::LineInfo>> line_infos =
+      elf_file.value()->GetLineInfos(addresses);
+  ASSERT_EQ(line_infos.size(), addresses.size());
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    SCOPED_TRACE(absl::StrFormat("address=%#x", addresses[i]));
+    ErrorMessageOr<orbit_grpc_protos::LineInfo> expected =
+        elf_file.value()->GetLineInfo(addresses[i]);
+    ASSERT_EQ(line_infos[i].has_value(), expected.has_value());
+    if (!expected.has_value()) continue;
+    EXPECT_EQ(line_infos[i]->source_file(), expected.value().source_file());
+    EXPECT_EQ(line_infos[i]->source_line(), expected.value().source_line());
+  }
+}
+
+TEST(ElfFile, GetLineInfos) {
+  ExpectGetLineInfosAgreesWithGetLineInfo("hello_world_elf_with_debug_info");
+}
+
+TEST(ElfFile, GetLineInfosInlining) {
+  ExpectGetLineInfosAgreesWithGetLineInfo("line_info_test_binary");
+
+  const std::filesystem::path file_path = orbit_test::GetTestdataDir() / "line_info_test_binary";
+  auto program = CreateElfFile(file_path);
+  ASSERT_THAT(program, HasNoError());
+
+  constexpr uint64_t kFirstInstructionOfInlinedPrintHelloWorld = 0x401141;
+  const std::vector<std::optional<orbit_grpc_protos::LineInfo>> line_infos =
+      program.value()->GetLineInfos({kFirstInstructionOfInlinedPrintHelloWorld});
+  ASSERT_EQ(line_infos.size(), 1);
+  ASSERT_TRUE(line_infos[0].has_value());
+  EXPECT_EQ(line_infos[0]->source_line(), 13);
+  EXPECT_EQ(std::filesystem::path{line_infos[0]->source_file()}.filename().string(),
+            "LineInfoTestBinary.cpp");
+}
+
 TEST(ElfFile, CompressedDebugInfo) {
   const std::filesystem::path file_path =
       orbit_test::GetTestdataDir() / "line_info_test_binary_compressed";
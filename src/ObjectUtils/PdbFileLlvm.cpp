@@ -44,7 +44,6 @@
 #include <llvm/DebugInfo/PDB/PDB.h>
 #include <llvm/DebugInfo/PDB/PDBSymbolExe.h>
 #include <llvm/DebugInfo/PDB/PDBTypes.h>
-#include <llvm/Demangle/Demangle.h>
 #include <llvm/Object/COFF.h>
 #include <llvm/Support/BinaryStreamArray.h>
 #include <llvm/Support/BinaryStreamRef.h>
@@ -54,10 +53,12 @@
 #include <algorithm>
 #include <iterator>
 #include <memory>
+#include <string>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "DemangleSymbolNames.h"
 #include "GrpcProtos/symbol.pb.h"
 #include "ObjectUtils/ObjectFile.h"
 #include "OrbitBase/Logging.h"
@@ -94,35 +95,36 @@ namespace {
 // all symbol info required for functions.
 class SymbolInfoVisitor : public llvm::codeview::SymbolVisitorCallbacks {
  public:
-  SymbolInfoVisitor(std::vector<SymbolInfo>* symbol_infos,
+  SymbolInfoVisitor(std::vector<SymbolInfo>* symbol_infos, std::vector<std::string>* argument_lists,
                     absl::flat_hash_set<uint64_t>* addresses_from_module_debug_stream,
                     const ObjectFileInfo& object_file_info,
                     llvm::FixedStreamArray<llvm::object::coff_section>* section_headers,
                     llvm::pdb::TpiStream* type_info_stream)
       : symbol_infos_(symbol_infos),
+        argument_lists_(argument_lists),
         addresses_from_module_debug_stream_(addresses_from_module_debug_stream),
         object_file_info_(object_file_info),
         section_headers_(section_headers),
         type_info_stream_(type_info_stream) {
     ORBIT_CHECK(symbol_infos != nullptr);
+    ORBIT_CHECK(argument_lists != nullptr);
     ORBIT_CHECK(type_info_stream != nullptr);
   }
 
   // This is the only record type (ProcSym) we are interested in, so we only override this
   // method. Other records will simply return llvm::Error::success without any work done.
+  // The names are demangled later, all at once, and only then completed with the argument list
+  // that is stored at the same index in `argument_lists_`.
   llvm::Error visitKnownRecord(llvm::codeview::CVSymbol& /*unused*/,
                                llvm::codeview::ProcSym& proc) override {
     SymbolInfo symbol_info;
-    symbol_info.set_demangled_name(llvm::demangle(proc.Name.str()));
+    symbol_info.set_demangled_name(proc.Name.str());
 
     // The ProcSym's name does not contain an argument list. However, this information is required
     // when dealing with overloads and it is available in the type info stream. See:
     // https://llvm.org/docs/PDB/TpiStream.html
-    llvm::StringRef argument_list = RetrieveArgumentList(proc);
-    if (!argument_list.empty()) {
-      symbol_info.set_demangled_name(
-          absl::StrCat(symbol_info.demangled_name(), argument_list.data()));
-    }
+    ORBIT_CHECK(argument_lists_ != nullptr);
+    argument_lists_->emplace_back(RetrieveArgumentList(proc).str());
 
     uint64_t address = ComputeAddress(proc.CodeOffset, proc.Segment, object_file_info_.load_bias,
                                       *section_headers_);
@@ -196,6 +198,7 @@ class SymbolInfoVisitor : public llvm::codeview::SymbolVisitorCallbacks {
   }
 
   std::vector<SymbolInfo>* symbol_infos_;
+  std::vector<std::string>* argument_lists_;
   absl::flat_hash_set<uint64_t>* addresses_from_module_debug_stream_;
   ObjectFileInfo object_file_info_;
   llvm::FixedStreamArray<llvm::object::coff_section>* section_headers_;
@@ -250,6 +253,8 @@ ErrorMessageOr<void> LoadDebugSymbolsFromModuleStreams(
     absl::flat_hash_set<uint64_t>* addresses_from_module_debug_stream) {
   const llvm::pdb::DbiModuleList& modules = debug_info_stream.modules();
 
+  std::vector<SymbolInfo> module_symbol_infos;
+  std::vector<std::string> argument_lists;
   for (uint32_t index = 0; index < modules.getModuleCount(); ++index) {
     auto modi = modules.getModuleDescriptor(index);
     uint16_t modi_stream_index = modi.getModuleStreamIndex();
@@ -274,8 +279,9 @@ ErrorMessageOr<void> LoadDebugSymbolsFromModuleStreams(
     llvm::codeview::SymbolDeserializer deserializer(nullptr,
                                                     llvm::codeview::CodeViewContainer::Pdb);
     pipeline.addCallbackToPipeline(deserializer);
-    SymbolInfoVisitor symbol_visitor(symbol_infos, addresses_from_module_debug_stream,
-                                     object_file_info, &section_headers, &type_info_stream);
+    SymbolInfoVisitor symbol_visitor(&module_symbol_infos, &argument_lists,
+                                     addresses_from_module_debug_stream, object_file_info,
+                                     &section_headers, &type_info_stream);
     pipeline.addCallbackToPipeline(symbol_visitor);
     llvm::codeview::CVSymbolVisitor visitor(pipeline);
 
@@ -291,6 +297,16 @@ ErrorMessageOr<void> LoadDebugSymbolsFromModuleStreams(
                           llvm::toString(std::move(error)))};
     }
   }
+
+  DemangleSymbolNames(&module_symbol_infos);
+  ORBIT_CHECK(argument_lists.size() == module_symbol_infos.size());
+  for (size_t i = 0; i < module_symbol_infos.size(); ++i) {
+    if (argument_lists[i].empty()) continue;
+    SymbolInfo& symbol_info = module_symbol_infos[i];
+    symbol_info.set_demangled_name(absl::StrCat(symbol_info.demangled_name(), argument_lists[i]));
+  }
+  symbol_infos->insert(symbol_infos->end(), std::make_move_iterator(module_symbol_infos.begin()),
+                       std::make_move_iterator(module_symbol_infos.end()));
   return outcome::success();
 }
 
@@ -300,6 +316,7 @@ void LoadDebugSymbolsFromPublicSymbolStream(
     const ObjectFileInfo& object_file_info,
     const absl::flat_hash_set<uint64_t>& addresses_from_module_debug_stream,
     std::vector<SymbolInfo>* symbol_infos) {
+  std::vector<SymbolInfo> public_symbol_infos;
   const llvm::pdb::GSIHashTable& public_symbol_has_records = public_symbol_stream.getPublicsTable();
   for (const auto& hash_record : public_symbol_has_records) {
     llvm::Expected<llvm::codeview::PublicSym32> record =
@@ -320,7 +337,8 @@ void LoadDebugSymbolsFromPublicSymbolStream(
 
     SymbolInfo symbol_info;
     symbol_info.set_address(address);
-    symbol_info.set_demangled_name(llvm::demangle(record->Name.str()));
+    // Demangled below, all at once.
+    symbol_info.set_demangled_name(record->Name.str());
     // The PDB public symbols don't contain the size of symbols. Set a placeholder which indicates
     // that the size is unknown for now and try to deduce it later. We will later use that
     // placeholder to look-up the size in `SectionContributionsVisitor` or in
@@ -329,8 +347,12 @@ void LoadDebugSymbolsFromPublicSymbolStream(
     // We currently only support hotpatchable functions in elf files.
     symbol_info.set_is_hotpatchable(false);
 
-    symbol_infos->emplace_back(std::move(symbol_info));
+    public_symbol_infos.emplace_back(std::move(symbol_info));
   }
+
+  DemangleSymbolNames(&public_symbol_infos);
+  symbol_infos->insert(symbol_infos->end(), std::make_move_iterator(public_symbol_infos.begin()),
+                       std::make_move_iterator(public_symbol_infos.end()));
 }
 
 }  // namespace
@@ -5,6 +5,7 @@
 #ifndef OBJECT_UTILS_ELF_FILE_H_
 #define OBJECT_UTILS_ELF_FILE_H_
 
+#include <absl/types/span.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -48,6 +49,12 @@ class ElfFile : public ObjectFile {
   [[nodiscard]] virtual std::string GetSoname() const = 0;
   [[nodiscard]] virtual ErrorMessageOr<orbit_grpc_protos::LineInfo> GetLineInfo(
       uint64_t address) = 0;
+  // Returns the same line info as GetLineInfo for each of `sorted_addresses`, or std::nullopt where
+  // there is none. Instead of symbolizing each address on its own, this walks the line table of
+  // each compilation unit once, and parsed line tables and source file names are kept for
+  // subsequent calls. Use this to get the line info of many addresses, e.g., of a whole function.
+  [[nodiscard]] virtual std::vector<std::optional<orbit_grpc_protos::LineInfo>> GetLineInfos(
+      absl::Span<const uint64_t> sorted_addresses) = 0;
 
   // Returns the declaration location of the given function (subprogram) address
   // if available in the DWARF debug information.
@@ -47,8 +47,10 @@
 #include "CaptureClient/LoadCapture.h"
 #include "CaptureFile/CaptureFile.h"
 #include "CaptureFile/CaptureFileHelpers.h"
+#include "CaptureFile/CaptureFileOutputStream.h"
 #include "ClientData/CallstackData.h"
 #include "ClientData/CallstackType.h"
+#include "ClientData/ModuleAndFunctionLookup.h"
 #include "ClientData/ModuleData.h"
 #include "ClientData/ModuleIdentifier.h"
 #include "ClientData/ModuleInMemory.h"
@@ -128,6 +130,7 @@ using orbit_capture_client::CaptureListener;
 using orbit_capture_client::ClientCaptureOptions;
 
 using orbit_capture_file::CaptureFile;
+using orbit_capture_file::CaptureSectionCompression;
 
 using orbit_client_data::CallstackData;
 using orbit_client_data::CallstackEvent;
@@ -171,6 +174,8 @@ using orbit_grpc_protos::CrashOrbitServiceRequest_CrashType;
 using orbit_grpc_protos::ModuleInfo;
 using orbit_grpc_protos::TracepointInfo;
 
+using orbit_object_utils::ElfFile;
+
 using orbit_preset_file::PresetFile;
 
 using orbit_client_data::ModuleIdentifier;
@@ -255,6 +260,26 @@ orbit_data_views::PresetLoadState GetPresetLoadStateForProcess(const PresetFile&
   return prioritized_modules;
 }
 
+// Returns, for each module, how many distinct addresses in the sampled callstacks fall into it.
+[[nodiscard]] absl::flat_hash_map<const ModuleData*, uint64_t> CountSampledAddressesPerModule(
+    const CallstackData& callstack_data, const ProcessData& process,
+    const orbit_client_data::ModuleManager& module_manager) {
+  absl::flat_hash_set<uint64_t> sampled_addresses;
+  callstack_data.ForEachUniqueCallstack([&sampled_addresses](
+                                            uint64_t /*callstack_id*/,
+                                            const orbit_client_data::CallstackInfo& callstack) {
+    sampled_addresses.insert(callstack.frames().begin(), callstack.frames().end());
+  });
+
+  absl::flat_hash_map<const ModuleData*, uint64_t> module_to_sampled_address_count;
+  for (uint64_t address : sampled_addresses) {
+    const ModuleData* module =
+        orbit_client_data::FindModuleByAddress(process, module_manager, address);
+    if (module != nullptr) ++module_to_sampled_address_count[module];
+  }
+  return module_to_sampled_address_count;
+}
+
 }  // namespace
 
 bool DoZoom = false;
@@ -911,20 +936,19 @@ void OrbitApp::ShowSourceCode(const orbit_client_data::FunctionInfo& function) {
       .module_path = function.module_path(), .build_id = function.module_build_id()};
   const ModuleData* module = GetModuleByModulePathAndBuildId(module_path_and_build_id);
 
-  auto loaded_module = RetrieveModuleWithDebugInfo(module_path_and_build_id);
+  auto loaded_elf_file = RetrieveElfFileWithDebugInfo(module_path_and_build_id);
 
-  (void)loaded_module.Then(main_thread_executor_, [this, module, function](
-                                                      const ErrorMessageOr<std::filesystem::path>&
-                                                          local_file_path_or_error) mutable {
+  (void)loaded_elf_file.Then(main_thread_executor_, [this, module, function](
+                                                        const ErrorMessageOr<std::shared_ptr<
+                                                            ElfFile>>& elf_file_or_error) mutable {
     const std::string error_title = "Error showing source code";
-    if (local_file_path_or_error.has_error()) {
-      SendErrorToUi(error_title, local_file_path_or_error.error().message());
+    if (elf_file_or_error.has_error()) {
+      SendErrorToUi(error_title, elf_file_or_error.error().message());
       return;
     }
 
-    const auto elf_file = orbit_object_utils::CreateElfFile(local_file_path_or_error.value());
-    const auto decl_line_info_or_error =
-        elf_file.value()->GetLocationOfFunction(function.address());
+    const std::shared_ptr<ElfFile>& elf_file = elf_file_or_error.value();
+    const auto decl_line_info_or_error = elf_file->GetLocationOfFunction(function.address());
     if (decl_line_info_or_error.has_error()) {
       SendErrorToUi(
           error_title,
@@ -963,7 +987,7 @@ void OrbitApp::ShowSourceCode(const orbit_client_data::FunctionInfo& function) {
       const orbit_client_data::ThreadSampleData* summary = sampling_data.GetSummary();
       if (summary != nullptr) {
         code_report = std::make_unique<orbit_code_report::SourceCodeReport>(
-            line_info.source_file(), function, absolute_address.value(), elf_file.value().get(),
+            line_info.source_file(), function, absolute_address.value(), elf_file.get(),
             *summary, GetCaptureData().GetCallstackData().GetCallstackEventsCount());
       }
     }
@@ -1241,7 +1265,10 @@ static std::unique_ptr<CaptureEventProcessor> CreateCaptureEventProcessor(
   }
 
   auto save_to_file_processor_or_error =
-      CaptureEventProcessor::CreateSaveToFileProcessor(file_path, error_handler);
+      CaptureEventProcessor::CreateSaveToFileProcessor(
+          file_path, error_handler,
+          absl::GetFlag(FLAGS_compress_capture_files) ? CaptureSectionCompression::kZstd
+                                                      : CaptureSectionCompression::kNone);
 
   if (save_to_file_processor_or_error.has_error()) {
     error_handler(ErrorMessage{
@@ -1389,6 +1416,10 @@ void OrbitApp::StartCapture() {
   options.enable_auto_frame_track = data_manager_->enable_auto_frame_track();
   options.thread_state_change_callstack_collection =
       data_manager_->thread_state_change_callstack_collection();
+  options.pack_capture_events = absl::GetFlag(FLAGS_compact_capture_stream);
+  options.compress_capture_responses = absl::GetFlag(FLAGS_compact_capture_stream);
+  options.use_shared_memory_producer_transport =
+      absl::GetFlag(FLAGS_shared_memory_producer_transport);
 
   ORBIT_CHECK(capture_client_ != nullptr);
 
@@ -1562,9 +1593,9 @@ OrbitApp::RetrieveModuleAndLoadSymbolsAndHandleError(const ModuleData* module) {
       });
 }
 
-Future<ErrorMessageOr<std::filesystem::path>> OrbitApp::RetrieveModuleWithDebugInfo(
+Future<ErrorMessageOr<std::shared_ptr<ElfFile>>> OrbitApp::RetrieveElfFileWithDebugInfo(
     const orbit_client_data::ModulePathAndBuildId& module_path_and_build_id) {
-  return symbol_loader_->RetrieveModuleWithDebugInfo(module_path_and_build_id);
+  return symbol_loader_->RetrieveElfFileWithDebugInfo(module_path_and_build_id);
 }
 
 void OrbitApp::AddSymbols(const orbit_client_data::ModulePathAndBuildId& module_path_and_build_id,
@@ -1892,8 +1923,26 @@ Future<std::vector<ErrorMessageOr<CanceledOr<void>>>> OrbitApp::LoadAllSymbols()
 
   const ProcessData& process = GetConnectedOrLoadedProcess();
 
+  // Modules are loaded in parallel, in the order in which they are scheduled. So start with the
+  // modules that most sampled addresses fall into: their symbols matter most for the profile, and
+  // they tend to be the largest ones, which would otherwise be the last to finish.
+  std::vector<const ModuleData*> modules = module_manager_->GetAllModuleData();
+  if (HasCaptureData()) {
+    const absl::flat_hash_map<const ModuleData*, uint64_t> module_to_sampled_address_count =
+        CountSampledAddressesPerModule(GetCaptureData().GetCallstackData(), process,
+                                       *module_manager_);
+    auto get_sampled_address_count = [&module_to_sampled_address_count](const ModuleData* module) {
+      auto it = module_to_sampled_address_count.find(module);
+      return it != module_to_sampled_address_count.end() ? it->second : uint64_t{0};
+    };
+    std::stable_sort(modules.begin(), modules.end(),
+                     [&get_sampled_address_count](const ModuleData* lhs, const ModuleData* rhs) {
+                       return get_sampled_address_count(lhs) > get_sampled_address_count(rhs);
+                     });
+  }
+
   std::vector<const ModuleData*> sorted_module_list = SortModuleListWithPrioritizationList(
-      module_manager_->GetAllModuleData(),
+      std::move(modules),
       {kGgpVlkModulePathSubstring, kNtdllSoFileName, process.full_path()});
 
   std::vector<Future<ErrorMessageOr<CanceledOr<void>>>> loading_futures;
@@ -2767,7 +2816,7 @@ OrbitApp::GetConfidenceIntervalEstimator() const {
   return confidence_interval_estimator_;
 }
 
-void OrbitApp::ShowHistogram(const std::vector<uint64_t>* data, std::string scope_name,
+void OrbitApp::ShowHistogram(const orbit_statistics::QuantileSketch* data, std::string scope_name,
                              std::optional<ScopeId> scope_id) {
   main_window_->ShowHistogram(data, std::move(scope_name), scope_id);
 }
@@ -25,6 +25,7 @@
 #include "OrbitBase/StopToken.h"
 #include "OrbitGl/CallTreeView.h"
 #include "OrbitGl/SelectionData.h"
+#include "Statistics/QuantileSketch.h"
 
 namespace orbit_gl {
 
@@ -53,7 +54,7 @@ class MainWindowInterface {
   virtual void AppendToCaptureLog(CaptureLogSeverity severity, absl::Duration capture_time,
                                   std::string_view message) = 0;
 
-  virtual void ShowHistogram(const std::vector<uint64_t>* data, std::string scope_name,
+  virtual void ShowHistogram(const orbit_statistics::QuantileSketch* data, std::string scope_name,
                              std::optional<ScopeId> scope_id) = 0;
 
   enum class SymbolErrorHandlingResult { kReloadRequired, kSymbolLoadingCancelled };
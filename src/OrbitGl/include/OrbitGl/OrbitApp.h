@@ -75,6 +75,7 @@
 #include "GrpcProtos/services.pb.h"
 #include "GrpcProtos/symbol.pb.h"
 #include "GrpcProtos/tracepoint.pb.h"
+#include "ObjectUtils/ElfFile.h"
 #include "OrbitBase/CanceledOr.h"
 #include "OrbitBase/Executor.h"
 #include "OrbitBase/Future.h"
@@ -95,6 +96,7 @@
 #include "QtUtils/Throttle.h"
 #include "Statistics/BinomialConfidenceInterval.h"
 #include "Statistics/Histogram.h"
+#include "Statistics/QuantileSketch.h"
 #include "StringManager/StringManager.h"
 
 class OrbitApp final : public DataViewFactory,
@@ -271,7 +273,8 @@ class OrbitApp final : public DataViewFactory,
   orbit_base::Future<void> LoadSymbolsManually(
       absl::Span<const orbit_client_data::ModuleData* const> modules) override;
 
-  orbit_base::Future<ErrorMessageOr<std::filesystem::path>> RetrieveModuleWithDebugInfo(
+  orbit_base::Future<ErrorMessageOr<std::shared_ptr<orbit_object_utils::ElfFile>>>
+  RetrieveElfFileWithDebugInfo(
       const orbit_client_data::ModulePathAndBuildId& module_path_and_build_id);
 
   orbit_base::Future<ErrorMessageOr<void>> UpdateProcessAndModuleList() override;
@@ -553,7 +556,7 @@ class OrbitApp final : public DataViewFactory,
 
   void RequestUpdatePrimitives();
 
-  void ShowHistogram(const std::vector<uint64_t>* data, std::string scope_name,
+  void ShowHistogram(const orbit_statistics::QuantileSketch* data, std::string scope_name,
                      std::optional<ScopeId> scope_id) override;
 
   // Sets CaptureData's selection_callstack_data and selection_post_processed_sampling_data.
@@ -7,6 +7,7 @@
 
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
+#include <absl/time/time.h>
 #include <stdint.h>
 
 #include <filesystem>
@@ -24,6 +25,7 @@
 #include "DataViews/SymbolLoadingState.h"
 #include "GrpcProtos/symbol.pb.h"
 #include "Http/HttpDownloadManager.h"
+#include "ObjectUtils/ElfFile.h"
 #include "OrbitBase/CanceledOr.h"
 #include "OrbitBase/Executor.h"
 #include "OrbitBase/Future.h"
@@ -77,6 +79,14 @@ class SymbolLoader {
   orbit_base::Future<ErrorMessageOr<std::filesystem::path>> RetrieveModuleWithDebugInfo(
       const orbit_client_data::ModulePathAndBuildId& module_path_and_build_id);
 
+  // Like `RetrieveModuleWithDebugInfo`, but returns the ElfFile with the debug information. The
+  // ElfFile is kept for each module, so that the compilation units and line tables it has parsed
+  // are reused by the next code report on the same module.
+  // ONLY call this from the main thread.
+  orbit_base::Future<ErrorMessageOr<std::shared_ptr<orbit_object_utils::ElfFile>>>
+  RetrieveElfFileWithDebugInfo(
+      const orbit_client_data::ModulePathAndBuildId& module_path_and_build_id);
+
   void DisableDownloadForModule(std::string_view module_path);
   void EnableDownloadForModules(const absl::flat_hash_set<std::string>& module_paths);
 
@@ -125,9 +135,11 @@ class SymbolLoader {
   orbit_base::Future<ErrorMessageOr<orbit_base::CanceledOr<std::filesystem::path>>>
   RetrieveModuleItselfFromInstance(std::string_view module_file_path);
 
+  // `retrieve_duration` is only used to report how long loading the symbols took in total.
   orbit_base::Future<ErrorMessageOr<void>> LoadSymbols(
       const std::filesystem::path& symbols_path,
-      const orbit_client_data::ModulePathAndBuildId& module_path_and_build_id);
+      const orbit_client_data::ModulePathAndBuildId& module_path_and_build_id,
+      absl::Duration retrieve_duration);
   orbit_base::Future<ErrorMessageOr<void>> LoadFallbackSymbols(
       const std::filesystem::path& object_path,
       const orbit_client_data::ModulePathAndBuildId& module_path_and_build_id);
@@ -169,6 +181,13 @@ class SymbolLoader {
   // Set of modules for which the download is disabled.
   // ONLY access this from the main thread.
   absl::flat_hash_set<std::string> download_disabled_modules_;
+
+  // Map of module path and build ID to the ElfFile with its debug information, as returned by
+  // `RetrieveElfFileWithDebugInfo`.
+  // ONLY access this from the main thread.
+  absl::flat_hash_map<orbit_client_data::ModulePathAndBuildId,
+                      std::shared_ptr<orbit_object_utils::ElfFile>>
+      elf_files_with_debug_info_;
 };
 
 }  // namespace orbit_gl
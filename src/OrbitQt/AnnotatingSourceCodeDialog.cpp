@@ -22,9 +22,9 @@
 
 namespace orbit_qt {
 void AnnotatingSourceCodeDialog::AddAnnotatingSourceCode(
-    orbit_client_data::FunctionInfo function_info, RetrieveModuleWithDebugInfoCallback callback) {
+    orbit_client_data::FunctionInfo function_info, RetrieveElfFileWithDebugInfoCallback callback) {
   function_info_ = std::move(function_info);
-  retrieve_module_with_debug_info_ = std::move(callback);
+  retrieve_elf_file_with_debug_info_ = std::move(callback);
 
   QObject::connect(this, &orbit_code_viewer::Dialog::StatusMessageButtonClicked, this,
                    &AnnotatingSourceCodeDialog::DialogActionButtonClicked);
@@ -32,12 +32,11 @@ void AnnotatingSourceCodeDialog::AddAnnotatingSourceCode(
   SetStatusMessage("Loading source location information", std::nullopt);
 
   ORBIT_CHECK(function_info_.has_value());
-  retrieve_module_with_debug_info_(
+  retrieve_elf_file_with_debug_info_(
       {.module_path = function_info_->module_path(), .build_id = function_info_->module_build_id()})
       .Then(&main_thread_executor_,
-            [this](const ErrorMessageOr<std::filesystem::path>& local_file_path_or_error) {
-              HandleDebugInfo(local_file_path_or_error);
-            });
+            [this](const ErrorMessageOr<std::shared_ptr<orbit_object_utils::ElfFile>>&
+                       elf_file_or_error) { HandleDebugInfo(elf_file_or_error); });
 }
 
 void AnnotatingSourceCodeDialog::EnableHeatmap(orbit_code_viewer::FontSizeInEm heatmap_bar_width) {
@@ -62,17 +61,6 @@ void AnnotatingSourceCodeDialog::DialogActionButtonClicked() {
   }
 }
 
-bool AnnotatingSourceCodeDialog::LoadElfFile(const std::filesystem::path& local_file_path) {
-  ErrorMessageOr<std::unique_ptr<orbit_object_utils::ElfFile>> elf_or_error =
-      orbit_object_utils::CreateElfFile(local_file_path);
-  if (elf_or_error.has_error()) {
-    SetStatusMessage(QString::fromStdString(elf_or_error.error().message()), "Hide");
-    awaited_button_action_ = ButtonAction::kHide;
-    return false;
-  }
-  elf_file_ = std::move(elf_or_error.value());
-  return true;
-}
 bool AnnotatingSourceCodeDialog::LoadLocationInformationFromElf() {
   ORBIT_CHECK(function_info_.has_value());
   ErrorMessageOr<orbit_grpc_protos::LineInfo> location_or_error =
@@ -125,19 +113,18 @@ void AnnotatingSourceCodeDialog::LoadSourceCode() {
 }
 
 void AnnotatingSourceCodeDialog::HandleDebugInfo(
-    const ErrorMessageOr<std::filesystem::path>& local_file_path_or_error) {
-  if (local_file_path_or_error.has_error()) {
+    const ErrorMessageOr<std::shared_ptr<orbit_object_utils::ElfFile>>& elf_file_or_error) {
+  if (elf_file_or_error.has_error()) {
     ORBIT_LOG("Error while loading debug information for the disassembly view: %s",
-              local_file_path_or_error.error().message());
+              elf_file_or_error.error().message());
 
-    SetStatusMessage(QString::fromStdString(local_file_path_or_error.error().message()), "Hide");
+    SetStatusMessage(QString::fromStdString(elf_file_or_error.error().message()), "Hide");
     awaited_button_action_ = ButtonAction::kHide;
 
     return;
   }
 
-  const std::filesystem::path& local_file_path = local_file_path_or_error.value();
-  if (!LoadElfFile(local_file_path)) return;
+  elf_file_ = elf_file_or_error.value();
   if (!LoadLocationInformationFromElf()) return;
   if (!DetermineLocalSourceFilePath()) return;
   LoadSourceCode();
@@ -77,6 +77,8 @@ TEST(AnnotatingSourceCodeDialog, SmokeTest) {
       << source_file_contents_or_error.error().message();
   std::string source_file_contents = std::move(source_file_contents_or_error.value());
 
+  const std::shared_ptr<orbit_object_utils::ElfFile> elf_file = std::move(program.value());
+
   orbit_client_data::FunctionInfo function_info{
       "line_info_test_binary",          "buildid", /*address=*/0x401140,
       kMainFunctionInstructions.size(), "main",    /*is_hotpatchable=*/false};
@@ -101,7 +103,8 @@ TEST(AnnotatingSourceCodeDialog, SmokeTest) {
       function_info,
       [&](const orbit_client_data::ModulePathAndBuildId& /*module_path_and_build_id*/) {
         callback_called = true;
-        return orbit_base::Future<ErrorMessageOr<std::filesystem::path>>{file_path};
+        return orbit_base::Future<ErrorMessageOr<std::shared_ptr<orbit_object_utils::ElfFile>>>{
+            elf_file};
       });
 
   bool source_code_loaded = false;
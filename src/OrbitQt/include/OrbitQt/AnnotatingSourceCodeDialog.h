@@ -54,9 +54,9 @@ class AnnotatingSourceCodeDialog : public orbit_code_viewer::Dialog {
  public:
   using orbit_code_viewer::Dialog::Dialog;
 
-  // Same interface as OrbitApp::RetrieveModuleWithDebugInfo;
-  using RetrieveModuleWithDebugInfoCallback =
-      std::function<orbit_base::Future<ErrorMessageOr<std::filesystem::path>>(
+  // Same interface as OrbitApp::RetrieveElfFileWithDebugInfo;
+  using RetrieveElfFileWithDebugInfoCallback = std::function<
+      orbit_base::Future<ErrorMessageOr<std::shared_ptr<orbit_object_utils::ElfFile>>>(
           const orbit_client_data::ModulePathAndBuildId&)>;
 
   void SetDisassemblyCodeReport(orbit_code_report::DisassemblyReport report) {
@@ -70,7 +70,7 @@ class AnnotatingSourceCodeDialog : public orbit_code_viewer::Dialog {
   // Call this function to trigger the annotation process. It requires a disassembly code report to
   // be set before hand by calling `SetDisassemblyCodeReport`.
   void AddAnnotatingSourceCode(orbit_client_data::FunctionInfo function_info,
-                               RetrieveModuleWithDebugInfoCallback callback);
+                               RetrieveElfFileWithDebugInfoCallback callback);
 
  signals:
   void SourceCodeAvailable();
@@ -78,18 +78,18 @@ class AnnotatingSourceCodeDialog : public orbit_code_viewer::Dialog {
 
  private:
   void DialogActionButtonClicked();
-  [[nodiscard]] bool LoadElfFile(const std::filesystem::path& local_file_path);
   [[nodiscard]] bool LoadLocationInformationFromElf();
   [[nodiscard]] bool DetermineLocalSourceFilePath();
   void LoadSourceCode();
-  void HandleDebugInfo(const ErrorMessageOr<std::filesystem::path>& local_file_path);
+  void HandleDebugInfo(
+      const ErrorMessageOr<std::shared_ptr<orbit_object_utils::ElfFile>>& elf_file_or_error);
   void ChooseFile();
   void HandleSourceCode(const QString& source_file_contents);
   void HandleAnnotations();
 
   std::optional<orbit_client_data::FunctionInfo> function_info_;
   std::optional<orbit_code_report::DisassemblyReport> report_;
-  RetrieveModuleWithDebugInfoCallback retrieve_module_with_debug_info_;
+  RetrieveElfFileWithDebugInfoCallback retrieve_elf_file_with_debug_info_;
 
   std::chrono::steady_clock::time_point starting_time_ = std::chrono::steady_clock::now();
 
@@ -97,7 +97,7 @@ class AnnotatingSourceCodeDialog : public orbit_code_viewer::Dialog {
   ButtonAction awaited_button_action_ = ButtonAction::kNone;
 
   std::filesystem::path local_source_file_path_;
-  std::unique_ptr<orbit_object_utils::ElfFile> elf_file_;
+  std::shared_ptr<orbit_object_utils::ElfFile> elf_file_;
   orbit_grpc_protos::LineInfo location_info_;
   std::vector<orbit_code_report::AnnotatingLine> annotations_;
 
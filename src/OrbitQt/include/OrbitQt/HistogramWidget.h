@@ -25,6 +25,7 @@
 
 #include "ClientData/ScopeId.h"
 #include "Statistics/Histogram.h"
+#include "Statistics/QuantileSketch.h"
 
 namespace orbit_qt {
 
@@ -40,8 +41,8 @@ struct BarData {
 [[nodiscard]] std::vector<int> GenerateHistogramBinWidths(size_t number_of_bins,
                                                           int histogram_width);
 
-// Implements a widget that draws a histogram.
-// If the histogram is empty, draws a textual suggestion to select a function.
+// Implements a widget that draws a histogram of the durations of a scope, as described by a
+// QuantileSketch. If the histogram is empty, draws a textual suggestion to select a function.
 class HistogramWidget : public QWidget {
   Q_OBJECT
   using ScopeId = orbit_client_data::ScopeId;
@@ -49,7 +50,8 @@ class HistogramWidget : public QWidget {
  public:
   using QWidget::QWidget;
 
-  void UpdateData(const std::vector<uint64_t>* data, std::string scope_name,
+  // The sketch is copied, so the widget doesn't depend on the lifetime of the stats it comes from.
+  void UpdateData(const orbit_statistics::QuantileSketch* data, std::string scope_name,
                   std::optional<ScopeId> scope_id);
 
   [[nodiscard]] QString GetTitle() const;
@@ -83,10 +85,10 @@ class HistogramWidget : public QWidget {
   [[nodiscard]] bool IsOverHistogram(const QPoint& pos) const;
 
   struct ScopeData {
-    ScopeData(const std::vector<uint64_t>* data, std::string name, ScopeId id)
-        : data(data), name(std::move(name)), id(id) {}
+    ScopeData(orbit_statistics::QuantileSketch data, std::string name, ScopeId id)
+        : data(std::move(data)), name(std::move(name)), id(id) {}
 
-    const std::vector<uint64_t>* data;
+    orbit_statistics::QuantileSketch data;
     std::string name;
     ScopeId id;
   };
@@ -25,6 +25,7 @@
 #include "OrbitQt/orbiteventiterator.h"
 #include "OrbitQt/types.h"
 #include "Statistics/Histogram.h"
+#include "Statistics/QuantileSketch.h"
 
 namespace Ui {
 class OrbitLiveFunctions;
@@ -51,7 +52,7 @@ class OrbitLiveFunctions : public QWidget {
   std::optional<LiveFunctionsController*> GetLiveFunctionsController() {
     return live_functions_ ? &live_functions_.value() : nullptr;
   }
-  void ShowHistogram(const std::vector<uint64_t>* data, std::string scope_name,
+  void ShowHistogram(const orbit_statistics::QuantileSketch* data, std::string scope_name,
                      std::optional<orbit_client_data::ScopeId> scope_id);
   void SetScopeStatsCollection(
       std::shared_ptr<const orbit_client_data::ScopeStatsCollection> scope_collection);
@@ -138,7 +138,7 @@ class OrbitMainWindow final : public QMainWindow, public orbit_gl::MainWindowInt
       std::string_view title, std::string_view text,
       std::string_view dont_show_again_setting_key) override;
 
-  void ShowHistogram(const std::vector<uint64_t>* data, std::string scope_name,
+  void ShowHistogram(const orbit_statistics::QuantileSketch* data, std::string scope_name,
                      std::optional<ScopeId> scope_id) override;
 
   orbit_base::Future<ErrorMessageOr<orbit_base::CanceledOr<void>>> DownloadFileFromInstance(
@@ -169,7 +169,8 @@ void OrbitLiveFunctions::OnRowSelected(std::optional<int> row) {
   ui_->data_view_panel_->GetTreeView()->SetIsInternalRefresh(false);
 }
 
-void OrbitLiveFunctions::ShowHistogram(const std::vector<uint64_t>* data, std::string scope_name,
+void OrbitLiveFunctions::ShowHistogram(const orbit_statistics::QuantileSketch* data,
+                                       std::string scope_name,
                                        std::optional<orbit_client_data::ScopeId> scope_id) {
   ui_->histogram_widget_->UpdateData(data, std::move(scope_name), scope_id);
 }
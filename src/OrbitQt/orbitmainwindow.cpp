@@ -1771,8 +1771,8 @@ void OrbitMainWindow::ShowWarningWithDontShowAgainCheckboxIfNeeded(
   message_box.exec();
 }
 
-void OrbitMainWindow::ShowHistogram(const std::vector<uint64_t>* data, std::string scope_name,
-                                    std::optional<ScopeId> scope_id) {
+void OrbitMainWindow::ShowHistogram(const orbit_statistics::QuantileSketch* data,
+                                    std::string scope_name, std::optional<ScopeId> scope_id) {
   ui->liveFunctions->ShowHistogram(data, std::move(scope_name), scope_id);
 }
 
@@ -1889,7 +1889,7 @@ void OrbitMainWindow::ShowDisassembly(const orbit_client_data::FunctionInfo& fun
   dialog_ptr->AddAnnotatingSourceCode(
       function_info,
       [this](const orbit_client_data::ModulePathAndBuildId& module_path_and_build_id) {
-        return app_->RetrieveModuleWithDebugInfo(module_path_and_build_id);
+        return app_->RetrieveElfFileWithDebugInfo(module_path_and_build_id);
       });
 }
 
@@ -4,19 +4,28 @@
 
 #include "ProducerEventProcessor/GrpcClientCaptureEventCollector.h"
 
+#include <absl/strings/str_format.h>
+#include <absl/time/clock.h>
 #include <absl/time/time.h>
 #include <google/protobuf/arena.h>
+#include <google/protobuf/io/coded_stream.h>
 #include <stddef.h>
 
 #include <algorithm>
+#include <optional>
+#include <string>
+#include <thread>
 #include <utility>
 
 #include "ApiInterface/Orbit.h"
+#include "CaptureResponseEncoding/PackedCaptureEvents.h"
 #include "GrpcProtos/capture.pb.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/MakeUniqueForOverwrite.h"
+#include "OrbitBase/Profiling.h"
 #include "OrbitBase/ThreadUtils.h"
 
+using orbit_grpc_protos::CaptureRequest;
 using orbit_grpc_protos::CaptureResponse;
 using orbit_grpc_protos::ClientCaptureEvent;
 
@@ -35,47 +44,132 @@ static void InitializeArenaOfCaptureResponses(
   *arena_of_capture_responses = std::make_unique<google::protobuf::Arena>(arena_options);
 }
 
+// Returns the size that `event` takes when serialized as an element of the repeated field
+// `capture_events` of a CaptureResponse, including the tag and the length.
+[[nodiscard]] static uint64_t GetByteSizeInCaptureResponse(const ClientCaptureEvent& event) {
+  const size_t event_byte_size = event.ByteSizeLong();
+  constexpr size_t kTagByteSize = 1;
+  return kTagByteSize +
+         google::protobuf::io::CodedOutputStream::VarintSize64(event_byte_size) +
+         event_byte_size;
+}
+
+GrpcClientCaptureEventCollector::Options
+GrpcClientCaptureEventCollector::GetOptionsFromCaptureRequest(const CaptureRequest& capture_request) {
+  Options options;
+  if (capture_request.max_send_latency_ms() > 0) {
+    options.max_send_latency = absl::Milliseconds(capture_request.max_send_latency_ms());
+  }
+  if (capture_request.event_memory_budget_bytes() > 0) {
+    options.memory_budget_bytes = capture_request.event_memory_budget_bytes();
+  }
+  switch (capture_request.event_drop_policy()) {
+    case CaptureRequest::kNeverDrop:
+      options.drop_policy = DropPolicy::kNeverDrop;
+      break;
+    case CaptureRequest::kDropCallstackSamples:
+      options.drop_policy = DropPolicy::kDropCallstackSamples;
+      break;
+    case CaptureRequest::kDropCallstackSamplesThenSystemEvents:
+      options.drop_policy = DropPolicy::kDropCallstackSamplesThenSystemEvents;
+      break;
+    default:
+      ORBIT_ERROR("Unknown event drop policy %d: never dropping events",
+                  capture_request.event_drop_policy());
+      options.drop_policy = DropPolicy::kNeverDrop;
+      break;
+  }
+  return options;
+}
+
 GrpcClientCaptureEventCollector::GrpcClientCaptureEventCollector(
     grpc::ServerReaderWriterInterface<orbit_grpc_protos::CaptureResponse,
                                       orbit_grpc_protos::CaptureRequest>* reader_writer)
-    : reader_writer_{reader_writer} {
+    : GrpcClientCaptureEventCollector{reader_writer, Options{}} {}
+
+GrpcClientCaptureEventCollector::GrpcClientCaptureEventCollector(
+    grpc::ServerReaderWriterInterface<orbit_grpc_protos::CaptureResponse,
+                                      orbit_grpc_protos::CaptureRequest>* reader_writer,
+    Options options)
+    : reader_writer_{reader_writer},
+      options_{options},
+      target_capture_response_bytes_{options.min_capture_response_bytes} {
   ORBIT_CHECK(reader_writer_ != nullptr);
+  ORBIT_CHECK(options_.min_capture_response_bytes > 0);
+  ORBIT_CHECK(options_.min_capture_response_bytes <= options_.max_capture_response_bytes);
 
-  InitializeArenaOfCaptureResponses(&arena_of_capture_responses_being_built_,
-                                    &initial_block_of_first_arena_);
   InitializeArenaOfCaptureResponses(&arena_of_capture_responses_to_send_,
-                                    &initial_block_of_second_arena_);
+                                    &initial_block_of_arena_);
 
   sender_thread_ = std::thread{[this] { SenderThread(); }};
 }
 
+bool GrpcClientCaptureEventCollector::ShouldDrop(const ClientCaptureEvent& event,
+                                                 uint64_t queued_byte_count) const {
+  if (queued_byte_count < options_.memory_budget_bytes) {
+    return false;
+  }
+  const bool is_callstack_sample = event.event_case() == ClientCaptureEvent::kCallstackSample;
+  switch (options_.drop_policy) {
+    case DropPolicy::kNeverDrop:
+      return false;
+    case DropPolicy::kDropCallstackSamples:
+      return is_callstack_sample;
+    case DropPolicy::kDropCallstackSamplesThenSystemEvents: {
+      if (is_callstack_sample) return true;
+      if (queued_byte_count < 2 * options_.memory_budget_bytes) return false;
+      switch (event.event_case()) {
+        case ClientCaptureEvent::kSchedulingSlice:
+        case ClientCaptureEvent::kThreadStateSlice:
+        case ClientCaptureEvent::kTracepointEvent:
+        case ClientCaptureEvent::kMemoryUsageEvent:
+          return true;
+        default:
+          return false;
+      }
+    }
+  }
+  ORBIT_UNREACHABLE();
+}
+
 void GrpcClientCaptureEventCollector::AddEvent(ClientCaptureEvent&& event) {
-  absl::MutexLock lock{&mutex_};
-  if (stop_requested_) {
+  // Count the event as queued before checking stop_requested_, and StopAndWait sets
+  // stop_requested_ before the sender thread reads queued_event_count_ for the last time (both
+  // sequentially consistent). So either this event is rejected here, or the sender thread waits
+  // for it to be pushed and sends it. Events are never left in event_queue_.
+  queued_event_count_.fetch_add(1, std::memory_order_seq_cst);
+  if (stop_requested_.load(std::memory_order_seq_cst)) {
+    queued_event_count_.fetch_sub(1, std::memory_order_relaxed);
     return;
   }
 
-  // We group several ClientCaptureEvents in a single CaptureResponse to avoid sending countless
-  // tiny messages. But we also want to avoid huge messages, which:
-  // - would cause the capture on the client to jump forward in time in few big steps and not look
-  //   live anymore;
-  // - could exceed the maximum gRPC message size.
-  static constexpr int kMaxEventsPerCaptureResponse = 10'000;
-  if (capture_responses_being_built_.empty() ||
-      capture_responses_being_built_.back()->capture_events_size() ==
-          kMaxEventsPerCaptureResponse) {
-    auto* capture_response = google::protobuf::Arena::CreateMessage<CaptureResponse>(
-        arena_of_capture_responses_being_built_.get());
-    capture_responses_being_built_.push_back(capture_response);
-  }
-  capture_responses_being_built_.back()->mutable_capture_events()->Add(std::move(event));
+  if (ShouldDrop(event, queued_byte_count_.load(std::memory_order_relaxed))) {
+    queued_event_count_.fetch_sub(1, std::memory_order_relaxed);
+    if (event.event_case() == ClientCaptureEvent::kCallstackSample) {
+      dropped_callstack_sample_count_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      dropped_system_event_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return;
+  }
+
+  const uint64_t byte_size = GetByteSizeInCaptureResponse(event);
+  event_queue_.Push({std::move(event), byte_size});
+  const uint64_t previous_queued_byte_count =
+      queued_byte_count_.fetch_add(byte_size, std::memory_order_relaxed);
+  const uint64_t target_bytes = target_capture_response_bytes_.load(std::memory_order_relaxed);
+  if (previous_queued_byte_count < target_bytes &&
+      previous_queued_byte_count + byte_size >= target_bytes) {
+    // The Condition the sender thread waits on is only re-evaluated when mutex_ is released.
+    absl::MutexLock lock{&mutex_};
+  }
 }
 
 void GrpcClientCaptureEventCollector::StopAndWait() {
   ORBIT_CHECK(sender_thread_.joinable());
   {
-    // Protect stop_requested_ with mutex_ so that we can use stop_requested_ in Conditions for
-    // Await/LockWhen (specifically, in SenderThread).
+    // Set stop_requested_ while holding mutex_ so that the Condition in SenderThread is
+    // re-evaluated.
     absl::MutexLock lock{&mutex_};
     stop_requested_ = true;
   }
@@ -93,11 +187,169 @@ GrpcClientCaptureEventCollector::~GrpcClientCaptureEventCollector() {
                           static_cast<float>(total_number_of_events_sent_);
     ORBIT_LOG("Average number of bytes per event: %.2f", average_bytes);
   }
+
+  ORBIT_LOG("Maximum number of bytes queued: %u", max_queued_byte_count_);
+  ORBIT_LOG("Maximum duration of sending buffered events: %s",
+            absl::FormatDuration(max_send_duration_));
+  ORBIT_LOG("Number of dropped CallstackSamples: %u",
+            dropped_callstack_sample_count_.load(std::memory_order_relaxed));
+  ORBIT_LOG("Number of dropped system events: %u",
+            dropped_system_event_count_.load(std::memory_order_relaxed));
+}
+
+void GrpcClientCaptureEventCollector::BuildDroppedEventsWarning(bool force) {
+  // Don't flood the client with warnings while the budget is exceeded.
+  constexpr absl::Duration kMinDroppedEventsWarningInterval = absl::Seconds(1);
+  const absl::Time now = absl::Now();
+  if (!force && now - last_dropped_events_warning_time_ < kMinDroppedEventsWarningInterval) {
+    return;
+  }
+
+  const uint64_t dropped_callstack_sample_count =
+      dropped_callstack_sample_count_.load(std::memory_order_relaxed);
+  const uint64_t dropped_system_event_count =
+      dropped_system_event_count_.load(std::memory_order_relaxed);
+  const uint64_t dropped_event_count = dropped_callstack_sample_count + dropped_system_event_count;
+  if (dropped_event_count == reported_dropped_event_count_) {
+    return;
+  }
+  reported_dropped_event_count_ = dropped_event_count;
+  last_dropped_events_warning_time_ = now;
+
+  ClientCaptureEvent event;
+  orbit_grpc_protos::WarningEvent* warning_event = event.mutable_warning_event();
+  warning_event->set_timestamp_ns(orbit_base::CaptureTimestampNs());
+  std::string message = absl::StrFormat(
+      "The client is not receiving capture data fast enough: %u CallstackSamples and %u other "
+      "events have been dropped so far, with %u bytes of events waiting to be sent.",
+      dropped_callstack_sample_count, dropped_system_event_count,
+      queued_byte_count_.load(std::memory_order_relaxed));
+  if (send_throughput_bytes_per_second_ > 0.0) {
+    absl::StrAppendFormat(&message, " Data is being sent at %.0f KB/s.",
+                          send_throughput_bytes_per_second_ / 1024);
+  }
+  warning_event->set_message(std::move(message));
+  const uint64_t byte_size = GetByteSizeInCaptureResponse(event);
+  AddToCaptureResponsesToSend(std::move(event), byte_size);
+}
+
+void GrpcClientCaptureEventCollector::AddEventSendingStats(bool force, uint64_t queued_event_count,
+                                                           uint64_t queued_byte_count) {
+  constexpr absl::Duration kEventSendingStatsInterval = absl::Seconds(1);
+  const absl::Time now = absl::Now();
+  if (capture_responses_to_send_.empty() ||
+      (!force && now - last_event_sending_stats_time_ < kEventSendingStatsInterval)) {
+    return;
+  }
+  last_event_sending_stats_time_ = now;
+
+  orbit_grpc_protos::EventSendingStats* stats =
+      capture_responses_to_send_.back()->mutable_event_sending_stats();
+  stats->set_queued_event_count(queued_event_count);
+  stats->set_queued_event_bytes(queued_byte_count);
+  stats->set_max_send_duration_us(
+      absl::ToInt64Microseconds(max_send_duration_since_event_sending_stats_));
+  stats->set_send_throughput_bytes_per_second(send_throughput_bytes_per_second_);
+  stats->set_dropped_callstack_sample_count(
+      dropped_callstack_sample_count_.load(std::memory_order_relaxed));
+  stats->set_dropped_other_event_count(dropped_system_event_count_.load(std::memory_order_relaxed));
+  max_send_duration_since_event_sending_stats_ = absl::ZeroDuration();
+}
+
+void GrpcClientCaptureEventCollector::AddToCaptureResponsesToSend(ClientCaptureEvent&& event,
+                                                                  uint64_t byte_size) {
+  // We group several ClientCaptureEvents in a single CaptureResponse to avoid sending countless
+  // tiny messages. But we also want to avoid huge messages, which:
+  // - would cause the capture on the client to jump forward in time in few big steps and not look
+  //   live anymore;
+  // - could exceed the maximum gRPC message size.
+  if (capture_responses_to_send_.empty() ||
+      (capture_response_being_built_byte_size_ > 0 &&
+       capture_response_being_built_byte_size_ + byte_size >
+           target_capture_response_bytes_.load(std::memory_order_relaxed))) {
+    capture_responses_to_send_.push_back(google::protobuf::Arena::CreateMessage<CaptureResponse>(
+        arena_of_capture_responses_to_send_.get()));
+    capture_response_being_built_byte_size_ = 0;
+  }
+  capture_responses_to_send_.back()->mutable_capture_events()->Add(std::move(event));
+  capture_response_being_built_byte_size_ += byte_size;
+}
+
+void GrpcClientCaptureEventCollector::BuildCaptureResponsesFromQueuedEvents(bool stopped) {
+  ORBIT_SCOPE("BuildCaptureResponsesFromQueuedEvents");
+  const uint64_t queued_byte_count = queued_byte_count_.load(std::memory_order_relaxed);
+  ORBIT_UINT64("Bytes of queued CaptureEvents", queued_byte_count);
+  max_queued_byte_count_ = std::max(max_queued_byte_count_, queued_byte_count);
+
+  if (stopped) {
+    // No event is accepted anymore, but AddEvents that were called before StopAndWait can still be
+    // pushing theirs. Wait for all of them, as CaptureFinished can be among those events.
+    while (queued_event_count_.load(std::memory_order_seq_cst) > 0) {
+      std::optional<QueuedEvent> queued_event = event_queue_.TryPop();
+      if (!queued_event.has_value()) {
+        std::this_thread::yield();
+        continue;
+      }
+      queued_event_count_.fetch_sub(1, std::memory_order_relaxed);
+      queued_byte_count_.fetch_sub(queued_event->byte_size, std::memory_order_relaxed);
+      AddToCaptureResponsesToSend(std::move(queued_event->event), queued_event->byte_size);
+    }
+    return;
+  }
+
+  // Only take the events queued so far, so that this terminates even if new events keep arriving.
+  uint64_t event_count = queued_event_count_.load(std::memory_order_acquire);
+  while (event_count > 0) {
+    std::optional<QueuedEvent> queued_event = event_queue_.TryPop();
+    if (!queued_event.has_value()) {
+      // An AddEvent is in progress, the remaining events will be taken in the next iteration.
+      break;
+    }
+    --event_count;
+    queued_event_count_.fetch_sub(1, std::memory_order_relaxed);
+    queued_byte_count_.fetch_sub(queued_event->byte_size, std::memory_order_relaxed);
+    AddToCaptureResponsesToSend(std::move(queued_event->event), queued_event->byte_size);
+  }
+}
+
+void GrpcClientCaptureEventCollector::UpdateTargetCaptureResponseBytes(
+    uint64_t bytes_sent, absl::Duration send_duration) {
+  // Only consider sends that were long enough to measure the throughput of the connection rather
+  // than the time it takes to hand small messages over to gRPC.
+  constexpr absl::Duration kMinMeasuredSendDuration = absl::Milliseconds(1);
+  if (send_duration < kMinMeasuredSendDuration) {
+    // The connection keeps up: grow the messages until they are large enough to be measured.
+    const uint64_t target_bytes = target_capture_response_bytes_.load(std::memory_order_relaxed);
+    if (bytes_sent >= target_bytes) {
+      target_capture_response_bytes_.store(
+          std::min(2 * target_bytes, options_.max_capture_response_bytes),
+          std::memory_order_relaxed);
+    }
+    return;
+  }
+
+  const double throughput = static_cast<double>(bytes_sent) / absl::ToDoubleSeconds(send_duration);
+  // Smooth the measurements, which are noisy as they include the scheduling of the sender thread.
+  constexpr double kNewMeasurementWeight = 0.25;
+  send_throughput_bytes_per_second_ =
+      send_throughput_bytes_per_second_ == 0.0
+          ? throughput
+          : (1 - kNewMeasurementWeight) * send_throughput_bytes_per_second_ +
+                kNewMeasurementWeight * throughput;
+
+  // Aim for sending one CaptureResponse per max_send_latency: smaller CaptureResponses on a slow
+  // connection keep the capture on the client live, larger ones on a fast connection reduce the
+  // overhead per message.
+  const auto target_bytes = static_cast<uint64_t>(
+      send_throughput_bytes_per_second_ * absl::ToDoubleSeconds(options_.max_send_latency));
+  target_capture_response_bytes_.store(
+      std::clamp(target_bytes, options_.min_capture_response_bytes,
+                 options_.max_capture_response_bytes),
+      std::memory_order_relaxed);
 }
 
 void GrpcClientCaptureEventCollector::SenderThread() {
   orbit_base::SetCurrentThreadName("SenderThread");
-  constexpr absl::Duration kSendTimeInterval = absl::Milliseconds(20);
 
   bool stopped = false;
   while (!stopped) {
@@ -105,40 +357,38 @@ void GrpcClientCaptureEventCollector::SenderThread() {
 
     mutex_.LockWhenWithTimeout(
         absl::Condition(
-            +[](GrpcClientCaptureEventCollector* self) ABSL_EXCLUSIVE_LOCKS_REQUIRED(self->mutex_) {
-              // This should be lower than (not equal to) kMaxEventsPerCaptureResponse in AddEvent
-              // as a few more ClientCaptureEvents are likely to arrive after the condition becomes
-              // true.
-              constexpr int kSendEventCountInterval = 5000;
-
-              return (self->capture_responses_being_built_.size() == 1 &&
-                      self->capture_responses_being_built_.back()->capture_events_size() >=
-                          kSendEventCountInterval) ||
-                     self->capture_responses_being_built_.size() > 1 || self->stop_requested_;
+            +[](GrpcClientCaptureEventCollector* self) {
+              return self->queued_byte_count_.load(std::memory_order_relaxed) >=
+                         self->target_capture_response_bytes_.load(std::memory_order_relaxed) ||
+                     self->stop_requested_.load(std::memory_order_relaxed);
             },
             this),
-        kSendTimeInterval);
+        options_.max_send_latency);
     if (stop_requested_) {
       stopped = true;
     }
-    if (capture_responses_being_built_.empty()) {
-      mutex_.Unlock();
+    mutex_.Unlock();
+
+    // Report dropped events before the events queued after them, and in particular before
+    // CaptureFinished, as the client stops processing events after it.
+    BuildDroppedEventsWarning(/*force=*/stopped);
+    const uint64_t queued_event_count = queued_event_count_.load(std::memory_order_relaxed);
+    const uint64_t queued_byte_count = queued_byte_count_.load(std::memory_order_relaxed);
+    // Events added before StopAndWait was called are still sent in this last iteration.
+    BuildCaptureResponsesFromQueuedEvents(stopped);
+    if (capture_responses_to_send_.empty()) {
       continue;
     }
-
-    // We employ double buffering, and the two Arenas `arena_of_capture_response_being_built_` and
-    // `arena_of_capture_response_to_send_` are effectively the two buffers.
-    arena_of_capture_responses_being_built_.swap(arena_of_capture_responses_to_send_);
-    capture_responses_being_built_.swap(capture_responses_to_send_);
-    mutex_.Unlock();
+    AddEventSendingStats(/*force=*/stopped, queued_event_count, queued_byte_count);
 
     uint64_t number_of_events_sent = 0;
     uint64_t number_of_bytes_sent = 0;
 
-    // Note that usually we only have one CaptureResponse to send because kSendEventCountInterval is
-    // quite lower than kMaxEventsPerCaptureResponse. But we can have more than one if new events
-    // come faster than `reader_writer_->Write` executes, which can for example happen if the client
-    // is a bit unresponsive.
+    // Note that usually we only have one CaptureResponse to send, as the target size of a
+    // CaptureResponse adapts to what can be sent in max_send_latency. But we can have more than one
+    // if new events come faster than `reader_writer_->Write` executes, which can for example happen
+    // if the client is a bit unresponsive.
+    const absl::Time send_start = absl::Now();
     for (CaptureResponse* capture_response : capture_responses_to_send_) {
       // Record statistics on event count and byte size for this CaptureResponse.
       int capture_response_event_count = capture_response->capture_events_size();
@@ -151,6 +401,15 @@ void GrpcClientCaptureEventCollector::SenderThread() {
       number_of_events_sent += capture_response_event_count;
       number_of_bytes_sent += capture_response_bytes;
 
+      // Note that the byte sizes above, which drive the target byte size of a CaptureResponse, are
+      // those of the events before packing, as that is how the events are accounted for when
+      // building CaptureResponses.
+      if (pack_capture_events_.load(std::memory_order_relaxed)) {
+        ORBIT_SCOPE("PackCaptureEvents");
+        orbit_capture_response_encoding::PackCaptureEvents(capture_response);
+        ORBIT_INT("Byte size of packed CaptureResponse", capture_response->ByteSizeLong());
+      }
+
       // Now send the CaptureResponse.
       {
         ORBIT_SCOPE("reader_writer_->Write");
@@ -167,11 +426,22 @@ void GrpcClientCaptureEventCollector::SenderThread() {
           static_cast<float>(number_of_bytes_sent) / static_cast<float>(number_of_events_sent);
       ORBIT_FLOAT("Average bytes per CaptureEvent", average_bytes);
 
+      const absl::Duration send_duration = absl::Now() - send_start;
+      ORBIT_UINT64("Duration of sending buffered CaptureEvents (us)",
+                   absl::ToInt64Microseconds(send_duration));
+      max_send_duration_ = std::max(max_send_duration_, send_duration);
+      max_send_duration_since_event_sending_stats_ =
+          std::max(max_send_duration_since_event_sending_stats_, send_duration);
+      UpdateTargetCaptureResponseBytes(number_of_bytes_sent, send_duration);
+      ORBIT_UINT64("Target byte size of CaptureResponse",
+                   target_capture_response_bytes_.load(std::memory_order_relaxed));
+
       total_number_of_events_sent_ += number_of_events_sent;
       total_number_of_bytes_sent_ += number_of_bytes_sent;
     }
 
     capture_responses_to_send_.clear();
+    capture_response_being_built_byte_size_ = 0;
     arena_of_capture_responses_to_send_->Reset();
   }
 }
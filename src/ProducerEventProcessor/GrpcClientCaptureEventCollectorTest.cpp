@@ -2,6 +2,8 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <absl/synchronization/notification.h>
+#include <absl/time/time.h>
 #include <gmock/gmock.h>
 #include <grpcpp/grpcpp.h>
 #include <gtest/gtest.h>
@@ -10,12 +12,17 @@
 #include <atomic>
 #include <chrono>
 #include <memory>
+#include <optional>
 #include <thread>
+#include <utility>
+#include <vector>
 
+#include "CaptureResponseEncoding/PackedCaptureEvents.h"
 #include "GrpcProtos/capture.pb.h"
 #include "GrpcProtos/services.pb.h"
 #include "OrbitBase/Logging.h"
 #include "ProducerEventProcessor/GrpcClientCaptureEventCollector.h"
+#include "TestUtils/TestUtils.h"
 
 using orbit_grpc_protos::CaptureRequest;
 using orbit_grpc_protos::CaptureResponse;
@@ -105,26 +112,257 @@ TEST_F(GrpcClientCaptureEventCollectorTest, AllEventsAreSent) {
   EXPECT_EQ(actual_event_count, kEventCount);
 }
 
-TEST_F(GrpcClientCaptureEventCollectorTest, ManyEventsAreSplitAcrossMultipleCaptureResponses) {
+TEST(GrpcClientCaptureEventCollector, ManyEventsAreSplitAcrossCaptureResponsesBySize) {
+  MockServerReaderWriter mock_reader_writer;
+  // An empty ClientCaptureEvent takes two bytes in a CaptureResponse: the tag and the length.
+  static constexpr uint64_t kEventByteSize = 2;
+  static constexpr uint64_t kCaptureResponseByteSize = 10'000;
+  GrpcClientCaptureEventCollector::Options options;
+  options.min_capture_response_bytes = kCaptureResponseByteSize;
+  options.max_capture_response_bytes = kCaptureResponseByteSize;
+
   std::atomic<uint64_t> actual_event_count = 0;
-  EXPECT_CALL(mock_reader_writer_, OnCaptureResponse)
-      // This depends on the values of kSendEventCountInterval (5000) in
-      // GrpcClientCaptureEventCollector::SenderThread, and of
-      // kMaxEventsPerCaptureResponse (10000) in GrpcClientCaptureEventCollector::AddEvent.
-      // So expect seven CaptureResponse, the first six of which with ~5000 events. But there could
-      // be fewer CaptureResponses as they can fit up to 10000 events.
-      .Times(testing::Between(4, 7))
+  EXPECT_CALL(mock_reader_writer, OnCaptureResponse)
+      // At least seven CaptureResponses of at most 5000 events are needed, but the events can be
+      // split across more CaptureResponses if they are added slower than they are sent.
+      .Times(testing::AtLeast(7))
       .WillRepeatedly([&actual_event_count](const CaptureResponse& capture_response) {
+        EXPECT_LE(capture_response.capture_events_size(),
+                  kCaptureResponseByteSize / kEventByteSize);
+        EXPECT_LE(capture_response.ByteSizeLong(), kCaptureResponseByteSize);
         actual_event_count += capture_response.capture_events_size();
       });
 
   static constexpr uint64_t kEventCount = 32000;
-  AddFakeEvents(kEventCount);
-
-  std::this_thread::sleep_for(kWaitAllCaptureResponsesSentDuration);
+  GrpcClientCaptureEventCollector collector{&mock_reader_writer, options};
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    collector.AddEvent(ClientCaptureEvent{});
+  }
+  collector.StopAndWait();
   EXPECT_EQ(actual_event_count, kEventCount);
 }
 
+TEST(GrpcClientCaptureEventCollector, EventsArePackedWhenEnabled) {
+  MockServerReaderWriter mock_reader_writer;
+  std::vector<ClientCaptureEvent> received_events;
+  EXPECT_CALL(mock_reader_writer, OnCaptureResponse)
+      .Times(testing::AtLeast(1))
+      .WillRepeatedly([&received_events](const CaptureResponse& capture_response) {
+        EXPECT_TRUE(capture_response.has_packed_capture_events());
+        CaptureResponse unpacked_capture_response = capture_response;
+        ASSERT_THAT(
+            orbit_capture_response_encoding::UnpackCaptureEvents(&unpacked_capture_response),
+            orbit_test_utils::HasNoError());
+        for (const ClientCaptureEvent& event : unpacked_capture_response.capture_events()) {
+          received_events.push_back(event);
+        }
+      });
+
+  static constexpr uint64_t kEventCount = 1000;
+  GrpcClientCaptureEventCollector collector{&mock_reader_writer};
+  collector.EnablePackedCaptureEvents();
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    ClientCaptureEvent event;
+    if (i % 10 == 0) {
+      event.mutable_interned_string()->set_key(i);
+    } else {
+      event.mutable_callstack_sample()->set_tid(i % 3);
+      event.mutable_callstack_sample()->set_timestamp_ns(1'000'000 + i);
+    }
+    collector.AddEvent(std::move(event));
+  }
+  collector.StopAndWait();
+
+  ASSERT_EQ(received_events.size(), kEventCount);
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    if (i % 10 == 0) {
+      EXPECT_EQ(received_events[i].interned_string().key(), i);
+    } else {
+      EXPECT_EQ(received_events[i].callstack_sample().tid(), i % 3);
+      EXPECT_EQ(received_events[i].callstack_sample().timestamp_ns(), 1'000'000 + i);
+    }
+  }
+}
+
+TEST(GrpcClientCaptureEventCollector, CallstackSamplesAreDroppedOverTheMemoryBudget) {
+  MockServerReaderWriter mock_reader_writer;
+  GrpcClientCaptureEventCollector::Options options;
+  options.max_send_latency = absl::Milliseconds(1);
+  options.memory_budget_bytes = 1000;
+  options.drop_policy = GrpcClientCaptureEventCollector::DropPolicy::kDropCallstackSamples;
+
+  // The first CaptureResponse is only sent when `client_unblocked` is notified, to simulate a slow
+  // client.
+  absl::Notification first_capture_response_received;
+  absl::Notification client_unblocked;
+  std::atomic<uint64_t> scheduling_slice_count = 0;
+  std::atomic<uint64_t> callstack_sample_count = 0;
+  std::atomic<uint64_t> warning_event_count = 0;
+  EXPECT_CALL(mock_reader_writer, OnCaptureResponse)
+      .WillRepeatedly([&](const CaptureResponse& capture_response) {
+        if (!first_capture_response_received.HasBeenNotified()) {
+          first_capture_response_received.Notify();
+          client_unblocked.WaitForNotification();
+        }
+        for (const ClientCaptureEvent& event : capture_response.capture_events()) {
+          switch (event.event_case()) {
+            case ClientCaptureEvent::kSchedulingSlice:
+              ++scheduling_slice_count;
+              break;
+            case ClientCaptureEvent::kCallstackSample:
+              ++callstack_sample_count;
+              break;
+            case ClientCaptureEvent::kWarningEvent:
+              EXPECT_THAT(event.warning_event().message(), testing::HasSubstr("dropped"));
+              ++warning_event_count;
+              break;
+            default:
+              ADD_FAILURE();
+          }
+        }
+      });
+
+  GrpcClientCaptureEventCollector collector{&mock_reader_writer, options};
+  ClientCaptureEvent scheduling_slice_event;
+  scheduling_slice_event.mutable_scheduling_slice()->set_out_timestamp_ns(1);
+  collector.AddEvent(ClientCaptureEvent{scheduling_slice_event});
+  first_capture_response_received.WaitForNotification();
+
+  static constexpr uint64_t kEventCount = 1000;
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    ClientCaptureEvent callstack_sample_event;
+    callstack_sample_event.mutable_callstack_sample()->set_timestamp_ns(i + 1);
+    callstack_sample_event.mutable_callstack_sample()->set_callstack_id(i + 1);
+    collector.AddEvent(std::move(callstack_sample_event));
+    collector.AddEvent(ClientCaptureEvent{scheduling_slice_event});
+  }
+  client_unblocked.Notify();
+  collector.StopAndWait();
+
+  // Events other than CallstackSamples are never dropped with kDropCallstackSamples.
+  EXPECT_EQ(scheduling_slice_count, kEventCount + 1);
+  EXPECT_GT(callstack_sample_count, 0);
+  EXPECT_LT(callstack_sample_count, kEventCount);
+  EXPECT_EQ(warning_event_count, 1);
+}
+
+TEST(GrpcClientCaptureEventCollector, OptionsAreTakenFromTheCaptureRequest) {
+  const GrpcClientCaptureEventCollector::Options default_options;
+  EXPECT_EQ(default_options.drop_policy, GrpcClientCaptureEventCollector::DropPolicy::kNeverDrop);
+
+  CaptureRequest capture_request;
+  GrpcClientCaptureEventCollector::Options options =
+      GrpcClientCaptureEventCollector::GetOptionsFromCaptureRequest(capture_request);
+  EXPECT_EQ(options.max_send_latency, default_options.max_send_latency);
+  EXPECT_EQ(options.memory_budget_bytes, default_options.memory_budget_bytes);
+  EXPECT_EQ(options.drop_policy, GrpcClientCaptureEventCollector::DropPolicy::kNeverDrop);
+
+  capture_request.set_max_send_latency_ms(100);
+  capture_request.set_event_memory_budget_bytes(1024);
+  capture_request.set_event_drop_policy(CaptureRequest::kDropCallstackSamplesThenSystemEvents);
+  options = GrpcClientCaptureEventCollector::GetOptionsFromCaptureRequest(capture_request);
+  EXPECT_EQ(options.max_send_latency, absl::Milliseconds(100));
+  EXPECT_EQ(options.memory_budget_bytes, 1024);
+  EXPECT_EQ(options.drop_policy,
+            GrpcClientCaptureEventCollector::DropPolicy::kDropCallstackSamplesThenSystemEvents);
+
+  capture_request.set_event_drop_policy(CaptureRequest::kDropCallstackSamples);
+  options = GrpcClientCaptureEventCollector::GetOptionsFromCaptureRequest(capture_request);
+  EXPECT_EQ(options.drop_policy,
+            GrpcClientCaptureEventCollector::DropPolicy::kDropCallstackSamples);
+}
+
+TEST(GrpcClientCaptureEventCollector, EventSendingStatsAreSentWithTheFirstAndLastCaptureResponse) {
+  MockServerReaderWriter mock_reader_writer;
+  absl::Notification first_capture_response_received;
+  std::vector<CaptureResponse> capture_responses;
+  EXPECT_CALL(mock_reader_writer, OnCaptureResponse)
+      .WillRepeatedly([&](const CaptureResponse& capture_response) {
+        capture_responses.push_back(capture_response);
+        if (!first_capture_response_received.HasBeenNotified()) {
+          first_capture_response_received.Notify();
+        }
+      });
+
+  GrpcClientCaptureEventCollector collector{&mock_reader_writer};
+  static constexpr uint64_t kEventCount = 5;
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    collector.AddEvent(ClientCaptureEvent{});
+  }
+  first_capture_response_received.WaitForNotification();
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    collector.AddEvent(ClientCaptureEvent{});
+  }
+  collector.StopAndWait();
+
+  // The sender thread has exited, so `capture_responses` is no longer written to.
+  ASSERT_GE(capture_responses.size(), 2);
+  ASSERT_TRUE(capture_responses.front().has_event_sending_stats());
+  EXPECT_GT(capture_responses.front().event_sending_stats().queued_event_count(), 0);
+  EXPECT_GT(capture_responses.front().event_sending_stats().queued_event_bytes(), 0);
+  ASSERT_TRUE(capture_responses.back().has_event_sending_stats());
+  EXPECT_GT(capture_responses.back().event_sending_stats().queued_event_count(), 0);
+  EXPECT_EQ(capture_responses.back().event_sending_stats().dropped_callstack_sample_count(), 0);
+  EXPECT_EQ(capture_responses.back().event_sending_stats().dropped_other_event_count(), 0);
+}
+
+TEST(GrpcClientCaptureEventCollector, NoEventIsLostWhenAddEventRacesStopAndWait) {
+  static constexpr uint64_t kProducerCount = 4;
+  static constexpr int kRepetitionCount = 20;
+  for (int repetition = 0; repetition < kRepetitionCount; ++repetition) {
+    MockServerReaderWriter mock_reader_writer;
+    // Sequence numbers of the received events, per producer.
+    std::vector<std::vector<uint64_t>> received_sequence_numbers(kProducerCount);
+    EXPECT_CALL(mock_reader_writer, OnCaptureResponse)
+        .WillRepeatedly([&received_sequence_numbers](const CaptureResponse& capture_response) {
+          for (const ClientCaptureEvent& event : capture_response.capture_events()) {
+            received_sequence_numbers[event.callstack_sample().tid()].push_back(
+                event.callstack_sample().timestamp_ns());
+          }
+        });
+
+    GrpcClientCaptureEventCollector::Options options;
+    options.drop_policy = GrpcClientCaptureEventCollector::DropPolicy::kNeverDrop;
+    std::optional<GrpcClientCaptureEventCollector> collector;
+    collector.emplace(&mock_reader_writer, options);
+
+    std::atomic<bool> stop_producers = false;
+    std::atomic<uint64_t> started_producer_count = 0;
+    std::vector<std::thread> producers;
+    for (uint64_t producer = 0; producer < kProducerCount; ++producer) {
+      producers.emplace_back([&, producer] {
+        ++started_producer_count;
+        for (uint64_t sequence_number = 0; !stop_producers; ++sequence_number) {
+          ClientCaptureEvent event;
+          event.mutable_callstack_sample()->set_tid(producer);
+          event.mutable_callstack_sample()->set_timestamp_ns(sequence_number);
+          collector->AddEvent(std::move(event));
+        }
+      });
+    }
+    while (started_producer_count < kProducerCount) {
+      std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+
+    collector->StopAndWait();
+    stop_producers = true;
+    for (std::thread& producer : producers) {
+      producer.join();
+    }
+    // This fails if events were left in the queue.
+    collector.reset();
+
+    // Events are only rejected from the moment StopAndWait is called, so each producer's events
+    // that were sent must be the first ones it added, without gaps.
+    for (const std::vector<uint64_t>& sequence_numbers : received_sequence_numbers) {
+      for (uint64_t i = 0; i < sequence_numbers.size(); ++i) {
+        ASSERT_EQ(sequence_numbers[i], i);
+      }
+    }
+  }
+}
+
 TEST_F(GrpcClientCaptureEventCollectorTest, CaptureResponsesAreSentPeriodicallyEvenIfSmall) {
   std::atomic<uint64_t> actual_event_count = 0;
   EXPECT_CALL(mock_reader_writer_, OnCaptureResponse)
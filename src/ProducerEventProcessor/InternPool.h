@@ -0,0 +1,141 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PRODUCER_EVENT_PROCESSOR_INTERN_POOL_H_
+#define PRODUCER_EVENT_PROCESSOR_INTERN_POOL_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/container/flat_hash_map.h>
+#include <absl/hash/hash.h>
+#include <absl/synchronization/mutex.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+#include <atomic>
+#include <utility>
+
+#include "ApiInterface/Orbit.h"
+#include "OrbitBase/Logging.h"
+
+namespace orbit_producer_event_processor {
+
+// Assigns a unique id to each distinct entry, starting from 1 as 0 is reserved for invalid ids.
+//
+// Entries are looked up through `View`, a non-owning type that `T` can be converted from and
+// constructed from, so that looking up an existing entry doesn't copy it: for example, a
+// std::string_view for std::string entries. `View` must be hashable with absl::Hash and comparable
+// with ==.
+//
+// The pool is safe to use from multiple threads. Entries are distributed by hash over shards with
+// their own mutex, so that concurrent callers rarely wait for each other. The hash of an entry is
+// only computed once per lookup and is reused by the hash map of the shard. The number of lock
+// acquisitions that had to wait is counted and reported to introspection.
+template <typename T, typename View>
+class InternPool final {
+ public:
+  // `name` is used for the introspection track of the lock contention, and must outlive the pool.
+  explicit InternPool(const char* name) : name_{name} {}
+
+  // Return pair of <id, assigned>, where assigned is true if the entry was assigned a new id
+  // and false if returning id for already existing entry.
+  std::pair<uint64_t, bool> GetOrAssignId(View entry) {
+    const size_t hash = absl::Hash<View>{}(entry);
+    Shard& shard = GetShard(hash);
+    LockShard(shard);
+    std::pair<uint64_t, bool> result = GetOrAssignIdInShard(shard, HashedView{entry, hash});
+    shard.mutex.Unlock();
+    return result;
+  }
+
+  // Same as above, but if the entry is assigned a new id, `on_assigned` is called with it while
+  // the shard is still locked. As other callers looking up the same entry only get its id after
+  // `on_assigned` has returned, this allows publishing the entry before its id is used anywhere.
+  template <typename OnAssigned>
+  uint64_t GetOrAssignId(View entry, OnAssigned&& on_assigned) {
+    const size_t hash = absl::Hash<View>{}(entry);
+    Shard& shard = GetShard(hash);
+    LockShard(shard);
+    auto [id, assigned] = GetOrAssignIdInShard(shard, HashedView{entry, hash});
+    if (assigned) {
+      std::forward<OnAssigned>(on_assigned)(id);
+    }
+    shard.mutex.Unlock();
+    return id;
+  }
+
+  [[nodiscard]] uint64_t GetLookupCount() const {
+    return lookup_count_.load(std::memory_order_relaxed);
+  }
+  [[nodiscard]] uint64_t GetContendedLockCount() const {
+    return contended_lock_count_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr size_t kShardCountLog2 = 4;
+  static constexpr size_t kShardCount = 1 << kShardCountLog2;
+
+  // A view with its precomputed hash, to look up entries without hashing them again.
+  struct HashedView {
+    View view;
+    size_t hash;
+  };
+
+  struct Hash {
+    using is_transparent = void;
+    size_t operator()(const T& entry) const { return absl::Hash<View>{}(View(entry)); }
+    size_t operator()(const HashedView& hashed_view) const { return hashed_view.hash; }
+  };
+
+  struct Eq {
+    using is_transparent = void;
+    bool operator()(const T& lhs, const T& rhs) const { return View(lhs) == View(rhs); }
+    bool operator()(const T& lhs, const HashedView& rhs) const { return View(lhs) == rhs.view; }
+    bool operator()(const HashedView& lhs, const T& rhs) const { return lhs.view == View(rhs); }
+  };
+
+  // Aligned to the cache line size, so that threads using different shards don't share a line.
+  struct alignas(64) Shard {
+    absl::Mutex mutex;
+    absl::flat_hash_map<T, uint64_t, Hash, Eq> entry_to_id ABSL_GUARDED_BY(mutex);
+  };
+
+  Shard& GetShard(size_t hash) {
+    // The hash map uses the low bits of the hash, so use the high bits to choose the shard.
+    return shards_[hash >> (sizeof(size_t) * 8 - kShardCountLog2)];
+  }
+
+  void LockShard(Shard& shard) ABSL_EXCLUSIVE_LOCK_FUNCTION(shard.mutex) {
+    if (!shard.mutex.TryLock()) {
+      const uint64_t contended_lock_count =
+          contended_lock_count_.fetch_add(1, std::memory_order_relaxed) + 1;
+      ORBIT_UINT64(name_, contended_lock_count);
+      shard.mutex.Lock();
+    }
+  }
+
+  std::pair<uint64_t, bool> GetOrAssignIdInShard(Shard& shard, const HashedView& hashed_view)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(shard.mutex) {
+    lookup_count_.fetch_add(1, std::memory_order_relaxed);
+    auto it = shard.entry_to_id.find(hashed_view);
+    if (it != shard.entry_to_id.end()) {
+      return std::make_pair(it->second, false);
+    }
+
+    uint64_t new_id = id_counter_.fetch_add(1, std::memory_order_relaxed);
+    auto [unused_it, inserted] = shard.entry_to_id.try_emplace(T(hashed_view.view), new_id);
+    ORBIT_CHECK(inserted);
+    return std::make_pair(new_id, true);
+  }
+
+  const char* name_;
+  std::array<Shard, kShardCount> shards_;
+  std::atomic<uint64_t> id_counter_{1};  // 0 is reserved for invalid_id
+  std::atomic<uint64_t> lookup_count_{0};
+  std::atomic<uint64_t> contended_lock_count_{0};
+};
+
+}  // namespace orbit_producer_event_processor
+
+#endif  // PRODUCER_EVENT_PROCESSOR_INTERN_POOL_H_
@@ -0,0 +1,71 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/container/flat_hash_set.h>
+#include <absl/strings/str_format.h>
+#include <gtest/gtest.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "InternPool.h"
+
+namespace orbit_producer_event_processor {
+
+using StringPool = InternPool<std::string, std::string_view>;
+
+TEST(InternPool, AssignsIdsStartingFromOne) {
+  StringPool pool{"Test pool contended locks"};
+  EXPECT_EQ(pool.GetOrAssignId("a"), std::make_pair(uint64_t{1}, true));
+  EXPECT_EQ(pool.GetOrAssignId("b"), std::make_pair(uint64_t{2}, true));
+  EXPECT_EQ(pool.GetOrAssignId("a"), std::make_pair(uint64_t{1}, false));
+  const std::string b = "b";
+  EXPECT_EQ(pool.GetOrAssignId(b), std::make_pair(uint64_t{2}, false));
+  EXPECT_EQ(pool.GetOrAssignId(""), std::make_pair(uint64_t{3}, true));
+  EXPECT_EQ(pool.GetLookupCount(), 5);
+}
+
+TEST(InternPool, AssignsUniqueIdsFromMultipleThreads) {
+  constexpr size_t kThreadCount = 8;
+  // A power of two, so that multiplying the indices by an odd number permutes them.
+  constexpr size_t kEntryCount = 8192;
+  StringPool pool{"Test pool contended locks"};
+
+  // All threads look up the same entries, in different orders.
+  std::vector<std::vector<uint64_t>> ids_per_thread(kThreadCount);
+  std::vector<std::thread> threads;
+  for (size_t thread_index = 0; thread_index < kThreadCount; ++thread_index) {
+    threads.emplace_back([&pool, &ids = ids_per_thread[thread_index], thread_index] {
+      ids.resize(kEntryCount);
+      for (size_t i = 0; i < kEntryCount; ++i) {
+        const size_t entry_index = (i * (2 * thread_index + 1)) % kEntryCount;
+        ids[entry_index] = pool.GetOrAssignId(absl::StrFormat("entry %u", entry_index)).first;
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  absl::flat_hash_set<uint64_t> distinct_ids;
+  for (size_t i = 0; i < kEntryCount; ++i) {
+    for (size_t thread_index = 1; thread_index < kThreadCount; ++thread_index) {
+      ASSERT_EQ(ids_per_thread[thread_index][i], ids_per_thread[0][i]);
+    }
+    const uint64_t id = ids_per_thread[0][i];
+    EXPECT_GE(id, 1);
+    EXPECT_LE(id, kEntryCount);
+    distinct_ids.insert(id);
+  }
+  EXPECT_EQ(distinct_ids.size(), kEntryCount);
+  EXPECT_EQ(pool.GetLookupCount(), kThreadCount * kEntryCount);
+  EXPECT_LE(pool.GetContendedLockCount(), pool.GetLookupCount());
+}
+
+}  // namespace orbit_producer_event_processor
@@ -0,0 +1,111 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/synchronization/mutex.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <memory>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ProducerEventProcessor/MpscQueue.h"
+
+namespace orbit_producer_event_processor {
+
+TEST(MpscQueue, PopsInPushOrder) {
+  MpscQueue<std::unique_ptr<int>> queue;
+  EXPECT_FALSE(queue.TryPop().has_value());
+
+  queue.Push(std::make_unique<int>(1));
+  queue.Push(std::make_unique<int>(2));
+  std::optional<std::unique_ptr<int>> value = queue.TryPop();
+  ASSERT_TRUE(value.has_value());
+  EXPECT_EQ(*value.value(), 1);
+
+  queue.Push(std::make_unique<int>(3));
+  for (int expected : {2, 3}) {
+    value = queue.TryPop();
+    ASSERT_TRUE(value.has_value());
+    EXPECT_EQ(*value.value(), expected);
+  }
+  EXPECT_FALSE(queue.TryPop().has_value());
+
+  // The remaining elements are destroyed with the queue.
+  queue.Push(std::make_unique<int>(4));
+}
+
+TEST(MpscQueue, PreservesTheOrderAcrossThreads) {
+  constexpr size_t kThreadCount = 4;
+  constexpr uint64_t kValueCountPerThread = 10'000;
+
+  MpscQueue<uint64_t> queue;
+  // The threads take turns through this mutex, so the order of the values is the order in which
+  // they were pushed.
+  absl::Mutex mutex;
+  uint64_t next_value = 0;
+  std::vector<std::thread> threads;
+  for (size_t thread_index = 0; thread_index < kThreadCount; ++thread_index) {
+    threads.emplace_back([&] {
+      for (uint64_t i = 0; i < kValueCountPerThread; ++i) {
+        absl::MutexLock lock{&mutex};
+        queue.Push(next_value++);
+      }
+    });
+  }
+
+  uint64_t expected_value = 0;
+  while (expected_value < kThreadCount * kValueCountPerThread) {
+    std::optional<uint64_t> value = queue.TryPop();
+    if (!value.has_value()) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_EQ(value.value(), expected_value);
+    ++expected_value;
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_FALSE(queue.TryPop().has_value());
+}
+
+TEST(MpscQueue, PopsAllValuesPushedConcurrently) {
+  constexpr size_t kThreadCount = 4;
+  constexpr uint64_t kValueCountPerThread = 10'000;
+
+  // Each value encodes the index of the thread that pushed it and its index on that thread.
+  MpscQueue<std::pair<size_t, uint64_t>> queue;
+  std::vector<std::thread> threads;
+  for (size_t thread_index = 0; thread_index < kThreadCount; ++thread_index) {
+    threads.emplace_back([&queue, thread_index] {
+      for (uint64_t i = 0; i < kValueCountPerThread; ++i) {
+        queue.Push({thread_index, i});
+      }
+    });
+  }
+
+  std::vector<uint64_t> next_value_per_thread(kThreadCount, 0);
+  uint64_t value_count = 0;
+  while (value_count < kThreadCount * kValueCountPerThread) {
+    std::optional<std::pair<size_t, uint64_t>> value = queue.TryPop();
+    if (!value.has_value()) {
+      std::this_thread::yield();
+      continue;
+    }
+    auto [thread_index, index_in_thread] = value.value();
+    ASSERT_LT(thread_index, kThreadCount);
+    ASSERT_EQ(index_in_thread, next_value_per_thread[thread_index]);
+    ++next_value_per_thread[thread_index];
+    ++value_count;
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_FALSE(queue.TryPop().has_value());
+}
+
+}  // namespace orbit_producer_event_processor
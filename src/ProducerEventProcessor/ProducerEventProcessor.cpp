@@ -8,14 +8,18 @@
 #include <absl/hash/hash.h>
 #include <absl/meta/type_traits.h>
 #include <absl/synchronization/mutex.h>
+#include <absl/types/span.h>
 #include <google/protobuf/stubs/port.h>
 
+#include <memory>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
 #include "GrpcProtos/capture.pb.h"
 #include "GrpcProtos/tracepoint.pb.h"
+#include "InternPool.h"
 #include "OrbitBase/Logging.h"
 #include "ProducerEventProcessor/ClientCaptureEventCollector.h"
 
@@ -72,32 +76,36 @@ namespace orbit_producer_event_processor {
 
 namespace {
 
-template <typename T>
-class InternPool final {
- public:
-  InternPool() = default;
-
-  // Return pair of <id, assigned>, where assigned is true if the entry was assigned a new id
-  // and false if returning id for already existing entry.
-  std::pair<uint64_t, bool> GetOrAssignId(const T& entry) {
-    absl::MutexLock lock(&entry_to_id_mutex_);
-    auto it = entry_to_id_.find(entry);
-    if (it != entry_to_id_.end()) {
-      return std::make_pair(it->second, false);
-    }
+// The key of the callstack pool, and the view of it that callstacks are looked up with, so that
+// the program counters of a Callstack don't need to be copied.
+struct CallstackView {
+  absl::Span<const uint64_t> pcs;
+  Callstack::CallstackType type;
 
-    uint64_t new_id = id_counter_++;
-    auto [unused_it, inserted] = entry_to_id_.insert_or_assign(entry, new_id);
-    ORBIT_CHECK(inserted);
-    return std::make_pair(new_id, true);
+  friend bool operator==(const CallstackView& lhs, const CallstackView& rhs) {
+    return lhs.type == rhs.type && lhs.pcs == rhs.pcs;
   }
 
- private:
-  uint64_t id_counter_ = 1;  // 0 is reserved for invalid_id
-  absl::flat_hash_map<T, uint64_t> entry_to_id_;
-  absl::Mutex entry_to_id_mutex_;
+  template <typename H>
+  friend H AbslHashValue(H h, const CallstackView& view) {
+    return H::combine(std::move(h), view.pcs, view.type);
+  }
 };
 
+struct CallstackEntry {
+  explicit CallstackEntry(CallstackView view)
+      : pcs{view.pcs.begin(), view.pcs.end()}, type{view.type} {}
+  // NOLINTNEXTLINE(google-explicit-constructor)
+  operator CallstackView() const { return {pcs, type}; }
+
+  std::vector<uint64_t> pcs;
+  Callstack::CallstackType type;
+};
+
+[[nodiscard]] CallstackView ToCallstackView(const Callstack& callstack) {
+  return {absl::MakeConstSpan(callstack.pcs().data(), callstack.pcs().size()), callstack.type()};
+}
+
 class ProducerEventProcessorImpl : public ProducerEventProcessor {
  public:
   ProducerEventProcessorImpl() = delete;
@@ -140,8 +148,7 @@ class ProducerEventProcessorImpl : public ProducerEventProcessor {
   void ProcessGpuQueueSubmissionAndTransferOwnership(uint64_t producer_id,
                                                      GpuQueueSubmission* gpu_queue_submission);
   // ProcessInterned* functions remap producer intern_ids to the id space used in the client.
-  // They keep track of these mappings in producer_interned_callstack_id_to_client_callstack_id_
-  // and producer_interned_string_id_to_client_string_id_.
+  // They keep track of these mappings in the ProducerState of each producer.
   void ProcessInternedCallstack(uint64_t producer_id, InternedCallstack* interned_callstack);
   void ProcessInternedString(uint64_t producer_id, InternedString* interned_string);
   void ProcessLostPerfRecordsEventAndTransferOwnership(
@@ -166,20 +173,37 @@ class ProducerEventProcessorImpl : public ProducerEventProcessor {
   void SendInternedStringEvent(uint64_t key, std::string value);
   void MergeThreadStateSliceWithCallstackAndTransferOwnership(ThreadStateSlice* thread_state_slice);
 
+  // These are mapping InternedStrings and InternedCallstacks from the ids of a single producer to
+  // client ids. Each producer has its own tables and mutex, so that the events of different
+  // producers can be translated concurrently. The mutex is only contended by the threads of the
+  // same producer.
+  struct ProducerState {
+    absl::Mutex mutex;
+    // producer_callstack_id -> client_callstack_id
+    absl::flat_hash_map<uint64_t, uint64_t> interned_callstack_id_to_client_callstack_id
+        ABSL_GUARDED_BY(mutex);
+    // producer_string_id -> client_string_id
+    absl::flat_hash_map<uint64_t, uint64_t> interned_string_id_to_client_string_id
+        ABSL_GUARDED_BY(mutex);
+  };
+
+  [[nodiscard]] ProducerState& GetOrCreateProducerState(uint64_t producer_id);
+
   ClientCaptureEventCollector* client_capture_event_collector_;
 
-  InternPool<std::pair<std::vector<uint64_t>, Callstack::CallstackType>> callstack_pool_;
-  InternPool<std::string> string_pool_;
-  InternPool<std::pair<std::string, std::string>> tracepoint_pool_;
+  // The events that publish a new entry of these pools (InternedCallstack, InternedString,
+  // InternedTracepointInfo) are added to the collector while the entry is locked in the pool, so
+  // that they always reach the collector before any event that refers to the entry, even when the
+  // latter comes from another thread or producer.
+  InternPool<CallstackEntry, CallstackView> callstack_pool_{"Callstack pool contended locks"};
+  InternPool<std::string, std::string_view> string_pool_{"String pool contended locks"};
+  InternPool<std::pair<std::string, std::string>, std::pair<std::string_view, std::string_view>>
+      tracepoint_pool_{"Tracepoint pool contended locks"};
 
-  // These are mapping InternStrings and InternedCallstacks from producer ids
-  // to client ids:
-  // <producer_id, producer_callstack_id> -> client_callstack_id
-  absl::flat_hash_map<std::pair<uint64_t, uint64_t>, uint64_t>
-      producer_interned_callstack_id_to_client_callstack_id_;
-  // <producer_id, producer_string_id> -> client_string_id
-  absl::flat_hash_map<std::pair<uint64_t, uint64_t>, uint64_t>
-      producer_interned_string_id_to_client_string_id_;
+  // Only locked to add a new producer.
+  absl::Mutex producer_states_mutex_;
+  absl::flat_hash_map<uint64_t, std::unique_ptr<ProducerState>> producer_states_
+      ABSL_GUARDED_BY(producer_states_mutex_);
 
   // Needed to allow merging of thread state slices and their callstacks, see:
   // http://go/stadia-orbit-tracepoint-callstack.
@@ -187,10 +211,29 @@ class ProducerEventProcessorImpl : public ProducerEventProcessor {
   // the begin tracepoint event that results in the ThreadStateSliceCallstack, so we will always
   // see the ThreadStateSliceCallstack before we see the matching ThreadStateSlice. Thus, we do not
   // need to save the thread state slices to be merged with a callstack later.
+  absl::Mutex thread_state_slice_mutex_;
   absl::flat_hash_map<std::pair<uint32_t, uint64_t>, uint64_t>
-      thread_state_slice_tid_and_begin_timestamp_to_callstack_id_;
+      thread_state_slice_tid_and_begin_timestamp_to_callstack_id_
+          ABSL_GUARDED_BY(thread_state_slice_mutex_);
 };
 
+ProducerEventProcessorImpl::ProducerState& ProducerEventProcessorImpl::GetOrCreateProducerState(
+    uint64_t producer_id) {
+  {
+    absl::ReaderMutexLock lock{&producer_states_mutex_};
+    auto it = producer_states_.find(producer_id);
+    if (it != producer_states_.end()) {
+      return *it->second;
+    }
+  }
+  absl::MutexLock lock{&producer_states_mutex_};
+  std::unique_ptr<ProducerState>& producer_state = producer_states_[producer_id];
+  if (producer_state == nullptr) {
+    producer_state = std::make_unique<ProducerState>();
+  }
+  return *producer_state;
+}
+
 void ProducerEventProcessorImpl::MergeThreadStateSliceWithCallstackAndTransferOwnership(
     ThreadStateSlice* thread_state_slice) {
   uint64_t begin_timestamp =
@@ -201,6 +244,7 @@ void ProducerEventProcessorImpl::MergeThreadStateSliceWithCallstackAndTransferOw
   // Also, even if we were missing the end tracepoint, we are not leaking memory in our callstack
   // map. The SwitchesStatesNamesVisitor will eventually create a thread state slice for that begin
   // tracepoint--worst case at the end of profiling--, such that we can erase the mapping.
+  absl::MutexLock lock{&thread_state_slice_mutex_};
   auto thread_state_slice_callstack_it =
       thread_state_slice_tid_and_begin_timestamp_to_callstack_id_.find(
           {thread_state_slice->tid(), begin_timestamp});
@@ -311,11 +355,15 @@ void ProducerEventProcessorImpl::ProcessApiTrackUint64AndTransferOwnership(
 void ProducerEventProcessorImpl::ProcessCallstackSampleAndTransferOwnership(
     uint64_t producer_id, CallstackSample* callstack_sample) {
   // translate producer id to client id
-  auto it = producer_interned_callstack_id_to_client_callstack_id_.find(
-      {producer_id, callstack_sample->callstack_id()});
-  // TODO(b/180235290): replace with error message
-  ORBIT_CHECK(it != producer_interned_callstack_id_to_client_callstack_id_.end());
-  callstack_sample->set_callstack_id(it->second);
+  {
+    ProducerState& producer_state = GetOrCreateProducerState(producer_id);
+    absl::MutexLock lock{&producer_state.mutex};
+    auto it = producer_state.interned_callstack_id_to_client_callstack_id.find(
+        callstack_sample->callstack_id());
+    // TODO(b/180235290): replace with error message
+    ORBIT_CHECK(it != producer_state.interned_callstack_id_to_client_callstack_id.end());
+    callstack_sample->set_callstack_id(it->second);
+  }
 
   ClientCaptureEvent event;
   event.set_allocated_callstack_sample(callstack_sample);
@@ -324,6 +372,7 @@ void ProducerEventProcessorImpl::ProcessCallstackSampleAndTransferOwnership(
 
 void ProducerEventProcessorImpl::ProcessCaptureFinishedAndTransferOwnership(
     CaptureFinished* capture_finished) {
+  absl::MutexLock lock{&thread_state_slice_mutex_};
   if (!thread_state_slice_tid_and_begin_timestamp_to_callstack_id_.empty()) {
     // We don't expect this to happen because SwitchesNamesStateVisitor always produces a slice from
     // the remaining begin tracepoints at the end of the capture.
@@ -375,17 +424,14 @@ void ProducerEventProcessorImpl::ProcessErrorsWithPerfEventOpenEventAndTransferO
 void ProducerEventProcessorImpl::ProcessFullCallstackSample(
     FullCallstackSample* full_callstack_sample) {
   const Callstack& callstack = full_callstack_sample->callstack();
-  std::pair<std::vector<uint64_t>, Callstack::CallstackType> callstack_data{
-      {callstack.pcs().begin(), callstack.pcs().end()}, callstack.type()};
-  auto [callstack_id, assigned] = callstack_pool_.GetOrAssignId(callstack_data);
-
-  if (assigned) {
-    ClientCaptureEvent interned_callstack_event;
-    interned_callstack_event.mutable_interned_callstack()->set_key(callstack_id);
-    interned_callstack_event.mutable_interned_callstack()->set_allocated_intern(
-        full_callstack_sample->release_callstack());
-    client_capture_event_collector_->AddEvent(std::move(interned_callstack_event));
-  }
+  uint64_t callstack_id = callstack_pool_.GetOrAssignId(
+      ToCallstackView(callstack), [this, full_callstack_sample](uint64_t new_callstack_id) {
+        ClientCaptureEvent interned_callstack_event;
+        interned_callstack_event.mutable_interned_callstack()->set_key(new_callstack_id);
+        interned_callstack_event.mutable_interned_callstack()->set_allocated_intern(
+            full_callstack_sample->release_callstack());
+        client_capture_event_collector_->AddEvent(std::move(interned_callstack_event));
+      });
 
   ClientCaptureEvent callstack_sample_event;
   CallstackSample* callstack_sample = callstack_sample_event.mutable_callstack_sample();
@@ -397,17 +443,15 @@ void ProducerEventProcessorImpl::ProcessFullCallstackSample(
 }
 
 void ProducerEventProcessorImpl::ProcessFullAddressInfo(FullAddressInfo* full_address_info) {
-  auto [function_name_key, function_key_assigned] =
-      string_pool_.GetOrAssignId(full_address_info->function_name());
-  if (function_key_assigned) {
-    SendInternedStringEvent(function_name_key, full_address_info->function_name());
-  }
+  uint64_t function_name_key = string_pool_.GetOrAssignId(
+      full_address_info->function_name(), [this, full_address_info](uint64_t key) {
+        SendInternedStringEvent(key, full_address_info->function_name());
+      });
 
-  auto [module_name_key, module_key_assigned] =
-      string_pool_.GetOrAssignId(full_address_info->module_name());
-  if (module_key_assigned) {
-    SendInternedStringEvent(module_name_key, full_address_info->module_name());
-  }
+  uint64_t module_name_key = string_pool_.GetOrAssignId(
+      full_address_info->module_name(), [this, full_address_info](uint64_t key) {
+        SendInternedStringEvent(key, full_address_info->module_name());
+      });
 
   ClientCaptureEvent event;
   AddressInfo* interned_address_info = event.mutable_address_info();
@@ -420,10 +464,10 @@ void ProducerEventProcessorImpl::ProcessFullAddressInfo(FullAddressInfo* full_ad
 }
 
 void ProducerEventProcessorImpl::ProcessFullGpuJob(FullGpuJob* full_gpu_job_event) {
-  auto [timeline_key, assigned] = string_pool_.GetOrAssignId(full_gpu_job_event->timeline());
-  if (assigned) {
-    SendInternedStringEvent(timeline_key, full_gpu_job_event->timeline());
-  }
+  uint64_t timeline_key = string_pool_.GetOrAssignId(
+      full_gpu_job_event->timeline(), [this, full_gpu_job_event](uint64_t key) {
+        SendInternedStringEvent(key, full_gpu_job_event->timeline());
+      });
 
   ClientCaptureEvent event;
   GpuJob* gpu_job_event = event.mutable_gpu_job();
@@ -443,17 +487,18 @@ void ProducerEventProcessorImpl::ProcessFullGpuJob(FullGpuJob* full_gpu_job_even
 
 void ProducerEventProcessorImpl::ProcessFullTracepointEvent(
     FullTracepointEvent* full_tracepoint_event) {
-  auto [tracepoint_key, assigned] =
-      tracepoint_pool_.GetOrAssignId({full_tracepoint_event->tracepoint_info().category(),
-                                      full_tracepoint_event->tracepoint_info().name()});
-  if (assigned) {
-    ClientCaptureEvent event;
-    InternedTracepointInfo* interned_tracepoint_info = event.mutable_interned_tracepoint_info();
-    interned_tracepoint_info->set_key(tracepoint_key);
-    interned_tracepoint_info->set_allocated_intern(
-        full_tracepoint_event->release_tracepoint_info());
-    client_capture_event_collector_->AddEvent(std::move(event));
-  }
+  uint64_t tracepoint_key = tracepoint_pool_.GetOrAssignId(
+      {full_tracepoint_event->tracepoint_info().category(),
+       full_tracepoint_event->tracepoint_info().name()},
+      [this, full_tracepoint_event](uint64_t key) {
+        ClientCaptureEvent event;
+        InternedTracepointInfo* interned_tracepoint_info =
+            event.mutable_interned_tracepoint_info();
+        interned_tracepoint_info->set_key(key);
+        interned_tracepoint_info->set_allocated_intern(
+            full_tracepoint_event->release_tracepoint_info());
+        client_capture_event_collector_->AddEvent(std::move(event));
+      });
 
   ClientCaptureEvent event;
   TracepointEvent* tracepoint_event = event.mutable_tracepoint_event();
@@ -475,11 +520,15 @@ void ProducerEventProcessorImpl::ProcessFunctionCallAndTransferOwnership(
 void ProducerEventProcessorImpl::ProcessGpuQueueSubmissionAndTransferOwnership(
     uint64_t producer_id, GpuQueueSubmission* gpu_queue_submission) {
   // Translate debug marker keys
-  for (GpuDebugMarker& mutable_marker : *gpu_queue_submission->mutable_completed_markers()) {
-    auto it = producer_interned_string_id_to_client_string_id_.find(
-        {producer_id, mutable_marker.text_key()});
-    ORBIT_CHECK(it != producer_interned_string_id_to_client_string_id_.end());
-    mutable_marker.set_text_key(it->second);
+  if (!gpu_queue_submission->completed_markers().empty()) {
+    ProducerState& producer_state = GetOrCreateProducerState(producer_id);
+    absl::MutexLock lock{&producer_state.mutex};
+    for (GpuDebugMarker& mutable_marker : *gpu_queue_submission->mutable_completed_markers()) {
+      auto it = producer_state.interned_string_id_to_client_string_id.find(
+          mutable_marker.text_key());
+      ORBIT_CHECK(it != producer_state.interned_string_id_to_client_string_id.end());
+      mutable_marker.set_text_key(it->second);
+    }
   }
 
   ClientCaptureEvent event;
@@ -489,48 +538,46 @@ void ProducerEventProcessorImpl::ProcessGpuQueueSubmissionAndTransferOwnership(
 
 void ProducerEventProcessorImpl::ProcessInternedCallstack(uint64_t producer_id,
                                                           InternedCallstack* interned_callstack) {
+  ProducerState& producer_state = GetOrCreateProducerState(producer_id);
+  absl::MutexLock lock{&producer_state.mutex};
   // TODO(b/180235290): replace with error message
-  ORBIT_CHECK(!producer_interned_callstack_id_to_client_callstack_id_.contains(
-      {producer_id, interned_callstack->key()}));
-
-  std::pair<std::vector<uint64_t>, Callstack::CallstackType> callstack_data{
-      {interned_callstack->intern().pcs().begin(), interned_callstack->intern().pcs().end()},
-      interned_callstack->intern().type()};
-  auto [interned_callstack_id, assigned] = callstack_pool_.GetOrAssignId(callstack_data);
-
-  producer_interned_callstack_id_to_client_callstack_id_.insert_or_assign(
-      {producer_id, interned_callstack->key()}, interned_callstack_id);
-
-  if (!assigned) {
-    return;
-  }
+  ORBIT_CHECK(!producer_state.interned_callstack_id_to_client_callstack_id.contains(
+      interned_callstack->key()));
+  const uint64_t producer_callstack_id = interned_callstack->key();
 
   // If this is first time we see it -> send it over with client_id
-  interned_callstack->set_key(interned_callstack_id);
-  ClientCaptureEvent event;
-  *event.mutable_interned_callstack() = std::move(*interned_callstack);
-  client_capture_event_collector_->AddEvent(std::move(event));
+  uint64_t interned_callstack_id = callstack_pool_.GetOrAssignId(
+      ToCallstackView(interned_callstack->intern()),
+      [this, interned_callstack](uint64_t new_callstack_id) {
+        interned_callstack->set_key(new_callstack_id);
+        ClientCaptureEvent event;
+        *event.mutable_interned_callstack() = std::move(*interned_callstack);
+        client_capture_event_collector_->AddEvent(std::move(event));
+      });
+
+  producer_state.interned_callstack_id_to_client_callstack_id.insert_or_assign(
+      producer_callstack_id, interned_callstack_id);
 }
 
 void ProducerEventProcessorImpl::ProcessInternedString(uint64_t producer_id,
                                                        InternedString* interned_string) {
+  ProducerState& producer_state = GetOrCreateProducerState(producer_id);
+  absl::MutexLock lock{&producer_state.mutex};
   // TODO(b/180235290): replace with error message
-  ORBIT_CHECK(!producer_interned_string_id_to_client_string_id_.contains(
-      {producer_id, interned_string->key()}));
-
-  auto [client_string_id, assigned] = string_pool_.GetOrAssignId(interned_string->intern());
-  producer_interned_string_id_to_client_string_id_.insert_or_assign(
-      {producer_id, interned_string->key()}, client_string_id);
-
-  if (!assigned) {
-    return;
-  }
+  ORBIT_CHECK(
+      !producer_state.interned_string_id_to_client_string_id.contains(interned_string->key()));
+  const uint64_t producer_string_id = interned_string->key();
 
-  interned_string->set_key(client_string_id);
+  uint64_t client_string_id = string_pool_.GetOrAssignId(
+      interned_string->intern(), [this, interned_string](uint64_t new_string_id) {
+        interned_string->set_key(new_string_id);
+        ClientCaptureEvent event;
+        *event.mutable_interned_string() = std::move(*interned_string);
+        client_capture_event_collector_->AddEvent(std::move(event));
+      });
 
-  ClientCaptureEvent event;
-  *event.mutable_interned_string() = std::move(*interned_string);
-  client_capture_event_collector_->AddEvent(std::move(event));
+  producer_state.interned_string_id_to_client_string_id.insert_or_assign(producer_string_id,
+                                                                         client_string_id);
 }
 
 void ProducerEventProcessorImpl::ProcessLostPerfRecordsEventAndTransferOwnership(
@@ -626,21 +673,18 @@ void ProducerEventProcessorImpl::ProcessWarningInstrumentingWithUprobesEventAndT
 void ProducerEventProcessorImpl::ProcessThreadStateSliceCallstack(
     ThreadStateSliceCallstack* thread_state_slice_callstack) {
   const Callstack& callstack = thread_state_slice_callstack->callstack();
-
-  std::pair<std::vector<uint64_t>, Callstack::CallstackType> callstack_data{
-      {callstack.pcs().begin(), callstack.pcs().end()}, callstack.type()};
-  auto [callstack_id, assigned] = callstack_pool_.GetOrAssignId(callstack_data);
-
-  if (assigned) {
-    ClientCaptureEvent interned_callstack_event;
-    interned_callstack_event.mutable_interned_callstack()->set_key(callstack_id);
-    interned_callstack_event.mutable_interned_callstack()->set_allocated_intern(
-        thread_state_slice_callstack->release_callstack());
-    client_capture_event_collector_->AddEvent(std::move(interned_callstack_event));
-  }
+  uint64_t callstack_id = callstack_pool_.GetOrAssignId(
+      ToCallstackView(callstack), [this, thread_state_slice_callstack](uint64_t new_callstack_id) {
+        ClientCaptureEvent interned_callstack_event;
+        interned_callstack_event.mutable_interned_callstack()->set_key(new_callstack_id);
+        interned_callstack_event.mutable_interned_callstack()->set_allocated_intern(
+            thread_state_slice_callstack->release_callstack());
+        client_capture_event_collector_->AddEvent(std::move(interned_callstack_event));
+      });
 
   // We are sending the callstack right away (if necessary) and only keep the callstack id to attach
   // it to the matching thread state slice.
+  absl::MutexLock lock{&thread_state_slice_mutex_};
   thread_state_slice_tid_and_begin_timestamp_to_callstack_id_[{
       thread_state_slice_callstack->thread_state_slice_tid(),
       thread_state_slice_callstack->timestamp_ns()}] = callstack_id;
@@ -0,0 +1,133 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/strings/str_format.h>
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "BenchmarkUtils/AllocationCounter.h"
+#include "GrpcProtos/capture.pb.h"
+#include "ProducerEventProcessor/ClientCaptureEventCollector.h"
+#include "ProducerEventProcessor/ProducerEventProcessor.h"
+
+namespace orbit_producer_event_processor {
+
+namespace {
+
+using orbit_grpc_protos::ClientCaptureEvent;
+using orbit_grpc_protos::ProducerCaptureEvent;
+
+class NoOpClientCaptureEventCollector : public ClientCaptureEventCollector {
+ public:
+  void AddEvent(ClientCaptureEvent&& event) override {
+    benchmark::DoNotOptimize(event);
+    ++event_count_;
+  }
+  void StopAndWait() override {}
+
+  [[nodiscard]] uint64_t GetEventCount() const { return event_count_; }
+
+ private:
+  uint64_t event_count_ = 0;
+};
+
+constexpr uint64_t kProducerId = 1;
+constexpr int kEventsPerBatch = 1024;
+constexpr uint32_t kPid = 42;
+constexpr uint64_t kFramesPerCallstack = 16;
+
+// Runs batches of events created by `create_event(event_index)` through a ProducerEventProcessor.
+// The events are created outside of the timed region, as they come from the producers.
+template <typename CreateEvent>
+void RunProducerEventProcessorBenchmark(benchmark::State& state, CreateEvent create_event) {
+  NoOpClientCaptureEventCollector collector;
+  std::unique_ptr<ProducerEventProcessor> producer_event_processor =
+      ProducerEventProcessor::Create(&collector);
+
+  orbit_benchmark_utils::AllocationCounter allocation_counter;
+  uint64_t event_index = 0;
+  std::vector<ProducerCaptureEvent> events;
+  events.reserve(kEventsPerBatch);
+  for (auto _ : state) {
+    state.PauseTiming();
+    allocation_counter.Pause();
+    events.clear();
+    for (int i = 0; i < kEventsPerBatch; ++i) {
+      events.push_back(create_event(event_index++));
+    }
+    allocation_counter.Resume();
+    state.ResumeTiming();
+
+    for (ProducerCaptureEvent& event : events) {
+      producer_event_processor->ProcessEvent(kProducerId, std::move(event));
+    }
+  }
+
+  allocation_counter.Report(state, static_cast<int64_t>(event_index));
+  state.counters["client_events"] = static_cast<double>(collector.GetEventCount());
+}
+
+// The argument is the number of distinct callstacks, which determines how often a new callstack
+// needs to be interned.
+void BM_ProcessFullCallstackSamples(benchmark::State& state) {
+  const auto distinct_callstack_count = static_cast<uint64_t>(state.range(0));
+  RunProducerEventProcessorBenchmark(state, [distinct_callstack_count](uint64_t event_index) {
+    ProducerCaptureEvent event;
+    orbit_grpc_protos::FullCallstackSample* sample = event.mutable_full_callstack_sample();
+    sample->set_pid(kPid);
+    sample->set_tid(kPid + event_index % 8);
+    sample->set_timestamp_ns(event_index);
+    orbit_grpc_protos::Callstack* callstack = sample->mutable_callstack();
+    callstack->set_type(orbit_grpc_protos::Callstack::kComplete);
+    const uint64_t callstack_index = event_index % distinct_callstack_count;
+    for (uint64_t frame = 0; frame < kFramesPerCallstack; ++frame) {
+      callstack->add_pcs(0x100000 + callstack_index * 0x1000 + frame * 0x10);
+    }
+    return event;
+  });
+}
+
+BENCHMARK(BM_ProcessFullCallstackSamples)->Arg(16)->Arg(1024)->Arg(1 << 20);
+
+// The argument is the number of distinct function names, which determines how often a new string
+// needs to be interned.
+void BM_ProcessFullAddressInfos(benchmark::State& state) {
+  const auto distinct_function_count = static_cast<uint64_t>(state.range(0));
+  RunProducerEventProcessorBenchmark(state, [distinct_function_count](uint64_t event_index) {
+    ProducerCaptureEvent event;
+    orbit_grpc_protos::FullAddressInfo* address_info = event.mutable_full_address_info();
+    const uint64_t function_index = event_index % distinct_function_count;
+    address_info->set_absolute_address(0x100000 + function_index * 0x10);
+    address_info->set_function_name(
+        absl::StrFormat("orbit_namespace::SomeClass::SomeFunction%u(int, int)", function_index));
+    address_info->set_offset_in_function(0);
+    address_info->set_module_name("/path/to/module.so");
+    return event;
+  });
+}
+
+BENCHMARK(BM_ProcessFullAddressInfos)->Arg(16)->Arg(1 << 20);
+
+void BM_ProcessSchedulingSlices(benchmark::State& state) {
+  RunProducerEventProcessorBenchmark(state, [](uint64_t event_index) {
+    ProducerCaptureEvent event;
+    orbit_grpc_protos::SchedulingSlice* scheduling_slice = event.mutable_scheduling_slice();
+    scheduling_slice->set_pid(kPid);
+    scheduling_slice->set_tid(kPid + event_index % 8);
+    scheduling_slice->set_core(event_index % 16);
+    scheduling_slice->set_duration_ns(1'000);
+    scheduling_slice->set_out_timestamp_ns(event_index * 1'000);
+    return event;
+  });
+}
+
+BENCHMARK(BM_ProcessSchedulingSlices);
+
+}  // namespace
+
+}  // namespace orbit_producer_event_processor
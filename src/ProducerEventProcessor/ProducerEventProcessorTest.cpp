@@ -2,6 +2,8 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <absl/container/flat_hash_set.h>
+#include <absl/synchronization/mutex.h>
 #include <gmock/gmock.h>
 #include <google/protobuf/stubs/port.h>
 #include <google/protobuf/util/message_differencer.h>
@@ -12,6 +14,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -2345,4 +2348,68 @@ TEST(ProducerEventProcessor, OutOfOrderEventsDiscardedEvent) {
   EXPECT_EQ(actual_out_of_order_events_discarded_event.end_timestamp_ns(), kTimestampNs1);
 }
 
+TEST(ProducerEventProcessor, InternedCallstacksPrecedeTheirUsesWithConcurrentProducers) {
+  MockClientCaptureEventCollector collector;
+  auto producer_event_processor = ProducerEventProcessor::Create(&collector);
+
+  absl::Mutex client_capture_events_mutex;
+  std::vector<ClientCaptureEvent> client_capture_events;
+  EXPECT_CALL(collector, AddEvent)
+      .WillRepeatedly([&client_capture_events_mutex,
+                       &client_capture_events](ClientCaptureEvent&& event) {
+        absl::MutexLock lock{&client_capture_events_mutex};
+        client_capture_events.push_back(std::move(event));
+      });
+
+  // All producers send the same callstacks, under different producer keys, from different threads.
+  constexpr uint64_t kProducerCount = 4;
+  constexpr uint64_t kCallstackCount = 1000;
+  std::vector<std::thread> threads;
+  for (uint64_t producer_id = 1; producer_id <= kProducerCount; ++producer_id) {
+    threads.emplace_back([&producer_event_processor, producer_id] {
+      for (uint64_t i = 0; i < kCallstackCount; ++i) {
+        const uint64_t producer_callstack_key = producer_id * kCallstackCount + i;
+        ProducerCaptureEvent interned_callstack_event;
+        InternedCallstack* interned_callstack =
+            interned_callstack_event.mutable_interned_callstack();
+        interned_callstack->set_key(producer_callstack_key);
+        interned_callstack->mutable_intern()->add_pcs(i);
+        interned_callstack->mutable_intern()->set_type(Callstack::kComplete);
+        producer_event_processor->ProcessEvent(producer_id, std::move(interned_callstack_event));
+
+        ProducerCaptureEvent callstack_sample_event;
+        callstack_sample_event.mutable_callstack_sample()->set_callstack_id(
+            producer_callstack_key);
+        producer_event_processor->ProcessEvent(producer_id, std::move(callstack_sample_event));
+
+        ProducerCaptureEvent full_callstack_sample_event;
+        Callstack* callstack =
+            full_callstack_sample_event.mutable_full_callstack_sample()->mutable_callstack();
+        callstack->add_pcs(i);
+        callstack->add_pcs(i);
+        callstack->set_type(Callstack::kComplete);
+        producer_event_processor->ProcessEvent(producer_id,
+                                               std::move(full_callstack_sample_event));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  absl::flat_hash_set<uint64_t> sent_callstack_ids;
+  uint64_t callstack_sample_count = 0;
+  for (const ClientCaptureEvent& event : client_capture_events) {
+    if (event.event_case() == ClientCaptureEvent::kInternedCallstack) {
+      EXPECT_TRUE(sent_callstack_ids.insert(event.interned_callstack().key()).second);
+    } else {
+      ASSERT_EQ(event.event_case(), ClientCaptureEvent::kCallstackSample);
+      EXPECT_TRUE(sent_callstack_ids.contains(event.callstack_sample().callstack_id()));
+      ++callstack_sample_count;
+    }
+  }
+  EXPECT_EQ(sent_callstack_ids.size(), 2 * kCallstackCount);
+  EXPECT_EQ(callstack_sample_count, 2 * kProducerCount * kCallstackCount);
+}
+
 }  // namespace orbit_producer_event_processor
\ No newline at end of file
@@ -7,29 +7,79 @@
 
 #include <absl/base/thread_annotations.h>
 #include <absl/synchronization/mutex.h>
+#include <absl/time/time.h>
 #include <google/protobuf/arena.h>
 #include <grpcpp/grpcpp.h>
 #include <grpcpp/impl/codegen/sync_stream.h>
 #include <grpcpp/support/sync_stream.h>
 #include <stdint.h>
 
+#include <atomic>
 #include <memory>
 #include <thread>
 #include <vector>
 
 #include "GrpcProtos/capture.pb.h"
 #include "GrpcProtos/services.pb.h"
+#include "ProducerEventProcessor/MpscQueue.h"
 #include "ProducerEventProcessor/ClientCaptureEventCollector.h"
 
 namespace orbit_producer_event_processor {
 
 // This class receives the ClientCaptureEvents emitted by a ProducerEventProcessor and continuously
 // sends them to the client buffered in CaptureResponses.
+//
+// AddEvent doesn't take any lock: events from all threads are merged through a lock-free queue, in
+// an order consistent with the order in which AddEvent was called across threads, and are only
+// moved into CaptureResponses on the sender thread. This way, threads adding events concurrently
+// don't wait for each other, nor for the serialization of the events.
+//
+// The size of the CaptureResponses adapts to the throughput of the connection, so that about one
+// CaptureResponse is sent per `Options::max_send_latency`. If the client doesn't keep up, the
+// queued events can be limited to a memory budget by dropping some kinds of events, according to
+// `Options::drop_policy`. The client is notified of dropped events with WarningEvents. About once
+// per second, a CaptureResponse also carries EventSendingStats, with the number of queued events
+// and how long sending takes.
 class GrpcClientCaptureEventCollector final : public ClientCaptureEventCollector {
  public:
+  enum class DropPolicy {
+    // Events are never dropped: the memory used by queued events is unbounded.
+    kNeverDrop,
+    // CallstackSamples are dropped while the budget is exceeded.
+    kDropCallstackSamples,
+    // CallstackSamples are dropped while the budget is exceeded, and SchedulingSlices,
+    // ThreadStateSlices, TracepointEvents and MemoryUsageEvents too while it is exceeded twice.
+    kDropCallstackSamplesThenSystemEvents,
+  };
+
+  struct Options {
+    // Queued events are sent at least this often.
+    absl::Duration max_send_latency = absl::Milliseconds(20);
+    // Bounds of the target byte size of a CaptureResponse.
+    uint64_t min_capture_response_bytes = 64 * 1024;
+    uint64_t max_capture_response_bytes = 8 * 1024 * 1024;
+    // Serialized size of the queued events above which events are dropped as per `drop_policy`.
+    // Events that are never dropped, e.g., interned callstacks and strings, can still exceed it.
+    uint64_t memory_budget_bytes = 256 * 1024 * 1024;
+    DropPolicy drop_policy = DropPolicy::kNeverDrop;
+  };
+
+  // Returns the default Options, overridden with what the client asked for in `capture_request`.
+  [[nodiscard]] static Options GetOptionsFromCaptureRequest(
+      const orbit_grpc_protos::CaptureRequest& capture_request);
+
   explicit GrpcClientCaptureEventCollector(
       grpc::ServerReaderWriterInterface<orbit_grpc_protos::CaptureResponse,
                                         orbit_grpc_protos::CaptureRequest>* reader_writer);
+  GrpcClientCaptureEventCollector(
+      grpc::ServerReaderWriterInterface<orbit_grpc_protos::CaptureResponse,
+                                        orbit_grpc_protos::CaptureRequest>* reader_writer,
+      Options options);
+
+  // Sends the SchedulingSlices, CallstackSamples and FunctionCalls in the columnar, delta-encoded
+  // PackedCaptureEvents, as requested with CaptureRequest::kPackedCaptureEvents. Call it before the
+  // first event is added.
+  void EnablePackedCaptureEvents() { pack_capture_events_ = true; }
 
   void AddEvent(orbit_grpc_protos::ClientCaptureEvent&& event) override;
 
@@ -38,25 +88,60 @@ class GrpcClientCaptureEventCollector final : public ClientCaptureEventCollector
   ~GrpcClientCaptureEventCollector() override;
 
  private:
+  struct QueuedEvent {
+    orbit_grpc_protos::ClientCaptureEvent event;
+    // The size of the event when serialized in a CaptureResponse.
+    uint64_t byte_size;
+  };
+
+  [[nodiscard]] bool ShouldDrop(const orbit_grpc_protos::ClientCaptureEvent& event,
+                                uint64_t queued_byte_count) const;
   void SenderThread();
+  // Adds a WarningEvent to `capture_responses_to_send_` if events were dropped since the last one.
+  void BuildDroppedEventsWarning(bool force);
+  // Sets EventSendingStats in the last of `capture_responses_to_send_` if the previous ones were
+  // sent long enough ago, or if `force`.
+  void AddEventSendingStats(bool force, uint64_t queued_event_count, uint64_t queued_byte_count);
+  // Moves the events queued so far into `capture_responses_to_send_`. If `stopped`, also waits for
+  // the events of the AddEvents still in progress.
+  void BuildCaptureResponsesFromQueuedEvents(bool stopped);
+  void AddToCaptureResponsesToSend(orbit_grpc_protos::ClientCaptureEvent&& event,
+                                   uint64_t byte_size);
+  // Adapts `target_capture_response_bytes_` to the throughput observed while sending.
+  void UpdateTargetCaptureResponseBytes(uint64_t bytes_sent, absl::Duration send_duration);
 
   grpc::ServerReaderWriterInterface<orbit_grpc_protos::CaptureResponse,
                                     orbit_grpc_protos::CaptureRequest>* reader_writer_;
+  const Options options_;
+  // Only used to wake up the sender thread, see SenderThread.
   absl::Mutex mutex_;
   std::thread sender_thread_;
-  bool stop_requested_ ABSL_GUARDED_BY(mutex_) = false;
-
-  std::unique_ptr<char[]> initial_block_of_first_arena_;
-  std::unique_ptr<char[]> initial_block_of_second_arena_;
-  std::unique_ptr<google::protobuf::Arena> arena_of_capture_responses_being_built_
-      ABSL_GUARDED_BY(mutex_);
-  std::vector<orbit_grpc_protos::CaptureResponse*> capture_responses_being_built_
-      ABSL_GUARDED_BY(mutex_);
+  std::atomic<bool> stop_requested_ = false;
+  std::atomic<bool> pack_capture_events_ = false;
+
+  MpscQueue<QueuedEvent> event_queue_;
+  // Also counts the events that AddEvent is about to push, see AddEvent.
+  std::atomic<uint64_t> queued_event_count_ = 0;
+  std::atomic<uint64_t> queued_byte_count_ = 0;
+  std::atomic<uint64_t> target_capture_response_bytes_;
+  std::atomic<uint64_t> dropped_callstack_sample_count_ = 0;
+  std::atomic<uint64_t> dropped_system_event_count_ = 0;
+
+  // Only accessed by the sender thread.
+  std::unique_ptr<char[]> initial_block_of_arena_;
   std::unique_ptr<google::protobuf::Arena> arena_of_capture_responses_to_send_;
   std::vector<orbit_grpc_protos::CaptureResponse*> capture_responses_to_send_;
+  uint64_t capture_response_being_built_byte_size_ = 0;
+  double send_throughput_bytes_per_second_ = 0.0;
+  uint64_t reported_dropped_event_count_ = 0;
+  absl::Time last_dropped_events_warning_time_ = absl::InfinitePast();
+  absl::Time last_event_sending_stats_time_ = absl::InfinitePast();
+  absl::Duration max_send_duration_since_event_sending_stats_ = absl::ZeroDuration();
 
   uint64_t total_number_of_events_sent_ = 0;
   uint64_t total_number_of_bytes_sent_ = 0;
+  uint64_t max_queued_byte_count_ = 0;
+  absl::Duration max_send_duration_ = absl::ZeroDuration();
 };
 
 }  // namespace orbit_producer_event_processor
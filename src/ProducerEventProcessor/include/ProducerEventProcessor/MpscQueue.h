@@ -0,0 +1,108 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PRODUCER_EVENT_PROCESSOR_MPSC_QUEUE_H_
+#define PRODUCER_EVENT_PROCESSOR_MPSC_QUEUE_H_
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_producer_event_processor {
+
+// Unbounded lock-free queue with multiple producers and a single consumer, after Dmitry Vyukov's
+// intrusive MPSC node-based queue.
+//
+// Push is wait-free: a single atomic exchange on the tail. As all pushes are serialized by that
+// exchange, elements are popped in an order consistent with happens-before across producer
+// threads: if a push on one thread happens before a push on another (for example because the two
+// threads synchronize through a mutex in between), the first element is popped first. This is what
+// moodycamel::ConcurrentQueue, which only preserves the order per producer, doesn't guarantee.
+//
+// TryPop must only be called from one thread at a time. It can return std::nullopt while a push is
+// in progress on another thread even if later pushes have already completed: the consumer just
+// needs to retry later.
+template <typename T>
+class MpscQueue {
+ public:
+  MpscQueue() : head_{&stub_}, tail_{&stub_} {}
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+  MpscQueue(MpscQueue&&) = delete;
+  MpscQueue& operator=(MpscQueue&&) = delete;
+
+  ~MpscQueue() {
+    while (TryPop().has_value()) {
+    }
+    // Only the stub is left, unless a push was still in progress, which would be a bug in the
+    // caller.
+    ORBIT_CHECK(head_ == &stub_);
+  }
+
+  void Push(T&& value) { PushNode(new Node{std::move(value)}); }
+
+  [[nodiscard]] std::optional<T> TryPop() {
+    Node* head = head_;
+    Node* next = head->next.load(std::memory_order_acquire);
+    if (head == &stub_) {
+      if (next == nullptr) return std::nullopt;
+      // Skip the stub node.
+      head_ = next;
+      head = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (next != nullptr) {
+      head_ = next;
+      return TakeValueAndDelete(head);
+    }
+    if (head != tail_.load(std::memory_order_acquire)) {
+      // A producer has exchanged the tail but not yet linked its node.
+      return std::nullopt;
+    }
+    // `head` is the last node: push the stub behind it so that `head` can be unlinked.
+    PushNode(&stub_);
+    next = head->next.load(std::memory_order_acquire);
+    if (next == nullptr) {
+      // Another producer pushed between our check of the tail and the push of the stub, and hasn't
+      // linked its node yet.
+      return std::nullopt;
+    }
+    head_ = next;
+    return TakeValueAndDelete(head);
+  }
+
+ private:
+  struct Node {
+    Node() = default;
+    explicit Node(T&& value) : value{std::move(value)} {}
+
+    std::atomic<Node*> next{nullptr};
+    std::optional<T> value;
+  };
+
+  void PushNode(Node* node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node* previous_tail = tail_.exchange(node, std::memory_order_acq_rel);
+    previous_tail->next.store(node, std::memory_order_release);
+  }
+
+  [[nodiscard]] static std::optional<T> TakeValueAndDelete(Node* node) {
+    std::optional<T> value = std::move(node->value);
+    delete node;
+    return value;
+  }
+
+  Node stub_;
+  // Only accessed by the consumer.
+  Node* head_;
+  // Aligned to the cache line size, so that pushes don't invalidate the line of the consumer.
+  alignas(64) std::atomic<Node*> tail_;
+};
+
+}  // namespace orbit_producer_event_processor
+
+#endif  // PRODUCER_EVENT_PROCESSOR_MPSC_QUEUE_H_
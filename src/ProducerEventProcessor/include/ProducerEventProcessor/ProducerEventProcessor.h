@@ -17,6 +17,8 @@ namespace orbit_producer_event_processor {
 // The implementation of this interface is responsible for processing
 // ProducerCaptureEvents from multiple producers.
 // It converts them to ClientCaptureEvents and sends to CaptureEventBuffer.
+// ProcessEvent can be called concurrently, also for the same producer. Events of different
+// producers are translated without waiting for each other.
 class ProducerEventProcessor {
  public:
   ProducerEventProcessor() = default;
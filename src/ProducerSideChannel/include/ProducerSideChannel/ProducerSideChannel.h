@@ -21,6 +21,11 @@ constexpr const char* kProducerSideWindowsServerAddress = "localhost:1789";
 // between producers of CaptureEvents and OrbitService.
 constexpr const char* kProducerSideUnixDomainSocketPath = "/tmp/orbit-producer-side-socket";
 
+// This is the default path of the Unix domain socket on which producers pass the file descriptors
+// of their shared memory ring buffers to OrbitService, see SharedMemoryFdPassing.h.
+constexpr const char* kProducerSideSharedMemoryFdUnixDomainSocketPath =
+    "/tmp/orbit-producer-side-shared-memory-fd-socket";
+
 // This function returns a gRPC channel that uses a Unix domain socket,
 // by default the one specified by kProducerSideUnixDomainSocketPath.
 inline std::shared_ptr<grpc::Channel> CreateProducerSideChannel(
@@ -15,13 +15,16 @@
 #include <string>
 #include <string_view>
 #include <system_error>
+#include <utility>
 
 #include "BuildAndStartProducerSideServerWithUri.h"
+#include "OrbitBase/Logging.h"
 #include "OrbitBase/Result.h"
 #include "OrbitBase/SafeStrerror.h"
 #include "ProducerSideChannel/ProducerSideChannel.h"
 #include "ProducerSideService/BuildAndStartProducerSideServer.h"
 #include "ProducerSideService/ProducerSideServer.h"
+#include "SharedMemoryTransport/SharedMemoryFdPassing.h"
 
 namespace orbit_producer_side_service {
 
@@ -65,10 +68,24 @@ ErrorMessageOr<std::unique_ptr<ProducerSideServer>> BuildAndStartProducerSideSer
   OUTCOME_TRY(
       VerifySocketAvailability(orbit_producer_side_channel::kProducerSideUnixDomainSocketPath));
 
+  // Producers can still send their events with gRPC if they can't pass their shared memory ring
+  // buffers.
+  std::unique_ptr<orbit_shared_memory_transport::SharedMemoryFdReceiver> shared_memory_fd_receiver;
+  ErrorMessageOr<std::unique_ptr<orbit_shared_memory_transport::SharedMemoryFdReceiver>>
+      shared_memory_fd_receiver_or_error =
+          orbit_shared_memory_transport::SharedMemoryFdReceiver::Create(
+              orbit_producer_side_channel::kProducerSideSharedMemoryFdUnixDomainSocketPath);
+  if (shared_memory_fd_receiver_or_error.has_error()) {
+    ORBIT_ERROR("Creating receiver of shared memory ring buffers: %s",
+                shared_memory_fd_receiver_or_error.error().message());
+  } else {
+    shared_memory_fd_receiver = std::move(shared_memory_fd_receiver_or_error.value());
+  }
+
   std::string unix_socket_path(orbit_producer_side_channel::kProducerSideUnixDomainSocketPath);
   std::string uri = absl::StrFormat("unix:%s", unix_socket_path);
   OUTCOME_TRY(std::unique_ptr<ProducerSideServer> producer_side_server,
-              BuildAndStartProducerSideServerWithUri(uri));
+              BuildAndStartProducerSideServerWithUri(uri, std::move(shared_memory_fd_receiver)));
 
   // When OrbitService runs as root, also allow non-root producers
   // (e.g., the game) to communicate over the Unix domain socket.
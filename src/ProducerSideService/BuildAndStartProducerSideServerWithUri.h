@@ -5,16 +5,22 @@
 #ifndef ORBIT_PRODUCER_SIDE_SERVICE_BUILD_AND_START_PRODUCER_SIDE_SERVER_WITH_URI_H_
 #define ORBIT_PRODUCER_SIDE_SERVICE_BUILD_AND_START_PRODUCER_SIDE_SERVER_WITH_URI_H_
 
+#include <memory>
+#include <string_view>
+#include <utility>
+
 #include "OrbitBase/Logging.h"
 #include "ProducerSideService/ProducerSideServer.h"
 
 namespace orbit_producer_side_service {
 
 inline ErrorMessageOr<std::unique_ptr<ProducerSideServer>> BuildAndStartProducerSideServerWithUri(
-    std::string_view uri) {
+    std::string_view uri,
+    std::unique_ptr<orbit_shared_memory_transport::SharedMemoryFdReceiver>
+        shared_memory_fd_receiver = nullptr) {
   auto producer_side_server = std::make_unique<ProducerSideServer>();
   ORBIT_LOG("Starting producer-side server at %s", uri);
-  if (!producer_side_server->BuildAndStart(uri)) {
+  if (!producer_side_server->BuildAndStart(uri, std::move(shared_memory_fd_receiver))) {
     return ErrorMessage{"Unable to start producer-side server."};
   }
   ORBIT_LOG("Producer-side server is running");
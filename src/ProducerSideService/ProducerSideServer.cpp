@@ -15,9 +15,15 @@
 
 namespace orbit_producer_side_service {
 
-bool ProducerSideServer::BuildAndStart(std::string_view uri) {
+bool ProducerSideServer::BuildAndStart(
+    std::string_view uri,
+    std::unique_ptr<orbit_shared_memory_transport::SharedMemoryFdReceiver>
+        shared_memory_fd_receiver) {
   ORBIT_CHECK(server_ == nullptr);
 
+  shared_memory_fd_receiver_ = std::move(shared_memory_fd_receiver);
+  producer_side_service_.SetSharedMemoryFdReceiver(shared_memory_fd_receiver_.get());
+
   grpc::ServerBuilder builder;
   builder.AddListeningPort(std::string{uri}, grpc::InsecureServerCredentials());
 
@@ -36,6 +42,8 @@ void ProducerSideServer::ShutdownAndWait() {
   producer_side_service_.OnExitRequest();
   server_->Shutdown();
   server_->Wait();
+  producer_side_service_.SetSharedMemoryFdReceiver(nullptr);
+  shared_memory_fd_receiver_ = nullptr;
 }
 
 void ProducerSideServer::OnCaptureStartRequested(
@@ -6,6 +6,7 @@
 
 #include <absl/synchronization/mutex.h>
 #include <absl/time/time.h>
+#include <absl/types/span.h>
 #include <google/protobuf/arena.h>
 #include <stddef.h>
 
@@ -16,6 +17,7 @@
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/MakeUniqueForOverwrite.h"
 #include "OrbitBase/ThreadUtils.h"
+#include "SharedMemoryEventReader.h"
 
 namespace orbit_producer_side_service {
 
@@ -373,6 +375,16 @@ void ProducerSideServiceImpl::ReceiveEventsThread(
   arena_options.start_block_size = kArenaFixedBlockSize;
   arena_options.max_block_size = kArenaFixedBlockSize;
 
+  // Only used if the producer writes its events to a shared memory ring buffer.
+  SharedMemoryEventReader shared_memory_event_reader{
+      [this, producer_id](absl::Span<ProducerCaptureEvent> events) {
+        absl::ReaderMutexLock lock{&producer_event_processor_mutex_};
+        if (producer_event_processor_ == nullptr) return;
+        for (ProducerCaptureEvent& event : events) {
+          producer_event_processor_->ProcessEvent(producer_id, std::move(event));
+        }
+      }};
+
   while (true) {
     google::protobuf::Arena arena{arena_options};
     auto* request = google::protobuf::Arena::CreateMessage<
@@ -402,8 +414,33 @@ void ProducerSideServiceImpl::ReceiveEventsThread(
         }
       } break;
 
+      case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::kSharedMemoryRingBuffer: {
+        // Only map a file descriptor that the producer passed itself, never one it designates.
+        std::optional<orbit_shared_memory_transport::SharedMemoryFdReceiver::ReceivedFd>
+            received_fd;
+        if (shared_memory_fd_receiver_ != nullptr) {
+          received_fd =
+              shared_memory_fd_receiver_->TakeFd(request->shared_memory_ring_buffer().token());
+        }
+        if (!received_fd.has_value()) {
+          ORBIT_ERROR("Refusing shared memory ring buffer of CaptureEventProducer: unknown token");
+          shared_memory_event_reader.StopUsingRingBuffer();
+          break;
+        }
+        ErrorMessageOr<void> result = shared_memory_event_reader.UseRingBuffer(
+            std::move(received_fd->fd), received_fd->pid,
+            request->shared_memory_ring_buffer().start_offset());
+        if (result.has_error()) {
+          ORBIT_ERROR("Using shared memory ring buffer of CaptureEventProducer: %s",
+                      result.error().message());
+        }
+      } break;
+
       case orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest::kAllEventsSent: {
         ORBIT_LOG("Received AllEventsSent from CaptureEventProducer");
+        // The producer has published all its events to the shared memory ring buffer, if any,
+        // before sending AllEventsSent.
+        shared_memory_event_reader.ReadPublishedEvents();
         absl::MutexLock lock{&service_state_mutex_};
         switch (service_state_.capture_status) {
           case CaptureStatus::kCaptureStarted: {
@@ -437,6 +474,7 @@ void ProducerSideServiceImpl::ReceiveEventsThread(
   }
 
   ORBIT_ERROR("Receiving ReceiveCommandsAndSendEventsRequest from CaptureEventProducer");
+  shared_memory_event_reader.ReadPublishedEvents();
   {
     absl::MutexLock lock{&service_state_mutex_};
     // Producer has disconnected: treat this as if it had sent all its CaptureEvents.
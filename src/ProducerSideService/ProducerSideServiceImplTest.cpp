@@ -9,6 +9,7 @@
 #include <grpcpp/support/channel_arguments.h>
 #include <gtest/gtest.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <chrono>
 #include <functional>
@@ -16,12 +17,18 @@
 #include <optional>
 #include <string>
 #include <thread>
+#include <utility>
 
 #include "GrpcProtos/capture.pb.h"
 #include "GrpcProtos/producer_side_services.grpc.pb.h"
 #include "GrpcProtos/producer_side_services.pb.h"
 #include "ProducerEventProcessor/ProducerEventProcessor.h"
 #include "ProducerSideService/ProducerSideServiceImpl.h"
+#include "SharedMemoryTransport/SharedMemoryFdPassing.h"
+#include "SharedMemoryTransport/SharedMemoryRecords.h"
+#include "SharedMemoryTransport/SharedMemoryRingBuffer.h"
+#include "TestUtils/TemporaryDirectory.h"
+#include "TestUtils/TestUtils.h"
 
 namespace orbit_producer_side_service {
 
@@ -91,6 +98,20 @@ class FakeProducer {
     }
   }
 
+  void SendSharedMemoryRingBuffer(uint64_t token, uint64_t start_offset) {
+    absl::ReaderMutexLock lock{&context_and_stream_mutex_};
+    ASSERT_NE(stream_, nullptr);
+    orbit_grpc_protos::ReceiveCommandsAndSendEventsRequest request;
+    request.mutable_shared_memory_ring_buffer()->set_token(token);
+    request.mutable_shared_memory_ring_buffer()->set_start_offset(start_offset);
+
+    {
+      absl::MutexLock write_lock{&exclusive_writes_mutex_};
+      bool written = stream_->Write(request);
+      EXPECT_TRUE(written);
+    }
+  }
+
   void SendAllEventsSent() {
     absl::ReaderMutexLock lock{&context_and_stream_mutex_};
     ASSERT_NE(stream_, nullptr);
@@ -154,6 +175,20 @@ class ProducerSideServiceImplTest : public ::testing::Test {
   void SetUp() override {
     service_.emplace();
 
+#ifdef __linux
+    auto temporary_directory_or_error = orbit_test_utils::TemporaryDirectory::Create();
+    ASSERT_THAT(temporary_directory_or_error, orbit_test_utils::HasNoError());
+    temporary_directory_.emplace(std::move(temporary_directory_or_error.value()));
+    shared_memory_fd_socket_path_ =
+        (temporary_directory_->GetDirectoryPath() / "shared_memory_fd_socket").string();
+    auto shared_memory_fd_receiver_or_error =
+        orbit_shared_memory_transport::SharedMemoryFdReceiver::Create(
+            shared_memory_fd_socket_path_);
+    ASSERT_THAT(shared_memory_fd_receiver_or_error, orbit_test_utils::HasNoError());
+    shared_memory_fd_receiver_ = std::move(shared_memory_fd_receiver_or_error.value());
+    service_->SetSharedMemoryFdReceiver(shared_memory_fd_receiver_.get());
+#endif
+
     grpc::ServerBuilder builder;
     builder.RegisterService(&*service_);
     fake_server_ = builder.BuildAndStart();
@@ -181,8 +216,12 @@ class ProducerSideServiceImplTest : public ::testing::Test {
 
     service_.reset();
     fake_server_.reset();
+    shared_memory_fd_receiver_.reset();
   }
 
+  std::optional<orbit_test_utils::TemporaryDirectory> temporary_directory_;
+  std::string shared_memory_fd_socket_path_;
+  std::unique_ptr<orbit_shared_memory_transport::SharedMemoryFdReceiver> shared_memory_fd_receiver_;
   std::optional<ProducerSideServiceImpl> service_;
   std::unique_ptr<grpc::Server> fake_server_;
   std::optional<FakeProducer> fake_producer_;
@@ -520,5 +559,113 @@ TEST_F(ProducerSideServiceImplTest, ProducerDisconnectsMidCapture) {
   ExpectDurationBetweenMs([this] { service_->OnCaptureStopRequested(); }, 0, 5);
 }
 
+#ifdef __linux
+TEST_F(ProducerSideServiceImplTest, EventsFromSharedMemoryRingBuffer) {
+  using orbit_shared_memory_transport::FunctionExitRecord;
+  using orbit_shared_memory_transport::SharedMemoryRecordType;
+  using orbit_shared_memory_transport::SharedMemoryRingBufferWriter;
+
+  MockProducerEventProcessor mock_processor;
+
+  EXPECT_CALL(*fake_producer_, OnStartCaptureCommandReceived(CaptureOptionsEq(kFakeCaptureOptions)))
+      .Times(1);
+  service_->OnCaptureStartRequested(kFakeCaptureOptions, &mock_processor);
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_producer_);
+
+  auto writer_or_error = SharedMemoryRingBufferWriter::Create(4096);
+  ASSERT_THAT(writer_or_error, orbit_test_utils::HasNoError());
+  SharedMemoryRingBufferWriter& writer = *writer_or_error.value();
+  auto write_function_exit = [&writer](uint64_t timestamp_ns) {
+    const FunctionExitRecord record{2, timestamp_ns};
+    char* payload = writer.TryBeginRecord(
+        static_cast<uint32_t>(SharedMemoryRecordType::kFunctionExit), sizeof(record));
+    ASSERT_NE(payload, nullptr);
+    memcpy(payload, &record, sizeof(record));
+    writer.EndRecord();
+  };
+
+  // This event precedes the start offset, so it belongs to a previous capture.
+  write_function_exit(0);
+  writer.Publish();
+  const uint64_t start_offset = writer.GetWriteOffset();
+
+  const auto is_function_exit_of_this_capture = ::testing::Property(
+      &orbit_grpc_protos::ProducerCaptureEvent::function_exit,
+      ::testing::Property(&orbit_grpc_protos::FunctionExit::timestamp_ns, ::testing::Gt(0)));
+  EXPECT_CALL(mock_processor, ProcessEvent(::testing::_, is_function_exit_of_this_capture))
+      .Times(4);
+  auto token_or_error =
+      orbit_shared_memory_transport::SendSharedMemoryFd(shared_memory_fd_socket_path_, writer.fd());
+  ASSERT_THAT(token_or_error, orbit_test_utils::HasNoError());
+  fake_producer_->SendSharedMemoryRingBuffer(token_or_error.value(), start_offset);
+  write_function_exit(1);
+  write_function_exit(2);
+  writer.Publish();
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  // These events are only published when stopping, and must be read before the capture finishes.
+  write_function_exit(3);
+  write_function_exit(4);
+  ON_CALL(*fake_producer_, OnStopCaptureCommandReceived).WillByDefault([this, &writer] {
+    writer.Publish();
+    fake_producer_->SendAllEventsSent();
+  });
+  {
+    ::testing::InSequence in_sequence;
+    EXPECT_CALL(*fake_producer_, OnStopCaptureCommandReceived).Times(1);
+    EXPECT_CALL(*fake_producer_, OnCaptureFinishedCommandReceived).Times(1);
+  }
+  service_->OnCaptureStopRequested();
+  ::testing::Mock::VerifyAndClearExpectations(&mock_processor);
+}
+
+TEST_F(ProducerSideServiceImplTest, SharedMemoryRingBufferWithUnknownTokenIsRefused) {
+  using orbit_shared_memory_transport::FunctionExitRecord;
+  using orbit_shared_memory_transport::SharedMemoryRecordType;
+  using orbit_shared_memory_transport::SharedMemoryRingBufferWriter;
+
+  MockProducerEventProcessor mock_processor;
+
+  EXPECT_CALL(*fake_producer_, OnStartCaptureCommandReceived(CaptureOptionsEq(kFakeCaptureOptions)))
+      .Times(1);
+  service_->OnCaptureStartRequested(kFakeCaptureOptions, &mock_processor);
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ::testing::Mock::VerifyAndClearExpectations(&*fake_producer_);
+
+  auto writer_or_error = SharedMemoryRingBufferWriter::Create(4096);
+  ASSERT_THAT(writer_or_error, orbit_test_utils::HasNoError());
+  SharedMemoryRingBufferWriter& writer = *writer_or_error.value();
+  const FunctionExitRecord record{2, 3};
+  char* payload = writer.TryBeginRecord(
+      static_cast<uint32_t>(SharedMemoryRecordType::kFunctionExit), sizeof(record));
+  ASSERT_NE(payload, nullptr);
+  memcpy(payload, &record, sizeof(record));
+  writer.EndRecord();
+
+  // The file descriptor was passed, but the producer designates another one.
+  auto token_or_error =
+      orbit_shared_memory_transport::SendSharedMemoryFd(shared_memory_fd_socket_path_, writer.fd());
+  ASSERT_THAT(token_or_error, orbit_test_utils::HasNoError());
+  EXPECT_CALL(mock_processor, ProcessEvent).Times(0);
+  fake_producer_->SendSharedMemoryRingBuffer(token_or_error.value() + 1, 0);
+  writer.Publish();
+  std::this_thread::sleep_for(kWaitMessagesSentDuration);
+
+  ON_CALL(*fake_producer_, OnStopCaptureCommandReceived).WillByDefault([this] {
+    fake_producer_->SendAllEventsSent();
+  });
+  {
+    ::testing::InSequence in_sequence;
+    EXPECT_CALL(*fake_producer_, OnStopCaptureCommandReceived).Times(1);
+    EXPECT_CALL(*fake_producer_, OnCaptureFinishedCommandReceived).Times(1);
+  }
+  service_->OnCaptureStopRequested();
+  ::testing::Mock::VerifyAndClearExpectations(&mock_processor);
+}
+#endif
+
 }  // namespace
 }  // namespace orbit_producer_side_service
@@ -0,0 +1,102 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "SharedMemoryEventReader.h"
+
+#include <absl/time/time.h>
+
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/ThreadUtils.h"
+#include "SharedMemoryTransport/SharedMemoryRecords.h"
+
+namespace orbit_producer_side_service {
+
+using orbit_shared_memory_transport::SharedMemoryRingBufferReader;
+
+SharedMemoryEventReader::~SharedMemoryEventReader() {
+  {
+    absl::MutexLock lock{&mutex_};
+    exit_requested_ = true;
+  }
+  if (read_thread_.joinable()) {
+    read_thread_.join();
+  }
+}
+
+ErrorMessageOr<void> SharedMemoryEventReader::UseRingBuffer(orbit_base::UniqueFd fd, uint32_t pid,
+                                                            uint64_t start_offset) {
+  absl::MutexLock lock{&mutex_};
+  ReadPublishedEventsLocked();
+  // The file descriptor is passed again for every capture, so always map it anew.
+  ring_buffer_ = nullptr;
+  OUTCOME_TRY(ring_buffer_, SharedMemoryRingBufferReader::OpenFromFd(std::move(fd)));
+  pid_ = pid;
+  ORBIT_LOG("Reading CaptureEvents from shared memory ring buffer of process %u", pid_);
+
+  // Discard what is left from previous captures.
+  if (ErrorMessageOr<void> result = ring_buffer_->SkipTo(start_offset);
+      result.has_error()) {
+    ring_buffer_ = nullptr;
+    return result.error();
+  }
+
+  if (!read_thread_.joinable()) {
+    read_thread_ = std::thread{&SharedMemoryEventReader::ReadThread, this};
+  }
+  return outcome::success();
+}
+
+void SharedMemoryEventReader::StopUsingRingBuffer() {
+  absl::MutexLock lock{&mutex_};
+  ReadPublishedEventsLocked();
+  ring_buffer_ = nullptr;
+}
+
+void SharedMemoryEventReader::ReadPublishedEvents() {
+  absl::MutexLock lock{&mutex_};
+  ReadPublishedEventsLocked();
+}
+
+void SharedMemoryEventReader::ReadThread() {
+  orbit_base::SetCurrentThreadName("PSSI::ShmEvents");
+  constexpr absl::Duration kReadInterval = absl::Milliseconds(1);
+  absl::MutexLock lock{&mutex_};
+  while (!mutex_.AwaitWithTimeout(absl::Condition(&exit_requested_), kReadInterval)) {
+    ReadPublishedEventsLocked();
+  }
+}
+
+void SharedMemoryEventReader::ReadPublishedEventsLocked() {
+  if (ring_buffer_ == nullptr) return;
+
+  events_.clear();
+  uint64_t invalid_record_count = 0;
+  ErrorMessageOr<size_t> record_count_or_error = ring_buffer_->ReadRecords(
+      [this, &invalid_record_count](uint32_t type, absl::Span<const char> payload) {
+        orbit_grpc_protos::ProducerCaptureEvent& event = events_.emplace_back();
+        if (orbit_shared_memory_transport::DecodeSharedMemoryRecord(type, payload, pid_, &event)
+                .has_error()) {
+          events_.pop_back();
+          ++invalid_record_count;
+        }
+      });
+  if (invalid_record_count > 0) {
+    ORBIT_ERROR("Discarded %u invalid records from shared memory ring buffer of process %u",
+                invalid_record_count, pid_);
+  }
+  if (record_count_or_error.has_error()) {
+    // The ring buffer is corrupted: stop reading from it.
+    ORBIT_ERROR("Reading shared memory ring buffer of process %u: %s", pid_,
+                record_count_or_error.error().message());
+    ring_buffer_ = nullptr;
+  }
+
+  if (!events_.empty()) {
+    process_events_(absl::MakeSpan(events_));
+  }
+}
+
+}  // namespace orbit_producer_side_service
@@ -0,0 +1,70 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PRODUCER_SIDE_SERVICE_SHARED_MEMORY_EVENT_READER_H_
+#define PRODUCER_SIDE_SERVICE_SHARED_MEMORY_EVENT_READER_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/synchronization/mutex.h>
+#include <absl/types/span.h>
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "GrpcProtos/capture.pb.h"
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+#include "SharedMemoryTransport/SharedMemoryRingBuffer.h"
+
+namespace orbit_producer_side_service {
+
+// Reads the events that a producer writes to its shared memory ring buffer instead of sending
+// them over gRPC, and passes them to `process_events`. The ring buffer is read periodically by a
+// thread, and on demand with ReadPublishedEvents, e.g., when the producer has sent AllEventsSent.
+class SharedMemoryEventReader {
+ public:
+  using ProcessEventsCallback =
+      std::function<void(absl::Span<orbit_grpc_protos::ProducerCaptureEvent> events)>;
+
+  explicit SharedMemoryEventReader(ProcessEventsCallback process_events)
+      : process_events_{std::move(process_events)} {}
+  ~SharedMemoryEventReader();
+
+  SharedMemoryEventReader(const SharedMemoryEventReader&) = delete;
+  SharedMemoryEventReader& operator=(const SharedMemoryEventReader&) = delete;
+  SharedMemoryEventReader(SharedMemoryEventReader&&) = delete;
+  SharedMemoryEventReader& operator=(SharedMemoryEventReader&&) = delete;
+
+  // Starts reading from the ring buffer in the shared memory region `fd`, which process `pid`
+  // passed, from `start_offset`. The events still in the previous ring buffer are read first.
+  [[nodiscard]] ErrorMessageOr<void> UseRingBuffer(orbit_base::UniqueFd fd, uint32_t pid,
+                                                   uint64_t start_offset);
+
+  // Reads the events still in the ring buffer, then stops reading from it.
+  void StopUsingRingBuffer();
+
+  void ReadPublishedEvents();
+
+ private:
+  void ReadThread();
+  void ReadPublishedEventsLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  ProcessEventsCallback process_events_;
+
+  absl::Mutex mutex_;
+  std::unique_ptr<orbit_shared_memory_transport::SharedMemoryRingBufferReader> ring_buffer_
+      ABSL_GUARDED_BY(mutex_);
+  uint32_t pid_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::vector<orbit_grpc_protos::ProducerCaptureEvent> events_ ABSL_GUARDED_BY(mutex_);
+  bool exit_requested_ ABSL_GUARDED_BY(mutex_) = false;
+
+  std::thread read_thread_;
+};
+
+}  // namespace orbit_producer_side_service
+
+#endif  // PRODUCER_SIDE_SERVICE_SHARED_MEMORY_EVENT_READER_H_
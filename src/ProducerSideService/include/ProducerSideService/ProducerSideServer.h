@@ -15,6 +15,7 @@
 #include "GrpcProtos/capture.pb.h"
 #include "ProducerEventProcessor/ProducerEventProcessor.h"
 #include "ProducerSideService/ProducerSideServiceImpl.h"
+#include "SharedMemoryTransport/SharedMemoryFdPassing.h"
 
 namespace orbit_producer_side_service {
 
@@ -22,7 +23,11 @@ namespace orbit_producer_side_service {
 // and listens on a socket.
 class ProducerSideServer final : public orbit_capture_service_base::CaptureStartStopListener {
  public:
-  bool BuildAndStart(std::string_view uri);
+  // Producers can pass the file descriptors of their shared memory ring buffers to
+  // `shared_memory_fd_receiver`, if any.
+  bool BuildAndStart(std::string_view uri,
+                     std::unique_ptr<orbit_shared_memory_transport::SharedMemoryFdReceiver>
+                         shared_memory_fd_receiver = nullptr);
   void ShutdownAndWait();
 
   void OnCaptureStartRequested(
@@ -31,6 +36,8 @@ class ProducerSideServer final : public orbit_capture_service_base::CaptureStart
   void OnCaptureStopRequested() override;
 
  private:
+  std::unique_ptr<orbit_shared_memory_transport::SharedMemoryFdReceiver>
+      shared_memory_fd_receiver_;
   ProducerSideServiceImpl producer_side_service_;
   std::unique_ptr<grpc::Server> server_;
 };
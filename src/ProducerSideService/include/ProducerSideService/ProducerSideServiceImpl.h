@@ -20,6 +20,7 @@
 #include "GrpcProtos/producer_side_services.grpc.pb.h"
 #include "GrpcProtos/producer_side_services.pb.h"
 #include "ProducerEventProcessor/ProducerEventProcessor.h"
+#include "SharedMemoryTransport/SharedMemoryFdPassing.h"
 
 namespace orbit_producer_side_service {
 
@@ -52,6 +53,14 @@ class ProducerSideServiceImpl final : public orbit_grpc_protos::ProducerSideServ
   // until all CaptureEvents have been sent by the producers. The default is 10 seconds.
   void SetMaxWaitForAllCaptureEventsMs(uint64_t ms) { max_wait_for_all_events_sent_ms_ = ms; }
 
+  // Producers that write their CaptureEvents to a shared memory ring buffer pass its file
+  // descriptor to `shared_memory_fd_receiver`. Without it, such ring buffers are refused. This
+  // must be called before producers connect, and `shared_memory_fd_receiver` must outlive them.
+  void SetSharedMemoryFdReceiver(
+      orbit_shared_memory_transport::SharedMemoryFdReceiver* shared_memory_fd_receiver) {
+    shared_memory_fd_receiver_ = shared_memory_fd_receiver;
+  }
+
   // This method forces to disconnect from connected producers and to terminate running threads.
   // It doesn't cause StopCaptureCommand to be sent, but producers will be able to handle
   // the fact that the connection was interrupted.
@@ -97,6 +106,8 @@ class ProducerSideServiceImpl final : public orbit_grpc_protos::ProducerSideServ
   std::atomic<uint64_t> producer_id_counter_ = orbit_grpc_protos::kExternalProducerStartingId;
 
   uint64_t max_wait_for_all_events_sent_ms_ = 10'000;
+
+  orbit_shared_memory_transport::SharedMemoryFdReceiver* shared_memory_fd_receiver_ = nullptr;
 };
 
 }  // namespace orbit_producer_side_service
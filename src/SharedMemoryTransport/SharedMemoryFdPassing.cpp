@@ -0,0 +1,266 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "SharedMemoryTransport/SharedMemoryFdPassing.h"
+
+#include <absl/strings/str_format.h>
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/SafeStrerror.h"
+
+#ifdef __linux
+#include <errno.h>
+#include <poll.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace orbit_shared_memory_transport {
+
+#ifdef __linux
+namespace {
+
+// A producer that connects and then doesn't send anything must not block the receiver for long.
+constexpr timeval kSocketTimeout{1, 0};
+constexpr int kPollIntervalMs = 100;
+// Bounds the number of file descriptors that have been passed but not taken yet.
+constexpr size_t kMaxPendingFdCount = 16;
+
+[[nodiscard]] ErrorMessageOr<sockaddr_un> CreateSocketAddress(std::string_view socket_path) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(address.sun_path)) {
+    return ErrorMessage{absl::StrFormat("Socket path \"%s\" is too long", socket_path)};
+  }
+  memcpy(address.sun_path, socket_path.data(), socket_path.size());
+  return address;
+}
+
+[[nodiscard]] ErrorMessageOr<void> SetSocketTimeouts(const orbit_base::UniqueFd& socket_fd) {
+  if (setsockopt(socket_fd.get(), SOL_SOCKET, SO_RCVTIMEO, &kSocketTimeout,
+                 sizeof(kSocketTimeout)) != 0 ||
+      setsockopt(socket_fd.get(), SOL_SOCKET, SO_SNDTIMEO, &kSocketTimeout,
+                 sizeof(kSocketTimeout)) != 0) {
+    return ErrorMessage{absl::StrFormat("Unable to set socket timeouts: %s", SafeStrerror(errno))};
+  }
+  return outcome::success();
+}
+
+}  // namespace
+
+ErrorMessageOr<uint64_t> SendSharedMemoryFd(std::string_view socket_path, int fd) {
+  uint64_t token = 0;
+  if (getrandom(&token, sizeof(token), 0) != sizeof(token)) {
+    return ErrorMessage{absl::StrFormat("Unable to generate token: %s", SafeStrerror(errno))};
+  }
+
+  OUTCOME_TRY(const sockaddr_un address, CreateSocketAddress(socket_path));
+  orbit_base::UniqueFd socket_fd{socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+  if (!socket_fd.valid()) {
+    return ErrorMessage{absl::StrFormat("Unable to create socket: %s", SafeStrerror(errno))};
+  }
+  OUTCOME_TRY(SetSocketTimeouts(socket_fd));
+  if (connect(socket_fd.get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) !=
+      0) {
+    return ErrorMessage{
+        absl::StrFormat("Unable to connect to \"%s\": %s", socket_path, SafeStrerror(errno))};
+  }
+
+  iovec iov{&token, sizeof(token)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))]{};
+  msghdr message{};
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  cmsghdr* control_message = CMSG_FIRSTHDR(&message);
+  control_message->cmsg_level = SOL_SOCKET;
+  control_message->cmsg_type = SCM_RIGHTS;
+  control_message->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(control_message), &fd, sizeof(int));
+  if (sendmsg(socket_fd.get(), &message, MSG_NOSIGNAL) != sizeof(token)) {
+    return ErrorMessage{
+        absl::StrFormat("Unable to send file descriptor: %s", SafeStrerror(errno))};
+  }
+
+  // The receiver acknowledges once the file descriptor can be taken with the token.
+  char ack = 0;
+  if (recv(socket_fd.get(), &ack, sizeof(ack), 0) != sizeof(ack)) {
+    return ErrorMessage{"File descriptor was not acknowledged by the receiver"};
+  }
+  return token;
+}
+
+ErrorMessageOr<std::unique_ptr<SharedMemoryFdReceiver>> SharedMemoryFdReceiver::Create(
+    std::string socket_path) {
+  OUTCOME_TRY(const sockaddr_un address, CreateSocketAddress(socket_path));
+  orbit_base::UniqueFd listening_socket{socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+  if (!listening_socket.valid()) {
+    return ErrorMessage{absl::StrFormat("Unable to create socket: %s", SafeStrerror(errno))};
+  }
+  if (unlink(socket_path.c_str()) != 0 && errno != ENOENT) {
+    return ErrorMessage{
+        absl::StrFormat("Unable to remove \"%s\": %s", socket_path, SafeStrerror(errno))};
+  }
+  if (bind(listening_socket.get(), reinterpret_cast<const sockaddr*>(&address),
+           sizeof(address)) != 0) {
+    return ErrorMessage{
+        absl::StrFormat("Unable to bind to \"%s\": %s", socket_path, SafeStrerror(errno))};
+  }
+  // Producers run as any user. Who passed a file descriptor is established with SO_PEERCRED.
+  if (chmod(socket_path.c_str(), 0777) != 0) {
+    return ErrorMessage{absl::StrFormat("Unable to change permissions of \"%s\": %s", socket_path,
+                                        SafeStrerror(errno))};
+  }
+  if (listen(listening_socket.get(), SOMAXCONN) != 0) {
+    return ErrorMessage{
+        absl::StrFormat("Unable to listen on \"%s\": %s", socket_path, SafeStrerror(errno))};
+  }
+  return std::unique_ptr<SharedMemoryFdReceiver>{
+      new SharedMemoryFdReceiver{std::move(socket_path), std::move(listening_socket)}};
+}
+
+SharedMemoryFdReceiver::SharedMemoryFdReceiver(std::string socket_path,
+                                               orbit_base::UniqueFd listening_socket)
+    : socket_path_{std::move(socket_path)}, listening_socket_{std::move(listening_socket)} {
+  accept_thread_ = std::thread{[this] { AcceptThread(); }};
+}
+
+SharedMemoryFdReceiver::~SharedMemoryFdReceiver() {
+  exit_requested_ = true;
+  accept_thread_.join();
+  if (unlink(socket_path_.c_str()) != 0) {
+    ORBIT_ERROR("Unable to remove \"%s\": %s", socket_path_, SafeStrerror(errno));
+  }
+}
+
+void SharedMemoryFdReceiver::AcceptThread() {
+  while (!exit_requested_) {
+    pollfd poll_fd{listening_socket_.get(), POLLIN, 0};
+    const int ready_count = poll(&poll_fd, 1, kPollIntervalMs);
+    if (ready_count == -1 && errno != EINTR) {
+      ORBIT_ERROR("Unable to poll \"%s\": %s", socket_path_, SafeStrerror(errno));
+      return;
+    }
+    if (ready_count <= 0) continue;
+
+    orbit_base::UniqueFd connection{
+        accept4(listening_socket_.get(), nullptr, nullptr, SOCK_CLOEXEC)};
+    if (!connection.valid()) {
+      ORBIT_ERROR("Unable to accept connection on \"%s\": %s", socket_path_, SafeStrerror(errno));
+      continue;
+    }
+    ReceiveFd(connection);
+  }
+}
+
+void SharedMemoryFdReceiver::ReceiveFd(const orbit_base::UniqueFd& connection) {
+  if (auto result = SetSocketTimeouts(connection); result.has_error()) {
+    ORBIT_ERROR("%s", result.error().message());
+    return;
+  }
+
+  uint64_t token = 0;
+  iovec iov{&token, sizeof(token)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))]{};
+  msghdr message{};
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  const ssize_t received_size = recvmsg(connection.get(), &message, MSG_CMSG_CLOEXEC);
+
+  // Take ownership of whatever file descriptors were received before validating anything, so that
+  // none is leaked.
+  std::vector<orbit_base::UniqueFd> received_fds;
+  if (received_size != -1) {
+    for (cmsghdr* control_message = CMSG_FIRSTHDR(&message); control_message != nullptr;
+         control_message = CMSG_NXTHDR(&message, control_message)) {
+      if (control_message->cmsg_level != SOL_SOCKET || control_message->cmsg_type != SCM_RIGHTS) {
+        continue;
+      }
+      const size_t fd_count = (control_message->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      for (size_t i = 0; i < fd_count; ++i) {
+        int fd = -1;
+        memcpy(&fd, CMSG_DATA(control_message) + i * sizeof(int), sizeof(int));
+        received_fds.emplace_back(fd);
+      }
+    }
+  }
+  if (received_size != sizeof(token) || (message.msg_flags & MSG_CTRUNC) != 0 ||
+      received_fds.size() != 1) {
+    ORBIT_ERROR("Received invalid shared memory file descriptor message on \"%s\"", socket_path_);
+    return;
+  }
+
+  ucred credentials{};
+  socklen_t credentials_size = sizeof(credentials);
+  if (getsockopt(connection.get(), SOL_SOCKET, SO_PEERCRED, &credentials, &credentials_size) !=
+      0) {
+    ORBIT_ERROR("Unable to get the credentials of a shared memory file descriptor sender: %s",
+                SafeStrerror(errno));
+    return;
+  }
+
+  {
+    absl::MutexLock lock{&mutex_};
+    if (token_to_received_fd_.contains(token)) {
+      ORBIT_ERROR("Received shared memory file descriptor with a token already in use");
+      return;
+    }
+    token_to_received_fd_.emplace(
+        token, ReceivedFd{std::move(received_fds[0]), static_cast<uint32_t>(credentials.pid)});
+    tokens_.push_back(token);
+    while (tokens_.size() > kMaxPendingFdCount) {
+      token_to_received_fd_.erase(tokens_.front());
+      tokens_.pop_front();
+    }
+  }
+
+  constexpr char kAck = 1;
+  if (send(connection.get(), &kAck, sizeof(kAck), MSG_NOSIGNAL) != sizeof(kAck)) {
+    ORBIT_ERROR("Unable to acknowledge shared memory file descriptor: %s", SafeStrerror(errno));
+  }
+}
+
+std::optional<SharedMemoryFdReceiver::ReceivedFd> SharedMemoryFdReceiver::TakeFd(uint64_t token) {
+  absl::MutexLock lock{&mutex_};
+  auto it = token_to_received_fd_.find(token);
+  if (it == token_to_received_fd_.end()) return std::nullopt;
+  ReceivedFd received_fd = std::move(it->second);
+  token_to_received_fd_.erase(it);
+  tokens_.erase(std::find(tokens_.begin(), tokens_.end(), token));
+  return received_fd;
+}
+
+#else
+
+ErrorMessageOr<uint64_t> SendSharedMemoryFd(std::string_view /*socket_path*/, int /*fd*/) {
+  return ErrorMessage{"Passing file descriptors is not supported on this platform"};
+}
+
+ErrorMessageOr<std::unique_ptr<SharedMemoryFdReceiver>> SharedMemoryFdReceiver::Create(
+    std::string /*socket_path*/) {
+  return ErrorMessage{"Passing file descriptors is not supported on this platform"};
+}
+
+SharedMemoryFdReceiver::~SharedMemoryFdReceiver() = default;
+
+std::optional<SharedMemoryFdReceiver::ReceivedFd> SharedMemoryFdReceiver::TakeFd(
+    uint64_t /*token*/) {
+  return std::nullopt;
+}
+
+#endif
+
+}  // namespace orbit_shared_memory_transport
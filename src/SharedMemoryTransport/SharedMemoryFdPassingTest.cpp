@@ -0,0 +1,100 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "OrbitBase/File.h"
+#include "SharedMemoryTransport/SharedMemoryFdPassing.h"
+#include "TestUtils/TemporaryDirectory.h"
+#include "TestUtils/TemporaryFile.h"
+#include "TestUtils/TestUtils.h"
+
+namespace orbit_shared_memory_transport {
+
+namespace {
+
+using orbit_test_utils::HasErrorWithMessage;
+using orbit_test_utils::HasNoError;
+
+class SharedMemoryFdPassingTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    auto temporary_directory_or_error = orbit_test_utils::TemporaryDirectory::Create();
+    ASSERT_THAT(temporary_directory_or_error, HasNoError());
+    temporary_directory_.emplace(std::move(temporary_directory_or_error.value()));
+    socket_path_ = (temporary_directory_->GetDirectoryPath() / "socket").string();
+
+    auto receiver_or_error = SharedMemoryFdReceiver::Create(socket_path_);
+    ASSERT_THAT(receiver_or_error, HasNoError());
+    receiver_ = std::move(receiver_or_error.value());
+  }
+
+  std::optional<orbit_test_utils::TemporaryDirectory> temporary_directory_;
+  std::string socket_path_;
+  std::unique_ptr<SharedMemoryFdReceiver> receiver_;
+};
+
+[[nodiscard]] ino_t GetInode(int fd) {
+  struct stat file_stat {};
+  EXPECT_EQ(fstat(fd, &file_stat), 0);
+  return file_stat.st_ino;
+}
+
+}  // namespace
+
+TEST_F(SharedMemoryFdPassingTest, PassedFdCanBeTakenOnceWithItsToken) {
+  auto temporary_file_or_error = orbit_test_utils::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, HasNoError());
+  const int fd = temporary_file_or_error.value().fd().get();
+
+  auto token_or_error = SendSharedMemoryFd(socket_path_, fd);
+  ASSERT_THAT(token_or_error, HasNoError());
+  const uint64_t token = token_or_error.value();
+
+  EXPECT_FALSE(receiver_->TakeFd(token + 1).has_value());
+
+  std::optional<SharedMemoryFdReceiver::ReceivedFd> received_fd = receiver_->TakeFd(token);
+  ASSERT_TRUE(received_fd.has_value());
+  // The received file descriptor is a new one, to the same file.
+  EXPECT_NE(received_fd->fd.get(), fd);
+  EXPECT_EQ(GetInode(received_fd->fd.get()), GetInode(fd));
+  EXPECT_EQ(received_fd->pid, static_cast<uint32_t>(getpid()));
+
+  EXPECT_FALSE(receiver_->TakeFd(token).has_value());
+}
+
+TEST_F(SharedMemoryFdPassingTest, OnlyTheMostRecentFdsAreKept) {
+  auto temporary_file_or_error = orbit_test_utils::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, HasNoError());
+  const int fd = temporary_file_or_error.value().fd().get();
+
+  auto first_token_or_error = SendSharedMemoryFd(socket_path_, fd);
+  ASSERT_THAT(first_token_or_error, HasNoError());
+  uint64_t last_token = 0;
+  for (int i = 0; i < 100; ++i) {
+    auto token_or_error = SendSharedMemoryFd(socket_path_, fd);
+    ASSERT_THAT(token_or_error, HasNoError());
+    last_token = token_or_error.value();
+  }
+
+  EXPECT_FALSE(receiver_->TakeFd(first_token_or_error.value()).has_value());
+  EXPECT_TRUE(receiver_->TakeFd(last_token).has_value());
+}
+
+TEST_F(SharedMemoryFdPassingTest, SendFailsWithoutReceiver) {
+  receiver_.reset();
+  EXPECT_THAT(SendSharedMemoryFd(socket_path_, STDIN_FILENO),
+              HasErrorWithMessage("Unable to connect"));
+}
+
+}  // namespace orbit_shared_memory_transport
@@ -0,0 +1,73 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "SharedMemoryTransport/SharedMemoryRecords.h"
+
+#include <absl/strings/str_format.h>
+#include <string.h>
+
+#include "ApiUtils/ApiEventRecord.h"
+
+namespace orbit_shared_memory_transport {
+
+namespace {
+
+// The payload is in memory shared with the producer: copy it before validating and using it.
+template <typename RecordT>
+[[nodiscard]] ErrorMessageOr<RecordT> CopyFixedSizeRecord(absl::Span<const char> payload) {
+  if (payload.size() != sizeof(RecordT)) {
+    return ErrorMessage{absl::StrFormat("Record has size %u instead of %u", payload.size(),
+                                        sizeof(RecordT))};
+  }
+  RecordT record;
+  memcpy(&record, payload.data(), sizeof(RecordT));
+  return record;
+}
+
+}  // namespace
+
+ErrorMessageOr<void> DecodeSharedMemoryRecord(
+    uint32_t type, absl::Span<const char> payload, uint32_t pid,
+    orbit_grpc_protos::ProducerCaptureEvent* capture_event) {
+  switch (static_cast<SharedMemoryRecordType>(type)) {
+    case SharedMemoryRecordType::kProducerCaptureEvent:
+      if (!capture_event->ParseFromArray(payload.data(), static_cast<int>(payload.size()))) {
+        return ErrorMessage{"Unable to parse ProducerCaptureEvent record"};
+      }
+      return outcome::success();
+
+    case SharedMemoryRecordType::kApiEvent:
+      return orbit_api::FillProducerCaptureEventFromSerializedApiEventRecord(payload, pid,
+                                                                            capture_event);
+
+    case SharedMemoryRecordType::kFunctionEntry: {
+      OUTCOME_TRY(const FunctionEntryRecord record,
+                  CopyFixedSizeRecord<FunctionEntryRecord>(payload));
+      orbit_grpc_protos::FunctionEntry* function_entry = capture_event->mutable_function_entry();
+      function_entry->set_pid(pid);
+      function_entry->set_tid(record.tid);
+      function_entry->set_function_id(record.function_id);
+      function_entry->set_stack_pointer(record.stack_pointer);
+      function_entry->set_return_address(record.return_address);
+      function_entry->set_timestamp_ns(record.timestamp_ns);
+      return outcome::success();
+    }
+
+    case SharedMemoryRecordType::kFunctionExit: {
+      OUTCOME_TRY(const FunctionExitRecord record,
+                  CopyFixedSizeRecord<FunctionExitRecord>(payload));
+      orbit_grpc_protos::FunctionExit* function_exit = capture_event->mutable_function_exit();
+      function_exit->set_pid(pid);
+      function_exit->set_tid(record.tid);
+      function_exit->set_timestamp_ns(record.timestamp_ns);
+      return outcome::success();
+    }
+
+    case SharedMemoryRecordType::kPadding:
+      break;
+  }
+  return ErrorMessage{absl::StrFormat("Unknown shared memory record type %u", type)};
+}
+
+}  // namespace orbit_shared_memory_transport
@@ -0,0 +1,126 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/types/span.h>
+#include <gmock/gmock.h>
+#include <google/protobuf/util/message_differencer.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "ApiUtils/ApiEventRecord.h"
+#include "GrpcProtos/capture.pb.h"
+#include "SharedMemoryTransport/SharedMemoryRecords.h"
+#include "TestUtils/TestUtils.h"
+
+using google::protobuf::util::MessageDifferencer;
+using orbit_grpc_protos::ProducerCaptureEvent;
+using orbit_test_utils::HasErrorWithMessage;
+using orbit_test_utils::HasNoError;
+
+namespace orbit_shared_memory_transport {
+
+namespace {
+
+constexpr uint32_t kPid = 42;
+constexpr uint32_t kTid = 43;
+
+template <typename RecordT>
+[[nodiscard]] absl::Span<const char> AsPayload(const RecordT& record) {
+  return {reinterpret_cast<const char*>(&record), sizeof(record)};
+}
+
+[[nodiscard]] ProducerCaptureEvent Decode(SharedMemoryRecordType type,
+                                          absl::Span<const char> payload) {
+  ProducerCaptureEvent capture_event;
+  EXPECT_THAT(DecodeSharedMemoryRecord(static_cast<uint32_t>(type), payload, kPid, &capture_event),
+              HasNoError());
+  return capture_event;
+}
+
+void ExpectEquals(const ProducerCaptureEvent& actual, const ProducerCaptureEvent& expected) {
+  EXPECT_TRUE(MessageDifferencer::Equals(actual, expected))
+      << actual.DebugString() << "\nvs\n"
+      << expected.DebugString();
+}
+
+}  // namespace
+
+TEST(SharedMemoryRecords, DecodesFunctionEntry) {
+  const FunctionEntryRecord record{kTid, 1, 2, 3, 4};
+  ProducerCaptureEvent expected;
+  orbit_grpc_protos::FunctionEntry* function_entry = expected.mutable_function_entry();
+  function_entry->set_pid(kPid);
+  function_entry->set_tid(kTid);
+  function_entry->set_function_id(1);
+  function_entry->set_stack_pointer(2);
+  function_entry->set_return_address(3);
+  function_entry->set_timestamp_ns(4);
+  ExpectEquals(Decode(SharedMemoryRecordType::kFunctionEntry, AsPayload(record)), expected);
+}
+
+TEST(SharedMemoryRecords, DecodesFunctionExit) {
+  const FunctionExitRecord record{kTid, 4};
+  ProducerCaptureEvent expected;
+  orbit_grpc_protos::FunctionExit* function_exit = expected.mutable_function_exit();
+  function_exit->set_pid(kPid);
+  function_exit->set_tid(kTid);
+  function_exit->set_timestamp_ns(4);
+  ExpectEquals(Decode(SharedMemoryRecordType::kFunctionExit, AsPayload(record)), expected);
+}
+
+TEST(SharedMemoryRecords, FunctionEntryAndExitTakeThePidOfTheWriter) {
+  constexpr uint32_t kOtherPid = 44;
+  ProducerCaptureEvent capture_event;
+  const FunctionEntryRecord function_entry{kTid, 1, 2, 3, 4};
+  ASSERT_THAT(
+      DecodeSharedMemoryRecord(static_cast<uint32_t>(SharedMemoryRecordType::kFunctionEntry),
+                               AsPayload(function_entry), kOtherPid, &capture_event),
+      HasNoError());
+  EXPECT_EQ(capture_event.function_entry().pid(), kOtherPid);
+
+  const FunctionExitRecord function_exit{kTid, 4};
+  ASSERT_THAT(DecodeSharedMemoryRecord(static_cast<uint32_t>(SharedMemoryRecordType::kFunctionExit),
+                                       AsPayload(function_exit), kOtherPid, &capture_event),
+              HasNoError());
+  EXPECT_EQ(capture_event.function_exit().pid(), kOtherPid);
+}
+
+TEST(SharedMemoryRecords, DecodesSerializedProducerCaptureEvent) {
+  ProducerCaptureEvent expected;
+  expected.mutable_interned_string()->set_key(1);
+  expected.mutable_interned_string()->set_intern("string");
+  const std::string serialized = expected.SerializeAsString();
+  ExpectEquals(Decode(SharedMemoryRecordType::kProducerCaptureEvent, serialized), expected);
+}
+
+TEST(SharedMemoryRecords, DecodesApiEvent) {
+  const orbit_api::ApiEventRecord record =
+      orbit_api::ApiEventRecord::CreateStringEvent(kTid, 4, "name", 5, kOrbitColorAuto);
+  std::vector<char> serialized(orbit_api::GetSerializedApiEventRecordSize(record.GetName()));
+  orbit_api::SerializeApiEventRecord(record, record.GetName(), serialized.data());
+
+  ProducerCaptureEvent expected;
+  orbit_api::FillProducerCaptureEventFromApiEventRecord(record, record.GetName(), kPid, &expected);
+  ExpectEquals(Decode(SharedMemoryRecordType::kApiEvent, serialized), expected);
+}
+
+TEST(SharedMemoryRecords, RejectsInvalidRecords) {
+  ProducerCaptureEvent capture_event;
+  const FunctionExitRecord function_exit{kTid, 4};
+  EXPECT_THAT(
+      DecodeSharedMemoryRecord(static_cast<uint32_t>(SharedMemoryRecordType::kFunctionEntry),
+                               AsPayload(function_exit), kPid, &capture_event),
+      HasErrorWithMessage("instead of"));
+  EXPECT_THAT(DecodeSharedMemoryRecord(100, AsPayload(function_exit), kPid, &capture_event),
+              HasErrorWithMessage("Unknown shared memory record type"));
+  EXPECT_THAT(
+      DecodeSharedMemoryRecord(static_cast<uint32_t>(SharedMemoryRecordType::kProducerCaptureEvent),
+                               "\xff\xff\xff", kPid, &capture_event),
+      HasErrorWithMessage("Unable to parse"));
+}
+
+}  // namespace orbit_shared_memory_transport
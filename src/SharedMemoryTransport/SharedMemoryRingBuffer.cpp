@@ -0,0 +1,248 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "SharedMemoryTransport/SharedMemoryRingBuffer.h"
+
+#include <absl/strings/str_format.h>
+#include <string.h>
+
+#include <algorithm>
+#include <new>
+#include <string>
+#include <utility>
+
+#include "OrbitBase/Align.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/SafeStrerror.h"
+
+#ifdef __linux
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace orbit_shared_memory_transport {
+
+namespace {
+
+[[nodiscard]] uint64_t GetRecordSizeInRingBuffer(uint64_t payload_size) {
+  return orbit_base::AlignUp<8>(sizeof(SharedMemoryRecordHeader) + payload_size);
+}
+
+#ifdef __linux
+void UnmapOrLogError(char* mapping, uint64_t size) {
+  if (munmap(mapping, size) != 0) {
+    ORBIT_ERROR("Unable to unmap shared memory ring buffer: %s", SafeStrerror(errno));
+  }
+}
+#endif
+
+}  // namespace
+
+ErrorMessageOr<std::unique_ptr<SharedMemoryRingBufferWriter>> SharedMemoryRingBufferWriter::Create(
+    uint64_t capacity) {
+  if (capacity == 0 || capacity % 8 != 0) {
+    return ErrorMessage{absl::StrFormat(
+        "Capacity of shared memory ring buffer must be a positive multiple of 8, but is %u",
+        capacity)};
+  }
+#ifdef __linux
+  orbit_base::UniqueFd fd{memfd_create("orbit_producer_events", MFD_CLOEXEC | MFD_ALLOW_SEALING)};
+  if (!fd.valid()) {
+    return ErrorMessage{
+        absl::StrFormat("Unable to create shared memory ring buffer: %s", SafeStrerror(errno))};
+  }
+  const uint64_t mapping_size = kSharedMemoryRingBufferDataOffset + capacity;
+  if (ftruncate(fd.get(), static_cast<off_t>(mapping_size)) != 0) {
+    return ErrorMessage{
+        absl::StrFormat("Unable to resize shared memory ring buffer: %s", SafeStrerror(errno))};
+  }
+  // The reader maps the region and accesses it assuming this size: make sure that it can't change,
+  // as accessing pages past the end of the file would raise SIGBUS in the reader.
+  if (fcntl(fd.get(), F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) {
+    return ErrorMessage{
+        absl::StrFormat("Unable to seal shared memory ring buffer: %s", SafeStrerror(errno))};
+  }
+  void* mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+  if (mapping == MAP_FAILED) {
+    return ErrorMessage{
+        absl::StrFormat("Unable to map shared memory ring buffer: %s", SafeStrerror(errno))};
+  }
+  return std::unique_ptr<SharedMemoryRingBufferWriter>{
+      new SharedMemoryRingBufferWriter{std::move(fd), static_cast<char*>(mapping), capacity}};
+#else
+  return ErrorMessage{"Shared memory ring buffers are not supported on this platform"};
+#endif
+}
+
+SharedMemoryRingBufferWriter::SharedMemoryRingBufferWriter(orbit_base::UniqueFd fd, char* mapping,
+                                                           uint64_t capacity)
+    : fd_{std::move(fd)},
+      mapping_{mapping},
+      header_{new (mapping) SharedMemoryRingBufferHeader{}},
+      data_{mapping + kSharedMemoryRingBufferDataOffset},
+      capacity_{capacity} {
+  header_->magic = SharedMemoryRingBufferHeader::kMagic;
+  header_->version = SharedMemoryRingBufferHeader::kVersion;
+  header_->capacity = capacity;
+  header_->write_offset.store(0, std::memory_order_relaxed);
+  header_->read_offset.store(0, std::memory_order_relaxed);
+}
+
+SharedMemoryRingBufferWriter::~SharedMemoryRingBufferWriter() {
+#ifdef __linux
+  UnmapOrLogError(mapping_, GetMappingSize());
+#endif
+}
+
+char* SharedMemoryRingBufferWriter::TryBeginRecord(uint32_t type, uint32_t size) {
+  ORBIT_CHECK(pending_record_size_ == 0);
+  if (size > GetMaxRecordSize()) return nullptr;
+
+  const uint64_t record_size = GetRecordSizeInRingBuffer(size);
+  uint64_t position = write_offset_ % capacity_;
+  const uint64_t size_until_end = capacity_ - position;
+  // A record that doesn't fit before the end of the data area is preceded by a padding record.
+  const uint64_t padding_size = size_until_end < record_size ? size_until_end : 0;
+  const uint64_t required_size = padding_size + record_size;
+  if (write_offset_ + required_size - cached_read_offset_ > capacity_) {
+    cached_read_offset_ = header_->read_offset.load(std::memory_order_acquire);
+    if (write_offset_ + required_size - cached_read_offset_ > capacity_) return nullptr;
+  }
+
+  if (padding_size > 0) {
+    const SharedMemoryRecordHeader padding_header{
+        static_cast<uint32_t>(padding_size - sizeof(SharedMemoryRecordHeader)), kPaddingRecordType};
+    memcpy(data_ + position, &padding_header, sizeof(padding_header));
+    write_offset_ += padding_size;
+    position = 0;
+  }
+
+  const SharedMemoryRecordHeader record_header{size, type};
+  memcpy(data_ + position, &record_header, sizeof(record_header));
+  pending_record_size_ = record_size;
+  return data_ + position + sizeof(record_header);
+}
+
+void SharedMemoryRingBufferWriter::EndRecord() {
+  ORBIT_CHECK(pending_record_size_ > 0);
+  write_offset_ += pending_record_size_;
+  pending_record_size_ = 0;
+}
+
+void SharedMemoryRingBufferWriter::Publish() {
+  header_->write_offset.store(write_offset_, std::memory_order_release);
+}
+
+ErrorMessageOr<std::unique_ptr<SharedMemoryRingBufferReader>>
+SharedMemoryRingBufferReader::OpenFromFd(orbit_base::UniqueFd fd) {
+#ifdef __linux
+  // Only accept memfds whose size is sealed, see SharedMemoryRingBufferWriter::Create. This also
+  // prevents a producer from making us write to one of its regular files.
+  const int seals = fcntl(fd.get(), F_GET_SEALS);
+  if (seals == -1 || (seals & F_SEAL_SHRINK) == 0) {
+    return ErrorMessage{"File descriptor is not a sealed shared memory region"};
+  }
+
+  struct stat file_stat {};
+  if (fstat(fd.get(), &file_stat) != 0) {
+    return ErrorMessage{
+        absl::StrFormat("Unable to stat shared memory region: %s", SafeStrerror(errno))};
+  }
+  const auto mapping_size = static_cast<uint64_t>(file_stat.st_size);
+  if (mapping_size <= kSharedMemoryRingBufferDataOffset) {
+    return ErrorMessage{"Shared memory region is too small for a ring buffer"};
+  }
+  const uint64_t capacity = mapping_size - kSharedMemoryRingBufferDataOffset;
+
+  // The mapping stays valid after `fd` is closed.
+  void* mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+  if (mapping == MAP_FAILED) {
+    return ErrorMessage{
+        absl::StrFormat("Unable to map shared memory region: %s", SafeStrerror(errno))};
+  }
+  const auto* header = static_cast<const SharedMemoryRingBufferHeader*>(mapping);
+  if (header->magic != SharedMemoryRingBufferHeader::kMagic ||
+      header->version != SharedMemoryRingBufferHeader::kVersion || header->capacity != capacity ||
+      capacity % 8 != 0) {
+    UnmapOrLogError(static_cast<char*>(mapping), mapping_size);
+    return ErrorMessage{"Shared memory region doesn't contain a supported ring buffer"};
+  }
+  return std::unique_ptr<SharedMemoryRingBufferReader>{
+      new SharedMemoryRingBufferReader{static_cast<char*>(mapping), capacity}};
+#else
+  (void)fd;
+  return ErrorMessage{"Shared memory ring buffers are not supported on this platform"};
+#endif
+}
+
+SharedMemoryRingBufferReader::SharedMemoryRingBufferReader(char* mapping, uint64_t capacity)
+    : mapping_{mapping},
+      header_{reinterpret_cast<SharedMemoryRingBufferHeader*>(mapping)},
+      data_{mapping + kSharedMemoryRingBufferDataOffset},
+      capacity_{capacity},
+      read_offset_{header_->read_offset.load(std::memory_order_relaxed)} {}
+
+SharedMemoryRingBufferReader::~SharedMemoryRingBufferReader() {
+#ifdef __linux
+  UnmapOrLogError(mapping_, kSharedMemoryRingBufferDataOffset + capacity_);
+#endif
+}
+
+ErrorMessageOr<void> SharedMemoryRingBufferReader::SkipTo(uint64_t offset) {
+  const uint64_t write_offset = header_->write_offset.load(std::memory_order_acquire);
+  // Offsets only increase, so the writer can't have written at `offset` and wrapped around since.
+  if (offset < read_offset_ || offset % 8 != 0 || offset - read_offset_ > capacity_) {
+    return ErrorMessage{absl::StrFormat(
+        "Invalid offset %u in shared memory ring buffer (read offset %u, write offset %u)", offset,
+        read_offset_, write_offset)};
+  }
+  read_offset_ = offset;
+  header_->read_offset.store(read_offset_, std::memory_order_release);
+  return outcome::success();
+}
+
+ErrorMessageOr<size_t> SharedMemoryRingBufferReader::ReadRecords(
+    absl::FunctionRef<void(uint32_t type, absl::Span<const char> payload)> consume_record) {
+  const uint64_t write_offset = header_->write_offset.load(std::memory_order_acquire);
+  if (write_offset < read_offset_ || write_offset - read_offset_ > capacity_ ||
+      write_offset % 8 != 0) {
+    return ErrorMessage{absl::StrFormat(
+        "Invalid write offset %u in shared memory ring buffer (read offset %u)", write_offset,
+        read_offset_)};
+  }
+
+  size_t record_count = 0;
+  while (read_offset_ < write_offset) {
+    const uint64_t position = read_offset_ % capacity_;
+    const uint64_t available_size = std::min(write_offset - read_offset_, capacity_ - position);
+    // Copy the header, as the writer could change it while we use it.
+    SharedMemoryRecordHeader record_header;
+    if (available_size < sizeof(record_header)) {
+      return ErrorMessage{"Truncated record header in shared memory ring buffer"};
+    }
+    memcpy(&record_header, data_ + position, sizeof(record_header));
+    const uint64_t record_size = GetRecordSizeInRingBuffer(record_header.size);
+    if (record_size > available_size) {
+      return ErrorMessage{absl::StrFormat(
+          "Record of size %u exceeds the published data in shared memory ring buffer",
+          record_header.size)};
+    }
+
+    if (record_header.type != kPaddingRecordType) {
+      consume_record(record_header.type,
+                     absl::MakeConstSpan(data_ + position + sizeof(record_header),
+                                         record_header.size));
+      ++record_count;
+    }
+    read_offset_ += record_size;
+  }
+
+  header_->read_offset.store(read_offset_, std::memory_order_release);
+  return record_count;
+}
+
+}  // namespace orbit_shared_memory_transport
@@ -0,0 +1,194 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/types/span.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "OrbitBase/File.h"
+#include "SharedMemoryTransport/SharedMemoryRingBuffer.h"
+#include "TestUtils/TemporaryFile.h"
+#include "TestUtils/TestUtils.h"
+
+namespace orbit_shared_memory_transport {
+
+namespace {
+
+using orbit_test_utils::HasErrorWithMessage;
+using orbit_test_utils::HasNoError;
+
+struct Record {
+  uint32_t type;
+  std::string payload;
+
+  friend bool operator==(const Record& lhs, const Record& rhs) {
+    return lhs.type == rhs.type && lhs.payload == rhs.payload;
+  }
+};
+
+[[nodiscard]] bool TryWriteRecord(SharedMemoryRingBufferWriter* writer, const Record& record) {
+  char* payload = writer->TryBeginRecord(record.type, record.payload.size());
+  if (payload == nullptr) return false;
+  memcpy(payload, record.payload.data(), record.payload.size());
+  writer->EndRecord();
+  return true;
+}
+
+[[nodiscard]] std::vector<Record> ReadAllRecords(SharedMemoryRingBufferReader* reader) {
+  std::vector<Record> records;
+  auto record_count_or_error =
+      reader->ReadRecords([&records](uint32_t type, absl::Span<const char> payload) {
+        records.push_back({type, std::string(payload.data(), payload.size())});
+      });
+  EXPECT_THAT(record_count_or_error, HasNoError());
+  return records;
+}
+
+class SharedMemoryRingBufferTest : public ::testing::Test {
+ protected:
+  void CreateWriterAndReader(uint64_t capacity) {
+    auto writer_or_error = SharedMemoryRingBufferWriter::Create(capacity);
+    ASSERT_THAT(writer_or_error, HasNoError());
+    writer_ = std::move(writer_or_error.value());
+
+    auto reader_or_error =
+        SharedMemoryRingBufferReader::OpenFromFd(orbit_base::UniqueFd{dup(writer_->fd())});
+    ASSERT_THAT(reader_or_error, HasNoError());
+    reader_ = std::move(reader_or_error.value());
+  }
+
+  std::unique_ptr<SharedMemoryRingBufferWriter> writer_;
+  std::unique_ptr<SharedMemoryRingBufferReader> reader_;
+};
+
+}  // namespace
+
+TEST_F(SharedMemoryRingBufferTest, RecordsAreOnlyReadAfterPublish) {
+  CreateWriterAndReader(1024);
+  const Record record_1{1, "first"};
+  const Record record_2{2, ""};
+  const Record record_3{3, std::string(100, 'x')};
+
+  EXPECT_TRUE(TryWriteRecord(writer_.get(), record_1));
+  EXPECT_TRUE(TryWriteRecord(writer_.get(), record_2));
+  EXPECT_THAT(ReadAllRecords(reader_.get()), ::testing::IsEmpty());
+
+  writer_->Publish();
+  EXPECT_TRUE(TryWriteRecord(writer_.get(), record_3));
+  EXPECT_THAT(ReadAllRecords(reader_.get()), ::testing::ElementsAre(record_1, record_2));
+
+  writer_->Publish();
+  EXPECT_THAT(ReadAllRecords(reader_.get()), ::testing::ElementsAre(record_3));
+  EXPECT_THAT(ReadAllRecords(reader_.get()), ::testing::IsEmpty());
+}
+
+TEST_F(SharedMemoryRingBufferTest, WritingFailsUntilSpaceIsFreed) {
+  CreateWriterAndReader(64);
+  // Each of these records takes 24 bytes in the ring buffer.
+  const Record record{1, std::string(12, 'a')};
+  EXPECT_TRUE(TryWriteRecord(writer_.get(), record));
+  EXPECT_TRUE(TryWriteRecord(writer_.get(), record));
+  EXPECT_FALSE(TryWriteRecord(writer_.get(), record));
+  writer_->Publish();
+
+  EXPECT_EQ(ReadAllRecords(reader_.get()).size(), 2);
+  EXPECT_TRUE(TryWriteRecord(writer_.get(), record));
+}
+
+TEST_F(SharedMemoryRingBufferTest, RecordsDontWrapAround) {
+  CreateWriterAndReader(64);
+  EXPECT_EQ(writer_->GetMaxRecordSize(), 24);
+  // The two records take 24 and 32 bytes in the ring buffer, so that they regularly don't fit
+  // before the end of the data area.
+  const Record small_record{1, std::string(12, 's')};
+  const Record large_record{2, std::string(24, 'l')};
+
+  std::vector<Record> read_records;
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(TryWriteRecord(writer_.get(), small_record));
+    ASSERT_TRUE(TryWriteRecord(writer_.get(), large_record));
+    writer_->Publish();
+    for (Record& record : ReadAllRecords(reader_.get())) {
+      read_records.push_back(std::move(record));
+    }
+  }
+
+  ASSERT_EQ(read_records.size(), 20);
+  for (size_t i = 0; i < read_records.size(); i += 2) {
+    EXPECT_EQ(read_records[i], small_record);
+    EXPECT_EQ(read_records[i + 1], large_record);
+  }
+}
+
+TEST_F(SharedMemoryRingBufferTest, RecordsLargerThanHalfTheCapacityAreRejected) {
+  CreateWriterAndReader(64);
+  EXPECT_EQ(writer_->TryBeginRecord(1, writer_->GetMaxRecordSize() + 1), nullptr);
+}
+
+TEST_F(SharedMemoryRingBufferTest, SkipToDiscardsOlderRecords) {
+  CreateWriterAndReader(1024);
+  EXPECT_TRUE(TryWriteRecord(writer_.get(), {1, "stale"}));
+  const uint64_t offset = writer_->GetWriteOffset();
+  EXPECT_TRUE(TryWriteRecord(writer_.get(), {2, "fresh"}));
+  writer_->Publish();
+
+  EXPECT_THAT(reader_->SkipTo(offset + 1), HasErrorWithMessage("Invalid offset"));
+  EXPECT_THAT(reader_->SkipTo(offset), HasNoError());
+  EXPECT_THAT(ReadAllRecords(reader_.get()), ::testing::ElementsAre(Record{2, "fresh"}));
+  EXPECT_THAT(reader_->SkipTo(offset), HasErrorWithMessage("Invalid offset"));
+}
+
+TEST_F(SharedMemoryRingBufferTest, ConcurrentWriteAndRead) {
+  CreateWriterAndReader(4096);
+  constexpr uint64_t kRecordCount = 20'000;
+
+  std::thread writer_thread{[this] {
+    for (uint64_t i = 0; i < kRecordCount; ++i) {
+      // Records of varying sizes, to also exercise padding at the end of the data area.
+      const Record record{static_cast<uint32_t>(i % 7 + 1),
+                          std::string(i % 13, static_cast<char>('a' + i % 26))};
+      while (!TryWriteRecord(writer_.get(), record)) {
+        writer_->Publish();
+        std::this_thread::yield();
+      }
+      if (i % 16 == 0) writer_->Publish();
+    }
+    writer_->Publish();
+  }};
+
+  uint64_t read_record_count = 0;
+  while (read_record_count < kRecordCount) {
+    for (const Record& record : ReadAllRecords(reader_.get())) {
+      const uint64_t i = read_record_count;
+      ASSERT_EQ(record, (Record{static_cast<uint32_t>(i % 7 + 1),
+                                std::string(i % 13, static_cast<char>('a' + i % 26))}));
+      ++read_record_count;
+    }
+  }
+  writer_thread.join();
+}
+
+TEST(SharedMemoryRingBuffer, CreateFailsForInvalidCapacity) {
+  EXPECT_THAT(SharedMemoryRingBufferWriter::Create(0), HasErrorWithMessage("multiple of 8"));
+  EXPECT_THAT(SharedMemoryRingBufferWriter::Create(100), HasErrorWithMessage("multiple of 8"));
+}
+
+TEST(SharedMemoryRingBuffer, OpenFromFdRejectsRegularFiles) {
+  auto temporary_file_or_error = orbit_test_utils::TemporaryFile::Create();
+  ASSERT_THAT(temporary_file_or_error, HasNoError());
+  EXPECT_THAT(SharedMemoryRingBufferReader::OpenFromFd(
+                  orbit_base::UniqueFd{dup(temporary_file_or_error.value().fd().get())}),
+              HasErrorWithMessage("is not a sealed shared memory region"));
+}
+
+}  // namespace orbit_shared_memory_transport
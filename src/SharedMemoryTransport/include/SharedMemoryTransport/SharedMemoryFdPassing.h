@@ -0,0 +1,83 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SHARED_MEMORY_TRANSPORT_SHARED_MEMORY_FD_PASSING_H_
+#define SHARED_MEMORY_TRANSPORT_SHARED_MEMORY_FD_PASSING_H_
+
+#include <absl/base/thread_annotations.h>
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_shared_memory_transport {
+
+// Passes the file descriptor of a shared memory region from a producer to OrbitService, which runs
+// as a different, usually more privileged, user. gRPC can't pass file descriptors, so the file
+// descriptor is passed with SCM_RIGHTS over a dedicated Unix domain socket, on which
+// SharedMemoryFdReceiver listens. The kernel only lets a process pass file descriptors it has
+// open, and reports the pid of the sender: OrbitService never opens a file on behalf of a producer,
+// and doesn't rely on the pid a producer claims.
+//
+// The file descriptor is associated with a random token, which the producer then sends over gRPC
+// to designate it.
+
+// Passes `fd` to the SharedMemoryFdReceiver listening on `socket_path`, and returns the token that
+// designates it. When this returns, the file descriptor is available from TakeFd.
+[[nodiscard]] ErrorMessageOr<uint64_t> SendSharedMemoryFd(std::string_view socket_path, int fd);
+
+class SharedMemoryFdReceiver {
+ public:
+  struct ReceivedFd {
+    orbit_base::UniqueFd fd;
+    // The pid of the process that passed the file descriptor, as reported by the kernel.
+    uint32_t pid;
+  };
+
+  // Listens on a Unix domain socket at `socket_path`, replacing what is there, that any user can
+  // connect to.
+  [[nodiscard]] static ErrorMessageOr<std::unique_ptr<SharedMemoryFdReceiver>> Create(
+      std::string socket_path);
+
+  ~SharedMemoryFdReceiver();
+
+  SharedMemoryFdReceiver(const SharedMemoryFdReceiver&) = delete;
+  SharedMemoryFdReceiver& operator=(const SharedMemoryFdReceiver&) = delete;
+  SharedMemoryFdReceiver(SharedMemoryFdReceiver&&) = delete;
+  SharedMemoryFdReceiver& operator=(SharedMemoryFdReceiver&&) = delete;
+
+  // Returns the file descriptor passed with `token`, at most once.
+  [[nodiscard]] std::optional<ReceivedFd> TakeFd(uint64_t token);
+
+ private:
+  SharedMemoryFdReceiver(std::string socket_path, orbit_base::UniqueFd listening_socket);
+
+  void AcceptThread();
+  void ReceiveFd(const orbit_base::UniqueFd& connection);
+
+  const std::string socket_path_;
+  const orbit_base::UniqueFd listening_socket_;
+  std::atomic<bool> exit_requested_ = false;
+  std::thread accept_thread_;
+
+  absl::Mutex mutex_;
+  absl::flat_hash_map<uint64_t, ReceivedFd> token_to_received_fd_ ABSL_GUARDED_BY(mutex_);
+  // The tokens in `token_to_received_fd_`, oldest first, so that file descriptors that are never
+  // taken don't accumulate.
+  std::deque<uint64_t> tokens_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace orbit_shared_memory_transport
+
+#endif  // SHARED_MEMORY_TRANSPORT_SHARED_MEMORY_FD_PASSING_H_
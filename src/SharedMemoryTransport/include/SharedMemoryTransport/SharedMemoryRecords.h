@@ -0,0 +1,56 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SHARED_MEMORY_TRANSPORT_SHARED_MEMORY_RECORDS_H_
+#define SHARED_MEMORY_TRANSPORT_SHARED_MEMORY_RECORDS_H_
+
+#include <absl/types/span.h>
+#include <stdint.h>
+
+#include "GrpcProtos/capture.pb.h"
+#include "OrbitBase/Result.h"
+#include "SharedMemoryTransport/SharedMemoryRingBuffer.h"
+
+namespace orbit_shared_memory_transport {
+
+// The types of the records that producers write to a SharedMemoryRingBufferWriter. Each record
+// corresponds to one ProducerCaptureEvent, which OrbitService re-creates with
+// DecodeSharedMemoryRecord.
+enum class SharedMemoryRecordType : uint32_t {
+  kPadding = kPaddingRecordType,
+  // A serialized orbit_grpc_protos::ProducerCaptureEvent, for events without a fixed layout.
+  kProducerCaptureEvent = 1,
+  // An orbit_api::ApiEventRecord serialized with orbit_api::SerializeApiEventRecord.
+  kApiEvent = 2,
+  // A FunctionEntryRecord.
+  kFunctionEntry = 3,
+  // A FunctionExitRecord.
+  kFunctionExit = 4,
+};
+
+// The records don't carry a pid: the events are attributed to the process that passed the ring
+// buffer, as identified by the peer credentials of the socket, so that a producer can't write
+// events on behalf of another process.
+struct FunctionEntryRecord {
+  uint32_t tid;
+  uint64_t function_id;
+  uint64_t stack_pointer;
+  uint64_t return_address;
+  uint64_t timestamp_ns;
+};
+
+struct FunctionExitRecord {
+  uint32_t tid;
+  uint64_t timestamp_ns;
+};
+
+// Fills `capture_event` from the record of type `type` with content `payload`, written by process
+// `pid`, which must come from the peer credentials and not from the payload. Returns an error for unknown types and malformed payloads.
+[[nodiscard]] ErrorMessageOr<void> DecodeSharedMemoryRecord(
+    uint32_t type, absl::Span<const char> payload, uint32_t pid,
+    orbit_grpc_protos::ProducerCaptureEvent* capture_event);
+
+}  // namespace orbit_shared_memory_transport
+
+#endif  // SHARED_MEMORY_TRANSPORT_SHARED_MEMORY_RECORDS_H_
@@ -0,0 +1,151 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SHARED_MEMORY_TRANSPORT_SHARED_MEMORY_RING_BUFFER_H_
+#define SHARED_MEMORY_TRANSPORT_SHARED_MEMORY_RING_BUFFER_H_
+
+#include <absl/functional/function_ref.h>
+#include <absl/types/span.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
+#include "OrbitBase/File.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_shared_memory_transport {
+
+// The layout of the beginning of the shared memory region. The records follow, starting at
+// `kSharedMemoryRingBufferDataOffset`. `write_offset` and `read_offset` only ever increase: the
+// position in the data area is the offset modulo the capacity.
+struct SharedMemoryRingBufferHeader {
+  static constexpr uint64_t kMagic = 0x4f5242495453484dULL;  // "ORBITSHM"
+  static constexpr uint32_t kVersion = 1;
+
+  uint64_t magic;
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t capacity;
+  // Only written by the producer.
+  alignas(64) std::atomic<uint64_t> write_offset;
+  // Only written by the consumer.
+  alignas(64) std::atomic<uint64_t> read_offset;
+};
+
+// The offsets are shared between processes, so they must not rely on a lock.
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+constexpr uint64_t kSharedMemoryRingBufferDataOffset = 192;
+static_assert(sizeof(SharedMemoryRingBufferHeader) <= kSharedMemoryRingBufferDataOffset);
+
+// Each record starts with this header, and is padded so that the next record is 8-byte aligned.
+// A record never wraps around the end of the data area: the space left at the end is instead
+// filled with a record of type `kPaddingRecordType`, which the reader skips.
+struct SharedMemoryRecordHeader {
+  uint32_t size;
+  uint32_t type;
+};
+static_assert(sizeof(SharedMemoryRecordHeader) == 8);
+
+constexpr uint32_t kPaddingRecordType = 0;
+
+// The producer side of a single-producer, single-consumer ring buffer of variable-size records in
+// a shared memory region. Records are written in place with TryBeginRecord and EndRecord, and only
+// become visible to the reader after Publish, so that the cost of the release store is amortized
+// over many records.
+//
+// On Linux the region is backed by a memfd, whose file descriptor is passed to the other process
+// with SendSharedMemoryFd. Shared memory is not supported on other platforms.
+class SharedMemoryRingBufferWriter {
+ public:
+  // `capacity` is the size of the data area. It must be a multiple of 8.
+  [[nodiscard]] static ErrorMessageOr<std::unique_ptr<SharedMemoryRingBufferWriter>> Create(
+      uint64_t capacity);
+
+  ~SharedMemoryRingBufferWriter();
+
+  SharedMemoryRingBufferWriter(const SharedMemoryRingBufferWriter&) = delete;
+  SharedMemoryRingBufferWriter& operator=(const SharedMemoryRingBufferWriter&) = delete;
+  SharedMemoryRingBufferWriter(SharedMemoryRingBufferWriter&&) = delete;
+  SharedMemoryRingBufferWriter& operator=(SharedMemoryRingBufferWriter&&) = delete;
+
+  [[nodiscard]] int fd() const { return fd_.get(); }
+  [[nodiscard]] uint64_t capacity() const { return capacity_; }
+  // The size of the whole shared memory region, including the header.
+  [[nodiscard]] uint64_t GetMappingSize() const {
+    return kSharedMemoryRingBufferDataOffset + capacity_;
+  }
+  // The offset at which the next record will be written. Records before this offset were all
+  // written before this call.
+  [[nodiscard]] uint64_t GetWriteOffset() const { return write_offset_; }
+
+  // The largest payload a record can have.
+  [[nodiscard]] uint64_t GetMaxRecordSize() const {
+    return capacity_ / 2 - sizeof(SharedMemoryRecordHeader);
+  }
+
+  // Returns a buffer of `size` bytes for the payload of a record of type `type`, or nullptr if
+  // there isn't enough free space. The record is only added by the following call to EndRecord.
+  [[nodiscard]] char* TryBeginRecord(uint32_t type, uint32_t size);
+  void EndRecord();
+
+  // Makes all the records ended so far visible to the reader.
+  void Publish();
+
+ private:
+  SharedMemoryRingBufferWriter(orbit_base::UniqueFd fd, char* mapping, uint64_t capacity);
+
+  orbit_base::UniqueFd fd_;
+  char* mapping_;
+  SharedMemoryRingBufferHeader* header_;
+  char* data_;
+  uint64_t capacity_;
+
+  uint64_t write_offset_ = 0;
+  // The read offset last loaded from the header: space before it is known to be free.
+  uint64_t cached_read_offset_ = 0;
+  uint64_t pending_record_size_ = 0;
+};
+
+// The consumer side of SharedMemoryRingBufferWriter, in another process. The content of the region
+// is written by a process that is not trusted: all offsets and sizes are validated, and a
+// corrupted region results in an error rather than in out-of-bounds accesses.
+class SharedMemoryRingBufferReader {
+ public:
+  // Maps the shared memory region that SharedMemoryRingBufferWriter::Create created in another
+  // process, from a file descriptor that the process passed, see SharedMemoryFdPassing.h.
+  [[nodiscard]] static ErrorMessageOr<std::unique_ptr<SharedMemoryRingBufferReader>> OpenFromFd(
+      orbit_base::UniqueFd fd);
+
+  ~SharedMemoryRingBufferReader();
+
+  SharedMemoryRingBufferReader(const SharedMemoryRingBufferReader&) = delete;
+  SharedMemoryRingBufferReader& operator=(const SharedMemoryRingBufferReader&) = delete;
+  SharedMemoryRingBufferReader(SharedMemoryRingBufferReader&&) = delete;
+  SharedMemoryRingBufferReader& operator=(SharedMemoryRingBufferReader&&) = delete;
+
+  // Discards the records before `offset`, which must be the offset of a record that hasn't been
+  // read yet, e.g., SharedMemoryRingBufferWriter::GetWriteOffset at some point.
+  [[nodiscard]] ErrorMessageOr<void> SkipTo(uint64_t offset);
+
+  // Calls `consume_record` with the type and the payload of the published records, in order, and
+  // frees their space for the writer. Returns the number of records read.
+  [[nodiscard]] ErrorMessageOr<size_t> ReadRecords(
+      absl::FunctionRef<void(uint32_t type, absl::Span<const char> payload)> consume_record);
+
+ private:
+  SharedMemoryRingBufferReader(char* mapping, uint64_t capacity);
+
+  char* mapping_;
+  SharedMemoryRingBufferHeader* header_;
+  const char* data_;
+  uint64_t capacity_;
+  uint64_t read_offset_;
+};
+
+}  // namespace orbit_shared_memory_transport
+
+#endif  // SHARED_MEMORY_TRANSPORT_SHARED_MEMORY_RING_BUFFER_H_
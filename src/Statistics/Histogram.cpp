@@ -6,13 +6,17 @@
 
 #include <absl/types/span.h>
 
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <limits>
 #include <optional>
 #include <utility>
+#include <vector>
 
 #include "HistogramUtils.h"
 #include "Statistics/DataSet.h"
+#include "Statistics/QuantileSketch.h"
 
 namespace orbit_statistics {
 
@@ -27,22 +31,15 @@ static Histogram BuildHistogramWithNumberOfBins(const std::optional<DataSet>& da
   return BuildHistogram(data_set.value(), bin_width);
 }
 
-[[nodiscard]] std::optional<Histogram> BuildHistogram(absl::Span<const uint64_t> data) {
-  std::optional<DataSet> data_set = DataSet::Create(data);
-  if (!data_set.has_value()) return std::nullopt;
-
-  // if the data set is extremely large, we surely have enough data
-  // to populate the maximal number of bins.
-  if (data_set->GetData().size() > kVeryLargeDatasetThreshold) {
-    return BuildHistogramWithNumberOfBins(data_set, kLargeNumberOfBins);
-  }
-
+template <typename BuildHistogramWithNumberOfBinsFunction>
+[[nodiscard]] static Histogram BuildHistogramMinimizingRiskScore(
+    BuildHistogramWithNumberOfBinsFunction build_histogram_with_number_of_bins) {
   size_t number_of_bins = 1;
   double best_risk_score = std::numeric_limits<double>::max();
   Histogram best_histogram;
 
   for (uint32_t i = 0; i < kNumberOfBinsGridSize; ++i) {
-    Histogram histogram = BuildHistogramWithNumberOfBins(data_set, number_of_bins);
+    Histogram histogram = build_histogram_with_number_of_bins(number_of_bins);
     double risk_score = HistogramRiskScore(histogram);
     if (risk_score < best_risk_score) {
       best_risk_score = risk_score;
@@ -54,4 +51,75 @@ static Histogram BuildHistogramWithNumberOfBins(const std::optional<DataSet>& da
   return best_histogram;
 }
 
+[[nodiscard]] std::optional<Histogram> BuildHistogram(absl::Span<const uint64_t> data) {
+  std::optional<DataSet> data_set = DataSet::Create(data);
+  if (!data_set.has_value()) return std::nullopt;
+
+  // if the data set is extremely large, we surely have enough data
+  // to populate the maximal number of bins.
+  if (data_set->GetData().size() > kVeryLargeDatasetThreshold) {
+    return BuildHistogramWithNumberOfBins(data_set, kLargeNumberOfBins);
+  }
+
+  return BuildHistogramMinimizingRiskScore([&data_set](size_t number_of_bins) {
+    return BuildHistogramWithNumberOfBins(data_set, number_of_bins);
+  });
+}
+
+// Returns how many of the `bin.count` values, assumed to be spread uniformly over
+// [bin.min, bin.max], are not greater than `value`.
+[[nodiscard]] static uint64_t CountValuesUpTo(const QuantileSketch::Bin& bin, uint64_t value) {
+  if (value < bin.min) return 0;
+  if (value >= bin.max) return bin.count;
+  const double fraction = static_cast<double>(value - bin.min + 1) /
+                          (static_cast<double>(bin.max - bin.min) + 1.0);
+  return static_cast<uint64_t>(std::llround(fraction * static_cast<double>(bin.count)));
+}
+
+static Histogram BuildHistogramWithBinWidth(absl::Span<const QuantileSketch::Bin> bins,
+                                            size_t data_set_size, uint64_t bin_width) {
+  const uint64_t min = bins.front().min;
+  const uint64_t max = bins.back().max;
+  std::vector<size_t> counts((max - min) / bin_width + 1, 0UL);
+  for (const QuantileSketch::Bin& bin : bins) {
+    uint64_t previous_count = 0;
+    for (uint64_t i = (bin.min - min) / bin_width; i <= (bin.max - min) / bin_width; ++i) {
+      const uint64_t count =
+          CountValuesUpTo(bin, min + std::min((i + 1) * bin_width - 1, bin.max - min));
+      counts[i] += count - previous_count;
+      previous_count = count;
+    }
+  }
+  return {min, max, bin_width, data_set_size, std::move(counts)};
+}
+
+[[nodiscard]] std::optional<Histogram> BuildHistogram(const QuantileSketch& sketch,
+                                                      const HistogramSelectionRange& range) {
+  std::vector<QuantileSketch::Bin> bins;
+  size_t data_set_size = 0;
+  for (const QuantileSketch::Bin& bin : sketch.GetBins()) {
+    const uint64_t min = std::max(bin.min, range.min_duration);
+    const uint64_t max = std::min(bin.max, range.max_duration);
+    if (min > max) continue;
+    const uint64_t count =
+        CountValuesUpTo(bin, max) - (min > bin.min ? CountValuesUpTo(bin, min - 1) : 0);
+    if (count == 0) continue;
+    bins.push_back({min, max, count});
+    data_set_size += count;
+  }
+  if (bins.empty()) return std::nullopt;
+
+  const uint64_t min = bins.front().min;
+  const uint64_t max = bins.back().max;
+  return BuildHistogramMinimizingRiskScore([&](size_t number_of_bins) {
+    return BuildHistogramWithBinWidth(bins, data_set_size,
+                                      NumberOfBinsToBinWidth(min, max, number_of_bins));
+  });
+}
+
+[[nodiscard]] std::optional<Histogram> BuildHistogram(const QuantileSketch& sketch) {
+  return BuildHistogram(sketch, {std::numeric_limits<uint64_t>::min(),
+                                 std::numeric_limits<uint64_t>::max()});
+}
+
 }  // namespace orbit_statistics
\ No newline at end of file
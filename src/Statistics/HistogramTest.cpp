@@ -16,6 +16,7 @@
 #include "HistogramUtils.h"
 #include "Statistics/DataSet.h"
 #include "Statistics/Histogram.h"
+#include "Statistics/QuantileSketch.h"
 
 namespace orbit_statistics {
 
@@ -169,4 +170,65 @@ TEST(Histogram, BuildHistogramCorrectlyChoosesTheBinWidth) {
   EXPECT_EQ(hist->counts.size(), 128);
 }
 
+static QuantileSketch CreateSketch(absl::Span<const uint64_t> data) {
+  QuantileSketch sketch;
+  for (uint64_t value : data) {
+    sketch.Add(value);
+  }
+  return sketch;
+}
+
+TEST(Histogram, BuildHistogramFromEmptySketch) {
+  EXPECT_FALSE(BuildHistogram(QuantileSketch{}).has_value());
+}
+
+TEST(Histogram, BuildHistogramFromSketch) {
+  // Small durations fall into buckets of their own, so the sketch knows them exactly.
+  const QuantileSketch sketch = CreateSketch(raw_data_set);
+  std::optional<Histogram> histogram = BuildHistogram(sketch);
+  ASSERT_TRUE(histogram.has_value());
+  EXPECT_EQ(histogram->data_set_size, kDataSetSize);
+  EXPECT_EQ(histogram->min, kMin);
+  EXPECT_EQ(histogram->max, kMax);
+  EXPECT_EQ(std::reduce(histogram->counts.begin(), histogram->counts.end()), kDataSetSize);
+  EXPECT_EQ(histogram->counts,
+            BuildHistogram(DataSet::Create(raw_data_set).value(), histogram->bin_width).counts);
+
+  histogram = BuildHistogram(sketch, HistogramSelectionRange{12, 20});
+  ASSERT_TRUE(histogram.has_value());
+  EXPECT_EQ(histogram->data_set_size, 4);
+  EXPECT_EQ(histogram->min, 12);
+  EXPECT_EQ(histogram->max, 19);
+  EXPECT_EQ(std::reduce(histogram->counts.begin(), histogram->counts.end()), 4);
+
+  EXPECT_FALSE(BuildHistogram(sketch, HistogramSelectionRange{31, 57}).has_value());
+}
+
+TEST(Histogram, BuildHistogramFromSketchSpreadsLargeValuesOverTheirBucket) {
+  constexpr uint64_t kValue = 1'000'000;
+  constexpr size_t kCount = 1000;
+  const QuantileSketch sketch = CreateSketch(std::vector<uint64_t>(kCount, kValue));
+  std::optional<Histogram> histogram = BuildHistogram(sketch);
+  ASSERT_TRUE(histogram.has_value());
+  EXPECT_EQ(histogram->min, kValue);
+  EXPECT_EQ(histogram->max, kValue);
+  EXPECT_EQ(histogram->counts, std::vector<size_t>{kCount});
+
+  // With a second value, the bucket of kValue is no longer clamped to kValue only. A range that
+  // covers part of the bucket gets the corresponding part of its values.
+  std::vector<uint64_t> data(kCount, kValue);
+  data.push_back(2 * kValue);
+  const QuantileSketch wide_sketch = CreateSketch(data);
+  histogram = BuildHistogram(wide_sketch, HistogramSelectionRange{0, kValue + 1'000});
+  ASSERT_TRUE(histogram.has_value());
+  EXPECT_EQ(histogram->min, kValue);
+  EXPECT_GT(histogram->data_set_size, 0);
+  EXPECT_LT(histogram->data_set_size, kCount);
+
+  histogram = BuildHistogram(wide_sketch);
+  ASSERT_TRUE(histogram.has_value());
+  EXPECT_EQ(histogram->data_set_size, kCount + 1);
+  EXPECT_EQ(std::reduce(histogram->counts.begin(), histogram->counts.end()), kCount + 1);
+}
+
 }  // namespace orbit_statistics
\ No newline at end of file
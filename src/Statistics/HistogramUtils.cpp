@@ -41,7 +41,11 @@ namespace orbit_statistics {
 }
 
 [[nodiscard]] uint64_t NumberOfBinsToBinWidth(const DataSet& data_set, size_t bins_num) {
-  const uint64_t width = data_set.GetMax() - data_set.GetMin() + 1;
+  return NumberOfBinsToBinWidth(data_set.GetMin(), data_set.GetMax(), bins_num);
+}
+
+[[nodiscard]] uint64_t NumberOfBinsToBinWidth(uint64_t min, uint64_t max, size_t bins_num) {
+  const uint64_t width = max - min + 1;
   return width / bins_num + ((width % bins_num != 0) ? 1 : 0);
 }
 
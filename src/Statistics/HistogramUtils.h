@@ -24,6 +24,7 @@ namespace orbit_statistics {
                                               uint64_t bin_width);
 
 [[nodiscard]] uint64_t NumberOfBinsToBinWidth(const DataSet& data_set, size_t bins_num);
+[[nodiscard]] uint64_t NumberOfBinsToBinWidth(uint64_t min, uint64_t max, size_t bins_num);
 
 [[nodiscard]] Histogram BuildHistogram(const DataSet& data_set, uint64_t bin_width);
 
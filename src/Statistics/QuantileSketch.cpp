@@ -0,0 +1,154 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "Statistics/QuantileSketch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_statistics {
+
+[[nodiscard]] static uint64_t RoundToUint64(double value) {
+  // 2^64 is exactly representable as a double, while the largest uint64_t is not.
+  constexpr double kTwoToThePowerOf64 = 18446744073709551616.0;
+  if (value >= kTwoToThePowerOf64) return std::numeric_limits<uint64_t>::max();
+  return static_cast<uint64_t>(value);
+}
+
+QuantileSketch::QuantileSketch(double relative_accuracy)
+    : relative_accuracy_{relative_accuracy},
+      gamma_{(1 + relative_accuracy) / (1 - relative_accuracy)},
+      log_gamma_{std::log(gamma_)} {
+  ORBIT_CHECK(relative_accuracy > 0 && relative_accuracy < 1);
+}
+
+int32_t QuantileSketch::ComputeBucketIndex(uint64_t value) const {
+  return static_cast<int32_t>(std::ceil(std::log(static_cast<double>(value)) / log_gamma_));
+}
+
+double QuantileSketch::ComputeBucketUpperBound(int32_t index) const {
+  return std::exp(index * log_gamma_);
+}
+
+uint64_t QuantileSketch::ComputeBucketValue(int32_t index) const {
+  // This value has a relative error of at most `relative_accuracy_` to any value in
+  // (gamma^(index-1), gamma^index].
+  return RoundToUint64(std::round(2 * ComputeBucketUpperBound(index) / (gamma_ + 1)));
+}
+
+uint64_t QuantileSketch::ComputeLargestIntegerInBucket(int32_t index) const {
+  uint64_t value = RoundToUint64(std::floor(ComputeBucketUpperBound(index)));
+  // Correct for the rounding errors of exp and log, so that the bounds agree with the bucket the
+  // values are actually counted in.
+  while (value < std::numeric_limits<uint64_t>::max() && ComputeBucketIndex(value + 1) <= index) {
+    ++value;
+  }
+  while (value > 0 && ComputeBucketIndex(value) > index) {
+    --value;
+  }
+  return value;
+}
+
+void QuantileSketch::EnsureBucketExists(int32_t index) {
+  if (bucket_counts_.empty()) {
+    first_bucket_index_ = index;
+    bucket_counts_.push_back(0);
+    return;
+  }
+  if (index < first_bucket_index_) {
+    bucket_counts_.insert(bucket_counts_.begin(), first_bucket_index_ - index, 0);
+    first_bucket_index_ = index;
+    return;
+  }
+  const auto last_bucket_index =
+      static_cast<int32_t>(first_bucket_index_ + bucket_counts_.size() - 1);
+  if (index > last_bucket_index) {
+    bucket_counts_.resize(bucket_counts_.size() + (index - last_bucket_index), 0);
+  }
+}
+
+void QuantileSketch::Add(uint64_t value) {
+  if (count_ == 0) {
+    min_ = value;
+    max_ = value;
+  } else {
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+  ++count_;
+
+  if (value == 0) {
+    ++zero_count_;
+    return;
+  }
+  const int32_t index = ComputeBucketIndex(value);
+  EnsureBucketExists(index);
+  ++bucket_counts_[index - first_bucket_index_];
+}
+
+void QuantileSketch::Merge(const QuantileSketch& other) {
+  ORBIT_CHECK(relative_accuracy_ == other.relative_accuracy_);
+  if (other.count_ == 0) return;
+  if (count_ == 0) {
+    min_ = other.min_;
+    max_ = other.max_;
+  } else {
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+  count_ += other.count_;
+  zero_count_ += other.zero_count_;
+
+  if (other.bucket_counts_.empty()) return;
+  EnsureBucketExists(other.first_bucket_index_);
+  EnsureBucketExists(static_cast<int32_t>(other.first_bucket_index_ +
+                                          other.bucket_counts_.size() - 1));
+  const size_t offset = other.first_bucket_index_ - first_bucket_index_;
+  for (size_t i = 0; i < other.bucket_counts_.size(); ++i) {
+    bucket_counts_[offset + i] += other.bucket_counts_[i];
+  }
+}
+
+uint64_t QuantileSketch::ComputeQuantile(double quantile) const {
+  if (count_ == 0) return 0;
+  quantile = std::clamp(quantile, 0.0, 1.0);
+  if (quantile == 0) return min_;
+  if (quantile == 1) return max_;
+
+  // The rank of the quantile among the sorted values, as for the nearest-rank method.
+  const auto rank = static_cast<uint64_t>(quantile * static_cast<double>(count_ - 1));
+  if (rank < zero_count_) return 0;
+
+  uint64_t cumulative_count = zero_count_;
+  for (size_t i = 0; i < bucket_counts_.size(); ++i) {
+    cumulative_count += bucket_counts_[i];
+    if (cumulative_count > rank) {
+      const uint64_t value = ComputeBucketValue(static_cast<int32_t>(first_bucket_index_ + i));
+      return std::clamp(value, min_, max_);
+    }
+  }
+  ORBIT_UNREACHABLE();
+}
+
+std::vector<QuantileSketch::Bin> QuantileSketch::GetBins() const {
+  std::vector<Bin> bins;
+  if (zero_count_ > 0) {
+    bins.push_back({0, 0, zero_count_});
+  }
+  for (size_t i = 0; i < bucket_counts_.size(); ++i) {
+    if (bucket_counts_[i] == 0) continue;
+    const auto index = static_cast<int32_t>(first_bucket_index_ + i);
+    // Bucket `index` holds the integers in (gamma^(index-1), gamma^index]. The bounds are clamped
+    // to the values that were actually added.
+    const uint64_t lower_bound = ComputeLargestIntegerInBucket(index - 1) + 1;
+    const uint64_t upper_bound = ComputeLargestIntegerInBucket(index);
+    bins.push_back({std::max(lower_bound, min_), std::min(upper_bound, max_), bucket_counts_[i]});
+  }
+  return bins;
+}
+
+}  // namespace orbit_statistics
@@ -0,0 +1,127 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "Statistics/QuantileSketch.h"
+
+namespace orbit_statistics {
+
+static void ExpectWithinRelativeAccuracy(uint64_t actual, uint64_t expected,
+                                         double relative_accuracy) {
+  EXPECT_LE(std::abs(static_cast<double>(actual) - static_cast<double>(expected)),
+            relative_accuracy * static_cast<double>(expected) + 1)
+      << "actual: " << actual << ", expected: " << expected;
+}
+
+static uint64_t ComputeExactQuantile(const std::vector<uint64_t>& sorted_values,
+                                     double quantile) {
+  return sorted_values[static_cast<size_t>(quantile *
+                                           static_cast<double>(sorted_values.size() - 1))];
+}
+
+TEST(QuantileSketch, IsEmpty) {
+  QuantileSketch sketch;
+  EXPECT_EQ(sketch.count(), 0);
+  EXPECT_EQ(sketch.ComputeQuantile(0.5), 0);
+  EXPECT_TRUE(sketch.GetBins().empty());
+}
+
+TEST(QuantileSketch, SingleValue) {
+  QuantileSketch sketch;
+  sketch.Add(12345);
+  EXPECT_EQ(sketch.count(), 1);
+  EXPECT_EQ(sketch.ComputeQuantile(0), 12345);
+  EXPECT_EQ(sketch.ComputeQuantile(0.5), 12345);
+  EXPECT_EQ(sketch.ComputeQuantile(1), 12345);
+
+  std::vector<QuantileSketch::Bin> bins = sketch.GetBins();
+  ASSERT_EQ(bins.size(), 1);
+  EXPECT_EQ(bins[0].min, 12345);
+  EXPECT_EQ(bins[0].max, 12345);
+  EXPECT_EQ(bins[0].count, 1);
+}
+
+TEST(QuantileSketch, ZeroAndExtremeValues) {
+  QuantileSketch sketch;
+  sketch.Add(0);
+  sketch.Add(0);
+  sketch.Add(1);
+  sketch.Add(std::numeric_limits<uint64_t>::max());
+  EXPECT_EQ(sketch.ComputeQuantile(0), 0);
+  EXPECT_EQ(sketch.ComputeQuantile(0.3), 0);
+  EXPECT_EQ(sketch.ComputeQuantile(0.7), 1);
+  EXPECT_EQ(sketch.ComputeQuantile(1), std::numeric_limits<uint64_t>::max());
+
+  std::vector<QuantileSketch::Bin> bins = sketch.GetBins();
+  ASSERT_EQ(bins.size(), 3);
+  EXPECT_EQ(bins[0].min, 0);
+  EXPECT_EQ(bins[0].count, 2);
+  EXPECT_EQ(bins[1].min, 1);
+  EXPECT_EQ(bins[1].max, 1);
+  EXPECT_EQ(bins[2].max, std::numeric_limits<uint64_t>::max());
+}
+
+TEST(QuantileSketch, QuantilesAreWithinRelativeAccuracy) {
+  std::mt19937_64 generator{42};
+  // Durations spanning several orders of magnitude, as for a typical function.
+  std::lognormal_distribution<double> distribution{10.0, 2.0};
+  std::vector<uint64_t> values;
+  QuantileSketch sketch;
+  for (int i = 0; i < 100'000; ++i) {
+    const auto value = static_cast<uint64_t>(distribution(generator));
+    values.push_back(value);
+    sketch.Add(value);
+  }
+  std::sort(values.begin(), values.end());
+
+  EXPECT_EQ(sketch.count(), values.size());
+  for (double quantile : {0.0, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99, 0.999, 1.0}) {
+    ExpectWithinRelativeAccuracy(sketch.ComputeQuantile(quantile),
+                                 ComputeExactQuantile(values, quantile),
+                                 sketch.relative_accuracy());
+  }
+
+  uint64_t bins_count = 0;
+  uint64_t previous_max = 0;
+  for (const QuantileSketch::Bin& bin : sketch.GetBins()) {
+    EXPECT_LE(bin.min, bin.max);
+    EXPECT_GE(bin.min, previous_max);
+    previous_max = bin.max;
+    bins_count += bin.count;
+  }
+  EXPECT_EQ(bins_count, values.size());
+  EXPECT_EQ(previous_max, values.back());
+}
+
+TEST(QuantileSketch, MergeIsEquivalentToAddingAllValues) {
+  QuantileSketch sketch_low;
+  QuantileSketch sketch_high;
+  QuantileSketch sketch_all;
+  for (uint64_t value = 1; value <= 10'000; ++value) {
+    (value <= 3'000 ? sketch_low : sketch_high).Add(value);
+    sketch_all.Add(value);
+  }
+
+  QuantileSketch merged;
+  merged.Merge(sketch_high);
+  merged.Merge(sketch_low);
+  merged.Merge(QuantileSketch{});
+
+  EXPECT_EQ(merged.count(), sketch_all.count());
+  for (double quantile : {0.0, 0.1, 0.5, 0.9, 0.99, 1.0}) {
+    EXPECT_EQ(merged.ComputeQuantile(quantile), sketch_all.ComputeQuantile(quantile));
+    ExpectWithinRelativeAccuracy(merged.ComputeQuantile(quantile),
+                                 1 + static_cast<uint64_t>(quantile * 9'999),
+                                 merged.relative_accuracy());
+  }
+}
+
+}  // namespace orbit_statistics
@@ -12,6 +12,8 @@
 #include <optional>
 #include <vector>
 
+#include "Statistics/QuantileSketch.h"
+
 namespace orbit_statistics {
 
 // Represents the inclusive range the user has selected on the HistogramWidget.
@@ -38,6 +40,14 @@ struct Histogram {
 // which minimizes it. The histogram will not own the data.
 [[nodiscard]] std::optional<Histogram> BuildHistogram(absl::Span<const uint64_t> data);
 
+// Builds a histogram of the values of `sketch` that lie in `range`, choosing the number of bins as
+// above. The sketch only knows the values up to its relative accuracy, so the values counted in one
+// of its buckets are assumed to be spread uniformly over the bucket. Returns std::nullopt if no
+// value lies in `range`.
+[[nodiscard]] std::optional<Histogram> BuildHistogram(const QuantileSketch& sketch,
+                                                      const HistogramSelectionRange& range);
+[[nodiscard]] std::optional<Histogram> BuildHistogram(const QuantileSketch& sketch);
+
 }  // namespace orbit_statistics
 
 #endif  // STATISTICS_HISTOGRAM_H_
\ No newline at end of file
@@ -0,0 +1,77 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef STATISTICS_QUANTILE_SKETCH_H_
+#define STATISTICS_QUANTILE_SKETCH_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace orbit_statistics {
+
+// A mergeable sketch of a distribution of `uint64_t` values that answers quantile queries with a
+// bounded relative error, using memory that only depends on the ratio between the largest and the
+// smallest value added, not on the number of values (see "DDSketch: A Fast and Fully-Mergeable
+// Quantile Sketch with Relative-Error Guarantees", Masson et al., 2019).
+//
+// Values are counted in logarithmically-sized buckets: bucket `i` holds the values in
+// (gamma^(i-1), gamma^i], with gamma = (1 + relative_accuracy) / (1 - relative_accuracy). Any value
+// returned by `ComputeQuantile` is within `relative_accuracy` of the exact quantile. As the values
+// are at most 2^64, a sketch has fewer than 2300 buckets at the default accuracy of 1%.
+class QuantileSketch {
+ public:
+  static constexpr double kDefaultRelativeAccuracy = 0.01;
+
+  explicit QuantileSketch(double relative_accuracy = kDefaultRelativeAccuracy);
+
+  void Add(uint64_t value);
+  // Adds all the values of `other` to this sketch. Both sketches must have the same accuracy.
+  void Merge(const QuantileSketch& other);
+
+  [[nodiscard]] uint64_t count() const { return count_; }
+  // The exact minimum and maximum of the values added, or zero if the sketch is empty.
+  [[nodiscard]] uint64_t min() const { return min_; }
+  [[nodiscard]] uint64_t max() const { return max_; }
+  [[nodiscard]] double relative_accuracy() const { return relative_accuracy_; }
+
+  // Returns an estimate of the value at `quantile` (between 0 and 1, e.g., 0.99 for the 99th
+  // percentile), or zero if the sketch is empty.
+  [[nodiscard]] uint64_t ComputeQuantile(double quantile) const;
+
+  // A non-empty bucket of the sketch: `count` values were added in the inclusive range [min, max].
+  struct Bin {
+    uint64_t min;
+    uint64_t max;
+    uint64_t count;
+  };
+  // Returns the non-empty buckets of the sketch, ordered by value. They can be used to draw a
+  // histogram with logarithmic bins of the distribution.
+  [[nodiscard]] std::vector<Bin> GetBins() const;
+
+ private:
+  [[nodiscard]] int32_t ComputeBucketIndex(uint64_t value) const;
+  [[nodiscard]] double ComputeBucketUpperBound(int32_t index) const;
+  [[nodiscard]] uint64_t ComputeBucketValue(int32_t index) const;
+  // Returns the largest integer that falls into bucket `index`, or into an earlier bucket.
+  [[nodiscard]] uint64_t ComputeLargestIntegerInBucket(int32_t index) const;
+  void EnsureBucketExists(int32_t index);
+
+  double relative_accuracy_;
+  double gamma_;
+  double log_gamma_;
+
+  uint64_t count_ = 0;
+  // Zero can't be represented in the logarithmic buckets.
+  uint64_t zero_count_ = 0;
+  uint64_t min_ = 0;
+  uint64_t max_ = 0;
+  // `bucket_counts_[i]` holds the count of the bucket with index `first_bucket_index_ + i`.
+  int32_t first_bucket_index_ = 0;
+  std::vector<uint64_t> bucket_counts_;
+};
+
+}  // namespace orbit_statistics
+
+#endif  // STATISTICS_QUANTILE_SKETCH_H_
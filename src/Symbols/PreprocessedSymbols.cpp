@@ -0,0 +1,192 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "Symbols/PreprocessedSymbols.h"
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/strings/str_format.h>
+#include <absl/time/time.h>
+#include <string.h>
+
+#include <algorithm>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+#include "OrbitBase/Align.h"
+#include "OrbitBase/File.h"
+
+using orbit_grpc_protos::ModuleSymbols;
+using orbit_grpc_protos::SymbolInfo;
+
+namespace orbit_symbols {
+
+namespace {
+
+// Layout of the preprocessed symbols, in host byte order:
+//   PreprocessedSymbolsHeader
+//   build id, padded to a multiple of 8 bytes
+//   PreprocessedSymbolRecord[symbol_count], sorted by address
+//   string pool of string_pool_size bytes
+constexpr char kSignature[8] = {'O', 'R', 'B', 'T', 'S', 'Y', 'M', 'S'};
+constexpr uint32_t kVersion = 1;
+
+struct PreprocessedSymbolsHeader {
+  char signature[8];
+  uint32_t version;
+  uint32_t build_id_size;
+  uint64_t load_bias;
+  uint64_t symbols_file_size;
+  int64_t symbols_file_modification_time_ns;
+  uint64_t symbol_count;
+  uint64_t string_pool_size;
+};
+static_assert(sizeof(PreprocessedSymbolsHeader) == 56);
+
+constexpr uint32_t kIsHotpatchableFlag = 1;
+
+struct PreprocessedSymbolRecord {
+  uint64_t address;
+  uint64_t size;
+  uint64_t name_offset;
+  uint32_t name_size;
+  uint32_t flags;
+};
+static_assert(sizeof(PreprocessedSymbolRecord) == 32);
+static_assert(std::is_trivially_copyable_v<PreprocessedSymbolRecord>);
+
+[[nodiscard]] uint64_t GetPaddedBuildIdSize(uint64_t build_id_size) {
+  return orbit_base::AlignUp<8>(build_id_size);
+}
+
+template <typename T>
+void Append(std::string* data, const T& value) {
+  data->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+[[nodiscard]] T Read(std::string_view data, uint64_t offset) {
+  T value;
+  memcpy(&value, data.data() + offset, sizeof(value));
+  return value;
+}
+
+}  // namespace
+
+ErrorMessageOr<PreprocessedSymbolsKey> CreatePreprocessedSymbolsKey(
+    std::string_view build_id, const std::filesystem::path& symbols_file_path,
+    const orbit_object_utils::ObjectFileInfo& object_file_info) {
+  OUTCOME_TRY(const uint64_t symbols_file_size, orbit_base::FileSize(symbols_file_path));
+  OUTCOME_TRY(const absl::Time symbols_file_modification_time,
+              orbit_base::GetFileDateModified(symbols_file_path));
+  PreprocessedSymbolsKey key;
+  key.build_id = build_id;
+  key.load_bias = object_file_info.load_bias;
+  key.symbols_file_size = symbols_file_size;
+  key.symbols_file_modification_time_ns = absl::ToUnixNanos(symbols_file_modification_time);
+  return key;
+}
+
+std::string SerializePreprocessedSymbols(const ModuleSymbols& module_symbols,
+                                         const PreprocessedSymbolsKey& key) {
+  const auto& symbol_infos = module_symbols.symbol_infos();
+  std::vector<int> sorted_indices(symbol_infos.size());
+  std::iota(sorted_indices.begin(), sorted_indices.end(), 0);
+  std::stable_sort(sorted_indices.begin(), sorted_indices.end(),
+                   [&symbol_infos](int lhs, int rhs) {
+                     return symbol_infos[lhs].address() < symbol_infos[rhs].address();
+                   });
+
+  // Overloads and instantiations of templates often share their name, so only store each name once.
+  std::vector<PreprocessedSymbolRecord> records;
+  records.reserve(sorted_indices.size());
+  std::string string_pool;
+  absl::flat_hash_map<std::string_view, uint64_t> name_to_offset;
+  for (int index : sorted_indices) {
+    const SymbolInfo& symbol_info = symbol_infos[index];
+    const std::string& name = symbol_info.demangled_name();
+    auto [it, inserted] = name_to_offset.try_emplace(name, string_pool.size());
+    if (inserted) string_pool.append(name);
+    records.push_back({symbol_info.address(), symbol_info.size(), it->second,
+                       static_cast<uint32_t>(name.size()),
+                       symbol_info.is_hotpatchable() ? kIsHotpatchableFlag : 0});
+  }
+
+  PreprocessedSymbolsHeader header{};
+  memcpy(header.signature, kSignature, sizeof(kSignature));
+  header.version = kVersion;
+  header.build_id_size = key.build_id.size();
+  header.load_bias = key.load_bias;
+  header.symbols_file_size = key.symbols_file_size;
+  header.symbols_file_modification_time_ns = key.symbols_file_modification_time_ns;
+  header.symbol_count = records.size();
+  header.string_pool_size = string_pool.size();
+
+  std::string data;
+  data.reserve(sizeof(header) + GetPaddedBuildIdSize(key.build_id.size()) +
+               records.size() * sizeof(PreprocessedSymbolRecord) + string_pool.size());
+  Append(&data, header);
+  data.append(key.build_id);
+  data.resize(sizeof(header) + GetPaddedBuildIdSize(key.build_id.size()), '\0');
+  data.append(reinterpret_cast<const char*>(records.data()),
+              records.size() * sizeof(PreprocessedSymbolRecord));
+  data.append(string_pool);
+  return data;
+}
+
+ErrorMessageOr<ModuleSymbols> DeserializePreprocessedSymbols(
+    std::string_view data, const PreprocessedSymbolsKey& expected_key) {
+  if (data.size() < sizeof(PreprocessedSymbolsHeader)) {
+    return ErrorMessage("Preprocessed symbols are truncated.");
+  }
+  const auto header = Read<PreprocessedSymbolsHeader>(data, 0);
+  if (memcmp(header.signature, kSignature, sizeof(kSignature)) != 0) {
+    return ErrorMessage("Data are not preprocessed symbols.");
+  }
+  if (header.version != kVersion) {
+    return ErrorMessage(
+        absl::StrFormat("Unsupported version of preprocessed symbols: %u", header.version));
+  }
+
+  const uint64_t records_offset = sizeof(header) + GetPaddedBuildIdSize(header.build_id_size);
+  // Divide rather than multiply to not overflow with corrupted counts.
+  if (records_offset > data.size() ||
+      header.symbol_count > (data.size() - records_offset) / sizeof(PreprocessedSymbolRecord) ||
+      header.string_pool_size != data.size() - records_offset -
+                                     header.symbol_count * sizeof(PreprocessedSymbolRecord)) {
+    return ErrorMessage("Preprocessed symbols are truncated.");
+  }
+
+  PreprocessedSymbolsKey key;
+  key.build_id = data.substr(sizeof(header), header.build_id_size);
+  key.load_bias = header.load_bias;
+  key.symbols_file_size = header.symbols_file_size;
+  key.symbols_file_modification_time_ns = header.symbols_file_modification_time_ns;
+  if (key != expected_key) {
+    return ErrorMessage("Preprocessed symbols were created from a different symbols file.");
+  }
+
+  const uint64_t string_pool_offset =
+      records_offset + header.symbol_count * sizeof(PreprocessedSymbolRecord);
+  const std::string_view string_pool = data.substr(string_pool_offset);
+  ModuleSymbols module_symbols;
+  module_symbols.mutable_symbol_infos()->Reserve(header.symbol_count);
+  for (uint64_t i = 0; i < header.symbol_count; ++i) {
+    const auto record = Read<PreprocessedSymbolRecord>(
+        data, records_offset + i * sizeof(PreprocessedSymbolRecord));
+    if (record.name_offset > string_pool.size() ||
+        record.name_size > string_pool.size() - record.name_offset) {
+      return ErrorMessage("Preprocessed symbols contain an invalid name.");
+    }
+    SymbolInfo* symbol_info = module_symbols.add_symbol_infos();
+    symbol_info->set_demangled_name(
+        std::string{string_pool.substr(record.name_offset, record.name_size)});
+    symbol_info->set_address(record.address);
+    symbol_info->set_size(record.size);
+    symbol_info->set_is_hotpatchable((record.flags & kIsHotpatchableFlag) != 0);
+  }
+  return module_symbols;
+}
+
+}  // namespace orbit_symbols
@@ -0,0 +1,119 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "GrpcProtos/symbol.pb.h"
+#include "Symbols/PreprocessedSymbols.h"
+#include "TestUtils/TestUtils.h"
+
+namespace orbit_symbols {
+
+namespace {
+
+using orbit_grpc_protos::ModuleSymbols;
+using orbit_grpc_protos::SymbolInfo;
+using orbit_test_utils::HasErrorWithMessage;
+using orbit_test_utils::HasNoError;
+
+const PreprocessedSymbolsKey kKey{"0123456789abcdef", 0x10000, 4242, 1'000'000'000};
+
+void AddSymbol(ModuleSymbols* module_symbols, std::string name, uint64_t address, uint64_t size,
+               bool is_hotpatchable = false) {
+  SymbolInfo* symbol_info = module_symbols->add_symbol_infos();
+  symbol_info->set_demangled_name(std::move(name));
+  symbol_info->set_address(address);
+  symbol_info->set_size(size);
+  symbol_info->set_is_hotpatchable(is_hotpatchable);
+}
+
+MATCHER_P4(SymbolInfoIs, name, address, size, is_hotpatchable, "") {
+  const SymbolInfo& symbol_info = arg;
+  return symbol_info.demangled_name() == name && symbol_info.address() == address &&
+         symbol_info.size() == size && symbol_info.is_hotpatchable() == is_hotpatchable;
+}
+
+}  // namespace
+
+TEST(PreprocessedSymbols, RoundTripSortsByAddress) {
+  ModuleSymbols module_symbols;
+  AddSymbol(&module_symbols, "void Foo<int>(int)", 0x3000, 0x10);
+  AddSymbol(&module_symbols, "main", 0x1000, 0x100, true);
+  AddSymbol(&module_symbols, "", 0x4000, 0x8);
+  AddSymbol(&module_symbols, "void Foo<int>(int)", 0x2000, 0x20);
+
+  const std::string data = SerializePreprocessedSymbols(module_symbols, kKey);
+  auto symbols_or_error = DeserializePreprocessedSymbols(data, kKey);
+  ASSERT_THAT(symbols_or_error, HasNoError());
+  EXPECT_THAT(symbols_or_error.value().symbol_infos(),
+              testing::ElementsAre(SymbolInfoIs("main", 0x1000, 0x100, true),
+                                   SymbolInfoIs("void Foo<int>(int)", 0x2000, 0x20, false),
+                                   SymbolInfoIs("void Foo<int>(int)", 0x3000, 0x10, false),
+                                   SymbolInfoIs("", 0x4000, 0x8, false)));
+}
+
+TEST(PreprocessedSymbols, NamesAreOnlyStoredOnce) {
+  const std::string name(1000, 'x');
+  ModuleSymbols one_symbol;
+  AddSymbol(&one_symbol, name, 0x1000, 0x10);
+  ModuleSymbols two_symbols = one_symbol;
+  AddSymbol(&two_symbols, name, 0x2000, 0x10);
+
+  EXPECT_LT(SerializePreprocessedSymbols(two_symbols, kKey).size(),
+            SerializePreprocessedSymbols(one_symbol, kKey).size() + name.size());
+}
+
+TEST(PreprocessedSymbols, EmptySymbols) {
+  const std::string data = SerializePreprocessedSymbols(ModuleSymbols{}, kKey);
+  auto symbols_or_error = DeserializePreprocessedSymbols(data, kKey);
+  ASSERT_THAT(symbols_or_error, HasNoError());
+  EXPECT_TRUE(symbols_or_error.value().symbol_infos().empty());
+}
+
+TEST(PreprocessedSymbols, RejectsDifferentKey) {
+  ModuleSymbols module_symbols;
+  AddSymbol(&module_symbols, "main", 0x1000, 0x100);
+  const std::string data = SerializePreprocessedSymbols(module_symbols, kKey);
+
+  PreprocessedSymbolsKey other_build_id = kKey;
+  other_build_id.build_id = "fedcba9876543210";
+  EXPECT_THAT(DeserializePreprocessedSymbols(data, other_build_id),
+              HasErrorWithMessage("different symbols file"));
+
+  PreprocessedSymbolsKey other_load_bias = kKey;
+  other_load_bias.load_bias = 0;
+  EXPECT_THAT(DeserializePreprocessedSymbols(data, other_load_bias),
+              HasErrorWithMessage("different symbols file"));
+
+  PreprocessedSymbolsKey other_modification_time = kKey;
+  ++other_modification_time.symbols_file_modification_time_ns;
+  EXPECT_THAT(DeserializePreprocessedSymbols(data, other_modification_time),
+              HasErrorWithMessage("different symbols file"));
+}
+
+TEST(PreprocessedSymbols, RejectsMalformedData) {
+  ModuleSymbols module_symbols;
+  AddSymbol(&module_symbols, "main", 0x1000, 0x100);
+  const std::string data = SerializePreprocessedSymbols(module_symbols, kKey);
+
+  EXPECT_THAT(DeserializePreprocessedSymbols("", kKey), HasErrorWithMessage("truncated"));
+  EXPECT_THAT(DeserializePreprocessedSymbols(data.substr(0, data.size() - 1), kKey),
+              HasErrorWithMessage("truncated"));
+  EXPECT_THAT(DeserializePreprocessedSymbols(data + "x", kKey), HasErrorWithMessage("truncated"));
+
+  std::string wrong_signature = data;
+  wrong_signature[0] = 'X';
+  EXPECT_THAT(DeserializePreprocessedSymbols(wrong_signature, kKey),
+              HasErrorWithMessage("not preprocessed symbols"));
+
+  std::string wrong_version = data;
+  wrong_version[8] = 42;
+  EXPECT_THAT(DeserializePreprocessedSymbols(wrong_version, kKey),
+              HasErrorWithMessage("Unsupported version"));
+}
+
+}  // namespace orbit_symbols
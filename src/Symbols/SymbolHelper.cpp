@@ -35,9 +35,11 @@
 #include "OrbitBase/ReadFileToString.h"
 #include "OrbitBase/Result.h"
 #include "OrbitBase/StopSource.h"
+#include "OrbitBase/ThreadUtils.h"
 #include "OrbitBase/WriteStringToFile.h"
 #include "SymbolProvider/StructuredDebugDirectorySymbolProvider.h"
 #include "SymbolProvider/SymbolLoadingOutcome.h"
+#include "Symbols/PreprocessedSymbols.h"
 #include "Symbols/SymbolUtils.h"
 
 using orbit_grpc_protos::ModuleSymbols;
@@ -319,6 +321,58 @@ ErrorMessageOr<orbit_grpc_protos::ModuleSymbols> SymbolHelper::LoadFallbackSymbo
   return object_file->LoadDynamicLinkingSymbolsAndUnwindRangesAsSymbols();
 }
 
+fs::path SymbolHelper::GeneratePreprocessedSymbolsFilePath(std::string_view build_id) const {
+  return cache_directory_ / absl::StrCat(build_id, ".orbit_symbols");
+}
+
+ErrorMessageOr<ModuleSymbols> SymbolHelper::LoadSymbolsFromFileUsingPreprocessedSymbols(
+    const fs::path& file_path, std::string_view build_id,
+    const ObjectFileInfo& object_file_info) const {
+  ORBIT_SCOPE_FUNCTION;
+  if (build_id.empty()) return LoadSymbolsFromFile(file_path, object_file_info);
+  // If this fails, so does loading the symbols from the file, with a better error message.
+  ErrorMessageOr<PreprocessedSymbolsKey> key_or_error =
+      CreatePreprocessedSymbolsKey(build_id, file_path, object_file_info);
+  if (key_or_error.has_error()) return LoadSymbolsFromFile(file_path, object_file_info);
+  const PreprocessedSymbolsKey& key = key_or_error.value();
+
+  const fs::path preprocessed_symbols_path = GeneratePreprocessedSymbolsFilePath(build_id);
+  OUTCOME_TRY(const bool preprocessed_symbols_exist,
+              orbit_base::FileOrDirectoryExists(preprocessed_symbols_path));
+  if (preprocessed_symbols_exist) {
+    ORBIT_SCOPED_TIMED_LOG("Loading preprocessed symbols: %s", preprocessed_symbols_path.string());
+    ErrorMessageOr<std::string> data_or_error =
+        orbit_base::ReadFileToString(preprocessed_symbols_path);
+    ErrorMessageOr<ModuleSymbols> symbols_or_error =
+        data_or_error.has_value() ? DeserializePreprocessedSymbols(data_or_error.value(), key)
+                                  : ErrorMessageOr<ModuleSymbols>{data_or_error.error()};
+    if (symbols_or_error.has_value()) return symbols_or_error;
+    ORBIT_LOG("Not using preprocessed symbols \"%s\": %s", preprocessed_symbols_path.string(),
+              symbols_or_error.error().message());
+  }
+
+  OUTCOME_TRY(ModuleSymbols symbols, LoadSymbolsFromFile(file_path, object_file_info));
+
+  // Write to a temporary file first, so that concurrent loads of the same module never read a
+  // partially written file. Failing to store the preprocessed symbols is not an error.
+  const fs::path temporary_path = absl::StrFormat(
+      "%s.%u.tmp", preprocessed_symbols_path.string(), orbit_base::GetCurrentThreadId());
+  ErrorMessageOr<void> store_result =
+      orbit_base::WriteStringToFile(temporary_path, SerializePreprocessedSymbols(symbols, key));
+  if (store_result.has_value()) {
+    store_result = orbit_base::MoveOrRenameFile(temporary_path, preprocessed_symbols_path);
+  }
+  if (store_result.has_error()) {
+    ORBIT_ERROR("Unable to store preprocessed symbols \"%s\": %s",
+                preprocessed_symbols_path.string(), store_result.error().message());
+    if (ErrorMessageOr<bool> remove_result = orbit_base::RemoveFile(temporary_path);
+        remove_result.has_error()) {
+      ORBIT_ERROR("%s", remove_result.error().message());
+    }
+  }
+  return symbols;
+}
+
 [[nodiscard]] bool SymbolHelper::IsMatchingDebugInfoFile(
     const std::filesystem::path& debuginfo_file_path, uint32_t checksum) {
   std::error_code error;
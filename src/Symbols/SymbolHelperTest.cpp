@@ -6,6 +6,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <filesystem>
@@ -21,6 +22,7 @@
 #include "OrbitBase/Result.h"
 #include "Symbols/SymbolHelper.h"
 #include "Test/Path.h"
+#include "TestUtils/TemporaryDirectory.h"
 #include "TestUtils/TemporaryFile.h"
 #include "TestUtils/TestUtils.h"
 
@@ -447,6 +449,57 @@ TEST(SymbolHelper, LoadSymbolsFromFile) {
   }
 }
 
+TEST(SymbolHelper, LoadSymbolsFromFileUsingPreprocessedSymbols) {
+  const fs::path file_path = orbit_test::GetTestdataDir() / "no_symbols_elf.debug";
+  constexpr std::string_view kBuildId = "b5413574bbacec6eacb3b89b1012d0e2cd92ec6b";
+  auto cache_directory_or_error = orbit_test_utils::TemporaryDirectory::Create();
+  ASSERT_THAT(cache_directory_or_error, HasNoError());
+  const SymbolHelper symbol_helper{cache_directory_or_error.value().GetDirectoryPath(), {}};
+  const fs::path preprocessed_symbols_path =
+      symbol_helper.GeneratePreprocessedSymbolsFilePath(kBuildId);
+
+  const auto expected_symbols_or_error =
+      SymbolHelper::LoadSymbolsFromFile(file_path, ObjectFileInfo{0x10000});
+  ASSERT_THAT(expected_symbols_or_error, HasValue());
+  const ModuleSymbols& expected_symbols = expected_symbols_or_error.value();
+
+  // The first load stores the preprocessed symbols...
+  const auto symbols_or_error = symbol_helper.LoadSymbolsFromFileUsingPreprocessedSymbols(
+      file_path, kBuildId, ObjectFileInfo{0x10000});
+  ASSERT_THAT(symbols_or_error, HasValue());
+  EXPECT_EQ(symbols_or_error.value().symbol_infos_size(), expected_symbols.symbol_infos_size());
+  EXPECT_THAT(orbit_base::FileOrDirectoryExists(preprocessed_symbols_path), HasValue(true));
+
+  // ...which the second load uses.
+  const auto cached_symbols_or_error = symbol_helper.LoadSymbolsFromFileUsingPreprocessedSymbols(
+      file_path, kBuildId, ObjectFileInfo{0x10000});
+  ASSERT_THAT(cached_symbols_or_error, HasValue());
+  // Preprocessed symbols are sorted by address.
+  std::vector<uint64_t> expected_addresses;
+  for (const auto& symbol_info : expected_symbols.symbol_infos()) {
+    expected_addresses.push_back(symbol_info.address());
+  }
+  std::sort(expected_addresses.begin(), expected_addresses.end());
+  std::vector<uint64_t> addresses;
+  for (const auto& symbol_info : cached_symbols_or_error.value().symbol_infos()) {
+    addresses.push_back(symbol_info.address());
+  }
+  EXPECT_EQ(addresses, expected_addresses);
+
+  // Preprocessed symbols for a different load bias are replaced.
+  const auto other_symbols_or_error = symbol_helper.LoadSymbolsFromFileUsingPreprocessedSymbols(
+      file_path, kBuildId, ObjectFileInfo{0x20000});
+  ASSERT_THAT(other_symbols_or_error, HasValue());
+  EXPECT_EQ(other_symbols_or_error.value().symbol_infos_size(),
+            expected_symbols.symbol_infos_size());
+
+  // Errors are the ones of loading from the file.
+  EXPECT_THAT(symbol_helper.LoadSymbolsFromFileUsingPreprocessedSymbols(
+                  orbit_test::GetTestdataDir() / "no_symbols_elf", "other build id",
+                  ObjectFileInfo{0x10000}),
+              HasErrorWithMessage("does not contain symbols"));
+}
+
 TEST(SymbolHelper, LoadFallbackSymbolsFromFile) {
   std::filesystem::path testdata_directory = orbit_test::GetTestdataDir();
   {
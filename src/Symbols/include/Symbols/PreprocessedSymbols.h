@@ -0,0 +1,57 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SYMBOLS_PREPROCESSED_SYMBOLS_H_
+#define SYMBOLS_PREPROCESSED_SYMBOLS_H_
+
+#include <stdint.h>
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+#include "GrpcProtos/symbol.pb.h"
+#include "ObjectUtils/SymbolsFile.h"
+#include "OrbitBase/Result.h"
+
+namespace orbit_symbols {
+
+// Identifies what preprocessed symbols were created from. Preprocessed symbols are only used when
+// the module has the same build id, the symbols file still has the same size and modification
+// time, and the load bias is the same.
+struct PreprocessedSymbolsKey {
+  std::string build_id;
+  uint64_t load_bias = 0;
+  uint64_t symbols_file_size = 0;
+  int64_t symbols_file_modification_time_ns = 0;
+
+  friend bool operator==(const PreprocessedSymbolsKey& lhs, const PreprocessedSymbolsKey& rhs) {
+    return lhs.build_id == rhs.build_id && lhs.load_bias == rhs.load_bias &&
+           lhs.symbols_file_size == rhs.symbols_file_size &&
+           lhs.symbols_file_modification_time_ns == rhs.symbols_file_modification_time_ns;
+  }
+  friend bool operator!=(const PreprocessedSymbolsKey& lhs, const PreprocessedSymbolsKey& rhs) {
+    return !(lhs == rhs);
+  }
+};
+
+[[nodiscard]] ErrorMessageOr<PreprocessedSymbolsKey> CreatePreprocessedSymbolsKey(
+    std::string_view build_id, const std::filesystem::path& symbols_file_path,
+    const orbit_object_utils::ObjectFileInfo& object_file_info);
+
+// Serializes `module_symbols` into a compact binary format: a fixed-size header containing `key`,
+// the symbols as fixed-size records sorted by address, and a pool with the demangled names, each of
+// which is only stored once. All offsets are relative to the start of the data, so the format can
+// be read directly from a memory mapping. See PreprocessedSymbols.cpp for the exact layout.
+[[nodiscard]] std::string SerializePreprocessedSymbols(
+    const orbit_grpc_protos::ModuleSymbols& module_symbols, const PreprocessedSymbolsKey& key);
+
+// Returns an error if `data` is malformed, or if it was not created with `expected_key`. The
+// symbols are returned sorted by address.
+[[nodiscard]] ErrorMessageOr<orbit_grpc_protos::ModuleSymbols> DeserializePreprocessedSymbols(
+    std::string_view data, const PreprocessedSymbolsKey& expected_key);
+
+}  // namespace orbit_symbols
+
+#endif  // SYMBOLS_PREPROCESSED_SYMBOLS_H_
@@ -52,6 +52,16 @@ class SymbolHelper : public SymbolCacheInterface {
   static ErrorMessageOr<orbit_grpc_protos::ModuleSymbols> LoadFallbackSymbolsFromFile(
       const std::filesystem::path& file_path);
 
+  // Like LoadSymbolsFromFile, but first tries the symbols preprocessed from the same symbols file
+  // for the module with `build_id`, which are stored in the cache directory. Otherwise loads the
+  // symbols from `file_path` and stores them preprocessed in the cache directory for next time.
+  [[nodiscard]] ErrorMessageOr<orbit_grpc_protos::ModuleSymbols>
+  LoadSymbolsFromFileUsingPreprocessedSymbols(
+      const std::filesystem::path& file_path, std::string_view build_id,
+      const orbit_object_utils::ObjectFileInfo& object_file_info) const;
+  [[nodiscard]] std::filesystem::path GeneratePreprocessedSymbolsFilePath(
+      std::string_view build_id) const;
+
   [[nodiscard]] static bool IsMatchingDebugInfoFile(const std::filesystem::path& file_path,
                                                     uint32_t checksum);
   [[nodiscard]] static ErrorMessageOr<std::filesystem::path> FindDebugInfoFileLocally(
@@ -4,10 +4,13 @@
 
 #include "AccessTraceesMemory.h"
 
+#include <absl/base/casts.h>
 #include <absl/strings/numbers.h>
 #include <absl/strings/str_format.h>
 #include <absl/strings/str_split.h>
 #include <absl/types/span.h>
+#include <limits.h>
+#include <sys/uio.h>
 
 #include <algorithm>
 #include <string>
@@ -50,6 +53,115 @@ using orbit_base::ReadFileToString;
   return outcome::success();
 }
 
+namespace {
+
+// The maximum number of ranges passed to a single call to process_vm_readv or process_vm_writev.
+constexpr size_t kMaxIovecsPerCall = IOV_MAX;
+
+// Opens /proc/<pid>/mem the first time it is needed, for the accesses that process_vm_readv and
+// process_vm_writev can't do.
+class LazyMemoryFile {
+ public:
+  LazyMemoryFile(pid_t pid, bool for_writing) : pid_{pid}, for_writing_{for_writing} {}
+
+  [[nodiscard]] ErrorMessageOr<const orbit_base::UniqueFd*> Get() {
+    if (!fd_.valid()) {
+      const std::string path = absl::StrFormat("/proc/%d/mem", pid_);
+      OUTCOME_TRY(fd_, for_writing_ ? orbit_base::OpenFileForWriting(path)
+                                    : orbit_base::OpenFileForReading(path));
+    }
+    return &fd_;
+  }
+
+ private:
+  pid_t pid_;
+  bool for_writing_;
+  orbit_base::UniqueFd fd_;
+};
+
+}  // namespace
+
+ErrorMessageOr<std::vector<std::vector<uint8_t>>> ReadTraceesMemory(
+    pid_t pid, absl::Span<const AddressRange> ranges) {
+  std::vector<std::vector<uint8_t>> contents(ranges.size());
+  LazyMemoryFile memory_file{pid, /*for_writing=*/false};
+  std::vector<iovec> local_iovecs;
+  std::vector<iovec> remote_iovecs;
+  for (size_t batch_begin = 0; batch_begin < ranges.size(); batch_begin += kMaxIovecsPerCall) {
+    const size_t batch_end = std::min(batch_begin + kMaxIovecsPerCall, ranges.size());
+    local_iovecs.clear();
+    remote_iovecs.clear();
+    for (size_t i = batch_begin; i < batch_end; ++i) {
+      ORBIT_CHECK(ranges[i].end > ranges[i].start);
+      const uint64_t length = ranges[i].end - ranges[i].start;
+      contents[i].resize(length);
+      local_iovecs.push_back({contents[i].data(), length});
+      remote_iovecs.push_back({absl::bit_cast<void*>(ranges[i].start), length});
+    }
+
+    const ssize_t result = process_vm_readv(pid, local_iovecs.data(), local_iovecs.size(),
+                                            remote_iovecs.data(), remote_iovecs.size(), 0);
+    // process_vm_readv stops at the first range it can't read completely.
+    uint64_t bytes_read = result > 0 ? static_cast<uint64_t>(result) : 0;
+    for (size_t i = batch_begin; i < batch_end; ++i) {
+      const uint64_t length = contents[i].size();
+      if (bytes_read >= length) {
+        bytes_read -= length;
+        continue;
+      }
+      const uint64_t offset = bytes_read;
+      bytes_read = 0;
+      OUTCOME_TRY(const orbit_base::UniqueFd* fd, memory_file.Get());
+      OUTCOME_TRY(const size_t read_size, ReadFullyAtOffset(*fd, contents[i].data() + offset,
+                                                            length - offset,
+                                                            ranges[i].start + offset));
+      if (read_size < length - offset) {
+        return ErrorMessage(absl::StrFormat(
+            "Failed to read %u bytes at %#x from memory of process %d. Only got %u bytes.",
+            length, ranges[i].start, pid, offset + read_size));
+      }
+    }
+  }
+  return contents;
+}
+
+ErrorMessageOr<void> WriteTraceesMemory(pid_t pid, absl::Span<const TraceesMemoryWrite> writes) {
+  LazyMemoryFile memory_file{pid, /*for_writing=*/true};
+  std::vector<iovec> local_iovecs;
+  std::vector<iovec> remote_iovecs;
+  for (size_t batch_begin = 0; batch_begin < writes.size(); batch_begin += kMaxIovecsPerCall) {
+    const size_t batch_end = std::min(batch_begin + kMaxIovecsPerCall, writes.size());
+    local_iovecs.clear();
+    remote_iovecs.clear();
+    for (size_t i = batch_begin; i < batch_end; ++i) {
+      const std::vector<uint8_t>& bytes = writes[i].bytes;
+      ORBIT_CHECK(!bytes.empty());
+      // process_vm_writev doesn't modify the local buffers.
+      local_iovecs.push_back({const_cast<uint8_t*>(bytes.data()), bytes.size()});
+      remote_iovecs.push_back({absl::bit_cast<void*>(writes[i].address), bytes.size()});
+    }
+
+    const ssize_t result = process_vm_writev(pid, local_iovecs.data(), local_iovecs.size(),
+                                             remote_iovecs.data(), remote_iovecs.size(), 0);
+    // process_vm_writev stops at the first range it can't write completely, e.g., because the
+    // memory is not writable. Do the remaining writes through /proc/<pid>/mem.
+    uint64_t bytes_written = result > 0 ? static_cast<uint64_t>(result) : 0;
+    for (size_t i = batch_begin; i < batch_end; ++i) {
+      const std::vector<uint8_t>& bytes = writes[i].bytes;
+      if (bytes_written >= bytes.size()) {
+        bytes_written -= bytes.size();
+        continue;
+      }
+      const uint64_t offset = bytes_written;
+      bytes_written = 0;
+      OUTCOME_TRY(const orbit_base::UniqueFd* fd, memory_file.Get());
+      OUTCOME_TRY(WriteFullyAtOffset(*fd, bytes.data() + offset, bytes.size() - offset,
+                                     writes[i].address + offset));
+    }
+  }
+  return outcome::success();
+}
+
 [[nodiscard]] ErrorMessageOr<AddressRange> GetExistingExecutableMemoryRegion(
     pid_t pid, uint64_t exclude_address) {
   OUTCOME_TRY(auto&& maps, ReadFileToString(absl::StrFormat("/proc/%d/maps", pid)));
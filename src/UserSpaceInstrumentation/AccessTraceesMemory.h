@@ -27,6 +27,29 @@ namespace orbit_user_space_instrumentation {
 [[nodiscard]] ErrorMessageOr<void> WriteTraceesMemory(pid_t pid, uint64_t start_address,
                                                       absl::Span<const uint8_t> bytes);
 
+// A write of `bytes` into the memory of a tracee, starting from `address`.
+struct TraceesMemoryWrite {
+  uint64_t address;
+  std::vector<uint8_t> bytes;
+};
+
+// Reads the memory ranges `ranges` of process `pid`, and returns their contents in the same order.
+// Contrary to calling the function above for each range, this reads up to IOV_MAX ranges with a
+// single call to process_vm_readv, and only falls back to reading /proc/<pid>/mem for the ranges
+// that process_vm_readv could not read.
+// Assumes we are already attached to the tracee `pid` e.g. using `AttachAndStopProcess`.
+[[nodiscard]] ErrorMessageOr<std::vector<std::vector<uint8_t>>> ReadTraceesMemory(
+    pid_t pid, absl::Span<const AddressRange> ranges);
+
+// Performs all `writes` into the memory of process `pid`, in order. Contrary to calling the
+// function above for each write, this performs up to IOV_MAX writes with a single call to
+// process_vm_writev. As process_vm_writev respects the protection of the tracee's memory, the
+// writes it can't do, e.g., to read-only code, are done through /proc/<pid>/mem, which is only
+// opened once.
+// Assumes we are already attached to the tracee `pid` e.g. using `AttachAndStopProcess`.
+[[nodiscard]] ErrorMessageOr<void> WriteTraceesMemory(pid_t pid,
+                                                      absl::Span<const TraceesMemoryWrite> writes);
+
 // Returns the address range of an executable memory region. One options is usually the second line
 // in the `maps` file corresponding to the code of the process we look at. However we don't really
 // care. So keeping it general and just searching for an executable region is probably helping
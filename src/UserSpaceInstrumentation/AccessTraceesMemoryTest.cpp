@@ -233,4 +233,78 @@ TEST(AccessTraceesMemoryTest, ReadWriteRestore) {
   waitpid(pid, nullptr, 0);
 }
 
+
+TEST(AccessTraceesMemoryTest, BatchedReadWriteRestore) {
+  pid_t pid = fork();
+  ORBIT_CHECK(pid != -1);
+  if (pid == 0) {
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+
+    // Child just runs an endless loop.
+    volatile uint64_t counter = 0;
+    while (true) {
+      // Endless loops without side effects are UB and recent versions of clang optimize it away.
+      ++counter;
+    }
+  }
+
+  // Stop the child process using our tooling.
+  ORBIT_CHECK(!AttachAndStopProcess(pid).has_error());
+
+  // The executable region is usually not writable, so this also covers writing through
+  // /proc/<pid>/mem after process_vm_writev failed.
+  auto memory_region_or_error = GetExistingExecutableMemoryRegion(pid);
+  ORBIT_CHECK(memory_region_or_error.has_value());
+  const uint64_t address = memory_region_or_error.value().start;
+
+  constexpr uint64_t kRangeCount = 16;
+  constexpr uint64_t kRangeSize = 20;
+  constexpr uint64_t kRangeDistance = 64;
+  std::vector<AddressRange> ranges;
+  for (uint64_t i = 0; i < kRangeCount; ++i) {
+    const uint64_t start = address + i * kRangeDistance;
+    ranges.emplace_back(start, start + kRangeSize);
+  }
+  auto backup_or_error = ReadTraceesMemory(pid, ranges);
+  ASSERT_TRUE(backup_or_error.has_value());
+  ASSERT_EQ(backup_or_error.value().size(), kRangeCount);
+  for (uint64_t i = 0; i < kRangeCount; ++i) {
+    auto expected_or_error = ReadTraceesMemory(pid, ranges[i].start, kRangeSize);
+    ASSERT_TRUE(expected_or_error.has_value());
+    EXPECT_EQ(backup_or_error.value()[i], expected_or_error.value());
+  }
+
+  std::mt19937 engine{std::random_device()()};
+  std::uniform_int_distribution<uint32_t> distribution{0x00, 0xff};
+  std::vector<TraceesMemoryWrite> writes;
+  for (const AddressRange& range : ranges) {
+    std::vector<uint8_t> new_data(kRangeSize);
+    std::generate(std::begin(new_data), std::end(new_data), [&distribution, &engine]() {
+      return static_cast<uint8_t>(distribution(engine));
+    });
+    writes.push_back({range.start, std::move(new_data)});
+  }
+  ASSERT_FALSE(WriteTraceesMemory(pid, writes).has_error());
+
+  auto read_back_or_error = ReadTraceesMemory(pid, ranges);
+  ASSERT_TRUE(read_back_or_error.has_value());
+  for (uint64_t i = 0; i < kRangeCount; ++i) {
+    EXPECT_EQ(read_back_or_error.value()[i], writes[i].bytes);
+  }
+
+  // Reading from a bad address fails.
+  ranges.emplace_back(0, kRangeSize);
+  EXPECT_THAT(ReadTraceesMemory(pid, ranges), HasErrorWithMessage("Input/output error"));
+
+  // Restore, detach and end child.
+  std::vector<TraceesMemoryWrite> restore_writes;
+  for (uint64_t i = 0; i < kRangeCount; ++i) {
+    restore_writes.push_back({ranges[i].start, backup_or_error.value()[i]});
+  }
+  ORBIT_CHECK(WriteTraceesMemory(pid, restore_writes).has_value());
+  ORBIT_CHECK(!DetachAndContinueProcess(pid).has_error());
+  kill(pid, SIGKILL);
+  waitpid(pid, nullptr, 0);
+}
+
 }  // namespace orbit_user_space_instrumentation
\ No newline at end of file
@@ -0,0 +1,51 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef USER_SPACE_INSTRUMENTATION_FUNCTION_ENTRY_EXIT_EVENT_H_
+#define USER_SPACE_INSTRUMENTATION_FUNCTION_ENTRY_EXIT_EVENT_H_
+
+#include <stdint.h>
+
+#include <type_traits>
+
+namespace orbit_user_space_instrumentation {
+
+// The event enqueued by EntryPayload and ExitPayload, later translated to an
+// orbit_grpc_protos::FunctionEntry or orbit_grpc_protos::FunctionExit. Don't use those protos
+// directly: while in memory they are basically plain structs as their fields are all integer
+// fields, their constructors and assignment operators are more complicated, and spend a lot of time
+// in InternalSwap. Contrary to a std::variant of two structs, this is trivially copyable and
+// needs no visitation, and it doesn't store the pid, which is the same for all events.
+struct FunctionEntryExitEvent {
+  enum class Type : uint32_t { kFunctionEntry, kFunctionExit };
+
+  [[nodiscard]] static FunctionEntryExitEvent CreateFunctionEntry(uint32_t tid,
+                                                                  uint64_t function_id,
+                                                                  uint64_t stack_pointer,
+                                                                  uint64_t return_address,
+                                                                  uint64_t timestamp_ns) {
+    return {tid, Type::kFunctionEntry, function_id, stack_pointer, return_address, timestamp_ns};
+  }
+
+  [[nodiscard]] static FunctionEntryExitEvent CreateFunctionExit(uint32_t tid,
+                                                                 uint64_t timestamp_ns) {
+    return {tid, Type::kFunctionExit, 0, 0, 0, timestamp_ns};
+  }
+
+  uint32_t tid;
+  Type type;
+  // Only set for kFunctionEntry.
+  uint64_t function_id;
+  uint64_t stack_pointer;
+  uint64_t return_address;
+
+  uint64_t timestamp_ns;
+};
+
+static_assert(std::is_trivially_copyable_v<FunctionEntryExitEvent>);
+static_assert(sizeof(FunctionEntryExitEvent) == 40, "FunctionEntryExitEvent should be 40 bytes.");
+
+}  // namespace orbit_user_space_instrumentation
+
+#endif  // USER_SPACE_INSTRUMENTATION_FUNCTION_ENTRY_EXIT_EVENT_H_
@@ -8,6 +8,8 @@
 #include <absl/container/flat_hash_set.h>
 #include <absl/meta/type_traits.h>
 #include <absl/strings/str_format.h>
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
 #include <absl/types/span.h>
 #include <capstone/capstone.h>
 #include <dlfcn.h>
@@ -99,6 +101,14 @@ ErrorMessageOr<bool> AlreadyInjected(absl::Span<const ModuleInfo> modules) {
   return false;
 }
 
+[[nodiscard]] uint64_t GetTotalSize(absl::Span<const TraceesMemoryWrite> writes) {
+  uint64_t total_size = 0;
+  for (const TraceesMemoryWrite& write : writes) {
+    total_size += write.bytes.size();
+  }
+  return total_size;
+}
+
 // We need to initialize some thread local memory when entering the payload functions. This leads to
 // a situation where instrumenting the functions below would lead to a recursive call into the
 // instrumentation. We just skip these and leave instrumenting them to the kernel/uprobe fallback.
@@ -495,6 +505,7 @@ ErrorMessageOr<InstrumentationManager::InstrumentationResult>
 InstrumentedProcess::InstrumentFunctions(const CaptureOptions& capture_options,
                                          absl::Span<const ModuleInfo> modules) {
   ORBIT_LOG("Instrumenting functions in process %d", pid_);
+  const absl::Time stop_begin = absl::Now();
   OUTCOME_TRY(AttachAndStopProcess(pid_));
   orbit_base::unique_resource detach_on_exit{pid_, [](int32_t pid) {
                                                if (DetachAndContinueProcess(pid).has_error()) {
@@ -528,6 +539,28 @@ InstrumentedProcess::InstrumentFunctions(const CaptureOptions& capture_options,
 
   ORBIT_LOG("Trying to instrument %d functions", capture_options.instrumented_functions().size());
   InstrumentationManager::InstrumentationResult result;
+
+  // The process is stopped while we instrument, and accessing its memory is the expensive part.
+  // So instead of instrumenting one function after the other, we first collect the functions to
+  // instrument, read the code of all the functions that don't have a trampoline yet at once, build
+  // their trampolines locally, and finally write all trampolines and all jumps into the
+  // trampolines in a few large, vectored writes.
+  struct FunctionToInstrument {
+    uint64_t function_id;
+    uint64_t function_address;
+    const std::string* function_name;
+  };
+  std::vector<FunctionToInstrument> functions_to_instrument;
+  struct TrampolineToCreate {
+    uint64_t function_address;
+    uint64_t function_size;
+    AddressRange module_address_range;
+    uint64_t function_id;
+    const std::string* function_name;
+  };
+  std::vector<TrampolineToCreate> trampolines_to_create;
+  absl::flat_hash_set<uint64_t> addresses_of_trampolines_to_create;
+
   absl::flat_hash_map<std::string, std::vector<ModuleInfo>> cache_of_modules_from_path;
   for (const auto& function : capture_options.instrumented_functions()) {
     const uint64_t function_id = function.function_id();
@@ -554,73 +587,166 @@ InstrumentedProcess::InstrumentFunctions(const CaptureOptions& capture_options,
       const uint64_t function_address = orbit_module_utils::SymbolVirtualAddressToAbsoluteAddress(
           function.function_virtual_address(), module.address_start(), module.load_bias(),
           module.executable_segment_offset());
-      if (!trampoline_map_.contains(function_address)) {
-        const AddressRange module_address_range(module.address_start(), module.address_end());
-        auto trampoline_address_or_error = GetTrampolineMemory(module_address_range);
-        if (trampoline_address_or_error.has_error()) {
-          ORBIT_ERROR("Failed to allocate memory for trampoline: %s",
-                      trampoline_address_or_error.error().message());
-          continue;
-        }
-        const uint64_t trampoline_address = trampoline_address_or_error.value();
-        // We need the machine code of the function for two purposes: We need to relocate the
-        // instructions that get overwritten into the trampoline and we also need to check if the
-        // function contains a jump back into the first five bytes (which would prohibit
-        // instrumentation). For the first reason 20 bytes would be enough; the 200 is chosen
-        // somewhat arbitrarily to cover all cases of jumps into the first five bytes we encountered
-        // in the wild. Specifically this covers all relative jumps to a signed 8 bit offset.
-        // Compare the comment of CheckForRelativeJumpIntoFirstFiveBytes in Trampoline.cpp.
-        constexpr uint64_t kMaxFunctionReadSize = 200;
-        const uint64_t function_read_size =
-            std::min(kMaxFunctionReadSize, function.function_size());
-        OUTCOME_TRY(auto&& function_data,
-                    ReadTraceesMemory(pid_, function_address, function_read_size));
-        auto address_after_prologue_or_error =
-            CreateTrampoline(pid_, function_address, function_data, trampoline_address,
-                             entry_payload_function_address_, return_trampoline_address_,
-                             capstone_handle, relocation_map_);
-        if (address_after_prologue_or_error.has_error()) {
-          const std::string message = absl::StrFormat(
-              "Can't instrument function \"%s\". Failed to create trampoline: %s",
-              function.function_name(), address_after_prologue_or_error.error().message());
-          ORBIT_ERROR("%s", message);
-          result.function_ids_to_error_messages[function_id] = message;
-          OUTCOME_TRY(ReleaseMostRecentlyAllocatedTrampolineMemory(module_address_range));
-          continue;
-        }
-        TrampolineData trampoline_data;
-        trampoline_data.trampoline_address = trampoline_address;
-        // We'll overwrite the first five bytes of the function and the rest of the instruction that
-        // we clobbered. Since we'll need to restore that when we remove the instrumentation we need
-        // a backup.
-        constexpr uint64_t kMaxFunctionBackupSize = 20;
-        const uint64_t function_backup_size =
-            std::min(kMaxFunctionBackupSize, function.function_size());
-        OUTCOME_TRY(auto&& function_backup_data,
-                    ReadTraceesMemory(pid_, function_address, function_backup_size));
-        trampoline_data.function_data = function_backup_data;
-        trampoline_data.address_after_prologue = address_after_prologue_or_error.value();
-        trampoline_map_.emplace(function_address, trampoline_data);
+      if (!trampoline_map_.contains(function_address) &&
+          addresses_of_trampolines_to_create.insert(function_address).second) {
+        trampolines_to_create.push_back(
+            {function_address, function.function_size(),
+             AddressRange(module.address_start(), module.address_end()), function_id,
+             &function.function_name()});
       }
-      auto it = trampoline_map_.find(function_address);
-      if (it == trampoline_map_.end()) {
-        continue;
+      functions_to_instrument.push_back({function_id, function_address, &function.function_name()});
+    }
+  }
+
+  // We need the machine code of the function for two purposes: We need to relocate the
+  // instructions that get overwritten into the trampoline and we also need to check if the
+  // function contains a jump back into the first five bytes (which would prohibit
+  // instrumentation). For the first reason 20 bytes would be enough; the 200 is chosen
+  // somewhat arbitrarily to cover all cases of jumps into the first five bytes we encountered
+  // in the wild. Specifically this covers all relative jumps to a signed 8 bit offset.
+  // Compare the comment of CheckForRelativeJumpIntoFirstFiveBytes in Trampoline.cpp.
+  constexpr uint64_t kMaxFunctionReadSize = 200;
+  std::vector<AddressRange> function_ranges_to_read;
+  function_ranges_to_read.reserve(trampolines_to_create.size());
+  for (const TrampolineToCreate& trampoline_to_create : trampolines_to_create) {
+    const uint64_t function_read_size =
+        std::min(kMaxFunctionReadSize, trampoline_to_create.function_size);
+    const uint64_t function_address = trampoline_to_create.function_address;
+    function_ranges_to_read.emplace_back(function_address, function_address + function_read_size);
+  }
+  OUTCOME_TRY(std::vector<std::vector<uint8_t>> functions_data,
+              ReadTraceesMemory(pid_, function_ranges_to_read));
+
+  struct CreatedTrampoline {
+    const TrampolineToCreate* trampoline_to_create;
+    TrampolineData trampoline_data;
+  };
+  std::vector<CreatedTrampoline> created_trampolines;
+  std::vector<TraceesMemoryWrite> trampoline_writes;
+  for (size_t i = 0; i < trampolines_to_create.size(); ++i) {
+    const TrampolineToCreate& trampoline_to_create = trampolines_to_create[i];
+    const uint64_t function_address = trampoline_to_create.function_address;
+    auto trampoline_address_or_error =
+        GetTrampolineMemory(trampoline_to_create.module_address_range);
+    if (trampoline_address_or_error.has_error()) {
+      ORBIT_ERROR("Failed to allocate memory for trampoline: %s",
+                  trampoline_address_or_error.error().message());
+      continue;
+    }
+    const uint64_t trampoline_address = trampoline_address_or_error.value();
+    const std::vector<uint8_t>& function_data = functions_data[i];
+    ErrorMessageOr<TrampolineCode> trampoline_code_or_error =
+        BuildTrampoline(function_address, function_data, trampoline_address,
+                        entry_payload_function_address_, return_trampoline_address_,
+                        capstone_handle, relocation_map_);
+    if (trampoline_code_or_error.has_error()) {
+      const std::string message = absl::StrFormat(
+          "Can't instrument function \"%s\". Failed to create trampoline: %s",
+          *trampoline_to_create.function_name, trampoline_code_or_error.error().message());
+      ORBIT_ERROR("%s", message);
+      result.function_ids_to_error_messages[trampoline_to_create.function_id] = message;
+      OUTCOME_TRY(
+          ReleaseMostRecentlyAllocatedTrampolineMemory(trampoline_to_create.module_address_range));
+      continue;
+    }
+    TrampolineData trampoline_data;
+    trampoline_data.trampoline_address = trampoline_address;
+    // We'll overwrite the first five bytes of the function and the rest of the instruction that
+    // we clobbered. Since we'll need to restore that when we remove the instrumentation we need
+    // a backup.
+    constexpr uint64_t kMaxFunctionBackupSize = 20;
+    const uint64_t function_backup_size =
+        std::min<uint64_t>(kMaxFunctionBackupSize, function_data.size());
+    trampoline_data.function_data.assign(function_data.begin(),
+                                         function_data.begin() + function_backup_size);
+    trampoline_data.address_after_prologue =
+        trampoline_code_or_error.value().address_after_prologue;
+    created_trampolines.push_back({&trampoline_to_create, std::move(trampoline_data)});
+    trampoline_writes.push_back(
+        {trampoline_address, std::move(trampoline_code_or_error.value().code)});
+  }
+
+  // Only use the trampolines once they have been written. If that fails, none of the new
+  // trampolines can be used: give their memory back, in the reverse order of the allocations, and
+  // forget the relocations into them, so that no instruction pointer is moved into them.
+  if (ErrorMessageOr<void> write_result = WriteTraceesMemory(pid_, trampoline_writes);
+      write_result.has_error()) {
+    for (auto it = created_trampolines.rbegin(); it != created_trampolines.rend(); ++it) {
+      const TrampolineToCreate& trampoline_to_create = *it->trampoline_to_create;
+      const std::string message = absl::StrFormat(
+          "Can't instrument function \"%s\". Failed to write trampoline: %s",
+          *trampoline_to_create.function_name, write_result.error().message());
+      ORBIT_ERROR("%s", message);
+      result.function_ids_to_error_messages[trampoline_to_create.function_id] = message;
+      for (uint64_t address = trampoline_to_create.function_address;
+           address < it->trampoline_data.address_after_prologue; ++address) {
+        relocation_map_.erase(address);
       }
-      const TrampolineData& trampoline_data = it->second;
+      OUTCOME_TRY(
+          ReleaseMostRecentlyAllocatedTrampolineMemory(trampoline_to_create.module_address_range));
+    }
+    created_trampolines.clear();
+    trampoline_writes.clear();
+  }
+  for (CreatedTrampoline& created_trampoline : created_trampolines) {
+    trampoline_map_.emplace(created_trampoline.trampoline_to_create->function_address,
+                            std::move(created_trampoline.trampoline_data));
+  }
 
-      auto result_or_error = InstrumentFunction(pid_, function_address, function_id,
-                                                trampoline_data.address_after_prologue,
-                                                trampoline_data.trampoline_address);
-      if (result_or_error.has_error()) {
+  std::vector<FunctionToInstrument> functions_with_trampoline;
+  std::vector<TraceesMemoryWrite> jump_to_trampoline_writes;
+  std::vector<TraceesMemoryWrite> function_id_writes;
+  for (const FunctionToInstrument& function : functions_to_instrument) {
+    auto it = trampoline_map_.find(function.function_address);
+    if (it == trampoline_map_.end()) {
+      continue;
+    }
+    const TrampolineData& trampoline_data = it->second;
+
+    auto writes_or_error = GetInstrumentFunctionWrites(
+        function.function_address, function.function_id, trampoline_data.address_after_prologue,
+        trampoline_data.trampoline_address);
+    if (writes_or_error.has_error()) {
+      const std::string message =
+          absl::StrFormat("Can't instrument function \"%s\": %s", *function.function_name,
+                          writes_or_error.error().message());
+      ORBIT_ERROR("%s", message);
+      result.function_ids_to_error_messages[function.function_id] = message;
+      continue;
+    }
+    functions_with_trampoline.push_back(function);
+    jump_to_trampoline_writes.push_back(std::move(writes_or_error.value().jump_to_trampoline));
+    function_id_writes.push_back(std::move(writes_or_error.value().function_id));
+  }
+
+  // Hand over the function ids to the trampolines before jumping into them.
+  if (WriteTraceesMemory(pid_, function_id_writes).has_value() &&
+      WriteTraceesMemory(pid_, jump_to_trampoline_writes).has_value()) {
+    for (const FunctionToInstrument& function : functions_with_trampoline) {
+      addresses_of_instrumented_functions_.insert(function.function_address);
+      result.instrumented_function_ids.insert(function.function_id);
+    }
+  } else {
+    // Some write failed. Redo the writes function by function to find out which functions we could
+    // instrument. Repeating the writes that already succeeded is harmless.
+    for (size_t i = 0; i < functions_with_trampoline.size(); ++i) {
+      const FunctionToInstrument& function = functions_with_trampoline[i];
+      ErrorMessageOr<void> write_result =
+          WriteTraceesMemory(pid_, function_id_writes[i].address, function_id_writes[i].bytes);
+      if (write_result.has_value()) {
+        write_result = WriteTraceesMemory(pid_, jump_to_trampoline_writes[i].address,
+                                          jump_to_trampoline_writes[i].bytes);
+      }
+      if (write_result.has_error()) {
         const std::string message =
-            absl::StrFormat("Can't instrument function \"%s\": %s", function.function_name(),
-                            result_or_error.error().message());
+            absl::StrFormat("Can't instrument function \"%s\": %s", *function.function_name,
+                            write_result.error().message());
         ORBIT_ERROR("%s", message);
-        result.function_ids_to_error_messages[function_id] = message;
-      } else {
-        addresses_of_instrumented_functions_.insert(function_address);
-        result.instrumented_function_ids.insert(function_id);
+        result.function_ids_to_error_messages[function.function_id] = message;
+        continue;
       }
+      addresses_of_instrumented_functions_.insert(function.function_address);
+      result.instrumented_function_ids.insert(function.function_id);
     }
   }
   ORBIT_LOG("Successfully instrumented %d functions", result.instrumented_function_ids.size());
@@ -634,6 +760,13 @@ InstrumentedProcess::InstrumentFunctions(const CaptureOptions& capture_options,
 
   OUTCOME_TRY(EnsureTrampolinesExecutable());
 
+  result.stop_duration = absl::Now() - stop_begin;
+  ORBIT_LOG("Process %d was stopped for %.3f ms to instrument %d functions (%u bytes written)",
+            pid_, absl::ToDoubleMilliseconds(result.stop_duration),
+            result.instrumented_function_ids.size(),
+            GetTotalSize(trampoline_writes) + GetTotalSize(function_id_writes) +
+                GetTotalSize(jump_to_trampoline_writes));
+
   return result;
 }
 
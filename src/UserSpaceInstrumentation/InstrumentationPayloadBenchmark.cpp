@@ -0,0 +1,188 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <benchmark/benchmark.h>
+#include <google/protobuf/arena.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stack>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "CaptureEventProducer/LockFreeBufferCaptureEventProducer.h"
+#include "CaptureEventProducer/PerThreadBufferCaptureEventProducer.h"
+#include "FunctionEntryExitEvent.h"
+#include "GrpcProtos/capture.pb.h"
+#include "OpenFunctionCallStack.h"
+#include "OrbitBase/Profiling.h"
+#include "OrbitBase/ThreadUtils.h"
+
+// These benchmarks measure the overhead that EntryPayload and ExitPayload of
+// OrbitUserSpaceInstrumentation.cpp add to each call of an instrumented function while a capture
+// is running: taking the timestamps, keeping track of the open function call, and enqueuing the
+// entry and exit events. Each iteration is one instrumented call, so with real time the time per
+// iteration is the time per instrumented call in each thread. The producers are not connected to
+// OrbitService: instead of the forwarder thread, a thread dequeues the events concurrently and
+// discards them.
+
+namespace orbit_user_space_instrumentation {
+
+namespace {
+
+constexpr size_t kMaxEventsPerDequeue = 10'000;
+constexpr uint64_t kFunctionId = 42;
+constexpr uint64_t kReturnAddress = 0x1234;
+
+// The previous implementation, kept as a baseline: a std::stack of OpenFunctionCalls, and a single
+// moodycamel::ConcurrentQueue of std::variant of the two events for all threads.
+struct LegacyFunctionEntry {
+  uint32_t pid;
+  uint32_t tid;
+  uint64_t function_id;
+  uint64_t stack_pointer;
+  uint64_t return_address;
+  uint64_t timestamp_ns;
+};
+
+struct LegacyFunctionExit {
+  uint32_t pid;
+  uint32_t tid;
+  uint64_t timestamp_ns;
+};
+
+using LegacyFunctionEntryExitVariant = std::variant<LegacyFunctionEntry, LegacyFunctionExit>;
+
+class ConcurrentQueueEventProducer
+    : public orbit_capture_event_producer::LockFreeBufferCaptureEventProducer<
+          LegacyFunctionEntryExitVariant> {
+ public:
+  using LockFreeBufferCaptureEventProducer<
+      LegacyFunctionEntryExitVariant>::DequeueIntermediateEvents;
+  using IntermediateEvent = LegacyFunctionEntryExitVariant;
+
+  void InstrumentedCall(uint32_t pid, uint32_t tid, uint64_t stack_pointer) {
+    thread_local std::stack<OpenFunctionCall> open_function_calls;
+    const uint64_t timestamp_on_entry_ns = orbit_base::CaptureTimestampNs();
+    open_function_calls.push({kReturnAddress, timestamp_on_entry_ns});
+    EnqueueIntermediateEvent(LegacyFunctionEntry{pid, tid, kFunctionId, stack_pointer,
+                                                 kReturnAddress, timestamp_on_entry_ns});
+
+    const uint64_t timestamp_on_exit_ns = orbit_base::CaptureTimestampNs();
+    const OpenFunctionCall open_function_call = open_function_calls.top();
+    open_function_calls.pop();
+    benchmark::DoNotOptimize(open_function_call);
+    EnqueueIntermediateEvent(LegacyFunctionExit{pid, tid, timestamp_on_exit_ns});
+  }
+
+ protected:
+  orbit_grpc_protos::ProducerCaptureEvent* TranslateIntermediateEvent(
+      LegacyFunctionEntryExitVariant&& /*intermediate_event*/,
+      google::protobuf::Arena* /*arena*/) override {
+    return nullptr;
+  }
+};
+
+// The current implementation: an OpenFunctionCallStack, and a buffer of FunctionEntryExitEvents
+// per thread.
+class PerThreadBufferEventProducer
+    : public orbit_capture_event_producer::PerThreadBufferCaptureEventProducer<
+          FunctionEntryExitEvent> {
+ public:
+  using PerThreadBufferCaptureEventProducer<FunctionEntryExitEvent>::DequeueIntermediateEvents;
+  using IntermediateEvent = FunctionEntryExitEvent;
+
+  PerThreadBufferEventProducer() : PerThreadBufferCaptureEventProducer{16 * 1024} {}
+
+  void InstrumentedCall(uint32_t /*pid*/, uint32_t tid, uint64_t stack_pointer) {
+    thread_local OpenFunctionCallStack open_function_calls;
+    const uint64_t timestamp_on_entry_ns = orbit_base::CaptureTimestampNs();
+    if (!open_function_calls.TryPush(kReturnAddress, timestamp_on_entry_ns)) return;
+    EnqueueIntermediateEvent(FunctionEntryExitEvent::CreateFunctionEntry(
+        tid, kFunctionId, stack_pointer, kReturnAddress, timestamp_on_entry_ns));
+
+    const uint64_t timestamp_on_exit_ns = orbit_base::CaptureTimestampNs();
+    const OpenFunctionCall open_function_call = open_function_calls.Pop();
+    benchmark::DoNotOptimize(open_function_call);
+    EnqueueIntermediateEvent(FunctionEntryExitEvent::CreateFunctionExit(tid, timestamp_on_exit_ns));
+  }
+
+ protected:
+  orbit_grpc_protos::ProducerCaptureEvent* TranslateIntermediateEvent(
+      FunctionEntryExitEvent&& /*intermediate_event*/,
+      google::protobuf::Arena* /*arena*/) override {
+    return nullptr;
+  }
+};
+
+// Dequeues and discards the events of `producer` in a separate thread until destroyed.
+template <typename Producer>
+class ConcurrentDequeuer {
+ public:
+  explicit ConcurrentDequeuer(Producer* producer)
+      : thread_{[this, producer] {
+          std::vector<typename Producer::IntermediateEvent> events(kMaxEventsPerDequeue);
+          while (!exit_requested_) {
+            if (producer->DequeueIntermediateEvents(events.data(), kMaxEventsPerDequeue) == 0) {
+              std::this_thread::yield();
+            }
+          }
+        }} {}
+
+  ~ConcurrentDequeuer() {
+    exit_requested_ = true;
+    thread_.join();
+  }
+
+  ConcurrentDequeuer(const ConcurrentDequeuer&) = delete;
+  ConcurrentDequeuer& operator=(const ConcurrentDequeuer&) = delete;
+
+ private:
+  std::atomic<bool> exit_requested_ = false;
+  std::thread thread_;
+};
+
+template <typename Producer>
+void RunInstrumentedCallBenchmark(benchmark::State& state, Producer* producer) {
+  std::unique_ptr<ConcurrentDequeuer<Producer>> dequeuer;
+  if (state.thread_index() == 0) {
+    dequeuer = std::make_unique<ConcurrentDequeuer<Producer>>(producer);
+  }
+
+  static const uint32_t pid = orbit_base::GetCurrentProcessId();
+  const uint32_t tid = orbit_base::GetCurrentThreadId();
+  uint64_t stack_slot = 0;
+  for (auto _ : state) {
+    producer->InstrumentedCall(pid, tid, reinterpret_cast<uint64_t>(&stack_slot));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// The producers are shared by all the threads of a benchmark and outlive them.
+
+void BM_InstrumentedCallWithStdStackAndConcurrentQueue(benchmark::State& state) {
+  static ConcurrentQueueEventProducer producer;
+  RunInstrumentedCallBenchmark(state, &producer);
+}
+
+void BM_InstrumentedCallWithFixedStackAndPerThreadBuffers(benchmark::State& state) {
+  static PerThreadBufferEventProducer producer;
+  const uint64_t overflow_event_count_before = producer.GetOverflowEventCount();
+  RunInstrumentedCallBenchmark(state, &producer);
+  // Events go to the slower overflow queues when the dequeuing thread doesn't keep up with the
+  // enqueuing threads.
+  if (state.thread_index() == 0) {
+    state.counters["overflow_events"] =
+        static_cast<double>(producer.GetOverflowEventCount() - overflow_event_count_before);
+  }
+}
+
+}  // namespace
+
+BENCHMARK(BM_InstrumentedCallWithStdStackAndConcurrentQueue)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_InstrumentedCallWithFixedStackAndPerThreadBuffers)->ThreadRange(1, 16)->UseRealTime();
+
+}  // namespace orbit_user_space_instrumentation
@@ -0,0 +1,60 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef USER_SPACE_INSTRUMENTATION_OPEN_FUNCTION_CALL_STACK_H_
+#define USER_SPACE_INSTRUMENTATION_OPEN_FUNCTION_CALL_STACK_H_
+
+#include <absl/base/optimization.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+
+#include "OrbitBase/Logging.h"
+
+namespace orbit_user_space_instrumentation {
+
+struct OpenFunctionCall {
+  uint64_t return_address;
+  uint64_t timestamp_on_entry_ns;
+};
+
+// The amount of data we store for each call is relevant for the overall performance. The assert is
+// here for awareness and to avoid packing issues in the struct.
+static_assert(sizeof(OpenFunctionCall) == 16, "OpenFunctionCall should be 16 bytes.");
+
+// Stack of the instrumented function calls of a thread that haven't returned yet, used to restore
+// their return addresses. Contrary to std::stack, it never allocates and pushing and popping are
+// just an index update, which matters as this happens on every instrumented call. It is meant to be
+// a thread_local: as it is zero-initialized, it needs no dynamic initialization.
+class OpenFunctionCallStack {
+ public:
+  // Deeper nesting of instrumented functions, e.g., in a recursion, is not recorded.
+  static constexpr size_t kCapacity = 2048;
+
+  // Returns false if the stack is full. In that case the call must not be instrumented, as its
+  // return address couldn't be restored.
+  [[nodiscard]] bool TryPush(uint64_t return_address, uint64_t timestamp_on_entry_ns) {
+    if (ABSL_PREDICT_FALSE(size_ == kCapacity)) return false;
+    open_function_calls_[size_] = {return_address, timestamp_on_entry_ns};
+    ++size_;
+    return true;
+  }
+
+  [[nodiscard]] OpenFunctionCall Pop() {
+    ORBIT_DCHECK(size_ > 0);
+    --size_;
+    return open_function_calls_[size_];
+  }
+
+  [[nodiscard]] size_t size() const { return size_; }
+
+ private:
+  size_t size_ = 0;
+  std::array<OpenFunctionCall, kCapacity> open_function_calls_{};
+};
+
+}  // namespace orbit_user_space_instrumentation
+
+#endif  // USER_SPACE_INSTRUMENTATION_OPEN_FUNCTION_CALL_STACK_H_
@@ -0,0 +1,46 @@
+// Copyright (c) 2023 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "OpenFunctionCallStack.h"
+
+namespace orbit_user_space_instrumentation {
+
+TEST(OpenFunctionCallStack, PopReturnsCallsInReverseOrder) {
+  OpenFunctionCallStack stack;
+  EXPECT_EQ(stack.size(), 0);
+  EXPECT_TRUE(stack.TryPush(0x100, 1));
+  EXPECT_TRUE(stack.TryPush(0x200, 2));
+  EXPECT_EQ(stack.size(), 2);
+
+  OpenFunctionCall call = stack.Pop();
+  EXPECT_EQ(call.return_address, 0x200);
+  EXPECT_EQ(call.timestamp_on_entry_ns, 2);
+  EXPECT_TRUE(stack.TryPush(0x300, 3));
+  call = stack.Pop();
+  EXPECT_EQ(call.return_address, 0x300);
+  call = stack.Pop();
+  EXPECT_EQ(call.return_address, 0x100);
+  EXPECT_EQ(call.timestamp_on_entry_ns, 1);
+  EXPECT_EQ(stack.size(), 0);
+}
+
+TEST(OpenFunctionCallStack, PushFailsWhenFull) {
+  OpenFunctionCallStack stack;
+  for (uint64_t i = 0; i < OpenFunctionCallStack::kCapacity; ++i) {
+    EXPECT_TRUE(stack.TryPush(i, i));
+  }
+  EXPECT_FALSE(stack.TryPush(0xdead, 0));
+  EXPECT_EQ(stack.size(), OpenFunctionCallStack::kCapacity);
+
+  // The calls pushed before the stack was full are still there.
+  EXPECT_EQ(stack.Pop().return_address, OpenFunctionCallStack::kCapacity - 1);
+  EXPECT_TRUE(stack.TryPush(0xbeef, 0));
+  EXPECT_EQ(stack.Pop().return_address, 0xbeef);
+}
+
+}  // namespace orbit_user_space_instrumentation
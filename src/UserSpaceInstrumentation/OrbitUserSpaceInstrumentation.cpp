@@ -4,37 +4,31 @@
 
 #include "OrbitUserSpaceInstrumentation.h"
 
+#include <absl/base/optimization.h>
+#include <absl/functional/function_ref.h>
 #include <google/protobuf/arena.h>
+#include <string.h>
 
-#include <algorithm>
-#include <stack>
 #include <utility>
-#include <variant>
 
-#include "CaptureEventProducer/LockFreeBufferCaptureEventProducer.h"
+#include "CaptureEventProducer/PerThreadBufferCaptureEventProducer.h"
+#include "FunctionEntryExitEvent.h"
 #include "GrpcProtos/capture.pb.h"
-#include "OrbitBase/Overloaded.h"
+#include "OpenFunctionCallStack.h"
 #include "OrbitBase/Profiling.h"
 #include "OrbitBase/ThreadUtils.h"
 #include "ProducerSideChannel/ProducerSideChannel.h"
+#include "SharedMemoryTransport/SharedMemoryRecords.h"
 
 using orbit_base::CaptureTimestampNs;
+using orbit_user_space_instrumentation::FunctionEntryExitEvent;
+using orbit_user_space_instrumentation::OpenFunctionCall;
+using orbit_user_space_instrumentation::OpenFunctionCallStack;
 
 namespace {
 
-struct OpenFunctionCall {
-  OpenFunctionCall(uint64_t return_address, uint64_t timestamp_on_entry_ns)
-      : return_address(return_address), timestamp_on_entry_ns(timestamp_on_entry_ns) {}
-  uint64_t return_address;
-  uint64_t timestamp_on_entry_ns;
-};
-
-// The amount of data we store for each call is relevant for the overall performance. The assert is
-// here for awareness and to avoid packing issues in the struct.
-static_assert(sizeof(OpenFunctionCall) == 16, "OpenFunctionCall should be 16 bytes.");
-
-std::stack<OpenFunctionCall>& GetOpenFunctionCallStack() {
-  thread_local std::stack<OpenFunctionCall> open_function_calls;
+OpenFunctionCallStack& GetOpenFunctionCallStack() {
+  thread_local OpenFunctionCallStack open_function_calls;
   return open_function_calls;
 }
 
@@ -42,47 +36,20 @@ uint64_t current_capture_start_timestamp_ns = 0;
 
 pid_t orbit_threads[] = {-1, -1, -1, -1, -1, -1};
 
-// Don't use the orbit_grpc_protos::FunctionEntry and orbit_grpc_protos::FunctionExit protos
-// directly. While in memory those protos are basically plain structs as their fields are all
-// integer fields, their constructors and assignment operators are more complicated, and spend a lot
-// of time in InternalSwap.
-struct FunctionEntry {
-  FunctionEntry() = default;
-  FunctionEntry(uint32_t pid, uint32_t tid, uint64_t function_id, uint64_t stack_pointer,
-                uint64_t return_address, uint64_t timestamp_ns)
-      : pid{pid},
-        tid{tid},
-        function_id{function_id},
-        stack_pointer{stack_pointer},
-        return_address{return_address},
-        timestamp_ns{timestamp_ns} {}
-  uint32_t pid;
-  uint32_t tid;
-  uint64_t function_id;
-  uint64_t stack_pointer;
-  uint64_t return_address;
-  uint64_t timestamp_ns;
-};
-
-struct FunctionExit {
-  FunctionExit() = default;
-  FunctionExit(uint32_t pid, uint32_t tid, uint64_t timestamp_ns)
-      : pid{pid}, tid{tid}, timestamp_ns{timestamp_ns} {}
-  uint32_t pid;
-  uint32_t tid;
-  uint64_t timestamp_ns;
-};
-
-using FunctionEntryExitVariant = std::variant<FunctionEntry, FunctionExit>;
-
-// This class is used to enqueue FunctionEntry and FunctionExit events from multiple threads,
-// transform them into orbit_grpc_protos::FunctionEntry and orbit_grpc_protos::FunctionExit protos,
-// and relay them to OrbitService.
+// This class is used to enqueue FunctionEntryExitEvents from multiple threads, transform them into
+// orbit_grpc_protos::FunctionEntry and orbit_grpc_protos::FunctionExit protos, and relay them to
+// OrbitService. Each thread enqueues its events in its own buffer, and the forwarder thread
+// dequeues them in bulk, so that instrumented threads don't contend with each other.
 class LockFreeUserSpaceInstrumentationEventProducer
-    : public orbit_capture_event_producer::LockFreeBufferCaptureEventProducer<
-          FunctionEntryExitVariant> {
+    : public orbit_capture_event_producer::PerThreadBufferCaptureEventProducer<
+          FunctionEntryExitEvent> {
  public:
-  LockFreeUserSpaceInstrumentationEventProducer() {
+  // Instrumented functions can be called millions of times per second: use larger buffers than the
+  // default, so that the forwarder thread can empty them before they are full.
+  static constexpr size_t kThreadBufferCapacity = 16 * 1024;
+
+  LockFreeUserSpaceInstrumentationEventProducer()
+      : PerThreadBufferCaptureEventProducer{kThreadBufferCapacity} {
     BuildAndStart(orbit_producer_side_channel::CreateProducerSideChannel());
   }
 
@@ -90,36 +57,60 @@ class LockFreeUserSpaceInstrumentationEventProducer
 
  protected:
   [[nodiscard]] orbit_grpc_protos::ProducerCaptureEvent* TranslateIntermediateEvent(
-      FunctionEntryExitVariant&& raw_event, google::protobuf::Arena* arena) override {
+      FunctionEntryExitEvent&& raw_event, google::protobuf::Arena* arena) override {
     auto* capture_event =
         google::protobuf::Arena::CreateMessage<orbit_grpc_protos::ProducerCaptureEvent>(arena);
 
-    std::visit(
-        orbit_base::Overloaded{[capture_event](const FunctionEntry& raw_event) -> void {
-                                 orbit_grpc_protos::FunctionEntry* function_entry =
-                                     capture_event->mutable_function_entry();
-                                 function_entry->set_pid(raw_event.pid);
-                                 function_entry->set_tid(raw_event.tid);
-                                 function_entry->set_function_id(raw_event.function_id);
-                                 function_entry->set_stack_pointer(raw_event.stack_pointer);
-                                 function_entry->set_return_address(raw_event.return_address);
-                                 function_entry->set_timestamp_ns(raw_event.timestamp_ns);
-                               },
-                               [capture_event](const FunctionExit& raw_event) -> void {
-                                 orbit_grpc_protos::FunctionExit* function_exit =
-                                     capture_event->mutable_function_exit();
-                                 function_exit->set_pid(raw_event.pid);
-                                 function_exit->set_tid(raw_event.tid);
-                                 function_exit->set_timestamp_ns(raw_event.timestamp_ns);
-                               }},
-        raw_event);
+    switch (raw_event.type) {
+      case FunctionEntryExitEvent::Type::kFunctionEntry: {
+        orbit_grpc_protos::FunctionEntry* function_entry = capture_event->mutable_function_entry();
+        function_entry->set_pid(pid_);
+        function_entry->set_tid(raw_event.tid);
+        function_entry->set_function_id(raw_event.function_id);
+        function_entry->set_stack_pointer(raw_event.stack_pointer);
+        function_entry->set_return_address(raw_event.return_address);
+        function_entry->set_timestamp_ns(raw_event.timestamp_ns);
+      } break;
+      case FunctionEntryExitEvent::Type::kFunctionExit: {
+        orbit_grpc_protos::FunctionExit* function_exit = capture_event->mutable_function_exit();
+        function_exit->set_pid(pid_);
+        function_exit->set_tid(raw_event.tid);
+        function_exit->set_timestamp_ns(raw_event.timestamp_ns);
+      } break;
+    }
 
     return capture_event;
   }
 
+  void WriteSharedMemoryRecord(
+      FunctionEntryExitEvent&& raw_event, google::protobuf::Arena* /*arena*/,
+      absl::FunctionRef<char*(orbit_shared_memory_transport::SharedMemoryRecordType type,
+                              uint64_t size)>
+          begin_record) override {
+    switch (raw_event.type) {
+      case FunctionEntryExitEvent::Type::kFunctionEntry: {
+        const orbit_shared_memory_transport::FunctionEntryRecord record{
+            raw_event.tid,
+            raw_event.function_id,
+            raw_event.stack_pointer,
+            raw_event.return_address,
+            raw_event.timestamp_ns};
+        char* payload = begin_record(
+            orbit_shared_memory_transport::SharedMemoryRecordType::kFunctionEntry, sizeof(record));
+        if (payload != nullptr) memcpy(payload, &record, sizeof(record));
+      } break;
+      case FunctionEntryExitEvent::Type::kFunctionExit: {
+        const orbit_shared_memory_transport::FunctionExitRecord record{raw_event.tid,
+                                                                      raw_event.timestamp_ns};
+        char* payload = begin_record(
+            orbit_shared_memory_transport::SharedMemoryRecordType::kFunctionExit, sizeof(record));
+        if (payload != nullptr) memcpy(payload, &record, sizeof(record));
+      } break;
+    }
+  }
+
  private:
-  template <class>
-  [[maybe_unused]] static constexpr bool kAlwaysFalseV = false;
+  const uint32_t pid_ = orbit_base::GetCurrentProcessId();
 };
 
 LockFreeUserSpaceInstrumentationEventProducer& GetCaptureEventProducer() {
@@ -179,14 +170,19 @@ bool& GetIsInPayload() {
 
   const uint64_t timestamp_on_entry_ns = CaptureTimestampNs();
 
-  std::stack<OpenFunctionCall>& open_function_call_stack = GetOpenFunctionCallStack();
-  open_function_call_stack.emplace(return_address, timestamp_on_entry_ns);
+  // If the stack is full, leave the return address untouched so that this call simply doesn't go
+  // through ExitPayload.
+  if (ABSL_PREDICT_FALSE(
+          !GetOpenFunctionCallStack().TryPush(return_address, timestamp_on_entry_ns))) {
+    is_in_payload = false;
+    return;
+  }
 
-  if (GetCaptureEventProducer().IsCapturing()) {
-    static const uint32_t kPid = orbit_base::GetCurrentProcessId();
-    GetCaptureEventProducer().EnqueueIntermediateEvent(
-        FunctionEntry{kPid, orbit_base::FromNativeThreadId(kTid), function_id, stack_pointer,
-                      return_address, timestamp_on_entry_ns});
+  LockFreeUserSpaceInstrumentationEventProducer& producer = GetCaptureEventProducer();
+  if (producer.IsCapturing()) {
+    thread_local const uint32_t kTidForEvents = orbit_base::FromNativeThreadId(kTid);
+    producer.EnqueueIntermediateEvent(FunctionEntryExitEvent::CreateFunctionEntry(
+        kTidForEvents, function_id, stack_pointer, return_address, timestamp_on_entry_ns));
   }
 
   // Overwrite return address so that we end up returning to the exit trampoline.
@@ -200,18 +196,16 @@ bool& GetIsInPayload() {
   is_in_payload = true;
 
   const uint64_t timestamp_on_exit_ns = CaptureTimestampNs();
-  std::stack<OpenFunctionCall>& open_function_call_stack = GetOpenFunctionCallStack();
-  OpenFunctionCall current_function_call = open_function_call_stack.top();
-  open_function_call_stack.pop();
+  const OpenFunctionCall current_function_call = GetOpenFunctionCallStack().Pop();
 
   // Skip emitting an event if we are not capturing or if the function call doesn't fully belong to
   // this capture.
-  if (GetCaptureEventProducer().IsCapturing() &&
+  LockFreeUserSpaceInstrumentationEventProducer& producer = GetCaptureEventProducer();
+  if (producer.IsCapturing() &&
       current_capture_start_timestamp_ns < current_function_call.timestamp_on_entry_ns) {
-    static uint32_t pid = orbit_base::GetCurrentProcessId();
-    thread_local uint32_t tid = orbit_base::GetCurrentThreadId();
-    GetCaptureEventProducer().EnqueueIntermediateEvent(
-        FunctionExit{pid, tid, timestamp_on_exit_ns});
+    thread_local const uint32_t kTid = orbit_base::GetCurrentThreadId();
+    producer.EnqueueIntermediateEvent(
+        FunctionEntryExitEvent::CreateFunctionExit(kTid, timestamp_on_exit_ns));
   }
 
   is_in_payload = false;
@@ -1169,12 +1169,10 @@ uint64_t GetMaxTrampolineSize() {
   return kTrampolineSize;
 }
 
-ErrorMessageOr<uint64_t> CreateTrampoline(pid_t pid, uint64_t function_address,
-                                          absl::Span<const uint8_t> function,
-                                          uint64_t trampoline_address,
-                                          uint64_t entry_payload_function_address,
-                                          uint64_t return_trampoline_address, csh capstone_handle,
-                                          absl::flat_hash_map<uint64_t, uint64_t>& relocation_map) {
+ErrorMessageOr<TrampolineCode> BuildTrampoline(
+    uint64_t function_address, absl::Span<const uint8_t> function, uint64_t trampoline_address,
+    uint64_t entry_payload_function_address, uint64_t return_trampoline_address,
+    csh capstone_handle, absl::flat_hash_map<uint64_t, uint64_t>& relocation_map) {
   const bool harmful_jump =
       CheckForRelativeJumpIntoFirstFiveBytes(function_address, function, capstone_handle);
   if (harmful_jump) {
@@ -1197,14 +1195,27 @@ ErrorMessageOr<uint64_t> CreateTrampoline(pid_t pid, uint64_t function_address,
   // Add code for jump from trampoline back into function.
   OUTCOME_TRY(AppendJumpBackCode(address_after_prologue, trampoline_address, trampoline));
 
+  return TrampolineCode{trampoline.GetResultAsVector(), address_after_prologue};
+}
+
+ErrorMessageOr<uint64_t> CreateTrampoline(pid_t pid, uint64_t function_address,
+                                          absl::Span<const uint8_t> function,
+                                          uint64_t trampoline_address,
+                                          uint64_t entry_payload_function_address,
+                                          uint64_t return_trampoline_address, csh capstone_handle,
+                                          absl::flat_hash_map<uint64_t, uint64_t>& relocation_map) {
+  OUTCOME_TRY(TrampolineCode trampoline,
+              BuildTrampoline(function_address, function, trampoline_address,
+                              entry_payload_function_address, return_trampoline_address,
+                              capstone_handle, relocation_map));
+
   // Copy trampoline into tracee.
-  auto write_result_or_error =
-      WriteTraceesMemory(pid, trampoline_address, trampoline.GetResultAsVector());
+  auto write_result_or_error = WriteTraceesMemory(pid, trampoline_address, trampoline.code);
   if (write_result_or_error.has_error()) {
     return write_result_or_error.error();
   }
 
-  return address_after_prologue;
+  return trampoline.address_after_prologue;
 }
 
 uint64_t GetReturnTrampolineSize() {
@@ -1235,6 +1246,18 @@ ErrorMessageOr<void> CreateReturnTrampoline(pid_t pid, uint64_t exit_payload_fun
 ErrorMessageOr<void> InstrumentFunction(pid_t pid, uint64_t function_address, uint64_t function_id,
                                         uint64_t address_after_prologue,
                                         uint64_t trampoline_address) {
+  OUTCOME_TRY(InstrumentFunctionWrites writes,
+              GetInstrumentFunctionWrites(function_address, function_id, address_after_prologue,
+                                          trampoline_address));
+  OUTCOME_TRY(WriteTraceesMemory(pid, writes.jump_to_trampoline.address,
+                                 writes.jump_to_trampoline.bytes));
+  OUTCOME_TRY(WriteTraceesMemory(pid, writes.function_id.address, writes.function_id.bytes));
+  return outcome::success();
+}
+
+ErrorMessageOr<InstrumentFunctionWrites> GetInstrumentFunctionWrites(
+    uint64_t function_address, uint64_t function_id, uint64_t address_after_prologue,
+    uint64_t trampoline_address) {
   MachineCode jump;
   jump.AppendBytes({0xe9});
   ErrorMessageOr<int32_t> offset_or_error =
@@ -1253,15 +1276,15 @@ ErrorMessageOr<void> InstrumentFunction(pid_t pid, uint64_t function_address, ui
   while (jump.GetResultAsVector().size() < address_after_prologue - function_address) {
     jump.AppendBytes({0x90});
   }
-  OUTCOME_TRY(WriteTraceesMemory(pid, function_address, jump.GetResultAsVector()));
 
   // Patch the trampoline to hand over the current function_id to the entry payload.
   MachineCode function_id_as_bytes;
   function_id_as_bytes.AppendImmediate64(function_id);
-  OUTCOME_TRY(WriteTraceesMemory(pid, trampoline_address + kOffsetOfFunctionIdInCallToEntryPayload,
-                                 function_id_as_bytes.GetResultAsVector()));
 
-  return outcome::success();
+  return InstrumentFunctionWrites{
+      {function_address, jump.GetResultAsVector()},
+      {trampoline_address + kOffsetOfFunctionIdInCallToEntryPayload,
+       function_id_as_bytes.GetResultAsVector()}};
 }
 
 void MoveInstructionPointersOutOfOverwrittenCode(
@@ -16,6 +16,7 @@
 #include <optional>
 #include <vector>
 
+#include "AccessTraceesMemory.h"
 #include "AllocateInTracee.h"
 #include "OrbitBase/Result.h"
 #include "UserSpaceInstrumentation/AddressRange.h"
@@ -137,6 +138,21 @@ struct RelocatedInstruction {
     uint64_t return_trampoline_address, csh capstone_handle,
     absl::flat_hash_map<uint64_t, uint64_t>& relocation_map);
 
+// The machine code of a trampoline built by `BuildTrampoline`, and the address of the first
+// instruction of the function that was not relocated into the trampoline.
+struct TrampolineCode {
+  std::vector<uint8_t> code;
+  uint64_t address_after_prologue = 0;
+};
+
+// Same as `CreateTrampoline` but returns the code of the trampoline instead of writing it into the
+// tracee, so that the trampolines of many functions can be written at once, with the
+// `WriteTraceesMemory` overload that takes a span of `TraceesMemoryWrite`s.
+[[nodiscard]] ErrorMessageOr<TrampolineCode> BuildTrampoline(
+    uint64_t function_address, absl::Span<const uint8_t> function, uint64_t trampoline_address,
+    uint64_t entry_payload_function_address, uint64_t return_trampoline_address,
+    csh capstone_handle, absl::flat_hash_map<uint64_t, uint64_t>& relocation_map);
+
 // As above with `GetMaxTrampolineSize` this is a compile-time constant, but we prefer to compute it
 // here since this captures every change to the code constructing the return trampoline.
 [[nodiscard]] uint64_t GetReturnTrampolineSize();
@@ -163,6 +179,19 @@ struct RelocatedInstruction {
                                                       uint64_t address_after_prologue,
                                                       uint64_t trampoline_address);
 
+// The two writes into the tracee that `InstrumentFunction` performs: the write of the jump into the
+// trampoline over the beginning of the function, and the write of `function_id` into the
+// trampoline. They are returned separately as they target different kinds of memory: the code of
+// the tracee, and the (writable while instrumenting) trampolines.
+struct InstrumentFunctionWrites {
+  TraceesMemoryWrite jump_to_trampoline;
+  TraceesMemoryWrite function_id;
+};
+
+[[nodiscard]] ErrorMessageOr<InstrumentFunctionWrites> GetInstrumentFunctionWrites(
+    uint64_t function_address, uint64_t function_id, uint64_t address_after_prologue,
+    uint64_t trampoline_address);
+
 // Move every instruction pointer that was in the middle of an overwritten function prologue to
 // the corresponding place in the trampoline.
 void MoveInstructionPointersOutOfOverwrittenCode(
@@ -8,6 +8,7 @@
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
 #include <absl/hash/hash.h>
+#include <absl/time/time.h>
 #include <sys/types.h>
 
 #include <cstdint>
@@ -43,6 +44,8 @@ class InstrumentationManager {
     std::vector<AddressRange> entry_trampoline_address_ranges;
     AddressRange return_trampoline_address_range;
     std::filesystem::path injected_library_path;
+    // How long the target process was stopped to instrument the functions.
+    absl::Duration stop_duration;
   };
 
   // On the first call to this function we inject OrbitUserSpaceInstrumentation.so into the target
@@ -22,14 +22,22 @@ using orbit_capture_service_base::CaptureStartStopListener;
 using orbit_grpc_protos::CaptureOptions;
 using orbit_grpc_protos::CaptureRequest;
 using orbit_grpc_protos::CaptureResponse;
+using orbit_producer_event_processor::GrpcClientCaptureEventCollector;
 
 grpc::Status WindowsCaptureService::Capture(
-    grpc::ServerContext*,
+    grpc::ServerContext* context,
     grpc::ServerReaderWriter<CaptureResponse, CaptureRequest>* reader_writer) {
   orbit_base::SetCurrentThreadName("WinCS::Capture");
 
-  orbit_producer_event_processor::GrpcClientCaptureEventCollector
-      grpc_client_capture_event_collector{reader_writer};
+  // The CaptureRequest is read first, as it carries the options of the
+  // GrpcClientCaptureEventCollector.
+  orbit_capture_service_base::GrpcStartStopCaptureRequestWaiter
+      grpc_start_stop_capture_request_waiter{reader_writer};
+  const CaptureRequest capture_request =
+      grpc_start_stop_capture_request_waiter.WaitForStartCaptureRequest();
+
+  GrpcClientCaptureEventCollector grpc_client_capture_event_collector{
+      reader_writer, GrpcClientCaptureEventCollector::GetOptionsFromCaptureRequest(capture_request)};
   CaptureServiceBase::CaptureInitializationResult initialization_result =
       InitializeCapture(&grpc_client_capture_event_collector);
   switch (initialization_result) {
@@ -40,10 +48,13 @@ grpc::Status WindowsCaptureService::Capture(
               "Cannot start capture because another capture is already in progress"};
   }
 
-  orbit_capture_service_base::GrpcStartStopCaptureRequestWaiter
-      grpc_start_stop_capture_request_waiter{reader_writer};
-  const CaptureOptions& capture_options =
-      grpc_start_stop_capture_request_waiter.WaitForStartCaptureRequest();
+  if (capture_request.capture_response_encoding() == CaptureRequest::kPackedCaptureEvents) {
+    grpc_client_capture_event_collector.EnablePackedCaptureEvents();
+  }
+  if (capture_request.compress_capture_responses()) {
+    context->set_compression_algorithm(GRPC_COMPRESS_GZIP);
+  }
+  const CaptureOptions& capture_options = capture_request.capture_options();
 
   if (capture_options.enable_api()) {
     EnableApiInTracee(capture_options);